@@ -0,0 +1,584 @@
+/**
+ * @file main.c
+ * @brief IRDB基准测试 - 解析/编码/解码/查找/缓存的每次操作耗时与分配
+ *
+ * 合成10~10000条目的数据库逐项测量，每项一行:
+ *   BENCH <name> n=<entries> ops=<ops> ns/op=<ns> allocs/op=<a> bytes/op=<b>
+ * 便于逐提交对比。native_sim用主机单调时钟计时，其余目标用周期计数器。
+ *
+ * 最后是往返矩阵: 每个已注册协议的随机码值编码后注入抖动、漂移、丢失
+ * 间隔，再经irdb_decode_from_raw解码，每个协议一行:
+ *   RT <protocol> <ok%> <ns/frame> ... (各列一种损伤)
+ */
+
+#include "irdb_loader.h"
+#include "irdb_protocol.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+
+#ifdef CONFIG_NATIVE_LIBC
+#include <time.h>
+#endif
+
+#define BENCH_MAX_ENTRIES CONFIG_IRDB_BENCH_MAX_ENTRIES
+#define BENCH_OPS CONFIG_IRDB_BENCH_OPS
+#define BENCH_DECODE_SAMPLES 32 // 解码测量用的预编码帧数
+#define BENCH_MAX_TIMINGS 128
+
+#define RT_CODES CONFIG_IRDB_BENCH_RT_CODES
+#define RT_FRAMES CONFIG_IRDB_BENCH_RT_FRAMES
+#define RT_JITTER_US CONFIG_IRDB_BENCH_RT_JITTER_US
+#define RT_DRIFT_PERCENT CONFIG_IRDB_BENCH_RT_DRIFT_PERCENT
+#define RT_DROP_PERCENT CONFIG_IRDB_BENCH_RT_DROP_PERCENT
+#define RT_BATCH 32 // 一次计时解码的帧数，编码和损伤不计入
+
+/* 合成库的协议组合 - 各协议的位宽都能容纳下面的设备/功能码 */
+static const uint16_t bench_protocols[] = {
+    IRDB_PROTOCOL_NEC1,  IRDB_PROTOCOL_SONY12,    IRDB_PROTOCOL_RC5,
+    IRDB_PROTOCOL_RC6,   IRDB_PROTOCOL_SAMSUNG32,
+};
+
+/* 分配计数 - CMakeLists以--wrap把malloc/calloc/realloc/k_malloc和数据库堆
+ * 接到这里 */
+static struct {
+  uint32_t count;
+  uint64_t bytes;
+} allocs;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__real_k_malloc(size_t size);
+void *__real_irdb_heap_alloc(size_t size);
+void *__real_irdb_heap_calloc(size_t nmemb, size_t size);
+void *__real_irdb_heap_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+  allocs.count++;
+  allocs.bytes += size;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size) {
+  allocs.count++;
+  allocs.bytes += nmemb * size;
+  return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  allocs.count++;
+  allocs.bytes += size;
+  return __real_realloc(ptr, size);
+}
+
+void *__wrap_k_malloc(size_t size) {
+  allocs.count++;
+  allocs.bytes += size;
+  return __real_k_malloc(size);
+}
+
+void *__wrap_irdb_heap_alloc(size_t size) {
+  allocs.count++;
+  allocs.bytes += size;
+  return __real_irdb_heap_alloc(size);
+}
+
+void *__wrap_irdb_heap_calloc(size_t nmemb, size_t size) {
+  allocs.count++;
+  allocs.bytes += nmemb * size;
+  return __real_irdb_heap_calloc(nmemb, size);
+}
+
+void *__wrap_irdb_heap_realloc(void *ptr, size_t size) {
+  allocs.count++;
+  allocs.bytes += size;
+  return __real_irdb_heap_realloc(ptr, size);
+}
+
+/* 计时 - native_sim的内核时钟是仿真时间，改用主机时钟 */
+#ifdef CONFIG_NATIVE_LIBC
+static uint64_t bench_now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+#else
+/* 32位周期计数按差值累加，单次测量不超过一个回绕周期 */
+static uint64_t bench_now_ns(void) {
+  static uint32_t last;
+  static uint64_t total;
+  uint32_t now = k_cycle_get_32();
+
+  total += now - last;
+  last = now;
+  return k_cyc_to_ns_floor64(total);
+}
+#endif
+
+/* 一次测量 */
+typedef struct {
+  uint64_t start_ns;
+  uint32_t start_allocs;
+  uint64_t start_bytes;
+} bench_t;
+
+static void bench_begin(bench_t *b) {
+  b->start_allocs = allocs.count;
+  b->start_bytes = allocs.bytes;
+  b->start_ns = bench_now_ns();
+}
+
+/* 输出一行结果 - 分配次数保留一位小数 */
+static void bench_report(const char *name, uint32_t entries, uint32_t ops,
+                         uint64_t ns, uint32_t count, uint64_t bytes) {
+  uint32_t allocs_x10 = (uint64_t)count * 10 / ops;
+
+  printf("BENCH %-15s n=%-5u ops=%-6u ns/op=%-8llu allocs/op=%u.%u "
+         "bytes/op=%llu\n",
+         name, entries, ops, (unsigned long long)(ns / ops), allocs_x10 / 10,
+         allocs_x10 % 10, (unsigned long long)(bytes / ops));
+}
+
+static void bench_end(const bench_t *b, const char *name, uint32_t entries,
+                      uint32_t ops) {
+  bench_report(name, entries, ops, bench_now_ns() - b->start_ns,
+               allocs.count - b->start_allocs, allocs.bytes - b->start_bytes);
+}
+
+/* 第i个合成条目 - 功能码6位、设备码5位，RC5也能编码；有子设备码的
+ * 协议子设备取设备码，解码结果能在库中查到 */
+static void bench_entry(uint32_t i, irdb_entry_t *entry) {
+  const irdb_protocol_params_t *params;
+
+  memset(entry, 0, sizeof(*entry));
+  entry->protocol = bench_protocols[i % ARRAY_SIZE(bench_protocols)];
+  entry->device = (i / 64) % 32;
+  entry->function = i % 64;
+
+  params = irdb_get_protocol_params(entry->protocol);
+  if (params && params->subdevice_bits > 0) {
+    entry->subdevice = entry->device;
+  }
+}
+
+/* 生成n行CSV */
+static char *bench_csv(uint32_t n) {
+  size_t size = 64 + (size_t)n * 32;
+  char *csv = __real_malloc(size);
+  size_t len;
+
+  if (!csv) {
+    return NULL;
+  }
+
+  len = snprintf(csv, size, "# Format: function_name,protocol,device,"
+                            "subdevice,function\n");
+  for (uint32_t i = 0; i < n; i++) {
+    irdb_entry_t e;
+
+    bench_entry(i, &e);
+    len += snprintf(csv + len, size - len, "F%04u,%u,%u,%u,%u\n", i,
+                    e.protocol, e.device, e.subdevice, e.function);
+  }
+  return csv;
+}
+
+static void bench_parse(const char *csv, uint32_t n) {
+  uint32_t ops = MAX(1, BENCH_OPS / n);
+  bench_t b;
+
+  bench_begin(&b);
+  for (uint32_t i = 0; i < ops; i++) {
+    irdb_database_t db;
+
+    if (irdb_parse_csv(csv, &db) < 0) {
+      printf("parse failed at n=%u\n", n);
+      return;
+    }
+    irdb_free_database(&db);
+  }
+  bench_end(&b, "parse_csv", n, ops);
+}
+
+static void bench_encode(const irdb_database_t *db, uint32_t n) {
+  ir_timing_t timings[BENCH_MAX_TIMINGS];
+  uint32_t ops = MAX(BENCH_OPS, n);
+  bench_t b;
+
+  bench_begin(&b);
+  for (uint32_t i = 0; i < ops; i++) {
+    uint32_t count;
+
+    irdb_encode_to_raw(&db->entries[i % n], timings, &count,
+                       BENCH_MAX_TIMINGS);
+  }
+  bench_end(&b, "encode_to_raw", n, ops);
+}
+
+static void bench_decode(const irdb_database_t *db, uint32_t n) {
+  static ir_timing_t frames[BENCH_DECODE_SAMPLES][BENCH_MAX_TIMINGS];
+  static uint32_t counts[BENCH_DECODE_SAMPLES];
+  uint32_t samples = MIN(n, BENCH_DECODE_SAMPLES);
+  uint32_t ops = BENCH_OPS;
+  uint32_t failed = 0;
+  bench_t b;
+
+  /* 样本均匀取自全库，覆盖各协议 */
+  for (uint32_t s = 0; s < samples; s++) {
+    irdb_encode_to_raw(&db->entries[s * n / samples], frames[s], &counts[s],
+                       BENCH_MAX_TIMINGS);
+  }
+
+  bench_begin(&b);
+  for (uint32_t i = 0; i < ops; i++) {
+    irdb_entry_t entry;
+    uint32_t s = i % samples;
+
+    if (irdb_decode_from_raw(db, frames[s], counts[s], &entry) < 0) {
+      failed++;
+    }
+  }
+  bench_end(&b, "decode_from_raw", n, ops);
+
+  if (failed) {
+    printf("  %u/%u frames not decoded\n", failed, ops);
+  }
+}
+
+static void bench_find(const irdb_database_t *db, uint32_t n) {
+  uint32_t ops = MAX(BENCH_OPS, n);
+  char name[16];
+  bench_t b;
+
+  bench_begin(&b);
+  for (uint32_t i = 0; i < ops; i++) {
+    snprintf(name, sizeof(name), "F%04u", (i * 7919) % n);
+    if (!irdb_find_function(db, name)) {
+      printf("find failed: %s\n", name);
+      return;
+    }
+  }
+  bench_end(&b, "find_function", n, ops);
+
+  bench_begin(&b);
+  for (uint32_t i = 0; i < ops; i++) {
+    irdb_find_function(db, "NoSuchKey");
+  }
+  bench_end(&b, "find_miss", n, ops);
+}
+
+/* 缓存 - 放入预算内能容纳的若干个数据库，再测命中/未命中查找 */
+static void bench_cache(const char *csv, uint32_t n) {
+  static const char *const types[] = {"TV", "AVR", "STB", "DVD"};
+  irdb_cache_key_t keys[ARRAY_SIZE(types)];
+  uint32_t stored = 0;
+  bench_t b;
+
+  uint64_t put_ns = 0;
+  uint32_t put_allocs = 0;
+  uint64_t put_bytes = 0;
+
+  irdb_cache_clear();
+
+  for (size_t k = 0; k < ARRAY_SIZE(types); k++) {
+    irdb_database_t db;
+
+    keys[k] = (irdb_cache_key_t){.manufacturer = "Bench",
+                                 .device_type = types[k],
+                                 .device = k,
+                                 .source = IRDB_LOAD_EMBEDDED};
+    if (irdb_parse_csv(csv, &db) < 0) {
+      break;
+    }
+
+    /* 只计put本身 (键拷贝、节点分配、淘汰)，不计解析 */
+    uint32_t start_allocs = allocs.count;
+    uint64_t start_bytes = allocs.bytes;
+    uint64_t start_ns = bench_now_ns();
+    int ret = irdb_cache_put(&keys[k], &db, NULL);
+
+    put_ns += bench_now_ns() - start_ns;
+    put_allocs += allocs.count - start_allocs;
+    put_bytes += allocs.bytes - start_bytes;
+
+    if (ret < 0) {
+      irdb_free_database(&db);
+      break;
+    }
+    stored++;
+  }
+
+  if (stored == 0) {
+    printf("BENCH cache           n=%-5u skipped (over %u B budget)\n", n,
+           IRDB_CACHE_BYTES);
+    return;
+  }
+
+  bench_report("cache_put", n, stored, put_ns, put_allocs, put_bytes);
+
+  bench_begin(&b);
+  for (uint32_t i = 0; i < BENCH_OPS; i++) {
+    irdb_database_t *db;
+
+    if (irdb_cache_get(&keys[i % stored], &db) == 0) {
+      irdb_cache_release(db);
+    }
+  }
+  bench_end(&b, "cache_get_hit", n, BENCH_OPS);
+
+  irdb_cache_key_t miss = {.manufacturer = "Bench",
+                           .device_type = "None",
+                           .source = IRDB_LOAD_EMBEDDED};
+  bench_begin(&b);
+  for (uint32_t i = 0; i < BENCH_OPS; i++) {
+    irdb_database_t *db;
+
+    irdb_cache_get(&miss, &db);
+  }
+  bench_end(&b, "cache_get_miss", n, BENCH_OPS);
+
+  irdb_cache_clear();
+}
+
+/* 往返矩阵的一列 - 时长各自加均匀抖动(±jitter_us)，整体按drift_percent
+ * 伸缩(发射端晶振偏差)，drop_percent的帧丢失一个间隔(日光灯干扰或
+ * 接收头漏检，前后两个mark并为一个) */
+typedef struct {
+  const char *name;
+  uint16_t jitter_us;
+  int8_t drift_percent;
+  uint8_t drop_percent;
+} rt_impair_t;
+
+static const rt_impair_t rt_impairs[] = {
+    {"clean", 0, 0, 0},
+    {"jitter", RT_JITTER_US, 0, 0},
+    {"drift+", 0, RT_DRIFT_PERCENT, 0},
+    {"drift-", 0, -RT_DRIFT_PERCENT, 0},
+    {"drop", 0, 0, RT_DROP_PERCENT},
+    {"all", RT_JITTER_US, RT_DRIFT_PERCENT, RT_DROP_PERCENT},
+};
+
+/* 一格的结果 */
+typedef struct {
+  uint32_t frames;
+  uint32_t ok;
+  uint32_t wrong; // 解出库中另一个码值 (比解不出更糟)
+  uint64_t ns;
+} rt_cell_t;
+
+/* 确定性伪随机 (xorshift32) - 各次运行结果可直接对比 */
+static uint32_t rt_rand(uint32_t *seed) {
+  uint32_t x = *seed;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *seed = x;
+  return x;
+}
+
+static uint32_t rt_bits(uint32_t *seed, uint8_t bits) {
+  return bits > 0 ? rt_rand(seed) & ((1U << bits) - 1) : 0;
+}
+
+/* 在原帧上施加损伤，返回新的时长数。末尾的帧间隔只受漂移影响 */
+static uint32_t rt_impair(const rt_impair_t *imp, ir_timing_t *timings,
+                          uint32_t count, uint32_t *seed) {
+  for (uint32_t i = 0; i < count; i++) {
+    int32_t us = ir_timing_us(timings[i]);
+
+    us += us * imp->drift_percent / 100;
+    if (imp->jitter_us > 0 && i + 1 < count) {
+      us += (int32_t)(rt_rand(seed) % (2U * imp->jitter_us + 1)) -
+            imp->jitter_us;
+    }
+    timings[i] = ir_timing_pack(MAX(us, 1));
+  }
+
+  /* 丢失第k个间隔 (k为奇数，不是末尾的帧间隔) */
+  if (imp->drop_percent > 0 && count >= 5 &&
+      rt_rand(seed) % 100 < imp->drop_percent) {
+    uint32_t k = 1 + 2 * (rt_rand(seed) % ((count - 3) / 2));
+
+    timings[k - 1] = ir_timing_pack(ir_timing_us(timings[k - 1]) +
+                                    ir_timing_us(timings[k]) +
+                                    ir_timing_us(timings[k + 1]));
+    memmove(&timings[k], &timings[k + 2],
+            (count - k - 2) * sizeof(ir_timing_t));
+    count -= 2;
+  }
+  return count;
+}
+
+/* 一个协议的随机码值库 - 名称只用于CSV，判定按码值 */
+static int rt_database(const irdb_protocol_params_t *params, uint32_t *seed,
+                       irdb_database_t *db) {
+  size_t size = 64 + (size_t)RT_CODES * 32;
+  char *csv = __real_malloc(size);
+  size_t len;
+  int ret;
+
+  if (!csv) {
+    return -ENOMEM;
+  }
+
+  len = snprintf(csv, size, "# Format: function_name,protocol,device,"
+                            "subdevice,function\n");
+  for (uint32_t i = 0; i < RT_CODES; i++) {
+    len += snprintf(csv + len, size - len, "R%03u,%u,%u,%u,%u\n", i,
+                    params->protocol_id, rt_bits(seed, params->device_bits),
+                    rt_bits(seed, params->subdevice_bits),
+                    rt_bits(seed, params->function_bits));
+  }
+
+  ret = irdb_parse_csv(csv, db);
+  free(csv);
+  return ret;
+}
+
+static bool rt_same_code(const irdb_entry_t *a, const irdb_entry_t *b) {
+  return a->protocol == b->protocol && a->device == b->device &&
+         a->subdevice == b->subdevice && a->function == b->function;
+}
+
+/* 一格: RT_FRAMES帧，按批编码+损伤后只对解码计时 */
+static void rt_cell(const irdb_database_t *db, const rt_impair_t *imp,
+                    uint32_t seed, rt_cell_t *cell) {
+  static ir_timing_t frames[RT_BATCH][BENCH_MAX_TIMINGS];
+  static uint32_t counts[RT_BATCH];
+  static const irdb_entry_t *sent[RT_BATCH];
+
+  memset(cell, 0, sizeof(*cell));
+
+  while (cell->frames < RT_FRAMES) {
+    uint32_t batch = MIN(RT_BATCH, RT_FRAMES - cell->frames);
+    uint32_t prepared = 0;
+
+    for (uint32_t i = 0; i < batch; i++) {
+      const irdb_entry_t *e = &db->entries[rt_rand(&seed) % db->entry_count];
+      uint32_t count;
+
+      if (irdb_encode_to_raw(e, frames[prepared], &count,
+                             BENCH_MAX_TIMINGS) < 0) {
+        continue; // 编码失败计为解不出
+      }
+      counts[prepared] = rt_impair(imp, frames[prepared], count, &seed);
+      sent[prepared++] = e;
+    }
+
+    irdb_entry_t decoded[RT_BATCH];
+    bool found[RT_BATCH];
+    uint64_t start = bench_now_ns();
+
+    for (uint32_t i = 0; i < prepared; i++) {
+      found[i] =
+          irdb_decode_from_raw(db, frames[i], counts[i], &decoded[i]) == 0;
+    }
+    cell->ns += bench_now_ns() - start;
+
+    for (uint32_t i = 0; i < prepared; i++) {
+      if (found[i] && rt_same_code(&decoded[i], sent[i])) {
+        cell->ok++;
+      } else if (found[i]) {
+        cell->wrong++;
+      }
+    }
+    cell->frames += batch;
+  }
+}
+
+/* 往返矩阵 - 行为协议，列为损伤，格内为正确率和每帧解码耗时 */
+static void bench_roundtrip(void) {
+  printf("Round-trip: %u codes/protocol, %u frames/cell, jitter=+-%uus "
+         "drift=+-%u%% drop=%u%%\n",
+         RT_CODES, RT_FRAMES, RT_JITTER_US, RT_DRIFT_PERCENT,
+         RT_DROP_PERCENT);
+
+  printf("RT %-10s", "protocol");
+  for (size_t c = 0; c < ARRAY_SIZE(rt_impairs); c++) {
+    printf(" %-14s", rt_impairs[c].name);
+  }
+  printf("\n");
+
+  for (uint32_t p = 0; p <= IRDB_PROTOCOL_MAX_ID; p++) {
+    const irdb_protocol_params_t *params = irdb_get_protocol_params(p);
+    rt_cell_t cells[ARRAY_SIZE(rt_impairs)];
+    uint32_t seed = 0x9E3779B9U ^ p;
+    irdb_database_t db;
+
+    if (!params) {
+      continue;
+    }
+    if (rt_database(params, &seed, &db) < 0) {
+      printf("RT %-10s database failed\n", params->name);
+      continue;
+    }
+
+    printf("RT %-10s", params->name);
+    for (size_t c = 0; c < ARRAY_SIZE(rt_impairs); c++) {
+      uint32_t ok_x10;
+
+      /* 每格独立的种子，增删一列不影响其余各列 */
+      rt_cell(&db, &rt_impairs[c], seed + c * 7919, &cells[c]);
+      ok_x10 = (uint64_t)cells[c].ok * 1000 / cells[c].frames;
+      printf(" %3u.%u%% %-7llu", ok_x10 / 10, ok_x10 % 10,
+             (unsigned long long)(cells[c].ns / cells[c].frames));
+    }
+    printf("\n");
+
+    for (size_t c = 0; c < ARRAY_SIZE(rt_impairs); c++) {
+      if (cells[c].wrong) {
+        printf("  %s %s: %u/%u frames decoded as another code\n",
+               params->name, rt_impairs[c].name, cells[c].wrong,
+               cells[c].frames);
+      }
+    }
+    irdb_free_database(&db);
+  }
+}
+
+static void bench_run(uint32_t n) {
+  char *csv = bench_csv(n);
+  irdb_database_t db;
+
+  if (!csv) {
+    printf("n=%u: out of memory for CSV\n", n);
+    return;
+  }
+
+  bench_parse(csv, n);
+
+  if (irdb_parse_csv(csv, &db) == 0) {
+    bench_encode(&db, n);
+    bench_decode(&db, n);
+    bench_find(&db, n);
+    irdb_free_database(&db);
+  }
+
+  bench_cache(csv, n);
+  free(csv);
+}
+
+int main(void) {
+  static const uint32_t sizes[] = {10, 100, 1000, 10000};
+
+  printf("IRDB benchmark: up to %u entries, %u ops per measurement\n",
+         BENCH_MAX_ENTRIES, BENCH_OPS);
+
+  /* 阶梯规模逐个测量，最后补测上限本身 (如qemu的500) */
+  for (size_t i = 0; i < ARRAY_SIZE(sizes) && sizes[i] < BENCH_MAX_ENTRIES;
+       i++) {
+    bench_run(sizes[i]);
+  }
+  bench_run(BENCH_MAX_ENTRIES);
+
+  bench_roundtrip();
+
+  printf("IRDB benchmark done\n");
+  return 0;
+}
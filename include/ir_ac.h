@@ -0,0 +1,118 @@
+/**
+ * @file ir_ac.h
+ * @brief 空调状态编码 - 由设备状态直接生成整帧
+ *
+ * 空调遥控器每次按键都发送完整状态(开关、模式、温度、风速、扫风)，
+ * 一帧上百位且带校验和，逐个组合学习要成千上万条信号。这里每个协议是
+ * 一个小模块: build把状态打包成帧字节(含校验和)，公共编码器按模块的
+ * 布局描述(引导码、位时序、分段)把字节直接编码进TX队列帧。调用者只需
+ * 保存一个ir_ac_state_t。
+ */
+
+#ifndef IR_AC_H
+#define IR_AC_H
+
+#include "ir_timing.h"
+#include "ir_tx_queue.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define IR_AC_FRAME_MAX_BYTES 32 // 单帧最大字节数
+#define IR_AC_MAX_SECTIONS 4     // 单帧最多分段数
+
+/* 运行模式 */
+typedef enum {
+  IR_AC_MODE_AUTO,
+  IR_AC_MODE_COOL,
+  IR_AC_MODE_DRY,
+  IR_AC_MODE_FAN,
+  IR_AC_MODE_HEAT,
+  IR_AC_MODE_COUNT
+} ir_ac_mode_t;
+
+/* 风速 */
+typedef enum {
+  IR_AC_FAN_AUTO,
+  IR_AC_FAN_LOW,
+  IR_AC_FAN_MID,
+  IR_AC_FAN_HIGH,
+  IR_AC_FAN_COUNT
+} ir_ac_fan_t;
+
+#define IR_AC_FLAG_TURBO 0x01 // 强力
+#define IR_AC_FLAG_LIGHT 0x02 // 面板灯
+#define IR_AC_FLAG_SLEEP 0x04 // 睡眠
+
+/* 设备状态 - 整体保存/恢复即可重现任意按键 */
+typedef struct {
+  uint8_t power;  // 0关 1开
+  uint8_t mode;   // ir_ac_mode_t
+  uint8_t temp_c; // 设定温度(摄氏)
+  uint8_t fan;    // ir_ac_fan_t
+  uint8_t swing;  // 0固定 1上下扫风
+  uint8_t flags;  // IR_AC_FLAG_*
+} ir_ac_state_t;
+
+/* 帧分段 - 字节段 + 附加固定位，段尾一个bit_mark加space_us */
+typedef struct {
+  uint8_t offset;     // 起始字节
+  uint8_t count;      // 字节数
+  uint8_t tail_bits;  // 段尾附加的固定位数 (如Gree的0b010)
+  uint8_t tail_value;
+  bool header;        // 段前发引导码
+  uint32_t space_us;  // 段尾间隔，最后一段即帧间隔(不输出)
+} ir_ac_section_t;
+
+/* 帧布局 - 脉冲距离编码 */
+typedef struct {
+  uint32_t header_mark;
+  uint32_t header_space;
+  uint32_t bit_mark;
+  uint32_t zero_space;
+  uint32_t one_space;
+  bool msb_first; // 字节内高位先发 (默认低位先发)
+  uint8_t section_count;
+  ir_ac_section_t sections[IR_AC_MAX_SECTIONS];
+} ir_ac_layout_t;
+
+/* 协议模块 */
+typedef struct {
+  const char *name;
+  uint32_t carrier_freq; // 载波频率(Hz)
+  uint8_t duty_cycle;    // 载波占空比(%)
+  uint8_t frame_bytes;   // build输出的字节数
+  uint8_t temp_min;      // 可设温度范围(摄氏)
+  uint8_t temp_max;
+  ir_ac_layout_t layout;
+  /* 状态 -> 帧字节(含校验和)，状态已按范围检查 */
+  void (*build)(const ir_ac_state_t *state, uint8_t *bytes);
+} ir_ac_protocol_t;
+
+/* 按名称查找协议，未找到返回NULL */
+const ir_ac_protocol_t *ir_ac_find(const char *name);
+
+/* 按序号获取协议，越界返回NULL */
+const ir_ac_protocol_t *ir_ac_get(size_t index);
+
+/* 默认状态: 关机、制冷、26度、自动风、不扫风 */
+void ir_ac_state_default(ir_ac_state_t *state);
+
+/* 生成帧字节 - 模式/风速/温度超出协议范围返回-EINVAL，返回字节数 */
+int ir_ac_build(const ir_ac_protocol_t *proto, const ir_ac_state_t *state,
+                uint8_t *bytes, size_t size);
+
+/* 编码为原始时序 (帧尾space并入帧间隔) */
+int ir_ac_encode(const ir_ac_protocol_t *proto, const ir_ac_state_t *state,
+                 ir_timing_t *timings_out, uint32_t *length_out,
+                 uint32_t max_length);
+
+/* 异步发送一帧 - 直接编码进队列帧后入队，按交互优先级发送 */
+int ir_ac_send(const ir_ac_protocol_t *proto, const ir_ac_state_t *state,
+               uint8_t channels, ir_tx_done_callback_t callback,
+               void *user_data);
+
+/* 协议模块 */
+extern const ir_ac_protocol_t ir_ac_gree;
+
+#endif /* IR_AC_H */
@@ -0,0 +1,72 @@
+/**
+ * @file ir_action.h
+ * @brief 动作表 - 解码结果按功能编号一次数组下标分派到动作
+ *
+ * 绑定(功能名 -> 处理函数或宏)在配置时编译: 每个功能名查出全部功能编号
+ * (ir_service_find_function_ids)，按遥控器槽位建以条目下标为索引的
+ * 动作表。接收回调从ir_service_rx_press取得解码时查出的功能编号后，
+ * 分派只是一次槽位判断和一次数组下标，不比较功能名，绑定多到数百条也
+ * 一样。
+ *
+ * 功能编号随活动集变化失效: 表记下编译时的活动集版本
+ * (ir_service_generation)，版本变化后的第一次分派按保存的绑定重新编译。
+ * 绑定表由调用者持有，使用期间须保持有效(通常为静态常量表)。不带
+ * "编号:"前缀的功能名绑定活动集中每个遥控器的同名条目(同一遥控器内的
+ * 重名条目也都绑定)，带前缀的只绑定该遥控器。
+ */
+
+#ifndef IR_ACTION_H
+#define IR_ACTION_H
+
+#include "ir_macro.h"
+#include "ir_service.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define IR_ACTION_REPEAT 0x01 // 长按的后续帧也触发，否则只有新按键触发
+
+/* 动作类型 */
+typedef enum {
+  IR_ACTION_HANDLER, // 调用处理函数
+  IR_ACTION_MACRO,   // 执行已编译的宏，正在执行时忽略
+} ir_action_kind_t;
+
+typedef struct ir_action_binding ir_action_binding_t;
+
+/* 处理函数 - 在解码工作队列中调用，应尽快返回 */
+typedef void (*ir_action_handler_t)(const ir_action_binding_t *binding,
+                                    const ir_service_press_t *press);
+
+struct ir_action_binding {
+  const char *function; // 功能名，可带"编号:"前缀
+  ir_action_kind_t kind;
+  union {
+    ir_action_handler_t handler;
+    ir_macro_t *macro;
+  };
+  void *user_data;
+  uint8_t flags; // IR_ACTION_*
+};
+
+typedef struct {
+  uint32_t generation; // 编译时的活动集版本
+  uint16_t bindings;   // 绑定数
+  uint16_t compiled;   // 查到功能编号、进入表的绑定
+  uint16_t entries;    // 表中绑定了动作的条目(各遥控器分别计)
+  uint32_t table_bytes;
+  uint32_t compiles;   // 编译次数(含活动集变化后的重新编译)
+  uint32_t dispatched; // 触发的动作
+  uint32_t unbound;    // 没有绑定动作或长按不触发的帧
+} ir_action_stats_t;
+
+/* 设置绑定并编译 - 查不到的功能名跳过并记日志，同一条目被多个绑定
+ * 匹配时后面的生效。返回进入表的绑定数或负errno */
+int ir_action_compile(const ir_action_binding_t *bindings, size_t count);
+
+/* 按解码结果分派 - 在接收回调中以ir_service_rx_press的结果调用。触发
+ * 返回1，没有绑定或长按不触发返回0 */
+int ir_action_dispatch(const ir_service_press_t *press);
+
+void ir_action_get_stats(ir_action_stats_t *stats);
+
+#endif /* IR_ACTION_H */
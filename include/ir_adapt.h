@@ -0,0 +1,90 @@
+/**
+ * @file ir_adapt.h
+ * @brief 时序自适应 - 按(协议, 设备)统计实际遥控器的时序，调整该协议的解码窗口
+ *
+ * 整帧解码成功且在当前遥控器中查到码值后，按irdb_timing_profile取该帧
+ * 各类时长(引导mark/space、位mark、0/1 space)归一化后的最短和最长，对
+ * 该(协议, 设备)做平均。样本满IR_ADAPT_MIN_FRAMES的各对按协议取并集，
+ * 两侧各加IR_ADAPT_MARGIN%余量，经irdb_adapt_windows替换该协议的窗口:
+ * 房间里的遥控器时序一致时窗口比标称容差窄，别的协议的帧在引导码处就被
+ * 排除; 遥控器整体偏离标称时窗口随之平移，处在标称容差边缘的帧不再失败。
+ * 统计定期写入IR_ADAPT_PATH，重启后恢复窗口。
+ *
+ * 同一协议新来的遥控器时序超出已学窗口时解不出: 短时间内连续
+ * IR_ADAPT_RELAX_MISSES帧解码失败即暂时恢复全部标称窗口，新遥控器在此
+ * 期间解出后加入统计，窗口随之放宽。
+ *
+ * 未启用CONFIG_IR_ADAPT时记录函数为空函数，调用点不产生代码。
+ */
+
+#ifndef IR_ADAPT_H
+#define IR_ADAPT_H
+
+#include "irdb_protocol.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define IR_ADAPT_PATH "/lfs/ir_adapt.bin"
+
+#ifdef CONFIG_IR_ADAPT_PAIRS
+#define IR_ADAPT_PAIRS CONFIG_IR_ADAPT_PAIRS
+#else
+#define IR_ADAPT_PAIRS 8
+#endif
+
+#ifdef CONFIG_IR_ADAPT_MIN_FRAMES
+#define IR_ADAPT_MIN_FRAMES CONFIG_IR_ADAPT_MIN_FRAMES
+#else
+#define IR_ADAPT_MIN_FRAMES 16
+#endif
+
+#ifdef CONFIG_IR_ADAPT_MARGIN
+#define IR_ADAPT_MARGIN CONFIG_IR_ADAPT_MARGIN
+#else
+#define IR_ADAPT_MARGIN 6
+#endif
+
+#define IR_ADAPT_RELAX_MISSES 3 // 连续失败帧数，超过即暂时恢复标称窗口
+
+/* 一个(协议, 设备)的时序统计 - 归一化后的平均最短/最长(us) */
+typedef struct {
+  uint16_t protocol;
+  uint16_t device;
+  uint32_t frames; // 0为空
+  uint16_t scale;  // 平均时间缩放 (Q12)
+  uint16_t lo_us[IRDB_ADAPT_CLASSES]; // hi_us为0的类别没有样本
+  uint16_t hi_us[IRDB_ADAPT_CLASSES];
+} ir_adapt_pair_t;
+
+#ifdef CONFIG_IR_ADAPT
+/* 一帧解码成功 - 在解码工作队列中调用 */
+void ir_adapt_note(const irdb_entry_t *code, const ir_timing_t *timings,
+                   uint32_t length);
+
+/* 一帧解码失败(不含重复码) */
+void ir_adapt_note_miss(void);
+#else
+static inline void ir_adapt_note(const irdb_entry_t *code,
+                                 const ir_timing_t *timings,
+                                 uint32_t length) {}
+
+static inline void ir_adapt_note_miss(void) {}
+#endif
+
+/* 恢复保存的统计并替换窗口，开始定期保存 */
+int ir_adapt_init(void);
+
+/* 立即保存 */
+int ir_adapt_save(void);
+
+/* 取统计表中的非空项，返回项数 */
+size_t ir_adapt_get_pairs(ir_adapt_pair_t *out, size_t max);
+
+/* 当前是否暂时用标称窗口 */
+bool ir_adapt_relaxed(void);
+
+/* 清空统计，恢复标称窗口，同时删除保存的文件 */
+void ir_adapt_reset(void);
+
+#endif /* IR_ADAPT_H */
@@ -0,0 +1,85 @@
+/**
+ * @file ir_analytics.h
+ * @brief 单遍信号分析 - 边沿到达时逐个累计，随时可取结果
+ *
+ * 每个时长只进一次: 计入mark/space直方图(每格64us，帧间隔不计入)、
+ * 格内时长和、总和与最值，并按帧间隔划分帧、记下各帧起点。结果阶段
+ * 只扫描直方图: 相邻非空格连成一类，类中心为格内时长和除以个数。
+ * 全部为32位整数运算; 成批输入时按mark+space两个16位时序一次处理，
+ * Cortex-M4上最值用DSP双16位指令。
+ */
+
+#ifndef IR_ANALYTICS_H
+#define IR_ANALYTICS_H
+
+#include "ir_infer.h"
+#include "ir_timing.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define IR_ANALYTICS_BIN_SHIFT 6 // 直方图每格 1 << SHIFT 微秒
+#define IR_ANALYTICS_BINS 64     // 0~4095us，更长的(引导码)计入末格
+#define IR_ANALYTICS_CLUSTERS 6  // 每种电平报告的时长类上限(取个数最多的)
+#define IR_ANALYTICS_FRAME_GAP_US 8000 // 超过此长度的space视为帧间隔
+
+/* 时长类 */
+typedef struct {
+  uint32_t centroid_us; // 类中心
+  uint16_t count;       // 时长个数
+} ir_duration_cluster_t;
+
+/* 分析信号特征 */
+typedef struct {
+  uint32_t avg_mark;       // 平均mark时长
+  uint32_t avg_space;      // 平均space时长
+  uint32_t min_pulse;      // 最短脉冲
+  uint32_t max_pulse;      // 最长脉冲
+  uint32_t pulse_count;    // 脉冲数量
+  uint32_t estimated_freq; // 学习时测得的载波频率，0为未测得
+
+  uint16_t mark_hist[IR_ANALYTICS_BINS];
+  uint16_t space_hist[IR_ANALYTICS_BINS]; // 不含帧间隔
+  ir_duration_cluster_t mark_clusters[IR_ANALYTICS_CLUSTERS]; // 按时长升序
+  ir_duration_cluster_t space_clusters[IR_ANALYTICS_CLUSTERS];
+  uint8_t mark_cluster_count;
+  uint8_t space_cluster_count;
+  uint16_t frame_count; // 按帧间隔划分的帧数
+  uint32_t period_us;   // 相邻帧起点的平均间隔(重复周期)，单帧为0
+
+  bool inferred;           // 未识别为已知协议，但推断出了协议参数
+  ir_infer_result_t infer; // 推断结果 (inferred时)，保存时按此只存参数
+} ir_signal_analysis_t;
+
+/* 累计状态 - 下标0为mark，1为space */
+typedef struct {
+  uint16_t hist[2][IR_ANALYTICS_BINS];
+  uint32_t bin_sum[2][IR_ANALYTICS_BINS]; // 格内时长和，求类中心
+  uint32_t sum[2];
+  uint32_t min_us;
+  uint32_t max_us;
+  uint32_t pair_min; // 成批输入的双16位最值，结果阶段并入min/max
+  uint32_t pair_max;
+  uint32_t elapsed_us;  // 已输入的总时长
+  uint32_t first_start; // 首帧起点
+  uint32_t last_start;  // 最后一帧起点
+  uint32_t edges;
+  uint16_t frames;
+  bool in_gap; // 上一个space是帧间隔，下一个mark开始新帧
+} ir_analytics_t;
+
+/* 清零，开始新的信号 */
+void ir_analytics_reset(ir_analytics_t *a);
+
+/* 输入一个时长 (mark与space交替，从mark开始)，O(1) */
+void ir_analytics_push(ir_analytics_t *a, ir_timing_t timing);
+
+/* 成批输入，等价于逐个push */
+void ir_analytics_feed(ir_analytics_t *a, const ir_timing_t *timings,
+                       uint32_t count);
+
+/* 取结果 - 不改变累计状态，可在输入过程中调用。estimated_freq和推断
+ * 结果不由此填写 */
+void ir_analytics_result(const ir_analytics_t *a,
+                         ir_signal_analysis_t *analysis);
+
+#endif /* IR_ANALYTICS_H */
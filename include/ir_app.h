@@ -0,0 +1,21 @@
+/**
+ * @file ir_app.h
+ * @brief 产品应用模式 (CONFIG_IR_APP_PRODUCTION)
+ *
+ * 启动时加载CONFIG_IR_APP_REMOTES列出的遥控器并常开接收，main()随即
+ * 返回; 此后由解码工作队列中的接收回调和各传输(BLE、命令链路、CoAP、
+ * shell)自己的线程驱动，没有轮询和空转休眠。临时接管接收的功能(嗅探、
+ * 识别、学习匹配、BLE RX通知)停止接收后调用ir_app_rx_resume()交还。
+ */
+
+#ifndef IR_APP_H
+#define IR_APP_H
+
+#ifdef CONFIG_IR_APP_PRODUCTION
+/* 恢复常开接收 (应用的接收回调) */
+void ir_app_rx_resume(void);
+#else
+static inline void ir_app_rx_resume(void) {}
+#endif
+
+#endif /* IR_APP_H */
@@ -0,0 +1,50 @@
+/**
+ * @file ir_bench.h
+ * @brief 板上周期计数基准 - 在量产硬件上评估固件构建，无需调试器
+ *
+ * Cortex-M上用DWT周期计数器(CPU时钟)逐次计时，其余目标退回内核周期
+ * 计数。每次操作单独计时、排序后给出min/median/p99/max，中断不屏蔽，
+ * p99反映实际运行时的排队与抢占。
+ */
+
+#ifndef IR_BENCH_H
+#define IR_BENCH_H
+
+#include <stdint.h>
+
+#define IR_BENCH_MAX_OPS 1000      // 单项最多计时次数(样本数组在堆上)
+#define IR_BENCH_FLASH_OPS_MAX 20  // 存取flash的项目上限，避免磨损
+#define IR_BENCH_SIGNAL "bench.tmp" // 存取测试用的信号名，结束后删除
+
+/* 测量项目 */
+typedef enum {
+  IR_BENCH_ENCODE,  // irdb_encode_to_raw
+  IR_BENCH_DECODE,  // irdb_decode_from_raw
+  IR_BENCH_PARSE,   // irdb_parse_csv (16行)
+  IR_BENCH_FIND,    // irdb_find_function
+  IR_BENCH_COMPARE, // ir_learning_compare
+  IR_BENCH_SAVE,    // ir_learning_save
+  IR_BENCH_LOAD,    // ir_learning_load
+  IR_BENCH_COUNT
+} ir_bench_op_t;
+
+/* 单项结果 - 周期数，已扣除读计数器本身的开销 */
+typedef struct {
+  uint32_t ops;
+  uint32_t min;
+  uint32_t median;
+  uint32_t p99;
+  uint32_t max;
+} ir_bench_result_t;
+
+/* 项目名称，无效返回NULL */
+const char *ir_bench_name(ir_bench_op_t op);
+
+/* 计数器频率(Hz)，周期换算为时间用 */
+uint32_t ir_bench_cycles_per_sec(void);
+
+/* 测量一项 - ops为计时次数(存取flash的项目不超过IR_BENCH_FLASH_OPS_MAX)，
+ * 未启用信号存储时存取项目返回-ENOTSUP */
+int ir_bench_run(ir_bench_op_t op, uint32_t ops, ir_bench_result_t *result);
+
+#endif /* IR_BENCH_H */
@@ -0,0 +1,88 @@
+/**
+ * @file ir_ble.h
+ * @brief BLE外设 - 广播、连接与连接参数模式，以及手机直连的GATT红外服务
+ *
+ * ir_ble.c持有协议栈: 使能、可连接广播、当前连接和连接参数模式，供GATT
+ * 红外服务(ir_ble_service.c)和命令链路BLE后端(ir_link_ble.c)共用。
+ *
+ * 红外服务 (小端，UUID为IR_BLE_UUID_SERVICE(下表编号)，1为服务):
+ *   2 SEND_ID   写/无响应写  编号(i32) 次数 通道        -> 按功能编号发送
+ *   3 SEND_RAW  写/无响应写  载波Hz(u32) 帧间隔ms(u16) 次数 通道
+ *                            时序(ir_timing_t u16)...   -> 原始时序发送
+ *   4 LEARN     写           超时s(u8) [名称]           -> 开始学习
+ *               通知         状态 已识别 时序数(u16) 载波Hz(u32)
+ *                            P D S F(u16) 保存结果(i8)
+ *   5 RX        通知         P D S F(u16) 库中有该条目(u8)
+ *                            事件(u8: 0按下 1长按 2松开) 帧数(u16)
+ *                                                       -> 订阅即开始接收
+ *   6 MODE      读/写        IR_BLE_MODE_*(u8)
+ * 通道0为默认通道，帧间隔0按学习信号的重放间隔。发送在BT接收线程的写
+ * 回调中直接入队，不经其他线程转交，手机到红外发出的时延为一个连接间隔
+ * 加编码; 队列满时有响应写返回ATT错误，无响应写静默丢弃(ir counters中
+ * 计入TX丢弃)。
+ * SEND_RAW只用一次ATT写入，时序数受MTU限制(247字节MTU时最多118个)。
+ */
+
+#ifndef IR_BLE_H
+#define IR_BLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct bt_conn;
+
+/* 7a1e????-4952-4c4b-9a3c-2f1e0b5d6c70: 0x000x命令链路，0x010x红外服务 */
+#define IR_BLE_UUID(n)                                                         \
+  BT_UUID_128_ENCODE(0x7a1e0000 + (n), 0x4952, 0x4c4b, 0x9a3c, 0x2f1e0b5d6c70)
+#define IR_BLE_UUID_LINK(n) IR_BLE_UUID(0x0000 + (n))
+#define IR_BLE_UUID_SERVICE(n) IR_BLE_UUID(0x0100 + (n))
+
+/* 连接参数模式 */
+typedef enum {
+  IR_BLE_MODE_LOW_LATENCY, // 7.5~15ms间隔，不跳过连接事件
+  IR_BLE_MODE_LOW_POWER,   // 50~100ms间隔，允许跳过4个连接事件
+  IR_BLE_MODE_COUNT,
+} ir_ble_mode_t;
+
+/* 连接参数 (间隔单位1.25ms，监督超时单位10ms) */
+#define IR_BLE_LOW_LATENCY_INTERVAL_MIN 6
+#define IR_BLE_LOW_LATENCY_INTERVAL_MAX 12
+#define IR_BLE_LOW_LATENCY_LATENCY 0
+#define IR_BLE_LOW_LATENCY_TIMEOUT 400
+#define IR_BLE_LOW_POWER_INTERVAL_MIN 40
+#define IR_BLE_LOW_POWER_INTERVAL_MAX 80
+#define IR_BLE_LOW_POWER_LATENCY 4
+#define IR_BLE_LOW_POWER_TIMEOUT 600
+
+/* 新连接使用的模式 */
+#ifdef CONFIG_IR_BLE_LOW_LATENCY
+#define IR_BLE_DEFAULT_MODE IR_BLE_MODE_LOW_LATENCY
+#else
+#define IR_BLE_DEFAULT_MODE IR_BLE_MODE_LOW_POWER
+#endif
+
+/* 红外服务LEARN写入的超时上限 (秒) */
+#define IR_BLE_LEARN_TIMEOUT_MAX_S 60
+
+/* 初始化 - 使能协议栈并开始可连接广播，可重复调用 */
+int ir_ble_init(void);
+
+/* 切换连接参数模式 - 已连接时立即向主机请求更新，之后的连接也使用该模式 */
+int ir_ble_set_mode(ir_ble_mode_t mode);
+ir_ble_mode_t ir_ble_get_mode(void);
+
+/* 当前连接 (已加引用，用完bt_conn_unref)，未连接时为NULL */
+struct bt_conn *ir_ble_conn_get(void);
+
+/* 状态 - 连接中时给出当前间隔(1.25ms单位)和跳过事件数 */
+typedef struct {
+  bool connected;
+  ir_ble_mode_t mode;
+  uint16_t interval;
+  uint16_t latency;
+  uint16_t timeout;
+} ir_ble_status_t;
+
+void ir_ble_get_status(ir_ble_status_t *status);
+
+#endif /* IR_BLE_H */
@@ -0,0 +1,52 @@
+/**
+ * @file ir_calib.h
+ * @brief 接收头时序校准 - 测定解调接收头的mark/space偏差并在采集阶段补偿
+ *
+ * 对准接收头按已知遥控器的任意键(或self模式下本机LED对着接收头发送)，
+ * 收到的每帧先按各协议解码，再以解出的码值(含toggle位)重新编码得到标称
+ * 时序，逐沿求差; mark和space分别取平均作为该通道的补偿量，写入
+ * ir_hal_rx_set_bias并存入IR_CALIB_PATH，启动时ir_calib_load恢复。
+ * 补偿后的误差只剩抖动，可把解码容差(CONFIG_IRDB_TIMING_TOLERANCE)收紧。
+ */
+
+#ifndef IR_CALIB_H
+#define IR_CALIB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define IR_CALIB_PATH "/lfs/ir_calib.bin"
+#define IR_CALIB_MAX_EDGES 256 // 单帧最大沿数
+#define IR_CALIB_MAX_BIAS_US 300 // 超过该值视为测量有误，不采用
+
+/* 校准结果 - 误差为测得时长减标称时长(未补偿) */
+typedef struct {
+  uint8_t channel;
+  uint16_t protocol;     // 最后一个有效帧的协议
+  uint32_t frames;       // 有效帧数
+  uint32_t rejected;     // 收到但无法解码或沿数不符的帧
+  uint32_t edges;        // 参与统计的沿数
+  int16_t mark_bias_us;  // mark的平均误差
+  int16_t space_bias_us; // space的平均误差
+  uint32_t jitter_us;    // 去掉平均误差后的均方根抖动
+  uint32_t max_jitter_us; // 去掉平均误差后的最大偏差
+} ir_calib_result_t;
+
+/* 校准一个接收通道 - 收满frames个有效帧或timeout_ms到时结束。self为真时
+ * 本机按NEC1逐帧发送(LED需对着该接收头，结果含发送引擎的误差，见ir
+ * loopback)，否则等待外部遥控器。测量期间该通道的补偿清零; 成功后应用
+ * 新补偿并保存(保存失败时补偿仍生效，返回保存的错误码)。一帧都没收到
+ * 返回-ETIMEDOUT，偏差超过IR_CALIB_MAX_BIAS_US返回-ERANGE(保留原补偿) */
+int ir_calib_run(uint8_t channel, uint32_t frames, uint32_t timeout_ms,
+                 bool self, ir_calib_result_t *result);
+
+/* 读取保存的补偿并应用到HAL (启动时调用)，没有保存过返回-ENOENT */
+int ir_calib_load(void);
+
+/* 保存各通道当前的补偿 */
+int ir_calib_save(void);
+
+/* 清除一个通道的补偿并保存 */
+int ir_calib_clear(uint8_t channel);
+
+#endif /* IR_CALIB_H */
@@ -0,0 +1,92 @@
+/**
+ * @file ir_capture.h
+ * @brief 原始边沿流录制 - 现场录制、导出到主机、离线回放评估解码器
+ *
+ * 文件格式 (小端):
+ *   头部24字节: 魔数"IRCP" 版本 通道掩码 标注(协议 设备 子设备 功能)
+ *               保留 起始时间(us, 64位)
+ *   之后逐脉冲一条记录，两个LEB128变长整数:
+ *     时间戳差值 - 相对上一条记录(首条相对起始时间)，zigzag有符号
+ *     时长<<4 | 通道<<2 | 帧结束<<1 | mark
+ *   帧结束记录即ir_pulse_t的frame_end通知，时长为0。
+ * 标注为录制时按下的按键(协议为IR_CAPTURE_NO_LABEL时未标注)，回放时据此
+ * 统计解码正确率。
+ *
+ * 编解码(ir_capture_codec.c)不依赖HAL，主机回放(replay/)直接编译同一份;
+ * 录制会话(ir_capture.c)订阅HAL边沿流，录到的字节由shell以十六进制行
+ * 导出，scripts/ir_capture.py从串口日志中还原文件。
+ */
+
+#ifndef IR_CAPTURE_H
+#define IR_CAPTURE_H
+
+#include "ir_hal.h"
+#include "irdb_protocol.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define IR_CAPTURE_MAGIC "IRCP"
+#define IR_CAPTURE_VERSION 1
+#define IR_CAPTURE_HEADER_SIZE 24
+#define IR_CAPTURE_RECORD_MAX 16   // 单条记录的最大字节数
+#define IR_CAPTURE_NO_LABEL 0xFFFF // 头部协议字段: 未标注
+
+/* 录制缓冲 - 录制回调写入，shell线程取出导出，满时整条丢弃 */
+#ifdef CONFIG_IR_CAPTURE_BUFFER
+#define IR_CAPTURE_BUFFER CONFIG_IR_CAPTURE_BUFFER
+#else
+#define IR_CAPTURE_BUFFER 2048
+#endif
+
+/* 文件头 */
+typedef struct {
+  uint8_t version;
+  uint8_t channels;   // 录制的通道位掩码
+  irdb_entry_t label; // 标注，protocol为IR_CAPTURE_NO_LABEL时无效
+  uint64_t start_us;  // 起始时刻，与ir_pulse_t.timestamp_us同源
+} ir_capture_header_t;
+
+/* 读取状态 */
+typedef struct {
+  const uint8_t *p;
+  const uint8_t *end;
+  uint64_t now_us; // 上一条记录的时间戳
+} ir_capture_reader_t;
+
+/* 写出头部，返回IR_CAPTURE_HEADER_SIZE */
+size_t ir_capture_header_pack(const ir_capture_header_t *hdr, uint8_t *out);
+
+/* 解析头部 - 魔数或版本不符返回-EBADMSG，长度不足返回-EINVAL */
+int ir_capture_header_parse(const uint8_t *buf, size_t len,
+                            ir_capture_header_t *hdr);
+
+/* 编码一条脉冲记录到out(至少IR_CAPTURE_RECORD_MAX字节)，prev_us为上一条
+ * 已写出记录的时间戳；返回字节数 */
+size_t ir_capture_encode(uint64_t prev_us, const ir_pulse_t *pulse,
+                         uint8_t *out);
+
+/* 从头部之后的记录区开始读取 */
+void ir_capture_reader_init(ir_capture_reader_t *reader,
+                            const ir_capture_header_t *hdr,
+                            const uint8_t *records, size_t len);
+
+/* 读出下一条 - 返回1有效，0已读完，-EBADMSG记录截断或损坏 */
+int ir_capture_read(ir_capture_reader_t *reader, ir_pulse_t *pulse);
+
+/* 录制统计 */
+typedef struct {
+  uint32_t bytes;   // 已写入缓冲的字节数(含头部)
+  uint32_t records; // 已写入的记录数
+  uint32_t dropped; // 缓冲满丢弃的记录数
+} ir_capture_stats_t;
+
+/* 开始录制 - label可为NULL；头部即写入缓冲。已在录制时返回-EBUSY */
+int ir_capture_start(uint8_t channels, const irdb_entry_t *label);
+
+/* 取出已录制的字节，返回字节数 */
+size_t ir_capture_drain(uint8_t *buf, size_t size);
+
+/* 停止录制，缓冲中剩余的字节仍可drain；stats可为NULL */
+int ir_capture_stop(ir_capture_stats_t *stats);
+
+#endif /* IR_CAPTURE_H */
@@ -0,0 +1,66 @@
+/**
+ * @file ir_coap.h
+ * @brief CoAP端点 - 经Thread(OpenThread)等IPv6网络把发送命令暴露为资源
+ *
+ * 资源 (UDP，默认端口5683):
+ *   POST /ir/<遥控器>/<功能>[?r=次数&c=通道]  按"编号:功能"发送
+ *   POST /ir/<功能>[?r=次数&c=通道]           发往默认遥控器
+ *   POST /ir/batch  负载为多行"<遥控器>/<功能>[,次数[,通道]]"，
+ *                   按行依次入队，遇错停止
+ *   GET  /.well-known/core                    资源发现 (link-format)
+ * 次数默认1，通道为发射通道位掩码，0或省略为默认通道。
+ *
+ * 响应不阻塞接收: 确认型请求先回空ACK，整批发射完成(发送完成回调)后
+ * 再以非确认型独立响应带回同一token，负载为已发送条数(文本)。响应码:
+ * 2.04全部发出，4.04功能不存在，4.00格式错误，4.13负载过长，5.03没有
+ * 空闲请求槽，5.00发送失败。发送队列满时等待本请求已入队的帧完成再续发，
+ * 一个请求可以远多于发送队列深度。
+ *
+ * 接收线程只解析请求和回ACK，编码入队与响应在系统工作队列中进行。
+ */
+
+#ifndef IR_COAP_H
+#define IR_COAP_H
+
+#include <stdint.h>
+
+/* 监听端口 */
+#ifdef CONFIG_IR_COAP_PORT
+#define IR_COAP_PORT CONFIG_IR_COAP_PORT
+#else
+#define IR_COAP_PORT 5683
+#endif
+
+/* 同时挂起的请求数 - 每个请求占一个槽直到发射完成并响应 */
+#ifdef CONFIG_IR_COAP_PENDING
+#define IR_COAP_PENDING CONFIG_IR_COAP_PENDING
+#else
+#define IR_COAP_PENDING 8
+#endif
+
+/* 批量请求负载上限 (字节)，也决定接收缓冲大小 */
+#ifdef CONFIG_IR_COAP_PAYLOAD_MAX
+#define IR_COAP_PAYLOAD_MAX CONFIG_IR_COAP_PAYLOAD_MAX
+#else
+#define IR_COAP_PAYLOAD_MAX 256
+#endif
+
+#define IR_COAP_THREAD_STACK_SIZE 2048 // 接收线程栈
+#define IR_COAP_THREAD_PRIORITY 7      // 低于命令链路线程
+#define IR_COAP_RETRY_MS 5 // 队列满且本请求无在途帧时的重试间隔
+
+/* 计数 */
+typedef struct {
+  uint32_t requests; // 已受理的发送请求 (含批量)
+  uint32_t commands; // 已入队的命令
+  uint32_t rejected; // 没有空闲槽而拒绝
+  uint32_t errors;   // 响应码非2.04
+  uint32_t invalid;  // 无法解析或不支持的报文
+} ir_coap_stats_t;
+
+/* 初始化 - 启动接收线程，在任意IPv6接口上监听IR_COAP_PORT */
+int ir_coap_init(void);
+
+void ir_coap_get_stats(ir_coap_stats_t *stats);
+
+#endif /* IR_COAP_H */
@@ -0,0 +1,119 @@
+/**
+ * @file ir_dlink.h
+ * @brief 红外数据链路 - 两台设备之间经各自的TX/RX点对点传文件
+ *
+ * 现场克隆学习库时不再经UART逐个读文件: 发送端"ir dlink send"把信号库、
+ * 已编译的数据库镜像(本身已LZ压缩)等文件逐帧发给对面执行"ir dlink recv"
+ * 的设备，存到相同路径。
+ *
+ * 线路编码为4级脉冲间隔(4-PPM的间隔形式): 每个符号是1个节拍的mark加
+ * (1+k)个节拍的space，k为0-3携带2位，按相邻两个mark起点的间隔(2-5个
+ * 节拍)判决，不受接收头把mark展宽、space缩短的影响。帧以间隔7个节拍的
+ * 同步符号开头，最后一个符号后补一个mark结束间隔，静默超过帧间隔即帧
+ * 结束。帧内字节(高位在前，每字节4个符号):
+ *   类型 u8 | 序号 u8 | 负载长度 u8 | 负载 | CRC16 u16(小端)
+ * CRC与命令链路(ir_link.h)相同，为CRC-16/CCITT-FALSE，覆盖类型到负载
+ * 末尾。
+ *
+ * 停等确认: 发送端每帧等对面的ACK(序号相同，负载为int16状态)，超时重发;
+ * 接收端收到与上一帧序号相同的帧只重发上次的ACK。CRC错误的帧丢弃且
+ * 不响应，与命令链路相同。一个文件为FILE(大小u32 CRC32 u32 路径)、若干
+ * DATA、END，全部文件之后BYE。接收端写入"路径~"，END时核对大小和
+ * CRC32后改名为目标路径，失败的传输不覆盖原文件。路径须在IR_DLINK_ROOT
+ * 下且不含".."，否则拒收(-EACCES)。
+ *
+ * 速率由节拍决定，平均每2位3.5个节拍: 解调接收头(TSOP类，38kHz载波)
+ * 节拍不短于约8个载波周期(210us)，约2.7kbit/s; 打开
+ * CONFIG_IR_DLINK_ENVELOPE后LED不调制，对面用不解调的接收器(IrDA收发器、
+ * 光电二极管放大)，节拍可缩短到10-20us，即30-50kbit/s量级，上限为RX
+ * 后端的沿速率(见"ir loopback stress")，RX毛刺滤波门限须小于节拍。
+ * 传输期间发送队列应空闲; 收到的信号库等文件在下次加载(或重启)后生效。
+ */
+
+#ifndef IR_DLINK_H
+#define IR_DLINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* 节拍 (us) */
+#ifdef CONFIG_IR_DLINK_TICK_US
+#define IR_DLINK_TICK_US CONFIG_IR_DLINK_TICK_US
+#else
+#define IR_DLINK_TICK_US 210
+#endif
+
+/* 单帧最大负载 (字节) */
+#ifdef CONFIG_IR_DLINK_PAYLOAD_MAX
+#define IR_DLINK_PAYLOAD_MAX CONFIG_IR_DLINK_PAYLOAD_MAX
+#else
+#define IR_DLINK_PAYLOAD_MAX 128
+#endif
+
+/* 等待ACK的时间 (ms)，从本帧发完算起 */
+#ifdef CONFIG_IR_DLINK_ACK_TIMEOUT_MS
+#define IR_DLINK_ACK_TIMEOUT_MS CONFIG_IR_DLINK_ACK_TIMEOUT_MS
+#else
+#define IR_DLINK_ACK_TIMEOUT_MS 200
+#endif
+
+/* 每帧最多重发次数 */
+#ifdef CONFIG_IR_DLINK_RETRIES
+#define IR_DLINK_RETRIES CONFIG_IR_DLINK_RETRIES
+#else
+#define IR_DLINK_RETRIES 8
+#endif
+
+#define IR_DLINK_CARRIER 38000       // 调制时的载波频率
+#define IR_DLINK_DUTY 33             // 调制时的载波占空比
+#define IR_DLINK_CONNECT_MS 10000    // 首帧持续重发等待对面开始接收的时长
+#define IR_DLINK_HEADER_SIZE 3       // 类型 序号 负载长度
+#define IR_DLINK_CRC_SIZE 2
+#define IR_DLINK_SYNC_TICKS 7        // 同步符号的间隔(节拍)
+#define IR_DLINK_GAP_TICKS 12        // 帧间隔(节拍)，不低于HAL的下限
+#define IR_DLINK_PATH_MAX 64         // 路径最大长度(含结束符)
+#define IR_DLINK_ROOT "/lfs/"        // 接收端只写入此目录下的文件
+
+#define IR_DLINK_FRAME_MAX                                                     \
+  (IR_DLINK_HEADER_SIZE + IR_DLINK_PAYLOAD_MAX + IR_DLINK_CRC_SIZE)
+
+/* 帧类型 */
+typedef enum {
+  IR_DLINK_FILE = 0x01, // 大小u32 CRC32 u32 路径(无结束符)
+  IR_DLINK_DATA = 0x02, // 文件的下一段
+  IR_DLINK_END = 0x03,  // 文件结束，核对后改名
+  IR_DLINK_BYE = 0x04,  // 会话结束
+  IR_DLINK_ACK = 0x80,  // 状态int16
+} ir_dlink_type_t;
+
+typedef struct {
+  uint16_t files;    // 完成的文件
+  uint16_t failed;   // 对面拒收或核对失败的文件
+  uint32_t bytes;    // 文件字节数(不含帧开销和重发)
+  uint32_t frames;   // 发出的帧(含重发和ACK)
+  uint32_t retries;  // 超时重发
+  uint32_t errors;   // 收到的有同步符号但解码或CRC失败的帧
+  uint32_t elapsed_ms;
+} ir_dlink_stats_t;
+
+/* 每个文件完成后的回调 - result为0或负errno */
+typedef void (*ir_dlink_file_cb_t)(const char *path, uint32_t size, int result,
+                                   void *user_data);
+
+/* 发送paths中的文件，目录则发送其中全部文件(不递归)，最后发送BYE。
+ * rx_channel为接收ACK的通道。对面在IR_DLINK_CONNECT_MS内没有响应返回
+ * -ETIMEDOUT，中途某帧重发用尽返回-EIO; 对面拒收的文件计入failed后继续。
+ * 同一时刻只有一个会话(-EBUSY)。返回发送成功的文件数 */
+int ir_dlink_send(const char *const *paths, size_t count, uint8_t rx_channel,
+                  ir_dlink_file_cb_t cb, void *user_data,
+                  ir_dlink_stats_t *stats);
+
+/* 接收文件直到收到BYE或静默idle_ms，返回收到的文件数 */
+int ir_dlink_receive(uint8_t rx_channel, uint32_t idle_ms,
+                     ir_dlink_file_cb_t cb, void *user_data,
+                     ir_dlink_stats_t *stats);
+
+/* 有效速率 (bit/s)，按文件字节数和会话时长计 */
+uint32_t ir_dlink_rate(const ir_dlink_stats_t *stats);
+
+#endif /* IR_DLINK_H */
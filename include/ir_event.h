@@ -0,0 +1,81 @@
+/**
+ * @file ir_event.h
+ * @brief 二进制事件跟踪 - 热路径上代替LOG_INF/LOG_DBG
+ *
+ * 每个事件只写入一条定长记录(时间戳、编号和三个整数参数)，不格式化、
+ * 不经过日志后端，中断和定时器回调中也可以调用。格式串只在读取端
+ * (ir_event_format / "ir events")使用；"ir events raw"按十六进制输出
+ * 原始记录，可在主机上解析，之后也可改由RTT导出。
+ * 未启用CONFIG_IR_EVENT_TRACE时ir_event_emit为空函数，调用点不产生代码。
+ */
+
+#ifndef IR_EVENT_H
+#define IR_EVENT_H
+
+#include "irdb_protocol.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* 环形缓冲中保留的事件数 */
+#ifdef CONFIG_IR_EVENT_RECORDS
+#define IR_EVENT_RECORDS CONFIG_IR_EVENT_RECORDS
+#else
+#define IR_EVENT_RECORDS 128
+#endif
+
+/* 事件编号 - 只追加，主机端解析依赖编号不变 */
+typedef enum {
+  IR_EVENT_TX_SENT,      // 按条目发送完成: 码值，extra为次数
+  IR_EVENT_TX_PRONTO,    // Pronto发送完成: a次数，b载波(Hz)
+  IR_EVENT_TX_DROPPED,   // 发送队列满: a通道掩码，b队列深度
+  IR_EVENT_RX_DECODED,   // 解出且库中有: 码值，extra为通道
+  IR_EVENT_RX_CODE,      // 解出但库中没有: 码值，extra为通道
+  IR_EVENT_RX_REPEAT,    // 重复码: 码值，extra为通道
+  IR_EVENT_RX_FAILED,    // 整帧解码失败: a通道，b时序数
+  IR_EVENT_LEARN_DETECT, // 学习收到第一个沿: a第几次按键，b按键数
+  IR_EVENT_LEARN_PRESS,  // 多次学习录完一次按键: a/b同上，c时序数
+  IR_EVENT_LEARN_DONE,   // 录制完成: a取中值的按键数，b已录按键数，c时序数
+  IR_EVENT_COUNT
+} ir_event_id_t;
+
+/* 事件记录 - 16字节 */
+typedef struct {
+  uint32_t cycles; // k_cycle_get_32()
+  uint16_t id;     // ir_event_id_t
+  uint16_t a;
+  uint32_t b;
+  uint32_t c;
+} ir_event_t;
+
+#ifdef CONFIG_IR_EVENT_TRACE
+/* 记录事件 - 缓冲满时覆盖最旧的 */
+void ir_event_emit(uint16_t id, uint16_t a, uint32_t b, uint32_t c);
+#else
+static inline void ir_event_emit(uint16_t id, uint16_t a, uint32_t b,
+                                 uint32_t c) {}
+#endif
+
+/* 码值事件 - a协议，b设备<<16|子设备，c功能<<16|extra */
+static inline void ir_event_code(uint16_t id, const irdb_entry_t *code,
+                                 uint16_t extra) {
+  ir_event_emit(id, code->protocol,
+                (uint32_t)code->device << 16 | code->subdevice,
+                (uint32_t)code->function << 16 | extra);
+}
+
+/* 最近的max条事件，按时间先后排列，返回条数 */
+size_t ir_event_get(ir_event_t *out, size_t max);
+
+/* 启动(或清空)以来记录的事件总数，超出IR_EVENT_RECORDS的已被覆盖 */
+uint32_t ir_event_total(void);
+
+/* 事件名称，无效编号返回"?" */
+const char *ir_event_name(uint16_t id);
+
+/* 格式化为一行文本(不含时间戳)，返回写入的字符数 */
+int ir_event_format(const ir_event_t *event, char *buf, size_t size);
+
+/* 清空 */
+void ir_event_clear(void);
+
+#endif /* IR_EVENT_H */
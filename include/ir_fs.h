@@ -0,0 +1,16 @@
+/**
+ * @file ir_fs.h
+ * @brief LittleFS按需挂载
+ *
+ * /lfs不在启动时自动挂载(overlay的fstab不带automount)，由第一个存取
+ * 文件的调用者挂载: 学习信号库、数据库存储、flash缓存、接收头校准的
+ * 入口先调用ir_fs_mount()。没有用到存储的启动不碰flash。
+ */
+
+#ifndef IR_FS_H
+#define IR_FS_H
+
+/* 挂载/lfs，已挂载时直接返回0 */
+int ir_fs_mount(void);
+
+#endif /* IR_FS_H */
@@ -6,6 +6,7 @@
 #ifndef IR_HAL_H
 #define IR_HAL_H
 
+#include "ir_timing.h"
 #include <zephyr/device.h>
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/drivers/pwm.h>
@@ -13,31 +14,410 @@
 
 /* 配置参数 */
 #define IR_TX_NODE DT_NODELABEL(tx_pwm)
-#define IR_RX_PIN 12           // P0.14 用于IR接收
+#define IR_RX_PIN 12           // P1.12 默认IR接收头 (设备树未描述时)
 #define IR_CARRIER_FREQ 38000  // 38kHz载波
-#define IR_PWM_DUTY 33         // 33%占空比
+#define IR_PWM_DUTY 33         // 33%占空比 (未指定占空比时的默认值)
+#define IR_PWM_DUTY_MIN 10     // 可用占空比下限(%)
+#define IR_PWM_DUTY_MAX 50     // 可用占空比上限(%)
 #define IR_MAX_PULSE_US 100000 // 最大脉冲宽度100ms
 #define IR_TIMER_FREQ 1000000  // 1MHz定时器频率
 
+/* 全局占空比覆盖(%)，0为按协议/学习结果发送: 省电时所有发送统一用此值 */
+#ifdef CONFIG_IR_HAL_TX_DUTY_OVERRIDE
+#define IR_HAL_TX_DUTY_OVERRIDE CONFIG_IR_HAL_TX_DUTY_OVERRIDE
+#else
+#define IR_HAL_TX_DUTY_OVERRIDE 0
+#endif
+
+/* TX能耗估算参数 - LED电流、供电电压、上电期间(HFXO + PWM)的静态电流 */
+#ifdef CONFIG_IR_HAL_TX_LED_MA
+#define IR_HAL_TX_LED_MA CONFIG_IR_HAL_TX_LED_MA
+#else
+#define IR_HAL_TX_LED_MA 100
+#endif
+#ifdef CONFIG_IR_HAL_TX_SUPPLY_MV
+#define IR_HAL_TX_SUPPLY_MV CONFIG_IR_HAL_TX_SUPPLY_MV
+#else
+#define IR_HAL_TX_SUPPLY_MV 3000
+#endif
+#define IR_HAL_TX_ACTIVE_UA 600
+
+/* RX缓冲与消费线程 */
+#define IR_HAL_RX_RING_SIZE 256          // ISR->线程环形缓冲区(2的幂)
+#define IR_HAL_FRAME_GAP_US 10000        // 默认帧间隔: 超过该静默即认为帧结束
+#define IR_HAL_FRAME_GAP_MIN_US 2000     // 可设置的帧间隔下限
+#define IR_HAL_RX_THREAD_STACK_SIZE 1536 // RX消费线程栈
+#define IR_HAL_RX_THREAD_PRIORITY 1      // RX消费线程优先级
+#define IR_HAL_RX_WAKE_EACH_EDGE 1       // 每个边沿唤醒消费线程(流式解码低延迟)
+#define IR_HAL_RX_SUBSCRIBERS 4          // 同时订阅边沿流的消费者上限
+
+/* 回波抑制 - 本机发送期间及结束后这段时间内的边沿视为自身发射管的回波
+ * (接收头输出比光信号晚数百微秒) */
+#ifdef CONFIG_IR_HAL_RX_ECHO_GUARD_US
+#define IR_HAL_RX_ECHO_GUARD_US CONFIG_IR_HAL_RX_ECHO_GUARD_US
+#else
+#define IR_HAL_RX_ECHO_GUARD_US 1000
+#endif
+
+/* 毛刺滤波 - 短于门限的mark(如日光灯干扰)或space(接收头输出的短暂跳变)
+ * 在入队前并入相邻的段，不唤醒消费线程、不触发解码; 均为0时关闭 */
+#ifdef CONFIG_IR_HAL_RX_MIN_MARK_US
+#define IR_HAL_RX_MIN_MARK_US CONFIG_IR_HAL_RX_MIN_MARK_US
+#else
+#define IR_HAL_RX_MIN_MARK_US 50
+#endif
+#ifdef CONFIG_IR_HAL_RX_MIN_SPACE_US
+#define IR_HAL_RX_MIN_SPACE_US CONFIG_IR_HAL_RX_MIN_SPACE_US
+#else
+#define IR_HAL_RX_MIN_SPACE_US 50
+#endif
+
+/* nRF5340双核 - 接收引擎(捕获、回波窗口、载波测量)在网络核上运行
+ * (netcore/，CONFIG_IR_HAL_IPC_ENGINE)，服务/数据库/传输层和发送后端在
+ * 应用核(CONFIG_IR_HAL_IPC)。边沿批次和接收控制经ipc_service共享内存环
+ * 往返(ir_hal_ipc.c)，接口不变。网络核没有PWM/I2S，引擎一侧不发送 */
+#ifdef CONFIG_IR_HAL_IPC
+#define IR_HAL_RX_IPC 1
+#endif
+#ifdef CONFIG_IR_HAL_IPC_ENGINE
+#define IR_HAL_TX_NONE 1
+#endif
+
+/* TX比特流引擎: zephyr,user节点带ir-tx-i2s属性时，I2S的SDOUT接IR_TX_PIN，
+ * 载波调制后的mark/space展开为比特流由EasyDMA双缓冲回放，用于没有空闲
+ * PWM的板子 (i2s0不能同时交给Zephyr I2S驱动) */
+#if defined(CONFIG_NRFX_I2S0) && !defined(IR_HAL_TX_NONE) &&                 \
+    DT_NODE_HAS_PROP(DT_PATH(zephyr_user), ir_tx_i2s) &&                       \
+    !DT_NODE_HAS_STATUS(DT_NODELABEL(i2s0), okay)
+#define IR_HAL_TX_I2S 1
+#endif
+#define IR_I2S_BIT_RATE 2000000 // SDOUT比特率: MCK=32MHz/16，RATIO 32X
+
+/* 比特流缓冲 - 两块交替回放，每块(32位字)在2Mbps下约4ms */
+#ifdef CONFIG_IR_HAL_TX_I2S_WORDS
+#define IR_HAL_TX_I2S_WORDS CONFIG_IR_HAL_TX_I2S_WORDS
+#else
+#define IR_HAL_TX_I2S_WORDS 256
+#endif
+
+/* TX序列引擎: PWM0未交给Zephyr PWM驱动时，由nrfx直接驱动EasyDMA回放整帧 */
+#if defined(CONFIG_NRFX_PWM0) &&                                               \
+    !DT_NODE_HAS_STATUS(DT_NODELABEL(pwm0), okay) &&                          \
+    !defined(IR_HAL_TX_I2S) && !defined(IR_HAL_TX_NONE)
+#define IR_HAL_TX_SEQ 1
+#endif
+
+/* RX波形后端: 光电二极管(未解调)接SAADC，内部定时器连续采样、EasyDMA
+ * 双缓冲交替写入，每满一块在中断中做包络检测，得到与捕获后端相同的边沿
+ * 流，同时测出载波频率/占空比和信号幅度。SAADC不能交给Zephyr ADC驱动，
+ * 取代捕获后端，仅单路 */
+#if defined(CONFIG_IR_HAL_RX_ADC) && defined(CONFIG_NRFX_SAADC) &&            \
+    !DT_NODE_HAS_STATUS(DT_NODELABEL(adc), okay) && !defined(IR_HAL_RX_IPC)
+#define IR_HAL_RX_ADC 1
+#endif
+
+/* RX捕获后端: GPIOTE边沿经(D)PPI触发TIMER1 CAPTURE，时间戳由硬件锁存 */
+#if defined(CONFIG_NRFX_TIMER1) && defined(CONFIG_NRFX_GPPI) &&               \
+    !defined(IR_HAL_RX_IPC) && !defined(IR_HAL_RX_ADC)
+#define IR_HAL_RX_CAPTURE 1
+#endif
+
+/* 接收通道: zephyr,user节点的ir-rx-gpios每个条目一个接收头(如各房间的
+ * 传感器)，未描述时为IR_RX_PIN上的单个接收头。各通道有独立的环形缓冲区、
+ * 解码状态和回调，共用一个消费线程。捕获后端每个通道占TIMER1的一个CC，
+ * 最后一个CC留给帧结束比较，因此最多3路 */
+#define IR_RX_NODE DT_PATH(zephyr_user)
+#if DT_NODE_HAS_PROP(IR_RX_NODE, ir_rx_gpios)
+#define IR_HAL_RX_CHANNELS DT_PROP_LEN(IR_RX_NODE, ir_rx_gpios)
+#else
+#define IR_HAL_RX_CHANNELS 1
+#endif
+#define IR_HAL_RX_CHANNELS_MAX 3
+#define IR_HAL_RX_CH_DEFAULT BIT(0) // 单路接口使用的通道
+#define IR_HAL_RX_CH_ALL BIT_MASK(IR_HAL_RX_CHANNELS)
+
+/* 波形后端的采样率(Hz) - SAADC内部定时器为16MHz/CC(CC 80~2047)，最高
+ * 200kHz (tACQ 3us + 转换2us)。每个载波周期至少要有一个样点落在发光内，
+ * 载波频率应低于采样率的1/3 */
+#ifdef CONFIG_IR_HAL_RX_ADC_RATE
+#define IR_HAL_RX_ADC_RATE CONFIG_IR_HAL_RX_ADC_RATE
+#else
+#define IR_HAL_RX_ADC_RATE 200000
+#endif
+
+/* 每块DMA缓冲的样点数 - 即处理粒度和帧结束的额外时延(200kHz下1000点
+ * 为5ms)，共两块 */
+#ifdef CONFIG_IR_HAL_RX_ADC_SAMPLES
+#define IR_HAL_RX_ADC_SAMPLES CONFIG_IR_HAL_RX_ADC_SAMPLES
+#else
+#define IR_HAL_RX_ADC_SAMPLES 1000
+#endif
+
+/* 包络保持(us) - 超过此时长没有样点越过门限即mark结束，应长于最低载波
+ * 频率下两个发光脉冲之间的间隙 */
+#ifdef CONFIG_IR_HAL_RX_ADC_HOLD_US
+#define IR_HAL_RX_ADC_HOLD_US CONFIG_IR_HAL_RX_ADC_HOLD_US
+#else
+#define IR_HAL_RX_ADC_HOLD_US 50
+#endif
+
+/* 光电二极管接的模拟输入 (AIN0~7) */
+#ifdef CONFIG_IR_HAL_RX_ADC_AIN
+#define IR_HAL_RX_ADC_AIN CONFIG_IR_HAL_RX_ADC_AIN
+#else
+#define IR_HAL_RX_ADC_AIN 0
+#endif
+
+/* 最小判决门限(ADC计数，10位) - 门限取此值与静默噪声4倍中的较大者 */
+#ifdef CONFIG_IR_HAL_RX_ADC_MIN_SWING
+#define IR_HAL_RX_ADC_MIN_SWING CONFIG_IR_HAL_RX_ADC_MIN_SWING
+#else
+#define IR_HAL_RX_ADC_MIN_SWING 24
+#endif
+
+/* 低功耗接收: 帧间引脚只挂GPIOTE PORT SENSE(低功耗锁存)，TIMER1停止、
+ * 不占HFCLK; 首个下降沿切到硬件捕获，帧结束后恢复SENSE。多路接收时
+ * TIMER1由各通道共用，不能随单个通道起停，仅单路可用 */
+#if defined(CONFIG_IR_HAL_RX_LOWPOWER) && defined(IR_HAL_RX_CAPTURE) &&       \
+    IR_HAL_RX_CHANNELS == 1
+#define IR_HAL_RX_LOWPOWER 1
+#endif
+
+/* System OFF唤醒: 接收头引脚的DETECT唤醒芯片，启动早期即捕获唤醒的那一帧
+ * (ir_hal_wake.h)，仅nRF52的单路捕获后端 */
+#if defined(CONFIG_IR_HAL_RX_WAKE_OFF) && defined(IR_HAL_RX_CAPTURE)
+#define IR_HAL_RX_WAKE_OFF 1
+#endif
+
+/* TX门控: 无序列引擎时，TIMER4经GPIOTE持续产生载波，TIMER3在每个边沿
+ * 经PPI通道组开关载波，边沿时刻由硬件给出，不随逐脉冲的软件开销漂移 */
+#if !defined(IR_HAL_TX_SEQ) && !defined(IR_HAL_TX_I2S) &&                     \
+    !defined(IR_HAL_TX_NONE) && defined(CONFIG_IR_HAL_TX_GATE) &&             \
+    defined(IR_HAL_RX_CAPTURE)
+#define IR_HAL_TX_GATE 1
+#endif
+#define IR_GATE_CLOCK 16000000 // 门控载波与边沿计时器频率
+#define IR_GATE_LEAD_US 20     // 启动到第一个mark的间隔
+
+/* TX零延迟中断: 无DMA引擎和门控时，TIMER4比较中断注册为零延迟中断(不受
+ * irq_lock屏蔽，BLE协议栈和flash驱动的中断也不能抢占)，按预先算好的边沿
+ * 表在每次比较时翻转IR_TX_PIN，逐个载波周期输出; 边沿之间CPU空闲 */
+#if !defined(IR_HAL_TX_SEQ) && !defined(IR_HAL_TX_I2S) &&                     \
+    !defined(IR_HAL_TX_GATE) && !defined(IR_HAL_TX_NONE) &&                   \
+    defined(CONFIG_IR_HAL_TX_ZLI)
+#define IR_HAL_TX_ZLI 1
+#endif
+#define IR_ZLI_CLOCK 16000000 // 边沿表与载波的计时器频率
+#define IR_ZLI_LEAD_US 20     // 启动到第一个mark的间隔
+
+/* 边沿表 - 每个mark/space一项，更长的帧拒绝发送 */
+#ifdef CONFIG_IR_HAL_TX_ZLI_EDGES
+#define IR_HAL_TX_ZLI_EDGES CONFIG_IR_HAL_TX_ZLI_EDGES
+#else
+#define IR_HAL_TX_ZLI_EDGES 512
+#endif
+
+/* 载波测量: 未解调的光电二极管输入经GPIOTE/PPI驱动TIMER2计数边沿、
+ * TIMER3锁存时间戳，学习时测出真实的载波频率和占空比 (需捕获后端的GPIOTE) */
+#if defined(CONFIG_IR_HAL_CARRIER) && defined(IR_HAL_RX_CAPTURE)
+#define IR_HAL_CARRIER 1
+#define IR_CARRIER_PSEL CONFIG_IR_HAL_CARRIER_PIN
+#endif
+#define IR_CARRIER_CLOCK 16000000 // 时间戳计时器频率
+#define IR_CARRIER_MIN_EDGES 12   // mark内少于此边沿数不参与测量
+#define IR_CARRIER_IDLE_US 100    // 无边沿超过此时长视为载波间隙
+
+#define IR_TX_PIN NRF_GPIO_PIN_MAP(1, 11) // P1.11 IR LED (与pinctrl一致)
+#define IR_PWM_BASE_CLOCK 16000000        // PWM基准时钟16MHz
+
+/* 序列段缓冲 - 每个mark/space一段(SEQ[n].REFRESH保持一个比较值)，SEQ0/
+ * SEQ1交替回放，中断逐段装入; 比这更长的帧由TX线程边放边补 (2的幂) */
+#ifdef CONFIG_IR_HAL_SEQ_SEGMENTS
+#define IR_HAL_SEQ_SEGMENTS CONFIG_IR_HAL_SEQ_SEGMENTS
+#else
+#define IR_HAL_SEQ_SEGMENTS 256
+#endif
+
+/* 多路发射: 序列引擎下PWM0的4个输出通道各接一个发射管，通道0为IR_TX_PIN。
+ * 同一帧可同时从多个通道发出(COMMON)，不同帧在各自通道上并行(INDIVIDUAL，
+ * 任一路的边沿处分段，每段4个比较值)。其余后端只有通道0 */
+#if defined(IR_HAL_TX_SEQ) && defined(CONFIG_IR_HAL_TX_CHANNELS)
+#define IR_HAL_TX_CHANNELS CONFIG_IR_HAL_TX_CHANNELS
+#else
+#define IR_HAL_TX_CHANNELS 1
+#endif
+#define IR_HAL_TX_CH_DEFAULT BIT(0) // 单路接口使用的通道
+#define IR_HAL_TX_CH_ALL BIT_MASK(IR_HAL_TX_CHANNELS)
+
 /* IR脉冲结构 */
 typedef struct {
   uint32_t duration_us; // 持续时间(微秒)
   bool is_mark;         // true=mark(载波), false=space(无载波)
+  uint8_t channel;      // 接收通道
+  uint64_t timestamp_us; // 脉冲起点的64位时间戳，与系统运行时间同源，不回绕
+  bool frame_end; // 帧结束通知(静默超过帧间隔)，不是脉冲，duration_us为0
+  bool echo; // 本机发送的回波，只送给ir_hal_rx_set_echo接收回波的订阅者
 } ir_pulse_t;
 
-/* IR接收回调 */
+/* IR接收回调 - 在RX消费线程中调用(非ISR上下文) */
 typedef void (*ir_rx_callback_t)(ir_pulse_t *pulse, void *user_data);
 
+/* RX统计 */
+typedef struct {
+  uint32_t edges;     // 入队脉冲数
+  uint32_t frames;    // 帧数 (帧起点时间戳个数)
+  uint32_t glitches;  // 毛刺滤波丢弃的段数
+  uint32_t overflows; // 环形缓冲区满丢弃数 (各通道之和)
+  uint32_t max_fill;  // 单个通道缓冲区的最大占用
+  uint32_t wakeups;   // 消费线程唤醒次数
+  uint32_t sense_wakeups; // 低功耗模式下由SENSE唤醒进入捕获的次数
+  uint32_t echo_dropped;  // 没有订阅者接收回波、在ISR中丢弃的边沿
+  uint32_t echo_tagged;   // 标记为回波入队的脉冲
+  uint32_t wake_frames;   // System OFF唤醒时启动早期捕获、补入队列的帧
+} ir_hal_rx_stats_t;
+
+/* 波形后端统计 - 幅度均为相对静默基线的ADC计数(10位)，用于判断安装位置
+ * 的信号余量: 各帧峰值摆幅的最小值接近门限时，再远或再偏就会丢帧 */
+typedef struct {
+  uint32_t sample_rate; // 实际采样率(Hz)
+  uint32_t buffers;     // 处理的DMA缓冲块
+  uint32_t overruns;    // 处理不及、采样中断后重启的次数
+  uint32_t marks;       // 包络检测出的mark
+  uint16_t baseline;    // 静默电平
+  uint16_t noise;       // 静默时的平均偏差
+  uint16_t threshold;   // 当前判决门限
+  uint16_t last_peak;   // 上一帧的峰值摆幅
+  uint16_t min_peak;    // 各帧峰值摆幅的最小值 (尚无帧时为0)
+  uint16_t max_peak;    // 各帧峰值摆幅的最大值
+} ir_hal_rx_adc_stats_t;
+
 /* HAL初始化 */
 int ir_hal_init(void);
 
-/* 发送接口 */
-int ir_hal_tx_start(uint32_t carrier_freq);
+/* 发送接口 - duty_cycle为载波占空比(%)，0取IR_PWM_DUTY，超出
+ * [IR_PWM_DUTY_MIN, IR_PWM_DUTY_MAX]时截断; 设置了全局覆盖时以覆盖值为准 */
+int ir_hal_tx_start(uint32_t carrier_freq, uint8_t duty_cycle);
 int ir_hal_tx_stop(void);
 int ir_hal_tx_pulse(uint32_t duration_us, bool is_mark);
 
-/* 接收接口 */
-int ir_hal_rx_start(ir_rx_callback_t callback, void *user_data);
-int ir_hal_rx_stop(void);
+/* 发送整帧 - timings为mark/space交替时序(偶数索引为mark)，阻塞至回放完成 */
+int ir_hal_tx_frame(const ir_timing_t *timings, size_t count,
+                    uint32_t carrier_freq, uint8_t duty_cycle);
+
+/* 按载波周期数发送 (Pronto) - periods为mark/space交替的周期数，
+ * 偶数个时末尾间隔视为lead-out，回放结束后等待而不占序列缓冲 */
+int ir_hal_tx_periods(const uint16_t *periods, size_t count,
+                      uint32_t carrier_freq, uint8_t duty_cycle);
+
+/* 多路发送的一路 - channels为通道位掩码 */
+typedef struct {
+  uint8_t channels;
+  const ir_timing_t *timings;
+  size_t count;
+} ir_hal_tx_lane_t;
+
+/* 多路同时发送 - 各路通道不得重叠，共用载波和占空比，阻塞至最长的一路
+ * 结束; 单路时与ir_hal_tx_frame相同，只是可选通道 */
+int ir_hal_tx_lanes(const ir_hal_tx_lane_t *lanes, size_t n,
+                    uint32_t carrier_freq, uint8_t duty_cycle);
+
+/* TX电源管理 - 引用计数: 首个get请求HFXO并恢复PWM，最后一个put挂起PWM
+ * 并释放HFXO。各发送接口内部自带get/put，连续发送的调用者(如发送队列)
+ * 可在整批期间持有一个引用，避免逐帧起停晶振 */
+void ir_hal_tx_power_get(void);
+void ir_hal_tx_power_put(void);
+
+/* TX能耗统计 - 按LED导通时间和上电时间估算 */
+typedef struct {
+  uint32_t frames;     // 已发送帧数
+  uint32_t resumes;    // 上电次数
+  uint64_t powered_us; // 累计上电时长
+  uint64_t airtime_us; // 累计发射时长 (帧内mark + space)
+  uint64_t carrier_us; // 累计LED导通时长 (mark时长 x 占空比)
+  uint32_t energy_uj;  // 累计估算能量
+} ir_hal_tx_power_stats_t;
+
+void ir_hal_tx_get_power_stats(ir_hal_tx_power_stats_t *stats);
+
+/* 全局占空比覆盖 - 0恢复按信号自身的占空比发送，初值IR_HAL_TX_DUTY_OVERRIDE */
+void ir_hal_tx_set_duty_override(uint8_t duty_cycle);
+uint8_t ir_hal_tx_get_duty_override(void);
+
+/* 包络输出 - 打开后mark期间输出恒定高电平而不调制载波，时序仍按各后端
+ * 的方式生成(序列引擎按载波周期取整)，用跳线把TX引脚接到反相的RX通道
+ * 即可环回测量。只用于测试，正常发送须关闭 */
+void ir_hal_tx_set_envelope(bool enable);
+bool ir_hal_tx_get_envelope(void);
+
+/* 接收订阅 - 同一边沿流可有多个订阅者(如协议解码与学习同时进行)，ISR只
+ * 入队一次，消费线程逐个回调。channels为通道位掩码(IR_HAL_RX_CH_ALL以内)，
+ * 通道在有订阅者时采集、最后一个订阅者离开时停止。subscribe返回订阅号，
+ * 槽位用尽返回-ENOMEM。取消和更改可在ISR中调用，当批已取出的脉冲仍可能
+ * 回调一次，订阅者需自行判断是否仍在接收 */
+int ir_hal_rx_subscribe(uint8_t channels, ir_rx_callback_t callback,
+                        void *user_data);
+int ir_hal_rx_set_channels(int id, uint8_t channels);
+int ir_hal_rx_unsubscribe(int id);
+
+/* 回波 - 本机发送期间(及IR_HAL_RX_ECHO_GUARD_US余量内)接收到的是自己的
+ * 信号。默认不送给订阅者: 通道上没有订阅者接收回波时在ISR中直接丢弃，
+ * 否则标记为echo入队，只回调receive为真的订阅者(如环回自测) */
+int ir_hal_rx_set_echo(int id, bool receive);
+
+/* 回波窗口 - 各发送接口在发送前后调用，其间及结束后
+ * IR_HAL_RX_ECHO_GUARD_US内的边沿为回波; 可嵌套。IR_HAL_RX_IPC时由应用核
+ * 转给网络核，begin只发出请求不等应答，网络核开窗之前转发来的边沿由
+ * 应用核按时间戳补标 */
+void ir_hal_rx_echo_begin(void);
+void ir_hal_rx_echo_end(void);
+
+/* 帧间隔 - 静默超过gap_us即结束当前帧，向订阅者发出frame_end通知。由捕获
+ * 后端的硬件比较一次性判定，不随边沿重启内核定时器。0恢复
+ * IR_HAL_FRAME_GAP_US，低于IR_HAL_FRAME_GAP_MIN_US时截断 */
+void ir_hal_rx_set_frame_gap(uint32_t gap_us);
+uint32_t ir_hal_rx_get_frame_gap(void);
+
+/* 反相输入 - channels中的通道以高电平为mark(如环回跳线直接接包络输出的
+ * TX引脚)，其余按解调接收头的低电平为mark。应在通道启动前设置 */
+void ir_hal_rx_set_inverted(uint8_t channels);
+uint8_t ir_hal_rx_get_inverted(void);
+
+/* 接收头补偿 - 该通道的mark时长减mark_us、space时长减space_us后再分发给
+ * 订阅者(至少1us)。TSOP类解调接收头把mark展宽、space缩短数十us，补偿后
+ * 解码和学习看到的是发送端的时长; 由ir_calib测定。帧间隔判定和时间戳
+ * 仍按原始时长 */
+void ir_hal_rx_set_bias(uint8_t channel, int16_t mark_us, int16_t space_us);
+void ir_hal_rx_get_bias(uint8_t channel, int16_t *mark_us, int16_t *space_us);
+
+/* 载波侦听 - 各接收中的通道最近一次有信号至今的静默时长(us)，有通道正处
+ * 于mark时为0; 没有通道在接收时返回UINT32_MAX(无从判断) */
+uint32_t ir_hal_rx_idle_us(void);
+
+/* 载波测量结果 */
+typedef struct {
+  uint32_t frequency; // 载波频率(Hz)
+  uint8_t duty_cycle; // 占空比(%)
+  uint16_t periods;   // 参与测量的载波周期数
+} ir_carrier_t;
+
+/* 载波测量 (CONFIG_IR_HAL_CARRIER或波形后端，否则返回-ENOTSUP)
+ * start后每个mark结束时调用read，取出该mark的测量并为下一个mark清零;
+ * mark_us为解调输入测得的mark时长，用于丢弃跨到下一个mark的读数。波形
+ * 后端逐块处理，read取出的是上次读取以来所有mark的累计，不看mark_us */
+int ir_hal_carrier_start(void);
+int ir_hal_carrier_read(uint32_t mark_us, ir_carrier_t *carrier);
+int ir_hal_carrier_stop(void);
+
+/* 进入System OFF (CONFIG_IR_HAL_RX_WAKE_OFF，否则返回-ENOTSUP) - 停止
+ * 接收，通道0的接收头引脚挂PORT SENSE后关机，不返回。下一个红外帧唤醒
+ * 芯片(即复位)，这一帧在启动早期捕获，通道0首次有订阅者时送达。调用前
+ * 应等发送队列空闲 */
+int ir_hal_rx_poweroff(void);
+
+/* 波形后端统计 (IR_HAL_RX_ADC，否则返回-ENOTSUP) */
+int ir_hal_rx_adc_get_stats(ir_hal_rx_adc_stats_t *stats);
+
+/* 获取RX统计 (用于确定IR_HAL_RX_RING_SIZE) */
+void ir_hal_rx_get_stats(ir_hal_rx_stats_t *stats);
 
 #endif /* IR_HAL_H */
\ No newline at end of file
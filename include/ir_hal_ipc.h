@@ -0,0 +1,121 @@
+/**
+ * @file ir_hal_ipc.h
+ * @brief nRF5340双核接收 - 应用核与网络核接收引擎之间的消息格式
+ *
+ * 网络核(netcore/)运行ir_hal.c的接收部分: 捕获、毛刺滤波、回波窗口、帧
+ * 结束判定和载波测量，订阅全部需要的通道，把脉冲攒成批次经ipc_service
+ * 端点IR_HAL_IPC_ENDPOINT(共享内存环，OpenAMP静态vring)送到应用核。应用
+ * 核的ir_hal_ipc.c实现ir_hal.h的接收接口: 本地订阅表、分发线程、通道与
+ * 回波掩码转发，设置类接口转发并在本地保留一份供get读取，查询类接口
+ * (静默时长、统计、载波测量)同步等待网络核的应答。
+ *
+ * 消息以ir_hal_ipc_hdr_t开头，小端，两核同一编译器ABI:
+ *   网络核 -> 应用核: PULSES(批次)、REPLY(应答)、READY(引擎启动)
+ *   应用核 -> 网络核: 其余，带seq的查询以同一seq的REPLY应答
+ *
+ * 时间戳: 批次头带网络核发出时的运行时间，应用核以收到时的本核运行时间
+ * 之差的最小值(即传输延迟最小的一次)换算，脉冲时间戳与本核运行时间同源。
+ * 两核的RTC由同一个LFCLK驱动，差值不漂移。
+ */
+
+#ifndef IR_HAL_IPC_H
+#define IR_HAL_IPC_H
+
+#include "ir_hal.h"
+#include <stdint.h>
+
+#define IR_HAL_IPC_ENDPOINT "ir_hal"
+
+/* 每批最多的脉冲数 */
+#ifdef CONFIG_IR_HAL_IPC_BATCH
+#define IR_HAL_IPC_BATCH CONFIG_IR_HAL_IPC_BATCH
+#else
+#define IR_HAL_IPC_BATCH 32
+#endif
+
+/* 批次未满时最多攒这么久(us)，帧结束立即发出 */
+#ifdef CONFIG_IR_HAL_IPC_FLUSH_US
+#define IR_HAL_IPC_FLUSH_US CONFIG_IR_HAL_IPC_FLUSH_US
+#else
+#define IR_HAL_IPC_FLUSH_US 1000
+#endif
+
+/* 应用核分发队列(脉冲数) */
+#ifdef CONFIG_IR_HAL_IPC_RX_QUEUE
+#define IR_HAL_IPC_RX_QUEUE CONFIG_IR_HAL_IPC_RX_QUEUE
+#else
+#define IR_HAL_IPC_RX_QUEUE 128
+#endif
+
+/* 查询等待应答的时限(ms) */
+#ifdef CONFIG_IR_HAL_IPC_TIMEOUT_MS
+#define IR_HAL_IPC_TIMEOUT_MS CONFIG_IR_HAL_IPC_TIMEOUT_MS
+#else
+#define IR_HAL_IPC_TIMEOUT_MS 20
+#endif
+
+/* 消息类型 */
+enum {
+  IR_HAL_IPC_PULSES = 0x01, // ir_hal_ipc_batch_t
+  IR_HAL_IPC_REPLY = 0x02,  // ir_hal_ipc_reply_t
+  IR_HAL_IPC_READY = 0x03,  // 引擎已启动(重启后应用核重发接收配置)
+
+  IR_HAL_IPC_CHANNELS = 0x10,  // arg[0]采集通道，arg[1]接收回波的通道
+  IR_HAL_IPC_ECHO_BEGIN = 0x11, // 不应答，开窗之前的边沿由应用核补标
+  IR_HAL_IPC_ECHO_END = 0x12,
+  IR_HAL_IPC_FRAME_GAP = 0x13, // arg[0]帧间隔(us)
+  IR_HAL_IPC_INVERTED = 0x14,  // arg[0]反相通道
+  IR_HAL_IPC_BIAS = 0x15,      // arg[0]通道，arg[1]mark(低16位)|space(高16位)
+  IR_HAL_IPC_IDLE = 0x16,      // 应答ret: 静默时长
+  IR_HAL_IPC_STATS = 0x17,     // 应答data: ir_hal_rx_stats_t
+  IR_HAL_IPC_CARRIER_START = 0x18,
+  IR_HAL_IPC_CARRIER_READ = 0x19, // arg[0]mark时长，应答data: ir_carrier_t
+  IR_HAL_IPC_CARRIER_STOP = 0x1A,
+};
+
+typedef struct {
+  uint8_t op;
+  uint8_t seq;    // 查询序号，应答原样带回; 其余为0
+  uint16_t count; // PULSES: 脉冲数; REPLY: data字节数
+} ir_hal_ipc_hdr_t;
+
+/* 应用核 -> 网络核 */
+typedef struct {
+  ir_hal_ipc_hdr_t hdr;
+  uint32_t arg[2];
+} ir_hal_ipc_req_t;
+
+/* 网络核 -> 应用核的应答 */
+typedef struct {
+  ir_hal_ipc_hdr_t hdr;
+  int32_t ret;
+  uint8_t data[];
+} ir_hal_ipc_reply_t;
+
+/* 脉冲 - ir_pulse_t的紧凑形式，时间戳为网络核运行时间 */
+#define IR_HAL_IPC_MARK BIT(0)
+#define IR_HAL_IPC_FRAME_END BIT(1)
+#define IR_HAL_IPC_ECHO BIT(2)
+
+typedef struct {
+  uint64_t timestamp_us;
+  uint32_t duration_us;
+  uint8_t channel;
+  uint8_t flags;
+  uint16_t reserved;
+} ir_hal_ipc_pulse_t;
+
+typedef struct {
+  ir_hal_ipc_hdr_t hdr;
+  uint32_t dropped;  // 网络核发送失败丢弃的脉冲(累计)
+  uint64_t sent_us;  // 发出时网络核的运行时间
+  ir_hal_ipc_pulse_t pulses[];
+} ir_hal_ipc_batch_t;
+
+#define IR_HAL_IPC_BATCH_SIZE                                                  \
+  (sizeof(ir_hal_ipc_batch_t) + IR_HAL_IPC_BATCH * sizeof(ir_hal_ipc_pulse_t))
+
+/* 应用核: 打开端点并启动分发线程 (由ir_hal_init调用) */
+int ir_hal_ipc_init(void);
+
+#endif /* IR_HAL_IPC_H */
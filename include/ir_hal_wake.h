@@ -0,0 +1,70 @@
+/**
+ * @file ir_hal_wake.h
+ * @brief System OFF红外唤醒 - 启动早期捕获唤醒本机的那一帧
+ *
+ * ir_hal_rx_poweroff()把通道0的接收头引脚设为PORT SENSE(空闲高电平，
+ * mark拉低时DETECT)后进入System OFF(约0.4uA)。红外帧的首个mark唤醒芯片，
+ * 唤醒即复位，内核初始化和ir_hal_init()完成时这一帧早已结束。
+ *
+ * 为此在EARLY初始化级(进入C环境之后、内核初始化之前)按复位原因判断:
+ * System OFF唤醒且RX引脚锁存了SENSE(或仍处于mark)时，立即以GPIOTE边沿
+ * 经PPI触发TIMER1 CAPTURE，与捕获后端相同由硬件锁存时间戳，CPU轮询事件
+ * 取出时长，直到静默超过帧间隔。启动因此推迟一帧的时长(NEC约70ms)。
+ * 捕获结束后TIMER1/GPIOTE/PPI恢复为复位状态，留给ir_hal_init()。
+ *
+ * 首个mark在计时开始前已持续了唤醒和启动的时间，按
+ * IR_HAL_RX_WAKE_LATENCY_US补上(板上实测一次即可，误差在解码容差之内)。
+ * 引导码短于启动时延的协议(RC5)首个mark在计时前已结束，残帧丢弃，改等
+ * 同一按键的下一帧(最长IR_HAL_RX_WAKE_WAIT_MS)。
+ *
+ * 捕获的帧在通道0首次有订阅者时作为一帧入队，带帧结束标记，时间戳为
+ * 启动时刻(运行时间0)，与之后采集的帧一样经订阅者解码。计时用HFINT
+ * (高频晶振尚未启动)，时长误差约1%。
+ */
+
+#ifndef IR_HAL_WAKE_H
+#define IR_HAL_WAKE_H
+
+#include "ir_hal.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* 唤醒帧最多的脉冲数，更长的帧截断 */
+#ifdef CONFIG_IR_HAL_RX_WAKE_PULSES
+#define IR_HAL_RX_WAKE_PULSES CONFIG_IR_HAL_RX_WAKE_PULSES
+#else
+#define IR_HAL_RX_WAKE_PULSES 160
+#endif
+
+/* 复位到开始计时的时延(us)，补到首个mark上 */
+#ifdef CONFIG_IR_HAL_RX_WAKE_LATENCY_US
+#define IR_HAL_RX_WAKE_LATENCY_US CONFIG_IR_HAL_RX_WAKE_LATENCY_US
+#else
+#define IR_HAL_RX_WAKE_LATENCY_US 300
+#endif
+
+/* 首帧已错过时等待下一帧的时限(ms)，重复码/重复帧的周期在此之内 */
+#define IR_HAL_RX_WAKE_WAIT_MS 150
+
+/* 唤醒引脚 - 通道0的接收头 */
+#if DT_NODE_HAS_PROP(IR_RX_NODE, ir_rx_gpios)
+#define IR_HAL_RX_WAKE_PSEL                                                    \
+  NRF_GPIO_PIN_MAP(                                                            \
+      DT_PROP(DT_GPIO_CTLR_BY_IDX(IR_RX_NODE, ir_rx_gpios, 0), port),          \
+      DT_GPIO_PIN_BY_IDX(IR_RX_NODE, ir_rx_gpios, 0))
+#else
+#define IR_HAL_RX_WAKE_PSEL NRF_GPIO_PIN_MAP(1, IR_RX_PIN)
+#endif
+
+/* 唤醒帧 - mark/space交替，首个为mark */
+typedef struct {
+  uint32_t count;
+  uint32_t pulses[IR_HAL_RX_WAKE_PULSES]; // us
+  bool missed;    // 首帧在计时前已结束，捕获的是下一帧
+  bool truncated; // 超过IR_HAL_RX_WAKE_PULSES
+} ir_hal_wake_capture_t;
+
+/* 取走唤醒帧 - 不是红外唤醒或没有捕获到脉冲时返回NULL，只返回一次 */
+const ir_hal_wake_capture_t *ir_hal_wake_take(void);
+
+#endif /* IR_HAL_WAKE_H */
@@ -0,0 +1,46 @@
+/**
+ * @file ir_infer.h
+ * @brief 未知协议推断 - 从录制的原始时序推断协议参数
+ *
+ * 首帧的mark和space分别按直方图聚类，依据类数确定位编码:
+ *   脉冲距离: mark一类、space两类 (NEC式)
+ *   脉冲宽度: mark两类(短约为长的一半)、space一类 (Sony式)
+ *   双相:     全部时长为T和2T两类，无引导码 (RC5式)
+ * 引导码、位数和帧间隔随之确定。推断出的参数交给通用编码器
+ * (irdb_encode_params)重新编码，须与录制逐个时长吻合才算成功。
+ * 首帧之后的帧须是首帧的重复，否则放弃(避免丢失分段帧的后半)。
+ */
+
+#ifndef IR_INFER_H
+#define IR_INFER_H
+
+#include "irdb_protocol.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define IR_INFER_MAX_BITS 48   // 设备码+子设备码+功能码，各16位
+#define IR_INFER_MIN_BITS 8    // 更短的帧不推断
+#define IR_INFER_MAX_FRAMES 8  // 首帧及其重复的最多帧数
+
+/* 推断结果 */
+typedef struct {
+  irdb_protocol_params_t params; // 未注册，protocol_id为0
+  irdb_entry_t code;             // 码字按先发位在高位拆成D/S/F
+  uint8_t bits;                  // 码字位数
+  uint8_t frames;                // 首帧及相同重复帧的总数
+  uint16_t frame_length;         // 首帧时序数
+} ir_infer_result_t;
+
+/* 推断协议 - carrier_freq为0时按38kHz。无法用上述编码描述或重新编码
+ * 与录制不符时返回-ENOENT */
+int ir_infer_protocol(const ir_timing_t *timings, uint16_t count,
+                      uint32_t carrier_freq, ir_infer_result_t *result);
+
+/* 按推断结果重新编码全部帧，帧间space为params.gap减去帧长 */
+int ir_infer_encode(const ir_infer_result_t *result, ir_timing_t *timings_out,
+                    uint32_t *length_out, uint32_t max_length);
+
+/* 位编码名称 */
+const char *ir_infer_coding_name(uint8_t coding);
+
+#endif /* IR_INFER_H */
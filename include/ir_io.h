@@ -0,0 +1,97 @@
+/**
+ * @file ir_io.h
+ * @brief 异步I/O执行器 - 基于Zephyr RTIO提交/完成队列的作业流水线
+ *
+ * flash保存/加载、网络获取这类慢操作作为作业提交给唯一的执行线程
+ * ("ir_io")。作业是一个阶段函数，可用next串成链: 前一阶段失败或被取消
+ * 时后续阶段不执行，以-ECANCELED完成。执行线程每轮取出已提交的作业，
+ * 整批放入RTIO提交队列(链内以RTIO_SQE_CHAINED相连)，一次rtio_submit按
+ * 顺序执行，再从完成队列逐个调用done。尚未开始的作业可以取消。
+ *
+ * 单线程按提交顺序执行，写同一文件的作业无需另加锁，也不会互相穿插。
+ * 边沿捕获仍由中断和硬件锁存完成，解码在服务层自己的工作队列上: 二者
+ * 对时延敏感，不能排在一次flash擦写之后。
+ */
+
+#ifndef IR_IO_H
+#define IR_IO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+
+/* 每轮提交的最多阶段数 (RTIO提交/完成队列深度)，链不能更长 */
+#ifdef CONFIG_IR_IO_BATCH
+#define IR_IO_BATCH CONFIG_IR_IO_BATCH
+#else
+#define IR_IO_BATCH 8
+#endif
+
+typedef struct ir_io_job ir_io_job_t;
+
+/* 阶段函数 - 在执行线程中调用，返回负错误码时链上后续阶段被取消 */
+typedef int (*ir_io_fn_t)(ir_io_job_t *job);
+
+/* 完成回调 - 在执行线程中调用，之后作业可重新提交或释放 */
+typedef void (*ir_io_done_t)(ir_io_job_t *job, int result);
+
+struct ir_io_job {
+  ir_io_fn_t fn;
+  ir_io_done_t done; // 可为NULL
+  void *user_data;
+  ir_io_job_t *next; // 链中的下一阶段，成功后执行
+
+  /* 以下由执行器使用 */
+  sys_snode_t node;
+  ir_io_job_t *prev;
+  uint32_t queued_at; // 提交时刻(周期)
+  int result;
+  atomic_t state;
+};
+
+/* 执行器统计 */
+typedef struct {
+  uint32_t submitted; // 阶段数
+  uint32_t completed;
+  uint32_t failed;    // 阶段函数返回错误
+  uint32_t canceled;  // 取消或前一阶段失败
+  uint32_t batches;   // rtio_submit次数
+  uint32_t max_batch; // 单次提交的最多阶段数
+  uint32_t max_wait_us; // 提交到开始执行的最长等待
+  uint32_t max_run_us;  // 单个阶段的最长执行时间
+  uint32_t pending;     // 当前未完成的阶段
+} ir_io_stats_t;
+
+static inline void ir_io_job_init(ir_io_job_t *job, ir_io_fn_t fn,
+                                  ir_io_done_t done, void *user_data) {
+  *job = (ir_io_job_t){
+      .fn = fn,
+      .done = done,
+      .user_data = user_data,
+  };
+}
+
+/* 启动执行线程 */
+int ir_io_init(void);
+
+/* 提交作业链(job及其next) - 可在中断中调用。链中有阶段尚未完成返回
+ * -EBUSY，链长超过IR_IO_BATCH返回-E2BIG，执行器未启动返回-ENODEV */
+int ir_io_submit(ir_io_job_t *job);
+
+/* 取消尚未开始的阶段(及其后续) - 仍以done回调-ECANCELED。已开始或已
+ * 完成返回-EALREADY */
+int ir_io_cancel(ir_io_job_t *job);
+
+/* 作业已提交、尚未完成 (此时不能重新初始化或提交) */
+bool ir_io_busy(const ir_io_job_t *job);
+
+/* 等待当前已提交的全部作业完成 - 在执行线程(完成回调)中调用直接返回 */
+void ir_io_flush(void);
+
+/* 当前线程是否为执行线程 */
+bool ir_io_in_executor(void);
+
+void ir_io_get_stats(ir_io_stats_t *stats);
+
+#endif /* IR_IO_H */
@@ -0,0 +1,83 @@
+/**
+ * @file ir_keys.h
+ * @brief 按键事件整形 - 把逐帧的解码结果合并为按下/长按/松开事件
+ *
+ * 按住一个键时遥控器每隔约45~110ms发一帧(完整帧或重复码)，逐帧回调时
+ * 下游(BLE通知、日志)每秒收到约9个事件。整形后每次按键只产生:
+ *
+ * - PRESS: 新按键的第一帧解出时立即发出，不增加首次按键的时延;
+ * - HOLD: 按住期间每IR_KEY_HOLD_INTERVAL ms最多一个，frames为按下以来
+ *   的帧数(含被合并的帧);
+ * - RELEASE: 最后一帧之后IR_KEY_RELEASE_MS内没有新帧时发出。
+ *
+ * 码值变化、RC5/RC6的toggle位变化或帧间隔超过IR_KEY_RELEASE_MS为新按键，
+ * 此时先为上一个键发出RELEASE。重复码(不带码值)延续当前按下的键。
+ *
+ * 这里只有状态机，不带定时器: 接收服务在解码工作队列中逐帧调用
+ * ir_keys_frame，并在IR_KEY_RELEASE_MS后调用ir_keys_expire。
+ */
+
+#ifndef IR_KEYS_H
+#define IR_KEYS_H
+
+#include "irdb_protocol.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* 长按事件的最小间隔(ms)，0为每帧一个 */
+#ifdef CONFIG_IR_KEY_HOLD_INTERVAL
+#define IR_KEY_HOLD_INTERVAL CONFIG_IR_KEY_HOLD_INTERVAL
+#else
+#define IR_KEY_HOLD_INTERVAL 250
+#endif
+
+/* 最后一帧之后多久判定松开(ms) */
+#ifdef CONFIG_IR_KEY_RELEASE_MS
+#define IR_KEY_RELEASE_MS CONFIG_IR_KEY_RELEASE_MS
+#else
+#define IR_KEY_RELEASE_MS 160
+#endif
+
+#define IR_KEY_NO_REMOTE 0xFF // 码值不在已加载的遥控器中
+
+typedef enum {
+  IR_KEY_PRESS,
+  IR_KEY_HOLD,
+  IR_KEY_RELEASE,
+} ir_key_action_t;
+
+/* 按键事件 */
+typedef struct {
+  irdb_entry_t code;  // 库中有时为条目副本(含名称偏移)
+  uint8_t channel;    // 接收通道
+  uint8_t remote;     // 所属遥控器槽位，IR_KEY_NO_REMOTE为库中没有
+  uint8_t action;     // ir_key_action_t
+  uint16_t frames;    // 按下以来的帧数
+  uint32_t held_ms;   // 按下以来的时长
+} ir_key_event_t;
+
+/* 一个接收通道的按键状态 */
+typedef struct {
+  ir_key_event_t key; // 当前按下的键
+  bool down;
+  int8_t toggle;
+  uint32_t press_ms;
+  uint32_t last_ms;      // 最后一帧
+  uint32_t reported_ms;  // 最后一个事件
+  uint32_t coalesced;    // 被合并而未发出事件的帧
+} ir_keys_state_t;
+
+void ir_keys_init(ir_keys_state_t *st, uint8_t channel);
+
+/* 一帧解出 - code为NULL表示重复码。out至少2个(上一个键的RELEASE和本键
+ * 的PRESS)，返回写入的事件数 */
+int ir_keys_frame(ir_keys_state_t *st, const irdb_entry_t *code,
+                  uint8_t remote, int toggle, uint32_t now_ms,
+                  ir_key_event_t *out);
+
+/* 松开检查 - 已超过IR_KEY_RELEASE_MS时写入RELEASE并返回1，返回0时
+ * *due_ms为还需等待的毫秒数(没有按下的键时为0) */
+int ir_keys_expire(ir_keys_state_t *st, uint32_t now_ms, ir_key_event_t *out,
+                   uint32_t *due_ms);
+
+#endif /* IR_KEYS_H */
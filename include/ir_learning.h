@@ -6,32 +6,55 @@
 #ifndef IR_LEARNING_H
 #define IR_LEARNING_H
 
+#include "ir_analytics.h"
+#include "ir_timing.h"
+#include "irdb_protocol.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
-/* 学习的信号最大长度 */
-#define IR_LEARNING_MAX_EDGES 512
+/* 学习的信号最大长度 - 加载、比较、指纹比对按此分配缓冲 */
+#ifdef CONFIG_IR_LEARNING_MAX_EDGES
+#define IR_LEARNING_MAX_EDGES CONFIG_IR_LEARNING_MAX_EDGES
+#else
+#define IR_LEARNING_MAX_EDGES 1024
+#endif
+
+/* 录制块池的块数 (每块64个时序)，只在学习期间从堆上分配 */
+#ifdef CONFIG_IR_LEARNING_CAPTURE_BLOCKS
+#define IR_LEARNING_CAPTURE_BLOCKS CONFIG_IR_LEARNING_CAPTURE_BLOCKS
+#else
+#define IR_LEARNING_CAPTURE_BLOCKS 32
+#endif
+#define IR_LEARNING_MAX_PRESSES 5 // 多次学习的按键次数上限
 #define IR_LEARNING_MAX_DURATION_US 100000
+#define IR_LEARNING_REPEAT_GAP_US 108000 // 未测得帧周期时非协议信号重放的周期
 
 /* 学习信号结构 */
 typedef struct {
   char name[32];              // 信号名称
-  uint32_t *timings;          // 时序数据数组 (微秒)
+  ir_timing_t *timings;       // 时序数据数组 (紧凑格式，见ir_timing.h)
   uint16_t timing_count;      // 时序数量
-  uint32_t carrier_freq;      // 检测到的载波频率
+  uint32_t carrier_freq;      // 载波频率，0为未测得 (按38kHz发送)
+  uint8_t duty_cycle;         // 测得的载波占空比(%)，只在学习结果中有效
   uint32_t total_duration_us; // 总时长
+  uint32_t repeat_period_us;  // 录制中测得的帧周期(帧起点到下一帧起点)，0为未测得
   bool valid;                 // 是否有效
+  bool parametric;            // 已识别为已知协议，code有效
+  irdb_entry_t code;          // 识别出的协议码 (parametric时)
 } ir_learned_signal_t;
 
-/* 学习回调 - 学习过程中的状态通知 */
+/* 学习回调 - 学习过程中的状态通知。等待在启动学习的线程中、接收中在
+ * RX线程(HAL接收回调)中、下一次按键在定时器中断中调用，完成、超时和
+ * 出错在系统工作队列中调用 */
 typedef enum {
   IR_LEARN_IDLE,      // 空闲
   IR_LEARN_WAITING,   // 等待信号
   IR_LEARN_RECEIVING, // 接收中
   IR_LEARN_COMPLETED, // 完成
   IR_LEARN_TIMEOUT,   // 超时
-  IR_LEARN_ERROR      // 错误
+  IR_LEARN_ERROR,     // 错误
+  IR_LEARN_NEXT_PRESS // 多次学习: 本次按键已录制，等待下一次
 } ir_learn_status_t;
 
 typedef void (*ir_learn_callback_t)(ir_learn_status_t status,
@@ -45,44 +68,123 @@ int ir_learning_init(void);
 int ir_learning_start(const char *signal_name, ir_learn_callback_t callback,
                       void *user_data, uint32_t timeout_ms);
 
+/* 多次学习 - 录制presses次按键(不超过IR_LEARNING_MAX_PRESSES)，每次按帧
+ * 间隔分帧并丢弃重复码和重复帧，最后对彼此吻合的按键逐个时长取中值。
+ * 每次按键重新计时timeout_ms，超时时已录到按键则以已有的完成 */
+int ir_learning_start_multi(const char *signal_name, uint8_t presses,
+                            ir_learn_callback_t callback, void *user_data,
+                            uint32_t timeout_ms);
+
 /* 停止学习 */
 int ir_learning_stop(void);
 
-/* 重放学习的信号 */
+/* 学习统计 - 启动以来的累计值 */
+typedef struct {
+  uint32_t completed;  // 录制完成 (含多次学习超时时以已录按键完成)
+  uint32_t recognized; // 其中识别为已知协议
+  uint32_t timeouts;   // 超时未收到信号
+  uint32_t errors;     // 结果缓冲分配失败
+} ir_learning_stats_t;
+
+void ir_learning_get_stats(ir_learning_stats_t *stats);
+
+/* 录制中(或最近一次学习)的实时分析 - 边沿到达时已逐个累计，这里只取
+ * 结果，不含推断。从未开始学习时返回-ENODATA */
+int ir_learning_live_analysis(ir_signal_analysis_t *analysis);
+
+/* 重放学习的信号 - 已识别协议的信号重新编码发送，其余原样回放，各次
+ * 按ir_learning_replay_period_us的周期从起点排定 */
 int ir_learning_replay(const ir_learned_signal_t *signal,
                        uint32_t repeat_count);
 
-/* 保存学习的信号到存储 */
+/* 非协议信号整段重放的周期 - 本次起点到下一次起点。录制中测得帧周期
+ * 时(学习时记录，或从时序中的第一个帧间隔得出)，段尾留出与录制相同的
+ * 帧间空闲; 否则按IR_LEARNING_REPEAT_GAP_US，且至少留一个帧间隔 */
+uint32_t ir_learning_replay_period_us(const ir_learned_signal_t *signal);
+
+/* 保存学习的信号到存储 - 已识别协议的信号只保存协议码，能推断出协议
+ * 参数的只保存参数和码字 (ir_infer.h) */
 int ir_learning_save(const ir_learned_signal_t *signal, const char *name);
 
-/* 从存储加载信号 */
+/* 异步保存完成回调 - 在存储工作队列线程中调用 */
+typedef void (*ir_learning_save_cb_t)(const char *name, int result,
+                                      void *user_data);
+
+/* 异步保存 - 信号和时序拷贝进队列后立即返回，最低优先级的存储工作队列
+ * 中按提交顺序调用ir_learning_save，flash擦写不阻塞调用者(可在中断中
+ * 调用)。加载、删除和列出前会等队列写完。队列满返回-EBUSY，时序缓冲池
+ * 空返回-ENOMEM；cb可为NULL */
+int ir_learning_save_async(const ir_learned_signal_t *signal,
+                           const char *name, ir_learning_save_cb_t cb,
+                           void *user_data);
+
+/* 等待已提交的异步保存全部写完 */
+void ir_learning_save_flush(void);
+
+/* 从存储加载信号 - 热集中的信号从RAM拷贝，不读flash */
 int ir_learning_load(ir_learned_signal_t *signal, const char *name);
 
+/* 按名称重放 - 热集命中时直接从RAM发送；未命中时从flash载入热集 */
+int ir_learning_replay_name(const char *name, uint32_t repeat_count);
+
+/* 把信号预先载入热集，预算放不下返回-ENOSPC */
+int ir_learning_hot_preload(const char *name);
+
+/* 热集统计 - 命中、未命中和淘汰为启动以来的累计值 */
+typedef struct {
+  uint32_t hits;      // 加载/重放命中
+  uint32_t misses;    // 未命中，读flash
+  uint32_t evictions; // 按预算淘汰
+  uint32_t signals;   // 当前热集中的信号
+  uint32_t pinned;    // 其中使用次数达到钉住门限的
+  uint32_t bytes;     // 占用数据库堆的字节数
+} ir_learning_hot_stats_t;
+
+void ir_learning_hot_get_stats(ir_learning_hot_stats_t *stats);
+
 /* 删除已保存的信号 */
 int ir_learning_delete(const char *name);
 
-/* 列出所有已保存的信号 */
+/* 列出所有已保存的信号 - 放不下时截断；信号多时用下面的游标逐个取 */
 int ir_learning_list(char *buf, size_t buf_size);
 
+/* 信号名称游标 - 每次取一个名称，调用之间不持有任何锁。遍历中保存或
+ * 删除信号时可能漏掉或重复个别名称 */
+typedef struct {
+  uint16_t index; // 信号库索引下标，可在init后设为起始位置
+  bool started;
+} ir_learning_iter_t;
+
+void ir_learning_iter_init(ir_learning_iter_t *it);
+
+/* 取下一个名称，返回0；遍历完返回-ENOENT */
+int ir_learning_iter_next(ir_learning_iter_t *it, char *name, size_t size);
+
+/* 按指纹查找与收到的帧一致的已保存信号，name返回其名称。指纹在保存时
+ * 更新，首次查找时扫描信号库建立；未找到返回-ENOENT。候选信号加载到
+ * 查找期间借用的一块时序缓冲，池空时返回-ENOMEM */
+int ir_learning_match(const ir_timing_t *timings, uint16_t count, char *name,
+                      size_t size);
+
 /* 导出为原始格式 (用于调试) */
 int ir_learning_export_raw(const ir_learned_signal_t *signal, char *buf,
                            size_t buf_size);
 
-/* 从原始格式导入 */
+/* 导出为Pronto hex学习码，返回写入的字符数 */
+int ir_learning_export_pronto(const ir_learned_signal_t *signal, char *buf,
+                              size_t buf_size);
+
+/* 从原始格式导入 - 支持导出格式、IrScrutinizer raw和Pronto hex，
+ * 可识别的协议同学习一样记为协议码。timings为NULL时分配缓冲区 */
 int ir_learning_import_raw(ir_learned_signal_t *signal, const char *raw_data);
 
-void test_ir_learning(void);
+/* 批量导入并保存 (工厂预置) - bundle为多段导出格式，每段以
+ * "# IR Signal: <名称>"开头。返回成功保存的数量，failed返回失败数 */
+int ir_learning_import_bundle(const char *bundle, uint16_t *failed);
 
-/* 分析信号特征 */
-typedef struct {
-  uint32_t avg_mark;       // 平均mark时长
-  uint32_t avg_space;      // 平均space时长
-  uint32_t min_pulse;      // 最短脉冲
-  uint32_t max_pulse;      // 最长脉冲
-  uint32_t pulse_count;    // 脉冲数量
-  uint32_t estimated_freq; // 估计的载波频率
-} ir_signal_analysis_t;
+void test_ir_learning(void);
 
+/* 分析信号特征 (ir_analytics单遍累计) - 未识别协议的信号再推断协议参数 */
 int ir_learning_analyze(const ir_learned_signal_t *signal,
                         ir_signal_analysis_t *analysis);
 
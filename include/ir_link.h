@@ -0,0 +1,155 @@
+/**
+ * @file ir_link.h
+ * @brief 二进制命令链路 - 集线器经USB CDC-ACM或BLE GATT高频下发命令
+ *
+ * 帧格式 (小端，请求与响应相同):
+ *   0xA5 | 负载长度 u16 | 命令 u8 | 序号 u8 | 负载 | CRC16 u16
+ * CRC为CRC-16/CCITT-FALSE(多项式0x1021，初值0xFFFF)，覆盖长度到负载末尾。
+ * 字节流中按同步字节和CRC定帧，BLE的一次写入可以是半帧或多帧。
+ *
+ * 响应的命令为请求命令|IR_LINK_RESPONSE，序号与请求相同，负载以状态
+ * (int16，0或负errno)开头。CRC错误的帧丢弃且不响应，集线器按序号超时重发。
+ *
+ * 命令与负载:
+ *   PING        任意字节              -> 原样返回
+ *   SEND_ENTRY  P D S F(u16) 次数 通道 -> 入队发送，通道0为默认通道
+ *   SEND_ID     编号(i32) 次数 通道    -> 按FIND_ID得到的功能编号发送
+ *   SEND_NAME   次数 通道 功能名       -> 功能名可带"编号:"前缀，无结束符
+ *   SEND_BATCH  n个SEND_ENTRY负载      -> 依次入队，返回入队数(u8)，遇错停止
+ *   FIND_ID     功能名                 -> 功能编号(i32)
+ *   LIST        起始编号(u32)          -> 下一编号 条目数(各u32) 记录...
+ *                                         记录为P D S F(u16) 名称长度(u8)
+ *                                         名称，一页尽量填满一帧；下一编号
+ *                                         等于条目数时列完
+ *   LIST_LEARNED 起始下标(u16)         -> 下一下标(u16) 名称...(长度u8+名称)
+ *                                         没有名称时列完
+ *   FIND        跳过数(u16) 前缀       -> 下一跳过数(u16) 记录...(长度u8+
+ *                                         "编号:名称")，活动集所有遥控器
+ *                                         按名称排序，没有记录时查完
+ *   DB_BEGIN    遥控器编号             -> 开始上传CSV数据库
+ *   DB_CHUNK    CSV文本                -> 分块解析，块边界可在行中间
+ *   DB_STORE    存储名称               -> 开始上传，结束时编译为镜像存入flash
+ *   DB_END      无                     -> 建立索引并加入活动集，返回条目数(u32)
+ *                                         DB_STORE会话则保存镜像，返回条目数
+ *                                         CSV字节数 耗时ms(各u32)
+ *   STATS       无                     -> IR_LINK_STAT_COUNT个u32计数
+ *   SEND_AT     时刻(u64 us) SEND_ENTRY负载 -> 在同步时基的该时刻开始发送
+ *   TIME        无 或 同步时间(u64 us) -> 带时间时设置同步时基，返回设置后
+ *                                         的当前同步时间(u64)
+ * 发送类命令只入队，不等待发射完成，队列满时状态为-ENOBUFS。
+ *
+ * 命令由专用线程逐帧处理，后端只在中断/协议栈回调里把收到的字节放入
+ * 各自的接收缓冲。
+ */
+
+#ifndef IR_LINK_H
+#define IR_LINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define IR_LINK_SYNC 0xA5
+#define IR_LINK_HEADER_SIZE 5 // 同步 长度 命令 序号
+#define IR_LINK_CRC_SIZE 2
+#define IR_LINK_RESPONSE 0x80 // 响应命令标志
+
+/* 单帧最大负载 - 决定DB_CHUNK块大小和批量发送条数 */
+#ifdef CONFIG_IR_LINK_PAYLOAD_MAX
+#define IR_LINK_PAYLOAD_MAX CONFIG_IR_LINK_PAYLOAD_MAX
+#else
+#define IR_LINK_PAYLOAD_MAX 256
+#endif
+
+/* 每个后端的接收缓冲 (字节) */
+#ifdef CONFIG_IR_LINK_RX_BUFFER
+#define IR_LINK_RX_BUFFER CONFIG_IR_LINK_RX_BUFFER
+#else
+#define IR_LINK_RX_BUFFER 1024
+#endif
+
+#define IR_LINK_THREAD_STACK_SIZE 2048 // 命令线程栈
+#define IR_LINK_THREAD_PRIORITY 6      // 低于解码和发送线程
+
+#define IR_LINK_FRAME_MAX                                                      \
+  (IR_LINK_HEADER_SIZE + IR_LINK_PAYLOAD_MAX + IR_LINK_CRC_SIZE)
+
+/* 命令 */
+typedef enum {
+  IR_LINK_CMD_PING = 0x01,
+  IR_LINK_CMD_SEND_ENTRY = 0x10,
+  IR_LINK_CMD_SEND_ID = 0x11,
+  IR_LINK_CMD_SEND_NAME = 0x12,
+  IR_LINK_CMD_SEND_BATCH = 0x13,
+  IR_LINK_CMD_FIND_ID = 0x14,
+  IR_LINK_CMD_LIST = 0x15,
+  IR_LINK_CMD_LIST_LEARNED = 0x16,
+  IR_LINK_CMD_SEND_AT = 0x17,
+  IR_LINK_CMD_FIND = 0x18,
+  IR_LINK_CMD_DB_BEGIN = 0x20,
+  IR_LINK_CMD_DB_CHUNK = 0x21,
+  IR_LINK_CMD_DB_END = 0x22,
+  IR_LINK_CMD_DB_STORE = 0x23,
+  IR_LINK_CMD_STATS = 0x30,
+  IR_LINK_CMD_TIME = 0x31,
+} ir_link_cmd_t;
+
+#define IR_LINK_SEND_ENTRY_SIZE 10 // SEND_ENTRY负载，也是批量中每条的长度
+
+/* STATS响应中计数的顺序 - 只在末尾追加，集线器按长度兼容旧固件 */
+typedef enum {
+  IR_LINK_STAT_RX_EDGES,
+  IR_LINK_STAT_RX_FRAMES,
+  IR_LINK_STAT_RX_OVERFLOWS,
+  IR_LINK_STAT_DECODED,     // 各协议解码数之和
+  IR_LINK_STAT_REPEATS,
+  IR_LINK_STAT_DECODE_FAILED,
+  IR_LINK_STAT_DECODE_DROPPED,
+  IR_LINK_STAT_TX_FRAMES,
+  IR_LINK_STAT_TX_AIRTIME_MS,
+  IR_LINK_STAT_TXQ_DEPTH,
+  IR_LINK_STAT_TXQ_SUBMITTED,
+  IR_LINK_STAT_TXQ_DROPPED,
+  IR_LINK_STAT_TXQ_MAX_LATENCY_US,
+  IR_LINK_STAT_LEARN_COMPLETED,
+  IR_LINK_STAT_LINK_COMMANDS,
+  IR_LINK_STAT_LINK_CRC_ERRORS,
+  IR_LINK_STAT_LINK_OVERRUNS,
+  IR_LINK_STAT_COUNT,
+} ir_link_stat_t;
+
+/* 后端 */
+typedef enum {
+  IR_LINK_PORT_USB,
+  IR_LINK_PORT_BLE,
+  IR_LINK_PORT_COUNT,
+} ir_link_port_t;
+
+/* 链路计数 */
+typedef struct {
+  uint32_t commands;   // 已处理的命令帧
+  uint32_t errors;     // 状态非0的响应
+  uint32_t crc_errors; // CRC错误或长度超限丢弃的帧
+  uint32_t overruns;   // 接收缓冲满丢弃的字节
+  uint32_t tx_errors;  // 响应发送失败
+} ir_link_stats_t;
+
+/* 初始化 - 启动命令线程和已配置的后端 */
+int ir_link_init(void);
+
+/* 链路计数 (各后端之和) */
+void ir_link_get_stats(ir_link_stats_t *stats);
+
+/* 后端接口 */
+
+/* 收到字节 - 可在中断中调用 */
+void ir_link_receive(ir_link_port_t port, const uint8_t *data, size_t len);
+
+/* 发送一个完整响应帧 (命令线程调用) */
+int ir_link_usb_send(const uint8_t *frame, size_t len);
+int ir_link_ble_send(const uint8_t *frame, size_t len);
+
+/* 后端初始化 */
+int ir_link_usb_init(void);
+int ir_link_ble_init(void);
+
+#endif /* IR_LINK_H */
@@ -0,0 +1,73 @@
+/**
+ * @file ir_loopback.h
+ * @brief TX时序环回自测 - 同板发送并以硬件时间戳接收，逐沿对比编码时序
+ *
+ * 跳线把TX引脚(IR_TX_PIN)接到ir-rx-gpios中的一路，测试期间TX输出包络
+ * (ir_hal_tx_set_envelope)、该路RX反相(ir_hal_rx_set_inverted)，测得的
+ * 就是发送引擎本身的误差，不含接收头的展宽。作为TX引擎改动的回归基准。
+ *
+ * 同一跳线也用于接收端的压力测试: 发送引擎以IR_LOOPBACK_STRESS_CLOCK_HZ
+ * 为节拍输出随机时长的长串沿，对比收到的脉冲数和时长，逐级缩短时长
+ * 找出当前RX后端(GPIO中断、PPI捕获、SAADC)开始丢沿的沿速率。短于毛刺
+ * 滤波门限(CONFIG_IR_HAL_RX_MIN_MARK_US/SPACE_US)的时长会被滤除，测
+ * 更高的速率时把门限设为0。
+ */
+
+#ifndef IR_LOOPBACK_H
+#define IR_LOOPBACK_H
+
+#include <stdint.h>
+
+#define IR_LOOPBACK_MAX_EDGES 256        // 单帧最大沿数
+#define IR_LOOPBACK_HIST_BINS 16         // 误差直方图格数
+#define IR_LOOPBACK_HIST_STEP_US 4       // 格宽，第i格为[(i-8)*4, (i-7)*4)
+#define IR_LOOPBACK_FRAME_TIMEOUT_MS 200 // 发送结束后等待帧结束的上限
+#define IR_LOOPBACK_STRESS_CLOCK_HZ 100000 // 压力测试的时长节拍(10us)
+#define IR_LOOPBACK_STRESS_MIN_GAP_US 5000 // 压力测试的帧间隔下限
+
+/* 单个协议的测量结果 - 误差为测得时长减编码时长 */
+typedef struct {
+  uint16_t protocol;
+  uint32_t frames;        // 发送帧数
+  uint32_t lost;          // 未收到或沿数不符的帧
+  uint32_t edges;         // 参与统计的沿数
+  int32_t mark_bias_us;   // mark的平均误差
+  int32_t space_bias_us;  // space的平均误差
+  uint32_t jitter_us;     // 去掉平均误差后的均方根抖动
+  uint32_t max_jitter_us; // 去掉平均误差后的最大偏差
+  uint32_t max_error_us;  // 最大绝对误差
+  uint32_t latency_us;    // 调用发送到首个沿的平均延迟
+  uint32_t max_latency_us;
+  uint32_t elapsed_us;     // 全部帧的总耗时
+  uint32_t frames_per_sec; // 每秒帧数(含帧间隔和帧结束判定)
+  uint32_t hist[IR_LOOPBACK_HIST_BINS]; // 逐沿误差直方图，两端含越界
+} ir_loopback_result_t;
+
+/* 环回测量一个协议 - rx_channel为接跳线的接收通道，frames帧的功能码
+ * 逐帧变化。测试期间持有TX电源引用(不计晶振起振)，发送队列应空闲。
+ * 协议无法编码返回-ENOTSUP，一帧都没收到返回-ETIMEDOUT */
+int ir_loopback_run(uint16_t protocol, uint8_t rx_channel, uint32_t frames,
+                    ir_loopback_result_t *result);
+
+/* 压力测试一级的结果 - 每串IR_LOOPBACK_MAX_EDGES-1个脉冲 */
+typedef struct {
+  uint32_t min_us;       // 取整到节拍后的时长范围
+  uint32_t max_us;
+  uint32_t edge_rate;    // 串内的平均沿速率(每秒)
+  uint32_t bursts;       // 发送的串数
+  uint32_t lost_bursts;  // 脉冲数不符(丢沿、多沿或超时)的串
+  uint32_t sent;         // 发送的脉冲数
+  uint32_t captured;     // 收到的脉冲数
+  uint32_t compared;     // 脉冲数相符、逐个对比了时长的脉冲数
+  uint32_t mean_error_us; // 对比的时长的平均绝对误差
+  uint32_t max_error_us;
+  uint32_t overflows;    // 期间环形缓冲区溢出
+  uint32_t glitches;     // 期间毛刺滤波丢弃的段
+} ir_loopback_stress_t;
+
+/* 压力测试一级 - 发送bursts串随机时长在[min_us, max_us]内的脉冲，经跳线
+ * 从rx_channel收回对比。前提与ir_loopback_run相同 */
+int ir_loopback_stress(uint8_t rx_channel, uint32_t min_us, uint32_t max_us,
+                       uint32_t bursts, ir_loopback_stress_t *result);
+
+#endif /* IR_LOOPBACK_H */
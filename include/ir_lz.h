@@ -0,0 +1,78 @@
+/**
+ * @file ir_lz.h
+ * @brief LZ压缩 - 存储的数据库镜像和学习信号正文的流式压缩与解压
+ *
+ * 字节对齐的LZSS，256字节窗口:
+ *   控制字节(低位在前，每位对应其后一个记号) + 8个记号
+ *   位为0: 字面量1字节
+ *   位为1: 匹配2字节 - 距离-1 (1~256)，长度-IR_LZ_MIN_MATCH (3~258)
+ * 解码器只需窗口加几个字节的状态，输入和输出都可以任意分块，镜像和
+ * 信号正文直接解压到最终的缓冲中，不需要整块的压缩数据副本。
+ * 流本身不含长度，由外层(镜像的irdb_image_lz_header_t、信号库记录长度)
+ * 给出。scripts/irdb_lz.py为构建时的同格式实现。
+ */
+
+#ifndef IR_LZ_H
+#define IR_LZ_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define IR_LZ_WINDOW 256
+#define IR_LZ_MIN_MATCH 3
+#define IR_LZ_MAX_MATCH (IR_LZ_MIN_MATCH + 255)
+
+/* 压缩输出 - 返回0或负错误码 */
+typedef int (*ir_lz_sink_t)(void *ctx, const void *data, size_t len);
+
+/* 解压输入 - 返回读出的字节数，0为结束，负数为错误 */
+typedef ssize_t (*ir_lz_source_t)(void *ctx, void *buf, size_t len);
+
+/* 压缩器 - 窗口加一个最长匹配的待编码区，约0.5KB */
+typedef struct {
+  uint8_t buf[IR_LZ_WINDOW + IR_LZ_MAX_MATCH];
+  uint16_t hist;          // buf中已编码的历史字节
+  uint16_t look;          // 历史之后待编码的字节
+  uint8_t group[1 + 2 * 8]; // 控制字节 + 8个记号
+  uint8_t group_len;
+  uint8_t group_tokens;
+  ir_lz_sink_t sink;
+  void *ctx;
+  uint32_t in_bytes;  // 已输入
+  uint32_t out_bytes; // 已输出
+} ir_lz_encoder_t;
+
+/* 解压器 */
+typedef struct {
+  uint8_t window[IR_LZ_WINDOW];
+  uint8_t pos;        // 下一个输出字节在窗口中的位置
+  uint8_t state;
+  uint8_t flags;      // 控制字节的剩余位
+  uint8_t flag_count; // 剩余位数
+  uint8_t dist;       // 匹配距离-1
+  uint16_t copy_left; // 匹配尚未输出的字节
+} ir_lz_decoder_t;
+
+void ir_lz_encoder_init(ir_lz_encoder_t *enc, ir_lz_sink_t sink, void *ctx);
+
+/* 压缩len字节，输出经sink写出 */
+int ir_lz_encode(ir_lz_encoder_t *enc, const void *data, size_t len);
+
+/* 编码剩余字节并写出最后一组 */
+int ir_lz_encode_finish(ir_lz_encoder_t *enc);
+
+void ir_lz_decoder_init(ir_lz_decoder_t *dec);
+
+/* 从in解压到out，两者都可以任意长度。*in_used返回消耗的输入字节，
+ * 返回写入out的字节数；输入用完或out写满时返回 */
+size_t ir_lz_decode(ir_lz_decoder_t *dec, const void *in, size_t in_len,
+                    size_t *in_used, void *out, size_t out_len);
+
+/* 从source分块读入并解压，直到out写满。dec须已初始化；
+ * 输入提前结束返回-EIO */
+int ir_lz_decode_all(ir_lz_decoder_t *dec, ir_lz_source_t source, void *ctx,
+                     void *out, size_t out_len);
+
+#endif /* IR_LZ_H */
@@ -0,0 +1,60 @@
+/**
+ * @file ir_macro.h
+ * @brief IR宏/场景 - 多步命令预编译为一个发送序列
+ *
+ * "开电视、等2秒、切HDMI2、开功放、音量到30"这样的场景编译一次即得到
+ * 各步的完整时序和精确延时，执行时整个序列交给TX线程，步间没有查找、
+ * 编码和入队开销。编译结果持有自己的时序，数据库切换后仍可执行。
+ */
+
+#ifndef IR_MACRO_H
+#define IR_MACRO_H
+
+#include "ir_tx_queue.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define IR_MACRO_MAX_STEPS 16 // 单个宏的最大步数
+
+/* 步骤来源 */
+typedef enum {
+  IR_MACRO_FUNCTION, // 功能名，可带"编号:"前缀指定活动集中的遥控器
+  IR_MACRO_SIGNAL,   // 已保存的学习信号名
+} ir_macro_source_t;
+
+/* 宏步骤描述 - name只在编译期间使用 */
+typedef struct {
+  ir_macro_source_t source;
+  const char *name;
+  uint32_t repeat;   // 发送次数，0按1
+  uint32_t delay_ms; // 本步结束到下一步开始的延时
+  uint8_t channels;  // 发射通道位掩码，0为IR_HAL_TX_CH_DEFAULT
+} ir_macro_step_t;
+
+/* 编译后的宏 */
+typedef struct {
+  ir_tx_step_t steps[IR_MACRO_MAX_STEPS]; // 时序为本宏所有
+  uint32_t step_count;
+  ir_tx_sequence_t seq;
+} ir_macro_t;
+
+/* 编译 - 查找功能/加载学习信号并编码，失败时已编译的部分被释放。
+ * macro需为未编译或已释放的状态 */
+int ir_macro_compile(ir_macro_t *macro, const ir_macro_step_t *steps,
+                     size_t count);
+
+/* 执行 - 入队立即返回，完成或取消后在TX线程中调用callback(可为NULL)，
+ * 报告见macro->seq.report */
+int ir_macro_run(ir_macro_t *macro, ir_tx_sequence_done_t callback,
+                 void *user_data);
+
+/* 取消执行 */
+int ir_macro_cancel(ir_macro_t *macro);
+
+/* 释放编译结果，执行中返回-EBUSY */
+int ir_macro_free(ir_macro_t *macro);
+
+/* 计划时长(us) - 各步发送时长与延时之和 */
+uint32_t ir_macro_duration_us(const ir_macro_t *macro);
+
+#endif /* IR_MACRO_H */
@@ -0,0 +1,52 @@
+/**
+ * @file ir_mem.h
+ * @brief IR专用内存 - 数据库堆和时序缓冲池，不与BLE/shell争用系统堆
+ *
+ * 数据库堆(k_heap，CONFIG_IRDB_HEAP_SIZE): CSV解析的条目数组和名称池、
+ * 读入RAM的镜像、加载器缓存条目。大小由数据库决定，用独立的堆使其他
+ * 子系统的分配不会把它切碎，加载失败只取决于数据库自身的占用。
+ * 时序缓冲池(k_mem_slab，CONFIG_IR_TIMING_BUFFERS块): 学习信号、加载、
+ * 导入和编码草稿的单帧时序，每块IR_TIMING_BUF_TIMINGS个时序，分配和
+ * 释放都是O(1)。校准和回环测试只在shell下运行，仍用系统堆。
+ */
+
+#ifndef IR_MEM_H
+#define IR_MEM_H
+
+#include "ir_learning.h"
+#include "ir_timing.h"
+#include "ir_tx_queue.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* 每块时序缓冲的容量 - 最长的学习信号或协议帧 */
+#define IR_TIMING_BUF_TIMINGS MAX(IR_LEARNING_MAX_EDGES, IR_TX_FRAME_MAX_TIMINGS)
+
+/* 内存统计 */
+typedef struct {
+  uint32_t heap_size;     // 数据库堆容量(字节)
+  uint32_t heap_used;     // 当前已分配
+  uint32_t heap_max_used; // 高水位
+  uint32_t heap_failures; // 分配失败次数
+  uint32_t bufs_total;    // 时序缓冲块数
+  uint32_t bufs_used;     // 当前占用
+  uint32_t bufs_max_used; // 高水位
+  uint32_t bufs_failures; // 池空次数
+} ir_mem_stats_t;
+
+/* 数据库堆 - 语义同malloc/calloc/realloc/free */
+void *irdb_heap_alloc(size_t size);
+void *irdb_heap_calloc(size_t nmemb, size_t size);
+void *irdb_heap_realloc(void *ptr, size_t size);
+void irdb_heap_free(void *ptr);
+
+/* 取一块时序缓冲(IR_TIMING_BUF_TIMINGS个)，池空返回NULL，不等待 */
+ir_timing_t *ir_timing_buf_alloc(void);
+
+/* 归还时序缓冲，NULL忽略 */
+void ir_timing_buf_free(ir_timing_t *buf);
+
+/* 获取统计 */
+void ir_mem_get_stats(ir_mem_stats_t *stats);
+
+#endif /* IR_MEM_H */
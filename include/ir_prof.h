@@ -0,0 +1,64 @@
+/**
+ * @file ir_prof.h
+ * @brief 采样剖析 - 定时中断采样被打断处的PC，计入RAM直方图
+ *
+ * RTC2比较中断按固定频率触发，入口从硬件压栈的异常帧取出被打断处的
+ * PC，按PC计数存入开放寻址哈希表(每个不同的PC一个槽)。热点循环只占
+ * 少数几个槽，几千次采样也只用几百个槽。采样中断取内核中断的最高
+ * 优先级0，采得到线程和其他内核中断(解码、发送引擎、链路)，采不到
+ * 零延迟中断(零延迟发送、BLE控制器)，它们占用的时间不计入。
+ *
+ * 不用DWT PC采样经ITM/SWO输出: 那需要调试器接在SWO引脚上，量产板上
+ * 没有; 与ir_bench相同只用片上资源。"ir prof dump"以"#IRPROF:"开头的
+ * 行输出直方图，scripts/ir_prof.py按zephyr.elf的符号表归到函数。
+ */
+
+#ifndef IR_PROF_H
+#define IR_PROF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* 直方图槽数 - 每槽8字节，满时新PC的采样计入dropped */
+#ifdef CONFIG_IR_PROF_SLOTS
+#define IR_PROF_SLOTS CONFIG_IR_PROF_SLOTS
+#else
+#define IR_PROF_SLOTS 512
+#endif
+
+#define IR_PROF_RTC_HZ 32768    // RTC计数频率，采样周期按它取整
+#define IR_PROF_HZ_DEFAULT 1000 // 默认采样频率
+#define IR_PROF_HZ_MAX 8192     // 比较值至少领先计数器2个节拍
+#define IR_PROF_PREFIX "#IRPROF:"
+
+typedef struct {
+  uint32_t pc;
+  uint32_t count;
+} ir_prof_slot_t;
+
+typedef struct {
+  bool running;
+  uint32_t hz;       // 实际采样频率
+  uint32_t samples;  // 计入直方图的采样
+  uint32_t dropped;  // 槽满丢弃的采样
+  uint32_t distinct; // 不同PC数(已用槽数)
+} ir_prof_stats_t;
+
+/* 清空直方图并开始采样 - hz为0用默认频率，超出范围返回-EINVAL，
+ * 已在采样返回-EALREADY */
+int ir_prof_start(uint32_t hz);
+
+/* 停止采样，直方图保留到下次开始 */
+void ir_prof_stop(void);
+
+void ir_prof_get_stats(ir_prof_stats_t *stats);
+
+/* 计数最多的max个PC，按计数从大到小，返回个数。采样中读取时计数
+ * 仍在变化，停止后读取才是一致的 */
+size_t ir_prof_top(ir_prof_slot_t *out, size_t max);
+
+/* 按槽位顺序取下一个非空槽 - *pos从0开始，返回0，取完返回-ENOENT */
+int ir_prof_next(uint32_t *pos, ir_prof_slot_t *slot);
+
+#endif /* IR_PROF_H */
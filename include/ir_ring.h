@@ -0,0 +1,80 @@
+/**
+ * @file ir_ring.h
+ * @brief 无锁单生产者/单消费者环形缓冲区 (ISR与线程之间)
+ *
+ * 生产者只写head，消费者只写tail，容量必须为2的幂。
+ */
+
+#ifndef IR_RING_H
+#define IR_RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/toolchain.h>
+
+typedef struct {
+  atomic_uint head;   // 下一个写入位置(生产者)
+  atomic_uint tail;   // 下一个读取位置(消费者)
+  uint32_t *buf;      // 存储区
+  uint32_t mask;      // 容量-1
+  uint32_t overflows; // 满时丢弃的元素数(生产者)
+} ir_ring_t;
+
+/* 静态定义环形缓冲区 */
+#define IR_RING_DEFINE(name, size)                                             \
+  static uint32_t name##_buf[size];                                            \
+  static ir_ring_t name = {.buf = name##_buf, .mask = (size) - 1};             \
+  BUILD_ASSERT(((size) & ((size) - 1)) == 0, "ring size must be power of 2")
+
+/* 运行时初始化 (缓冲区属于更大的结构体、无法用IR_RING_DEFINE时) */
+static inline void ir_ring_init(ir_ring_t *ring, uint32_t *buf, uint32_t size) {
+  ring->buf = buf;
+  ring->mask = size - 1;
+  ring->overflows = 0;
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->tail, 0);
+}
+
+/* 清空 (仅在生产者与消费者都停止时调用) */
+static inline void ir_ring_reset(ir_ring_t *ring) {
+  atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+  atomic_store_explicit(&ring->tail, 0, memory_order_relaxed);
+}
+
+/* 当前元素数 */
+static inline uint32_t ir_ring_count(const ir_ring_t *ring) {
+  return atomic_load_explicit(&ring->head, memory_order_acquire) -
+         atomic_load_explicit(&ring->tail, memory_order_acquire);
+}
+
+/* 写入一个元素 - 仅生产者调用，满时返回false */
+static inline bool ir_ring_put(ir_ring_t *ring, uint32_t value) {
+  unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+  if (head - tail > ring->mask) {
+    ring->overflows++;
+    return false;
+  }
+
+  ring->buf[head & ring->mask] = value;
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+  return true;
+}
+
+/* 读取一个元素 - 仅消费者调用，空时返回false */
+static inline bool ir_ring_get(ir_ring_t *ring, uint32_t *value) {
+  unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+  if (tail == head) {
+    return false;
+  }
+
+  *value = ring->buf[tail & ring->mask];
+  atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+  return true;
+}
+
+#endif /* IR_RING_H */
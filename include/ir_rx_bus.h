@@ -0,0 +1,55 @@
+/**
+ * @file ir_rx_bus.h
+ * @brief 解码事件总线 - 每个解出的帧在zbus通道ir_rx_chan上发布一次
+ *
+ * 接收回调只有一个，BLE通知、日志、统计和宏触发各自订阅本通道即可，
+ * 增加订阅者不增加解码，也不增加拷贝: 监听者(ZBUS_LISTENER_DEFINE)在
+ * 发布线程中用zbus_chan_const_msg()就地读取消息。消息在解码工作队列中
+ * 发布，此时服务的接收回调也已调用完毕。
+ *
+ * 消息带码值副本而非库内条目指针 - 活动集可随时热替换，指针在消息被
+ * 读取时可能已失效; 名称用ir_service_entry_name(&msg->code)取得。
+ */
+
+#ifndef IR_RX_BUS_H
+#define IR_RX_BUS_H
+
+#include "irdb_protocol.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define IR_RX_BUS_NO_REMOTE 0xFF     // 码值不在任何已加载的遥控器中
+#define IR_RX_QUALITY_UNKNOWN 0xFF   // 协议没有标称时序 (IRP)
+
+/* 解码事件 - 24字节 */
+typedef struct {
+  irdb_entry_t code;     // 码值; 库中有时为条目副本(含名称偏移)
+  uint8_t channel;       // 接收通道
+  uint8_t remote;        // 所属遥控器槽位，IR_RX_BUS_NO_REMOTE为库中没有
+  uint32_t timestamp_us; // 帧结束时刻 (HAL接收时间戳)
+  uint32_t presses;      // 本通道的按键计数 (库中没有的码值为0)
+  uint8_t quality;       // 时序质量0~100 (irdb_timing_quality)
+  bool repeat;           // 重复码
+  bool new_press;        // 新按键 (否则为长按或重复码)
+} ir_rx_msg_t;
+
+#ifdef CONFIG_IR_RX_BUS
+#include <zephyr/zbus/zbus.h>
+
+ZBUS_CHAN_DECLARE(ir_rx_chan);
+
+/* 发布 - 通道忙超过IR_RX_BUS_PUB_TIMEOUT_MS时丢弃并计数 */
+void ir_rx_bus_publish(const ir_rx_msg_t *msg);
+
+/* 已发布和丢弃的消息数 */
+void ir_rx_bus_get_stats(uint32_t *published, uint32_t *dropped);
+#else
+static inline void ir_rx_bus_publish(const ir_rx_msg_t *msg) {}
+static inline void ir_rx_bus_get_stats(uint32_t *published,
+                                       uint32_t *dropped) {
+  *published = 0;
+  *dropped = 0;
+}
+#endif
+
+#endif /* IR_RX_BUS_H */
@@ -1,16 +1,33 @@
 /**
  * @file ir_service.h
  * @brief IR服务层 - 整合HAL、IRDB协议和加载器
+ *
+ * 可在多个线程中同时调用(shell、BLE、CoAP、宏引擎)。查找和发送只读取
+ * 活动集的已发布快照，不加锁; 加载、移出、选择遥控器和启停接收串行
+ * 执行，不阻塞查找、发送和接收。返回库内指针的接口(find_function、
+ * get_database等)所指内容在该遥控器被替换或移出前有效。
  */
 
 #ifndef IR_SERVICE_H
 #define IR_SERVICE_H
 
 #include "ir_hal.h"
+#include "ir_keys.h"
+#include "ir_tx_queue.h"
 #include "irdb_loader.h"
 #include "irdb_protocol.h"
 #include <stddef.h>
 
+/* 活动集 - 同时加载的遥控器，命令以"编号:功能"寻址 (如"avr:Vol+")，
+ * 无前缀或前缀不是活动集中的编号时用当前选中的遥控器 */
+#ifdef CONFIG_IR_SERVICE_MAX_REMOTES
+#define IR_SERVICE_MAX_REMOTES CONFIG_IR_SERVICE_MAX_REMOTES
+#else
+#define IR_SERVICE_MAX_REMOTES 4
+#endif
+#define IR_SERVICE_REMOTE_ID_MAX 16 // 遥控器编号最大长度(含结束符)
+#define IR_SERVICE_REMOTE_SEP ':'   // 编号与功能名的分隔符
+#define IR_SERVICE_ID_SHIFT 16      // 功能编号: 遥控器槽位 << 16 | 条目下标
 
 /* IR服务配置 */
 typedef struct {
@@ -24,23 +41,130 @@ typedef struct {
 /* IR服务初始化 */
 int ir_service_init(void);
 
-/* 加载遥控器数据库 */
+/* 加载遥控器数据库 - 替换当前选中的遥控器。新库完整建好后原子切换，
+ * 接收不停止；加载失败时原有的保持不变 */
 int ir_service_load_remote(const ir_service_config_t *config);
 
-/* 从嵌入式数据加载 */
-int ir_service_load_embedded_csv(const char *csv_data, const char *manufacturer,
+/* 预载入RAM缓存 - 不加入活动集，之后加载同一遥控器时直接命中。内置
+ * 遥控器无需预载，返回0；缓存条目全被引用放不下时返回-EBUSY */
+int ir_service_prefetch_remote(const ir_service_config_t *config);
+
+/* 从嵌入式数据加载 - CSV文本或二进制镜像，替换当前选中的遥控器 */
+int ir_service_load_embedded_csv(const void *data, const char *manufacturer,
                                  const char *device_type);
 
-/* 发送命令（通过功能名） */
+/* 加入活动集 - 已有同编号的遥控器时替换之，槽位用尽返回-ENOMEM。编号
+ * 不能含分隔符。选中的遥控器为空时改选新加入的 */
+int ir_service_add_remote(const char *remote_id,
+                          const ir_service_config_t *config);
+int ir_service_add_embedded(const char *remote_id, const void *data,
+                            const char *manufacturer,
+                            const char *device_type);
+
+/* 加入已解析的数据库(如irdb_parser分块解析的结果) - 活动集接管db的
+ * 条目和索引，成功后db被清空 */
+int ir_service_add_database(const char *remote_id, irdb_database_t *db);
+
+/* 移出活动集 */
+int ir_service_remove_remote(const char *remote_id);
+
+/* 选择无前缀功能名所用的遥控器 */
+int ir_service_select_remote(const char *remote_id);
+
+/* 列出活动集 (选中的遥控器以*标记) */
+int ir_service_list_remotes(char *buf, size_t buf_size);
+
+/* 发送命令（通过功能名，可带"编号:"前缀） */
 int ir_service_send_command(const char *function_name, uint32_t repeat);
 
+/* 查找条目 (功能名可带"编号:"前缀)，未找到返回NULL。发送优先用
+ * send_command/send_id，查找和复制在同一快照内完成 */
+const irdb_entry_t *ir_service_find_function(const char *function_name);
+
+/* 查找功能编号 - 重复发送时用编号代替名称，省去字符串查找
+ * 编号带遥控器槽位，对活动集中任一遥控器有效 */
+int ir_service_find_function_id(const char *function_name);
+
+/* 查找功能名对应的全部功能编号 - 带"编号:"前缀时只查该遥控器，否则查
+ * 活动集中的每个遥控器，同一遥控器内的同名条目也都计入。最多写入max个，
+ * 返回找到的总数(可大于max)，没有找到返回0 */
+int ir_service_find_function_ids(const char *function_name, int32_t *ids,
+                                 size_t max);
+
+/* 按功能编号发送 (编号在重新加载数据库后失效) */
+int ir_service_send_id(int id, uint32_t repeat);
+
 /* 发送原始IRDB条目 */
 int ir_service_send_entry(const irdb_entry_t *entry, uint32_t repeat);
 
+/* 发送Pronto学习码 (0000格式)，按载波周期直接生成发送序列 */
+int ir_service_send_pronto(const char *pronto, uint32_t repeat);
+
+/* 异步发送命令 - 编码后入队立即返回，完成时调用callback(可为NULL) */
+int ir_service_send_async(const char *function_name, uint32_t repeat,
+                          ir_tx_done_callback_t callback, void *user_data);
+
+/* 异步发送IRDB条目 */
+int ir_service_send_entry_async(const irdb_entry_t *entry, uint32_t repeat,
+                                ir_tx_done_callback_t callback,
+                                void *user_data);
+
+/* 按通道异步发送 - channels为发射通道位掩码(IR_HAL_TX_CH_ALL以内)，同一帧
+ * 从所选通道同时发出; 排队中发往不同通道的帧(载波和占空比相同)并行发送 */
+int ir_service_send_async_on(const char *function_name, uint32_t repeat,
+                             uint8_t channels, ir_tx_done_callback_t callback,
+                             void *user_data);
+int ir_service_send_entry_async_on(const irdb_entry_t *entry, uint32_t repeat,
+                                   uint8_t channels,
+                                   ir_tx_done_callback_t callback,
+                                   void *user_data);
+
+/* 定时异步发送 - 在同步时基(ir_timesync.h)的start_at_us时刻开始发送，
+ * 多台设备按同一时刻同时发出。按批量帧排队，等待开始时刻期间交互命令
+ * 照常发送; 时刻已过时立即发送并计入迟到 */
+int ir_service_send_at(const char *function_name, uint32_t repeat,
+                       uint8_t channels, uint64_t start_at_us,
+                       ir_tx_done_callback_t callback, void *user_data);
+int ir_service_send_entry_at(const irdb_entry_t *entry, uint32_t repeat,
+                             uint8_t channels, uint64_t start_at_us,
+                             ir_tx_done_callback_t callback,
+                             void *user_data);
+
+/* 按功能编号异步发送 - 省去名称查找，供高频命令链路使用 */
+int ir_service_send_id_async_on(int id, uint32_t repeat, uint8_t channels,
+                                ir_tx_done_callback_t callback,
+                                void *user_data);
+
+/* 异步发送原始时序 - 紧凑时序(见ir_timing.h)标记与间隔交替、以标记开始，
+ * 拷贝进队列帧后立即返回; carrier_freq为0时按IR_CARRIER_FREQ，各次之间
+ * 间隔gap_us */
+int ir_service_send_raw_async_on(const ir_timing_t *timings, uint32_t count,
+                                 uint32_t carrier_freq, uint32_t gap_us,
+                                 uint32_t repeat, uint8_t channels,
+                                 ir_tx_done_callback_t callback,
+                                 void *user_data);
+
 /* 接收回调 */
 typedef void (*ir_service_rx_callback_t)(const irdb_entry_t *entry,
                                          void *user_data);
 
+/* 接收回调帧的按键状态 - RC5/RC6按帧中toggle位区分新按键和长按，其余
+ * 协议按码值变化或距上一帧超过重复窗口判定; 重复码总是长按 */
+typedef struct {
+  bool new_press;   // 新按下(而不是长按的后续帧)
+  int8_t toggle;    // 帧中的toggle位，IRDB_TOGGLE_NONE为协议没有
+  uint8_t channel;  // 接收通道
+  uint32_t presses; // 该通道累计的新按键数
+  int32_t id;       // 功能编号(同find_function_id)，解码时查出，长按沿用
+} ir_service_press_t;
+
+/* 只在接收回调中调用，返回正在回调的帧的按键状态 */
+int ir_service_rx_press(ir_service_press_t *press);
+
+/* 活动集版本 - 加载、加入、移出遥控器时递增，此前得到的功能编号随之
+ * 失效，按编号建的表(如ir_action.h)据此重建 */
+uint32_t ir_service_generation(void);
+
 /* 启动接收 */
 int ir_service_start_receive(ir_service_rx_callback_t callback,
                              void *user_data);
@@ -48,10 +172,99 @@ int ir_service_start_receive(ir_service_rx_callback_t callback,
 /* 停止接收 */
 int ir_service_stop_receive(void);
 
-/* 列出当前数据库的所有功能 */
+/* 按通道接收 - channels为接收通道位掩码(IR_HAL_RX_CH_ALL以内)，每个通道
+ * 独立解码、各自记下callback和user_data(可按通道传不同的user_data区分
+ * 接收头); ir_service_start_receive/stop_receive即全部通道。
+ * 不需要已加载的数据库，callback只收到库中有的条目，可为NULL(只用码值
+ * 回调) */
+int ir_service_start_receive_on(uint8_t channels,
+                                ir_service_rx_callback_t callback,
+                                void *user_data);
+int ir_service_stop_receive_on(uint8_t channels);
+
+/* 未解码帧回调 - 数据库无法解码且不是重复码的整帧 (如交给学习信号匹配)，
+ * 在解码工作队列中调用，timings仅在回调期间有效 */
+typedef void (*ir_service_raw_callback_t)(const ir_timing_t *timings,
+                                          uint32_t count, void *user_data);
+
+void ir_service_set_raw_callback(ir_service_raw_callback_t callback,
+                                 void *user_data);
+
+/* 码值回调 - 任何解出的帧(重复码除外)都以(协议, 设备, 子设备, 功能)调用，
+ * 不论库中有无该条目(没有时name为IRDB_NAME_NONE)。设置后解码所有已注册
+ * 协议，而不只是活动集中各库的协议；在解码工作队列中调用，NULL取消 */
+typedef void (*ir_service_code_callback_t)(const irdb_entry_t *code,
+                                           void *user_data);
+
+void ir_service_set_code_callback(ir_service_code_callback_t callback,
+                                  void *user_data);
+
+/* 按键事件回调 - 码值回调的整形版本: 每次按键一个PRESS，按住期间每
+ * CONFIG_IR_KEY_HOLD_INTERVAL ms最多一个HOLD，松开后一个RELEASE(见
+ * ir_keys.h)，库中没有的码值也有事件。在解码工作队列中调用，NULL取消 */
+typedef void (*ir_service_key_callback_t)(const ir_key_event_t *event,
+                                          void *user_data);
+
+void ir_service_set_key_callback(ir_service_key_callback_t callback,
+                                 void *user_data);
+
+/* 接收统计 - 启动以来的累计值，按协议编号分列 */
+typedef struct {
+  uint32_t decoded[IRDB_PROTOCOL_MAX_ID + 1];   // 解出且库中有该条目
+  uint32_t unmatched[IRDB_PROTOCOL_MAX_ID + 1]; // 解出码值但库中没有
+  uint32_t repeats; // 重复码
+  uint32_t failed;  // 整帧解码无协议匹配且不是重复码
+  uint32_t dropped; // 上一帧仍在解码时到达而丢弃
+  uint32_t memo_hits; // 由解码备忘得出的结果 (已计入decoded/unmatched)
+  uint32_t overlapped; // 帧分离器从交叠中解出的帧 (已计入decoded/repeats)
+  uint32_t key_events; // 发出的按键事件
+  uint32_t coalesced;  // 按住期间合并、未单独发出事件的帧
+} ir_service_rx_stats_t;
+
+void ir_service_get_rx_stats(ir_service_rx_stats_t *stats);
+
+/* 列出当前数据库的所有功能 - 放不下时截断；大库用下面的游标逐条输出 */
 int ir_service_list_functions(char *buf, size_t buf_size);
 
-/* 获取当前数据库信息 */
+/* 功能列表游标 - 每次取当前选中遥控器的一个条目，两次调用之间不持有
+ * 活动集，可以在其间做慢速输出(shell打印、链路发送)，无需整表缓冲 */
+typedef struct {
+  uint32_t index; // 下一个条目下标(即功能编号)
+  uint32_t count; // 最近一次调用时的条目数
+  const void *db; // 遍历中的数据库，只用于比较
+} ir_service_func_iter_t;
+
+void ir_service_func_iter_init(ir_service_func_iter_t *it, uint32_t start);
+
+/* 取下一个条目，name非NULL时拷贝功能名称。返回0；遍历完返回-ENOENT，
+ * 没有数据库返回-EINVAL，遍历中选中的遥控器变了返回-ESTALE */
+int ir_service_func_iter_next(ir_service_func_iter_t *it, irdb_entry_t *entry,
+                              char *name, size_t size);
+
+/* 功能名前缀查找的一个结果 */
+typedef struct {
+  char remote[IR_SERVICE_REMOTE_ID_MAX]; // 遥控器编号，未命名的槽位为空串
+  char name[IRDB_NAME_MAX];
+  int32_t id; // 在该遥控器中的功能编号
+} ir_service_match_t;
+
+/* 按前缀查找活动集所有遥控器的功能名 (不区分大小写) - 各库的名称序
+ * 归并，结果按名称排序(同名按活动集顺序)。跳过前skip个后最多填max个，
+ * 下一页的skip加上本页个数; 只在拷贝期间进入活动集，skip越大越慢。
+ * 返回填入的个数 */
+int ir_service_search_functions(const char *prefix, uint32_t skip,
+                                ir_service_match_t *out, size_t max);
+
+/* 获取条目的功能名称 (条目需来自活动集，如接收回调的解码结果) */
+const char *ir_service_entry_name(const irdb_entry_t *entry);
+
+/* 获取条目所属遥控器的编号 - 多个遥控器有相同码值时为活动集中靠前的 */
+const char *ir_service_entry_remote(const irdb_entry_t *entry);
+
+/* 获取当前选中的遥控器的数据库 */
 const irdb_database_t *ir_service_get_database(void);
 
+/* 按编号获取活动集中的数据库 */
+const irdb_database_t *ir_service_get_remote(const char *remote_id);
+
 #endif /* IR_SERVICE_H */
\ No newline at end of file
@@ -0,0 +1,79 @@
+/**
+ * @file ir_signal_lib.h
+ * @brief 学习信号库 - 按名称存取学习信号的正文
+ *
+ * 两种后端，由CONFIG_IR_LEARNING_STORAGE选择:
+ *   LittleFS: 全部信号追加写入单个文件，每个信号一条记录(记录头 + 名称 +
+ *     正文)，删除和覆盖追加新记录，废弃字节超过有效字节时整理。初始化时
+ *     扫描一次建立内存索引，之后按名称O(1)定位，整个会话只打开一次文件。
+ *   NVS: 每个信号一条NVS记录，ID由名称哈希决定，写入原子且自带磨损均衡。
+ * 正文格式由调用者(ir_learning.c)决定，通过ir_signal_stream_t读写。
+ * LittleFS后端在CONFIG_IR_STORAGE_COMPRESS时把正文压缩存放(ir_lz.h)，
+ * 流的读写透明地压缩和解压，读出的时长直接解压到调用者的缓冲中。
+ * 两种后端都在RAM中组装整条记录，提交时一次写入。
+ */
+
+#ifndef IR_SIGNAL_LIB_H
+#define IR_SIGNAL_LIB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+struct fs_file_t;
+struct ir_signal_lz;
+
+#define IR_SIGNAL_LIB_PATH "/lfs/ir_learned.lib"
+#define IR_SIGNAL_LIB_NAME_MAX 32 // 名称最大长度(含结束符)
+
+#ifdef CONFIG_IR_SIGNAL_LIB_MAX
+#define IR_SIGNAL_LIB_MAX CONFIG_IR_SIGNAL_LIB_MAX
+#else
+#define IR_SIGNAL_LIB_MAX 256
+#endif
+
+/* NVS后端单条记录上限 (名称 + 最长的v2正文) */
+#define IR_SIGNAL_NVS_RECORD_MAX 1152
+
+/* 正文读写流 - 文件当前位置或内存缓冲 */
+typedef struct {
+  struct fs_file_t *file; // 非NULL时读写文件
+  uint8_t *buf;           // 否则读写buf
+  size_t size;            // buf容量(写)或正文长度(读)
+  size_t pos;             // 自起点起已读写的字节(压缩前)
+  struct ir_signal_lz *lz; // 非NULL时文件中的正文是压缩的
+  /* 非NULL时写入交给它(信号库组装记录)，签名同ir_lz_sink_t */
+  int (*sink)(void *ctx, const void *data, size_t len);
+} ir_signal_stream_t;
+
+/* 读写len字节，返回实际字节数或负错误码 */
+ssize_t ir_signal_stream_read(ir_signal_stream_t *st, void *data, size_t len);
+ssize_t ir_signal_stream_write(ir_signal_stream_t *st, const void *data,
+                               size_t len);
+
+/* 回到流起点 */
+int ir_signal_stream_rewind(ir_signal_stream_t *st);
+
+/* 打开信号库并建立索引 */
+int ir_signal_lib_init(void);
+
+/* 定位信号正文，st返回位于正文起点的流。成功后须调用
+ * ir_signal_lib_read_end()，期间库被锁定。未找到返回-ENOENT */
+int ir_signal_lib_read_begin(const char *name, ir_signal_stream_t **st);
+void ir_signal_lib_read_end(void);
+
+/* 开始写入一个信号，st返回正文写入流。调用者写完正文后以
+ * ir_signal_lib_write_end()提交(commit为false时丢弃)，同名旧信号被覆盖。
+ * 库已满返回-ENOSPC */
+int ir_signal_lib_write_begin(const char *name, ir_signal_stream_t **st);
+int ir_signal_lib_write_end(bool commit);
+
+/* 删除信号，未找到返回-ENOENT */
+int ir_signal_lib_delete(const char *name);
+
+/* 信号数量，及按下标取名称(下标在删除后会变化) */
+uint16_t ir_signal_lib_count(void);
+int ir_signal_lib_name(uint16_t index, char *name, size_t size);
+
+#endif /* IR_SIGNAL_LIB_H */
@@ -0,0 +1,34 @@
+/**
+ * @file ir_stats.h
+ * @brief 运行计数汇总 - 一次取齐HAL、服务、数据库和学习各层的计数
+ *
+ * 各模块的计数在各自的热路径上以原子加或已持有的锁内自增维护，不打
+ * 日志，量产构建中也保持开启。这里只是快照，不额外计数；各项为启动
+ * 以来的累计值，彼此不是同一时刻的原子快照。
+ */
+
+#ifndef IR_STATS_H
+#define IR_STATS_H
+
+#include "ir_hal.h"
+#include "ir_learning.h"
+#include "ir_service.h"
+#include "ir_tx_cache.h"
+#include "ir_tx_queue.h"
+#include "irdb_loader.h"
+
+typedef struct {
+  ir_hal_rx_stats_t rx;          // 边沿捕获、毛刺滤除、环形缓冲溢出
+  ir_service_rx_stats_t decode;  // 按协议的解码结果
+  irdb_cache_stats_t irdb_cache; // 数据库RAM缓存
+  uint32_t parsed_bytes;         // CSV解析字节数
+  ir_hal_tx_power_stats_t tx;    // 发射帧数、发射时长
+  ir_tx_queue_stats_t tx_queue;  // 发送队列
+  ir_tx_cache_stats_t tx_cache;  // 时序缓存
+  ir_learning_stats_t learning;  // 学习结果
+} ir_stats_t;
+
+/* 取全部计数 */
+void ir_stats_get(ir_stats_t *stats);
+
+#endif /* IR_STATS_H */
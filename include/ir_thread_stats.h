@@ -0,0 +1,37 @@
+/**
+ * @file ir_thread_stats.h
+ * @brief 线程栈高水位和CPU占用 - 按实测调整各线程的栈大小、找出占CPU的线程
+ *
+ * 遍历全部线程(ir_tx、ir_rx、ir_decode、ir_io、ir_link、BT、shell、main、
+ * sysworkq等)，栈高水位由CONFIG_INIT_STACKS填充的哨兵值扫描得出，CPU
+ * 占用取CONFIG_THREAD_RUNTIME_STATS的执行周期。每次取样与上一次取样
+ * 比较，得出这段时间内的占用; 同时给出启动以来的占用。
+ *
+ * 扫描栈要读完未用部分，在调用者线程中逐个线程进行，不关中断。
+ */
+
+#ifndef IR_THREAD_STATS_H
+#define IR_THREAD_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define IR_THREAD_STATS_MAX 24     // 一次最多报告的线程数
+#define IR_THREAD_STATS_NAME_MAX 16 // 线程名称(含结束符)，更长的截断
+
+typedef struct {
+  char name[IR_THREAD_STATS_NAME_MAX];
+  int priority;
+  uint32_t stack_size; // 字节
+  uint32_t stack_used; // 启动以来的最大用量(高水位)
+  uint16_t cpu_permille;       // 自上次取样以来的CPU占用(千分比)
+  uint16_t cpu_total_permille; // 启动以来的CPU占用
+} ir_thread_stat_t;
+
+/* 取各线程的统计 - 最多max个，返回填入的个数; total_permille非NULL时
+ * 填入自上次取样以来除空闲线程外的总CPU占用。取样之间不宜并发调用
+ * (内部加锁串行) */
+int ir_thread_stats_get(ir_thread_stat_t *out, size_t max,
+                        uint16_t *total_permille);
+
+#endif /* IR_THREAD_STATS_H */
@@ -0,0 +1,55 @@
+/**
+ * @file ir_timesync.h
+ * @brief 同步时基 - 多个发射器在同一时刻开始发送
+ *
+ * 同步时间 = 本机运行时间(us) + 偏移，偏移来自:
+ *
+ * - ir_timesync_set(): 集线器经命令链路下发当前时间，精度受链路时延
+ *   限制(USB约1ms，BLE一个连接间隔)，用于粗同步;
+ * - ir_timesync_set_at(): BLE/Thread的时间同步协议给出同步点及其本机
+ *   时间戳，精度即该协议的精度;
+ * - 秒脉冲(CONFIG_IR_TIMESYNC_PPS，zephyr,user节点的ir-pps-gpios): 各单元
+ *   接同一路PPS，每个上升沿把同步时间对齐到最近的整秒。粗同步误差在
+ *   ±0.5s以内即可，此后各单元之间的偏差为一个系统时钟节拍(32768Hz时
+ *   约31us)加中断时延之差，每秒的对齐同时消除各单元晶振的漂移。
+ *
+ * 发送队列按同步时间定时发送(ir_tx_frame_t.start_at_us)。
+ */
+
+#ifndef IR_TIMESYNC_H
+#define IR_TIMESYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define IR_TIMESYNC_PPS_PERIOD_US 1000000 // 秒脉冲周期
+
+typedef struct {
+  bool synced;          // 已设置过时间或收到过秒脉冲
+  uint32_t sets;        // ir_timesync_set/set_at的调用次数
+  uint32_t pulses;      // 秒脉冲边沿
+  int32_t last_step_us; // 最近一次秒脉冲对齐的调整量
+  uint32_t max_step_us; // 秒脉冲对齐调整量绝对值的最大值(漂移+量化)
+} ir_timesync_stats_t;
+
+/* 初始化 - 配置了秒脉冲时开启其中断 */
+int ir_timesync_init(void);
+
+/* 本机运行时间(us)，发送队列的时基 */
+uint64_t ir_timesync_local_us(void);
+
+/* 当前同步时间(us) */
+uint64_t ir_timesync_now_us(void);
+
+/* 把当前同步时间设为sync_us */
+void ir_timesync_set(uint64_t sync_us);
+
+/* 同步点 - 本机时刻local_us对应同步时间sync_us */
+void ir_timesync_set_at(uint64_t sync_us, uint64_t local_us);
+
+/* 同步时间换算为本机运行时间，早于启动的时刻返回0 */
+uint64_t ir_timesync_to_local_us(uint64_t sync_us);
+
+void ir_timesync_get_stats(ir_timesync_stats_t *stats);
+
+#endif /* IR_TIMESYNC_H */
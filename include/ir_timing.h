@@ -0,0 +1,43 @@
+/**
+ * @file ir_timing.h
+ * @brief 紧凑16位时序表示
+ *
+ * 最高位为0时低15位即微秒数(0~32767us，覆盖所有协议的位时序)；
+ * 最高位为1时低15位以IR_TIMING_LONG_UNIT_US为单位，用于长间隔(最长约262ms)。
+ */
+
+#ifndef IR_TIMING_H
+#define IR_TIMING_H
+
+#include <stdint.h>
+
+typedef uint16_t ir_timing_t;
+
+#define IR_TIMING_LONG_FLAG 0x8000 // 长间隔标记
+#define IR_TIMING_LONG_SHIFT 3     // 长间隔单位 = 1 << SHIFT 微秒
+#define IR_TIMING_LONG_UNIT_US (1U << IR_TIMING_LONG_SHIFT)
+#define IR_TIMING_SHORT_MAX_US 0x7FFF // 短格式最大微秒数
+#define IR_TIMING_MAX_US (0x7FFFU << IR_TIMING_LONG_SHIFT)
+
+/* 微秒 -> 紧凑时序 (超出范围饱和) */
+static inline ir_timing_t ir_timing_pack(uint32_t us) {
+  if (us <= IR_TIMING_SHORT_MAX_US) {
+    return (ir_timing_t)us;
+  }
+
+  uint32_t units = (us + IR_TIMING_LONG_UNIT_US / 2) >> IR_TIMING_LONG_SHIFT;
+  if (units > 0x7FFF) {
+    units = 0x7FFF;
+  }
+  return (ir_timing_t)(IR_TIMING_LONG_FLAG | units);
+}
+
+/* 紧凑时序 -> 微秒 */
+static inline uint32_t ir_timing_us(ir_timing_t t) {
+  if (t & IR_TIMING_LONG_FLAG) {
+    return (uint32_t)(t & ~IR_TIMING_LONG_FLAG) << IR_TIMING_LONG_SHIFT;
+  }
+  return t;
+}
+
+#endif /* IR_TIMING_H */
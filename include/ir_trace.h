@@ -0,0 +1,100 @@
+/**
+ * @file ir_trace.h
+ * @brief 收发流水线时延跟踪 - 每帧一条记录，逐阶段打时间戳
+ *
+ * 接收: 最后一个沿(硬件时间戳) -> 帧结束判定 -> 解码开始/结束 -> 回调返回
+ * 发送: 调用发送命令 -> 查找完成 -> 编码完成 -> 开始发射 -> 发射结束
+ *
+ * 时间戳与ir_pulse_t.timestamp_us同源(系统运行时间，精度为一个内核
+ * tick，nRF52约30.5us)。记录提交时计入各阶段的对数直方图，最近的记录
+ * 保留在环形缓冲中。
+ */
+
+#ifndef IR_TRACE_H
+#define IR_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* 环形缓冲中保留的记录数 */
+#ifdef CONFIG_IR_TRACE_RECORDS
+#define IR_TRACE_RECORDS CONFIG_IR_TRACE_RECORDS
+#else
+#define IR_TRACE_RECORDS 32
+#endif
+
+#define IR_TRACE_STAGES 5
+#define IR_TRACE_UNSET UINT32_MAX   // 未经过的阶段
+#define IR_TRACE_NO_PROTOCOL 0xFFFF // 帧未解出
+#define IR_TRACE_HIST_BINS 16       // 第0格<32us，第k格[2^(k+4), 2^(k+5))
+#define IR_TRACE_HIST_MIN_SHIFT 5
+
+typedef enum {
+  IR_TRACE_NONE, // 记录未开始，提交时忽略
+  IR_TRACE_RX,
+  IR_TRACE_TX,
+  IR_TRACE_KINDS
+} ir_trace_kind_t;
+
+/* 接收阶段 */
+enum {
+  IR_TRACE_RX_CAPTURE,      // 帧最后一个沿 (流式解码为完成解码的沿)
+  IR_TRACE_RX_FRAME_END,    // 帧结束判定 (流式解码为识别出码值)
+  IR_TRACE_RX_DECODE_START, // 解码开始
+  IR_TRACE_RX_DECODE_END,   // 解码和查库完成
+  IR_TRACE_RX_DISPATCH,     // 用户回调返回
+};
+
+/* 发送阶段 */
+enum {
+  IR_TRACE_TX_COMMAND, // 调用发送接口
+  IR_TRACE_TX_LOOKUP,  // 按功能名查到条目
+  IR_TRACE_TX_ENCODE,  // 编码完成(或取到缓存)
+  IR_TRACE_TX_START,   // 交给HAL开始发射
+  IR_TRACE_TX_END,     // 发射结束(含重复)
+};
+
+/* 单帧记录 - 各阶段为相对t0_us的偏移，第0阶段即t0 */
+typedef struct {
+  uint64_t t0_us;
+  uint32_t at_us[IR_TRACE_STAGES];
+  uint16_t protocol;
+  uint8_t kind;    // ir_trace_kind_t
+  uint8_t channel; // 接收为通道号，发送为通道位掩码
+} ir_trace_record_t;
+
+/* 阶段时长直方图 */
+typedef struct {
+  uint32_t count;
+  uint32_t max_us;
+  uint64_t sum_us;
+  uint32_t bins[IR_TRACE_HIST_BINS];
+} ir_trace_hist_t;
+
+/* 当前时刻(us)，与接收时间戳同源 */
+uint64_t ir_trace_now_us(void);
+
+/* 开始记录 - t0_us为第0阶段的时刻 */
+void ir_trace_begin(ir_trace_record_t *rec, ir_trace_kind_t kind,
+                    uint8_t channel, uint16_t protocol, uint64_t t0_us);
+
+/* 标记阶段为当前时刻 */
+void ir_trace_mark(ir_trace_record_t *rec, int stage);
+
+/* 提交到环形缓冲和直方图，之后记录回到未开始状态 */
+void ir_trace_commit(ir_trace_record_t *rec);
+
+/* 直方图 - span为0时是总时延(接收: 沿到回调返回，发送: 命令到开始
+ * 发射)，span为s(1..4)时是前一个经过的阶段到第s阶段，未经过的阶段不计入 */
+int ir_trace_get_hist(ir_trace_kind_t kind, int span, ir_trace_hist_t *hist);
+
+/* 最近的记录，新的在前，返回条数 */
+size_t ir_trace_get_records(ir_trace_record_t *out, size_t max);
+
+/* 阶段名称 */
+const char *ir_trace_stage_name(ir_trace_kind_t kind, int stage);
+
+/* 清空记录和直方图 */
+void ir_trace_reset(void);
+
+#endif /* IR_TRACE_H */
@@ -0,0 +1,77 @@
+/**
+ * @file ir_tx_cache.h
+ * @brief IR发送缓存 - 条目预编码为时序块，发送时只移交指针
+ */
+
+#ifndef IR_TX_CACHE_H
+#define IR_TX_CACHE_H
+
+#include "ir_tx_queue.h"
+#include "irdb_protocol.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/sys/atomic.h>
+
+/* 配置参数 */
+#define IR_TX_CACHE_SLOTS 16 // 缓存条目数(LRU淘汰)
+#define IR_TX_CACHE_PIN_MAX (IR_TX_CACHE_SLOTS / 2) // 钉住条目上限
+
+/* 缓存模式 */
+typedef enum {
+  IR_TX_CACHE_OFF,        // 每次发送都重新编码
+  IR_TX_CACHE_LAZY,       // 首次发送时编码并缓存
+  IR_TX_CACHE_PRECOMPILE, // 加载数据库时预编码(前IR_TX_CACHE_SLOTS个条目)
+} ir_tx_cache_mode_t;
+
+/* 预编码时序块 */
+typedef struct {
+  uint16_t protocol; // 键: 协议和码值
+  uint16_t device;
+  uint16_t subdevice;
+  uint16_t function;
+  uint32_t carrier_freq;        // 载波频率(Hz)
+  uint32_t gap_us;              // 帧间隔(us)
+  uint32_t timing_count;        // 完整帧时序数
+  ir_timing_t *timings;         // 完整帧时序(按实际长度分配)
+  uint32_t repeat_timing_count; // 重复码时序数(0表示无)
+  ir_timing_t repeat_timings[IR_TX_REPEAT_MAX_TIMINGS];
+} ir_tx_blob_t;
+
+/* 缓存统计 */
+typedef struct {
+  uint32_t hits;      // 命中
+  uint32_t misses;    // 未命中(需编码)
+  uint32_t evictions; // LRU淘汰
+  uint32_t used;      // 已用槽位
+  uint32_t pinned;    // 其中钉住的
+  uint32_t bytes;     // 时序占用内存
+} ir_tx_cache_stats_t;
+
+/* 设置缓存模式 (切换时清空缓存) */
+void ir_tx_cache_set_mode(ir_tx_cache_mode_t mode);
+
+/* 获取缓存模式 */
+ir_tx_cache_mode_t ir_tx_cache_get_mode(void);
+
+/* 预编码数据库条目 (仅PRECOMPILE模式生效) */
+int ir_tx_cache_precompile(const irdb_database_t *db);
+
+/* 获取条目的时序块并加引用，缓存关闭或失败返回NULL */
+const ir_tx_blob_t *ir_tx_cache_get(const irdb_entry_t *entry);
+
+/* 释放引用 */
+void ir_tx_cache_put(const ir_tx_blob_t *blob);
+
+/* 钉住条目 - 立即编码并常驻缓存，LRU淘汰和清空都跳过。替换之前钉住的
+ * 集合，count为0时全部取消；超过IR_TX_CACHE_PIN_MAX的忽略。钉住集合
+ * 按码值记下，缓存关闭后重新开启时重新编码。返回钉住的条目数 */
+int ir_tx_cache_pin(const irdb_entry_t *entries, size_t count);
+
+/* 清空缓存 - 钉住的条目保留(按码值索引，与数据库无关)，仍被引用的块
+ * 在最后一次put时释放 */
+void ir_tx_cache_clear(void);
+
+/* 获取统计 */
+void ir_tx_cache_get_stats(ir_tx_cache_stats_t *stats);
+
+#endif /* IR_TX_CACHE_H */
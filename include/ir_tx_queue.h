@@ -0,0 +1,227 @@
+/**
+ * @file ir_tx_queue.h
+ * @brief IR异步发送队列 - 预编码帧 + 专用TX线程
+ */
+
+#ifndef IR_TX_QUEUE_H
+#define IR_TX_QUEUE_H
+
+#include "ir_timing.h"
+#include "ir_trace.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+/* 配置参数 */
+#define IR_TX_QUEUE_DEPTH 4          // 队列深度(帧)
+#define IR_TX_FRAME_MAX_TIMINGS 512  // 单帧最大时序数
+#define IR_TX_THREAD_STACK_SIZE 1536 // TX线程栈 (插入交互帧时嵌套一层发送)
+#define IR_TX_THREAD_PRIORITY 2      // TX线程优先级
+#define IR_TX_REPEAT_MAX_TIMINGS 8   // 重复码最大时序数
+#define IR_TX_BULK_REPEAT 5          // 自动判定时发送次数超过此值为批量
+#define IR_TX_INTERACTIVE_RESERVE 1  // 批量帧不能占用的空闲帧数
+
+/* 载波侦听 - 发送前等待接收头静默满IR_TX_SENSE_IDLE_US，0关闭 */
+#ifdef CONFIG_IR_TX_SENSE_IDLE_US
+#define IR_TX_SENSE_IDLE_US CONFIG_IR_TX_SENSE_IDLE_US
+#else
+#define IR_TX_SENSE_IDLE_US 0
+#endif
+
+#ifdef CONFIG_IR_TX_SENSE_MAX_MS
+#define IR_TX_SENSE_MAX_MS CONFIG_IR_TX_SENSE_MAX_MS
+#else
+#define IR_TX_SENSE_MAX_MS 500
+#endif
+
+#define IR_TX_SENSE_SLOT_US 2000      // 首次退避的随机上限
+#define IR_TX_SENSE_SLOT_MAX_US 32000 // 退避上限逐次加倍至此
+
+/* 填充重复间隔 - 一个设备的帧按协议帧周期重复时，两帧之间发射器空闲
+ * (NEC重复码周期108ms中约97ms)。其间把发往其他设备、放得进空闲的
+ * 排队单帧插进去发送，前后各留IR_TX_GAP_FILL_GUARD_US静默，
+ * 被插入的设备之后从完整帧重新开始。只看各队列的队首，同一队列内的
+ * 顺序不变; 序列中delay_us为0的下一步同样可提前插入。0关闭 */
+#ifdef CONFIG_IR_TX_GAP_FILL_GUARD_US
+#define IR_TX_GAP_FILL_GUARD_US CONFIG_IR_TX_GAP_FILL_GUARD_US
+#else
+#define IR_TX_GAP_FILL_GUARD_US 10000
+#endif
+
+/* 合并相同命令 - 连续提交的同一条命令(同一目标、时序、通道和回调，
+ * 如滑条连发的音量+)在前一帧仍在排队时并入该帧，发送次数相加: 首帧
+ * 之后按协议帧周期发送重复码(无重复码的协议重复整帧)，省去命令之间
+ * 的帧间隔，也不再各占一个队列位置。只并入队尾的帧，发送顺序不变;
+ * 合并后的发送次数不超过IR_TX_COALESCE_MAX，每个并入的命令仍各得一次
+ * 完成回调。0关闭 */
+#ifdef CONFIG_IR_TX_COALESCE_MAX
+#define IR_TX_COALESCE_MAX CONFIG_IR_TX_COALESCE_MAX
+#else
+#define IR_TX_COALESCE_MAX 16
+#endif
+
+/* 目标设备标识 - 非0且互不相同的帧才互相填入间隔，0为未知(不参与) */
+#define IR_TX_TARGET(protocol, device)                                         \
+  ((((uint32_t)(protocol) + 1) << 16) | (uint16_t)(device))
+
+/* 定时发送 - start_at_us非0的帧在同步时基的该时刻开始第一帧: 内核定时器
+ * 在时刻前的最后一个系统时钟节拍唤醒，剩余不足一个节拍的部分忙等，多台
+ * 设备的开始时刻只差同步误差和中断时延之差。等待期间交互帧照常插入
+ * (批量帧)，放得下的其他排队单帧填入空闲。开始时刻相同、通道不重叠的
+ * 定时帧并为一批同时发送; 定时帧不做载波侦听(各台同时开始是目的) */
+
+/* 优先级类别 - 交互帧(用户按键)排在批量任务(场景、多次重复)之前，并在
+ * 正在发送的批量任务的下一个帧边界插入，交互命令的延迟不超过一帧 */
+typedef enum {
+  IR_TX_PRIO_AUTO = 0,    // 序列为批量，帧按发送次数判定
+  IR_TX_PRIO_INTERACTIVE, // 交互
+  IR_TX_PRIO_BULK,        // 批量 - 帧边界可插入交互帧，可整体取消
+} ir_tx_priority_t;
+
+/* 发送完成回调 - result为0表示成功 */
+typedef void (*ir_tx_done_callback_t)(int result, void *user_data);
+
+/* 外部时序释放回调 */
+typedef void (*ir_tx_release_t)(void *ctx);
+
+/* 预编译序列的一步 - 一帧(含重复)，之后延时再开始下一步 */
+typedef struct {
+  const ir_timing_t *timings; // 完整帧时序，由序列持有者保持有效
+  uint32_t timing_count;
+  uint32_t carrier_freq; // 载波频率(Hz)
+  uint8_t duty_cycle;    // 载波占空比(%)，0为HAL默认
+  uint8_t channels;      // 发射通道位掩码
+  uint32_t gap_us;       // 帧间隔(us)
+  bool period;           // gap_us为帧起点到帧起点的周期(协议帧周期)
+  uint32_t repeat;       // 发送次数
+  uint32_t delay_us;     // 本步结束到下一步开始的延时
+  uint32_t target;       // IR_TX_TARGET，0为未知
+  uint32_t repeat_timing_count; // 重复码时序数，0为重复整帧
+  ir_timing_t repeat_timings[IR_TX_REPEAT_MAX_TIMINGS];
+} ir_tx_step_t;
+
+/* 序列执行报告 - 各步按计划时刻(前一步计划结束 + delay_us)开始，调度
+ * 误差不会逐步累积。提前插入上一步重复间隔的步不再占用计划时长，
+ * elapsed_us可短于planned_us */
+typedef struct {
+  int result;            // 0成功，-ECANCELED已取消，其余为发送错误
+  uint32_t steps_sent;   // 已发送完的步数
+  uint32_t planned_us;   // 按计划执行完全部步骤的时长
+  uint32_t elapsed_us;   // 序列开始到结束的实际时长
+  uint32_t max_late_us;  // 各步实际开始晚于计划的最大值
+  uint32_t latency_us;   // 入队到开始执行的延迟
+} ir_tx_sequence_report_t;
+
+struct ir_tx_sequence;
+
+/* 序列完成回调 - 在TX线程中调用 */
+typedef void (*ir_tx_sequence_done_t)(const struct ir_tx_sequence *seq,
+                                      void *user_data);
+
+/* 预编译序列 - steps由调用者持有，提交后到完成回调前不得修改或释放 */
+typedef struct ir_tx_sequence {
+  const ir_tx_step_t *steps;
+  uint32_t step_count;
+  ir_tx_sequence_done_t callback;
+  void *user_data;
+  ir_tx_sequence_report_t report; // 完成时有效
+  atomic_t busy;                  // 位0已提交未完成，位1请求取消
+} ir_tx_sequence_t;
+
+/* 预编码帧 */
+typedef struct {
+  uint32_t carrier_freq;  // 载波频率(Hz)
+  uint8_t duty_cycle;     // 载波占空比(%)，0为HAL默认
+  uint8_t channels;       // 发射通道位掩码，默认IR_HAL_TX_CH_DEFAULT
+  uint32_t gap_us;        // 帧间隔(us)，默认为上一帧结束到下一帧开始
+  bool period;            // gap_us为帧起点到帧起点的周期(协议帧周期)
+  uint32_t repeat;        // 发送次数
+  uint32_t timing_count;  // 时序数量
+  uint8_t priority;       // ir_tx_priority_t，默认IR_TX_PRIO_AUTO
+  uint32_t target;        // IR_TX_TARGET，0为未知(默认)
+  uint64_t start_at_us;   // 定时发送: 同步时基(ir_timesync.h)中的开始时刻，0为尽快
+  ir_tx_done_callback_t callback;
+  void *user_data;
+  uint32_t submit_cycles; // 入队时刻(内部使用)
+  uint32_t cancel_gen;    // 入队时的批量取消次数(内部使用)
+  uint32_t coalesced;     // 并入本帧的相同命令数(内部使用)
+  ir_timing_t timings[IR_TX_FRAME_MAX_TIMINGS];
+
+  /* 重复码 (如NEC): 非0时首帧发送timings，之后各次发送repeat_timings */
+  uint32_t repeat_timing_count;
+  ir_timing_t repeat_timings[IR_TX_REPEAT_MAX_TIMINGS];
+
+  /* 外部时序 (如发送缓存): 非NULL时替代timings，帧释放时调用release */
+  const ir_timing_t *ext_timings;
+  ir_tx_release_t release;
+  void *release_ctx;
+
+  /* 预编译序列: 非NULL时本帧只是序列的载体，其余字段不使用 */
+  ir_tx_sequence_t *sequence;
+
+  /* 时延记录 - 提交者开始的记录由TX线程补上发射起止并提交 */
+  ir_trace_record_t trace;
+} ir_tx_frame_t;
+
+/* 队列统计 */
+typedef struct {
+  uint32_t depth;          // 当前排队帧数
+  uint32_t max_depth;      // 历史最大排队数
+  uint32_t submitted;      // 入队帧数
+  uint32_t sent;           // 已发送帧数
+  uint32_t dropped;        // 队列满/无空闲帧而丢弃
+  uint32_t failed;         // 发送失败
+  uint32_t parallel;       // 与其他通道的帧同时发送的帧数
+  uint32_t last_latency_us; // 最近一帧入队到开始发送的延迟
+  uint32_t max_latency_us;  // 最大延迟
+  uint32_t sequences;       // 执行完(含取消)的序列数，其各步计入sent
+  uint32_t cancelled;       // 取消的序列和批量帧数
+  uint32_t preempted;       // 在批量任务帧边界插入发送的交互批次
+  uint32_t busy_deferred;   // 因侦听到信号推迟发送的批次
+  uint32_t busy_backoffs;   // 退避次数
+  uint32_t busy_forced;     // 等满IR_TX_SENSE_MAX_MS仍有信号、照常发送
+  uint32_t busy_max_wait_us; // 单次侦听的最长等待
+  uint32_t gap_filled;      // 插入其他设备重复间隔发送的帧和序列步
+  uint32_t coalesced;       // 并入排队中相同命令、不再单独发送的帧
+  uint32_t timed;           // 定时发送的批次
+  uint32_t timed_late;      // 其中到时仍在发送前面的帧、晚于时刻开始的
+  uint32_t timed_max_late_us; // 最大迟到
+} ir_tx_queue_stats_t;
+
+/* 初始化队列并启动TX线程 */
+int ir_tx_queue_init(void);
+
+/* 申请空闲帧 (失败返回NULL并计入dropped) */
+ir_tx_frame_t *ir_tx_frame_alloc(void);
+
+/* 释放未提交的帧 */
+void ir_tx_frame_free(ir_tx_frame_t *frame);
+
+/* 提交帧 - 立即返回，帧所有权转移给队列(失败时帧被释放)。批量帧在空闲
+ * 帧不超过IR_TX_INTERACTIVE_RESERVE时拒绝(-ENOBUFS)，给交互帧留位置 */
+int ir_tx_queue_submit(ir_tx_frame_t *frame);
+
+/* 提交预编译序列 - 整个序列占一个队列位置，由TX线程逐步发送，步间不再
+ * 经过查找、编码和入队。同一序列完成前不能再次提交(-EBUSY) */
+int ir_tx_queue_submit_sequence(ir_tx_sequence_t *seq);
+
+/* 取消序列 - 正在发送的帧发完即停，排队中的序列不再发送；完成回调照常
+ * 调用，report.result为-ECANCELED。未在执行的序列返回-EALREADY */
+int ir_tx_sequence_cancel(ir_tx_sequence_t *seq);
+
+/* 取消全部批量任务 - 正在发送的批量帧或序列在当前帧发完后停止，排队中
+ * 的不再发送; 完成回调照常调用，结果为-ECANCELED。之后提交的不受影响 */
+void ir_tx_queue_cancel_bulk(void);
+
+/* 载波侦听参数 - idle_us为0关闭，max_ms为单批次最长推迟 */
+void ir_tx_queue_set_sense(uint32_t idle_us, uint32_t max_ms);
+void ir_tx_queue_get_sense(uint32_t *idle_us, uint32_t *max_ms);
+
+/* 一步的发送时长(us)，含重复间隔，不含delay_us */
+uint32_t ir_tx_step_duration_us(const ir_tx_step_t *step);
+
+/* 获取统计 */
+void ir_tx_queue_get_stats(ir_tx_queue_stats_t *stats);
+
+#endif /* IR_TX_QUEUE_H */
@@ -0,0 +1,89 @@
+/**
+ * @file ir_usage.h
+ * @brief 使用统计 - 按功能和遥控器计数，钉住常用功能，启动时预载常用遥控器
+ *
+ * 发送路径按码值给功能计数，加载遥控器时按配置给遥控器计数。表满时
+ * 替换计数最小的一项，新项从其计数加1起(space-saving)，少数常用项
+ * 不会被偶尔用到的挤出。计数定期写入IR_USAGE_PATH，重启后恢复:
+ * 计数最高的IR_USAGE_PIN个功能钉在发送缓存(ir_tx_cache_pin)，计数
+ * 最高的IR_USAGE_PRELOAD个遥控器预载入RAM缓存(HTTP遥控器同时确认
+ * flash缓存)，重启后的首次发送不必再编码和加载。
+ *
+ * 未启用CONFIG_IR_USAGE时计数函数为空函数，调用点不产生代码。
+ */
+
+#ifndef IR_USAGE_H
+#define IR_USAGE_H
+
+#include "ir_service.h"
+#include "irdb_protocol.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define IR_USAGE_PATH "/lfs/ir_usage.bin"
+
+#ifdef CONFIG_IR_USAGE_FUNCTIONS
+#define IR_USAGE_FUNCTIONS CONFIG_IR_USAGE_FUNCTIONS
+#else
+#define IR_USAGE_FUNCTIONS 32
+#endif
+
+#ifdef CONFIG_IR_USAGE_REMOTES
+#define IR_USAGE_REMOTES CONFIG_IR_USAGE_REMOTES
+#else
+#define IR_USAGE_REMOTES 4
+#endif
+
+#ifdef CONFIG_IR_USAGE_PIN
+#define IR_USAGE_PIN CONFIG_IR_USAGE_PIN
+#else
+#define IR_USAGE_PIN 8
+#endif
+
+#ifdef CONFIG_IR_USAGE_PRELOAD
+#define IR_USAGE_PRELOAD CONFIG_IR_USAGE_PRELOAD
+#else
+#define IR_USAGE_PRELOAD 2
+#endif
+
+/* 功能计数 - 按码值，code.name为IRDB_NAME_NONE */
+typedef struct {
+  irdb_entry_t code;
+  uint32_t count;
+} ir_usage_function_t;
+
+/* 遥控器计数 */
+typedef struct {
+  ir_service_config_t config;
+  uint32_t count;
+} ir_usage_remote_t;
+
+#ifdef CONFIG_IR_USAGE
+/* 发送一次 - 可在任意线程调用 */
+void ir_usage_note_send(const irdb_entry_t *entry);
+
+/* 加载一次遥控器 */
+void ir_usage_note_remote(const ir_service_config_t *config);
+#else
+static inline void ir_usage_note_send(const irdb_entry_t *entry) {}
+
+static inline void ir_usage_note_remote(const ir_service_config_t *config) {}
+#endif
+
+/* 恢复保存的计数，钉住常用功能并开始定期保存 */
+int ir_usage_init(void);
+
+/* 预载常用遥控器 - 作为作业交给I/O执行器后即返回，返回排队的个数 */
+int ir_usage_preload(void);
+
+/* 立即保存 */
+int ir_usage_save(void);
+
+/* 按计数从高到低取前max项，返回项数 */
+size_t ir_usage_top_functions(ir_usage_function_t *out, size_t max);
+size_t ir_usage_top_remotes(ir_usage_remote_t *out, size_t max);
+
+/* 清空计数和钉住的功能，同时删除保存的文件 */
+void ir_usage_reset(void);
+
+#endif /* IR_USAGE_H */
@@ -0,0 +1,80 @@
+/**
+ * @file irdb_bulk.h
+ * @brief 批量加载 - 安装调试时把几十个遥控器从LittleFS读入RAM缓存
+ *
+ * 逐个ir_service_load_remote时读flash和解析串行进行，且每个CSV读两遍
+ * (先数行数再解析)。批量加载把读取交给I/O执行线程(ir_io.h): 一组固定
+ * 的工作项各带一块数据缓冲，按顺序读出各文件的下一块，调用者线程解析
+ * 已读出的块、建索引并放入RAM缓存，用完的工作项立即重新提交。flash
+ * 驱动等待QSPI/SPI传输时CPU去解析，每个文件只读一遍; 条目数组按倍增
+ * 扩展，解析完收缩到实际大小。已编译的镜像文件(irdb_store.h)由读取端
+ * 整体读入，不经解析。
+ *
+ * 结果以IRDB_LOAD_FILESYSTEM为来源放入RAM缓存，之后ir_service_load_remote/
+ * add_remote直接命中; CONFIG_IRDB_CACHE_BYTES需能容纳整批，否则先读入的
+ * 被后读入的淘汰。
+ */
+
+#ifndef IRDB_BULK_H
+#define IRDB_BULK_H
+
+#include "irdb_loader.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* 工作项数 - 同时在读取或等待解析的数据块 */
+#ifdef CONFIG_IRDB_BULK_CHUNKS
+#define IRDB_BULK_CHUNKS CONFIG_IRDB_BULK_CHUNKS
+#else
+#define IRDB_BULK_CHUNKS 4
+#endif
+
+/* 每块字节数 */
+#ifdef CONFIG_IRDB_BULK_CHUNK_SIZE
+#define IRDB_BULK_CHUNK_SIZE CONFIG_IRDB_BULK_CHUNK_SIZE
+#else
+#define IRDB_BULK_CHUNK_SIZE 512
+#endif
+
+/* 列表文件最多的遥控器数 */
+#ifdef CONFIG_IRDB_BULK_MAX_REMOTES
+#define IRDB_BULK_MAX_REMOTES CONFIG_IRDB_BULK_MAX_REMOTES
+#else
+#define IRDB_BULK_MAX_REMOTES 32
+#endif
+
+#define IRDB_BULK_LINE_MAX 64 // 列表文件每行平均字节数，定列表缓冲大小
+
+typedef struct {
+  uint16_t loaded;   // 读入并放入RAM缓存
+  uint16_t cached;   // 已在RAM缓存中，未读flash
+  uint16_t uncached; // 读入但RAM缓存放不下，已丢弃
+  uint16_t failed;   // 打开、读取或解析失败
+  uint32_t bytes;    // 从flash读出的字节数
+  uint32_t total_ms; // 开始到全部完成
+  uint32_t read_ms;  // 执行线程读flash的累计时间
+  uint32_t parse_ms; // 调用者线程解析、建索引和放入缓存的累计时间
+  uint32_t wait_ms;  // 调用者等待数据块的累计时间
+} irdb_bulk_stats_t;
+
+/* 批量加载keys中的遥控器 (来源按IRDB_LOAD_FILESYSTEM，文件路径见
+ * irdb_build_path)。每个遥控器完成后调用cb(可为NULL)，result为0、负
+ * errno，或缓存放不下时irdb_cache_put的错误码。同一时刻只有一个批量
+ * 加载，不能在I/O执行线程中调用(-EDEADLK)。返回失败的遥控器数量 */
+int irdb_bulk_load(const irdb_cache_key_t *keys, size_t count,
+                   irdb_prefetch_cb_t cb, void *user_data,
+                   irdb_bulk_stats_t *stats);
+
+/* 解析"厂商/设备类型/设备码,子设备码" - 原地切分spec，key中的字符串
+ * 指向spec */
+int irdb_bulk_parse_spec(char *spec, irdb_cache_key_t *key);
+
+/* 按列表文件批量加载 - 每行一个上面格式的遥控器，空行和'#'开头的行
+ * 忽略。超过IRDB_BULK_MAX_REMOTES个返回-E2BIG */
+int irdb_bulk_load_list(const char *path, irdb_prefetch_cb_t cb,
+                        void *user_data, irdb_bulk_stats_t *stats);
+
+/* 吞吐 (字节/秒)，以开始到全部完成的时长计 */
+uint32_t irdb_bulk_rate(const irdb_bulk_stats_t *stats);
+
+#endif /* IRDB_BULK_H */
@@ -0,0 +1,70 @@
+/**
+ * @file irdb_corpus.h
+ * @brief IRDB镜像库 - 完整的离线IRDB镜像存于外部QSPI flash
+ *
+ * 由scripts/irdb_corpus.py把整个IRDB codes目录编译成一个文件，烧入
+ * irdb_corpus_partition (DK上8MB的MX25R64)。布局 (小端，4字节对齐):
+ *   irdb_corpus_header_t
+ *   irdb_corpus_slot_t   slots[index_size]  按遥控器键哈希的开放寻址表
+ *   记录*N: "<manufacturer>\0<device_type>\0" 补齐到4字节 + 镜像
+ *   镜像可以是压缩镜像(irdb_image_lz_header_t + LZ流，见ir_lz.h)
+ *
+ * 加载一个遥控器: 探查索引槽(经小的行缓存，通常一次)，读出键核对，
+ * 镜像读入(压缩的边读边解压)数据库堆后直接打开，无需解析和重建索引。
+ * 遥控器按IRDB_LOAD_EXTERNAL加载，内置镜像中没有的IRDB_LOAD_EMBEDDED
+ * 也到这里查找，结果进入RAM缓存。
+ */
+
+#ifndef IRDB_CORPUS_H
+#define IRDB_CORPUS_H
+
+#include "irdb_protocol.h"
+#include <stdint.h>
+
+#define IRDB_CORPUS_MAGIC 0x43445249 // "IRDC"
+#define IRDB_CORPUS_VERSION 1
+
+/* 文件头 */
+typedef struct {
+  uint32_t magic;        // IRDB_CORPUS_MAGIC
+  uint16_t version;      // IRDB_CORPUS_VERSION
+  uint16_t reserved;
+  uint32_t remote_count; // 遥控器数
+  uint32_t index_size;   // 索引槽数(2的幂)
+  uint32_t size;         // 文件总字节数
+} irdb_corpus_header_t;
+
+/* 索引槽 - size为0表示空槽 */
+typedef struct {
+  uint32_t hash;      // irdb_corpus_key_hash
+  uint32_t offset;    // 记录起点(自文件头起)
+  uint32_t size;      // 记录字节数(键 + 补齐 + 镜像)
+  uint8_t device;
+  uint8_t subdevice;
+  uint16_t key_len;   // "<manufacturer>\0<device_type>\0"的字节数
+} irdb_corpus_slot_t;
+
+/* 统计 */
+typedef struct {
+  uint32_t remotes;     // 库中的遥控器数，未找到有效的库时为0
+  uint32_t size;        // 库的字节数
+  uint32_t loads;       // 成功加载
+  uint32_t probes;      // 读过的索引槽
+  uint32_t line_hits;   // 索引行缓存命中
+  uint32_t bytes_read;  // 从外部flash读出的字节
+} irdb_corpus_stats_t;
+
+/* 键哈希 - FNV-1a覆盖"<manufacturer>\0<device_type>\0"、device、subdevice */
+uint32_t irdb_corpus_key_hash(const char *manufacturer,
+                              const char *device_type, uint8_t device,
+                              uint8_t subdevice);
+
+/* 加载遥控器 - db引用数据库堆中的一块镜像，irdb_free_database归还。
+ * 未找到返回-ENOENT，没有可用的库返回-ENODEV */
+int irdb_corpus_load(const char *manufacturer, const char *device_type,
+                     uint8_t device, uint8_t subdevice, irdb_database_t *db);
+
+/* 获取统计 */
+void irdb_corpus_get_stats(irdb_corpus_stats_t *stats);
+
+#endif /* IRDB_CORPUS_H */
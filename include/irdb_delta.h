@@ -0,0 +1,75 @@
+/**
+ * @file irdb_delta.h
+ * @brief IRDB增量更新 - 按版本清单只下载变化的遥控器，且只下载变化的条目
+ *
+ * 由scripts/irdb_delta.py发布到CDN的CONFIG_IRDB_DELTA_PATH下:
+ *   manifest.bin: irdb_delta_manifest_t + irdb_delta_record_t[count]
+ *     每个遥控器一条，当前版本和内容哈希
+ *   <manufacturer>/<device_type>/<device>,<subdevice>.<from>.delta:
+ *     irdb_delta_header_t + uint32_t removed[removed_count] +
+ *     新增条目的CSV文本 (与IRDB CSV相同的列)
+ *     从最近几个旧版本到当前版本各一个，更早的版本返回404
+ *
+ * 同步时先下载清单(条件请求，通常只有304)，与flash缓存中各遥控器保存的
+ * 版本比较；过期的下载对应版本的增量，在旧条目上删去removed、追加新条目，
+ * 校验内容哈希后写回flash缓存，已在RAM缓存中的同时替换。没有可用增量或
+ * 哈希不符时整表下载。已被服务槽位引用的旧数据库在下次加载时更新。
+ *
+ * 条目哈希: FNV-1a覆盖 名称 + '\0' + protocol/device/subdevice/function
+ * (各2字节小端)；内容哈希为全部条目哈希之和，与条目顺序无关。
+ * 清单按irdb_cache_key_hash(来源IRDB_LOAD_HTTP)标识遥控器。
+ */
+
+#ifndef IRDB_DELTA_H
+#define IRDB_DELTA_H
+
+#include "irdb_protocol.h"
+#include <stdint.h>
+
+#define IRDB_DELTA_MANIFEST_MAGIC 0x4D445249 // "IRDM"
+#define IRDB_DELTA_MAGIC 0x44445249          // "IRDD"
+#define IRDB_DELTA_FORMAT 1
+
+/* 清单头 */
+typedef struct {
+  uint32_t magic;  // IRDB_DELTA_MANIFEST_MAGIC
+  uint16_t format; // IRDB_DELTA_FORMAT
+  uint16_t reserved;
+  uint32_t serial; // 发布序号，每次发布递增
+  uint32_t count;  // 记录数
+} irdb_delta_manifest_t;
+
+/* 清单记录 */
+typedef struct {
+  uint32_t key_hash;     // irdb_cache_key_hash
+  uint32_t version;      // 当前版本(从1起)
+  uint32_t content_hash; // 当前内容哈希
+} irdb_delta_record_t;
+
+/* 增量文件头 */
+typedef struct {
+  uint32_t magic;        // IRDB_DELTA_MAGIC
+  uint32_t from;         // 旧版本
+  uint32_t to;           // 新版本
+  uint32_t content_hash; // 新版本的内容哈希
+  uint16_t removed_count; // 删除的条目哈希数(同一哈希可重复)
+  uint16_t reserved;
+} irdb_delta_header_t;
+
+/* 同步统计 */
+typedef struct {
+  uint16_t checked; // flash缓存中的遥控器
+  uint16_t current; // 已是最新(含首次确认版本的)
+  uint16_t patched; // 按增量更新
+  uint16_t full;    // 整表下载
+  uint16_t failed;
+  uint32_t bytes;   // 清单和增量文件的下载字节数
+} irdb_delta_stats_t;
+
+/* 数据库内容哈希 */
+uint32_t irdb_delta_content_hash(const irdb_database_t *db);
+
+/* 同步flash缓存中的全部遥控器，返回失败数或负错误码；stats可为NULL */
+int irdb_delta_sync(irdb_delta_stats_t *stats);
+
+#endif /* IRDB_DELTA_H */
@@ -0,0 +1,90 @@
+/**
+ * @file irdb_demux.h
+ * @brief 帧分离 - 在同一路边沿流上并行跟踪多个帧假设，交叠的两帧各自解出
+ *
+ * 两个遥控器同时按下、或某遥控器的重复码与另一帧交叠时，接收头输出的
+ * 是两者的叠加: 整帧缓冲里混着两帧，逐协议一个状态机的流式解码遇到第一
+ * 个外来脉冲就复位，两帧都丢。这里每个假设是一个流式解码器加它的起始沿:
+ *
+ * - 有引导码的协议在每个落在引导mark窗口内的mark上新开假设，无引导码的
+ *   协议在没有该协议的假设时开一个，因此后开始的帧有自己的状态机;
+ * - 每个沿交给全部假设。某假设的space不合窗口时不立即放弃，而是把随后
+ *   的外来mark和space并入该space(最多IRDB_DEMUX_ABSORB个mark，累计不超
+ *   过协议的帧结束门限)，累计值合窗口即继续: 另一帧短mark落在本帧space
+ *   中间的情形被还原;
+ * - 同一帧可能有几种协议解释(如NEC1/NEC2)，各自在不同的沿上解出，start
+ *   相同。调用方查库，查到后irdb_demux_settle结束该帧的其余解释，查不到
+ *   的解释不影响其他解释继续。
+ *
+ * mark与mark交叠时接收头输出的是并集，无法拆分，这种交叠仍两帧都丢。
+ * RC5/RC6和IRP协议不支持流式解码，不参与分离。只在接收线程中使用。
+ */
+
+#ifndef IRDB_DEMUX_H
+#define IRDB_DEMUX_H
+
+#include "irdb_protocol.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* 同时跟踪的帧假设数 */
+#ifdef CONFIG_IRDB_DEMUX_HYPOTHESES
+#define IRDB_DEMUX_HYPOTHESES CONFIG_IRDB_DEMUX_HYPOTHESES
+#else
+#define IRDB_DEMUX_HYPOTHESES 8
+#endif
+
+#define IRDB_DEMUX_ABSORB 2  // 一个space中最多并入的外来mark数
+#define IRDB_DEMUX_RESULTS 4 // 一个沿上解出的帧及其不同解释
+
+/* 一个帧假设 */
+typedef struct {
+  irdb_stream_decoder_t dec;
+  uint32_t start;      // 起始沿序号
+  uint32_t pending_us; // 并入外来脉冲中的space累计，0为未在并入
+  uint32_t limit_us;   // 并入上限 (协议的帧结束门限)
+  uint8_t absorbed;    // 已并入的外来mark数
+  bool active;
+} irdb_demux_hyp_t;
+
+typedef struct {
+  uint32_t frames;     // 采纳的帧 (含重复码)
+  uint32_t overlapped; // 其中与另一帧交叠的
+  uint32_t absorbed;   // 并入space的外来mark
+  uint32_t full;       // 假设已满而未能开始的帧
+} irdb_demux_stats_t;
+
+typedef struct {
+  uint16_t protocols[IRDB_PROTOCOL_MAX_ID + 1]; // 支持流式解码的协议
+  uint8_t protocol_count;
+  irdb_demux_hyp_t hyps[IRDB_DEMUX_HYPOTHESES];
+  uint32_t edge;      // 沿序号
+  uint32_t done_edge; // 上一次采纳帧时的沿序号
+  irdb_demux_stats_t stats;
+} irdb_demux_t;
+
+/* 一个解出的帧 */
+typedef struct {
+  irdb_entry_t code;  // 重复码时仅protocol有效
+  uint32_t start;     // 起始沿序号，同一帧的几种解释相同
+  bool repeat;
+  bool overlapped; // 解出时另有帧在进行，或上一帧在本帧开始后才结束
+} irdb_demux_result_t;
+
+/* 按给定协议初始化 - 不支持流式解码的协议略过，返回参与的协议数 */
+int irdb_demux_init(irdb_demux_t *dm, const uint16_t *protocols,
+                    size_t count);
+
+/* 结束全部假设 (统计保留) */
+void irdb_demux_reset(irdb_demux_t *dm);
+
+/* 输入一个脉冲 - 本沿解出的帧写入out，返回个数。out宜不少于
+ * IRDB_DEMUX_RESULTS个 */
+int irdb_demux_feed(irdb_demux_t *dm, uint32_t duration_us, bool is_mark,
+                    irdb_demux_result_t *out, size_t max);
+
+/* 采纳一个解出的帧 - 结束该帧的其余解释并计入统计 */
+void irdb_demux_settle(irdb_demux_t *dm, const irdb_demux_result_t *result);
+
+#endif /* IRDB_DEMUX_H */
@@ -0,0 +1,50 @@
+/**
+ * @file irdb_flash_cache.h
+ * @brief IRDB flash缓存 - HTTP下载的数据库以二进制镜像格式存于LittleFS
+ *
+ * 第二级缓存: RAM缓存(irdb_cache_*)未命中时先查flash，重启或切换
+ * 遥控器后无需重新下载和解析。每个遥控器一个文件，带ETag/Last-Modified
+ * 供条件请求校验，总大小超过CONFIG_IRDB_FLASH_CACHE_BYTES时按LRU删除。
+ * 校验信息中的版本号由增量更新(irdb_delta.h)维护。
+ */
+
+#ifndef IRDB_FLASH_CACHE_H
+#define IRDB_FLASH_CACHE_H
+
+#include "irdb_loader.h"
+
+#define IRDB_FLASH_CACHE_DIR "/lfs/irdb_cache"
+#define IRDB_FLASH_CACHE_KEY_MAX 96 // manufacturer和device_type(含'\0')
+
+#ifdef CONFIG_IRDB_FLASH_CACHE_BYTES
+#define IRDB_FLASH_CACHE_BYTES CONFIG_IRDB_FLASH_CACHE_BYTES
+#else
+#define IRDB_FLASH_CACHE_BYTES 65536
+#endif
+
+/* 读取缓存的数据库 - 条目、字符串池和索引直接读入堆，无需解析和重建
+ * 索引。validator非NULL时返回保存的校验信息。未缓存返回-ENOENT */
+int irdb_flash_cache_load(const irdb_cache_key_t *key, irdb_database_t *db,
+                          irdb_http_validator_t *validator);
+
+/* 保存数据库及其校验信息，随后按LRU修剪到预算以内 */
+int irdb_flash_cache_store(const irdb_cache_key_t *key,
+                           const irdb_database_t *db,
+                           const irdb_http_validator_t *validator);
+
+/* 只更新保存的版本号(validator.version)，镜像不变。未缓存返回-ENOENT */
+int irdb_flash_cache_set_version(const irdb_cache_key_t *key,
+                                 uint32_t version);
+
+/* 遍历缓存的遥控器 - key(来源为IRDB_LOAD_HTTP)和validator只在回调期间
+ * 有效，回调返回非0时停止。遍历期间持有缓存锁，回调中不得读写缓存 */
+typedef int (*irdb_flash_cache_cb_t)(const irdb_cache_key_t *key,
+                                     const irdb_http_validator_t *validator,
+                                     void *user_data);
+
+int irdb_flash_cache_foreach(irdb_flash_cache_cb_t cb, void *user_data);
+
+/* 删除全部缓存文件 */
+void irdb_flash_cache_clear(void);
+
+#endif /* IRDB_FLASH_CACHE_H */
@@ -0,0 +1,73 @@
+/**
+ * @file irdb_ident.h
+ * @brief 遥控器识别 - 由一帧解码结果查出可能的IRDB文件
+ *
+ * 布局 (小端，4字节对齐):
+ *   irdb_ident_header_t
+ *   irdb_ident_key_t  keys[key_count]   按(协议, 设备, 子设备)升序
+ *   irdb_ident_path_t paths[path_count]
+ *   uint16_t          refs[ref_count]   每个键的候选路径序号，条目多者在前
+ *   char              strings[strings_len] 厂商/类型字符串池
+ *
+ * 由scripts/irdb_ident.py从IRDB仓库生成，直接在flash中使用。
+ */
+
+#ifndef IRDB_IDENT_H
+#define IRDB_IDENT_H
+
+#include "irdb_protocol.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define IRDB_IDENT_MAGIC 0x58445249 // "IRDX"
+#define IRDB_IDENT_VERSION 1
+
+/* 索引头 */
+typedef struct {
+  uint32_t magic;      // IRDB_IDENT_MAGIC
+  uint16_t version;    // IRDB_IDENT_VERSION
+  uint16_t path_count; // 遥控器文件数
+  uint32_t key_count;
+  uint32_t ref_count;
+  uint32_t strings_len;
+  uint32_t size; // 索引总字节数
+} irdb_ident_header_t;
+
+/* 键 - 文件中出现的一组(协议, 设备, 子设备) */
+typedef struct {
+  uint16_t protocol;
+  uint16_t device;
+  uint16_t subdevice;
+  uint16_t ref_count; // 候选数
+  uint32_t first_ref; // refs中的起始下标
+} irdb_ident_key_t;
+
+/* 遥控器文件 <manufacturer>/<device_type>/<device>,<subdevice>.csv */
+typedef struct {
+  uint16_t manufacturer; // 字符串池偏移
+  uint16_t device_type;
+  uint8_t device;
+  uint8_t subdevice;
+} irdb_ident_path_t;
+
+/* 候选遥控器 - 字符串指向索引，索引有效期间可用 */
+typedef struct {
+  const char *manufacturer;
+  const char *device_type;
+  uint8_t device;
+  uint8_t subdevice;
+} irdb_ident_candidate_t;
+
+/* 判断数据是否为识别索引 */
+bool irdb_ident_is_valid(const void *index);
+
+/* 识别 - 按code的协议/设备/子设备二分查找，最多填写max个候选(可能性
+ * 大的在前)，返回候选总数(可大于max)，索引无效返回-EINVAL */
+int irdb_identify(const void *index, const irdb_entry_t *code,
+                  irdb_ident_candidate_t *out, size_t max);
+
+/* 内置索引 - CONFIG_IRDB_IDENT_INDEX构建时生成，未启用返回NULL */
+const void *irdb_ident_builtin(void);
+
+#endif /* IRDB_IDENT_H */
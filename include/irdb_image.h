@@ -0,0 +1,77 @@
+/**
+ * @file irdb_image.h
+ * @brief IRDB二进制镜像 - 构建时由CSV生成，运行时直接引用flash中的数据
+ *
+ * 布局 (小端，2字节对齐):
+ *   irdb_image_header_t
+ *   irdb_entry_t   entries[entry_count]
+ *   uint16_t       hash_slots[index_size]  码值哈希表
+ *   uint16_t       name_slots[index_size]  名称哈希表
+ *   char           names[names_len]        字符串池
+ *
+ * 哈希表与irdb_build_index的算法一致，由scripts/irdb_image.py生成。
+ */
+
+#ifndef IRDB_IMAGE_H
+#define IRDB_IMAGE_H
+
+#include "irdb_protocol.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define IRDB_IMAGE_MAGIC 0x42445249 // "IRDB"
+#define IRDB_IMAGE_VERSION 1
+#define IRDB_IMAGE_LZ_MAGIC 0x5A445249 // "IRDZ"
+
+/* 镜像头 */
+typedef struct {
+  uint32_t magic;       // IRDB_IMAGE_MAGIC
+  uint16_t version;     // IRDB_IMAGE_VERSION
+  uint16_t entry_count; // 条目数
+  uint32_t size;        // 镜像总字节数
+  uint16_t names_len;   // 字符串池字节数
+  uint16_t index_size;  // 哈希表槽位数(2的幂)，0表示无索引
+  uint8_t protocol_count;
+  uint8_t reserved;
+  uint16_t protocols[IRDB_MAX_DB_PROTOCOLS];
+  uint16_t reserved2;
+} irdb_image_header_t;
+
+/* 压缩镜像头 - 之后是整个镜像的LZ流(ir_lz.h)，用于文件和外部flash，
+ * 读入时解压到RAM；直接在内部flash中使用的内置镜像不压缩 */
+typedef struct {
+  uint32_t magic; // IRDB_IMAGE_LZ_MAGIC
+  uint32_t size;  // 解压后的镜像字节数
+} irdb_image_lz_header_t;
+
+/* 判断数据是否为二进制镜像 */
+bool irdb_image_is_valid(const void *data);
+
+/* 打开镜像 - db直接引用镜像数据，不分配内存，不需解析
+ * 镜像须4字节对齐且在db使用期间有效 */
+int irdb_image_open(irdb_database_t *db, const void *data);
+
+/* 按数据库填写镜像头，用于运行时把数据库写成镜像(如flash缓存)
+ * 条目或字符串池超出镜像字段范围时返回-E2BIG */
+int irdb_image_header_init(irdb_image_header_t *hdr,
+                           const irdb_database_t *db);
+
+/* 内置遥控器 - 构建时由CONFIG_IRDB_BUILTIN_DIR下的CSV生成 */
+typedef struct {
+  const char *manufacturer;
+  const char *device_type;
+  uint8_t device;
+  uint8_t subdevice;
+  const void *image;
+} irdb_builtin_remote_t;
+
+/* 查找内置遥控器镜像，未找到返回NULL */
+const void *irdb_builtin_find(const char *manufacturer,
+                              const char *device_type, uint8_t device,
+                              uint8_t subdevice);
+
+/* 按序号获取内置遥控器，越界返回NULL */
+const irdb_builtin_remote_t *irdb_builtin_get(size_t index);
+
+#endif /* IRDB_IMAGE_H */
@@ -0,0 +1,85 @@
+/**
+ * @file irdb_irp.h
+ * @brief IRP协议字节码解释器 - 协议以IRP记法描述，构建时由
+ * scripts/irp_compile.py编译为字节码，运行时编码和解码共用一份程序
+ *
+ * 程序布局 (小端，时长为24位微秒):
+ *   uint8_t flags              IRP_FLAG_*
+ *   uint24 zero_mark, zero_space, one_mark, one_space   位形态<0|1>
+ *   首帧指令 ...
+ *   [IRP_OP_REPEAT 重复码指令 ...]
+ *   IRP_OP_END
+ *
+ * 指令:
+ *   IRP_OP_MARK us24 / IRP_OP_SPACE us24   固定时长
+ *   IRP_OP_EXTENT us24    帧尾space补齐到从本段起点算起的总时长
+ *   IRP_OP_FIELD var width offset   var低2位为IRP_VAR_*，IRP_FIELD_INVERT取反
+ *   IRP_OP_CONST width value32
+ *
+ * 编译器保证电平交替: 位形态为一个mark加一个space，字段前后不会出现
+ * 相邻的同电平时长; 字段之后的space只会出现在段尾(并入帧间隔)。
+ */
+
+#ifndef IRDB_IRP_H
+#define IRDB_IRP_H
+
+#include "irdb_protocol.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define IRP_HEADER_SIZE 13
+#define IRP_PROGRAM_MAX 512 // 单个程序最大字节数
+
+#define IRP_FLAG_MSB 0x01         // 字段高位先发 (默认低位先发)
+#define IRP_FLAG_REPEAT 0x02      // 有重复码段
+#define IRP_FLAG_REPEAT_DATA 0x04 // 重复码段含字段 (完整帧，非短重复码)
+
+enum {
+  IRP_OP_END,
+  IRP_OP_MARK,
+  IRP_OP_SPACE,
+  IRP_OP_EXTENT,
+  IRP_OP_FIELD,
+  IRP_OP_CONST,
+  IRP_OP_REPEAT,
+};
+
+enum {
+  IRP_VAR_D, // device
+  IRP_VAR_S, // subdevice
+  IRP_VAR_F, // function
+  IRP_VAR_T, // toggle
+};
+
+#define IRP_FIELD_INVERT 0x80
+#define IRP_FIELD_VAR_MASK 0x03
+
+/* 注册构建时生成的全部协议 (CONFIG_IRDB_IRP_PROTOCOLS) - 编号已被占用的
+ * 跳过，重复调用不会重复注册，返回本次注册数 */
+int irdb_irp_register_builtin(void);
+
+/* 检查程序结构 (指令、字段宽度、结尾)，注册自定义IRP协议时调用 */
+int irdb_irp_check(const uint8_t *program);
+
+/* 编码首帧或重复码段 - 帧尾space不输出(并入帧间隔)。没有重复码段
+ * 或重复码段含字段(同首帧重发)时repeat返回-ENOTSUP */
+int irdb_irp_encode(const irdb_protocol_params_t *params,
+                    const irdb_entry_t *entry, uint8_t toggle, bool repeat,
+                    ir_timing_t *timings_out, uint32_t *length_out,
+                    uint32_t max_length);
+
+/* 解码一帧 - 先按首帧匹配，重复码段含字段时再按重复码段匹配。同一变量
+ * 多次出现(如~F)须一致; toggle_out无T字段时为IRDB_TOGGLE_NONE */
+int irdb_irp_decode(const irdb_protocol_params_t *params,
+                    const ir_timing_t *timings, uint32_t length,
+                    irdb_entry_t *code_out, int *toggle_out);
+
+/* 是否为不含字段的短重复码 */
+bool irdb_irp_is_repeat(const irdb_protocol_params_t *params,
+                        const ir_timing_t *timings, uint32_t length);
+
+/* 帧内最长的space(us)，不含段尾并入帧间隔的部分 */
+uint32_t irdb_irp_longest_space(const irdb_protocol_params_t *params);
+
+#endif /* IRDB_IRP_H */
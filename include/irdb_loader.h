@@ -23,10 +23,10 @@ void irdb_build_path(char *path_out, size_t path_size, const char *manufacturer,
                      const char *device_type, uint8_t device,
                      uint8_t subdevice);
 
-/* 从嵌入式数据加载 */
-int irdb_load_embedded(irdb_database_t *db, const char *csv_data);
+/* 从嵌入式数据加载 - CSV文本或二进制镜像(irdb_image.h) */
+int irdb_load_embedded(irdb_database_t *db, const void *data);
 
-/* 从文件系统加载 */
+/* 从文件系统加载 - CSV或irdb_store保存的二进制镜像，按文件头识别 */
 int irdb_load_from_file(irdb_database_t *db, const char *filepath);
 
 /* 从HTTP加载（需要网络支持） */
@@ -34,18 +34,123 @@ int irdb_load_from_http(irdb_database_t *db, const char *manufacturer,
                         const char *device_type, uint8_t device,
                         uint8_t subdevice);
 
-/* 缓存管理 */
+/* HTTP缓存校验信息 (ETag / Last-Modified响应头) */
 typedef struct {
-  char path[128];
+  char etag[64];
+  char last_modified[32];
+  uint32_t version; // 增量更新清单中的版本(irdb_delta.h)，0为未知
+} irdb_http_validator_t;
+
+/* 服务器返回304，本地副本仍有效 */
+#define IRDB_HTTP_NOT_MODIFIED 1
+
+/* 响应体分片回调，返回负数时不再接收后续分片 */
+typedef int (*irdb_http_body_cb_t)(const uint8_t *data, size_t len,
+                                   void *user_data);
+
+/* 从IRDB CDN下载url(主机内的路径)，复用持久连接。validator非空时
+ * 发送条件请求并更新为新响应的值(version不变)。返回0(200，响应体已
+ * 交给body)、IRDB_HTTP_NOT_MODIFIED、-ENOENT(404)或其他负错误码 */
+int irdb_http_get(const char *url, irdb_http_validator_t *validator,
+                  irdb_http_body_cb_t body, void *user_data);
+
+/* 条件请求加载 - validator非空时携带If-None-Match/If-Modified-Since，
+ * 返回IRDB_HTTP_NOT_MODIFIED时db未被填充；成功时validator更新为新响应的值 */
+int irdb_load_from_http_cond(irdb_database_t *db, const char *manufacturer,
+                             const char *device_type, uint8_t device,
+                             uint8_t subdevice,
+                             irdb_http_validator_t *validator);
+
+/* 缓存管理 - 按字节预算淘汰，条目数量不固定；条目带引用计数，
+ * 被引用的数据库不会被淘汰释放 */
+#ifdef CONFIG_IRDB_CACHE_BYTES
+#define IRDB_CACHE_BYTES CONFIG_IRDB_CACHE_BYTES
+#else
+#define IRDB_CACHE_BYTES 8192
+#endif
+
+/* 键索引容量(2的幂)，装载因子不超过1/2 */
+#define IRDB_CACHE_INDEX_SIZE 64
+#define IRDB_CACHE_MAX_ENTRIES (IRDB_CACHE_INDEX_SIZE / 2)
+
+/* 缓存键 - 遥控器四元组加来源，哈希一次后开放寻址查找 */
+typedef struct {
+  const char *manufacturer;
+  const char *device_type;
+  uint8_t device;
+  uint8_t subdevice;
+  uint8_t source; // irdb_load_method_t
+} irdb_cache_key_t;
+
+typedef struct irdb_cache_entry {
+  struct irdb_cache_entry *next; // 待释放链
   irdb_database_t database;
-  uint32_t last_access;
-  bool valid;
+  size_t cost;          // 计入预算的字节数(条目+字符串池+索引+节点)
+  uint32_t last_access; // 访问序号，按差值比较，回绕安全
+  uint32_t hash;        // 键哈希
+  uint16_t refs;        // 未释放的引用数
+  bool valid; // 可被查找命中；清空时仍被引用的条目置false，最后释放时回收
+  uint8_t device;
+  uint8_t subdevice;
+  uint8_t source;
+  char key[]; // manufacturer和device_type，以'\0'分隔
 } irdb_cache_entry_t;
 
-#define IRDB_CACHE_SIZE 4
+/* 键哈希 (FNV-1a)，flash缓存也以此命名文件 */
+uint32_t irdb_cache_key_hash(const irdb_cache_key_t *key);
+
+/* 命中时增加引用计数，用完后须调用irdb_cache_release */
+int irdb_cache_get(const irdb_cache_key_t *key, irdb_database_t **db_out);
+
+/* 转移数据库所有权到缓存(不拷贝)，成功后db被清零；db_out非NULL时返回
+ * 缓存中的数据库并持有一个引用。按LRU淘汰未被引用的条目直到预算
+ * 足够，仍不够时返回-EBUSY，数据库大于整个预算时返回-ENOMEM */
+int irdb_cache_put(const irdb_cache_key_t *key, irdb_database_t *db,
+                   irdb_database_t **db_out);
 
-int irdb_cache_get(const char *path, irdb_database_t **db_out);
-int irdb_cache_put(const char *path, const irdb_database_t *db);
+/* 释放irdb_cache_get/irdb_cache_put取得的引用 */
+void irdb_cache_release(const irdb_database_t *db);
+
+/* 清空缓存 - 仍被引用的条目在最后一次释放时回收 */
 void irdb_cache_clear(void);
 
+/* 缓存占用字节数 */
+size_t irdb_cache_used(void);
+
+/* 缓存统计 - 累计值，清空缓存不归零 */
+typedef struct {
+  uint32_t hits;      // irdb_cache_get命中
+  uint32_t misses;    // irdb_cache_get未命中
+  uint32_t evictions; // 按LRU淘汰(同键替换和清空不计)
+} irdb_cache_stats_t;
+
+void irdb_cache_get_stats(irdb_cache_stats_t *stats);
+
+/* HTTP遥控器两级加载 - 先查flash缓存(irdb_flash_cache.h)，按ETag/
+ * Last-Modified条件请求校验，离线时使用flash副本；下载结果写回flash。
+ * 返回0表示从网络下载，IRDB_LOADED_FROM_FLASH表示使用flash副本 */
+#define IRDB_LOADED_FROM_FLASH 2
+
+int irdb_load_http_cached(const irdb_cache_key_t *key, irdb_database_t *db);
+
+/* 批量预取 - 复用同一持久连接依次下载，结果写入RAM和flash缓存 */
+typedef struct {
+  uint16_t fetched;    // 从网络下载
+  uint16_t from_flash; // flash副本(304或离线)
+  uint16_t cached;     // 已在RAM缓存中
+  uint16_t failed;
+  uint32_t total_ms; // 总耗时
+  uint32_t max_ms;   // 单个遥控器最长耗时
+} irdb_prefetch_stats_t;
+
+/* 进度回调 - 每个遥控器完成后调用，result为负errno或上述返回值 */
+typedef void (*irdb_prefetch_cb_t)(size_t index, size_t count,
+                                   const irdb_cache_key_t *key, int result,
+                                   void *user_data);
+
+/* 返回失败的遥控器数量；stats可为NULL */
+int irdb_prefetch(const irdb_cache_key_t *keys, size_t count,
+                  irdb_prefetch_cb_t cb, void *user_data,
+                  irdb_prefetch_stats_t *stats);
+
 #endif /* IRDB_LOADER_H */
\ No newline at end of file
@@ -0,0 +1,52 @@
+/**
+ * @file irdb_pronto.h
+ * @brief Pronto hex编解码 - 集成商之间交换IR码的通用格式
+ *
+ * 学习码(0000)布局，每个字为4位十六进制:
+ *   0000 FFFF OOOO RRRR  once[2*OOOO]  repeat[2*RRRR]
+ *   FFFF: 频率字，载波周期 = FFFF * 0.241246us
+ *   OOOO/RRRR: 单次序列/重复序列的mark/space对数
+ *   once/repeat: 以载波周期计的mark/space时长，每个序列以lead-out间隔结束
+ * 按住按键时单次序列发送一次，之后循环发送重复序列；单次序列为空时直接
+ * 循环重复序列。
+ */
+
+#ifndef IRDB_PRONTO_H
+#define IRDB_PRONTO_H
+
+#include "irdb_protocol.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define IRDB_PRONTO_CLOCK_HZ 4145146 // 1 / 0.241246us，频率字的基准
+
+/* 解析结果 */
+typedef struct {
+  uint32_t carrier_freq; // 载波频率(Hz)
+  uint16_t freq_word;    // 原始频率字
+  uint16_t once_length;  // 单次序列时长个数 (2 * 对数)
+  uint16_t repeat_length; // 重复序列时长个数，紧随单次序列之后
+} irdb_pronto_info_t;
+
+/* 解析Pronto学习码，periods_out输出以载波周期计的时长 (单次序列在前)
+ * 只读取len字节内的内容；非0000格式返回-ENOTSUP */
+int irdb_pronto_parse(const char *pronto, size_t len, uint16_t *periods_out,
+                      uint32_t max_length, irdb_pronto_info_t *info);
+
+/* 解析并换算为微秒时序 */
+int irdb_pronto_to_raw(const char *pronto, size_t len,
+                       ir_timing_t *timings_out, uint32_t max_length,
+                       irdb_pronto_info_t *info);
+
+/* 微秒时序生成Pronto学习码。奇数长度的序列(以mark结束)补一个lead_out_us
+ * 的间隔，偶数长度的序列把lead_out_us并入最后一个间隔。返回写入的字符数 */
+int irdb_pronto_from_raw(const ir_timing_t *once, uint32_t once_length,
+                         const ir_timing_t *repeat, uint32_t repeat_length,
+                         uint32_t carrier_freq, uint32_t lead_out_us,
+                         char *buf, size_t size);
+
+/* IRDB条目生成Pronto学习码 - 有重复码的协议以完整帧为单次序列、重复码为
+ * 重复序列，其余协议只有重复序列；lead-out按协议的重复间隔计算 */
+int irdb_encode_pronto(const irdb_entry_t *entry, char *buf, size_t size);
+
+#endif /* IRDB_PRONTO_H */
@@ -8,7 +8,9 @@
 #ifndef IRDB_PROTOCOL_H
 #define IRDB_PROTOCOL_H
 
+#include "ir_timing.h"
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 
@@ -25,27 +27,122 @@ typedef enum {
   IRDB_PROTOCOL_SAMSUNG36 = 21,
 } irdb_protocol_id_t;
 
+#define IRDB_PROTOCOL_MAX_ID 31 // 协议编号上限(含自定义协议)
+
+/* 功能名称 - 存放在数据库的字符串池中，条目只保存偏移 */
+#define IRDB_NAME_MAX 32          // 功能名称最大长度(含结束符)
+#define IRDB_NAME_POOL_MAX 0xFFFF // 字符串池上限(16位偏移)
+#define IRDB_NAME_NONE 0xFFFF     // 解码出的码值未关联数据库，没有名称
+
 /* IRDB条目 */
 typedef struct {
-  char function_name[32]; // 功能名称 (如 "Power", "Vol+")
-  uint16_t protocol;      // 协议编号
-  uint16_t device;        // 设备码
-  uint16_t subdevice;     // 子设备码
-  uint16_t function;      // 功能码
+  uint16_t name;     // 功能名称在db->names中的偏移 (如 "Power", "Vol+")
+  uint16_t protocol; // 协议编号
+  uint16_t device;    // 设备码
+  uint16_t subdevice; // 子设备码
+  uint16_t function;  // 功能码
 } irdb_entry_t;
 
+#define IRDB_MAX_DB_PROTOCOLS 8 // 单个数据库最多索引的协议数
+
+/* 数据库内存区 - 条目和索引顺序分配，释放时整体回退 (后进先出) */
+typedef struct {
+  uint8_t *base;
+  size_t size;
+  size_t used;
+} irdb_arena_t;
+
 /* IRDB数据库 */
 typedef struct {
   char manufacturer[64]; // 制造商
   char device_type[64];  // 设备类型
   irdb_entry_t *entries; // 条目数组
   uint32_t entry_count;  // 条目数量
+  char *names;           // 功能名称字符串池 (以'\0'分隔)
+  uint32_t names_len;    // 字符串池已用字节
+
+  /* 查找索引 (由irdb_build_index生成) */
+  uint16_t protocols[IRDB_MAX_DB_PROTOCOLS]; // 库中出现的协议
+  uint8_t protocol_count;                    // 协议数量
+  uint16_t *hash_slots; // 码值哈希表，存条目下标+1 (0为空)
+  uint16_t *name_slots; // 名称哈希表(不区分大小写)，与hash_slots同一分配
+  uint32_t hash_mask;   // 哈希表容量-1
+  /* 按名称排序(不区分大小写，同名按下标)的条目下标，前缀查找用
+   * (由irdb_build_name_order生成)。总在数据库堆中，各种库都单独归还 */
+  uint16_t *name_order;
+
+  /* 非NULL时条目、名称和索引直接引用只读镜像，释放时无需归还 */
+  const void *image;
+  /* 非NULL时镜像位于数据库堆中的这块内存(如外部flash镜像库读入的)，
+   * 释放时归还 */
+  void *image_buf;
+
+  /* 非NULL时条目、名称和索引位于arena中，释放时回退到arena_mark */
+  irdb_arena_t *arena;
+  size_t arena_mark;
 } irdb_database_t;
 
+/* 位编码方式 */
+typedef enum {
+  IRDB_CODING_PULSE_DISTANCE, // 固定mark，space长短表示位值 (NEC/Samsung)
+  IRDB_CODING_PULSE_WIDTH,    // mark长短表示位值 (Sony)
+  IRDB_CODING_BIPHASE,        // 曼彻斯特编码 (RC5)
+  IRDB_CODING_RC6,            // RC6模式0: 起始位+模式位+双宽toggle位+曼彻斯特数据
+  IRDB_CODING_IRP,            // IRP字节码 (见irdb_irp.h)
+} irdb_coding_t;
+
+/* 解码时序容差(%) - 接收头经ir_calib补偿后可以收紧 */
+#ifdef CONFIG_IRDB_TIMING_TOLERANCE
+#define IRDB_TIMING_TOLERANCE CONFIG_IRDB_TIMING_TOLERANCE
+#else
+#define IRDB_TIMING_TOLERANCE 20
+#endif
+
+/* 遥控器时钟偏差(%) - 解码前按引导码(无引导码时按首部的位单元)估计整帧
+ * 的时间缩放，归一化后再按IRDB_TIMING_TOLERANCE判定。0为不归一化 */
+#ifdef CONFIG_IRDB_CLOCK_DRIFT
+#define IRDB_CLOCK_DRIFT CONFIG_IRDB_CLOCK_DRIFT
+#else
+#define IRDB_CLOCK_DRIFT 10
+#endif
+
+/* 可替换为自适应窗口的协议数 (见irdb_adapt_windows) */
+#ifdef CONFIG_IRDB_ADAPT_PROTOCOLS
+#define IRDB_ADAPT_PROTOCOLS CONFIG_IRDB_ADAPT_PROTOCOLS
+#else
+#define IRDB_ADAPT_PROTOCOLS 4
+#endif
+
+/* 自适应窗口的时长类别 */
+enum {
+  IRDB_ADAPT_HEADER_MARK,
+  IRDB_ADAPT_HEADER_SPACE,
+  IRDB_ADAPT_BIT_MARK, // 双相/RC6为半位，mark和space都计入
+  IRDB_ADAPT_BIT_0,
+  IRDB_ADAPT_BIT_1,
+  IRDB_ADAPT_CLASSES
+};
+
+/* 一帧的时长分布 - 按整帧缩放归一化后各类别的最短和最长(us)，
+ * hi_us为0的类别本帧没有 */
+typedef struct {
+  uint16_t scale; // Q12定点的缩放，4096为不缩放
+  uint16_t lo_us[IRDB_ADAPT_CLASSES];
+  uint16_t hi_us[IRDB_ADAPT_CLASSES];
+} irdb_timing_profile_t;
+
+/* 自适应窗口 [lo_us, hi_us]，hi_us为0的类别保持标称窗口 */
+typedef struct {
+  uint16_t lo_us;
+  uint16_t hi_us;
+} irdb_window_t;
+
 /* 协议参数表 */
 typedef struct {
   irdb_protocol_id_t protocol_id;
   const char *name;
+  uint8_t coding;         // irdb_coding_t
+  bool function_inverse;  // 功能码后附加8位反码 (NEC1)
   uint32_t frequency;     // 载波频率(Hz)
   uint32_t duty_cycle;    // 占空比(%)
   uint32_t header_mark;   // 引导标记(us)
@@ -54,33 +151,270 @@ typedef struct {
   uint32_t bit_0_space;   // 0位间隔(us)
   uint32_t bit_1_space;   // 1位间隔(us)
   uint32_t trailer_mark;  // 结束标记(us)
-  uint32_t gap;           // 重复间隔(us)
+  uint32_t gap;           // 帧周期(us): 帧起点到下一帧起点
+  uint32_t repeat_space;  // 重复码引导间隔(us)，0表示无重复码
+  uint32_t sync_space;    // 帧中同步间隔(us)，0表示无 (Samsung36)
+  uint8_t sync_bit;       // 同步脉冲插在第几位之前
   uint8_t device_bits;    // 设备码位数
   uint8_t subdevice_bits; // 子设备码位数
   uint8_t function_bits;  // 功能码位数
   bool toggle_bit;        // 是否有toggle位
+  uint8_t min_frames;     // 最少连续发送帧数，0不限 (Sony设备收齐3帧才响应)
+  const uint8_t *program; // IRP字节码 (IRDB_CODING_IRP)，其余编码为NULL
 } irdb_protocol_params_t;
 
-/* 协议参数查询 */
+/* 发送帧数 - 请求的帧数不足协议要求时补足 */
+static inline uint32_t irdb_send_frames(const irdb_protocol_params_t *params,
+                                        uint32_t repeat) {
+  return repeat < params->min_frames ? params->min_frames : repeat;
+}
+
+/* 协议参数查询 - O(1)，按协议编号直接索引 */
 const irdb_protocol_params_t *
 irdb_get_protocol_params(irdb_protocol_id_t protocol);
 
-/* CSV解析 */
+/* 注册自定义协议 (编号须未被占用且不超过IRDB_PROTOCOL_MAX_ID)
+ * params需长期有效，应在初始化阶段、收发开始前调用 */
+int irdb_register_protocol(const irdb_protocol_params_t *params);
+
+/* 初始化内存区 */
+void irdb_arena_init(irdb_arena_t *arena, void *buf, size_t size);
+
+/* CSV解析 - 先统计行数，条目数组只分配一次 */
 int irdb_parse_csv(const char *csv_data, irdb_database_t *db);
 
+/* CSV解析到调用者提供的内存区 (不使用堆) */
+int irdb_parse_csv_into(irdb_arena_t *arena, const char *csv_data,
+                        irdb_database_t *db);
+
+/* 流式CSV解析 - 分块输入(文件/HTTP/UART)，跨块的半行被暂存 */
+#define IRDB_PARSER_LINE_MAX 128 // 单行最大长度
+
+typedef struct {
+  irdb_database_t *db;
+  uint32_t capacity;                // 条目数组容量
+  uint32_t names_cap;               // 字符串池容量
+  uint32_t lines;                   // 已处理行数
+  char carry[IRDB_PARSER_LINE_MAX]; // 上一块末尾的半行
+  uint16_t carry_len;
+  uint8_t bom_pos; // 已匹配的BOM字节数
+  int error;       // 首个错误
+} irdb_parser_t;
+
+/* 初始化解析器，清空db；arena非NULL时数据分配在arena中
+ * (arena模式下需先irdb_parser_reserve，名称池紧随条目数组之后) */
+int irdb_parser_init(irdb_parser_t *ctx, irdb_database_t *db,
+                     irdb_arena_t *arena);
+
+/* 预留条目容量 (已知行数时避免扩容) */
+int irdb_parser_reserve(irdb_parser_t *ctx, uint32_t count);
+
+/* 输入一块数据 */
+int irdb_parser_feed(irdb_parser_t *ctx, const char *chunk, size_t len);
+
+/* 结束解析并建立索引，失败时释放db */
+int irdb_parser_finish(irdb_parser_t *ctx);
+
+/* 启动以来输入解析器的累计字节数 (所有CSV来源) */
+uint32_t irdb_parser_bytes(void);
+
 /* 释放数据库 */
 void irdb_free_database(irdb_database_t *db);
 
+/* 获取条目的功能名称 (偏移无效时返回空串) */
+const char *irdb_entry_name(const irdb_database_t *db,
+                            const irdb_entry_t *entry);
+
+/* 条目遍历回调 - index为条目下标(即功能编号)，返回非0时停止遍历 */
+typedef int (*irdb_entry_cb_t)(const irdb_database_t *db, uint32_t index,
+                               const irdb_entry_t *entry, void *user_data);
+
+/* 从下标start起依次回调每个条目，不分配内存也不拷贝名称。返回回调的
+ * 非0返回值，遍历完返回0 */
+int irdb_for_each_entry(const irdb_database_t *db, uint32_t start,
+                        irdb_entry_cb_t cb, void *user_data);
+
+/* 依次回调每个名称为function_name(不区分大小写)的条目，按出现顺序。
+ * 有名称索引时只走名称哈希的探测链。返回值同irdb_for_each_entry */
+int irdb_for_each_named(const irdb_database_t *db, const char *function_name,
+                        irdb_entry_cb_t cb, void *user_data);
+
+/* 查找功能编号 (不区分大小写)，返回条目下标或-ENOENT
+ * 编号在数据库释放或重新加载前保持不变 */
+int irdb_find_function_id(const irdb_database_t *db,
+                          const char *function_name);
+
+/* 建立名称序 - 条目下标按名称排序，每条2字节，名称仍在字符串池中。
+ * 已建立时直接返回; 内存不足返回-ENOMEM，前缀查找退化为逐条扫描 */
+int irdb_build_name_order(irdb_database_t *db);
+
+/* 前缀查找游标 - 有名称序时二分定位后顺序读取，按名称顺序给出;
+ * 否则逐条扫描，按下标顺序给出。同名条目只给出下标最小的一个 */
+typedef struct {
+  const irdb_database_t *db;
+  const char *prefix; // 遍历期间须保持有效
+  size_t prefix_len;
+  uint32_t pos;  // 下一个位置 (名称序或条目下标)
+  int32_t last;  // 上一次给出的条目下标，-1为尚未给出
+} irdb_prefix_iter_t;
+
+void irdb_prefix_iter_init(irdb_prefix_iter_t *it, const irdb_database_t *db,
+                           const char *prefix);
+
+/* 取下一个名称以prefix开头(不区分大小写)的条目，返回条目下标，
+ * 没有更多返回-ENOENT */
+int irdb_prefix_iter_next(irdb_prefix_iter_t *it);
+
+/* 按前缀查找 - 跳过前skip个匹配，之后最多回调max个(0不限)，回调返回
+ * 非0时停止。返回回调的次数 */
+int irdb_search_prefix(const irdb_database_t *db, const char *prefix,
+                       uint32_t skip, uint32_t max, irdb_entry_cb_t cb,
+                       void *user_data);
+
+/* 按编号获取条目，编号无效返回NULL */
+const irdb_entry_t *irdb_get_entry(const irdb_database_t *db, int id);
+
 /* 查找功能 */
 const irdb_entry_t *irdb_find_function(const irdb_database_t *db,
                                        const char *function_name);
 
-/* 编码为原始数据 */
-int irdb_encode_to_raw(const irdb_entry_t *entry, uint32_t *timings_out,
+/* 编码为原始数据 - RC5/RC6的toggle位每次调用按协议翻转一次 */
+int irdb_encode_to_raw(const irdb_entry_t *entry, ir_timing_t *timings_out,
+                       uint32_t *length_out, uint32_t max_length);
+
+/* 按给定toggle位(0/1)编码 - 调用者按设备跟踪按键，每次新按下翻转，
+ * 长按的重复帧保持不变; 无toggle位的协议忽略该参数 */
+int irdb_encode_with_toggle(const irdb_entry_t *entry, uint8_t toggle,
+                            ir_timing_t *timings_out, uint32_t *length_out,
+                            uint32_t max_length);
+
+/* 按给定参数编码一帧 - 参数无需注册 (如学习时推断出的协议)，
+ * entry->protocol不使用 */
+int irdb_encode_params(const irdb_protocol_params_t *params,
+                       const irdb_entry_t *entry, uint8_t toggle,
+                       ir_timing_t *timings_out, uint32_t *length_out,
+                       uint32_t max_length);
+
+/* 编码重复码 (引导标记 + 短间隔 + 结束标记)，协议无重复码返回-ENOTSUP */
+int irdb_encode_repeat(const irdb_entry_t *entry, ir_timing_t *timings_out,
                        uint32_t *length_out, uint32_t max_length);
 
-/* 解码原始数据 */
-int irdb_decode_from_raw(const irdb_database_t *db, const uint32_t *timings,
+/* 判断原始时序是否为指定协议的重复码 */
+bool irdb_is_repeat_frame(uint16_t protocol, const ir_timing_t *timings,
+                          uint32_t length);
+
+/* 时序质量0~100 - 各时长与协议标称时长的平均吻合度，100为完全吻合，
+ * 0为处在解码容差边缘，类似RSSI反映接收距离和角度。IRP协议返回-ENOTSUP，
+ * 没有可计的时长返回-ENODATA */
+int irdb_timing_quality(uint16_t protocol, const ir_timing_t *timings,
+                        uint32_t length);
+
+/* 时长分布 - 按解码时的缩放归一化，mark和space分别归入标称窗口含它且
+ * 离中心最近的类别，帧间隔等不在窗口内的不计。供服务层统计实际遥控器
+ * 的时序。IRP协议返回-ENOTSUP，没有可计的时长返回-ENODATA */
+int irdb_timing_profile(uint16_t protocol, const ir_timing_t *timings,
+                        uint32_t length, irdb_timing_profile_t *out);
+
+/* 替换协议的时序窗口 - 按windows[IRDB_ADAPT_CLASSES]改写对应类别，其余
+ * 窗口(半位倍数、重复码、时钟偏差估计)保持标称。每类限制在标称值加减
+ * 容差与时钟偏差之和内。windows为NULL恢复标称窗口。最多同时替换
+ * IRDB_ADAPT_PROTOCOLS个协议，槽满返回-ENOMEM; IRP协议返回-ENOTSUP。
+ * 调用者之间须串行，且对同一协议两次替换的间隔须长于一次解码 */
+int irdb_adapt_windows(uint16_t protocol, const irdb_window_t *windows);
+
+/* 帧结束判定的静默门限(us) - 帧内任何间隔都短于它、帧间的静默都长于它:
+ * 取帧内最长间隔的2倍与重复间隔的1/10中较大者 (NEC约10.8ms) */
+uint32_t irdb_frame_end_gap(uint16_t protocol);
+
+/* 建立查找索引 (协议列表 + 码值和名称哈希表) */
+int irdb_build_index(irdb_database_t *db);
+
+/* 按码值查找条目 */
+const irdb_entry_t *irdb_lookup_code(const irdb_database_t *db,
+                                     uint16_t protocol, uint16_t device,
+                                     uint16_t subdevice, uint16_t function);
+
+/* 按指定协议解码原始数据，输出协议和码值 (不含功能名) */
+int irdb_decode_protocol(uint16_t protocol, const ir_timing_t *timings,
+                         uint32_t length, irdb_entry_t *code_out);
+
+#define IRDB_TOGGLE_NONE (-1) // 协议没有toggle位
+
+/* 同上，另输出帧中的toggle位 (toggle_out可为NULL) */
+int irdb_decode_with_toggle(uint16_t protocol, const ir_timing_t *timings,
+                            uint32_t length, irdb_entry_t *code_out,
+                            int *toggle_out);
+
+/* 不依赖数据库的解码 - 尝试所有已注册协议，输出时序误差最小的协议
+ * 和码值(name为IRDB_NAME_NONE)。用于嗅探未知遥控器、按设备码判断该取
+ * 哪个IRDB文件；查库是可选的第二步(irdb_lookup_code) */
+int irdb_decode_any(const ir_timing_t *timings, uint32_t length,
+                    irdb_entry_t *code_out);
+
+/* 解码原始数据 - 只返回库中有的条目，多个协议都解出库中条目时取时序
+ * 误差最小的 (见irdb_decode_candidates) */
+int irdb_decode_from_raw(const irdb_database_t *db, const ir_timing_t *timings,
                          uint32_t length, irdb_entry_t *entry_out);
 
+/* 解码候选 - 帧结构相同的协议(NEC1与Samsung32的位时序、NEC1与NEC2的
+ * 地址解释)可能同时解出，按解出的码值重新编码后与本帧逐个时长比较:
+ * error为各时长相对误差(%)之和(缺少或多出的时长各计100，两边末尾的帧
+ * 间隔不计)，confidence为100减平均误差 */
+#define IRDB_MAX_CANDIDATES 4
+
+typedef struct {
+  irdb_entry_t entry; // 库中条目，或库中没有时的码值(name为IRDB_NAME_NONE)
+  uint32_t error;
+  uint8_t confidence; // 0~100
+  bool in_db;
+  int8_t toggle; // IRDB_TOGGLE_NONE为协议没有toggle位
+} irdb_candidate_t;
+
+/* 按给定协议各解码一次，按误差从小到大输出前max个码值(in_db为false)。
+ * protocols为NULL时尝试全部已注册协议。返回候选数，都解不出返回-ENOENT */
+int irdb_decode_ranked(const uint16_t *protocols, size_t protocol_count,
+                       const ir_timing_t *timings, uint32_t length,
+                       irdb_candidate_t *out, size_t max);
+
+/* 同上，用数据库的协议并查表 - 误差相同时库中的条目排在前面 */
+int irdb_decode_candidates(const irdb_database_t *db,
+                           const ir_timing_t *timings, uint32_t length,
+                           irdb_candidate_t *out, size_t max);
+
+/* 流式解码 - 逐个脉冲输入，最后一位/结束标记到达即出结果 */
+#define IRDB_STREAM_IDLE_US 20000 // space超过该值视为帧边界
+
+typedef enum {
+  IRDB_STREAM_HEADER,  // 等待引导码
+  IRDB_STREAM_DATA,    // 接收数据位
+  IRDB_STREAM_TRAILER, // 等待结束标记
+} irdb_stream_state_t;
+
+typedef struct {
+  const irdb_protocol_params_t *params;
+  uint16_t protocol;
+  uint8_t state;      // irdb_stream_state_t
+  uint8_t total_bits; // 码字总位数
+  uint8_t bits;       // 已解码位数
+  bool have_first;    // 是否已有配对中的前一个脉冲
+  bool repeat;        // 当前帧为重复码
+  bool synced;        // 已通过帧中同步脉冲
+  uint16_t scale;     // 由引导码估计的时间缩放 (Q12，4096为1)
+  uint32_t first;     // 配对中的前一个脉冲(us，已缩放)
+  uint64_t code;      // 已解码码字
+} irdb_stream_decoder_t;
+
+/* 初始化指定协议的流式解码器 */
+int irdb_stream_init(irdb_stream_decoder_t *dec, uint16_t protocol);
+
+/* 复位到等待帧起点 */
+void irdb_stream_reset(irdb_stream_decoder_t *dec);
+
+#define IRDB_STREAM_REPEAT 2 // irdb_stream_feed: 收到重复码
+
+/* 输入一个脉冲 - 返回1表示完成(code_out有效)，IRDB_STREAM_REPEAT表示重复码
+ * (仅code_out->protocol有效)，0继续，-ENOENT本帧不匹配 */
+int irdb_stream_feed(irdb_stream_decoder_t *dec, uint32_t duration_us,
+                     bool is_mark, irdb_entry_t *code_out);
+
 #endif /* IRDB_PROTOCOL_H */
\ No newline at end of file
@@ -0,0 +1,77 @@
+/**
+ * @file irdb_store.h
+ * @brief 数据库存储 - 流式上传的CSV编译为二进制镜像，按名称存于LittleFS
+ *
+ * 上传会话把CSV分块送入流式解析器，CSV本身从不整体缓存，RAM中只有编译
+ * 后的条目、字符串池和索引(约为CSV的三分之一); 结束时写成二进制镜像
+ * (irdb_image.h布局)，之后加载只需读入，不再解析和建索引。
+ * 存储文件为IRDB_STORE_DIR/<名称>.img，写入先落到临时文件再改名。
+ * irdb_load_from_file按文件头自动识别镜像和CSV。
+ */
+
+#ifndef IRDB_STORE_H
+#define IRDB_STORE_H
+
+#include "irdb_protocol.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef CONFIG_IRDB_STORE_DIR
+#define IRDB_STORE_DIR CONFIG_IRDB_STORE_DIR
+#else
+#define IRDB_STORE_DIR "/lfs/irdb"
+#endif
+
+#define IRDB_STORE_NAME_MAX 32 // 存储名称最大长度(含结束符)
+#define IRDB_STORE_HEX_CHUNK 96 // shell "ir store hex"一行的最大字节数
+
+/* 上传会话 */
+typedef struct {
+  irdb_parser_t parser;
+  irdb_database_t db;
+  uint32_t bytes;      // 已输入的CSV字节数
+  uint32_t entries;    // 结束时的条目数
+  int64_t start_ms;    // irdb_upload_begin时刻
+  uint32_t elapsed_ms; // 开始到结束(含写入)
+  bool active;
+} irdb_upload_t;
+
+/* 开始上传 - 清空会话中的数据库 */
+int irdb_upload_begin(irdb_upload_t *up);
+
+/* 输入一块CSV，块边界可在行中间 */
+int irdb_upload_feed(irdb_upload_t *up, const void *chunk, size_t len);
+
+/* 结束解析并建立索引 - 成功后up->db归调用者(加入活动集或保存后释放) */
+int irdb_upload_end(irdb_upload_t *up);
+
+/* 结束并保存为name - 保存后释放数据库 */
+int irdb_upload_save(irdb_upload_t *up, const char *name);
+
+/* 放弃上传，释放已解析的条目 */
+void irdb_upload_abort(irdb_upload_t *up);
+
+/* 吞吐 (字节/秒)，以开始到结束的时长计 */
+uint32_t irdb_upload_rate(const irdb_upload_t *up);
+
+/* 保存/加载/删除已编译的数据库 */
+int irdb_store_save(const char *name, const irdb_database_t *db);
+int irdb_store_load(const char *name, irdb_database_t *db);
+int irdb_store_delete(const char *name);
+
+/* 列出已存储的数据库 ("名称 条目数 字节数"，每行一个)，返回个数 */
+int irdb_store_list(char *buf, size_t buf_size);
+
+/* 镜像文件读写 - file位于镜像头处，flash缓存在自己的文件头之后共用 */
+struct fs_file_t;
+
+/* CONFIG_IR_STORAGE_COMPRESS时写成压缩镜像(irdb_image_lz_header_t + LZ流) */
+int irdb_image_write_file(struct fs_file_t *file, const irdb_database_t *db);
+
+/* 条目、索引和字符串池分别读入堆，与irdb_free_database的释放方式一致;
+ * 压缩镜像直接解压到堆中的一块镜像缓冲并原地打开。
+ * 镜像头无效或长度不符返回-EINVAL，截断返回-EIO */
+int irdb_image_read_file(struct fs_file_t *file, irdb_database_t *db);
+
+#endif /* IRDB_STORE_H */
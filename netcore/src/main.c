@@ -0,0 +1,227 @@
+/**
+ * @file main.c
+ * @brief nRF5340网络核接收引擎 - 采集边沿，成批经ipc_service送往应用核
+ *
+ * ir_hal.c以CONFIG_IR_HAL_IPC_ENGINE编译(只有接收部分)，本文件用一个订阅
+ * 者采集应用核要求的通道，脉冲攒成批次发出; 应用核的接收控制和查询在
+ * 端点回调中直接调用对应的ir_hal接口并应答。格式见ir_hal_ipc.h。
+ */
+
+#include "ir_hal.h"
+#include "ir_hal_ipc.h"
+#include <string.h>
+#include <zephyr/ipc/ipc_service.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(ir_netcore, LOG_LEVEL_INF);
+
+#define IPC_NODE DT_NODELABEL(ipc0)
+
+static struct ipc_ept ept;
+static atomic_t ept_ready;
+
+/* 采集应用核要求的通道的订阅者，无通道时取消 */
+static int rx_sub = -1;
+
+/* 批次 - 消费线程追加，攒批超时由系统工作队列发出 */
+static K_MUTEX_DEFINE(batch_lock);
+static uint8_t batch_buf[IR_HAL_IPC_BATCH_SIZE] __aligned(8);
+static ir_hal_ipc_batch_t *const batch = (ir_hal_ipc_batch_t *)batch_buf;
+static uint32_t batch_dropped;
+static struct k_work_delayable batch_flush_work;
+
+/* 发出当前批次 - 持batch_lock。共享内存环满时丢弃本批并计数 */
+static void batch_send(void) {
+  if (batch->hdr.count == 0) {
+    return;
+  }
+
+  batch->hdr.op = IR_HAL_IPC_PULSES;
+  batch->hdr.seq = 0;
+  batch->dropped = batch_dropped;
+  batch->sent_us = k_ticks_to_us_floor64(k_uptime_ticks());
+
+  size_t len = sizeof(*batch) + batch->hdr.count * sizeof(batch->pulses[0]);
+  if (!atomic_get(&ept_ready) || ipc_service_send(&ept, batch, len) < 0) {
+    batch_dropped += batch->hdr.count;
+  }
+  batch->hdr.count = 0;
+}
+
+static void batch_flush_handler(struct k_work *work) {
+  k_mutex_lock(&batch_lock, K_FOREVER);
+  batch_send();
+  k_mutex_unlock(&batch_lock);
+}
+
+/* 订阅回调 - 帧结束和批满立即发出，否则首个脉冲起最多攒
+ * IR_HAL_IPC_FLUSH_US */
+static void rx_pulse(ir_pulse_t *pulse, void *user_data) {
+  k_mutex_lock(&batch_lock, K_FOREVER);
+
+  ir_hal_ipc_pulse_t *out = &batch->pulses[batch->hdr.count++];
+  out->timestamp_us = pulse->timestamp_us;
+  out->duration_us = pulse->duration_us;
+  out->channel = pulse->channel;
+  out->flags = (pulse->is_mark ? IR_HAL_IPC_MARK : 0) |
+               (pulse->frame_end ? IR_HAL_IPC_FRAME_END : 0) |
+               (pulse->echo ? IR_HAL_IPC_ECHO : 0);
+  out->reserved = 0;
+
+  if (pulse->frame_end || batch->hdr.count == IR_HAL_IPC_BATCH) {
+    batch_send();
+    k_work_cancel_delayable(&batch_flush_work);
+  } else if (batch->hdr.count == 1) {
+    k_work_schedule(&batch_flush_work, K_USEC(IR_HAL_IPC_FLUSH_US));
+  }
+  k_mutex_unlock(&batch_lock);
+}
+
+/* 采集通道 - 有任一通道的订阅者接收回波时，全部回波都标记送出，由应用
+ * 核按订阅者过滤 */
+static void rx_set_channels(uint8_t channels, uint8_t echo) {
+  channels &= IR_HAL_RX_CH_ALL;
+
+  if (channels == 0) {
+    if (rx_sub >= 0) {
+      ir_hal_rx_unsubscribe(rx_sub);
+      rx_sub = -1;
+    }
+    return;
+  }
+
+  if (rx_sub < 0) {
+    rx_sub = ir_hal_rx_subscribe(channels, rx_pulse, NULL);
+    if (rx_sub < 0) {
+      return;
+    }
+  } else {
+    ir_hal_rx_set_channels(rx_sub, channels);
+  }
+  ir_hal_rx_set_echo(rx_sub, echo != 0);
+}
+
+static void reply(uint8_t seq, int32_t ret, const void *data, size_t size) {
+  union {
+    ir_hal_ipc_reply_t reply;
+    uint8_t buf[sizeof(ir_hal_ipc_reply_t) +
+                MAX(sizeof(ir_hal_rx_stats_t), sizeof(ir_carrier_t))];
+  } msg;
+
+  size = MIN(size, sizeof(msg.buf) - sizeof(msg.reply));
+  msg.reply.hdr.op = IR_HAL_IPC_REPLY;
+  msg.reply.hdr.seq = seq;
+  msg.reply.hdr.count = size;
+  msg.reply.ret = ret;
+  if (size > 0) {
+    memcpy(msg.reply.data, data, size);
+  }
+  ipc_service_send(&ept, &msg, sizeof(msg.reply) + size);
+}
+
+/* 应用核的请求 - 端点回调(IPC工作队列)中执行，均不阻塞 */
+static void ept_received(const void *data, size_t len, void *priv) {
+  const ir_hal_ipc_req_t *req = data;
+
+  if (len < sizeof(*req)) {
+    return;
+  }
+
+  switch (req->hdr.op) {
+  case IR_HAL_IPC_CHANNELS:
+    rx_set_channels(req->arg[0], req->arg[1]);
+    break;
+  case IR_HAL_IPC_ECHO_BEGIN:
+    ir_hal_rx_echo_begin();
+    break;
+  case IR_HAL_IPC_ECHO_END:
+    ir_hal_rx_echo_end();
+    break;
+  case IR_HAL_IPC_FRAME_GAP:
+    ir_hal_rx_set_frame_gap(req->arg[0]);
+    break;
+  case IR_HAL_IPC_INVERTED:
+    ir_hal_rx_set_inverted(req->arg[0]);
+    break;
+  case IR_HAL_IPC_BIAS:
+    ir_hal_rx_set_bias(req->arg[0], (int16_t)(req->arg[1] & 0xFFFF),
+                       (int16_t)(req->arg[1] >> 16));
+    break;
+  case IR_HAL_IPC_IDLE: {
+    uint32_t idle_us = ir_hal_rx_idle_us();
+
+    reply(req->hdr.seq, 0, &idle_us, sizeof(idle_us));
+    break;
+  }
+  case IR_HAL_IPC_STATS: {
+    ir_hal_rx_stats_t stats;
+
+    ir_hal_rx_get_stats(&stats);
+    reply(req->hdr.seq, 0, &stats, sizeof(stats));
+    break;
+  }
+  case IR_HAL_IPC_CARRIER_START:
+    reply(req->hdr.seq, ir_hal_carrier_start(), NULL, 0);
+    break;
+  case IR_HAL_IPC_CARRIER_READ: {
+    ir_carrier_t carrier = {0};
+    int ret = ir_hal_carrier_read(req->arg[0], &carrier);
+
+    reply(req->hdr.seq, ret, &carrier, sizeof(carrier));
+    break;
+  }
+  case IR_HAL_IPC_CARRIER_STOP:
+    reply(req->hdr.seq, ir_hal_carrier_stop(), NULL, 0);
+    break;
+  default:
+    break;
+  }
+}
+
+/* 绑定后通知应用核重发接收配置 (本核重启时应用核的端点仍在) */
+static void ept_bound(void *priv) {
+  ir_hal_ipc_hdr_t ready = {.op = IR_HAL_IPC_READY};
+
+  atomic_set(&ept_ready, 1);
+  ipc_service_send(&ept, &ready, sizeof(ready));
+  LOG_INF("Bound to application core");
+}
+
+static struct ipc_ept_cfg ept_cfg = {
+    .name = IR_HAL_IPC_ENDPOINT,
+    .cb =
+        {
+            .bound = ept_bound,
+            .received = ept_received,
+        },
+};
+
+int main(void) {
+  const struct device *ipc = DEVICE_DT_GET(IPC_NODE);
+  int ret;
+
+  k_work_init_delayable(&batch_flush_work, batch_flush_handler);
+
+  ret = ir_hal_init();
+  if (ret < 0) {
+    LOG_ERR("IR HAL init failed: %d", ret);
+    return ret;
+  }
+
+  ret = ipc_service_open_instance(ipc);
+  if (ret < 0 && ret != -EALREADY) {
+    LOG_ERR("Failed to open IPC instance: %d", ret);
+    return ret;
+  }
+
+  ret = ipc_service_register_endpoint(ipc, &ept, &ept_cfg);
+  if (ret < 0) {
+    LOG_ERR("Failed to register endpoint: %d", ret);
+    return ret;
+  }
+
+  /* 之后只由捕获中断、消费线程和端点回调驱动 */
+  LOG_INF("IR receive engine started, %u channel(s)", IR_HAL_RX_CHANNELS);
+  return 0;
+}
@@ -0,0 +1,360 @@
+/**
+ * @file main.c
+ * @brief 录制回放 - 把.ircap边沿流以最快速度送入解码流水线
+ *
+ * 流水线与ir_service.c相同: 逐沿经帧分离器流式解码所有已注册协议，帧
+ * 结束时仍未出结果的整帧解码兜底。每个录制一行:
+ *   REPLAY <name> frames=<n> edges=<n> ns/edge=<ns> ns/frame=<ns>
+ *          correct=<n> wrong=<n> repeat=<n> failed=<n> accuracy=<%>
+ * 带标注的录制按标注判定正确与否，未标注的只统计解出的帧数。
+ *
+ * 用法 (native_sim):
+ *   zephyr.exe -testargs a.ircap b.ircap   回放文件
+ *   zephyr.exe -testargs --synth out        合成录制写到out-<协议>.ircap
+ *   zephyr.exe                              回放内置的合成录制
+ * 合成录制为各协议的一个按键，带重复码，按接收头的特性加mark展宽和抖动。
+ */
+
+#include "ir_capture.h"
+#include "irdb_demux.h"
+#include "irdb_protocol.h"
+#include <cmdline.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zephyr/kernel.h>
+
+#define REPLAY_MAX_TIMINGS 512 // 与ir_service.c的MAX_RAW_TIMINGS相同
+#define REPLAY_MAX_FILE (1024 * 1024)
+
+#define SYNTH_PRESSES 40      // 每个合成录制的按键次数
+#define SYNTH_REPEATS 2       // 每次按键后的重复码数
+#define SYNTH_MARK_STRETCH 40 // 接收头的mark展宽(us)，space相应缩短
+#define SYNTH_JITTER_US 40    // 每个时长的随机抖动幅度(us)
+
+/* 合成录制的协议和按键 - 有子设备码的协议子设备取设备码 */
+static const irdb_entry_t synth_keys[] = {
+    {.protocol = IRDB_PROTOCOL_NEC1, .device = 4, .function = 8},
+    {.protocol = IRDB_PROTOCOL_NEC2, .device = 4, .function = 11},
+    {.protocol = IRDB_PROTOCOL_SONY12, .device = 1, .function = 21},
+    {.protocol = IRDB_PROTOCOL_RC5, .device = 0, .function = 12},
+    {.protocol = IRDB_PROTOCOL_RC6, .device = 0, .function = 12},
+    {.protocol = IRDB_PROTOCOL_SAMSUNG32, .device = 7, .function = 2},
+};
+
+/* 单个通道的解码状态 */
+typedef struct {
+  irdb_demux_t demux;
+  ir_timing_t timings[REPLAY_MAX_TIMINGS];
+  uint32_t count;
+  bool decoded; // 流式解码已出结果
+  bool repeat;
+  irdb_entry_t code;
+} replay_channel_t;
+
+/* 一个录制的结果 */
+typedef struct {
+  uint32_t frames;
+  uint32_t edges;
+  uint32_t correct;
+  uint32_t wrong;
+  uint32_t repeats;
+  uint32_t failed;
+  uint32_t decoded; // 未标注录制中解出的帧
+} replay_result_t;
+
+static replay_channel_t channels[IR_HAL_RX_CHANNELS_MAX + 1];
+
+static uint64_t replay_now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void channel_init(replay_channel_t *ch) {
+  uint16_t protocols[IRDB_PROTOCOL_MAX_ID + 1];
+
+  memset(ch, 0, sizeof(*ch));
+  for (uint16_t p = 0; p <= IRDB_PROTOCOL_MAX_ID; p++) {
+    protocols[p] = p;
+  }
+  irdb_demux_init(&ch->demux, protocols, ARRAY_SIZE(protocols));
+}
+
+static bool code_matches(const irdb_entry_t *a, const irdb_entry_t *b) {
+  return a->protocol == b->protocol && a->device == b->device &&
+         a->subdevice == b->subdevice && a->function == b->function;
+}
+
+/* 帧结果按标注归类 */
+static void replay_classify(const ir_capture_header_t *hdr,
+                            const replay_channel_t *ch, bool ok,
+                            replay_result_t *result) {
+  const irdb_entry_t *label = &hdr->label;
+
+  result->frames++;
+  if (ok && ch->repeat) {
+    result->repeats++;
+  } else if (!ok) {
+    result->failed++;
+  } else if (label->protocol == IR_CAPTURE_NO_LABEL) {
+    result->decoded++;
+  } else if (code_matches(&ch->code, label)) {
+    result->correct++;
+  } else {
+    result->wrong++;
+  }
+}
+
+/* 帧结束 - 流式解码未出结果时整帧解码 */
+static void replay_frame_end(const ir_capture_header_t *hdr,
+                             replay_channel_t *ch, replay_result_t *result) {
+  bool ok = ch->decoded;
+
+  if (!ok && ch->count > 0) {
+    ch->repeat = false;
+    ok = irdb_decode_any(ch->timings, ch->count, &ch->code) == 0;
+  }
+  if (ch->decoded || ch->count > 0) {
+    replay_classify(hdr, ch, ok, result);
+  }
+
+  ch->decoded = false;
+  ch->count = 0;
+  irdb_demux_reset(&ch->demux);
+}
+
+/* 标注即已加载的遥控器 - 与服务查库一样，流式结果不在库中时换下一个协议
+ * (NEC1/NEC2等同一帧可被多个协议解出) */
+static void replay_pulse(const ir_capture_header_t *hdr, replay_channel_t *ch,
+                         const ir_pulse_t *pulse) {
+  irdb_demux_result_t results[IRDB_DEMUX_RESULTS];
+
+  if (ch->count < REPLAY_MAX_TIMINGS) {
+    ch->timings[ch->count++] = ir_timing_pack(pulse->duration_us);
+  }
+
+  int n = irdb_demux_feed(&ch->demux, pulse->duration_us, pulse->is_mark,
+                          results, ARRAY_SIZE(results));
+  for (int i = 0; i < n && !ch->decoded; i++) {
+    if (!results[i].repeat && hdr->label.protocol != IR_CAPTURE_NO_LABEL &&
+        !code_matches(&results[i].code, &hdr->label)) {
+      continue;
+    }
+    irdb_demux_settle(&ch->demux, &results[i]);
+    ch->code = results[i].code;
+    ch->decoded = true;
+    ch->repeat = results[i].repeat;
+  }
+}
+
+/* 回放一个录制 - 只计解码时间，不计文件读取 */
+static int replay_run(const char *name, const uint8_t *data, size_t len) {
+  ir_capture_header_t hdr;
+  ir_capture_reader_t reader;
+  replay_result_t result = {0};
+  ir_pulse_t pulse;
+  int ret;
+
+  ret = ir_capture_header_parse(data, len, &hdr);
+  if (ret < 0) {
+    printf("%s: not a capture file (%d)\n", name, ret);
+    return ret;
+  }
+
+  for (size_t i = 0; i < ARRAY_SIZE(channels); i++) {
+    channel_init(&channels[i]);
+  }
+  ir_capture_reader_init(&reader, &hdr, data + IR_CAPTURE_HEADER_SIZE,
+                         len - IR_CAPTURE_HEADER_SIZE);
+
+  uint64_t start = replay_now_ns();
+  while ((ret = ir_capture_read(&reader, &pulse)) > 0) {
+    replay_channel_t *ch = &channels[pulse.channel];
+
+    if (pulse.frame_end) {
+      replay_frame_end(&hdr, ch, &result);
+    } else {
+      result.edges++;
+      replay_pulse(&hdr, ch, &pulse);
+    }
+  }
+  uint64_t ns = replay_now_ns() - start;
+
+  if (ret < 0) {
+    printf("%s: record stream corrupt after %u edges\n", name, result.edges);
+  }
+
+  uint32_t judged = result.correct + result.wrong + result.failed;
+  printf("REPLAY %-16s frames=%-5u edges=%-6u ns/edge=%-6llu ns/frame=%-7llu "
+         "correct=%u wrong=%u repeat=%u failed=%u",
+         name, result.frames, result.edges,
+         (unsigned long long)(result.edges ? ns / result.edges : 0),
+         (unsigned long long)(result.frames ? ns / result.frames : 0),
+         result.correct, result.wrong, result.repeats, result.failed);
+  if (hdr.label.protocol == IR_CAPTURE_NO_LABEL) {
+    printf(" decoded=%u (unlabelled)\n", result.decoded);
+  } else {
+    uint32_t x10 = judged ? result.correct * 1000 / judged : 0;
+
+    printf(" accuracy=%u.%u%%\n", x10 / 10, x10 % 10);
+  }
+  return ret;
+}
+
+/* 确定性伪随机抖动 - 各次运行结果可直接对比 */
+static int32_t synth_jitter(uint32_t *seed) {
+  *seed = *seed * 1103515245 + 12345;
+  return (int32_t)((*seed >> 16) % (2 * SYNTH_JITTER_US + 1)) -
+         SYNTH_JITTER_US;
+}
+
+/* 一帧时序写成记录 - 末尾space为帧间隔，HAL不作为脉冲上报，只用来推进
+ * 下一帧的起点；帧结束记录的时间戳为最后一个沿 */
+static size_t synth_frame(const ir_timing_t *timings, uint32_t count,
+                          uint64_t *now_us, uint64_t *prev_us, uint32_t *seed,
+                          uint8_t *out) {
+  uint32_t edges = count % 2 == 0 ? count - 1 : count;
+  size_t len = 0;
+
+  for (uint32_t i = 0; i < edges; i++) {
+    int32_t us = ir_timing_us(timings[i]) + synth_jitter(seed);
+    ir_pulse_t pulse = {.is_mark = i % 2 == 0, .timestamp_us = *now_us};
+
+    us += pulse.is_mark ? SYNTH_MARK_STRETCH : -SYNTH_MARK_STRETCH;
+    pulse.duration_us = MAX(us, IR_HAL_RX_MIN_MARK_US);
+    len += ir_capture_encode(*prev_us, &pulse, out + len);
+    *prev_us = pulse.timestamp_us;
+    *now_us += pulse.duration_us;
+  }
+
+  ir_pulse_t end = {.frame_end = true, .timestamp_us = *now_us};
+  len += ir_capture_encode(*prev_us, &end, out + len);
+  *prev_us = end.timestamp_us;
+
+  *now_us += edges < count ? ir_timing_us(timings[count - 1]) : 40000;
+  return len;
+}
+
+/* 生成一个按键的合成录制，返回字节数 */
+static size_t synth_capture(const irdb_entry_t *key, uint8_t *out,
+                            size_t size) {
+  static ir_timing_t frame[REPLAY_MAX_TIMINGS];
+  static ir_timing_t repeat[REPLAY_MAX_TIMINGS];
+  uint32_t frame_count, repeat_count = 0;
+  irdb_entry_t label = *key;
+  uint32_t seed = key->protocol;
+
+  const irdb_protocol_params_t *params =
+      irdb_get_protocol_params(key->protocol);
+  if (params && params->subdevice_bits > 0) {
+    label.subdevice = label.device;
+  }
+  if (irdb_encode_to_raw(&label, frame, &frame_count, REPLAY_MAX_TIMINGS) <
+      0) {
+    return 0;
+  }
+  irdb_encode_repeat(&label, repeat, &repeat_count, REPLAY_MAX_TIMINGS);
+
+  ir_capture_header_t hdr = {.channels = BIT(0), .label = label};
+  size_t len = ir_capture_header_pack(&hdr, out);
+  uint64_t now_us = 0, prev_us = 0;
+
+  for (int p = 0; p < SYNTH_PRESSES; p++) {
+    size_t need = (frame_count + SYNTH_REPEATS * repeat_count + 3) *
+                  IR_CAPTURE_RECORD_MAX;
+
+    if (len + need > size) {
+      break;
+    }
+    len += synth_frame(frame, frame_count, &now_us, &prev_us, &seed,
+                       out + len);
+    for (int r = 0; r < SYNTH_REPEATS && repeat_count > 0; r++) {
+      len += synth_frame(repeat, repeat_count, &now_us, &prev_us, &seed,
+                         out + len);
+    }
+  }
+  return len;
+}
+
+static uint8_t file_buf[REPLAY_MAX_FILE];
+
+static const char *synth_name(const irdb_entry_t *key) {
+  const irdb_protocol_params_t *params =
+      irdb_get_protocol_params(key->protocol);
+
+  return params && params->name ? params->name : "?";
+}
+
+/* 写出或回放全部合成录制 */
+static int replay_synth(const char *prefix) {
+  int failed = 0;
+
+  for (size_t k = 0; k < ARRAY_SIZE(synth_keys); k++) {
+    const char *name = synth_name(&synth_keys[k]);
+    size_t len = synth_capture(&synth_keys[k], file_buf, sizeof(file_buf));
+
+    if (len == 0) {
+      printf("%s: encode failed\n", name);
+      failed++;
+      continue;
+    }
+    if (!prefix) {
+      failed += replay_run(name, file_buf, len) < 0;
+      continue;
+    }
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s-%s.ircap", prefix, name);
+    FILE *f = fopen(path, "wb");
+    if (!f || fwrite(file_buf, 1, len, f) != len) {
+      printf("%s: write failed\n", path);
+      failed++;
+    } else {
+      printf("%s: %zu bytes\n", path, len);
+    }
+    if (f) {
+      fclose(f);
+    }
+  }
+  return failed;
+}
+
+static int replay_file(const char *path) {
+  FILE *f = fopen(path, "rb");
+
+  if (!f) {
+    printf("%s: cannot open\n", path);
+    return -ENOENT;
+  }
+
+  size_t len = fread(file_buf, 1, sizeof(file_buf), f);
+  fclose(f);
+
+  const char *name = strrchr(path, '/');
+  return replay_run(name ? name + 1 : path, file_buf, len);
+}
+
+int main(void) {
+  int argc = 0;
+  char **argv = NULL;
+  int failed = 0;
+
+  native_get_test_cmd_line_args(&argc, &argv);
+
+  if (argc >= 2 && strcmp(argv[0], "--synth") == 0) {
+    failed = replay_synth(argv[1]);
+  } else if (argc == 0) {
+    printf("Replaying built-in synthetic captures\n");
+    failed = replay_synth(NULL);
+  } else {
+    for (int i = 0; i < argc; i++) {
+      failed += replay_file(argv[i]) < 0;
+    }
+  }
+
+  printf("Replay done%s\n", failed ? " (with errors)" : "");
+  return failed ? 1 : 0;
+}
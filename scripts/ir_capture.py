@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""
+边沿流录制工具 - 从串口日志还原录制文件，查看录制内容
+
+格式见include/ir_capture.h。"ir capture"在shell中输出以"#IRCAP:"开头的
+十六进制行(BEGIN/END之间)，本工具把一次或多次录制拼回.ircap文件，交给
+replay/离线回放。
+
+用法:
+  ir_capture.py extract console.log out.ircap   # 日志中第一段录制
+  ir_capture.py extract console.log out --all   # 每段一个out-N.ircap
+  ir_capture.py dump out.ircap                  # 逐帧列出时序
+"""
+
+import argparse
+import struct
+import sys
+
+MAGIC = b"IRCP"
+VERSION = 1
+HEADER_FMT = "<4sBBHHHHHQ"
+HEADER_SIZE = struct.calcsize(HEADER_FMT)
+NO_LABEL = 0xFFFF
+PREFIX = "#IRCAP:"
+
+
+def extract(lines):
+    """返回日志中每段录制的字节串"""
+    captures = []
+    current = None
+
+    for line in lines:
+        pos = line.find(PREFIX)
+        if pos < 0:
+            continue
+        body = line[pos + len(PREFIX):].strip()
+        if body.startswith("BEGIN"):
+            current = bytearray()
+        elif body.startswith("END"):
+            if current is not None:
+                captures.append(bytes(current))
+            current = None
+        elif current is not None:
+            current += bytes.fromhex(body)
+    return captures
+
+
+def parse_header(data):
+    if len(data) < HEADER_SIZE:
+        raise ValueError("truncated header")
+    magic, version, channels, protocol, device, subdevice, function, _, \
+        start_us = struct.unpack_from(HEADER_FMT, data)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("not an IR capture (magic/version)")
+    label = None
+    if protocol != NO_LABEL:
+        label = (protocol, device, subdevice, function)
+    return channels, label, start_us
+
+
+def read_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        if pos >= len(data) or shift >= 64:
+            raise ValueError("truncated record at byte %d" % pos)
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            return value, pos
+        shift += 7
+
+
+def records(data):
+    """逐条产生(timestamp_us, duration_us, channel, frame_end, is_mark)"""
+    _, _, now = parse_header(data)
+    pos = HEADER_SIZE
+
+    while pos < len(data):
+        zigzag, pos = read_varint(data, pos)
+        value, pos = read_varint(data, pos)
+        now += (zigzag >> 1) ^ -(zigzag & 1)
+        yield (now, value >> 4, (value >> 2) & 0x3, bool(value & 2),
+               bool(value & 1))
+
+
+def dump(data, out):
+    channels, label, start_us = parse_header(data)
+    out.write("channels 0x%x, start %u us, label %s\n" %
+              (channels, start_us,
+               "P:%u D:%u.%u F:%u" % label if label else "none"))
+
+    frames = {}
+    edges = 0
+    for ts, duration, channel, frame_end, is_mark in records(data):
+        frame = frames.setdefault(channel, [])
+        if not frame_end:
+            frame.append(("+" if is_mark else "-") + str(duration))
+            edges += 1
+            continue
+        out.write("ch%u @%u: %s\n" % (channel, ts, " ".join(frame)))
+        frames[channel] = []
+    out.write("%u edges\n" % edges)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="IR edge capture tool")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    ext = sub.add_parser("extract", help="rebuild capture file(s) from a log")
+    ext.add_argument("log")
+    ext.add_argument("output")
+    ext.add_argument("--all", action="store_true",
+                     help="write every capture as OUTPUT-N.ircap")
+    dmp = sub.add_parser("dump", help="list frames in a capture file")
+    dmp.add_argument("capture")
+    args = parser.parse_args()
+
+    if args.cmd == "dump":
+        with open(args.capture, "rb") as f:
+            dump(f.read(), sys.stdout)
+        return 0
+
+    with open(args.log, errors="replace") as f:
+        captures = extract(f)
+    if not captures:
+        sys.stderr.write("no complete #IRCAP: capture in %s\n" % args.log)
+        return 1
+
+    if not args.all:
+        captures = captures[:1]
+    for i, data in enumerate(captures):
+        parse_header(data)
+        path = args.output if not args.all else "%s-%d.ircap" % (args.output, i)
+        with open(path, "wb") as f:
+            f.write(data)
+        print("%s: %u bytes" % (path, len(data)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
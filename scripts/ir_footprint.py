@@ -0,0 +1,283 @@
+#!/usr/bin/env python3
+"""
+固件尺寸报告 - 从链接映射文件(zephyr.map)按模块统计flash、RAM和栈
+
+每个输入段按所在目标文件归入模块: 应用的src/ir_*.c、irdb_*.c、main.c和
+构建时生成的镜像各为一行，其余应用文件合为"app (other)"，内核、驱动和
+库合为"zephyr"。输出段的地址落在哪个存储区决定记入RAM还是flash，带加载
+地址的已初始化数据两边都计。RAM中不清零的段(.noinit)里含"stack"符号的
+记为线程栈，也计入RAM。
+
+用法: ir_footprint.py build/zephyr/zephyr.map
+  --ram-budget N / --flash-budget N  ir_*/irdb_*模块合计超出时返回1
+  --json out.json                    保存本次结果
+  --baseline old.json                与之前保存的结果比较，列出增减
+  --top N                            列出最大的N个RAM符号
+
+构建目标: west build -t ir_footprint (CMakeLists.txt)
+"""
+
+import argparse
+import json
+import re
+import sys
+
+# 不占目标存储的输出段
+SKIP_PREFIXES = (".debug", ".comment", ".ARM.attributes", ".stab", ".note",
+                 ".gnu", ".symtab", ".strtab", ".shstrtab")
+
+APP_OBJECT = re.compile(r"(?:libapp\.a\(|app\.dir/).*?([\w.-]+)\.c\.obj\)?$")
+OUT_SECTION = re.compile(r"^([.\w]\S*)(?:\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)"
+                         r"(?:\s+load address 0x([0-9a-f]+))?)?\s*$")
+OUT_CONT = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)"
+                      r"(?:\s+load address 0x([0-9a-f]+))?\s*$")
+IN_SECTION = re.compile(r"^ (\.\S+|COMMON)(?:\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)"
+                        r"\s+(\S.*))?\s*$")
+IN_CONT = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*?)\s*$")
+SYMBOL = re.compile(r"^\s+0x([0-9a-f]+)\s+([A-Za-z_]\w*)\s*$")
+REGION = re.compile(r"^(\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s*(\w*)\s*$")
+
+
+def module_of(obj):
+    """目标文件 -> 模块名"""
+    m = APP_OBJECT.search(obj)
+    if not m:
+        return "zephyr"
+    name = m.group(1)
+    if name.startswith(("ir_", "irdb_")) or name == "main":
+        return name
+    return "app (other)"
+
+
+def is_ir_module(name):
+    return name.startswith(("ir_", "irdb_")) or name == "main"
+
+
+class Entry:
+    def __init__(self, out, name, addr, size, obj):
+        self.out = out
+        self.name = name
+        self.addr = addr
+        self.size = size
+        self.module = module_of(obj)
+        self.symbols = []
+
+
+def parse_map(path):
+    regions = []
+    entries = []
+    out = None  # 当前输出段: (名称, 地址, 是否有加载地址)
+    pending_out = None
+    pending_in = None
+    state = "head"
+
+    with open(path, errors="replace") as f:
+        for line in f:
+            line = line.rstrip("\n")
+
+            if line.startswith("Memory Configuration"):
+                state = "regions"
+                continue
+            if line.startswith("Linker script and memory map"):
+                state = "map"
+                continue
+
+            if state == "regions":
+                m = REGION.match(line)
+                if m and m.group(1) not in ("Name", "*default*"):
+                    regions.append((m.group(1), int(m.group(2), 16),
+                                    int(m.group(3), 16), m.group(4)))
+                continue
+            if state != "map":
+                continue
+
+            if pending_out is not None:
+                m = OUT_CONT.match(line)
+                if m:
+                    out = (pending_out, int(m.group(1), 16),
+                           m.group(3) is not None)
+                pending_out = None
+                continue
+            if pending_in is not None:
+                m = IN_CONT.match(line)
+                if m and out:
+                    entries.append(Entry(out, pending_in, int(m.group(1), 16),
+                                         int(m.group(2), 16), m.group(3)))
+                pending_in = None
+                if m:
+                    continue
+
+            if line and not line[0].isspace():
+                m = OUT_SECTION.match(line)
+                if not m:
+                    continue
+                if m.group(2) is None:
+                    pending_out = m.group(1)
+                else:
+                    out = (m.group(1), int(m.group(2), 16),
+                           m.group(4) is not None)
+                continue
+
+            m = IN_SECTION.match(line)
+            if m:
+                if m.group(2) is None:
+                    pending_in = m.group(1)
+                elif out:
+                    entries.append(Entry(out, m.group(1), int(m.group(2), 16),
+                                         int(m.group(3), 16), m.group(4)))
+                continue
+
+            m = SYMBOL.match(line)
+            if m and entries:
+                entries[-1].symbols.append(m.group(2))
+
+    return regions, entries
+
+
+def region_of(regions, addr):
+    for name, origin, length, attrs in regions:
+        if origin <= addr < origin + length:
+            return name, "w" in attrs
+    return None, False
+
+
+def symbol_of(e):
+    """全局符号取映射文件中的名字，静态变量由段名(.bss.<名字>)得到"""
+    if e.symbols:
+        return e.symbols[0]
+    if e.name.startswith((".bss.", ".data.")):
+        return e.name.split(".", 2)[2]
+    return e.name
+
+
+def summarize(regions, entries):
+    modules = {}
+    symbols = []
+
+    for e in entries:
+        name, addr, loaded = e.out
+        if e.size == 0 or name.startswith(SKIP_PREFIXES):
+            continue
+        region, writable = region_of(regions, addr)
+        if region is None or region == "IDT_LIST":
+            continue
+
+        m = modules.setdefault(e.module, {"flash": 0, "ram": 0, "stack": 0})
+        if writable:
+            m["ram"] += e.size
+            if loaded:
+                m["flash"] += e.size
+            if "noinit" in e.name and any("stack" in s for s in e.symbols):
+                m["stack"] += e.size
+            if is_ir_module(e.module):
+                symbols.append((e.size, e.module, symbol_of(e)))
+        else:
+            m["flash"] += e.size
+
+    symbols.sort(reverse=True)
+    return modules, symbols
+
+
+def totals(modules, pick):
+    t = {"flash": 0, "ram": 0, "stack": 0}
+    for name, m in modules.items():
+        if pick(name):
+            for k in t:
+                t[k] += m[k]
+    return t
+
+
+def fmt_delta(value, old):
+    if old is None:
+        return ""
+    d = value - old
+    return "%+d" % d if d else "="
+
+
+def print_report(modules, baseline):
+    rows = sorted((n for n in modules if is_ir_module(n)),
+                  key=lambda n: -(modules[n]["flash"] + modules[n]["ram"]))
+    groups = [
+        ("ir_* total", totals(modules, is_ir_module)),
+        ("app (other)", modules.get("app (other)")),
+        ("zephyr", modules.get("zephyr")),
+        ("image total", totals(modules, lambda n: True)),
+    ]
+
+    print("%-24s %9s %9s %9s" % ("module", "flash", "ram", "stack"))
+    for name in rows:
+        print_row(name, modules[name], baseline)
+    print("-" * 54)
+    for name, m in groups:
+        if m:
+            print_row(name, m, baseline)
+
+
+def print_row(name, m, baseline):
+    old = baseline.get(name) if baseline else None
+    line = "%-24s %9u %9u %9u" % (name, m["flash"], m["ram"], m["stack"])
+    if old:
+        line += "   flash %s ram %s" % (fmt_delta(m["flash"], old["flash"]),
+                                       fmt_delta(m["ram"], old["ram"]))
+    elif baseline is not None:
+        line += "   (new)"
+    print(line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="IR firmware footprint")
+    parser.add_argument("map", help="linker map file (zephyr.map)")
+    parser.add_argument("--ram-budget", type=int, default=0,
+                        help="fail if ir_* RAM exceeds this (0: no check)")
+    parser.add_argument("--flash-budget", type=int, default=0,
+                        help="fail if ir_* flash exceeds this (0: no check)")
+    parser.add_argument("--json", help="save the per-module sizes")
+    parser.add_argument("--baseline", help="compare with a saved report")
+    parser.add_argument("--top", type=int, default=10,
+                        help="largest ir_* RAM symbols to list")
+    args = parser.parse_args()
+
+    regions, entries = parse_map(args.map)
+    if not regions or not entries:
+        sys.exit("ir_footprint: %s is not a GNU ld map file" % args.map)
+    modules, symbols = summarize(regions, entries)
+
+    baseline = None
+    if args.baseline:
+        try:
+            with open(args.baseline) as f:
+                baseline = json.load(f)
+        except FileNotFoundError:
+            print("ir_footprint: no baseline %s yet" % args.baseline,
+                  file=sys.stderr)
+
+    print_report(modules, baseline)
+
+    if args.top > 0 and symbols:
+        print("\nlargest ir_* RAM symbols:")
+        for size, module, name in symbols[:args.top]:
+            print("  %7u  %-16s %s" % (size, module, name))
+
+    if args.json:
+        report = dict(modules)
+        report["ir_* total"] = totals(modules, is_ir_module)
+        report["image total"] = totals(modules, lambda n: True)
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=1, sort_keys=True)
+
+    ir = totals(modules, is_ir_module)
+    failed = False
+    if args.ram_budget and ir["ram"] > args.ram_budget:
+        print("ir_footprint: RAM %u exceeds budget %u"
+              % (ir["ram"], args.ram_budget), file=sys.stderr)
+        failed = True
+    if args.flash_budget and ir["flash"] > args.flash_budget:
+        print("ir_footprint: flash %u exceeds budget %u"
+              % (ir["flash"], args.flash_budget), file=sys.stderr)
+        failed = True
+    if failed:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
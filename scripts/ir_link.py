@@ -0,0 +1,296 @@
+#!/usr/bin/env python3
+"""
+二进制命令链路客户端 - 经USB CDC-ACM串口驱动设备，也是集线器实现的参考
+
+帧格式见include/ir_link.h。BLE后端的帧格式相同，写入RX特征、从TX特征的
+通知中按同样的方式定帧即可。
+
+用法 (需要pyserial):
+  ir_link.py /dev/ttyACM1 ping
+  ir_link.py /dev/ttyACM1 send 1 4 4 8 [repeat] [channels]
+  ir_link.py /dev/ttyACM1 name tv:Power [repeat]
+  ir_link.py /dev/ttyACM1 upload hub configs/irdb_samples/Sony_TV_1_0.csv
+  ir_link.py /dev/ttyACM1 store sony configs/irdb_samples/Sony_TV_1_0.csv
+  ir_link.py /dev/ttyACM1 stats
+  ir_link.py /dev/ttyACM1 list            # 当前遥控器的全部功能，分页取回
+  ir_link.py /dev/ttyACM1 learned         # 全部学习信号名称
+  ir_link.py /dev/ttyACM1 find vol        # 活动集中以vol开头的功能
+  ir_link.py /dev/ttyACM1 bench 1000 1 4 4 8   # 连续发送，测每秒命令数
+  ir_link.py /dev/ttyACM1 time            # 设备同步时间设为本机时间
+  ir_link.py /dev/ttyACM1 at 500 1 4 4 8  # 500ms后在同步时间上发送
+
+多个发射器同时发送: 先对每个设备执行time(或接同一路秒脉冲)，再对每个
+设备用同一个时刻执行at。
+"""
+
+import argparse
+import binascii
+import struct
+import sys
+import time
+
+SYNC = 0xA5
+RESPONSE = 0x80
+
+CMD_PING = 0x01
+CMD_SEND_ENTRY = 0x10
+CMD_SEND_ID = 0x11
+CMD_SEND_NAME = 0x12
+CMD_SEND_BATCH = 0x13
+CMD_FIND_ID = 0x14
+CMD_LIST = 0x15
+CMD_LIST_LEARNED = 0x16
+CMD_SEND_AT = 0x17
+CMD_FIND = 0x18
+CMD_DB_BEGIN = 0x20
+CMD_DB_CHUNK = 0x21
+CMD_DB_END = 0x22
+CMD_DB_STORE = 0x23
+CMD_STATS = 0x30
+CMD_TIME = 0x31
+
+# 与ir_link_stat_t的顺序相同
+STAT_NAMES = [
+    "rx_edges", "rx_frames", "rx_overflows", "decoded", "repeats",
+    "decode_failed", "decode_dropped", "tx_frames", "tx_airtime_ms",
+    "txq_depth", "txq_submitted", "txq_dropped", "txq_max_latency_us",
+    "learn_completed", "link_commands", "link_crc_errors", "link_overruns",
+]
+
+CHUNK = 200  # 不超过固件的CONFIG_IR_LINK_PAYLOAD_MAX
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE"""
+    return binascii.crc_hqx(data, 0xFFFF)
+
+
+def frame(cmd, seq, payload=b""):
+    body = struct.pack("<HBB", len(payload), cmd, seq) + payload
+    return bytes([SYNC]) + body + struct.pack("<H", crc16(body))
+
+
+def entry(protocol, device, subdevice, function, repeat=1, channels=0):
+    return struct.pack("<HHHHBB", protocol, device, subdevice, function,
+                       repeat, channels)
+
+
+class Link:
+    def __init__(self, port, timeout=1.0):
+        import serial  # pylint: disable=import-outside-toplevel
+        self.ser = serial.Serial(port, 115200, timeout=timeout)
+        self.seq = 0
+        self.buf = b""
+
+    def request(self, cmd, payload=b""):
+        """发送一帧并等待同序号的响应，返回(状态, 数据)"""
+        self.seq = (self.seq + 1) & 0xFF
+        self.ser.write(frame(cmd, self.seq, payload))
+        while True:
+            resp = self._read_frame()
+            if resp is None:
+                raise TimeoutError("no response to 0x%02x" % cmd)
+            rcmd, rseq, data = resp
+            if rcmd == cmd | RESPONSE and rseq == self.seq:
+                status = struct.unpack_from("<h", data)[0]
+                return status, data[2:]
+
+    def _read_frame(self):
+        while True:
+            start = self.buf.find(bytes([SYNC]))
+            if start < 0:
+                self.buf = b""
+            else:
+                self.buf = self.buf[start:]
+            if len(self.buf) >= 5:
+                plen = struct.unpack_from("<H", self.buf, 1)[0]
+                total = 5 + plen + 2
+                if len(self.buf) >= total:
+                    body = self.buf[1:total - 2]
+                    crc = struct.unpack_from("<H", self.buf, total - 2)[0]
+                    if crc != crc16(body):
+                        self.buf = self.buf[1:]
+                        continue
+                    self.buf = self.buf[total:]
+                    return body[2], body[3], body[4:]
+            more = self.ser.read(max(1, self.ser.in_waiting))
+            if not more:
+                return None
+            self.buf += more
+
+
+def check(status, what):
+    if status < 0:
+        sys.exit("%s failed: %d" % (what, status))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="IR command link client")
+    parser.add_argument("port")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    sub.add_parser("ping")
+    snd = sub.add_parser("send")
+    for name in ("protocol", "device", "subdevice", "function"):
+        snd.add_argument(name, type=int)
+    snd.add_argument("repeat", type=int, nargs="?", default=1)
+    snd.add_argument("channels", type=lambda v: int(v, 0), nargs="?",
+                     default=0)
+    nam = sub.add_parser("name")
+    nam.add_argument("function")
+    nam.add_argument("repeat", type=int, nargs="?", default=1)
+    upl = sub.add_parser("upload")
+    upl.add_argument("remote_id")
+    upl.add_argument("csv")
+    sto = sub.add_parser("store")
+    sto.add_argument("name")
+    sto.add_argument("csv")
+    sub.add_parser("stats")
+    sub.add_parser("list")
+    sub.add_parser("learned")
+    fnd = sub.add_parser("find")
+    fnd.add_argument("prefix", nargs="?", default="")
+    ben = sub.add_parser("bench")
+    ben.add_argument("count", type=int)
+    for name in ("protocol", "device", "subdevice", "function"):
+        ben.add_argument(name, type=int)
+    sub.add_parser("time")
+    at = sub.add_parser("at")
+    at.add_argument("delay_ms", type=int)
+    for name in ("protocol", "device", "subdevice", "function"):
+        at.add_argument(name, type=int)
+    at.add_argument("repeat", type=int, nargs="?", default=1)
+    at.add_argument("channels", type=lambda v: int(v, 0), nargs="?",
+                    default=0)
+    args = parser.parse_args()
+
+    link = Link(args.port)
+
+    if args.cmd == "ping":
+        start = time.monotonic()
+        status, data = link.request(CMD_PING, b"ping")
+        print("%s in %.1f ms" % (data, (time.monotonic() - start) * 1000))
+    elif args.cmd == "send":
+        status, _ = link.request(CMD_SEND_ENTRY, entry(
+            args.protocol, args.device, args.subdevice, args.function,
+            args.repeat, args.channels))
+        check(status, "send")
+    elif args.cmd == "name":
+        status, _ = link.request(CMD_SEND_NAME, struct.pack(
+            "<BB", args.repeat, 0) + args.function.encode())
+        check(status, "send")
+    elif args.cmd == "upload":
+        with open(args.csv, "rb") as f:
+            data = f.read()
+        check(link.request(CMD_DB_BEGIN, args.remote_id.encode())[0],
+              "begin")
+        for off in range(0, len(data), CHUNK):
+            check(link.request(CMD_DB_CHUNK, data[off:off + CHUNK])[0],
+                  "chunk at %d" % off)
+        status, out = link.request(CMD_DB_END)
+        check(status, "end")
+        print("%s: %u entries" % (args.remote_id,
+                                  struct.unpack("<I", out)[0]))
+    elif args.cmd == "store":
+        check(link.request(CMD_DB_STORE, args.name.encode())[0], "begin")
+        start = time.monotonic()
+        with open(args.csv, "rb") as f:
+            off = 0
+            for data in iter(lambda: f.read(CHUNK), b""):
+                check(link.request(CMD_DB_CHUNK, data)[0],
+                      "chunk at %d" % off)
+                off += len(data)
+        status, out = link.request(CMD_DB_END)
+        check(status, "end")
+        elapsed = time.monotonic() - start
+        count, size, device_ms = struct.unpack("<III", out)
+        print("%s: %u entries, %u bytes in %.2f s (%.1f KB/s, device %u ms)"
+              % (args.name, count, size, elapsed, size / 1024 / elapsed,
+                 device_ms))
+    elif args.cmd == "stats":
+        status, out = link.request(CMD_STATS)
+        check(status, "stats")
+        values = struct.unpack("<%dI" % (len(out) // 4), out)
+        for i, value in enumerate(values):
+            name = STAT_NAMES[i] if i < len(STAT_NAMES) else "stat%d" % i
+            print("%-20s %u" % (name, value))
+    elif args.cmd == "list":
+        index = 0
+        while True:
+            status, out = link.request(CMD_LIST, struct.pack("<I", index))
+            check(status, "list at %u" % index)
+            next_index, count = struct.unpack_from("<II", out)
+            off = 8
+            while off < len(out):
+                p, d, s, f, n = struct.unpack_from("<4HB", out, off)
+                name = out[off + 9:off + 9 + n].decode(errors="replace")
+                print("%5u  %-20s P:%u D:%u.%u F:%u" % (index, name, p, d, s,
+                                                        f))
+                index += 1
+                off += 9 + n
+            if next_index >= count:
+                break
+            index = next_index
+    elif args.cmd == "learned":
+        index = 0
+        while True:
+            status, out = link.request(CMD_LIST_LEARNED,
+                                       struct.pack("<H", index))
+            check(status, "list at %u" % index)
+            index, = struct.unpack_from("<H", out)
+            if len(out) == 2:
+                break
+            off = 2
+            while off < len(out):
+                n = out[off]
+                print(out[off + 1:off + 1 + n].decode(errors="replace"))
+                off += 1 + n
+    elif args.cmd == "find":
+        skip = 0
+        while True:
+            status, out = link.request(CMD_FIND, struct.pack(
+                "<H", skip) + args.prefix.encode())
+            check(status, "find at %u" % skip)
+            skip, = struct.unpack_from("<H", out)
+            if len(out) == 2:
+                break
+            off = 2
+            while off < len(out):
+                n = out[off]
+                print(out[off + 1:off + 1 + n].decode(errors="replace"))
+                off += 1 + n
+    elif args.cmd == "bench":
+        rec = entry(args.protocol, args.device, args.subdevice,
+                    args.function)
+        busy = 0
+        start = time.monotonic()
+        for _ in range(args.count):
+            status, _ = link.request(CMD_SEND_ENTRY, rec)
+            busy += status == -105  # -ENOBUFS: 发送队列满
+        elapsed = time.monotonic() - start
+        print("%u commands in %.2f s: %.0f/s, %u rejected (queue full)" %
+              (args.count, elapsed, args.count / elapsed, busy))
+    elif args.cmd == "time":
+        status, out = link.request(CMD_TIME)
+        check(status, "time")
+        before = struct.unpack("<Q", out)[0]
+        # 请求在往返时间的一半处到达设备
+        start = time.monotonic()
+        link.request(CMD_TIME)
+        rtt = time.monotonic() - start
+        now_us = int(time.time() * 1e6 + rtt / 2 * 1e6)
+        status, _ = link.request(CMD_TIME, struct.pack("<Q", now_us))
+        check(status, "time set")
+        print("time set, was %+.3f s off (rtt %.1f ms)" %
+              ((before - now_us) / 1e6, rtt * 1000))
+    elif args.cmd == "at":
+        at_us = int(time.time() * 1e6) + args.delay_ms * 1000
+        status, _ = link.request(CMD_SEND_AT, struct.pack("<Q", at_us) + entry(
+            args.protocol, args.device, args.subdevice, args.function,
+            args.repeat, args.channels))
+        check(status, "send at")
+        print("scheduled at %u us" % at_us)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""
+采样剖析结果符号化 - 把"ir prof dump"的PC直方图归到函数
+
+"ir prof dump"在shell中输出以"#IRPROF:"开头的行(BEGIN/END之间，每行
+一个PC及其采样数)，本工具从串口日志中取出最后一段，按zephyr.elf的
+符号表(arm-none-eabi-nm)把PC归到函数，按采样数排序输出。
+
+用法:
+  ir_prof.py console.log build/zephyr/zephyr.elf
+  ir_prof.py console.log build/zephyr/zephyr.elf --top 30 --lines
+  ir_prof.py console.log zephyr.elf --nm llvm-nm --addr2line llvm-addr2line
+
+--lines再用addr2line列出最热的几个PC所在的源码行。
+"""
+
+import argparse
+import bisect
+import subprocess
+import sys
+
+PREFIX = "#IRPROF:"
+
+
+def extract(lines):
+    """返回日志中最后一段直方图: (频率, 采样数, 丢弃数, {pc: 次数})"""
+    result = None
+    current = None
+
+    for line in lines:
+        pos = line.find(PREFIX)
+        if pos < 0:
+            continue
+        body = line[pos + len(PREFIX):].split()
+        if not body:
+            continue
+        if body[0] == "BEGIN":
+            hz, samples, dropped = (int(v) for v in body[1:4])
+            current = (hz, samples, dropped, {})
+        elif body[0] == "END":
+            if current is not None:
+                result = current
+            current = None
+        elif current is not None and len(body) == 2:
+            current[3][int(body[0], 16)] = int(body[1])
+    return result
+
+
+def load_symbols(nm, elf):
+    """函数符号: 按地址排序的(地址, 大小, 名称)，Thumb位清零"""
+    out = subprocess.run([nm, "-S", "-n", "--defined-only", elf],
+                         capture_output=True, text=True, check=True).stdout
+    symbols = []
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) != 4 or parts[2] not in "tTwW":
+            continue
+        addr = int(parts[0], 16) & ~1
+        symbols.append((addr, int(parts[1], 16), parts[3]))
+    symbols.sort()
+    return symbols
+
+
+def symbolize(symbols, pc):
+    addrs = [s[0] for s in symbols]
+    i = bisect.bisect_right(addrs, pc) - 1
+    if i >= 0:
+        addr, size, name = symbols[i]
+        if pc < addr + max(size, 1):
+            return name
+    return "0x%08x" % pc
+
+
+def lines_of(addr2line, elf, pcs):
+    out = subprocess.run([addr2line, "-e", elf, "-f", "-C"] +
+                         ["0x%x" % pc for pc in pcs],
+                         capture_output=True, text=True, check=True).stdout
+    rows = out.splitlines()
+    return [rows[i + 1] for i in range(0, len(rows) - 1, 2)]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    ap.add_argument("log", help="串口日志，- 为标准输入")
+    ap.add_argument("elf", help="zephyr.elf")
+    ap.add_argument("--top", type=int, default=20, help="列出的函数数")
+    ap.add_argument("--lines", action="store_true",
+                    help="同时列出最热PC的源码行")
+    ap.add_argument("--nm", default="arm-none-eabi-nm")
+    ap.add_argument("--addr2line", default="arm-none-eabi-addr2line")
+    args = ap.parse_args()
+
+    if args.log == "-":
+        prof = extract(sys.stdin)
+    else:
+        with open(args.log, errors="replace") as f:
+            prof = extract(f)
+    if prof is None:
+        print("no %s BEGIN/END block in %s" % (PREFIX, args.log),
+              file=sys.stderr)
+        return 1
+
+    hz, samples, dropped, hist = prof
+    symbols = load_symbols(args.nm, args.elf)
+    funcs = {}
+    for pc, count in hist.items():
+        name = symbolize(symbols, pc)
+        funcs[name] = funcs.get(name, 0) + count
+
+    total = sum(hist.values()) or 1
+    print("%u samples at %u Hz (%.2f s), %u PCs, %u dropped" %
+          (samples, hz, samples / hz if hz else 0, len(hist), dropped))
+    print("%8s %7s  %s" % ("samples", "%", "function"))
+    for name, count in sorted(funcs.items(), key=lambda f: -f[1])[:args.top]:
+        print("%8u %6.2f%%  %s" % (count, 100.0 * count / total, name))
+
+    if args.lines:
+        hot = sorted(hist.items(), key=lambda h: -h[1])[:args.top]
+        print()
+        print("%8s %7s  %-10s %s" % ("samples", "%", "pc", "line"))
+        for (pc, count), where in zip(
+                hot, lines_of(args.addr2line, args.elf, [h[0] for h in hot])):
+            print("%8u %6.2f%%  0x%08x %s" % (count, 100.0 * count / total,
+                                              pc, where))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
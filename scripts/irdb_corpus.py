@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+IRDB镜像库生成器 - 把整个IRDB codes目录编译成一个外部flash镜像文件
+
+布局见include/irdb_corpus.h。每个遥控器的镜像与irdb_image.py生成的相同，
+默认以irdb_lz.py压缩(压缩无益的原样存放)，键哈希必须与
+src/irdb_corpus.c的irdb_corpus_key_hash一致。
+
+用法: irdb_corpus.py --root codes/ irdb_corpus.bin codes/*/*/*.csv
+  文件命名同irdb_ident.py (IRDB仓库布局或扁平布局)
+
+烧写到DK的MX25R64 (QSPI映射在0x12000000，分区从0开始):
+  arm-none-eabi-objcopy -I binary -O ihex --change-addresses 0x12000000 \\
+      irdb_corpus.bin irdb_corpus.hex
+  nrfjprog --program irdb_corpus.hex --qspisectorerase --verify
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from irdb_ident import remote_of  # noqa: E402
+from irdb_image import build_image, parse_csv  # noqa: E402
+from irdb_lz import compress_image  # noqa: E402
+
+IRDB_CORPUS_MAGIC = 0x43445249  # "IRDC"
+IRDB_CORPUS_VERSION = 1
+
+HEADER_FMT = "<IHHIII"
+SLOT_FMT = "<IIIBBH"
+
+MASK32 = 0xFFFFFFFF
+
+
+def key_hash(manufacturer, device_type, device, subdevice):
+    """与irdb_corpus_key_hash一致"""
+    h = 2166136261
+    for c in manufacturer + b"\0" + device_type + b"\0" + bytes(
+            [device, subdevice]):
+        h ^= c
+        h = (h * 16777619) & MASK32
+    return h
+
+
+def pad4(data):
+    return data + b"\0" * (-len(data) % 4)
+
+
+def build_corpus(root, inputs, compress=True):
+    remotes = {}
+    skipped = 0
+
+    for source in sorted(inputs):
+        remote = remote_of(source, root)
+        if not remote:
+            skipped += 1
+            continue
+
+        with open(source, "rb") as f:
+            records = parse_csv(f.read())
+        if not records:
+            skipped += 1
+            continue
+
+        manufacturer, device_type, device, subdevice = remote
+        key = (manufacturer.encode("utf-8"), device_type.encode("utf-8"),
+               device, subdevice)
+        image, _ = build_image(records)
+        remotes[key] = compress_image(image) if compress else image
+
+    index_size = 16
+    while index_size < len(remotes) * 2:
+        index_size <<= 1
+
+    # 记录紧跟在索引之后
+    offset = struct.calcsize(HEADER_FMT) + index_size * struct.calcsize(
+        SLOT_FMT)
+    offset += -offset % 4
+
+    slots = [None] * index_size
+    hashes = {}
+    data = bytearray()
+    mask = index_size - 1
+    for key in sorted(remotes):
+        manufacturer, device_type, device, subdevice = key
+        h = key_hash(*key)
+
+        # 加载端只在哈希、设备、子设备和键长都相同时读出记录比对，
+        # 完全相同的槽会挡住后面的遥控器
+        ident = (h, device, subdevice, len(manufacturer) + len(device_type))
+        if ident in hashes:
+            sys.exit("irdb_corpus: key hash collision: %s and %s"
+                     % (hashes[ident], key))
+        hashes[ident] = key
+
+        key_data = manufacturer + b"\0" + device_type + b"\0"
+        record = pad4(key_data) + remotes[key]
+
+        slot = h & mask
+        while slots[slot]:
+            slot = (slot + 1) & mask
+        slots[slot] = (h, offset + len(data), len(record), device, subdevice,
+                       len(key_data))
+        data += pad4(record)
+
+    index = b"".join(struct.pack(SLOT_FMT, *(s or (0, 0, 0, 0, 0, 0)))
+                     for s in slots)
+    body = pad4(index) + bytes(data)
+
+    size = struct.calcsize(HEADER_FMT) + len(body)
+    header = struct.pack(HEADER_FMT, IRDB_CORPUS_MAGIC, IRDB_CORPUS_VERSION,
+                         0, len(remotes), index_size, size)
+    return header + body, len(remotes), skipped
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build IRDB corpus image")
+    parser.add_argument("output", help="output binary file")
+    parser.add_argument("files", nargs="*", help="IRDB CSV files")
+    parser.add_argument("--root", required=True, help="IRDB codes directory")
+    parser.add_argument("--max-size", type=int, default=0x800000,
+                        help="partition size in bytes")
+    parser.add_argument("--no-compress", action="store_true",
+                        help="store images uncompressed")
+    args = parser.parse_args()
+
+    corpus, remotes, skipped = build_corpus(args.root, args.files,
+                                            not args.no_compress)
+    if skipped:
+        print("irdb_corpus: skipped %u files" % skipped, file=sys.stderr)
+    if len(corpus) > args.max_size:
+        sys.exit("irdb_corpus: %u bytes exceed the %u byte partition"
+                 % (len(corpus), args.max_size))
+
+    with open(args.output, "wb") as f:
+        f.write(corpus)
+
+    print("irdb_corpus: %u remotes, %u bytes" % (remotes, len(corpus)))
+
+
+if __name__ == "__main__":
+    main()
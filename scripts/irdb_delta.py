@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+"""
+IRDB增量发布 - 为每个遥控器编版本号，生成版本清单和增量文件
+
+格式见include/irdb_delta.h。输出目录同时保存各遥控器最近几个版本的
+快照(<device>,<subdevice>.<version>.csv)，下次运行与之比较：内容变化的
+遥控器版本加1，并生成从保留的每个旧版本到新版本的增量。把输出目录
+推送到GitHub仓库，设备经jsDelivr按CONFIG_IRDB_DELTA_PATH访问。
+
+用法: irdb_delta.py --root codes/ --out delta/ codes/*/*/*.csv
+  文件命名同irdb_ident.py (IRDB仓库布局或扁平布局)
+"""
+
+import argparse
+import collections
+import glob
+import os
+import re
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from irdb_ident import remote_of  # noqa: E402
+from irdb_image import parse_csv  # noqa: E402
+
+IRDB_DELTA_MANIFEST_MAGIC = 0x4D445249  # "IRDM"
+IRDB_DELTA_MAGIC = 0x44445249  # "IRDD"
+IRDB_DELTA_FORMAT = 1
+IRDB_LOAD_HTTP = 2
+
+MANIFEST_FMT = "<IHHII"
+RECORD_FMT = "<III"
+DELTA_FMT = "<IIIIHH"
+
+MASK32 = 0xFFFFFFFF
+
+
+def fnv1a(h, data):
+    for c in data:
+        h ^= c
+        h = (h * 16777619) & MASK32
+    return h
+
+
+def key_hash(manufacturer, device_type, device, subdevice):
+    """与irdb_cache_key_hash一致 (来源IRDB_LOAD_HTTP)"""
+    return fnv1a(2166136261, manufacturer + b"\0" + device_type + b"\0" +
+                 bytes([device, subdevice, IRDB_LOAD_HTTP]))
+
+
+def entry_hash(record):
+    """与irdb_delta.c的entry_hash一致"""
+    name, *codes = record
+    return fnv1a(2166136261, name + b"\0" + struct.pack("<4H", *codes))
+
+
+def content_hash(records):
+    return sum(entry_hash(r) for r in records) & MASK32
+
+
+def record_csv(record):
+    """与irdb_delta.c的feed_entry相同的写法"""
+    name, *codes = record
+    return b'"' + name.replace(b'"', b'""') + b'",' + b",".join(
+        b"%u" % c for c in codes) + b"\n"
+
+
+def read_manifest(path):
+    try:
+        with open(path, "rb") as f:
+            data = f.read()
+    except FileNotFoundError:
+        return 0, {}
+
+    magic, fmt, _, serial, count = struct.unpack_from(MANIFEST_FMT, data)
+    if magic != IRDB_DELTA_MANIFEST_MAGIC or fmt != IRDB_DELTA_FORMAT:
+        sys.exit("irdb_delta: %s is not a delta manifest" % path)
+
+    records = {}
+    offset = struct.calcsize(MANIFEST_FMT)
+    for _ in range(count):
+        h, version, chash = struct.unpack_from(RECORD_FMT, data, offset)
+        records[h] = (version, chash)
+        offset += struct.calcsize(RECORD_FMT)
+    return serial, records
+
+
+def build_delta(old, new, from_version, to_version):
+    """删除表为旧版本多出的条目哈希(可重复)，新增条目按新版本的顺序"""
+    removed = collections.Counter(old) - collections.Counter(new)
+    added = collections.Counter(new) - collections.Counter(old)
+
+    removed_hashes = [entry_hash(r) for r in removed.elements()]
+    if len(removed_hashes) > 0xFFFF:
+        return None
+
+    body = bytearray()
+    for record in new:
+        if added[record] > 0:
+            added[record] -= 1
+            body += record_csv(record)
+
+    header = struct.pack(DELTA_FMT, IRDB_DELTA_MAGIC, from_version,
+                         to_version, content_hash(new), len(removed_hashes),
+                         0)
+    return header + struct.pack("<%uI" % len(removed_hashes),
+                                *removed_hashes) + bytes(body)
+
+
+def snapshots(base):
+    """已保存的快照 {版本: 路径}"""
+    found = {}
+    for path in glob.glob(glob.escape(base) + ".*.csv"):
+        match = re.match(r"\.(\d+)\.csv$", path[len(base):])
+        if match:
+            found[int(match.group(1))] = path
+    return found
+
+
+def publish(root, inputs, out, keep):
+    os.makedirs(out, exist_ok=True)
+    serial, previous = read_manifest(os.path.join(out, "manifest.bin"))
+    manifest = {}
+    changed = 0
+    deltas = 0
+
+    for source in sorted(inputs):
+        remote = remote_of(source, root)
+        if not remote:
+            continue
+
+        with open(source, "rb") as f:
+            records = parse_csv(f.read())
+        if not records:
+            continue
+
+        manufacturer, device_type, device, subdevice = remote
+        h = key_hash(manufacturer.encode("utf-8"),
+                     device_type.encode("utf-8"), device, subdevice)
+        chash = content_hash(records)
+        base = os.path.join(out, manufacturer, device_type,
+                            "%u,%u" % (device, subdevice))
+
+        version, old_hash = previous.get(h, (0, None))
+        if old_hash != chash:
+            version += 1
+            changed += 1
+
+        os.makedirs(os.path.dirname(base), exist_ok=True)
+        kept = snapshots(base)
+        if version not in kept:
+            with open("%s.%u.csv" % (base, version), "wb") as f:
+                f.write(b"".join(record_csv(r) for r in records))
+
+            # 从保留的旧版本到新版本的增量
+            for old_version, path in kept.items():
+                if old_version < version - keep:
+                    continue
+                with open(path, "rb") as f:
+                    delta = build_delta(parse_csv(f.read()), records,
+                                        old_version, version)
+                if delta is not None:
+                    with open("%s.%u.delta" % (base, old_version), "wb") as f:
+                        f.write(delta)
+                    deltas += 1
+
+        # 超出保留范围的快照和增量删除，设备对更早的版本整表下载
+        for old_version, path in kept.items():
+            if old_version < version - keep:
+                os.remove(path)
+        for path in glob.glob(glob.escape(base) + ".*.delta"):
+            match = re.match(r"\.(\d+)\.delta$", path[len(base):])
+            if match and int(match.group(1)) < version - keep:
+                os.remove(path)
+
+        if h in manifest:
+            print("irdb_delta: key hash collision at %s" % source,
+                  file=sys.stderr)
+        manifest[h] = (version, chash)
+
+    if changed or set(manifest) != set(previous):
+        serial += 1
+
+    data = struct.pack(MANIFEST_FMT, IRDB_DELTA_MANIFEST_MAGIC,
+                       IRDB_DELTA_FORMAT, 0, serial, len(manifest))
+    for h in sorted(manifest):
+        data += struct.pack(RECORD_FMT, h, *manifest[h])
+
+    with open(os.path.join(out, "manifest.bin"), "wb") as f:
+        f.write(data)
+    return serial, len(manifest), changed, deltas
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Publish IRDB deltas")
+    parser.add_argument("files", nargs="*", help="IRDB CSV files")
+    parser.add_argument("--root", required=True, help="IRDB codes directory")
+    parser.add_argument("--out", required=True, help="publication directory")
+    parser.add_argument("--keep", type=int, default=4,
+                        help="older versions to keep deltas from")
+    args = parser.parse_args()
+
+    serial, remotes, changed, deltas = publish(args.root, args.files,
+                                               args.out, max(args.keep, 1))
+    print("irdb_delta: serial %u, %u remotes, %u changed, %u deltas"
+          % (serial, remotes, changed, deltas))
+
+
+if __name__ == "__main__":
+    main()
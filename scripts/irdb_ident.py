@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+"""
+IRDB识别索引生成器 - 按(协议, 设备, 子设备)索引IRDB文件路径
+
+布局见include/irdb_ident.h。CSV解析与irdb_image.py相同，识别时用一帧的
+解码结果二分查找，得到可交给irdb_build_path()/irdb_load_from_http()的
+候选遥控器。
+
+用法: irdb_ident.py --root codes/ output.c codes/Samsung/TV/7,7.csv ...
+  IRDB仓库布局: <root>/<manufacturer>/<device_type>/<device>,<subdevice>.csv
+  扁平布局:     <manufacturer>_<device_type>_<device>_<subdevice>.csv
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from irdb_image import REMOTE_NAME, format_array, parse_csv  # noqa: E402
+
+IRDB_IDENT_MAGIC = 0x58445249  # "IRDX"
+IRDB_IDENT_VERSION = 1
+IRDB_IDENT_POOL_MAX = 0xFFFF
+
+HEADER_FMT = "<IHHIIII"
+KEY_FMT = "<HHHHI"
+PATH_FMT = "<HHBB"
+
+PATH_NAME = re.compile(r"^(\d+),(\d+)$")
+
+
+def remote_of(path, root):
+    """由文件路径得到(manufacturer, device_type, device, subdevice)"""
+    rel = os.path.relpath(path, root).replace(os.sep, "/")
+    parts = rel.split("/")
+    stem = os.path.splitext(parts[-1])[0]
+
+    if len(parts) >= 3:
+        match = PATH_NAME.match(stem)
+        if not match:
+            return None
+        remote = (parts[-3], parts[-2]) + match.groups()
+    else:
+        match = REMOTE_NAME.match(stem)
+        if not match:
+            return None
+        remote = match.groups()
+
+    manufacturer, device_type, device, subdevice = remote
+    if int(device) > 255 or int(subdevice) > 255:
+        return None
+    return manufacturer, device_type, int(device), int(subdevice)
+
+
+def build_index(root, inputs):
+    paths = []
+    keys = {}
+    skipped = 0
+
+    for source in sorted(inputs):
+        remote = remote_of(source, root)
+        if not remote:
+            skipped += 1
+            continue
+
+        with open(source, "rb") as f:
+            records = parse_csv(f.read())
+
+        # 同一文件内按键计数，条目多的键排在候选前面
+        counts = {}
+        for _, protocol, device, subdevice, _ in records:
+            key = (protocol, device, subdevice)
+            counts[key] = counts.get(key, 0) + 1
+        if not counts:
+            skipped += 1
+            continue
+
+        index = len(paths)
+        paths.append(remote)
+        for key, count in counts.items():
+            keys.setdefault(key, []).append((count, index))
+
+    if len(paths) > 0xFFFF:
+        sys.exit("irdb_ident: too many remotes")
+
+    # 字符串池: 厂商和类型去重
+    pool = bytearray()
+    offsets = {}
+
+    def intern(text):
+        data = text.encode("utf-8")
+        if data not in offsets:
+            offsets[data] = len(pool)
+            pool.extend(data + b"\0")
+        return offsets[data]
+
+    path_data = b""
+    for manufacturer, device_type, device, subdevice in paths:
+        path_data += struct.pack(PATH_FMT, intern(manufacturer),
+                                 intern(device_type), device, subdevice)
+    if len(pool) > IRDB_IDENT_POOL_MAX:
+        sys.exit("irdb_ident: string pool too large")
+
+    key_data = b""
+    refs = []
+    for key in sorted(keys):
+        ranked = sorted(keys[key], key=lambda r: (-r[0], r[1]))
+        key_data += struct.pack(KEY_FMT, *key, len(ranked), len(refs))
+        refs += [index for _, index in ranked]
+
+    body = key_data + path_data + struct.pack("<%dH" % len(refs), *refs)
+    body += bytes(pool)
+
+    size = struct.calcsize(HEADER_FMT) + len(body)
+    header = struct.pack(HEADER_FMT, IRDB_IDENT_MAGIC, IRDB_IDENT_VERSION,
+                         len(paths), len(keys), len(refs), len(pool), size)
+    return header + body, len(paths), len(keys), skipped
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build IRDB identify index")
+    parser.add_argument("output", help="output C source")
+    parser.add_argument("files", nargs="*", help="IRDB CSV files")
+    parser.add_argument("--root", required=True, help="IRDB codes directory")
+    parser.add_argument("--symbol", default="irdb_ident_index",
+                        help="C array name")
+    args = parser.parse_args()
+
+    index, remotes, keys, skipped = build_index(args.root, args.files)
+    if skipped:
+        # 子设备为-1等加载器无法寻址的文件不进索引
+        print("irdb_ident: skipped %u files" % skipped, file=sys.stderr)
+
+    lines = [
+        "/* 由scripts/irdb_ident.py生成的IRDB识别索引，请勿手工修改 */",
+        "/* %u remotes, %u keys, %u bytes */" % (remotes, keys, len(index)),
+        "",
+        "#include <stdint.h>",
+        "",
+    ]
+    lines += format_array(args.symbol, index)
+    lines.append("")
+
+    with open(args.output, "w", encoding="utf-8") as f:
+        f.write("\n".join(lines))
+
+    print("irdb_ident: %u remotes, %u keys, %u bytes"
+          % (remotes, keys, len(index)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,301 @@
+#!/usr/bin/env python3
+"""
+IRDB二进制镜像生成器 - 把IRDB CSV编译成可直接放在flash中使用的C数组
+
+镜像布局见include/irdb_image.h。CSV解析规则和哈希算法必须与
+src/irdb_protocol.c保持一致 (parse_csv_record / code_hash / name_hash)。
+
+用法:
+  单个镜像: irdb_image.py input.csv output.c --symbol irdb_image_samsung_tv_7_7
+  内置注册表: irdb_image.py --registry output.c Samsung_TV_7_7.csv ...
+    文件名格式为 <manufacturer>_<device_type>_<device>_<subdevice>.csv
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+IRDB_IMAGE_MAGIC = 0x42445249
+IRDB_IMAGE_VERSION = 1
+IRDB_MAX_DB_PROTOCOLS = 8
+IRDB_NAME_MAX = 32
+IRDB_NAME_POOL_MAX = 0xFFFF
+
+HEADER_FMT = "<IHHIHHBB%dHH" % IRDB_MAX_DB_PROTOCOLS
+ENTRY_FMT = "<HHHHH"
+
+MASK32 = 0xFFFFFFFF
+
+
+def skip_blank(line, i):
+    while i < len(line) and line[i] in b" \t":
+        i += 1
+    return i
+
+
+def parse_name_field(line, i):
+    """与parse_name_field一致: 支持引号和""转义，非引号字段去除尾部空白"""
+    name = bytearray()
+    i = skip_blank(line, i)
+
+    if i < len(line) and line[i : i + 1] == b'"':
+        i += 1
+        while i < len(line):
+            c = line[i : i + 1]
+            i += 1
+            if c == b'"':
+                if line[i : i + 1] == b'"':
+                    i += 1
+                else:
+                    break
+            name += c
+        i = skip_blank(line, i)
+    else:
+        while i < len(line) and line[i : i + 1] != b",":
+            name += line[i : i + 1]
+            i += 1
+        name = name.rstrip(b" \t")
+
+    return bytes(name[: IRDB_NAME_MAX - 1]), i
+
+
+def parse_uint_field(line, i):
+    i = skip_blank(line, i)
+    start = i
+    while i < len(line) and line[i : i + 1].isdigit():
+        i += 1
+    if i == start:
+        return None, i
+    value = int(line[start:i])
+    if value > 0xFFFF:
+        return None, i
+    return value, skip_blank(line, i)
+
+
+def parse_record(line):
+    """解析一行，表头或格式错误返回None"""
+    name, i = parse_name_field(line, 0)
+    fields = []
+
+    for _ in range(4):
+        if line[i : i + 1] != b",":
+            return None
+        value, i = parse_uint_field(line, i + 1)
+        if value is None:
+            return None
+        fields.append(value)
+
+    if i < len(line) and line[i : i + 1] != b",":
+        return None
+    return (name, *fields)
+
+
+def parse_csv(data):
+    if data.startswith(b"\xef\xbb\xbf"):
+        data = data[3:]
+
+    records = []
+    for line in data.replace(b"\r", b"\n").split(b"\n"):
+        stripped = line[skip_blank(line, 0) :]
+        if not stripped or stripped.startswith(b"#"):
+            continue
+        record = parse_record(line)
+        if record:
+            records.append(record)
+    return records
+
+
+def code_hash(protocol, device, subdevice, function):
+    h = (((protocol << 16) | device) * 0x9E3779B1) & MASK32
+    h ^= (((subdevice << 16) | function) * 0x85EBCA77) & MASK32
+    return h ^ (h >> 15)
+
+
+def name_hash(name):
+    h = 2166136261
+    for c in name.lower():
+        h ^= c
+        h = (h * 16777619) & MASK32
+    return h
+
+
+def build_image(records):
+    # 字符串池: 同名条目共用同一偏移
+    names = bytearray()
+    offsets = {}
+    entries = []
+    for name, protocol, device, subdevice, function in records:
+        if name not in offsets:
+            offsets[name] = len(names)
+            names += name + b"\0"
+        entries.append((offsets[name], protocol, device, subdevice, function))
+
+    if len(names) > IRDB_NAME_POOL_MAX or len(entries) >= 0xFFFF:
+        sys.exit("irdb_image: database too large")
+
+    protocols = []
+    for entry in entries:
+        if entry[1] not in protocols and len(protocols) < IRDB_MAX_DB_PROTOCOLS:
+            protocols.append(entry[1])
+
+    # 与irdb_build_index相同的表大小和线性探测顺序
+    index_size = 0
+    if entries:
+        index_size = 16
+        while index_size < len(entries) * 2:
+            index_size <<= 1
+
+    hash_slots = [0] * index_size
+    name_slots = [0] * index_size
+    mask = index_size - 1
+    for i, (offset, protocol, device, subdevice, function) in enumerate(entries):
+        slot = code_hash(protocol, device, subdevice, function) & mask
+        while hash_slots[slot]:
+            slot = (slot + 1) & mask
+        hash_slots[slot] = i + 1
+
+        name = names[offset : names.index(b"\0", offset)]
+        slot = name_hash(name) & mask
+        while name_slots[slot]:
+            slot = (slot + 1) & mask
+        name_slots[slot] = i + 1
+
+    body = b"".join(struct.pack(ENTRY_FMT, *e) for e in entries)
+    body += struct.pack("<%dH" % (2 * index_size), *(hash_slots + name_slots))
+    body += bytes(names)
+
+    size = struct.calcsize(HEADER_FMT) + len(body)
+    header = struct.pack(
+        HEADER_FMT,
+        IRDB_IMAGE_MAGIC,
+        IRDB_IMAGE_VERSION,
+        len(entries),
+        size,
+        len(names),
+        index_size,
+        len(protocols),
+        0,
+        *(protocols + [0] * (IRDB_MAX_DB_PROTOCOLS - len(protocols))),
+        0,
+    )
+    return header + body, len(entries)
+
+
+def format_array(symbol, image, static=False):
+    lines = [
+        "%sconst uint8_t %s[] __attribute__((aligned(4))) = {"
+        % ("static " if static else "", symbol)
+    ]
+    for i in range(0, len(image), 12):
+        chunk = image[i : i + 12]
+        lines.append("    " + " ".join("0x%02x," % b for b in chunk))
+    lines.append("};")
+    return lines
+
+
+def write_source(path, symbol, image, source, count):
+    lines = [
+        "/* 由scripts/irdb_image.py从%s生成，请勿手工修改 */"
+        % os.path.basename(source),
+        "/* %u entries, %u bytes */" % (count, len(image)),
+        "",
+        "#include <stdint.h>",
+        "",
+    ]
+    lines += format_array(symbol, image)
+    lines.append("")
+
+    with open(path, "w", encoding="utf-8") as f:
+        f.write("\n".join(lines))
+
+
+REMOTE_NAME = re.compile(r"^(.+)_([^_]+)_(\d+)_(\d+)$")
+
+
+def c_string(text):
+    return '"%s"' % text.replace("\\", "\\\\").replace('"', '\\"')
+
+
+def write_registry(path, inputs):
+    """生成内置遥控器注册表: 每个CSV一个镜像 + irdb_builtin_remotes[]"""
+    lines = [
+        "/* 由scripts/irdb_image.py生成的内置遥控器注册表，请勿手工修改 */",
+        "",
+        '#include "irdb_image.h"',
+        "#include <stddef.h>",
+        "#include <stdint.h>",
+        "",
+    ]
+    remotes = []
+    total = 0
+
+    for source in sorted(inputs):
+        stem = os.path.splitext(os.path.basename(source))[0]
+        match = REMOTE_NAME.match(stem)
+        if not match:
+            sys.exit("irdb_image: bad remote file name: %s" % source)
+
+        manufacturer, device_type, device, subdevice = match.groups()
+        if int(device) > 255 or int(subdevice) > 255:
+            sys.exit("irdb_image: device out of range: %s" % source)
+
+        with open(source, "rb") as f:
+            records = parse_csv(f.read())
+        if not records:
+            print("irdb_image: skipping empty %s" % source, file=sys.stderr)
+            continue
+
+        image, count = build_image(records)
+        symbol = "image_" + re.sub(r"[^0-9a-z]", "_", stem.lower())
+        lines.append("/* %s: %u entries, %u bytes */" % (stem, count, len(image)))
+        lines += format_array(symbol, image, static=True)
+        lines.append("")
+        remotes.append((manufacturer, device_type, device, subdevice, symbol))
+        total += len(image)
+
+    lines.append("const irdb_builtin_remote_t irdb_builtin_remotes[] = {")
+    for manufacturer, device_type, device, subdevice, symbol in remotes:
+        lines.append(
+            "    {%s, %s, %s, %s, %s},"
+            % (c_string(manufacturer), c_string(device_type), device, subdevice,
+               symbol)
+        )
+    if not remotes:
+        lines.append("    {NULL, NULL, 0, 0, NULL},")
+    lines.append("};")
+    lines.append("")
+    lines.append("const size_t irdb_builtin_remote_count = %u;" % len(remotes))
+    lines.append("")
+
+    with open(path, "w", encoding="utf-8") as f:
+        f.write("\n".join(lines))
+
+    print("irdb_image: %u remotes, %u bytes" % (len(remotes), total))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile IRDB CSV to image")
+    parser.add_argument("files", nargs="+", help="input.csv output.c, or CSVs")
+    parser.add_argument("--symbol", help="C array name (single image)")
+    parser.add_argument("--registry", metavar="OUTPUT",
+                        help="generate a builtin remote registry from CSVs")
+    args = parser.parse_args()
+
+    if args.registry:
+        write_registry(args.registry, args.files)
+        return
+
+    if len(args.files) != 2 or not args.symbol:
+        parser.error("single image needs input.csv output.c --symbol NAME")
+
+    with open(args.files[0], "rb") as f:
+        records = parse_csv(f.read())
+
+    image, count = build_image(records)
+    write_source(args.files[1], args.symbol, image, args.files[0], count)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""
+LZ压缩 - 与src/ir_lz.c相同格式的构建时实现
+
+格式见include/ir_lz.h: 控制字节(低位在前) + 8个记号，字面量1字节，
+匹配2字节(距离-1, 长度-3)，窗口256字节。
+
+用法: irdb_lz.py input output   (压缩文件，主要用于检查压缩率)
+"""
+
+import struct
+import sys
+
+LZ_WINDOW = 256
+LZ_MIN_MATCH = 3
+LZ_MAX_MATCH = LZ_MIN_MATCH + 255
+
+IRDB_IMAGE_LZ_MAGIC = 0x5A445249  # "IRDZ"
+
+
+def compress(data):
+    """贪心匹配，与ir_lz_encode的输出可以不同，解码结果一致"""
+    out = bytearray()
+    pos = 0
+    group = None
+    tokens = 0
+
+    while pos < len(data):
+        if tokens == 0:
+            group = len(out)
+            out.append(0)
+
+        limit = min(LZ_MAX_MATCH, len(data) - pos)
+        best = 0
+        dist = 0
+        for d in range(1, min(pos, LZ_WINDOW) + 1):
+            n = 0
+            while n < limit and data[pos - d + n] == data[pos + n]:
+                n += 1
+            if n > best:
+                best = n
+                dist = d
+                if best == limit:
+                    break
+
+        if best >= LZ_MIN_MATCH:
+            out[group] |= 1 << tokens
+            out += bytes([dist - 1, best - LZ_MIN_MATCH])
+            pos += best
+        else:
+            out.append(data[pos])
+            pos += 1
+        tokens = (tokens + 1) % 8
+
+    return bytes(out)
+
+
+def decompress(data, size):
+    out = bytearray()
+    i = 0
+    while len(out) < size and i < len(data):
+        flags = data[i]
+        i += 1
+        for bit in range(8):
+            if len(out) >= size or i >= len(data):
+                break
+            if flags & (1 << bit):
+                dist = data[i] + 1
+                length = data[i + 1] + LZ_MIN_MATCH
+                i += 2
+                for _ in range(length):
+                    out.append(out[-dist] if dist <= len(out) else 0)
+            else:
+                out.append(data[i])
+                i += 1
+    return bytes(out[:size])
+
+
+def compress_image(image):
+    """压缩镜像: irdb_image_lz_header_t + LZ流，压缩无益时返回原镜像"""
+    packed = struct.pack("<II", IRDB_IMAGE_LZ_MAGIC, len(image)) + compress(
+        image)
+    if decompress(packed[8:], len(image)) != image:
+        sys.exit("irdb_lz: round trip failed")
+    return packed if len(packed) < len(image) else image
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    with open(sys.argv[1], "rb") as f:
+        data = f.read()
+    packed = compress(data)
+    with open(sys.argv[2], "wb") as f:
+        f.write(packed)
+    print("irdb_lz: %u -> %u bytes" % (len(data), len(packed)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,459 @@
+#!/usr/bin/env python3
+"""
+IRP协议编译器 - 把IRP记法的协议定义编译成字节码和协议参数表(C源文件)
+
+字节码格式见include/irdb_irp.h，解释器在src/irdb_irp.c，两边必须一致。
+
+定义文件每行一个协议: <编号> <名称> <IRP>，#开头为注释，例如
+  3 JVC {38k,525}<1,-1|1,-3>(16,-8,(D:8,F:8,1,-45)+)
+
+支持的IRP子集 (覆盖IrScrutinizer协议库中脉冲距离/脉冲宽度类的协议):
+  {38.4k,564,msb,33%}  载波频率(k=kHz)、时间单位(us)、位序(默认lsb)、占空比
+  <1,-1|1,-3>          0/1两种位形态，各为一个mark加一个space
+  16,-8 / 9m / 560u    mark(正)和space(负)，无后缀以时间单位计，m/u为ms/us
+  ^108m                帧长补齐: 帧尾space延长到从帧起点算起的总时长
+  D:8 S:8 F:8 T:1      设备码/子设备码/功能码/toggle位，~取反，F:4:4取4~7位
+  1:2 0x5:4            常量
+  (..)* (..)+          整帧重复; 末尾的内层组(..)*为重复码，(..)+则首帧也含一次
+  [D:0..255,...]       参数说明，忽略
+不支持的(双相位RC5/RC6类、校验和等表达式、多于1位的位形态)报错退出，
+这类协议仍用irdb_protocol.c中的专用编码。
+
+用法: irp_compile.py protocols.irp output.c
+"""
+
+import argparse
+import re
+import sys
+
+IRP_FLAG_MSB = 0x01
+IRP_FLAG_REPEAT = 0x02
+IRP_FLAG_REPEAT_DATA = 0x04
+
+IRP_OP_END = 0x00
+IRP_OP_MARK = 0x01
+IRP_OP_SPACE = 0x02
+IRP_OP_EXTENT = 0x03
+IRP_OP_FIELD = 0x04
+IRP_OP_CONST = 0x05
+IRP_OP_REPEAT = 0x06
+
+IRP_FIELD_INVERT = 0x80
+IRP_PROGRAM_MAX = 512
+IRP_DURATION_MAX = 0xFFFFFF
+
+VARS = {"D": 0, "S": 1, "F": 2, "T": 3}
+VAR_LIMIT = {"D": 16, "S": 16, "F": 16, "T": 1}
+
+PROTOCOL_MAX_ID = 31
+
+# 与irdb_protocol_params_t的成员顺序一致
+PARAM_ORDER = ("frequency", "duty_cycle", "header_mark", "header_space",
+               "bit_mark", "bit_0_space", "bit_1_space", "gap",
+               "repeat_space", "device_bits", "subdevice_bits",
+               "function_bits", "toggle_bit")
+
+
+class IrpError(Exception):
+    pass
+
+
+class Parser:
+    """IRP递归下降解析 - 持续时间统一换算为us"""
+
+    def __init__(self, text):
+        self.s = re.sub(r"\s+", "", text)
+        self.i = 0
+        self.unit = 1.0
+
+    def peek(self):
+        return self.s[self.i] if self.i < len(self.s) else ""
+
+    def expect(self, c):
+        if self.peek() != c:
+            raise IrpError("expected '%s' at %d: %s" % (c, self.i, self.s))
+        self.i += 1
+
+    def number(self):
+        m = re.compile(r"0x[0-9a-fA-F]+|\d+(\.\d+)?").match(self.s, self.i)
+        if not m:
+            raise IrpError("expected number at %d: %s" % (self.i, self.s))
+        self.i = m.end()
+        text = m.group(0)
+        return int(text, 16) if text.startswith("0x") else float(text)
+
+    def general(self):
+        spec = {"frequency": 38000, "duty": 33, "unit": 1.0, "msb": False}
+        self.expect("{")
+        while True:
+            if self.s.startswith("msb", self.i) or self.s.startswith("lsb",
+                                                                     self.i):
+                spec["msb"] = self.s.startswith("msb", self.i)
+                self.i += 3
+            else:
+                value = self.number()
+                if self.peek() == "k":
+                    self.i += 1
+                    spec["frequency"] = int(round(value * 1000))
+                elif self.peek() == "%":
+                    self.i += 1
+                    spec["duty"] = int(value)
+                else:
+                    spec["unit"] = value
+            if self.peek() != ",":
+                break
+            self.i += 1
+        self.expect("}")
+        self.unit = spec["unit"]
+        return spec
+
+    def time(self):
+        value = self.number()
+        if self.peek() == "m":
+            self.i += 1
+            us = value * 1000
+        elif self.peek() == "u":
+            self.i += 1
+            us = value
+        else:
+            us = value * self.unit
+        us = int(round(us))
+        if us <= 0 or us > IRP_DURATION_MAX:
+            raise IrpError("duration out of range: %s" % self.s)
+        return us
+
+    def duration(self):
+        mark = True
+        if self.peek() == "-":
+            self.i += 1
+            mark = False
+        return ("dur", mark, self.time())
+
+    def bitspec(self):
+        alts = []
+        self.expect("<")
+        while True:
+            alt = [self.duration()]
+            while self.peek() == ",":
+                self.i += 1
+                alt.append(self.duration())
+            alts.append(alt)
+            if self.peek() != "|":
+                break
+            self.i += 1
+        self.expect(">")
+        if len(alts) != 2:
+            raise IrpError("only 1-bit bitspecs <zero|one> are supported")
+        for alt in alts:
+            if len(alt) != 2 or not alt[0][1] or alt[1][1]:
+                raise IrpError("bitspec symbols must be one mark and one "
+                               "space (bi-phase coding is not supported)")
+        return [(alt[0][2], alt[1][2]) for alt in alts]
+
+    def field(self):
+        invert = False
+        if self.peek() == "~":
+            self.i += 1
+            invert = True
+        c = self.peek()
+        if c in VARS:
+            self.i += 1
+            source = c
+        elif c.isdigit():
+            source = int(self.number())
+        else:
+            raise IrpError("unsupported expression at %d: %s" % (self.i,
+                                                                  self.s))
+        if self.peek() != ":":
+            raise IrpError("expressions are not supported at %d: %s" %
+                           (self.i, self.s))
+        self.i += 1
+        width = int(self.number())
+        offset = 0
+        if self.peek() == ":":
+            self.i += 1
+            offset = int(self.number())
+        if width < 1 or width > 32:
+            raise IrpError("bad field width: %s" % self.s)
+        if isinstance(source, str):
+            if offset + width > VAR_LIMIT[source]:
+                raise IrpError("%s:%u:%u exceeds %u bits" %
+                               (source, width, offset, VAR_LIMIT[source]))
+            return ("field", source, width, offset, invert)
+        value = (source >> offset) & ((1 << width) - 1)
+        return ("const", value ^ ((1 << width) - 1) if invert else value,
+                width)
+
+    def element(self):
+        c = self.peek()
+        if c == "(":
+            return self.group()
+        if c == "^":
+            self.i += 1
+            return ("extent", self.time())
+        if c == "-":
+            return self.duration()
+        if c == "~" or c in VARS:
+            return self.field()
+        m = re.compile(r"(0x[0-9a-fA-F]+|\d+(\.\d+)?)(.)").match(self.s,
+                                                                 self.i)
+        if m and m.group(3) == ":":
+            return self.field()
+        return self.duration()
+
+    def group(self):
+        items = []
+        self.expect("(")
+        while True:
+            items.append(self.element())
+            if self.peek() != ",":
+                break
+            self.i += 1
+        self.expect(")")
+        if self.peek() == ":":
+            raise IrpError("expressions such as (D^F):8 are not supported")
+        repeat = None
+        if self.peek() and self.peek() in "*+":
+            repeat = self.peek()
+            self.i += 1
+        return ("group", items, repeat)
+
+    def parse(self):
+        general = self.general()
+        bits = self.bitspec()
+        body = self.group()
+        if self.peek() == "[":
+            end = self.s.find("]", self.i)
+            if end < 0:
+                raise IrpError("unterminated parameter spec: %s" % self.s)
+            self.i = end + 1
+        if self.i != len(self.s):
+            raise IrpError("trailing text at %d: %s" % (self.i, self.s))
+        return general, bits, body
+
+
+def sections(body):
+    """拆成首帧和重复码两段"""
+    _, items, repeat = body
+    inner = [it for it in items if it[0] == "group"]
+    if not inner:
+        return items, None
+    if len(inner) > 1 or items[-1][0] != "group" or repeat:
+        raise IrpError("only one trailing repeat group is supported")
+    _, rep_items, rep = inner[0]
+    if any(it[0] == "group" for it in rep_items):
+        raise IrpError("nested repeat groups are not supported")
+    head = items[:-1]
+    if rep == "+" or not head:
+        return head + rep_items, rep_items
+    return head, rep_items
+
+
+def normalize(items, what):
+    """合并相邻同电平的持续时间并检查电平交替 - 位形态以mark开始、space
+    结束，其后的space只能是帧尾(并入帧间隔)"""
+    out = []
+    for it in items:
+        if (it[0] == "dur" and out and out[-1][0] == "dur" and
+                out[-1][1] == it[1]):
+            out[-1] = ("dur", it[1], out[-1][2] + it[2])
+        else:
+            out.append(it)
+
+    level = False  # 上一个电平，帧前视为space
+    trailing = False
+    for n, it in enumerate(out):
+        if it[0] == "extent":
+            if n != len(out) - 1:
+                raise IrpError("%s: extent must end the frame" % what)
+            continue
+        if trailing:
+            raise IrpError("%s: space after a bit field must end the frame"
+                           % what)
+        if it[0] != "dur":
+            if level:
+                raise IrpError("%s: bit field right after a mark" % what)
+        elif it[1] and level:
+            raise IrpError("%s: adjacent marks" % what)
+        elif not it[1] and not level:
+            if n == 0:
+                raise IrpError("%s: frame starts with a space" % what)
+            trailing = True
+        level = it[0] == "dur" and it[1]
+    if not any(it[0] in ("field", "const") or it[0] == "dur" and it[1]
+               for it in out):
+        raise IrpError("%s: frame has no marks" % what)
+    return out
+
+
+def u24(value):
+    return [value & 0xFF, (value >> 8) & 0xFF, value >> 16]
+
+
+def assemble(items):
+    code = []
+    for it in items:
+        if it[0] == "dur":
+            code += [IRP_OP_MARK if it[1] else IRP_OP_SPACE] + u24(it[2])
+        elif it[0] == "extent":
+            code += [IRP_OP_EXTENT] + u24(it[1])
+        elif it[0] == "field":
+            _, var, width, offset, invert = it
+            code += [IRP_OP_FIELD,
+                     VARS[var] | (IRP_FIELD_INVERT if invert else 0), width,
+                     offset]
+        else:
+            _, value, width = it
+            code += [IRP_OP_CONST, width] + list(value.to_bytes(4, "little"))
+    return code
+
+
+def frame_params(general, bits, intro, repeat):
+    """字节码之外的协议参数 - 位数按字段覆盖的最高位，其余用于帧结束判定、
+    发送间隔和Pronto导出"""
+    widths = {v: 0 for v in VARS}
+    for it in intro + (repeat or []):
+        if it[0] == "field":
+            widths[it[1]] = max(widths[it[1]], it[2] + it[3])
+    if widths["F"] == 0:
+        raise IrpError("protocol has no F field")
+
+    def gap_of(items):
+        if items[-1][0] == "extent":
+            return items[-1][1]
+        if items[-1][0] == "dur" and not items[-1][1]:
+            return items[-1][2]
+        return 0
+
+    p = {
+        "frequency": general["frequency"],
+        "duty_cycle": general["duty"],
+        "bit_mark": bits[0][0],
+        "bit_0_space": bits[0][1],
+        "bit_1_space": bits[1][1],
+        "gap": gap_of(intro),
+        "device_bits": widths["D"],
+        "subdevice_bits": widths["S"],
+        "function_bits": widths["F"],
+        "toggle_bit": widths["T"] > 0,
+    }
+    if intro[0][0] == "dur" and len(intro) > 1 and intro[1][0] == "dur":
+        p["header_mark"] = intro[0][2]
+        p["header_space"] = intro[1][2]
+    ditto = repeat and not any(it[0] == "field" for it in repeat)
+    if ditto:
+        spaces = [it[2] for it in repeat if it[0] == "dur" and not it[1]]
+        p["repeat_space"] = spaces[0] if spaces else repeat[0][2]
+    return p
+
+
+def compile_irp(text, what):
+    general, bits, body = Parser(text).parse()
+    intro, repeat = sections(body)
+    intro = normalize(intro, what)
+    repeat = normalize(repeat, what + " repeat") if repeat else None
+
+    flags = IRP_FLAG_MSB if general["msb"] else 0
+    code = []
+    for mark, space in bits:
+        code += u24(mark) + u24(space)
+    code += assemble(intro)
+    if repeat:
+        flags |= IRP_FLAG_REPEAT
+        if any(it[0] == "field" for it in repeat):
+            flags |= IRP_FLAG_REPEAT_DATA
+        code += [IRP_OP_REPEAT] + assemble(repeat)
+    program = [flags] + code + [IRP_OP_END]
+
+    if len(program) > IRP_PROGRAM_MAX:
+        raise IrpError("%s: program too large (%u bytes)" % (what,
+                                                              len(program)))
+    return program, frame_params(general, bits, intro, repeat)
+
+
+def parse_definitions(path):
+    protocols = []
+    with open(path, encoding="utf-8") as f:
+        for lineno, line in enumerate(f, 1):
+            line = line.split("#", 1)[0].strip()
+            if not line:
+                continue
+            parts = line.split(None, 2)
+            where = "%s:%u" % (path, lineno)
+            if len(parts) != 3 or not parts[0].isdigit():
+                sys.exit("irp_compile: %s: expected '<id> <name> <irp>'" %
+                         where)
+            pid = int(parts[0])
+            if pid > PROTOCOL_MAX_ID or any(p[0] == pid for p in protocols):
+                sys.exit("irp_compile: %s: bad or duplicate id %u" %
+                         (where, pid))
+            try:
+                program, params = compile_irp(parts[2], parts[1])
+            except IrpError as e:
+                sys.exit("irp_compile: %s: %s" % (where, e))
+            protocols.append((pid, parts[1], parts[2], program, params))
+    return protocols
+
+
+def c_ident(name):
+    return re.sub(r"[^0-9A-Za-z]", "_", name)
+
+
+def write_source(path, source, protocols):
+    lines = [
+        "/* 由scripts/irp_compile.py从%s生成，请勿手工修改 */" % source,
+        "",
+        '#include "irdb_irp.h"',
+        "",
+    ]
+    total = 0
+    for pid, name, irp, program, _ in protocols:
+        total += len(program)
+        lines.append("/* %s */" % irp)
+        lines.append("static const uint8_t irp_%s[] = {" % c_ident(name))
+        for i in range(0, len(program), 12):
+            lines.append("    " + " ".join("0x%02x," % b
+                                           for b in program[i : i + 12]))
+        lines.append("};")
+        lines.append("")
+
+    lines.append("const irdb_protocol_params_t irdb_irp_protocols[] = {")
+    for pid, name, irp, program, params in protocols:
+        lines.append("    {")
+        lines.append("        .protocol_id = %u," % pid)
+        lines.append('        .name = "%s",' % name)
+        lines.append("        .coding = IRDB_CODING_IRP,")
+        for key in PARAM_ORDER:
+            if key not in params:
+                continue
+            value = params[key]
+            if isinstance(value, bool):
+                value = "true" if value else "false"
+            lines.append("        .%s = %s," % (key, value))
+        lines.append("        .program = irp_%s," % c_ident(name))
+        lines.append("    },")
+    if not protocols:
+        lines.append("    {0},")
+    lines.append("};")
+    lines.append("")
+    lines.append("const size_t irdb_irp_protocol_count = %u;" % len(protocols))
+    lines.append("")
+
+    with open(path, "w", encoding="utf-8") as f:
+        f.write("\n".join(lines))
+
+    print("irp_compile: %u protocols, %u bytes of bytecode" %
+          (len(protocols), total))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile IRP protocols")
+    parser.add_argument("input", help="protocol definitions (.irp)")
+    parser.add_argument("output", help="generated C source")
+    args = parser.parse_args()
+
+    write_source(args.output, args.input, parse_definitions(args.input))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,159 @@
+/**
+ * @file ir_ac.c
+ * @brief 空调状态编码 - 协议注册表与公共帧编码
+ */
+
+#include "ir_ac.h"
+#include "ir_hal.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(ir_ac, LOG_LEVEL_INF);
+
+/* 协议注册表 - 新模块在此登记 */
+static const ir_ac_protocol_t *const ac_protocols[] = {
+    &ir_ac_gree,
+};
+
+/* 按名称查找协议 */
+const ir_ac_protocol_t *ir_ac_find(const char *name) {
+  for (size_t i = 0; name && i < ARRAY_SIZE(ac_protocols); i++) {
+    if (strcmp(ac_protocols[i]->name, name) == 0) {
+      return ac_protocols[i];
+    }
+  }
+  return NULL;
+}
+
+/* 按序号获取协议 */
+const ir_ac_protocol_t *ir_ac_get(size_t index) {
+  return index < ARRAY_SIZE(ac_protocols) ? ac_protocols[index] : NULL;
+}
+
+/* 默认状态 */
+void ir_ac_state_default(ir_ac_state_t *state) {
+  memset(state, 0, sizeof(*state));
+  state->mode = IR_AC_MODE_COOL;
+  state->temp_c = 26;
+  state->fan = IR_AC_FAN_AUTO;
+}
+
+/* 生成帧字节 */
+int ir_ac_build(const ir_ac_protocol_t *proto, const ir_ac_state_t *state,
+                uint8_t *bytes, size_t size) {
+  if (!proto || !state || !bytes || size < proto->frame_bytes) {
+    return -EINVAL;
+  }
+  if (state->mode >= IR_AC_MODE_COUNT || state->fan >= IR_AC_FAN_COUNT ||
+      state->temp_c < proto->temp_min || state->temp_c > proto->temp_max) {
+    return -EINVAL;
+  }
+
+  memset(bytes, 0, proto->frame_bytes);
+  proto->build(state, bytes);
+  return proto->frame_bytes;
+}
+
+/* 帧的时序数 - 每段: 引导码2 + 每位2 + 段尾mark和space 2 */
+static uint32_t layout_timings(const ir_ac_layout_t *layout) {
+  uint32_t count = 0;
+
+  for (uint8_t s = 0; s < layout->section_count; s++) {
+    const ir_ac_section_t *sec = &layout->sections[s];
+    count += (sec->header ? 2 : 0) + 16 * sec->count + 2 * sec->tail_bits + 2;
+  }
+  return count - 1; // 帧尾space不输出
+}
+
+static ir_timing_t *put_bits(const ir_ac_layout_t *layout, ir_timing_t *out,
+                             uint32_t value, uint8_t bits) {
+  const ir_timing_t mark = ir_timing_pack(layout->bit_mark);
+  const ir_timing_t zero = ir_timing_pack(layout->zero_space);
+  const ir_timing_t one = ir_timing_pack(layout->one_space);
+
+  for (uint8_t i = 0; i < bits; i++) {
+    uint8_t bit = layout->msb_first ? bits - 1 - i : i;
+
+    *out++ = mark;
+    *out++ = (value >> bit) & 1 ? one : zero;
+  }
+  return out;
+}
+
+/* 编码为原始时序 - 长度按布局预先算出，逐位写入时不再检查边界 */
+int ir_ac_encode(const ir_ac_protocol_t *proto, const ir_ac_state_t *state,
+                 ir_timing_t *timings_out, uint32_t *length_out,
+                 uint32_t max_length) {
+  uint8_t bytes[IR_AC_FRAME_MAX_BYTES];
+
+  if (!timings_out || !length_out) {
+    return -EINVAL;
+  }
+
+  int ret = ir_ac_build(proto, state, bytes, sizeof(bytes));
+  if (ret < 0) {
+    return ret;
+  }
+
+  const ir_ac_layout_t *layout = &proto->layout;
+  uint32_t count = layout_timings(layout);
+  if (count > max_length) {
+    return -ENOMEM;
+  }
+
+  ir_timing_t *out = timings_out;
+  for (uint8_t s = 0; s < layout->section_count; s++) {
+    const ir_ac_section_t *sec = &layout->sections[s];
+
+    if (sec->header) {
+      *out++ = ir_timing_pack(layout->header_mark);
+      *out++ = ir_timing_pack(layout->header_space);
+    }
+    for (uint8_t i = 0; i < sec->count; i++) {
+      out = put_bits(layout, out, bytes[sec->offset + i], 8);
+    }
+    out = put_bits(layout, out, sec->tail_value, sec->tail_bits);
+
+    *out++ = ir_timing_pack(layout->bit_mark);
+    if (s + 1 < layout->section_count) {
+      *out++ = ir_timing_pack(sec->space_us);
+    }
+  }
+
+  *length_out = count;
+  return 0;
+}
+
+/* 异步发送 */
+int ir_ac_send(const ir_ac_protocol_t *proto, const ir_ac_state_t *state,
+               uint8_t channels, ir_tx_done_callback_t callback,
+               void *user_data) {
+  if (!proto || !state || channels == 0 || (channels & ~IR_HAL_TX_CH_ALL)) {
+    return -EINVAL;
+  }
+
+  ir_tx_frame_t *frame = ir_tx_frame_alloc();
+  if (!frame) {
+    return -ENOBUFS;
+  }
+
+  int ret = ir_ac_encode(proto, state, frame->timings, &frame->timing_count,
+                         IR_TX_FRAME_MAX_TIMINGS);
+  if (ret < 0) {
+    LOG_ERR("%s: encoding failed: %d", proto->name, ret);
+    ir_tx_frame_free(frame);
+    return ret;
+  }
+
+  const ir_ac_layout_t *layout = &proto->layout;
+  frame->carrier_freq = proto->carrier_freq;
+  frame->duty_cycle = proto->duty_cycle;
+  frame->channels = channels;
+  frame->gap_us = layout->sections[layout->section_count - 1].space_us;
+  frame->priority = IR_TX_PRIO_INTERACTIVE;
+  frame->callback = callback;
+  frame->user_data = user_data;
+
+  return ir_tx_queue_submit(frame);
+}
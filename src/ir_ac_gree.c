@@ -0,0 +1,68 @@
+/**
+ * @file ir_ac_gree.c
+ * @brief 格力(Gree YAW1F/YBOF)空调协议模块
+ *
+ * 8字节低位先发，分两段: 字节0-3 + 固定位0b010，间隔约20ms后发字节4-7。
+ * 校验和为字节0-3低半字节与字节4-6高半字节之和加10，放在字节7高半字节。
+ */
+
+#include "ir_ac.h"
+
+#define GREE_BYTES 8
+#define GREE_TEMP_MIN 16
+#define GREE_TEMP_MAX 30
+#define GREE_MSG_SPACE_US 19980
+
+/* 模式和风速编码与ir_ac_mode_t/ir_ac_fan_t同序，直接写入 */
+static void gree_build(const ir_ac_state_t *state, uint8_t *bytes) {
+  bytes[0] = (state->mode & 0x07) | (state->power ? 0x08 : 0) |
+             (state->fan << 4) | (state->swing ? 0x40 : 0) |
+             (state->flags & IR_AC_FLAG_SLEEP ? 0x80 : 0);
+  bytes[1] = state->temp_c - GREE_TEMP_MIN;
+  bytes[2] = (state->flags & IR_AC_FLAG_TURBO ? 0x10 : 0) |
+             (state->flags & IR_AC_FLAG_LIGHT ? 0x20 : 0) | 0x40; // ModelA
+  bytes[3] = 0x50;
+  bytes[4] = state->swing ? 0x01 : 0x00; // 上下扫风: 自动
+  bytes[5] = 0x20;
+
+  uint8_t sum = 10;
+  for (uint8_t i = 0; i < 4; i++) {
+    sum += bytes[i] & 0x0F;
+  }
+  for (uint8_t i = 4; i < 7; i++) {
+    sum += bytes[i] >> 4;
+  }
+  bytes[7] = (sum & 0x0F) << 4;
+}
+
+const ir_ac_protocol_t ir_ac_gree = {
+    .name = "gree",
+    .carrier_freq = 38000,
+    .duty_cycle = 50,
+    .frame_bytes = GREE_BYTES,
+    .temp_min = GREE_TEMP_MIN,
+    .temp_max = GREE_TEMP_MAX,
+    .layout =
+        {
+            .header_mark = 9000,
+            .header_space = 4500,
+            .bit_mark = 620,
+            .zero_space = 540,
+            .one_space = 1600,
+            .msb_first = false,
+            .section_count = 2,
+            .sections =
+                {
+                    {.offset = 0,
+                     .count = 4,
+                     .tail_bits = 3,
+                     .tail_value = 0x02,
+                     .header = true,
+                     .space_us = GREE_MSG_SPACE_US},
+                    {.offset = 4,
+                     .count = 4,
+                     .space_us = GREE_MSG_SPACE_US},
+                },
+        },
+    .build = gree_build,
+};
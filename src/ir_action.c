@@ -0,0 +1,205 @@
+/**
+ * @file ir_action.c
+ * @brief 动作表实现 - 每个槽位一段条目下标到绑定序号的数组
+ */
+
+#include "ir_action.h"
+#include "ir_mem.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(ir_action, LOG_LEVEL_INF);
+
+/* 编译结果 - slots[r][i]为槽位r第i个条目的绑定序号+1，0为没有绑定 */
+static struct {
+  const ir_action_binding_t *bindings;
+  size_t count;
+  uint16_t *slots[IR_SERVICE_MAX_REMOTES];
+  uint32_t lengths[IR_SERVICE_MAX_REMOTES];
+  uint16_t *table; // 各槽位的数组连续分配
+  ir_action_stats_t stats;
+} actions;
+
+/* 编译与分派串行，分派只在查表期间持有 */
+static K_MUTEX_DEFINE(action_mutex);
+
+/* 一个绑定最多匹配的条目数 (各遥控器的同名条目) */
+#define ACTION_MATCH_MAX 16
+
+/* 第i个绑定匹配的功能编号，返回写入ids的个数 */
+static size_t action_match(size_t i, int32_t *ids, bool verbose) {
+  const char *function = actions.bindings[i].function;
+  int n = ir_service_find_function_ids(function, ids, ACTION_MATCH_MAX);
+
+  if (n <= 0) {
+    if (verbose) {
+      LOG_WRN("Action '%s' not bound: %d", function, n < 0 ? n : -ENOENT);
+    }
+    return 0;
+  }
+  if (n > ACTION_MATCH_MAX) {
+    if (verbose) {
+      LOG_WRN("Action '%s' matches %d entries, binding %d", function, n,
+              ACTION_MATCH_MAX);
+    }
+    n = ACTION_MATCH_MAX;
+  }
+  return n;
+}
+
+/* 清空编译结果，重新编译成功前不分派任何动作 */
+static void action_clear(void) {
+  irdb_heap_free(actions.table);
+  actions.table = NULL;
+  memset(actions.slots, 0, sizeof(actions.slots));
+  memset(actions.lengths, 0, sizeof(actions.lengths));
+  actions.stats.compiled = 0;
+  actions.stats.entries = 0;
+  actions.stats.table_bytes = 0;
+}
+
+/* 按保存的绑定建表 - 先求各槽位用到的最大条目下标，再一次分配。
+ * 版本先于查找读取，其间活动集变化时下次分派再编译。分配失败时旧表
+ * 已对不上活动集或绑定，一并清空 */
+static int action_build(bool verbose) {
+  uint32_t gen = ir_service_generation();
+  uint32_t lengths[IR_SERVICE_MAX_REMOTES] = {0};
+  int32_t ids[ACTION_MATCH_MAX];
+  size_t total = 0;
+  uint16_t compiled = 0;
+  uint16_t entries = 0;
+
+  for (size_t i = 0; i < actions.count; i++) {
+    size_t n = action_match(i, ids, verbose);
+
+    for (size_t k = 0; k < n; k++) {
+      size_t r = ids[k] >> IR_SERVICE_ID_SHIFT;
+      uint32_t index = ids[k] & BIT_MASK(IR_SERVICE_ID_SHIFT);
+
+      if (r < IR_SERVICE_MAX_REMOTES) {
+        lengths[r] = MAX(lengths[r], index + 1);
+      }
+    }
+  }
+  for (size_t r = 0; r < IR_SERVICE_MAX_REMOTES; r++) {
+    total += lengths[r];
+  }
+
+  uint16_t *table = NULL;
+  if (total > 0) {
+    table = irdb_heap_calloc(total, sizeof(uint16_t));
+    if (!table) {
+      action_clear();
+      return -ENOMEM;
+    }
+  }
+
+  action_clear();
+  actions.table = table;
+  for (size_t r = 0; r < IR_SERVICE_MAX_REMOTES; r++) {
+    actions.slots[r] = lengths[r] ? table : NULL;
+    actions.lengths[r] = lengths[r];
+    table += lengths[r];
+  }
+
+  /* 第二遍填表 - 名称查找结果与第一遍相同，除非其间活动集变化 */
+  for (size_t i = 0; i < actions.count; i++) {
+    size_t n = action_match(i, ids, false);
+    bool bound = false;
+
+    for (size_t k = 0; k < n; k++) {
+      size_t r = ids[k] >> IR_SERVICE_ID_SHIFT;
+      uint32_t index = ids[k] & BIT_MASK(IR_SERVICE_ID_SHIFT);
+
+      if (r >= IR_SERVICE_MAX_REMOTES || index >= actions.lengths[r]) {
+        continue;
+      }
+      if (actions.slots[r][index] == 0) {
+        entries++;
+      }
+      actions.slots[r][index] = i + 1;
+      bound = true;
+    }
+    compiled += bound;
+  }
+
+  actions.stats.generation = gen;
+  actions.stats.bindings = actions.count;
+  actions.stats.compiled = compiled;
+  actions.stats.entries = entries;
+  actions.stats.table_bytes = total * sizeof(uint16_t);
+  actions.stats.compiles++;
+  return compiled;
+}
+
+int ir_action_compile(const ir_action_binding_t *bindings, size_t count) {
+  if ((!bindings && count > 0) || count >= UINT16_MAX) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&action_mutex, K_FOREVER);
+  actions.bindings = bindings;
+  actions.count = count;
+  int ret = action_build(true);
+  k_mutex_unlock(&action_mutex);
+
+  if (ret >= 0) {
+    LOG_INF("Compiled %d/%zu actions onto %u entries, %u bytes", ret, count,
+            actions.stats.entries, actions.stats.table_bytes);
+  }
+  return ret;
+}
+
+/* 查表 - 活动集变化后先重新编译 */
+static const ir_action_binding_t *action_lookup(int32_t id) {
+  const ir_action_binding_t *binding = NULL;
+
+  k_mutex_lock(&action_mutex, K_FOREVER);
+  if (actions.stats.generation != ir_service_generation() &&
+      action_build(false) < 0) {
+    LOG_ERR("Action table rebuild failed");
+  }
+
+  size_t r = id >> IR_SERVICE_ID_SHIFT;
+  uint32_t index = id & BIT_MASK(IR_SERVICE_ID_SHIFT);
+
+  if (id >= 0 && r < IR_SERVICE_MAX_REMOTES && index < actions.lengths[r] &&
+      actions.slots[r][index] != 0) {
+    binding = &actions.bindings[actions.slots[r][index] - 1];
+  }
+  k_mutex_unlock(&action_mutex);
+  return binding;
+}
+
+int ir_action_dispatch(const ir_service_press_t *press) {
+  const ir_action_binding_t *binding = action_lookup(press->id);
+
+  if (!binding ||
+      (!press->new_press && !(binding->flags & IR_ACTION_REPEAT))) {
+    actions.stats.unbound++;
+    return 0;
+  }
+
+  actions.stats.dispatched++;
+  switch (binding->kind) {
+  case IR_ACTION_HANDLER:
+    binding->handler(binding, press);
+    break;
+  case IR_ACTION_MACRO: {
+    int ret = ir_macro_run(binding->macro, NULL, NULL);
+    if (ret < 0) {
+      LOG_DBG("Macro for '%s' not started: %d", binding->function, ret);
+    }
+    break;
+  }
+  }
+  return 1;
+}
+
+void ir_action_get_stats(ir_action_stats_t *stats) {
+  k_mutex_lock(&action_mutex, K_FOREVER);
+  *stats = actions.stats;
+  k_mutex_unlock(&action_mutex);
+}
@@ -0,0 +1,396 @@
+/**
+ * @file ir_adapt.c
+ * @brief 时序自适应实现 - 按(协议, 设备)的时序统计，定期保存到LittleFS
+ */
+
+#include "ir_adapt.h"
+#include "ir_fs.h"
+#include "ir_io.h"
+#include <string.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(ir_adapt, LOG_LEVEL_INF);
+
+#define ADAPT_MAGIC 0x44415249 // "IRAD"
+#define ADAPT_VERSION 1
+#define ADAPT_WEIGHT 8      // 满这么多帧后按1/8指数平均，之前为算术平均
+#define ADAPT_APPLY_EVERY 8 // 每对每这么多帧重算一次窗口
+#define ADAPT_RELAX_WINDOW_MS 2000 // 连续失败须落在此时间内
+#define ADAPT_RELAX_S 60           // 暂时恢复标称窗口的时长
+
+#ifdef CONFIG_IR_ADAPT_SAVE_INTERVAL
+#define ADAPT_SAVE_INTERVAL_S CONFIG_IR_ADAPT_SAVE_INTERVAL
+#else
+#define ADAPT_SAVE_INTERVAL_S 600
+#endif
+
+/* 文件头，之后为pairs个记录(结构体原样) */
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint8_t pairs;
+  uint8_t classes;    // IRDB_ADAPT_CLASSES，类别变化时失效
+  uint16_t pair_size; // sizeof(ir_adapt_pair_t)
+  uint16_t reserved;
+} adapt_file_t;
+
+/* 统计表和窗口替换在解码工作队列、保存作业和shell之间串行 */
+static K_MUTEX_DEFINE(adapt_mutex);
+static struct {
+  ir_adapt_pair_t pairs[IR_ADAPT_PAIRS];
+  bool dirty;
+  bool relaxed;        // 暂时用标称窗口
+  uint8_t misses;      // 连续失败帧数
+  int64_t first_miss;  // 本轮连续失败的开始(ms)
+} adapt;
+
+/* 保存在保存作业与shell之间串行，快照避免持adapt_mutex写文件 */
+static K_MUTEX_DEFINE(adapt_save_mutex);
+static ir_adapt_pair_t snap_pairs[IR_ADAPT_PAIRS];
+
+static void adapt_save_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(adapt_save_work, adapt_save_handler);
+static void adapt_restore_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(adapt_restore_work, adapt_restore_handler);
+
+static ir_io_job_t adapt_save_job;
+
+/* 平均 - 前ADAPT_WEIGHT帧为算术平均，之后为指数平均 */
+static uint16_t adapt_mean(uint16_t mean, uint16_t value, uint32_t frames) {
+  int32_t weight = MIN(frames, ADAPT_WEIGHT);
+
+  return mean + ((int32_t)value - (int32_t)mean) / weight;
+}
+
+/* 按协议取成熟各对的并集加余量替换窗口，没有成熟的对时恢复标称窗口
+ * (调用者持adapt_mutex) */
+static void adapt_apply(uint16_t protocol) {
+  irdb_window_t win[IRDB_ADAPT_CLASSES] = {0};
+  bool any = false;
+
+  if (adapt.relaxed) {
+    return;
+  }
+
+  for (size_t i = 0; i < ARRAY_SIZE(adapt.pairs); i++) {
+    const ir_adapt_pair_t *p = &adapt.pairs[i];
+
+    if (p->frames < IR_ADAPT_MIN_FRAMES || p->protocol != protocol) {
+      continue;
+    }
+    for (int c = 0; c < IRDB_ADAPT_CLASSES; c++) {
+      if (p->hi_us[c] == 0) {
+        continue;
+      }
+      if (win[c].hi_us == 0) {
+        win[c].lo_us = p->lo_us[c];
+        win[c].hi_us = p->hi_us[c];
+      } else {
+        win[c].lo_us = MIN(win[c].lo_us, p->lo_us[c]);
+        win[c].hi_us = MAX(win[c].hi_us, p->hi_us[c]);
+      }
+    }
+    any = true;
+  }
+
+  if (!any) {
+    irdb_adapt_windows(protocol, NULL);
+    return;
+  }
+
+  for (int c = 0; c < IRDB_ADAPT_CLASSES; c++) {
+    uint32_t margin = (uint32_t)win[c].hi_us * IR_ADAPT_MARGIN / 100;
+
+    if (win[c].hi_us == 0) {
+      continue;
+    }
+    win[c].lo_us -= MIN(margin, win[c].lo_us);
+    win[c].hi_us = MIN(win[c].hi_us + margin, UINT16_MAX);
+  }
+
+  int ret = irdb_adapt_windows(protocol, win);
+  if (ret < 0) {
+    LOG_DBG("Protocol %u keeps nominal windows: %d", protocol, ret);
+  }
+}
+
+/* 对统计表中出现的每个协议替换窗口 (调用者持adapt_mutex) */
+static void adapt_apply_all(void) {
+  for (size_t i = 0; i < ARRAY_SIZE(adapt.pairs); i++) {
+    bool seen = adapt.pairs[i].frames == 0;
+
+    for (size_t j = 0; !seen && j < i; j++) {
+      seen = adapt.pairs[j].frames > 0 &&
+             adapt.pairs[j].protocol == adapt.pairs[i].protocol;
+    }
+    if (!seen) {
+      adapt_apply(adapt.pairs[i].protocol);
+    }
+  }
+}
+
+/* 恢复标称窗口 (调用者持adapt_mutex) */
+static void adapt_clear_windows(void) {
+  for (size_t i = 0; i < ARRAY_SIZE(adapt.pairs); i++) {
+    if (adapt.pairs[i].frames > 0) {
+      irdb_adapt_windows(adapt.pairs[i].protocol, NULL);
+    }
+  }
+}
+
+void ir_adapt_note(const irdb_entry_t *code, const ir_timing_t *timings,
+                   uint32_t length) {
+  irdb_timing_profile_t profile;
+
+  if (irdb_timing_profile(code->protocol, timings, length, &profile) < 0) {
+    return; // IRP协议不参与
+  }
+
+  size_t min = 0;
+  size_t i;
+
+  k_mutex_lock(&adapt_mutex, K_FOREVER);
+  adapt.misses = 0;
+
+  /* 表满时替换帧数最少的一对，它成熟过时其协议的窗口随之重算 */
+  for (i = 0; i < ARRAY_SIZE(adapt.pairs); i++) {
+    const ir_adapt_pair_t *p = &adapt.pairs[i];
+
+    if (p->frames > 0 && p->protocol == code->protocol &&
+        p->device == code->device) {
+      break;
+    }
+    if (p->frames < adapt.pairs[min].frames) {
+      min = i;
+    }
+  }
+  if (i == ARRAY_SIZE(adapt.pairs)) {
+    ir_adapt_pair_t old = adapt.pairs[min];
+
+    i = min;
+    memset(&adapt.pairs[i], 0, sizeof(adapt.pairs[i]));
+    adapt.pairs[i].protocol = code->protocol;
+    adapt.pairs[i].device = code->device;
+    if (old.frames >= IR_ADAPT_MIN_FRAMES) {
+      adapt_apply(old.protocol);
+    }
+  }
+
+  ir_adapt_pair_t *p = &adapt.pairs[i];
+  uint32_t frames = p->frames < UINT32_MAX ? p->frames + 1 : p->frames;
+
+  p->scale = frames == 1 ? profile.scale
+                         : adapt_mean(p->scale, profile.scale, frames);
+  for (int c = 0; c < IRDB_ADAPT_CLASSES; c++) {
+    if (profile.hi_us[c] == 0) {
+      continue;
+    }
+    if (p->hi_us[c] == 0) {
+      p->lo_us[c] = profile.lo_us[c];
+      p->hi_us[c] = profile.hi_us[c];
+    } else {
+      p->lo_us[c] = adapt_mean(p->lo_us[c], profile.lo_us[c], frames);
+      p->hi_us[c] = adapt_mean(p->hi_us[c], profile.hi_us[c], frames);
+    }
+  }
+  p->frames = frames;
+  adapt.dirty = true;
+
+  if (frames == IR_ADAPT_MIN_FRAMES ||
+      (frames > IR_ADAPT_MIN_FRAMES && frames % ADAPT_APPLY_EVERY == 0)) {
+    adapt_apply(code->protocol);
+  }
+  k_mutex_unlock(&adapt_mutex);
+}
+
+void ir_adapt_note_miss(void) {
+  int64_t now = k_uptime_get();
+
+  k_mutex_lock(&adapt_mutex, K_FOREVER);
+  if (adapt.misses == 0 || now - adapt.first_miss > ADAPT_RELAX_WINDOW_MS) {
+    adapt.misses = 0;
+    adapt.first_miss = now;
+  }
+  adapt.misses++;
+
+  /* 可能是时序超出已学窗口的新遥控器，暂时放开让它解出并加入统计 */
+  if (adapt.misses >= IR_ADAPT_RELAX_MISSES && !adapt.relaxed) {
+    adapt_clear_windows();
+    adapt.relaxed = true;
+    k_work_reschedule(&adapt_restore_work, K_SECONDS(ADAPT_RELAX_S));
+    LOG_INF("%u frames missed, nominal windows for %u s", adapt.misses,
+            ADAPT_RELAX_S);
+  }
+  k_mutex_unlock(&adapt_mutex);
+}
+
+static void adapt_restore_handler(struct k_work *work) {
+  k_mutex_lock(&adapt_mutex, K_FOREVER);
+  adapt.relaxed = false;
+  adapt.misses = 0;
+  adapt_apply_all();
+  k_mutex_unlock(&adapt_mutex);
+}
+
+bool ir_adapt_relaxed(void) {
+  k_mutex_lock(&adapt_mutex, K_FOREVER);
+  bool relaxed = adapt.relaxed;
+  k_mutex_unlock(&adapt_mutex);
+  return relaxed;
+}
+
+size_t ir_adapt_get_pairs(ir_adapt_pair_t *out, size_t max) {
+  size_t n = 0;
+
+  if (!out) {
+    return 0;
+  }
+
+  k_mutex_lock(&adapt_mutex, K_FOREVER);
+  for (size_t i = 0; i < ARRAY_SIZE(adapt.pairs) && n < max; i++) {
+    if (adapt.pairs[i].frames > 0) {
+      out[n++] = adapt.pairs[i];
+    }
+  }
+  k_mutex_unlock(&adapt_mutex);
+  return n;
+}
+
+#ifdef CONFIG_FILE_SYSTEM
+static int adapt_write(void) {
+  adapt_file_t hdr = {
+      .magic = ADAPT_MAGIC,
+      .version = ADAPT_VERSION,
+      .pairs = IR_ADAPT_PAIRS,
+      .classes = IRDB_ADAPT_CLASSES,
+      .pair_size = sizeof(ir_adapt_pair_t),
+  };
+  struct fs_file_t file;
+
+  /* 快照后释放锁，写flash时解码不被阻塞 (调用者持adapt_save_mutex) */
+  k_mutex_lock(&adapt_mutex, K_FOREVER);
+  memcpy(snap_pairs, adapt.pairs, sizeof(snap_pairs));
+  adapt.dirty = false;
+  k_mutex_unlock(&adapt_mutex);
+
+  int ret = ir_fs_mount();
+  if (ret < 0) {
+    return ret;
+  }
+
+  fs_file_t_init(&file);
+  ret = fs_open(&file, IR_ADAPT_PATH, FS_O_CREATE | FS_O_WRITE | FS_O_TRUNC);
+  if (ret < 0) {
+    LOG_ERR("Failed to create %s: %d", IR_ADAPT_PATH, ret);
+    return ret;
+  }
+
+  ssize_t written = fs_write(&file, &hdr, sizeof(hdr));
+  if (written == sizeof(hdr)) {
+    written = fs_write(&file, snap_pairs, sizeof(snap_pairs));
+  }
+  fs_close(&file);
+  if (written != sizeof(snap_pairs)) {
+    LOG_ERR("Failed to write %s: %d", IR_ADAPT_PATH, (int)written);
+    return written < 0 ? (int)written : -ENOSPC;
+  }
+  return 0;
+}
+
+static int adapt_read(void) {
+  adapt_file_t hdr;
+  struct fs_file_t file;
+
+  fs_file_t_init(&file);
+  if (ir_fs_mount() < 0 || fs_open(&file, IR_ADAPT_PATH, FS_O_READ) < 0) {
+    return -ENOENT;
+  }
+
+  ssize_t len = fs_read(&file, &hdr, sizeof(hdr));
+  if (len != sizeof(hdr) || hdr.magic != ADAPT_MAGIC ||
+      hdr.version != ADAPT_VERSION || hdr.classes != IRDB_ADAPT_CLASSES ||
+      hdr.pair_size != sizeof(ir_adapt_pair_t)) {
+    fs_close(&file);
+    LOG_WRN("Ignoring invalid %s", IR_ADAPT_PATH);
+    return -EINVAL;
+  }
+
+  /* 表改小时只取前面能放下的槽位 */
+  size_t pairs = MIN(hdr.pairs, IR_ADAPT_PAIRS);
+
+  memset(snap_pairs, 0, sizeof(snap_pairs));
+  len = fs_read(&file, snap_pairs, pairs * hdr.pair_size);
+  fs_close(&file);
+  if (len < 0) {
+    return len;
+  }
+
+  k_mutex_lock(&adapt_mutex, K_FOREVER);
+  memcpy(adapt.pairs, snap_pairs, sizeof(adapt.pairs));
+  k_mutex_unlock(&adapt_mutex);
+  return 0;
+}
+#else
+static int adapt_write(void) { return -ENOTSUP; }
+
+static int adapt_read(void) { return -ENOTSUP; }
+#endif
+
+int ir_adapt_save(void) {
+  k_mutex_lock(&adapt_save_mutex, K_FOREVER);
+  int ret = adapt_write();
+  k_mutex_unlock(&adapt_save_mutex);
+  return ret;
+}
+
+static int adapt_save_stage(ir_io_job_t *job) { return ir_adapt_save(); }
+
+/* 定期保存 - 没有新样本时不写flash; 上一次还在排队时跳过 */
+static void adapt_save_handler(struct k_work *work) {
+  k_mutex_lock(&adapt_mutex, K_FOREVER);
+  bool dirty = adapt.dirty;
+  k_mutex_unlock(&adapt_mutex);
+
+  if (dirty) {
+    ir_io_submit(&adapt_save_job);
+  }
+  k_work_schedule(&adapt_save_work, K_SECONDS(ADAPT_SAVE_INTERVAL_S));
+}
+
+int ir_adapt_init(void) {
+  ir_io_init();
+  ir_io_job_init(&adapt_save_job, adapt_save_stage, NULL, NULL);
+
+  int ret = adapt_read();
+
+  k_mutex_lock(&adapt_mutex, K_FOREVER);
+  adapt_apply_all();
+  k_mutex_unlock(&adapt_mutex);
+
+  if (ret == 0) {
+    LOG_INF("Timing statistics restored from %s", IR_ADAPT_PATH);
+  }
+
+  k_work_schedule(&adapt_save_work, K_SECONDS(ADAPT_SAVE_INTERVAL_S));
+  return ret == -ENOENT ? 0 : ret;
+}
+
+/* 持adapt_save_mutex清空并删除文件 - 正在写的保存先写完再删，排队的
+ * 保存之后取到的是清空后的快照 */
+void ir_adapt_reset(void) {
+  k_work_cancel_delayable(&adapt_restore_work);
+
+  k_mutex_lock(&adapt_save_mutex, K_FOREVER);
+  k_mutex_lock(&adapt_mutex, K_FOREVER);
+  adapt_clear_windows();
+  memset(&adapt, 0, sizeof(adapt));
+  k_mutex_unlock(&adapt_mutex);
+#ifdef CONFIG_FILE_SYSTEM
+  if (ir_fs_mount() == 0) {
+    fs_unlink(IR_ADAPT_PATH);
+  }
+#endif
+  k_mutex_unlock(&adapt_save_mutex);
+}
@@ -0,0 +1,189 @@
+/**
+ * @file ir_analytics.c
+ * @brief 单遍信号分析 - 直方图、类中心、帧数与重复周期
+ */
+
+#include "ir_analytics.h"
+#include <string.h>
+#include <zephyr/kernel.h>
+
+#if defined(__ARM_FEATURE_DSP)
+#include <cmsis_core.h>
+#endif
+
+#define PAIR_LONG_FLAGS (IR_TIMING_LONG_FLAG | (IR_TIMING_LONG_FLAG << 16))
+
+void ir_analytics_reset(ir_analytics_t *a) {
+  memset(a, 0, sizeof(*a));
+  a->min_us = UINT32_MAX;
+  a->pair_min = UINT32_MAX;
+  a->in_gap = true;
+}
+
+static inline void analytics_bin(ir_analytics_t *a, uint8_t level,
+                                 uint32_t us) {
+  uint32_t bin = MIN(us >> IR_ANALYTICS_BIN_SHIFT, IR_ANALYTICS_BINS - 1);
+
+  a->hist[level][bin]++;
+  a->bin_sum[level][bin] += us;
+}
+
+void ir_analytics_push(ir_analytics_t *a, ir_timing_t timing) {
+  uint32_t us = ir_timing_us(timing);
+  uint8_t level = a->edges & 1;
+
+  if (level == 0 && a->in_gap) {
+    if (a->frames == 0) {
+      a->first_start = a->elapsed_us;
+    }
+    a->last_start = a->elapsed_us;
+    a->frames++;
+    a->in_gap = false;
+  }
+
+  a->sum[level] += us;
+  a->min_us = MIN(a->min_us, us);
+  a->max_us = MAX(a->max_us, us);
+
+  if (level == 1 && us >= IR_ANALYTICS_FRAME_GAP_US) {
+    a->in_gap = true;
+  } else {
+    analytics_bin(a, level, us);
+  }
+
+  a->elapsed_us += us;
+  a->edges++;
+}
+
+/* 一对mark+space (低/高16位)，调用者已确认都是短格式且space不是帧间隔 */
+static inline void analytics_pair(ir_analytics_t *a, uint32_t pair) {
+  uint32_t mark = pair & 0xFFFF;
+  uint32_t space = pair >> 16;
+
+  analytics_bin(a, 0, mark);
+  analytics_bin(a, 1, space);
+  a->sum[0] += mark;
+  a->sum[1] += space;
+  a->elapsed_us += mark + space;
+
+#if defined(__ARM_FEATURE_DSP)
+  /* USUB16按半字置GE标志，SEL按标志逐半字取较小/较大值 */
+  __USUB16(pair, a->pair_min);
+  a->pair_min = __SEL(a->pair_min, pair);
+  __USUB16(pair, a->pair_max);
+  a->pair_max = __SEL(pair, a->pair_max);
+#else
+  a->min_us = MIN(a->min_us, MIN(mark, space));
+  a->max_us = MAX(a->max_us, MAX(mark, space));
+#endif
+}
+
+/* 成批输入 - 对齐到mark后每次取两对(4个时序)，帧内的短时序走快速路径，
+ * 帧起点、帧间隔和长格式时序逐个处理 */
+void ir_analytics_feed(ir_analytics_t *a, const ir_timing_t *timings,
+                       uint32_t count) {
+  uint32_t i = 0;
+
+  if (count > 0 && (a->edges & 1)) {
+    ir_analytics_push(a, timings[i++]);
+  }
+
+  for (; i + 4 <= count; i += 4) {
+    uint32_t p0, p1;
+
+    memcpy(&p0, &timings[i], sizeof(p0));
+    memcpy(&p1, &timings[i + 2], sizeof(p1));
+
+    if (a->in_gap || ((p0 | p1) & PAIR_LONG_FLAGS) ||
+        (p0 >> 16) >= IR_ANALYTICS_FRAME_GAP_US ||
+        (p1 >> 16) >= IR_ANALYTICS_FRAME_GAP_US) {
+      for (uint32_t k = 0; k < 4; k++) {
+        ir_analytics_push(a, timings[i + k]);
+      }
+      continue;
+    }
+
+    analytics_pair(a, p0);
+    analytics_pair(a, p1);
+    a->edges += 4;
+  }
+
+  for (; i < count; i++) {
+    ir_analytics_push(a, timings[i]);
+  }
+}
+
+/* 直方图中相邻非空格连成一类，多于上限时去掉个数最少的 */
+static uint8_t analytics_clusters(const ir_analytics_t *a, uint8_t level,
+                                  ir_duration_cluster_t *out) {
+  const uint16_t *hist = a->hist[level];
+  const uint32_t *bin_sum = a->bin_sum[level];
+  uint8_t count = 0;
+
+  for (uint32_t bin = 0; bin < IR_ANALYTICS_BINS;) {
+    if (hist[bin] == 0) {
+      bin++;
+      continue;
+    }
+
+    uint32_t n = 0;
+    uint32_t sum = 0;
+    for (; bin < IR_ANALYTICS_BINS && hist[bin] > 0; bin++) {
+      n += hist[bin];
+      sum += bin_sum[bin];
+    }
+
+    ir_duration_cluster_t c = {
+        .centroid_us = (sum + n / 2) / n,
+        .count = MIN(n, UINT16_MAX),
+    };
+
+    if (count == IR_ANALYTICS_CLUSTERS) {
+      uint8_t least = 0;
+      for (uint8_t k = 1; k < count; k++) {
+        if (out[k].count < out[least].count) {
+          least = k;
+        }
+      }
+      if (out[least].count >= c.count) {
+        continue;
+      }
+      memmove(&out[least], &out[least + 1],
+              (count - least - 1) * sizeof(*out));
+      count--;
+    }
+    out[count++] = c;
+  }
+  return count;
+}
+
+void ir_analytics_result(const ir_analytics_t *a,
+                         ir_signal_analysis_t *analysis) {
+  uint32_t marks = (a->edges + 1) / 2;
+  uint32_t spaces = a->edges / 2;
+  uint32_t min_us = a->min_us;
+  uint32_t max_us = a->max_us;
+
+  /* 双16位最值的两个半字并入 */
+  if (a->pair_min != UINT32_MAX || a->pair_max != 0) {
+    min_us = MIN(min_us, MIN(a->pair_min & 0xFFFF, a->pair_min >> 16));
+    max_us = MAX(max_us, MAX(a->pair_max & 0xFFFF, a->pair_max >> 16));
+  }
+
+  analysis->pulse_count = a->edges;
+  analysis->avg_mark = marks ? a->sum[0] / marks : 0;
+  analysis->avg_space = spaces ? a->sum[1] / spaces : 0;
+  analysis->min_pulse = a->edges ? min_us : 0;
+  analysis->max_pulse = max_us;
+
+  memcpy(analysis->mark_hist, a->hist[0], sizeof(analysis->mark_hist));
+  memcpy(analysis->space_hist, a->hist[1], sizeof(analysis->space_hist));
+  analysis->mark_cluster_count =
+      analytics_clusters(a, 0, analysis->mark_clusters);
+  analysis->space_cluster_count =
+      analytics_clusters(a, 1, analysis->space_clusters);
+
+  analysis->frame_count = a->frames;
+  analysis->period_us =
+      a->frames > 1 ? (a->last_start - a->first_start) / (a->frames - 1) : 0;
+}
@@ -0,0 +1,302 @@
+/**
+ * @file ir_bench.c
+ * @brief 板上周期计数基准实现
+ */
+
+#include "ir_bench.h"
+#include "ir_learning.h"
+#include "ir_mem.h"
+#include "irdb_protocol.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#ifdef CONFIG_CPU_CORTEX_M_HAS_DWT
+#include <cmsis_core.h>
+#endif
+
+LOG_MODULE_REGISTER(ir_bench, LOG_LEVEL_INF);
+
+#define BENCH_MAX_TIMINGS 128 // NEC1一帧68个时序
+#define BENCH_CALIBRATE_RUNS 16
+
+/* 测试遥控器 - 固定内容，不同构建的结果可以直接对比 */
+static const char bench_csv[] = "# ir bench: NEC1 device 4\n"
+                                "Power,1,4,4,8\n"
+                                "Input,1,4,4,11\n"
+                                "Vol+,1,4,4,2\n"
+                                "Vol-,1,4,4,3\n"
+                                "Ch+,1,4,4,0\n"
+                                "Ch-,1,4,4,1\n"
+                                "Mute,1,4,4,9\n"
+                                "Menu,1,4,4,67\n"
+                                "Up,1,4,4,64\n"
+                                "Down,1,4,4,65\n"
+                                "Left,1,4,4,7\n"
+                                "Right,1,4,4,6\n"
+                                "OK,1,4,4,68\n"
+                                "Back,1,4,4,40\n"
+                                "Home,1,4,4,124\n"
+                                "Info,1,4,4,170\n";
+
+static const char *const bench_names[IR_BENCH_COUNT] = {
+    [IR_BENCH_ENCODE] = "encode",   [IR_BENCH_DECODE] = "decode",
+    [IR_BENCH_PARSE] = "parse_csv", [IR_BENCH_FIND] = "find",
+    [IR_BENCH_COMPARE] = "compare", [IR_BENCH_SAVE] = "flash_save",
+    [IR_BENCH_LOAD] = "flash_load",
+};
+
+/* 测量现场 - 堆上分配，不占用调用者(shell)的栈 */
+typedef struct {
+  irdb_database_t db;
+  ir_timing_t frames[2][BENCH_MAX_TIMINGS];
+  uint32_t counts[2];
+  ir_learned_signal_t loaded; // 存取项目的读出缓冲
+} bench_ctx_t;
+
+static inline uint32_t bench_cycles(void) {
+#ifdef CONFIG_CPU_CORTEX_M_HAS_DWT
+  return DWT->CYCCNT;
+#else
+  return k_cycle_get_32();
+#endif
+}
+
+/* 开启DWT计数 - 不清零CYCCNT，调试器或其他模块可能也在使用 */
+static void bench_counter_init(void) {
+#ifdef CONFIG_CPU_CORTEX_M_HAS_DWT
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+/* 读两次计数器的最小开销，从每个样本中扣除 */
+static uint32_t bench_overhead(void) {
+  uint32_t best = UINT32_MAX;
+
+  for (int i = 0; i < BENCH_CALIBRATE_RUNS; i++) {
+    uint32_t t0 = bench_cycles();
+    uint32_t t1 = bench_cycles();
+
+    best = MIN(best, t1 - t0);
+  }
+  return best;
+}
+
+const char *ir_bench_name(ir_bench_op_t op) {
+  return op < IR_BENCH_COUNT ? bench_names[op] : NULL;
+}
+
+uint32_t ir_bench_cycles_per_sec(void) {
+#ifdef CONFIG_CPU_CORTEX_M_HAS_DWT
+  return SystemCoreClock;
+#else
+  return sys_clock_hw_cycles_per_sec();
+#endif
+}
+
+/* 编码第i个功能到frames[slot] (不计时) */
+static int bench_encode(bench_ctx_t *ctx, uint32_t i, int slot) {
+  return irdb_encode_to_raw(&ctx->db.entries[i % ctx->db.entry_count],
+                            ctx->frames[slot], &ctx->counts[slot],
+                            BENCH_MAX_TIMINGS);
+}
+
+/* 把frames[slot]包装成学习信号 (时序不拷贝) */
+static void bench_signal(bench_ctx_t *ctx, int slot,
+                         ir_learned_signal_t *signal) {
+  memset(signal, 0, sizeof(*signal));
+  strncpy(signal->name, IR_BENCH_SIGNAL, sizeof(signal->name) - 1);
+  signal->timings = ctx->frames[slot];
+  signal->timing_count = ctx->counts[slot];
+  signal->carrier_freq = 38000;
+  for (uint32_t k = 0; k < ctx->counts[slot]; k++) {
+    signal->total_duration_us += ir_timing_us(ctx->frames[slot][k]);
+  }
+  signal->valid = true;
+}
+
+/* 计时一次操作 - 准备和清理不计入 */
+static int bench_one(ir_bench_op_t op, bench_ctx_t *ctx, uint32_t i,
+                     uint32_t *cycles) {
+  const irdb_entry_t *entry = &ctx->db.entries[i % ctx->db.entry_count];
+  ir_learned_signal_t a, b;
+  irdb_database_t db;
+  irdb_entry_t decoded;
+  uint8_t similarity;
+  const char *name;
+  uint32_t t0;
+  int ret;
+
+  switch (op) {
+  case IR_BENCH_ENCODE:
+    t0 = bench_cycles();
+    ret = irdb_encode_to_raw(entry, ctx->frames[0], &ctx->counts[0],
+                             BENCH_MAX_TIMINGS);
+    *cycles = bench_cycles() - t0;
+    return ret;
+
+  case IR_BENCH_DECODE:
+    ret = bench_encode(ctx, i, 0);
+    if (ret < 0) {
+      return ret;
+    }
+    t0 = bench_cycles();
+    ret = irdb_decode_from_raw(&ctx->db, ctx->frames[0], ctx->counts[0],
+                               &decoded);
+    *cycles = bench_cycles() - t0;
+    return ret;
+
+  case IR_BENCH_PARSE:
+    t0 = bench_cycles();
+    ret = irdb_parse_csv(bench_csv, &db);
+    *cycles = bench_cycles() - t0;
+    if (ret == 0) {
+      irdb_free_database(&db);
+    }
+    return ret;
+
+  case IR_BENCH_FIND:
+    name = irdb_entry_name(&ctx->db, entry);
+    t0 = bench_cycles();
+    ret = irdb_find_function(&ctx->db, name) ? 0 : -ENOENT;
+    *cycles = bench_cycles() - t0;
+    return ret;
+
+  case IR_BENCH_COMPARE:
+    ret = bench_encode(ctx, i, 0);
+    if (ret == 0) {
+      ret = bench_encode(ctx, i + 1, 1);
+    }
+    if (ret < 0) {
+      return ret;
+    }
+    bench_signal(ctx, 0, &a);
+    bench_signal(ctx, 1, &b);
+    t0 = bench_cycles();
+    ret = ir_learning_compare(&a, &b, &similarity);
+    *cycles = bench_cycles() - t0;
+    return ret;
+
+  case IR_BENCH_SAVE:
+    ret = bench_encode(ctx, i, 0);
+    if (ret < 0) {
+      return ret;
+    }
+    bench_signal(ctx, 0, &a);
+    t0 = bench_cycles();
+    ret = ir_learning_save(&a, IR_BENCH_SIGNAL);
+    *cycles = bench_cycles() - t0;
+    return ret;
+
+  case IR_BENCH_LOAD:
+    t0 = bench_cycles();
+    ret = ir_learning_load(&ctx->loaded, IR_BENCH_SIGNAL);
+    *cycles = bench_cycles() - t0;
+    return ret;
+
+  default:
+    return -EINVAL;
+  }
+}
+
+static int cycles_compare(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+/* 排序后取统计量 - p99按最近秩 */
+static void bench_stats(uint32_t *samples, uint32_t n,
+                        ir_bench_result_t *result) {
+  qsort(samples, n, sizeof(samples[0]), cycles_compare);
+
+  result->ops = n;
+  result->min = samples[0];
+  result->median = samples[n / 2];
+  result->p99 = samples[(n * 99 + 99) / 100 - 1];
+  result->max = samples[n - 1];
+}
+
+/* 存取项目先写一次: 验证存储可用，读取项目也需要这条信号 */
+static int bench_storage_prepare(bench_ctx_t *ctx) {
+  ir_learned_signal_t signal;
+
+  ctx->loaded.timings = ir_timing_buf_alloc();
+  if (!ctx->loaded.timings) {
+    return -ENOMEM;
+  }
+
+  int ret = bench_encode(ctx, 0, 0);
+  if (ret < 0) {
+    return ret;
+  }
+  bench_signal(ctx, 0, &signal);
+  return ir_learning_save(&signal, IR_BENCH_SIGNAL);
+}
+
+/* 逐次计时并统计 */
+static int bench_measure(ir_bench_op_t op, bench_ctx_t *ctx,
+                         uint32_t *samples, uint32_t ops,
+                         ir_bench_result_t *result) {
+  bench_counter_init();
+  uint32_t overhead = bench_overhead();
+
+  for (uint32_t i = 0; i < ops; i++) {
+    uint32_t cycles;
+
+    int ret = bench_one(op, ctx, i, &cycles);
+    if (ret < 0) {
+      LOG_ERR("%s failed at op %u: %d", bench_names[op], i, ret);
+      return ret;
+    }
+    samples[i] = cycles > overhead ? cycles - overhead : 0;
+  }
+
+  bench_stats(samples, ops, result);
+  return 0;
+}
+
+int ir_bench_run(ir_bench_op_t op, uint32_t ops, ir_bench_result_t *result) {
+  if (op >= IR_BENCH_COUNT || ops == 0 || !result) {
+    return -EINVAL;
+  }
+
+  bool storage = op == IR_BENCH_SAVE || op == IR_BENCH_LOAD;
+
+  ops = MIN(ops, storage ? IR_BENCH_FLASH_OPS_MAX : IR_BENCH_MAX_OPS);
+
+  bench_ctx_t *ctx = k_malloc(sizeof(*ctx));
+  uint32_t *samples = k_malloc(ops * sizeof(uint32_t));
+  if (!ctx || !samples) {
+    k_free(ctx);
+    k_free(samples);
+    return -ENOMEM;
+  }
+
+  memset(ctx, 0, sizeof(*ctx));
+  int ret = irdb_parse_csv(bench_csv, &ctx->db);
+  if (ret == 0) {
+    bool saved = false;
+
+    if (storage) {
+      ret = bench_storage_prepare(ctx);
+      saved = ret == 0;
+    }
+    if (ret == 0) {
+      ret = bench_measure(op, ctx, samples, ops, result);
+    }
+
+    if (saved) {
+      ir_learning_delete(IR_BENCH_SIGNAL);
+    }
+    ir_timing_buf_free(ctx->loaded.timings);
+    irdb_free_database(&ctx->db);
+  }
+
+  k_free(samples);
+  k_free(ctx);
+  return ret;
+}
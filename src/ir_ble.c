@@ -0,0 +1,211 @@
+/**
+ * @file ir_ble.c
+ * @brief BLE外设 - 协议栈使能、可连接广播、连接跟踪与连接参数模式
+ *
+ * 只接受一个连接(手机或集线器)。连接建立后按当前模式请求连接参数，主机
+ * 可以拒绝或改用其他值，实际值在ir ble中显示。断开后自动重新广播。
+ */
+
+#include "ir_ble.h"
+#include <errno.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(ir_ble, LOG_LEVEL_INF);
+
+static const struct bt_le_conn_param *const mode_params[IR_BLE_MODE_COUNT] = {
+    [IR_BLE_MODE_LOW_LATENCY] = BT_LE_CONN_PARAM(
+        IR_BLE_LOW_LATENCY_INTERVAL_MIN, IR_BLE_LOW_LATENCY_INTERVAL_MAX,
+        IR_BLE_LOW_LATENCY_LATENCY, IR_BLE_LOW_LATENCY_TIMEOUT),
+    [IR_BLE_MODE_LOW_POWER] = BT_LE_CONN_PARAM(
+        IR_BLE_LOW_POWER_INTERVAL_MIN, IR_BLE_LOW_POWER_INTERVAL_MAX,
+        IR_BLE_LOW_POWER_LATENCY, IR_BLE_LOW_POWER_TIMEOUT),
+};
+
+/* 连接在BT接收线程中变化，其他线程取用时加引用 */
+static struct {
+  struct k_spinlock lock;
+  struct bt_conn *conn;
+  ir_ble_mode_t mode;
+  uint16_t interval;
+  uint16_t latency;
+  uint16_t timeout;
+  atomic_t enabled;
+} ble_state = {
+    .mode = IR_BLE_DEFAULT_MODE,
+};
+
+static void adv_work_handler(struct k_work *work);
+static K_WORK_DEFINE(adv_work, adv_work_handler);
+
+/* 广播服务UUID - 两个128位UUID放不进31字节，有红外服务时广播红外服务 */
+static const struct bt_data ble_ad[] = {
+    BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
+#ifdef CONFIG_IR_BLE_SERVICE
+    BT_DATA_BYTES(BT_DATA_UUID128_ALL, IR_BLE_UUID_SERVICE(1)),
+#else
+    BT_DATA_BYTES(BT_DATA_UUID128_ALL, IR_BLE_UUID_LINK(1)),
+#endif
+};
+
+static const struct bt_data ble_sd[] = {
+    BT_DATA(BT_DATA_NAME_COMPLETE, CONFIG_BT_DEVICE_NAME,
+            sizeof(CONFIG_BT_DEVICE_NAME) - 1),
+};
+
+/* 可连接广播 - 参数宏在新旧协议栈中名称不同 */
+#ifdef BT_LE_ADV_CONN_FAST_1
+#define BLE_ADV_PARAM BT_LE_ADV_CONN_FAST_1
+#else
+#define BLE_ADV_PARAM BT_LE_ADV_CONN
+#endif
+
+static void adv_work_handler(struct k_work *work) {
+  int ret = bt_le_adv_start(BLE_ADV_PARAM, ble_ad, ARRAY_SIZE(ble_ad), ble_sd,
+                            ARRAY_SIZE(ble_sd));
+
+  if (ret < 0 && ret != -EALREADY) {
+    LOG_ERR("Advertising failed: %d", ret);
+  }
+}
+
+static int request_mode(struct bt_conn *conn, ir_ble_mode_t mode) {
+  int ret = bt_conn_le_param_update(conn, mode_params[mode]);
+
+  if (ret < 0 && ret != -EALREADY) {
+    LOG_WRN("Connection parameter update failed: %d", ret);
+  }
+  return ret;
+}
+
+static void ble_connected(struct bt_conn *conn, uint8_t err) {
+  if (err) {
+    return;
+  }
+
+  struct bt_conn_info info;
+  bool taken = false;
+
+  k_spinlock_key_t key = k_spin_lock(&ble_state.lock);
+  if (!ble_state.conn) {
+    ble_state.conn = bt_conn_ref(conn);
+    taken = true;
+  }
+  ir_ble_mode_t mode = ble_state.mode;
+  k_spin_unlock(&ble_state.lock, key);
+
+  if (!taken) {
+    return;
+  }
+
+  if (bt_conn_get_info(conn, &info) == 0) {
+    key = k_spin_lock(&ble_state.lock);
+    ble_state.interval = info.le.interval;
+    ble_state.latency = info.le.latency;
+    ble_state.timeout = info.le.timeout;
+    k_spin_unlock(&ble_state.lock, key);
+    LOG_INF("Connected, interval %u", info.le.interval);
+  }
+
+  request_mode(conn, mode);
+}
+
+static void ble_disconnected(struct bt_conn *conn, uint8_t reason) {
+  k_spinlock_key_t key = k_spin_lock(&ble_state.lock);
+  struct bt_conn *old = ble_state.conn == conn ? ble_state.conn : NULL;
+
+  if (old) {
+    ble_state.conn = NULL;
+  }
+  k_spin_unlock(&ble_state.lock, key);
+
+  if (old) {
+    bt_conn_unref(old);
+    LOG_INF("Disconnected (0x%02x)", reason);
+  }
+}
+
+static void ble_param_updated(struct bt_conn *conn, uint16_t interval,
+                              uint16_t latency, uint16_t timeout) {
+  k_spinlock_key_t key = k_spin_lock(&ble_state.lock);
+
+  if (ble_state.conn == conn) {
+    ble_state.interval = interval;
+    ble_state.latency = latency;
+    ble_state.timeout = timeout;
+  }
+  k_spin_unlock(&ble_state.lock, key);
+  LOG_INF("Connection interval %u, latency %u", interval, latency);
+}
+
+/* 连接对象回收后才能重新开始可连接广播 */
+static void ble_recycled(void) { k_work_submit(&adv_work); }
+
+BT_CONN_CB_DEFINE(ble_conn_cb) = {
+    .connected = ble_connected,
+    .disconnected = ble_disconnected,
+    .le_param_updated = ble_param_updated,
+    .recycled = ble_recycled,
+};
+
+struct bt_conn *ir_ble_conn_get(void) {
+  k_spinlock_key_t key = k_spin_lock(&ble_state.lock);
+  struct bt_conn *conn = ble_state.conn ? bt_conn_ref(ble_state.conn) : NULL;
+  k_spin_unlock(&ble_state.lock, key);
+
+  return conn;
+}
+
+int ir_ble_set_mode(ir_ble_mode_t mode) {
+  if (mode >= IR_BLE_MODE_COUNT) {
+    return -EINVAL;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&ble_state.lock);
+  ble_state.mode = mode;
+  k_spin_unlock(&ble_state.lock, key);
+
+  struct bt_conn *conn = ir_ble_conn_get();
+  if (!conn) {
+    return 0;
+  }
+
+  int ret = request_mode(conn, mode);
+  bt_conn_unref(conn);
+  return ret == -EALREADY ? 0 : ret;
+}
+
+ir_ble_mode_t ir_ble_get_mode(void) { return ble_state.mode; }
+
+void ir_ble_get_status(ir_ble_status_t *status) {
+  if (!status) {
+    return;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&ble_state.lock);
+  status->connected = ble_state.conn != NULL;
+  status->mode = ble_state.mode;
+  status->interval = ble_state.interval;
+  status->latency = ble_state.latency;
+  status->timeout = ble_state.timeout;
+  k_spin_unlock(&ble_state.lock, key);
+}
+
+int ir_ble_init(void) {
+  if (atomic_set(&ble_state.enabled, 1)) {
+    return 0;
+  }
+
+  int ret = bt_enable(NULL);
+  if (ret < 0 && ret != -EALREADY) {
+    atomic_clear(&ble_state.enabled);
+    return ret;
+  }
+
+  k_work_submit(&adv_work);
+  LOG_INF("Advertising as \"%s\"", CONFIG_BT_DEVICE_NAME);
+  return 0;
+}
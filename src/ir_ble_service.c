@@ -0,0 +1,286 @@
+/**
+ * @file ir_ble_service.c
+ * @brief GATT红外服务 - 手机直连发送、学习与接收通知
+ *
+ * 特征与负载见include/ir_ble.h。发送特征的写回调在BT接收线程中直接编码入
+ * 队，不转交其他线程; 学习回调在RX线程、定时器中断或系统工作队列中
+ * 调用，保存和通知统一放到系统工作队列; 接收通知在解码工作队列中发出，
+ * 按住一个键时只通知按下、限速的长按和松开，不逐帧通知。通知发给所有已订阅的连接。
+ */
+
+#include "ir_app.h"
+#include "ir_ble.h"
+#include "ir_learning.h"
+#include "ir_service.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+LOG_MODULE_REGISTER(ir_ble_service, LOG_LEVEL_INF);
+
+#define SEND_ID_SIZE 6     // 编号 次数 通道
+#define SEND_RAW_HEADER 8  // 载波 帧间隔 次数 通道
+#define LEARN_NOTIFY_SIZE 17
+#define RX_NOTIFY_SIZE 12
+
+static const struct bt_uuid_128 svc_uuid =
+    BT_UUID_INIT_128(IR_BLE_UUID_SERVICE(1));
+static const struct bt_uuid_128 send_id_uuid =
+    BT_UUID_INIT_128(IR_BLE_UUID_SERVICE(2));
+static const struct bt_uuid_128 send_raw_uuid =
+    BT_UUID_INIT_128(IR_BLE_UUID_SERVICE(3));
+static const struct bt_uuid_128 learn_uuid =
+    BT_UUID_INIT_128(IR_BLE_UUID_SERVICE(4));
+static const struct bt_uuid_128 rx_uuid =
+    BT_UUID_INIT_128(IR_BLE_UUID_SERVICE(5));
+static const struct bt_uuid_128 mode_uuid =
+    BT_UUID_INIT_128(IR_BLE_UUID_SERVICE(6));
+
+/* 学习状态 - 回调在中断中记下，工作项中提交异步保存，保存完成后
+ * 再次提交工作项发出通知，系统工作队列不被flash写入阻塞 */
+static struct {
+  char name[sizeof(((ir_learned_signal_t *)0)->name)];
+  bool save;
+  atomic_t status;
+  const ir_learned_signal_t *signal;
+  int saved; // 保存结果
+} learn;
+
+static void learn_work_handler(struct k_work *work);
+static K_WORK_DEFINE(learn_work, learn_work_handler);
+
+static atomic_t rx_active;
+
+/* 服务错误码 -> ATT错误 */
+static ssize_t write_result(int ret, uint16_t len) {
+  switch (ret) {
+  case 0:
+    return len;
+  case -ENOBUFS:
+  case -ENOMEM:
+    return BT_GATT_ERR(BT_ATT_ERR_INSUFFICIENT_RESOURCES);
+  case -EINVAL:
+  case -ENOENT:
+  case -ENOTSUP:
+    return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+  default:
+    return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+  }
+}
+
+static uint8_t tx_channels(uint8_t channels) {
+  return channels ? channels : IR_HAL_TX_CH_DEFAULT;
+}
+
+static ssize_t send_id_write(struct bt_conn *conn,
+                             const struct bt_gatt_attr *attr, const void *buf,
+                             uint16_t len, uint16_t offset, uint8_t flags) {
+  const uint8_t *data = buf;
+
+  if (offset != 0) {
+    return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+  }
+  if (len != SEND_ID_SIZE) {
+    return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+  }
+
+  int ret = ir_service_send_id_async_on((int32_t)sys_get_le32(data), data[4],
+                                        tx_channels(data[5]), NULL, NULL);
+  return write_result(ret, len);
+}
+
+static ssize_t send_raw_write(struct bt_conn *conn,
+                              const struct bt_gatt_attr *attr, const void *buf,
+                              uint16_t len, uint16_t offset, uint8_t flags) {
+  const uint8_t *data = buf;
+
+  if (offset != 0) {
+    return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+  }
+  if (len <= SEND_RAW_HEADER || (len - SEND_RAW_HEADER) % 2 != 0) {
+    return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+  }
+
+  uint16_t gap_ms = sys_get_le16(data + 4);
+  uint32_t gap_us = gap_ms ? gap_ms * 1000U : IR_LEARNING_REPEAT_GAP_US;
+
+  /* 时序为小端u16，服务层用memcpy拷贝进队列帧，未对齐无妨 */
+  int ret = ir_service_send_raw_async_on(
+      (const ir_timing_t *)(data + SEND_RAW_HEADER),
+      (len - SEND_RAW_HEADER) / 2, sys_get_le32(data), gap_us, data[6],
+      tx_channels(data[7]), NULL, NULL);
+  return write_result(ret, len);
+}
+
+static void learn_callback(ir_learn_status_t status,
+                           const ir_learned_signal_t *signal,
+                           void *user_data) {
+  if (status == IR_LEARN_COMPLETED) {
+    learn.signal = signal;
+  }
+  atomic_set(&learn.status, status);
+  k_work_submit(&learn_work);
+}
+
+static ssize_t learn_write(struct bt_conn *conn,
+                           const struct bt_gatt_attr *attr, const void *buf,
+                           uint16_t len, uint16_t offset, uint8_t flags) {
+  const uint8_t *data = buf;
+
+  if (offset != 0) {
+    return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+  }
+  if (len < 1 || len > sizeof(learn.name) || data[0] == 0 ||
+      data[0] > IR_BLE_LEARN_TIMEOUT_MAX_S) {
+    return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+  }
+
+  /* 名称可选 - 给出时学习完成后按该名称保存 */
+  char name[sizeof(learn.name)] = "ble";
+  if (len > 1) {
+    memcpy(name, data + 1, len - 1);
+    name[len - 1] = '\0';
+  }
+
+  int ret = ir_learning_start(name, learn_callback, NULL, data[0] * 1000U);
+  if (ret == 0) {
+    strcpy(learn.name, name);
+    learn.save = len > 1;
+    learn.saved = 0;
+  }
+  return write_result(ret, len);
+}
+
+static void rx_key_callback(const ir_key_event_t *event, void *user_data);
+
+/* 订阅RX通知即开始接收，取消订阅或断开时停止 */
+static void rx_ccc_changed(const struct bt_gatt_attr *attr, uint16_t value) {
+  if (value == BT_GATT_CCC_NOTIFY) {
+    if (atomic_set(&rx_active, 1)) {
+      return;
+    }
+    ir_service_set_key_callback(rx_key_callback, NULL);
+    int ret = ir_service_start_receive(NULL, NULL);
+    if (ret < 0) {
+      LOG_ERR("Failed to start receive: %d", ret);
+      ir_service_set_key_callback(NULL, NULL);
+      atomic_clear(&rx_active);
+    }
+  } else if (atomic_clear(&rx_active)) {
+    ir_service_stop_receive();
+    ir_service_set_key_callback(NULL, NULL);
+    ir_app_rx_resume();
+  }
+}
+
+static ssize_t mode_read(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                         void *buf, uint16_t len, uint16_t offset) {
+  uint8_t mode = ir_ble_get_mode();
+
+  return bt_gatt_attr_read(conn, attr, buf, len, offset, &mode, sizeof(mode));
+}
+
+static ssize_t mode_write(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                          const void *buf, uint16_t len, uint16_t offset,
+                          uint8_t flags) {
+  const uint8_t *data = buf;
+
+  if (offset != 0) {
+    return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+  }
+  if (len != 1) {
+    return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+  }
+
+  return write_result(ir_ble_set_mode(data[0]), len);
+}
+
+BT_GATT_SERVICE_DEFINE(
+    ir_ble_svc, BT_GATT_PRIMARY_SERVICE(&svc_uuid),
+    BT_GATT_CHARACTERISTIC(&send_id_uuid.uuid,
+                           BT_GATT_CHRC_WRITE |
+                               BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+                           BT_GATT_PERM_WRITE, NULL, send_id_write, NULL),
+    BT_GATT_CHARACTERISTIC(&send_raw_uuid.uuid,
+                           BT_GATT_CHRC_WRITE |
+                               BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+                           BT_GATT_PERM_WRITE, NULL, send_raw_write, NULL),
+    BT_GATT_CHARACTERISTIC(&learn_uuid.uuid,
+                           BT_GATT_CHRC_WRITE | BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_PERM_WRITE, NULL, learn_write, NULL),
+    BT_GATT_CCC(NULL, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+    BT_GATT_CHARACTERISTIC(&rx_uuid.uuid, BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_PERM_NONE, NULL, NULL, NULL),
+    BT_GATT_CCC(rx_ccc_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+    BT_GATT_CHARACTERISTIC(&mode_uuid.uuid,
+                           BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+                           BT_GATT_PERM_READ | BT_GATT_PERM_WRITE, mode_read,
+                           mode_write, NULL));
+
+/* 通知特征的值属性 (服务, 2×(声明, 值), 学习声明, 学习值, CCC, RX声明,
+ * RX值, ...) */
+#define LEARN_ATTR (&ir_ble_svc.attrs[6])
+#define RX_ATTR (&ir_ble_svc.attrs[9])
+
+static void learn_saved(const char *name, int result, void *user_data) {
+  if (result < 0) {
+    LOG_ERR("Failed to save '%s': %d", name, result);
+  }
+  learn.saved = result;
+  k_work_submit(&learn_work);
+}
+
+static void learn_work_handler(struct k_work *work) {
+  ir_learn_status_t status = atomic_get(&learn.status);
+  const ir_learned_signal_t *signal =
+      status == IR_LEARN_COMPLETED ? learn.signal : NULL;
+  uint8_t pkt[LEARN_NOTIFY_SIZE] = {status};
+  int saved = 0;
+
+  if (signal) {
+    if (learn.save) {
+      learn.save = false;
+      saved = ir_learning_save_async(signal, learn.name, learn_saved, NULL);
+      if (saved == 0) {
+        return; // 保存完成后learn_saved再次提交，那时通知
+      }
+      LOG_ERR("Failed to queue save of '%s': %d", learn.name, saved);
+    } else {
+      saved = learn.saved;
+    }
+
+    pkt[1] = signal->parametric;
+    sys_put_le16(signal->timing_count, pkt + 2);
+    sys_put_le32(signal->carrier_freq, pkt + 4);
+    if (signal->parametric) {
+      sys_put_le16(signal->code.protocol, pkt + 8);
+      sys_put_le16(signal->code.device, pkt + 10);
+      sys_put_le16(signal->code.subdevice, pkt + 12);
+      sys_put_le16(signal->code.function, pkt + 14);
+    }
+  }
+  pkt[16] = (uint8_t)(int8_t)CLAMP(saved, INT8_MIN, 0);
+
+  bt_gatt_notify(NULL, LEARN_ATTR, pkt, sizeof(pkt));
+}
+
+/* 解码工作队列中调用 */
+static void rx_key_callback(const ir_key_event_t *event, void *user_data) {
+  const irdb_entry_t *code = &event->code;
+  uint8_t pkt[RX_NOTIFY_SIZE];
+
+  sys_put_le16(code->protocol, pkt);
+  sys_put_le16(code->device, pkt + 2);
+  sys_put_le16(code->subdevice, pkt + 4);
+  sys_put_le16(code->function, pkt + 6);
+  pkt[8] = event->remote != IR_KEY_NO_REMOTE;
+  pkt[9] = event->action;
+  sys_put_le16(event->frames, pkt + 10);
+
+  bt_gatt_notify(NULL, RX_ATTR, pkt, sizeof(pkt));
+}
@@ -0,0 +1,387 @@
+/**
+ * @file ir_calib.c
+ * @brief 接收头时序校准实现
+ */
+
+#include "ir_calib.h"
+#include "ir_fs.h"
+#include "ir_hal.h"
+#include "irdb_protocol.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#ifdef CONFIG_FILE_SYSTEM
+#include <zephyr/fs/fs.h>
+#endif
+
+LOG_MODULE_REGISTER(ir_calib, LOG_LEVEL_INF);
+
+#define CALIB_MAGIC 0x42435249 // "IRCB"
+#define CALIB_VERSION 1
+#define CALIB_FRAME_TIMEOUT_MS 200 // self模式: 发送后等待帧结束的上限
+#define CALIB_SELF_GAP_MS 100      // self模式: 帧间留给接收头AGC恢复
+
+/* 保存的补偿 - 按最大通道数定长，换板子后多出的通道忽略 */
+typedef struct {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t channels;
+  uint16_t reserved;
+  int16_t bias[IR_HAL_RX_CHANNELS_MAX][2]; // [mark, space]
+} calib_file_t;
+
+/* 接收侧状态 - RX消费线程写，校准线程在帧结束后读 */
+static struct {
+  struct k_sem done;
+  uint32_t *durations;
+  uint32_t count;
+  bool overflow;
+  bool first_mark;
+  volatile bool armed;
+} capture;
+
+static atomic_t calib_busy;
+
+/* 逐类累计 */
+typedef struct {
+  int64_t sum;
+  uint64_t sum_sq;
+  int32_t min;
+  int32_t max;
+  uint32_t n;
+} calib_acc_t;
+
+static void capture_callback(ir_pulse_t *pulse, void *user_data) {
+  if (!capture.armed) {
+    return;
+  }
+
+  if (pulse->frame_end) {
+    if (capture.count > 0) {
+      capture.armed = false;
+      k_sem_give(&capture.done);
+    }
+    return;
+  }
+
+  if (capture.count == 0) {
+    capture.first_mark = pulse->is_mark;
+  }
+  if (capture.count < IR_CALIB_MAX_EDGES) {
+    capture.durations[capture.count++] = pulse->duration_us;
+  } else {
+    capture.overflow = true;
+  }
+}
+
+static void acc_add(calib_acc_t *acc, int32_t error) {
+  if (acc->n == 0 || error < acc->min) {
+    acc->min = error;
+  }
+  if (acc->n == 0 || error > acc->max) {
+    acc->max = error;
+  }
+  acc->sum += error;
+  acc->sum_sq += (int64_t)error * error;
+  acc->n++;
+}
+
+static int32_t acc_mean(const calib_acc_t *acc) {
+  return acc->n ? (int32_t)(acc->sum / (int64_t)acc->n) : 0;
+}
+
+static uint32_t isqrt64(uint64_t v) {
+  uint64_t r = 0;
+
+  for (uint64_t bit = 1ULL << 62; bit; bit >>= 2) {
+    if (v >= r + bit) {
+      v -= r + bit;
+      r = (r >> 1) + bit;
+    } else {
+      r >>= 1;
+    }
+  }
+  return r;
+}
+
+/* 识别一帧并与标称时序逐沿对比 - 返回协议编号，无法对比返回-ENOENT。
+ * 解码按各协议的容差进行，偏差在容差以内的接收头才能校准 */
+static int calib_frame(ir_timing_t *timings, ir_timing_t *nominal,
+                       calib_acc_t acc[2]) {
+  uint32_t count = capture.count;
+
+  if (capture.overflow || !capture.first_mark) {
+    return -ENOENT;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    timings[i] = ir_timing_pack(capture.durations[i]);
+  }
+
+  for (uint16_t id = 0; id <= IRDB_PROTOCOL_MAX_ID; id++) {
+    irdb_entry_t code;
+    uint32_t n;
+    int toggle;
+
+    if (!irdb_get_protocol_params(id) ||
+        irdb_decode_with_toggle(id, timings, count, &code, &toggle) < 0 ||
+        irdb_encode_with_toggle(&code, toggle == 1, nominal, &n,
+                                IR_CALIB_MAX_EDGES) < 0) {
+      continue;
+    }
+
+    /* 末尾的space并入帧间静默，不在帧内 */
+    if (count != n - (n % 2 == 0)) {
+      continue;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+      acc_add(&acc[i % 2], (int32_t)capture.durations[i] -
+                               (int32_t)ir_timing_us(nominal[i]));
+    }
+    return id;
+  }
+  return -ENOENT;
+}
+
+/* self模式发送一帧NEC1 - 功能码逐帧变化 */
+static int calib_send(uint32_t frame, ir_timing_t *nominal) {
+  const irdb_protocol_params_t *params =
+      irdb_get_protocol_params(IRDB_PROTOCOL_NEC1);
+  irdb_entry_t entry = {
+      .name = IRDB_NAME_NONE,
+      .protocol = IRDB_PROTOCOL_NEC1,
+      .device = 1,
+      .function = (frame * 37 + 1) & 0xFF,
+  };
+  uint32_t count;
+
+  int ret = irdb_encode_to_raw(&entry, nominal, &count, IR_CALIB_MAX_EDGES);
+  if (ret < 0) {
+    return ret;
+  }
+  return ir_hal_tx_frame(nominal, count, params->frequency,
+                         params->duty_cycle);
+}
+
+/* 逐帧接收并累计 - 返回有效帧数或负errno */
+static int calib_measure(uint32_t frames, uint32_t timeout_ms, bool self,
+                         ir_timing_t *timings, ir_timing_t *nominal,
+                         ir_calib_result_t *result) {
+  calib_acc_t acc[2] = {0};
+  int64_t deadline = k_uptime_get() + timeout_ms;
+  uint32_t sent = 0;
+  int ret = 0;
+
+  if (self) {
+    ir_hal_tx_power_get();
+  }
+
+  while (result->frames < frames) {
+    int64_t remaining = deadline - k_uptime_get();
+    if (remaining <= 0) {
+      break;
+    }
+
+    capture.count = 0;
+    capture.overflow = false;
+    k_sem_reset(&capture.done);
+    capture.armed = true;
+
+    if (self) {
+      ret = calib_send(sent++, nominal);
+      if (ret < 0) {
+        capture.armed = false;
+        break;
+      }
+      remaining = MIN(remaining, CALIB_FRAME_TIMEOUT_MS);
+    }
+
+    if (k_sem_take(&capture.done, K_MSEC(remaining)) < 0) {
+      capture.armed = false;
+      continue;
+    }
+
+    int protocol = calib_frame(timings, nominal, acc);
+    if (protocol < 0) {
+      result->rejected++;
+    } else {
+      result->protocol = protocol;
+      result->frames++;
+    }
+    if (self) {
+      k_msleep(CALIB_SELF_GAP_MS);
+    }
+  }
+
+  if (self) {
+    ir_hal_tx_power_put();
+  }
+
+  result->edges = acc[0].n + acc[1].n;
+  result->mark_bias_us = acc_mean(&acc[0]);
+  result->space_bias_us = acc_mean(&acc[1]);
+
+  /* 抖动以各自类别的平均误差为基准 */
+  uint64_t var_sum = 0;
+  for (size_t k = 0; k < 2; k++) {
+    if (acc[k].n == 0) {
+      continue;
+    }
+
+    int32_t mean = acc_mean(&acc[k]);
+    int64_t centered =
+        (int64_t)acc[k].sum_sq - acc[k].sum * acc[k].sum / (int64_t)acc[k].n;
+
+    var_sum += centered > 0 ? centered : 0;
+    result->max_jitter_us =
+        MAX(result->max_jitter_us,
+            (uint32_t)MAX(acc[k].max - mean, mean - acc[k].min));
+  }
+  if (result->edges > 0) {
+    result->jitter_us = isqrt64(var_sum / result->edges);
+  }
+  return ret < 0 ? ret : (int)result->frames;
+}
+
+int ir_calib_run(uint8_t channel, uint32_t frames, uint32_t timeout_ms,
+                 bool self, ir_calib_result_t *result) {
+  if (!result || frames == 0 || channel >= IR_HAL_RX_CHANNELS) {
+    return -EINVAL;
+  }
+
+  if (atomic_test_and_set_bit(&calib_busy, 0)) {
+    return -EBUSY;
+  }
+
+  /* 接收时序、标称时序和测得时长共用一次分配 */
+  ir_timing_t *timings = k_malloc(IR_CALIB_MAX_EDGES *
+                                  (2 * sizeof(ir_timing_t) + sizeof(uint32_t)));
+  if (!timings) {
+    atomic_clear_bit(&calib_busy, 0);
+    return -ENOMEM;
+  }
+
+  memset(result, 0, sizeof(*result));
+  result->channel = channel;
+
+  k_sem_init(&capture.done, 0, 1);
+  capture.durations = (uint32_t *)(timings + 2 * IR_CALIB_MAX_EDGES);
+  capture.armed = false;
+
+  /* 测量未补偿的时长 */
+  int16_t saved_mark, saved_space;
+  ir_hal_rx_get_bias(channel, &saved_mark, &saved_space);
+  ir_hal_rx_set_bias(channel, 0, 0);
+
+  int ret = ir_hal_rx_subscribe(BIT(channel), capture_callback, NULL);
+  if (ret >= 0) {
+    int sub = ret;
+
+    /* self模式测量的是自己发出的信号 */
+    ir_hal_rx_set_echo(sub, self);
+    ret = calib_measure(frames, timeout_ms, self, timings,
+                        timings + IR_CALIB_MAX_EDGES, result);
+    ir_hal_rx_unsubscribe(sub);
+    if (ret == 0) {
+      ret = -ETIMEDOUT;
+    }
+  }
+  k_free(timings);
+
+  if (ret > 0 && (abs(result->mark_bias_us) > IR_CALIB_MAX_BIAS_US ||
+                  abs(result->space_bias_us) > IR_CALIB_MAX_BIAS_US)) {
+    ret = -ERANGE;
+  }
+
+  if (ret < 0) {
+    ir_hal_rx_set_bias(channel, saved_mark, saved_space);
+    atomic_clear_bit(&calib_busy, 0);
+    LOG_ERR("Calibration of RX%u failed: %d", channel, ret);
+    return ret;
+  }
+
+  ir_hal_rx_set_bias(channel, result->mark_bias_us, result->space_bias_us);
+  ret = ir_calib_save();
+  atomic_clear_bit(&calib_busy, 0);
+
+  LOG_INF("RX%u calibrated from %u frames: bias %d/%d us, jitter %u us "
+          "(max %u)",
+          channel, result->frames, result->mark_bias_us,
+          result->space_bias_us, result->jitter_us, result->max_jitter_us);
+  return ret;
+}
+
+int ir_calib_clear(uint8_t channel) {
+  if (channel >= IR_HAL_RX_CHANNELS) {
+    return -EINVAL;
+  }
+
+  ir_hal_rx_set_bias(channel, 0, 0);
+  return ir_calib_save();
+}
+
+#ifdef CONFIG_FILE_SYSTEM
+int ir_calib_save(void) {
+  calib_file_t data = {
+      .magic = CALIB_MAGIC,
+      .version = CALIB_VERSION,
+      .channels = IR_HAL_RX_CHANNELS,
+  };
+  struct fs_file_t file;
+
+  for (uint8_t i = 0; i < IR_HAL_RX_CHANNELS; i++) {
+    ir_hal_rx_get_bias(i, &data.bias[i][0], &data.bias[i][1]);
+  }
+
+  int ret = ir_fs_mount();
+  if (ret < 0) {
+    return ret;
+  }
+
+  fs_file_t_init(&file);
+  ret = fs_open(&file, IR_CALIB_PATH, FS_O_CREATE | FS_O_WRITE | FS_O_TRUNC);
+  if (ret < 0) {
+    LOG_ERR("Failed to create %s: %d", IR_CALIB_PATH, ret);
+    return ret;
+  }
+
+  ssize_t written = fs_write(&file, &data, sizeof(data));
+  fs_close(&file);
+  if (written != sizeof(data)) {
+    LOG_ERR("Failed to write %s: %d", IR_CALIB_PATH, (int)written);
+    return written < 0 ? (int)written : -ENOSPC;
+  }
+  return 0;
+}
+
+int ir_calib_load(void) {
+  calib_file_t data;
+  struct fs_file_t file;
+
+  fs_file_t_init(&file);
+  if (ir_fs_mount() < 0 || fs_open(&file, IR_CALIB_PATH, FS_O_READ) < 0) {
+    return -ENOENT;
+  }
+
+  ssize_t len = fs_read(&file, &data, sizeof(data));
+  fs_close(&file);
+  if (len != sizeof(data) || data.magic != CALIB_MAGIC ||
+      data.version != CALIB_VERSION) {
+    LOG_WRN("Ignoring invalid %s", IR_CALIB_PATH);
+    return -EINVAL;
+  }
+
+  for (uint8_t i = 0; i < MIN(data.channels, IR_HAL_RX_CHANNELS); i++) {
+    ir_hal_rx_set_bias(i, data.bias[i][0], data.bias[i][1]);
+    LOG_INF("RX%u bias %d/%d us", i, data.bias[i][0], data.bias[i][1]);
+  }
+  return 0;
+}
+#else
+int ir_calib_save(void) { return -ENOTSUP; }
+
+int ir_calib_load(void) { return -ENOTSUP; }
+#endif
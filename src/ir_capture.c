@@ -0,0 +1,123 @@
+/**
+ * @file ir_capture.c
+ * @brief 边沿流录制会话 - 订阅HAL边沿流，编码后暂存供shell导出
+ */
+
+#include "ir_capture.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(ir_capture, LOG_LEVEL_INF);
+
+/* 录制状态 - 回调在RX消费线程中写入，shell线程取出 */
+static struct {
+  struct k_spinlock lock;
+  uint8_t buf[IR_CAPTURE_BUFFER];
+  size_t len;
+  uint64_t prev_us; // 上一条写入记录的时间戳，丢弃的记录不计
+  bool active;
+  ir_capture_stats_t stats;
+} capture_state;
+
+static atomic_t capture_busy; // start到stop之间占用
+static int capture_subscriber;
+
+/* 整条写入或整条丢弃 - 丢弃的记录其时间差并入下一条，流仍可解析 */
+static void capture_rx_callback(ir_pulse_t *pulse, void *user_data) {
+  uint8_t record[IR_CAPTURE_RECORD_MAX];
+  k_spinlock_key_t key = k_spin_lock(&capture_state.lock);
+
+  if (!capture_state.active) {
+    k_spin_unlock(&capture_state.lock, key);
+    return;
+  }
+
+  size_t n = ir_capture_encode(capture_state.prev_us, pulse, record);
+  if (capture_state.len + n > sizeof(capture_state.buf)) {
+    capture_state.stats.dropped++;
+  } else {
+    memcpy(capture_state.buf + capture_state.len, record, n);
+    capture_state.len += n;
+    capture_state.prev_us = pulse->timestamp_us;
+    capture_state.stats.bytes += n;
+    capture_state.stats.records++;
+  }
+  k_spin_unlock(&capture_state.lock, key);
+}
+
+int ir_capture_start(uint8_t channels, const irdb_entry_t *label) {
+  if (channels == 0 || (channels & ~IR_HAL_RX_CH_ALL)) {
+    return -EINVAL;
+  }
+
+  ir_capture_header_t hdr = {
+      .channels = channels,
+      .start_us = k_ticks_to_us_floor64(k_uptime_ticks()),
+  };
+
+  if (label) {
+    hdr.label = *label;
+  } else {
+    hdr.label.protocol = IR_CAPTURE_NO_LABEL;
+  }
+
+  if (atomic_test_and_set_bit(&capture_busy, 0)) {
+    return -EBUSY;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&capture_state.lock);
+  capture_state.len = ir_capture_header_pack(&hdr, capture_state.buf);
+  capture_state.prev_us = hdr.start_us;
+  memset(&capture_state.stats, 0, sizeof(capture_state.stats));
+  capture_state.stats.bytes = capture_state.len;
+  capture_state.active = true;
+  k_spin_unlock(&capture_state.lock, key);
+
+  capture_subscriber = ir_hal_rx_subscribe(channels, capture_rx_callback,
+                                           NULL);
+  if (capture_subscriber < 0) {
+    LOG_ERR("RX subscribe failed: %d", capture_subscriber);
+    capture_state.active = false;
+    atomic_clear_bit(&capture_busy, 0);
+    return capture_subscriber;
+  }
+
+  LOG_INF("Capture started (channels 0x%x)", channels);
+  return 0;
+}
+
+size_t ir_capture_drain(uint8_t *buf, size_t size) {
+  if (!buf) {
+    return 0;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&capture_state.lock);
+  size_t n = MIN(size, capture_state.len);
+
+  memcpy(buf, capture_state.buf, n);
+  memmove(capture_state.buf, capture_state.buf + n, capture_state.len - n);
+  capture_state.len -= n;
+  k_spin_unlock(&capture_state.lock, key);
+  return n;
+}
+
+int ir_capture_stop(ir_capture_stats_t *stats) {
+  if (!atomic_test_bit(&capture_busy, 0)) {
+    return -EALREADY;
+  }
+
+  ir_hal_rx_unsubscribe(capture_subscriber);
+
+  k_spinlock_key_t key = k_spin_lock(&capture_state.lock);
+  capture_state.active = false;
+  if (stats) {
+    *stats = capture_state.stats;
+  }
+  k_spin_unlock(&capture_state.lock, key);
+
+  atomic_clear_bit(&capture_busy, 0);
+  LOG_INF("Capture stopped");
+  return 0;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file ir_capture_codec.c
+ * @brief 边沿流录制格式编解码 - 不依赖HAL，主机回放共用
+ */
+
+#include "ir_capture.h"
+#include <errno.h>
+#include <string.h>
+
+#define RECORD_MARK BIT(0)
+#define RECORD_FRAME_END BIT(1)
+#define RECORD_CHANNEL_SHIFT 2
+#define RECORD_CHANNEL_MASK 0x3
+#define RECORD_DURATION_SHIFT 4
+
+static void put_le16(uint8_t *p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+static uint16_t get_le16(const uint8_t *p) {
+  return p[0] | p[1] << 8;
+}
+
+static size_t put_varint(uint8_t *p, uint64_t v) {
+  size_t n = 0;
+
+  while (v >= 0x80) {
+    p[n++] = (uint8_t)v | 0x80;
+    v >>= 7;
+  }
+  p[n++] = (uint8_t)v;
+  return n;
+}
+
+/* 读LEB128 - 超过64位或越过end返回false */
+static bool get_varint(ir_capture_reader_t *reader, uint64_t *v) {
+  *v = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (reader->p >= reader->end) {
+      return false;
+    }
+
+    uint8_t byte = *reader->p++;
+    *v |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t ir_capture_header_pack(const ir_capture_header_t *hdr, uint8_t *out) {
+  memcpy(out, IR_CAPTURE_MAGIC, 4);
+  out[4] = IR_CAPTURE_VERSION;
+  out[5] = hdr->channels;
+  put_le16(out + 6, hdr->label.protocol);
+  put_le16(out + 8, hdr->label.device);
+  put_le16(out + 10, hdr->label.subdevice);
+  put_le16(out + 12, hdr->label.function);
+  put_le16(out + 14, 0);
+  for (int i = 0; i < 8; i++) {
+    out[16 + i] = hdr->start_us >> (8 * i);
+  }
+  return IR_CAPTURE_HEADER_SIZE;
+}
+
+int ir_capture_header_parse(const uint8_t *buf, size_t len,
+                            ir_capture_header_t *hdr) {
+  if (!buf || !hdr || len < IR_CAPTURE_HEADER_SIZE) {
+    return -EINVAL;
+  }
+  if (memcmp(buf, IR_CAPTURE_MAGIC, 4) != 0 ||
+      buf[4] != IR_CAPTURE_VERSION) {
+    return -EBADMSG;
+  }
+
+  memset(hdr, 0, sizeof(*hdr));
+  hdr->version = buf[4];
+  hdr->channels = buf[5];
+  hdr->label.name = IRDB_NAME_NONE;
+  hdr->label.protocol = get_le16(buf + 6);
+  hdr->label.device = get_le16(buf + 8);
+  hdr->label.subdevice = get_le16(buf + 10);
+  hdr->label.function = get_le16(buf + 12);
+  for (int i = 0; i < 8; i++) {
+    hdr->start_us |= (uint64_t)buf[16 + i] << (8 * i);
+  }
+  return 0;
+}
+
+size_t ir_capture_encode(uint64_t prev_us, const ir_pulse_t *pulse,
+                         uint8_t *out) {
+  /* 各通道的脉冲交错回调，时间戳不保证单调 */
+  int64_t delta = (int64_t)(pulse->timestamp_us - prev_us);
+  uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+  uint64_t value = (uint64_t)pulse->duration_us << RECORD_DURATION_SHIFT |
+                   (pulse->channel & RECORD_CHANNEL_MASK)
+                       << RECORD_CHANNEL_SHIFT |
+                   (pulse->frame_end ? RECORD_FRAME_END : 0) |
+                   (pulse->is_mark ? RECORD_MARK : 0);
+  size_t n = put_varint(out, zigzag);
+
+  return n + put_varint(out + n, value);
+}
+
+void ir_capture_reader_init(ir_capture_reader_t *reader,
+                            const ir_capture_header_t *hdr,
+                            const uint8_t *records, size_t len) {
+  reader->p = records;
+  reader->end = records + len;
+  reader->now_us = hdr->start_us;
+}
+
+int ir_capture_read(ir_capture_reader_t *reader, ir_pulse_t *pulse) {
+  uint64_t zigzag, value;
+
+  if (reader->p >= reader->end) {
+    return 0;
+  }
+  if (!get_varint(reader, &zigzag) || !get_varint(reader, &value) ||
+      value >> RECORD_DURATION_SHIFT > UINT32_MAX) {
+    return -EBADMSG;
+  }
+
+  int64_t delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+
+  reader->now_us += delta;
+  pulse->timestamp_us = reader->now_us;
+  pulse->duration_us = value >> RECORD_DURATION_SHIFT;
+  pulse->channel = (value >> RECORD_CHANNEL_SHIFT) & RECORD_CHANNEL_MASK;
+  pulse->frame_end = value & RECORD_FRAME_END;
+  pulse->is_mark = value & RECORD_MARK;
+  pulse->echo = false; // 录制时的订阅不接收回波
+  return 1;
+}
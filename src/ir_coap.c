@@ -0,0 +1,461 @@
+/**
+ * @file ir_coap.c
+ * @brief CoAP端点 - 资源路由、请求槽与发射完成后的独立响应
+ *
+ * 每个受理的请求占一个槽，命令以文本行存放在槽中，由工作项逐条入队;
+ * 队列满时停下，等本请求的一帧发射完成(回调重新调度工作项)再续发。
+ * 所有帧完成后回独立响应并释放槽。
+ */
+
+#include "ir_coap.h"
+#include "ir_service.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/net/socket.h>
+
+LOG_MODULE_REGISTER(ir_coap, LOG_LEVEL_INF);
+
+#define COAP_PATH_MAX 3   // ir/<遥控器>/<功能>
+#define COAP_QUERY_MAX 2  // r= c=
+#define COAP_REPLY_SIZE 128
+#define COAP_LINE_MAX (IR_SERVICE_REMOTE_ID_MAX + IRDB_NAME_MAX + 16)
+
+/* 资源发现 */
+static const char coap_links[] = "</ir>;rt=\"ir.send\","
+                                 "</ir/batch>;rt=\"ir.batch\";ct=0";
+
+/* 请求方 - 响应需要的地址、类型、消息ID和token */
+typedef struct {
+  struct sockaddr_in6 addr;
+  uint8_t type;
+  uint16_t mid;
+  uint8_t tkl;
+  uint8_t token[COAP_TOKEN_MAX_LEN];
+} coap_peer_t;
+
+/* 挂起请求 - 接收线程填写，之后只由工作项访问 (计数除外) */
+typedef struct {
+  atomic_t busy;
+  coap_peer_t peer;
+  char items[IR_COAP_PAYLOAD_MAX]; // 命令行，'\n'分隔
+  uint16_t length;
+  uint16_t cursor;      // 下一条待入队命令
+  uint16_t sent;        // 已入队条数
+  atomic_t outstanding; // 已入队未完成的帧
+  atomic_t result;      // 首个错误
+  struct k_work_delayable work;
+} coap_pending_t;
+
+static coap_pending_t pending[IR_COAP_PENDING];
+static ir_coap_stats_t coap_stats;
+static int coap_sock = -1;
+
+K_THREAD_STACK_DEFINE(coap_thread_stack, IR_COAP_THREAD_STACK_SIZE);
+static struct k_thread coap_thread;
+
+/* 接收缓冲 - 只在接收线程中使用，另留头部、token和选项的空间 */
+static uint8_t rx_buf[IR_COAP_PAYLOAD_MAX + 128];
+
+static void coap_send(const struct sockaddr_in6 *addr, uint8_t type,
+                      uint16_t mid, const uint8_t *token, uint8_t tkl,
+                      uint8_t code, uint16_t format, const char *payload) {
+  uint8_t buf[COAP_REPLY_SIZE];
+  struct coap_packet pkt;
+
+  int ret = coap_packet_init(&pkt, buf, sizeof(buf), COAP_VERSION_1, type,
+                             tkl, token, code, mid);
+  if (ret == 0 && payload) {
+    ret = coap_append_option_int(&pkt, COAP_OPTION_CONTENT_FORMAT, format);
+    if (ret == 0) {
+      ret = coap_packet_append_payload_marker(&pkt);
+    }
+    if (ret == 0) {
+      ret = coap_packet_append_payload(&pkt, (const uint8_t *)payload,
+                                       strlen(payload));
+    }
+  }
+  if (ret < 0) {
+    LOG_ERR("Failed to build response: %d", ret);
+    return;
+  }
+
+  if (sendto(coap_sock, buf, pkt.offset, 0, (const struct sockaddr *)addr,
+             sizeof(*addr)) < 0) {
+    LOG_WRN("Failed to send response: %d", -errno);
+  }
+}
+
+/* 立即响应 - 确认型请求用捎带ACK，非确认型用新的非确认响应 */
+static void coap_reply(const coap_peer_t *peer, uint8_t code, uint16_t format,
+                       const char *payload) {
+  bool con = peer->type == COAP_TYPE_CON;
+
+  coap_send(&peer->addr, con ? COAP_TYPE_ACK : COAP_TYPE_NON_CON,
+            con ? peer->mid : coap_next_id(), peer->token, peer->tkl, code,
+            format, payload);
+}
+
+/* 空ACK - 告知已收到，响应稍后单独发送 */
+static void coap_ack(const coap_peer_t *peer) {
+  if (peer->type == COAP_TYPE_CON) {
+    coap_send(&peer->addr, COAP_TYPE_ACK, peer->mid, NULL, 0, COAP_CODE_EMPTY,
+              0, NULL);
+  }
+}
+
+static uint8_t coap_code(int result) {
+  switch (result) {
+  case 0:
+    return COAP_RESPONSE_CODE_CHANGED;
+  case -ENOENT:
+    return COAP_RESPONSE_CODE_NOT_FOUND;
+  case -EINVAL:
+    return COAP_RESPONSE_CODE_BAD_REQUEST;
+  default:
+    return COAP_RESPONSE_CODE_INTERNAL_ERROR;
+  }
+}
+
+/* 取出一条命令 "<遥控器>/<功能>[,次数[,通道]]"，name为服务层的
+ * "编号:功能"，空行时name为空串; 返回下一条的位置 */
+static int next_item(const coap_pending_t *p, char *name, size_t size,
+                     uint32_t *repeat, uint8_t *channels) {
+  const char *line = p->items + p->cursor;
+  size_t left = p->length - p->cursor;
+  const char *end = memchr(line, '\n', left);
+  size_t len = end ? (size_t)(end - line) : left;
+  int next = p->cursor + len + (end ? 1 : 0);
+
+  if (len > 0 && line[len - 1] == '\r') {
+    len--;
+  }
+  if (len >= size) {
+    return -EINVAL;
+  }
+  memcpy(name, line, len);
+  name[len] = '\0';
+
+  *repeat = 1;
+  *channels = IR_HAL_TX_CH_DEFAULT;
+
+  char *sep = strchr(name, ',');
+  if (sep) {
+    char *rest;
+
+    *sep = '\0';
+    *repeat = strtoul(sep + 1, &rest, 10);
+    if (*rest == ',') {
+      uint8_t ch = strtoul(rest + 1, NULL, 0);
+      *channels = ch ? ch : IR_HAL_TX_CH_DEFAULT;
+    }
+  }
+
+  char *slash = strchr(name, '/');
+  if (slash) {
+    *slash = ':';
+  }
+  return next;
+}
+
+/* 发射完成 (TX线程) - 记下错误并让工作项续发或响应 */
+static void pending_done(int result, void *user_data) {
+  coap_pending_t *p = user_data;
+
+  if (result < 0) {
+    atomic_cas(&p->result, 0, result);
+  }
+  atomic_dec(&p->outstanding);
+  k_work_reschedule(&p->work, K_NO_WAIT);
+}
+
+static void pending_finish(coap_pending_t *p) {
+  int result = atomic_get(&p->result);
+  char payload[8];
+
+  if (result != 0) {
+    coap_stats.errors++;
+  }
+  snprintf(payload, sizeof(payload), "%u", p->sent);
+  coap_send(&p->peer.addr, COAP_TYPE_NON_CON, coap_next_id(), p->peer.token,
+            p->peer.tkl, coap_code(result), COAP_CONTENT_FORMAT_TEXT_PLAIN,
+            payload);
+  atomic_clear(&p->busy);
+}
+
+/* 逐条入队，队列满时等待本请求的帧完成 */
+static void pending_work_handler(struct k_work *work) {
+  coap_pending_t *p =
+      CONTAINER_OF(k_work_delayable_from_work(work), coap_pending_t, work);
+  char name[COAP_LINE_MAX];
+
+  /* 已响应的槽 - 最后一帧的完成回调与上一次执行交错时会多调度一次 */
+  if (!atomic_get(&p->busy)) {
+    return;
+  }
+
+  while (p->cursor < p->length && atomic_get(&p->result) == 0) {
+    uint32_t repeat;
+    uint8_t channels;
+    int next = next_item(p, name, sizeof(name), &repeat, &channels);
+
+    if (next < 0) {
+      atomic_cas(&p->result, 0, next);
+      break;
+    }
+    if (name[0] == '\0') {
+      p->cursor = next;
+      continue;
+    }
+
+    atomic_inc(&p->outstanding);
+    int ret = ir_service_send_async_on(name, repeat, channels, pending_done, p);
+    if (ret < 0) {
+      atomic_dec(&p->outstanding);
+    }
+    if (ret == -ENOBUFS) {
+      /* 本请求没有在途帧时不会有完成回调，定时重试 */
+      if (atomic_get(&p->outstanding) == 0) {
+        k_work_reschedule(&p->work, K_MSEC(IR_COAP_RETRY_MS));
+      }
+      return;
+    }
+    if (ret < 0) {
+      atomic_cas(&p->result, 0, ret);
+      break;
+    }
+
+    coap_stats.commands++;
+    p->sent++;
+    p->cursor = next;
+  }
+
+  if (atomic_get(&p->outstanding) == 0) {
+    pending_finish(p);
+  }
+}
+
+static bool option_is(const struct coap_option *option, const char *value) {
+  size_t len = strlen(value);
+
+  return option->len == len && memcmp(option->value, value, len) == 0;
+}
+
+static bool same_peer(const coap_peer_t *a, const coap_peer_t *b) {
+  return a->mid == b->mid && a->addr.sin6_port == b->addr.sin6_port &&
+         memcmp(&a->addr.sin6_addr, &b->addr.sin6_addr,
+                sizeof(a->addr.sin6_addr)) == 0;
+}
+
+/* 查询参数 r=次数 c=通道 */
+static void parse_query(const struct coap_packet *req, uint32_t *repeat,
+                        uint8_t *channels) {
+  struct coap_option query[COAP_QUERY_MAX];
+  int n = coap_find_options(req, COAP_OPTION_URI_QUERY, query, COAP_QUERY_MAX);
+
+  for (int i = 0; i < n; i++) {
+    char value[12];
+    size_t len = MIN(query[i].len, sizeof(value) - 1);
+
+    memcpy(value, query[i].value, len);
+    value[len] = '\0';
+    if (strncmp(value, "r=", 2) == 0) {
+      *repeat = strtoul(value + 2, NULL, 10);
+    } else if (strncmp(value, "c=", 2) == 0) {
+      *channels = strtoul(value + 2, NULL, 0);
+    }
+  }
+}
+
+/* 把请求放进槽中 - 单条命令也转成一行，与批量同样处理 */
+static int pending_fill(coap_pending_t *p, const struct coap_packet *req,
+                        const struct coap_option *path, int segments) {
+  if (segments == 2 && option_is(&path[1], "batch")) {
+    uint16_t len;
+    const uint8_t *payload = coap_packet_get_payload(req, &len);
+
+    if (!payload || len == 0) {
+      return -EINVAL;
+    }
+    if (len > sizeof(p->items)) {
+      return -EMSGSIZE;
+    }
+    memcpy(p->items, payload, len);
+    p->length = len;
+    return 0;
+  }
+
+  uint32_t repeat = 1;
+  uint8_t channels = 0;
+  int len;
+
+  parse_query(req, &repeat, &channels);
+  if (segments == 3) {
+    len = snprintf(p->items, sizeof(p->items), "%.*s/%.*s,%u,%u", path[1].len,
+                   (const char *)path[1].value, path[2].len,
+                   (const char *)path[2].value, repeat, channels);
+  } else {
+    len = snprintf(p->items, sizeof(p->items), "%.*s,%u,%u", path[1].len,
+                   (const char *)path[1].value, repeat, channels);
+  }
+  if (len < 0 || len >= (int)sizeof(p->items)) {
+    return -EMSGSIZE;
+  }
+  p->length = len;
+  return 0;
+}
+
+static void coap_handle_send(const coap_peer_t *peer,
+                             const struct coap_packet *req,
+                             const struct coap_option *path, int segments) {
+  /* 确认型请求的重传 (ACK丢失): 只补发ACK，不重复发送 */
+  for (int i = 0; i < IR_COAP_PENDING; i++) {
+    if (atomic_get(&pending[i].busy) && same_peer(&pending[i].peer, peer)) {
+      coap_ack(peer);
+      return;
+    }
+  }
+
+  coap_pending_t *p = NULL;
+  for (int i = 0; i < IR_COAP_PENDING && !p; i++) {
+    if (atomic_cas(&pending[i].busy, 0, 1)) {
+      p = &pending[i];
+    }
+  }
+  if (!p) {
+    coap_stats.rejected++;
+    coap_reply(peer, COAP_RESPONSE_CODE_SERVICE_UNAVAILABLE, 0, NULL);
+    return;
+  }
+
+  int ret = pending_fill(p, req, path, segments);
+  if (ret < 0) {
+    atomic_clear(&p->busy);
+    coap_stats.errors++;
+    coap_reply(peer,
+               ret == -EMSGSIZE ? COAP_RESPONSE_CODE_REQUEST_TOO_LARGE
+                                : COAP_RESPONSE_CODE_BAD_REQUEST,
+               0, NULL);
+    return;
+  }
+
+  p->peer = *peer;
+  p->cursor = 0;
+  p->sent = 0;
+  atomic_set(&p->outstanding, 0);
+  atomic_set(&p->result, 0);
+  coap_stats.requests++;
+
+  coap_ack(peer);
+  k_work_reschedule(&p->work, K_NO_WAIT);
+}
+
+static void coap_handle(uint8_t *data, size_t len,
+                        const struct sockaddr_in6 *addr) {
+  struct coap_packet req;
+  coap_peer_t peer = {.addr = *addr};
+
+  if (coap_packet_parse(&req, data, len, NULL, 0) < 0) {
+    coap_stats.invalid++;
+    return;
+  }
+
+  /* 独立响应是非确认型，不会收到ACK; 复位报文同样忽略 */
+  peer.type = coap_header_get_type(&req);
+  if (peer.type != COAP_TYPE_CON && peer.type != COAP_TYPE_NON_CON) {
+    return;
+  }
+  peer.mid = coap_header_get_id(&req);
+  peer.tkl = coap_header_get_token(&req, peer.token);
+
+  uint8_t code = coap_header_get_code(&req);
+  struct coap_option path[COAP_PATH_MAX + 1];
+  int segments =
+      coap_find_options(&req, COAP_OPTION_URI_PATH, path, ARRAY_SIZE(path));
+
+  if (segments == 2 && option_is(&path[0], ".well-known") &&
+      option_is(&path[1], "core")) {
+    coap_reply(&peer,
+               code == COAP_METHOD_GET ? COAP_RESPONSE_CODE_CONTENT
+                                       : COAP_RESPONSE_CODE_NOT_ALLOWED,
+               COAP_CONTENT_FORMAT_APP_LINK_FORMAT,
+               code == COAP_METHOD_GET ? coap_links : NULL);
+    return;
+  }
+
+  if (segments < 2 || segments > COAP_PATH_MAX ||
+      !option_is(&path[0], "ir")) {
+    coap_stats.invalid++;
+    coap_reply(&peer, COAP_RESPONSE_CODE_NOT_FOUND, 0, NULL);
+    return;
+  }
+  if (code != COAP_METHOD_POST) {
+    coap_stats.invalid++;
+    coap_reply(&peer, COAP_RESPONSE_CODE_NOT_ALLOWED, 0, NULL);
+    return;
+  }
+
+  coap_handle_send(&peer, &req, path, segments);
+}
+
+static void coap_thread_entry(void *p1, void *p2, void *p3) {
+  while (1) {
+    struct sockaddr_in6 addr;
+    socklen_t addr_len = sizeof(addr);
+    ssize_t len = recvfrom(coap_sock, rx_buf, sizeof(rx_buf), 0,
+                           (struct sockaddr *)&addr, &addr_len);
+
+    if (len < 0) {
+      LOG_ERR("Receive failed: %d", -errno);
+      k_sleep(K_MSEC(100));
+      continue;
+    }
+    coap_handle(rx_buf, len, &addr);
+  }
+}
+
+void ir_coap_get_stats(ir_coap_stats_t *stats) {
+  if (stats) {
+    *stats = coap_stats;
+  }
+}
+
+int ir_coap_init(void) {
+  struct sockaddr_in6 addr = {
+      .sin6_family = AF_INET6,
+      .sin6_port = htons(IR_COAP_PORT),
+      .sin6_addr = in6addr_any,
+  };
+
+  for (int i = 0; i < IR_COAP_PENDING; i++) {
+    k_work_init_delayable(&pending[i].work, pending_work_handler);
+  }
+
+  coap_sock = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+  if (coap_sock < 0) {
+    LOG_ERR("Failed to create socket: %d", -errno);
+    return -errno;
+  }
+
+  if (bind(coap_sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    int ret = -errno;
+
+    LOG_ERR("Failed to bind port %u: %d", IR_COAP_PORT, ret);
+    close(coap_sock);
+    coap_sock = -1;
+    return ret;
+  }
+
+  k_thread_create(&coap_thread, coap_thread_stack,
+                  K_THREAD_STACK_SIZEOF(coap_thread_stack), coap_thread_entry,
+                  NULL, NULL, NULL, K_PRIO_PREEMPT(IR_COAP_THREAD_PRIORITY), 0,
+                  K_NO_WAIT);
+  k_thread_name_set(&coap_thread, "ir_coap");
+
+  LOG_INF("CoAP endpoints on port %u", IR_COAP_PORT);
+  return 0;
+}
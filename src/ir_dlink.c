@@ -0,0 +1,628 @@
+/**
+ * @file ir_dlink.c
+ * @brief 红外数据链路实现 - 脉冲间隔编码、停等确认和文件收发
+ */
+
+#include "ir_dlink.h"
+#include "ir_fs.h"
+#include "ir_hal.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+
+LOG_MODULE_REGISTER(ir_dlink, LOG_LEVEL_INF);
+
+#define DLINK_CRC_SEED 0xFFFF
+#define DLINK_SYMBOLS (IR_DLINK_FRAME_MAX * 4)   // 每字节4个符号
+#define DLINK_TIMINGS (2 + 2 * DLINK_SYMBOLS + 1) // 同步 符号 结束mark
+#define DLINK_FRAME_GAP_US                                                     \
+  MAX(IR_DLINK_GAP_TICKS * IR_DLINK_TICK_US, IR_HAL_FRAME_GAP_MIN_US)
+#define DLINK_CLOCK_HZ (USEC_PER_SEC / IR_DLINK_TICK_US) // 包络输出的时长节拍
+#define DLINK_FILE_HEADER 8 // FILE负载中路径之前的大小和CRC32
+
+BUILD_ASSERT(IR_DLINK_TICK_US > IR_HAL_RX_MIN_MARK_US &&
+                 IR_DLINK_TICK_US > IR_HAL_RX_MIN_SPACE_US,
+             "IR_DLINK_TICK_US must exceed the RX glitch filter");
+BUILD_ASSERT(IR_DLINK_PAYLOAD_MAX <= UINT8_MAX,
+             "IR_DLINK_PAYLOAD_MAX must fit the u8 length field");
+BUILD_ASSERT(IR_DLINK_PAYLOAD_MAX >= DLINK_FILE_HEADER + IR_DLINK_PATH_MAX,
+             "IR_DLINK_PAYLOAD_MAX must hold a FILE frame");
+
+/* 收到的一帧 - 已核对长度和CRC */
+typedef struct {
+  uint16_t len;
+  uint8_t data[IR_DLINK_FRAME_MAX];
+} dlink_frame_t;
+
+K_MSGQ_DEFINE(dlink_frames, sizeof(dlink_frame_t), 2, 4);
+
+/* 接收解码状态 - 只在RX消费线程的回调中访问 */
+static struct {
+  dlink_frame_t frame;
+  uint32_t mark_us;
+  uint32_t bits; // 当前帧已收的位数
+  uint32_t errors;
+  bool in_frame;
+  bool bad;
+} rx;
+
+/* 会话 - 同一时刻只有一个，收发两端共用 */
+typedef struct {
+  ir_dlink_stats_t *stats;
+  uint32_t gap;
+  bool envelope;
+  int sub;
+  uint8_t seq;    // 发送端: 下一帧的序号
+  bool connected; // 发送端: 已收到过对面的ACK
+} dlink_session_t;
+
+static ir_timing_t tx_timings[DLINK_TIMINGS];
+static atomic_t dlink_busy;
+
+static void dlink_rx_finish(void) {
+  const uint8_t *d = rx.frame.data;
+  size_t len = rx.bits / 8;
+
+  if (rx.bad || rx.bits % 8 != 0 ||
+      len < IR_DLINK_HEADER_SIZE + IR_DLINK_CRC_SIZE ||
+      len != IR_DLINK_HEADER_SIZE + d[2] + IR_DLINK_CRC_SIZE ||
+      crc16_itu_t(DLINK_CRC_SEED, d, len - IR_DLINK_CRC_SIZE) !=
+          sys_get_le16(d + len - IR_DLINK_CRC_SIZE)) {
+    rx.errors++;
+    return;
+  }
+
+  rx.frame.len = len;
+  /* 停等协议下队列不会满，满了说明对面乱发，丢弃由重发兜底 */
+  k_msgq_put(&dlink_frames, &rx.frame, K_NO_WAIT);
+}
+
+/* 逐个脉冲解码 - 相邻mark起点的间隔取整到节拍，同步符号开始一帧，
+ * 帧结束时核对 */
+static void dlink_rx_callback(ir_pulse_t *pulse, void *user_data) {
+  if (pulse->frame_end) {
+    if (rx.in_frame) {
+      dlink_rx_finish();
+    }
+    rx.in_frame = false;
+    return;
+  }
+  if (pulse->is_mark) {
+    rx.mark_us = pulse->duration_us;
+    return;
+  }
+
+  uint32_t ticks =
+      (rx.mark_us + pulse->duration_us + IR_DLINK_TICK_US / 2) /
+      IR_DLINK_TICK_US;
+
+  if (ticks == IR_DLINK_SYNC_TICKS) {
+    rx.in_frame = true;
+    rx.bad = false;
+    rx.bits = 0;
+    return;
+  }
+  if (!rx.in_frame || rx.bad) {
+    return;
+  }
+  if (ticks < 2 || ticks > 5 || rx.bits >= 8 * IR_DLINK_FRAME_MAX) {
+    rx.bad = true;
+    return;
+  }
+
+  uint8_t *b = &rx.frame.data[rx.bits / 8];
+
+  if (rx.bits % 8 == 0) {
+    *b = 0;
+  }
+  *b |= (ticks - 2) << (6 - rx.bits % 8);
+  rx.bits += 2;
+}
+
+/* 按线路编码生成一帧的时序，返回时序数 */
+static size_t dlink_encode(const uint8_t *data, size_t len, ir_timing_t *t) {
+  size_t n = 0;
+
+  t[n++] = ir_timing_pack(IR_DLINK_TICK_US);
+  t[n++] = ir_timing_pack((IR_DLINK_SYNC_TICKS - 1) * IR_DLINK_TICK_US);
+  for (size_t i = 0; i < len; i++) {
+    for (int shift = 6; shift >= 0; shift -= 2) {
+      uint32_t k = (data[i] >> shift) & 3;
+
+      t[n++] = ir_timing_pack(IR_DLINK_TICK_US);
+      t[n++] = ir_timing_pack((1 + k) * IR_DLINK_TICK_US);
+    }
+  }
+  t[n++] = ir_timing_pack(IR_DLINK_TICK_US);
+  return n;
+}
+
+static int dlink_tx(dlink_session_t *s, uint8_t type, uint8_t seq,
+                    const void *payload, size_t len) {
+  uint8_t frame[IR_DLINK_FRAME_MAX];
+
+  frame[0] = type;
+  frame[1] = seq;
+  frame[2] = len;
+  if (len > 0) {
+    memcpy(frame + IR_DLINK_HEADER_SIZE, payload, len);
+  }
+  len += IR_DLINK_HEADER_SIZE;
+  sys_put_le16(crc16_itu_t(DLINK_CRC_SEED, frame, len), frame + len);
+  len += IR_DLINK_CRC_SIZE;
+
+  size_t count = dlink_encode(frame, len, tx_timings);
+
+  s->stats->frames++;
+  if (IS_ENABLED(CONFIG_IR_DLINK_ENVELOPE)) {
+    return ir_hal_tx_frame(tx_timings, count, DLINK_CLOCK_HZ, 0);
+  }
+  return ir_hal_tx_frame(tx_timings, count, IR_DLINK_CARRIER, IR_DLINK_DUTY);
+}
+
+static int dlink_ack(dlink_session_t *s, uint8_t seq, int status) {
+  uint8_t payload[2];
+
+  sys_put_le16((uint16_t)(int16_t)status, payload);
+  return dlink_tx(s, IR_DLINK_ACK, seq, payload, sizeof(payload));
+}
+
+/* 发送一帧并等待ACK，*status为对面的状态。重发用尽返回-EIO; 尚未收到
+ * 过ACK时首帧在IR_DLINK_CONNECT_MS内持续重发，等对面开始接收，超时
+ * 返回-ETIMEDOUT */
+static int dlink_request(dlink_session_t *s, uint8_t type, const void *payload,
+                         size_t len, int *status) {
+  int64_t connect_until = k_uptime_get() + IR_DLINK_CONNECT_MS;
+  uint8_t seq = s->seq++;
+
+  for (uint32_t attempt = 0;; attempt++) {
+    if (attempt > 0) {
+      s->stats->retries++;
+    }
+
+    int ret = dlink_tx(s, type, seq, payload, len);
+    if (ret < 0) {
+      return ret;
+    }
+
+    int64_t until = k_uptime_get() + IR_DLINK_ACK_TIMEOUT_MS;
+    dlink_frame_t ack;
+
+    /* 跳过迟到的旧ACK */
+    while (k_msgq_get(&dlink_frames, &ack,
+                      K_MSEC(MAX(until - k_uptime_get(), 0))) == 0) {
+      if (ack.data[0] == IR_DLINK_ACK && ack.data[1] == seq &&
+          ack.data[2] >= 2) {
+        s->connected = true;
+        *status = (int16_t)sys_get_le16(ack.data + IR_DLINK_HEADER_SIZE);
+        return 0;
+      }
+    }
+
+    if (s->connected && attempt >= IR_DLINK_RETRIES) {
+      return -EIO;
+    }
+    if (!s->connected && k_uptime_get() >= connect_until) {
+      return -ETIMEDOUT;
+    }
+  }
+}
+
+/* 进入会话 - 帧间隔按节拍缩短，订阅接收通道，整个会话持有TX电源引用 */
+static int dlink_begin(dlink_session_t *s, uint8_t rx_channel,
+                       ir_dlink_stats_t *stats) {
+  if (rx_channel >= IR_HAL_RX_CHANNELS) {
+    return -EINVAL;
+  }
+  if (atomic_test_and_set_bit(&dlink_busy, 0)) {
+    return -EBUSY;
+  }
+
+  memset(s, 0, sizeof(*s));
+  memset(stats, 0, sizeof(*stats));
+  s->stats = stats;
+  s->gap = ir_hal_rx_get_frame_gap();
+  s->envelope = ir_hal_tx_get_envelope();
+
+  rx.in_frame = false;
+  rx.errors = 0;
+  k_msgq_purge(&dlink_frames);
+
+  ir_hal_rx_set_frame_gap(DLINK_FRAME_GAP_US);
+  if (IS_ENABLED(CONFIG_IR_DLINK_ENVELOPE)) {
+    ir_hal_tx_set_envelope(true);
+  }
+  s->sub = ir_hal_rx_subscribe(BIT(rx_channel), dlink_rx_callback, NULL);
+  if (s->sub < 0) {
+    ir_hal_tx_set_envelope(s->envelope);
+    ir_hal_rx_set_frame_gap(s->gap);
+    atomic_clear_bit(&dlink_busy, 0);
+    return s->sub;
+  }
+
+  ir_hal_tx_power_get();
+  stats->elapsed_ms = k_uptime_get_32();
+  return 0;
+}
+
+static void dlink_end(dlink_session_t *s) {
+  s->stats->elapsed_ms = k_uptime_get_32() - s->stats->elapsed_ms;
+  ir_hal_tx_power_put();
+  ir_hal_rx_unsubscribe(s->sub);
+  ir_hal_tx_set_envelope(s->envelope);
+  ir_hal_rx_set_frame_gap(s->gap);
+  s->stats->errors = rx.errors;
+  atomic_clear_bit(&dlink_busy, 0);
+}
+
+/* 读遍文件求CRC32 */
+static int dlink_file_crc(struct fs_file_t *file, uint8_t *buf,
+                          uint32_t *size, uint32_t *crc) {
+  ssize_t n;
+
+  *size = 0;
+  *crc = 0;
+  while ((n = fs_read(file, buf, IR_DLINK_PAYLOAD_MAX)) > 0) {
+    *crc = crc32_ieee_update(*crc, buf, n);
+    *size += n;
+  }
+  return n < 0 ? n : fs_seek(file, 0, FS_SEEK_SET);
+}
+
+/* 发送一个文件 - 链路失败时返回负errno结束会话，否则*status为本地
+ * 读取或对面的结果 */
+static int dlink_send_file(dlink_session_t *s, const char *path,
+                           int *status) {
+  uint8_t buf[IR_DLINK_PAYLOAD_MAX];
+  size_t path_len = strlen(path);
+  struct fs_file_t file;
+  uint32_t size, crc;
+  int ret;
+
+  if (path_len >= IR_DLINK_PATH_MAX) {
+    *status = -ENAMETOOLONG;
+    return 0;
+  }
+
+  fs_file_t_init(&file);
+  *status = fs_open(&file, path, FS_O_READ);
+  if (*status < 0) {
+    return 0;
+  }
+  *status = dlink_file_crc(&file, buf, &size, &crc);
+  if (*status < 0) {
+    fs_close(&file);
+    return 0;
+  }
+
+  sys_put_le32(size, buf);
+  sys_put_le32(crc, buf + 4);
+  memcpy(buf + DLINK_FILE_HEADER, path, path_len);
+  ret = dlink_request(s, IR_DLINK_FILE, buf, DLINK_FILE_HEADER + path_len,
+                      status);
+
+  /* 读取出错时提前结束，对面核对大小失败后丢弃 */
+  ssize_t n = 0;
+  while (ret == 0 && *status == 0 &&
+         (n = fs_read(&file, buf, sizeof(buf))) > 0) {
+    ret = dlink_request(s, IR_DLINK_DATA, buf, n, status);
+  }
+  fs_close(&file);
+
+  if (ret == 0 && *status == 0) {
+    ret = dlink_request(s, IR_DLINK_END, NULL, 0, status);
+    if (ret == 0 && *status == 0 && n < 0) {
+      *status = n;
+    }
+  }
+  if (ret == 0 && *status == 0) {
+    s->stats->bytes += size;
+  }
+  return ret;
+}
+
+/* 发送一个文件并计入统计 */
+static int dlink_send_one(dlink_session_t *s, const char *path, uint32_t size,
+                          ir_dlink_file_cb_t cb, void *user_data) {
+  int status;
+  int ret = dlink_send_file(s, path, &status);
+
+  if (ret < 0) {
+    return ret;
+  }
+  if (status == 0) {
+    s->stats->files++;
+  } else {
+    s->stats->failed++;
+  }
+  if (cb) {
+    cb(path, size, status, user_data);
+  }
+  return 0;
+}
+
+/* 发送一个路径 - 目录发送其中的文件，跳过未完成的接收("~"结尾) */
+static int dlink_send_path(dlink_session_t *s, const char *path,
+                           ir_dlink_file_cb_t cb, void *user_data) {
+  struct fs_dirent entry;
+  struct fs_dir_t dir;
+  int ret;
+
+  ret = fs_stat(path, &entry);
+  if (ret < 0) {
+    s->stats->failed++;
+    if (cb) {
+      cb(path, 0, ret, user_data);
+    }
+    return 0;
+  }
+  if (entry.type == FS_DIR_ENTRY_FILE) {
+    return dlink_send_one(s, path, entry.size, cb, user_data);
+  }
+
+  fs_dir_t_init(&dir);
+  ret = fs_opendir(&dir, path);
+  if (ret < 0) {
+    return ret;
+  }
+
+  while (ret == 0 && fs_readdir(&dir, &entry) == 0 &&
+         entry.name[0] != '\0') {
+    size_t len = strlen(entry.name);
+    char child[IR_DLINK_PATH_MAX + 1];
+
+    if (entry.type != FS_DIR_ENTRY_FILE || entry.name[len - 1] == '~') {
+      continue;
+    }
+
+    snprintf(child, sizeof(child), "%s/%s", path, entry.name);
+    ret = dlink_send_one(s, child, entry.size, cb, user_data);
+  }
+  fs_closedir(&dir);
+  return ret;
+}
+
+int ir_dlink_send(const char *const *paths, size_t count, uint8_t rx_channel,
+                  ir_dlink_file_cb_t cb, void *user_data,
+                  ir_dlink_stats_t *stats) {
+  dlink_session_t s;
+  int status;
+  int ret;
+
+  if (!paths || count == 0 || !stats) {
+    return -EINVAL;
+  }
+  ret = ir_fs_mount();
+  if (ret < 0) {
+    return ret;
+  }
+  ret = dlink_begin(&s, rx_channel, stats);
+  if (ret < 0) {
+    return ret;
+  }
+
+  /* 序号从随机值开始，对面不会把新会话的首帧当作上一会话的重发 */
+  s.seq = k_cycle_get_32();
+  for (size_t i = 0; ret == 0 && i < count; i++) {
+    ret = dlink_send_path(&s, paths[i], cb, user_data);
+  }
+  if (ret == 0) {
+    /* 文件都已确认，BYE的ACK丢失不算失败 */
+    dlink_request(&s, IR_DLINK_BYE, NULL, 0, &status);
+  }
+  dlink_end(&s);
+
+  if (ret < 0) {
+    LOG_ERR("Send failed after %u files: %d", stats->files, ret);
+    return ret;
+  }
+
+  LOG_INF("Sent %u files (%u failed), %u bytes in %u ms, %u retries",
+          stats->files, stats->failed, stats->bytes, stats->elapsed_ms,
+          stats->retries);
+  return stats->files;
+}
+
+/* 接收端的当前文件 - 写入"路径~"，END核对后改名 */
+typedef struct {
+  struct fs_file_t file;
+  char path[IR_DLINK_PATH_MAX];
+  char tmp[IR_DLINK_PATH_MAX + 1];
+  uint32_t size;
+  uint32_t crc;
+  uint32_t got;
+  uint32_t got_crc;
+  bool open;
+} dlink_rx_file_t;
+
+static void dlink_rx_discard(dlink_rx_file_t *f) {
+  if (f->open) {
+    fs_close(&f->file);
+    fs_unlink(f->tmp);
+    f->open = false;
+  }
+}
+
+static int dlink_rx_open(dlink_rx_file_t *f, const uint8_t *payload,
+                         size_t len) {
+  size_t path_len = len - DLINK_FILE_HEADER;
+
+  dlink_rx_discard(f);
+  f->path[0] = '\0';
+  if (len <= DLINK_FILE_HEADER || path_len >= IR_DLINK_PATH_MAX ||
+      payload[DLINK_FILE_HEADER] != '/') {
+    return -EINVAL;
+  }
+
+  f->size = sys_get_le32(payload);
+  f->crc = sys_get_le32(payload + 4);
+  f->got = 0;
+  f->got_crc = 0;
+  memcpy(f->path, payload + DLINK_FILE_HEADER, path_len);
+  f->path[path_len] = '\0';
+
+  /* 对面给出的路径只能落在LittleFS下，不能用".."跳出 */
+  if (strncmp(f->path, IR_DLINK_ROOT, strlen(IR_DLINK_ROOT)) != 0 ||
+      strstr(f->path, "..") || strlen(f->path) != path_len) {
+    f->path[0] = '\0';
+    return -EACCES;
+  }
+  snprintf(f->tmp, sizeof(f->tmp), "%s~", f->path);
+
+  /* 上一级目录可能还不存在 (如IRDB_STORE_DIR) */
+  char *slash = strrchr(f->path, '/');
+  if (slash && slash != f->path) {
+    *slash = '\0';
+    fs_mkdir(f->path);
+    *slash = '/';
+  }
+
+  fs_unlink(f->tmp);
+  fs_file_t_init(&f->file);
+  int ret = fs_open(&f->file, f->tmp, FS_O_CREATE | FS_O_WRITE);
+  if (ret < 0) {
+    return ret;
+  }
+  f->open = true;
+  return 0;
+}
+
+static int dlink_rx_write(dlink_rx_file_t *f, const uint8_t *data,
+                          size_t len) {
+  if (!f->open) {
+    return -EBADF;
+  }
+  if (f->got + len > f->size) {
+    return -EFBIG;
+  }
+
+  ssize_t n = fs_write(&f->file, data, len);
+  if (n < 0) {
+    return n;
+  }
+  if ((size_t)n != len) {
+    return -ENOSPC;
+  }
+  f->got_crc = crc32_ieee_update(f->got_crc, data, len);
+  f->got += len;
+  return 0;
+}
+
+static int dlink_rx_close(dlink_rx_file_t *f) {
+  if (!f->open) {
+    return -EBADF;
+  }
+
+  int ret = fs_close(&f->file);
+  f->open = false;
+  if (ret == 0 && (f->got != f->size || f->got_crc != f->crc)) {
+    ret = -EBADMSG;
+  }
+  if (ret == 0) {
+    fs_unlink(f->path);
+    ret = fs_rename(f->tmp, f->path);
+  }
+  if (ret < 0) {
+    fs_unlink(f->tmp);
+  }
+  return ret;
+}
+
+int ir_dlink_receive(uint8_t rx_channel, uint32_t idle_ms,
+                     ir_dlink_file_cb_t cb, void *user_data,
+                     ir_dlink_stats_t *stats) {
+  static dlink_rx_file_t f;
+  dlink_session_t s;
+  dlink_frame_t frame;
+  int last_seq = -1;
+  int last_status = 0;
+  bool bye = false;
+  int ret;
+
+  if (!stats) {
+    return -EINVAL;
+  }
+  ret = ir_fs_mount();
+  if (ret < 0) {
+    return ret;
+  }
+  ret = dlink_begin(&s, rx_channel, stats);
+  if (ret < 0) {
+    return ret;
+  }
+
+  f.open = false;
+  while (!bye && k_msgq_get(&dlink_frames, &frame, K_MSEC(idle_ms)) == 0) {
+    const uint8_t *payload = frame.data + IR_DLINK_HEADER_SIZE;
+    uint8_t type = frame.data[0];
+    uint8_t seq = frame.data[1];
+    size_t len = frame.data[2];
+    int status;
+
+    if (type == IR_DLINK_ACK) {
+      continue;
+    }
+    /* 对面没收到ACK而重发，不重复处理 */
+    if (seq == last_seq) {
+      stats->retries++;
+      dlink_ack(&s, seq, last_status);
+      continue;
+    }
+
+    switch (type) {
+    case IR_DLINK_FILE:
+      status = dlink_rx_open(&f, payload, len);
+      break;
+    case IR_DLINK_DATA:
+      status = dlink_rx_write(&f, payload, len);
+      break;
+    case IR_DLINK_END:
+      status = dlink_rx_close(&f);
+      break;
+    case IR_DLINK_BYE:
+      status = 0;
+      bye = true;
+      break;
+    default:
+      status = -ENOTSUP;
+      break;
+    }
+
+    /* 出错的文件不再接收后续段，对面收到错误状态后转到下一个文件 */
+    if (type == IR_DLINK_END || (status < 0 && type != IR_DLINK_BYE)) {
+      dlink_rx_discard(&f);
+      if (status == 0) {
+        stats->files++;
+        stats->bytes += f.size;
+      } else {
+        stats->failed++;
+      }
+      if (cb) {
+        cb(f.path, f.got, status, user_data);
+      }
+    }
+    last_seq = seq;
+    last_status = status;
+    dlink_ack(&s, seq, status);
+  }
+
+  dlink_rx_discard(&f);
+  dlink_end(&s);
+
+  LOG_INF("Received %u files (%u failed), %u bytes in %u ms, %u bad frames",
+          stats->files, stats->failed, stats->bytes, stats->elapsed_ms,
+          stats->errors);
+  return bye || stats->files ? stats->files : -ETIMEDOUT;
+}
+
+uint32_t ir_dlink_rate(const ir_dlink_stats_t *stats) {
+  if (stats->elapsed_ms == 0) {
+    return 0;
+  }
+  return (uint64_t)stats->bytes * 8 * MSEC_PER_SEC / stats->elapsed_ms;
+}
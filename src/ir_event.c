@@ -0,0 +1,123 @@
+/**
+ * @file ir_event.c
+ * @brief 二进制事件跟踪实现
+ */
+
+#include "ir_event.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+
+/* 读取端的名称和格式 - code为真时参数按ir_event_code解包，fmt只描述
+ * extra；否则fmt依次消费a、b、c */
+static const struct {
+  const char *name;
+  const char *fmt;
+  bool code;
+} event_info[IR_EVENT_COUNT] = {
+    [IR_EVENT_TX_SENT] = {"tx_sent", "x%u", true},
+    [IR_EVENT_TX_PRONTO] = {"tx_pronto", "x%u, %u Hz", false},
+    [IR_EVENT_TX_DROPPED] = {"tx_dropped", "channels 0x%x, depth %u", false},
+    [IR_EVENT_RX_DECODED] = {"rx_decoded", "ch %u", true},
+    [IR_EVENT_RX_CODE] = {"rx_code", "ch %u (not in db)", true},
+    [IR_EVENT_RX_REPEAT] = {"rx_repeat", "ch %u", true},
+    [IR_EVENT_RX_FAILED] = {"rx_failed", "ch %u, %u timings", false},
+    [IR_EVENT_LEARN_DETECT] = {"learn_detect", "press %u/%u", false},
+    [IR_EVENT_LEARN_PRESS] = {"learn_press", "press %u/%u, %u edges", false},
+    [IR_EVENT_LEARN_DONE] = {"learn_done", "median of %u/%u, %u edges",
+                             false},
+};
+
+#ifdef CONFIG_IR_EVENT_TRACE
+static struct {
+  struct k_spinlock lock;
+  ir_event_t ring[IR_EVENT_RECORDS];
+  uint32_t total; // 已记录总数，ring[total % IR_EVENT_RECORDS]为下一条
+} event_state;
+
+void ir_event_emit(uint16_t id, uint16_t a, uint32_t b, uint32_t c) {
+  k_spinlock_key_t key = k_spin_lock(&event_state.lock);
+  ir_event_t *event = &event_state.ring[event_state.total % IR_EVENT_RECORDS];
+
+  event->cycles = k_cycle_get_32();
+  event->id = id;
+  event->a = a;
+  event->b = b;
+  event->c = c;
+  event_state.total++;
+  k_spin_unlock(&event_state.lock, key);
+}
+
+size_t ir_event_get(ir_event_t *out, size_t max) {
+  if (!out) {
+    return 0;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&event_state.lock);
+  uint32_t n = MIN(MIN(event_state.total, IR_EVENT_RECORDS), max);
+  uint32_t first = event_state.total - n;
+
+  for (uint32_t i = 0; i < n; i++) {
+    out[i] = event_state.ring[(first + i) % IR_EVENT_RECORDS];
+  }
+  k_spin_unlock(&event_state.lock, key);
+  return n;
+}
+
+uint32_t ir_event_total(void) {
+  return event_state.total;
+}
+
+void ir_event_clear(void) {
+  k_spinlock_key_t key = k_spin_lock(&event_state.lock);
+  event_state.total = 0;
+  k_spin_unlock(&event_state.lock, key);
+}
+#else
+size_t ir_event_get(ir_event_t *out, size_t max) {
+  return 0;
+}
+
+uint32_t ir_event_total(void) {
+  return 0;
+}
+
+void ir_event_clear(void) {
+}
+#endif /* CONFIG_IR_EVENT_TRACE */
+
+const char *ir_event_name(uint16_t id) {
+  return id < IR_EVENT_COUNT ? event_info[id].name : "?";
+}
+
+int ir_event_format(const ir_event_t *event, char *buf, size_t size) {
+  if (!event || !buf || size == 0) {
+    return -EINVAL;
+  }
+
+  if (event->id >= IR_EVENT_COUNT) {
+    return snprintf(buf, size, "? id %u: %u %u %u", event->id, event->a,
+                    event->b, event->c);
+  }
+
+  int n = snprintf(buf, size, "%s ", event_info[event->id].name);
+  if (n < 0 || (size_t)n >= size) {
+    return n;
+  }
+
+  if (!event_info[event->id].code) {
+    return n + snprintf(buf + n, size - n, event_info[event->id].fmt, event->a,
+                        event->b, event->c);
+  }
+
+  const irdb_protocol_params_t *params = irdb_get_protocol_params(event->a);
+  int m = snprintf(buf + n, size - n, "%s D:%u.%u F:%u ",
+                   params && params->name ? params->name : "?",
+                   event->b >> 16, event->b & 0xFFFF, event->c >> 16);
+  if (m < 0 || (size_t)(n + m) >= size) {
+    return n + m;
+  }
+  return n + m + snprintf(buf + n + m, size - n - m, event_info[event->id].fmt,
+                          event->c & 0xFFFF);
+}
@@ -0,0 +1,55 @@
+/**
+ * @file ir_fs.c
+ * @brief LittleFS按需挂载实现
+ */
+
+#include "ir_fs.h"
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#ifdef CONFIG_FILE_SYSTEM
+#include <zephyr/fs/fs.h>
+#endif
+
+LOG_MODULE_REGISTER(ir_fs, LOG_LEVEL_INF);
+
+#define IR_FS_NODE DT_NODELABEL(lfs1)
+
+#if defined(CONFIG_FILE_SYSTEM_LITTLEFS) && DT_NODE_EXISTS(IR_FS_NODE)
+FS_FSTAB_DECLARE_ENTRY(IR_FS_NODE);
+
+static K_MUTEX_DEFINE(fs_mutex);
+static bool fs_mounted;
+
+int ir_fs_mount(void) {
+  struct fs_mount_t *mp = &FS_FSTAB_ENTRY(IR_FS_NODE);
+  int ret = 0;
+
+  k_mutex_lock(&fs_mutex, K_FOREVER);
+
+  if (!fs_mounted) {
+    uint32_t start = k_cycle_get_32();
+
+    /* fstab仍带automount时已由文件系统驱动挂载 */
+    ret = fs_mount(mp);
+    if (ret == -EBUSY) {
+      ret = 0;
+    }
+    if (ret < 0) {
+      LOG_ERR("Failed to mount %s: %d", mp->mnt_point, ret);
+    } else {
+      fs_mounted = true;
+      LOG_INF("%s mounted in %u us", mp->mnt_point,
+              k_cyc_to_us_floor32(k_cycle_get_32() - start));
+    }
+  }
+
+  k_mutex_unlock(&fs_mutex);
+  return ret;
+}
+#else
+int ir_fs_mount(void) {
+  return IS_ENABLED(CONFIG_FILE_SYSTEM) ? 0 : -ENOTSUP;
+}
+#endif
@@ -4,157 +4,2820 @@
  */
 
 #include "ir_hal.h"
+#include "ir_ring.h"
+#ifdef IR_HAL_RX_IPC
+#include "ir_hal_ipc.h"
+#endif
+#ifdef IR_HAL_RX_WAKE_OFF
+#include "ir_hal_wake.h"
+#include <zephyr/sys/poweroff.h>
+#endif
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/logging/log.h>
 
+#ifdef CONFIG_CLOCK_CONTROL_NRF
+#include <zephyr/drivers/clock_control/nrf_clock_control.h>
+#endif
+
+#ifdef CONFIG_PM_DEVICE_RUNTIME
+#include <zephyr/pm/device_runtime.h>
+#endif
+
+#if defined(IR_HAL_TX_SEQ) || defined(IR_HAL_RX_CAPTURE) ||                  \
+    defined(IR_HAL_CARRIER) || defined(IR_HAL_TX_GATE) ||                     \
+    defined(IR_HAL_TX_I2S) || defined(IR_HAL_TX_ZLI)
+#include <hal/nrf_gpio.h>
+#endif
+
+#ifdef IR_HAL_TX_ZLI
+#include <nrfx_timer.h>
+#endif
+
+#ifdef IR_HAL_TX_SEQ
+#include <nrfx_pwm.h>
+#endif
+
+#ifdef IR_HAL_TX_I2S
+#include <nrfx_i2s.h>
+#endif
+
+#ifdef IR_HAL_RX_ADC
+#include <nrfx_saadc.h>
+#include <stdlib.h>
+#endif
+
+#if defined(IR_HAL_RX_CAPTURE) || defined(IR_HAL_CARRIER) ||                  \
+    defined(IR_HAL_TX_GATE)
+#include <helpers/nrfx_gppi.h>
+#include <nrfx_gpiote.h>
+#include <nrfx_timer.h>
+#endif
+
 LOG_MODULE_REGISTER(ir_hal, LOG_LEVEL_INF);
 
+#ifdef IR_HAL_TX_SEQ
+/* PWM0实例 - 由nrfx直接驱动 */
+static const nrfx_pwm_t pwm_seq = NRFX_PWM_INSTANCE(0);
+
+/* 比较值表 - EasyDMA直接读取，按掩码索引。COMMON装载只读第一个值(掩码
+ * 1为mark)，INDIVIDUAL装载每个通道一个值，置位的通道为mark */
+#define SEQ_SLOTS (IR_HAL_TX_CHANNELS > 1 ? NRF_PWM_CHANNEL_COUNT : 1)
+static nrf_pwm_values_common_t seq_table[1 << SEQ_SLOTS][SEQ_SLOTS];
+
+/* 段(见下方的序列编译)由TX线程写入环形缓冲，PWM中断在SEQ0/SEQ1交替
+ * 结束时取出，周期数即SEQ[n].REFRESH，一个比较值保持整段 */
+#define SEQ_GUARD_US 200 // 末尾space的最短时长，给中断装入最后一段留余量
+IR_RING_DEFINE(seq_ring, IR_HAL_SEQ_SEGMENTS);
+
+/* bit15为极性位: 置1时计数值小于比较值输出高电平，比较值0即恒低 */
+#define SEQ_POLARITY 0x8000
+
+/* 各通道的发射管引脚，未用的通道不连接 */
+static const uint32_t tx_seq_pins[NRF_PWM_CHANNEL_COUNT] = {
+    IR_TX_PIN,
+#if IR_HAL_TX_CHANNELS > 1
+    CONFIG_IR_HAL_TX_PIN1,
+#else
+    NRF_PWM_PIN_NOT_CONNECTED,
+#endif
+#if IR_HAL_TX_CHANNELS > 2
+    CONFIG_IR_HAL_TX_PIN2,
+#else
+    NRF_PWM_PIN_NOT_CONNECTED,
+#endif
+#if IR_HAL_TX_CHANNELS > 3
+    CONFIG_IR_HAL_TX_PIN3,
+#else
+    NRF_PWM_PIN_NOT_CONNECTED,
+#endif
+};
+
+/* 输出路由: 通道掩码 | INDIVIDUAL装载标志 */
+#define SEQ_ROUTE_INDIVIDUAL BIT(7)
+#define SEQ_ROUTE_NONE 0xFF
+
+/* 发送状态 */
+static struct {
+  struct k_sem done;
+  uint32_t carrier_freq;
+  uint16_t top_value;
+  uint16_t mark_value; // mark期间的比较值，由占空比决定
+  uint8_t duty_cycle;  // ir_hal_tx_start设置，供ir_hal_tx_pulse使用
+  uint8_t route;       // 当前的输出路由
+  uint8_t seq_len;     // 每段的比较值个数 (COMMON 1，INDIVIDUAL 4)
+  struct k_sem space;  // 中断取走一段
+  uint32_t seq_left;   // 还要由中断装入的段数
+  bool underrun;       // 中断时缓冲为空
+  bool busy;
+} tx_state;
+
+static int tx_seq_init(void);
+#elif defined(IR_HAL_TX_I2S)
+/* I2S实例 - 由nrfx直接驱动，只连接SDOUT，SCK/LRCK在内部运行 */
+static const nrfx_i2s_t i2s_tx = NRFX_I2S_INSTANCE(0);
+
+/* 比特流缓冲 - EasyDMA回放一块时TX线程展开另一块 */
+#define I2S_BITS (IR_HAL_TX_I2S_WORDS * 32)
+static uint32_t i2s_buffers[2][IR_HAL_TX_I2S_WORDS];
+
+/* 发送状态 */
+static struct {
+  struct k_sem done;
+  struct k_sem space;  // 中断请求下一块缓冲
+  uint32_t carrier_freq;
+  uint32_t period_fx;  // 载波周期(比特，16.16定点)
+  uint32_t mark_bits;  // 每个载波周期开头的高电平比特数，由占空比决定
+  uint8_t duty_cycle;  // ir_hal_tx_start设置，供ir_hal_tx_pulse使用
+  uint32_t *released;  // 中断交回、可以重新展开的缓冲
+  bool wanted;         // 已请求下一块，TX线程尚未给出
+  bool last;           // 已给出的最后一块之后不再有信号
+  bool underrun;       // 请求时上一次请求仍未给出
+  bool busy;
+} tx_state;
+
+static int tx_i2s_init(void);
+#elif defined(IR_HAL_TX_GATE)
+static int tx_gate_init(void);
+#elif defined(IR_HAL_TX_ZLI)
+static int tx_zli_init(void);
+#elif defined(IR_HAL_TX_NONE)
+/* 接收引擎(网络核)不发送 */
+#else
 /* PWM设备 */
 static const struct pwm_dt_spec pwm_ir = PWM_DT_SPEC_GET(IR_TX_NODE);
+#endif
+
+#ifndef IR_HAL_RX_IPC
+/* 接收头引脚 - 设备树未描述时为gpio1上的IR_RX_PIN */
+#if DT_NODE_HAS_PROP(IR_RX_NODE, ir_rx_gpios)
+#define RX_GPIO_SPEC(node, prop, idx) GPIO_DT_SPEC_GET_BY_IDX(node, prop, idx),
+static const struct gpio_dt_spec rx_gpios[IR_HAL_RX_CHANNELS] = {
+    DT_FOREACH_PROP_ELEM(IR_RX_NODE, ir_rx_gpios, RX_GPIO_SPEC)};
+#else
+static const struct gpio_dt_spec rx_gpios[IR_HAL_RX_CHANNELS] = {{
+    .port = DEVICE_DT_GET(DT_NODELABEL(gpio1)),
+    .pin = IR_RX_PIN,
+    .dt_flags = GPIO_PULL_UP,
+}};
+#endif
+
+#ifdef IR_HAL_RX_CAPTURE
+BUILD_ASSERT(IR_HAL_RX_CHANNELS <= IR_HAL_RX_CHANNELS_MAX,
+             "capture backend supports at most 3 RX channels");
+
+/* 捕获后端按绝对引脚号配置GPIOTE */
+#if DT_NODE_HAS_PROP(IR_RX_NODE, ir_rx_gpios)
+#define RX_PSEL(node, prop, idx)                                               \
+  NRF_GPIO_PIN_MAP(DT_PROP(DT_GPIO_CTLR_BY_IDX(node, prop, idx), port),        \
+                   DT_GPIO_PIN_BY_IDX(node, prop, idx)),
+static const uint32_t rx_psel[IR_HAL_RX_CHANNELS] = {
+    DT_FOREACH_PROP_ELEM(IR_RX_NODE, ir_rx_gpios, RX_PSEL)};
+#else
+static const uint32_t rx_psel[IR_HAL_RX_CHANNELS] = {
+    NRF_GPIO_PIN_MAP(1, IR_RX_PIN)};
+#endif
+#endif
+
+/* 接收通道 - 每路独立的脉冲环和边沿状态，ISR只写本通道 */
+typedef struct {
+  ir_ring_t ring; // ISR -> 消费线程，元素为 时长|RX_PULSE_MARK或帧起点时间戳
+  uint32_t ring_buf[IR_HAL_RX_RING_SIZE];
+  uint64_t last_edge_us; // 上一个边沿(当前未结束的一段的起点)的扩展时间戳
+  int64_t last_seen;     // 上一个边沿被处理时的运行时间(tick)
+  bool last_state;
+  bool last_echo; // 上一个边沿在回波窗口内
+  bool has_edge; // 是否已有上一个边沿
+  bool frame_next; // 当前这一段是帧的首个脉冲
+  bool in_frame;   // 本帧已有脉冲入队，帧结束时需通知
+  /* 毛刺滤波的延迟线: 最近结束的一段暂存，下一段不是毛刺时才入队 */
+  uint64_t pending_start;
+  uint32_t pending_us;
+  bool pending_mark;
+  bool pending_frame;
+  bool pending_echo;
+  bool has_pending;
+  bool frame_real; // 本帧有非回波的脉冲
+  bool active;   // 有订阅者，硬件在采集
+  uint8_t index;
+  uint32_t edges;
+  uint32_t frames;
+  uint32_t max_fill;
+  uint32_t glitches;
+  uint32_t echo_dropped;
+  uint32_t echo_tagged;
+  uint32_t stamp_low; // 消费线程: 时间戳低30位，等待高位
+  uint64_t time_us;   // 消费线程: 下一个脉冲的起点
+#ifdef IR_HAL_RX_CAPTURE
+  uint8_t gpiote_ch;
+  uint8_t ppi_ch;
+#else
+  struct gpio_callback gpio_cb;
+#endif
+} rx_channel_t;
+
+static rx_channel_t rx_channels[IR_HAL_RX_CHANNELS];
+
+/* 各通道共用的消费线程状态 */
+static struct {
+  struct k_sem wake;   // 唤醒消费线程
+  atomic_t wake_pending;
+  uint32_t wakeups;
+  uint32_t sense_wakeups;
+  uint32_t wake_frames;
+} rx_state;
+
+#define RX_PULSE_MARK BIT(31)
+#define RX_PULSE_ECHO BIT(29) // 回波 (时长元素和帧结束标记，不用于时间戳)
+
+/* 帧起点时间戳 - 以两个带RX_PULSE_STAMP的元素入队: 先低30位，再带
+ * RX_PULSE_MARK的高30位。时长总小于IR_MAX_PULSE_US，不会与之混淆 */
+#define RX_PULSE_STAMP BIT(30)
+#define RX_STAMP_BITS 30
+#define RX_STAMP_MASK BIT_MASK(RX_STAMP_BITS)
+
+/* 帧结束标记 - 脉冲时长不会为0 */
+#define RX_FRAME_END 0
 
-/* GPIO设备 - 使用设备树方式获取 */
-#define RX_GPIO_NODE DT_NODELABEL(gpio1)
-static const struct device *gpio_dev = DEVICE_DT_GET(RX_GPIO_NODE);
+/* 帧间隔，各通道共用 */
+static uint32_t rx_frame_gap_us = IR_HAL_FRAME_GAP_US;
+static uint8_t rx_inverted; // 高电平为mark的通道 (环回跳线)
+static int16_t rx_bias[IR_HAL_RX_CHANNELS][2]; // 接收头补偿(us) [space, mark]
 
-/* GPIO回调结构 */
-static struct gpio_callback gpio_cb;
+/* 毛刺滤波 - 短于门限的一段连同其两侧并为一个脉冲，不入队 */
+#define RX_GLITCH_FILTER                                                       \
+  (IR_HAL_RX_MIN_MARK_US > 0 || IR_HAL_RX_MIN_SPACE_US > 0)
 
-/* 接收状态 */
+/* 边沿处理与帧结束冲刷互斥 (二者在不同优先级的中断中) */
+static struct k_spinlock rx_edge_lock;
+
+/* 回波窗口 - 发送期间到结束后IR_HAL_RX_ECHO_GUARD_US。边沿在ISR中即时
+ * 处理，按处理时刻的运行时间判断，不与TIMER1的捕获时间戳比较(二者时钟
+ * 不同源，长时间运行后相差可达数十毫秒); 持rx_edge_lock读写 */
 static struct {
+  int64_t until;  // 窗口结束(tick)
+  uint8_t depth;  // 进行中的发送 (兼容接口start/stop内再发整帧)
+  uint8_t wanted; // 有订阅者接收回波的通道 (持rx_subs_lock更新)
+} rx_echo;
+
+/* 订阅表 - callback为NULL的槽位空闲。ISR只入队一次，由消费线程按订阅表
+ * 分发给每个订阅者; 通道硬件按所有订阅者的通道并集起停 */
+typedef struct {
   ir_rx_callback_t callback;
   void *user_data;
-  uint32_t last_edge_us;
-  bool last_state;
-  bool active;
-} rx_state;
+  uint8_t channels;
+  bool echo; // 接收回波
+} rx_subscriber_t;
 
-/* GPIO中断处理 - 接收边沿检测 */
-static void gpio_callback_handler(const struct device *dev,
-                                  struct gpio_callback *cb, uint32_t pins) {
-  /* 安全检查 */
-  if (!rx_state.active) {
+static rx_subscriber_t rx_subs[IR_HAL_RX_SUBSCRIBERS];
+static struct k_spinlock rx_subs_lock; // 订阅表与通道起停，可在ISR中取
+
+K_THREAD_STACK_DEFINE(rx_thread_stack, IR_HAL_RX_THREAD_STACK_SIZE);
+static struct k_thread rx_thread;
+
+#ifdef IR_HAL_RX_CAPTURE
+/* 捕获资源: TIMER1自由运行于1MHz，通道i的GPIOTE事件经PPI锁存到CC[i]，
+ * CC[3]为各通道共用的帧结束比较 */
+static const nrfx_timer_t rx_timer = NRFX_TIMER_INSTANCE(1);
+static const nrfx_gpiote_t rx_gpiote = NRFX_GPIOTE_INSTANCE(0);
+#define RX_FRAME_CC NRF_TIMER_CC_CHANNEL3
+#define RX_FRAME_EVENT NRF_TIMER_EVENT_COMPARE3
+#define RX_HEARTBEAT_US BIT(30) // 帧间CC[3]的心跳间隔(约18分钟)
+
+/* 扩展时间戳 - TIMER1的32位计数按有符号差累加到64位。定时器每次从空闲
+ * 启动时以系统运行时间为起点; 帧间CC[3]改作心跳，保证两次观测之差远小于
+ * 2^31us，单次减法即得时长，且各通道锁存值的先后交错也不会误判回绕 */
+static struct {
+  uint64_t last_us;
+  uint32_t last_raw;
+  bool frame_pending; // CC[3]当前为帧结束比较(否则为心跳)
+} rx_time;
+
+/* 锁存计数 -> 扩展时间戳 (持rx_edge_lock) */
+static uint64_t rx_time_extend(uint32_t raw) {
+  int32_t delta = (int32_t)(raw - rx_time.last_raw);
+  uint64_t us = rx_time.last_us + delta;
+
+  if (delta > 0) {
+    rx_time.last_us = us;
+    rx_time.last_raw = raw;
+  }
+  return us;
+}
+#else
+/* 扩展时间戳 - 内核的64位运行时间(RTC由内核按溢出扩展) */
+static uint64_t rx_time_now(void) {
+  return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+#endif
+
+/* 是否还有通道在接收 */
+static bool rx_any_active(void) {
+  for (size_t i = 0; i < IR_HAL_RX_CHANNELS; i++) {
+    if (rx_channels[i].active) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* 唤醒消费线程 (同一批次只唤醒一次，各通道合并) */
+static void rx_wake(void) {
+  if (!atomic_test_and_set_bit(&rx_state.wake_pending, 0)) {
+    k_sem_give(&rx_state.wake);
+  }
+}
+
+/* ISR中入队一个脉冲 */
+static inline void rx_push_pulse(rx_channel_t *ch, uint32_t duration,
+                                 bool is_mark, bool echo) {
+  if (duration == 0 || duration >= IR_MAX_PULSE_US) {
+    return;
+  }
+
+  if (ir_ring_put(&ch->ring, duration | (is_mark ? RX_PULSE_MARK : 0) |
+                                 (echo ? RX_PULSE_ECHO : 0))) {
+    ch->edges++;
+    ch->in_frame = true;
+    if (echo) {
+      ch->echo_tagged++;
+    } else {
+      ch->frame_real = true;
+    }
+  }
+
+  uint32_t fill = ir_ring_count(&ch->ring);
+  if (fill > ch->max_fill) {
+    ch->max_fill = fill;
+  }
+
+  /* 流式解码需要逐边沿送达；否则缓冲区过半时提前唤醒，避免长帧溢出 */
+  if (IR_HAL_RX_WAKE_EACH_EDGE || fill > IR_HAL_RX_RING_SIZE / 2) {
+    rx_wake();
+  }
+}
+
+/* ISR中入队帧起点时间戳 - 两个元素要么都入队，要么都丢弃 */
+static void rx_push_stamp(rx_channel_t *ch, uint64_t stamp_us) {
+  if (ir_ring_count(&ch->ring) + 2 > IR_HAL_RX_RING_SIZE) {
+    ch->ring.overflows += 2;
+    return;
+  }
+
+  ir_ring_put(&ch->ring, RX_PULSE_STAMP | (stamp_us & RX_STAMP_MASK));
+  ir_ring_put(&ch->ring, RX_PULSE_STAMP | RX_PULSE_MARK |
+                             ((stamp_us >> RX_STAMP_BITS) & RX_STAMP_MASK));
+  ch->frames++;
+}
+
+/* 入队延迟线中的脉冲 (帧首脉冲先入队帧起点时间戳) - 持rx_edge_lock */
+static void rx_commit(rx_channel_t *ch) {
+  if (!ch->has_pending) {
+    return;
+  }
+
+  if (ch->pending_frame) {
+    rx_push_stamp(ch, ch->pending_start);
+  }
+  rx_push_pulse(ch, ch->pending_us, ch->pending_mark, ch->pending_echo);
+  ch->has_pending = false;
+}
+
+/* 处理时刻now在回波窗口内 - 持rx_edge_lock */
+static bool rx_is_echo(int64_t now) {
+  return rx_echo.depth > 0 || now < rx_echo.until;
+}
+
+/* ISR中处理一个边沿 - level为边沿之后的电平，持rx_edge_lock。首个边沿或
+ * 超过帧间隔的静默之后的一段为帧首脉冲。毛刺滤波开启时结束的一段先进
+ * 延迟线; 短于门限的一段视为毛刺，前一段恢复为未结束，毛刺并入其中 */
+static void rx_edge(rx_channel_t *ch, uint64_t edge_us, bool level) {
+  if (rx_inverted & BIT(ch->index)) {
+    level = !level;
+  }
+
+  /* 没有订阅者接收回波: 丢弃，窗口之后的首个边沿重新开始。波形后端逐块
+   * 处理，边沿最多晚一块才到，按边沿时刻(与运行时间同源)判断 */
+#ifdef IR_HAL_RX_ADC
+  int64_t now = k_us_to_ticks_floor64(edge_us);
+#else
+  int64_t now = k_uptime_ticks();
+#endif
+  bool echo = rx_is_echo(now);
+  if (echo && !(rx_echo.wanted & BIT(ch->index))) {
+    ch->echo_dropped++;
+    ch->has_edge = false;
+    return;
+  }
+
+  ch->last_seen = now;
+  if (!ch->has_edge) {
+    ch->last_edge_us = edge_us;
+    ch->last_echo = echo;
+    ch->last_state = level;
+    ch->has_edge = true;
+    ch->frame_next = true;
+    return;
+  }
+
+  uint64_t duration = edge_us - ch->last_edge_us;
+  bool is_mark = !ch->last_state;
+
+  if (RX_GLITCH_FILTER &&
+      duration < (is_mark ? IR_HAL_RX_MIN_MARK_US : IR_HAL_RX_MIN_SPACE_US)) {
+    ch->glitches++;
+    if (ch->has_pending) {
+      ch->last_edge_us = ch->pending_start;
+      ch->last_state = !ch->pending_mark;
+      ch->frame_next = ch->pending_frame;
+      ch->has_pending = false;
+    } else {
+      ch->has_edge = false; // 帧首的毛刺: 回到空闲
+    }
+    return;
+  }
+
+  rx_commit(ch);
+  ch->pending_start = ch->last_edge_us;
+  ch->pending_us = MIN(duration, IR_MAX_PULSE_US);
+  ch->pending_mark = is_mark;
+  ch->pending_frame = ch->frame_next;
+  ch->pending_echo = echo || ch->last_echo;
+  ch->has_pending = true;
+  if (!RX_GLITCH_FILTER) {
+    rx_commit(ch);
+  }
+
+  ch->frame_next = duration >= rx_frame_gap_us;
+  ch->last_edge_us = edge_us;
+  ch->last_echo = echo;
+  ch->last_state = level;
+}
+
+/* 帧结束 - 延迟线中的最后一个脉冲不再等待后续边沿，本帧有脉冲的通道
+ * 入队帧结束标记 */
+static void rx_flush(void) {
+  k_spinlock_key_t key = k_spin_lock(&rx_edge_lock);
+
+  for (size_t i = 0; i < IR_HAL_RX_CHANNELS; i++) {
+    rx_channel_t *ch = &rx_channels[i];
+
+    rx_commit(ch);
+    /* 只有回波的帧，结束标记同样不送给不接收回波的订阅者 */
+    if (ch->in_frame &&
+        ir_ring_put(&ch->ring,
+                    RX_FRAME_END | (ch->frame_real ? 0 : RX_PULSE_ECHO))) {
+      ch->in_frame = false;
+      ch->frame_real = false;
+    }
+  }
+  k_spin_unlock(&rx_edge_lock, key);
+}
+
+/* 接收头补偿 - 帧结束标记(时长0)不变 */
+static uint32_t rx_compensate(size_t channel, uint32_t duration, bool is_mark) {
+  int32_t us = (int32_t)duration - rx_bias[channel][is_mark];
+
+  return duration == 0 ? 0 : MAX(us, 1);
+}
+
+/* RX消费线程 - 每次唤醒依次清空所有通道的脉冲环，每个脉冲分发给订阅了
+ * 该通道的所有订阅者。订阅表每批次取一次快照，回调在锁外执行 */
+static void rx_thread_entry(void *p1, void *p2, void *p3) {
+  rx_subscriber_t subs[IR_HAL_RX_SUBSCRIBERS];
+  uint32_t value;
+
+  while (1) {
+    k_sem_take(&rx_state.wake, K_FOREVER);
+    atomic_clear_bit(&rx_state.wake_pending, 0);
+    rx_state.wakeups++;
+
+    k_spinlock_key_t key = k_spin_lock(&rx_subs_lock);
+    memcpy(subs, rx_subs, sizeof(subs));
+    k_spin_unlock(&rx_subs_lock, key);
+
+    for (size_t i = 0; i < IR_HAL_RX_CHANNELS; i++) {
+      rx_channel_t *ch = &rx_channels[i];
+
+      while (ir_ring_get(&ch->ring, &value)) {
+        if (value & RX_PULSE_STAMP) {
+          /* 帧起点: 之后的脉冲起点由时长依次累加 */
+          if (value & RX_PULSE_MARK) {
+            ch->time_us = ((uint64_t)(value & RX_STAMP_MASK)
+                           << RX_STAMP_BITS) |
+                          ch->stamp_low;
+          } else {
+            ch->stamp_low = value & RX_STAMP_MASK;
+          }
+          continue;
+        }
+
+        bool echo = (value & RX_PULSE_ECHO) != 0;
+        bool is_mark = (value & RX_PULSE_MARK) != 0;
+        uint32_t duration = value & ~(RX_PULSE_ECHO | RX_PULSE_MARK);
+
+        ir_pulse_t pulse = {
+            .duration_us = rx_compensate(i, duration, is_mark),
+            .is_mark = is_mark,
+            .channel = ch->index,
+            .timestamp_us = ch->time_us,
+            .frame_end = (value & ~RX_PULSE_ECHO) == RX_FRAME_END,
+            .echo = echo,
+        };
+        ch->time_us += duration;
+        if (!ch->active) {
+          continue;
+        }
+        for (size_t s = 0; s < ARRAY_SIZE(subs); s++) {
+          if (subs[s].callback && (subs[s].channels & BIT(i)) &&
+              (!echo || subs[s].echo)) {
+            subs[s].callback(&pulse, subs[s].user_data);
+          }
+        }
+      }
+    }
+  }
+}
+
+#ifdef IR_HAL_RX_CAPTURE
+/* GPIOTE边沿中断 - 时间戳已由硬件锁存，ISR延迟不影响测量 */
+static void rx_capture_handler(nrfx_gpiote_pin_t pin,
+                               nrfx_gpiote_trigger_t trigger,
+                               void *p_context) {
+  rx_channel_t *ch = p_context;
+
+  if (!ch->active) {
+    return;
+  }
+
+  uint32_t raw = nrfx_timer_capture_get(&rx_timer,
+                                        (nrf_timer_cc_channel_t)ch->index);
+  bool level = nrf_gpio_pin_read(pin) != 0;
+
+  /* 重设帧结束比较点，所有通道静默超过帧间隔时冲刷并唤醒消费线程 */
+  k_spinlock_key_t key = k_spin_lock(&rx_edge_lock);
+  uint64_t edge_us = rx_time_extend(raw);
+  rx_time.frame_pending = true;
+  nrfx_timer_compare(&rx_timer, RX_FRAME_CC, raw + rx_frame_gap_us, true);
+  rx_edge(ch, edge_us, level);
+  k_spin_unlock(&rx_edge_lock, key);
+}
+
+#ifdef IR_HAL_RX_LOWPOWER
+static void rx_sense_handler(nrfx_gpiote_pin_t pin,
+                             nrfx_gpiote_trigger_t trigger, void *p_context);
+#endif
+
+/* 配置RX引脚 - sense为真时只用PORT SENSE检测mark起点的边沿，不占IN通道 */
+static int rx_input_configure(rx_channel_t *ch, bool sense) {
+  static const nrf_gpio_pin_pull_t pull = NRF_GPIO_PIN_PULLUP;
+  nrfx_gpiote_trigger_config_t trigger_config = {
+      .trigger = NRFX_GPIOTE_TRIGGER_TOGGLE,
+      .p_in_channel = &ch->gpiote_ch,
+  };
+  nrfx_gpiote_handler_config_t handler_config = {
+      .handler = rx_capture_handler,
+      .p_context = ch,
+  };
+  nrfx_gpiote_input_pin_config_t input_config = {
+      .p_pull_config = &pull,
+      .p_trigger_config = &trigger_config,
+      .p_handler_config = &handler_config,
+  };
+
+#ifdef IR_HAL_RX_LOWPOWER
+  if (sense) {
+    trigger_config.trigger = (rx_inverted & BIT(ch->index))
+                                 ? NRFX_GPIOTE_TRIGGER_LOTOHI
+                                 : NRFX_GPIOTE_TRIGGER_HITOLO;
+    trigger_config.p_in_channel = NULL;
+    handler_config.handler = rx_sense_handler;
+  }
+#endif
+
+  if (nrfx_gpiote_input_configure(&rx_gpiote, rx_psel[ch->index],
+                                  &input_config) != NRFX_SUCCESS) {
+    return -EIO;
+  }
+  return 0;
+}
+
+/* 启动一个通道的硬件捕获 - 首个通道启动时定时器从0计时，扩展时间戳
+ * 接上当前的系统运行时间 */
+static void rx_capture_enable(rx_channel_t *ch) {
+  if (!nrfx_timer_is_enabled(&rx_timer)) {
+    nrfx_timer_clear(&rx_timer);
+    rx_time.last_us = k_ticks_to_us_floor64(k_uptime_ticks());
+    rx_time.last_raw = 0;
+    rx_time.frame_pending = false;
+    nrfx_timer_compare(&rx_timer, RX_FRAME_CC, RX_HEARTBEAT_US, true);
+    nrfx_timer_enable(&rx_timer);
+  }
+  nrfx_gppi_channels_enable(BIT(ch->ppi_ch));
+  nrfx_gpiote_trigger_enable(&rx_gpiote, rx_psel[ch->index], true);
+}
+
+/* 停止一个通道的硬件捕获 - 最后一个通道停止后定时器停止，释放HFCLK请求 */
+static void rx_capture_disable(rx_channel_t *ch) {
+  nrfx_gpiote_trigger_disable(&rx_gpiote, rx_psel[ch->index]);
+  nrfx_gppi_channels_disable(BIT(ch->ppi_ch));
+  if (!rx_any_active()) {
+    nrfx_timer_compare_int_disable(&rx_timer, RX_FRAME_CC);
+    nrfx_timer_disable(&rx_timer);
+  }
+}
+
+#ifdef IR_HAL_RX_LOWPOWER
+/* 帧间休眠 - 只保留SENSE (仅单路，定时器随通道停止) */
+static void rx_sense_arm(rx_channel_t *ch) {
+  nrfx_gpiote_trigger_disable(&rx_gpiote, rx_psel[ch->index]);
+  nrfx_gppi_channels_disable(BIT(ch->ppi_ch));
+  nrfx_timer_compare_int_disable(&rx_timer, RX_FRAME_CC);
+  nrfx_timer_disable(&rx_timer);
+  if (rx_input_configure(ch, true) < 0) {
+    LOG_ERR("RX sense config failed");
+    return;
+  }
+  ch->has_edge = false;
+  nrfx_gpiote_trigger_enable(&rx_gpiote, rx_psel[ch->index], true);
+}
+
+/* SENSE唤醒 - 首个下降沿(mark起点)无硬件时间戳，以切换时刻为起点，
+ * 首个mark因此短了中断延迟(数微秒)，在解码容差之内 */
+static void rx_sense_handler(nrfx_gpiote_pin_t pin,
+                             nrfx_gpiote_trigger_t trigger, void *p_context) {
+  rx_channel_t *ch = p_context;
+  k_spinlock_key_t key = k_spin_lock(&rx_subs_lock);
+
+  if (!ch->active) {
+    k_spin_unlock(&rx_subs_lock, key);
+    return;
+  }
+
+  nrfx_gpiote_trigger_disable(&rx_gpiote, pin);
+  if (rx_input_configure(ch, false) == 0) {
+    rx_capture_enable(ch);
+
+    ch->has_edge = false;
+    rx_edge(ch, rx_time.last_us, (rx_inverted & BIT(ch->index)) != 0);
+    rx_state.sense_wakeups++;
+    rx_time.frame_pending = true;
+    nrfx_timer_compare(&rx_timer, RX_FRAME_CC, rx_frame_gap_us, true);
+  }
+  k_spin_unlock(&rx_subs_lock, key);
+}
+#endif
+
+/* TIMER事件回调 - CC[3]为帧结束比较或帧间心跳，二者都推进扩展时间戳 */
+static void rx_timer_handler(nrf_timer_event_t event_type, void *p_context) {
+  if (event_type != RX_FRAME_EVENT) {
+    return;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&rx_edge_lock);
+  uint32_t raw = nrfx_timer_capture_get(&rx_timer, RX_FRAME_CC);
+  bool frame_end = rx_time.frame_pending;
+
+  rx_time_extend(raw);
+  rx_time.frame_pending = false;
+  nrfx_timer_compare(&rx_timer, RX_FRAME_CC, raw + RX_HEARTBEAT_US, true);
+  k_spin_unlock(&rx_edge_lock, key);
+
+  if (!frame_end) {
     return;
   }
 
-  if (!dev || dev != gpio_dev) {
-    return;
+  rx_flush();
+  rx_wake();
+#ifdef IR_HAL_RX_LOWPOWER
+  /* 与取消订阅互斥，避免在通道停止后重新挂上SENSE */
+  key = k_spin_lock(&rx_subs_lock);
+  if (rx_channels[0].active) {
+    rx_sense_arm(&rx_channels[0]);
+  }
+  k_spin_unlock(&rx_subs_lock, key);
+#endif
+}
+
+/* 初始化硬件捕获链路 GPIOTE -> PPI -> TIMER CAPTURE[i]，每个通道一条 */
+static int rx_capture_init(void) {
+  nrfx_timer_config_t timer_config = NRFX_TIMER_DEFAULT_CONFIG(IR_TIMER_FREQ);
+  timer_config.bit_width = NRF_TIMER_BIT_WIDTH_32;
+
+  IRQ_CONNECT(TIMER1_IRQn, IRQ_PRIO_LOWEST, nrfx_timer_1_irq_handler, 0, 0);
+
+  if (nrfx_timer_init(&rx_timer, &timer_config, rx_timer_handler) !=
+      NRFX_SUCCESS) {
+    LOG_ERR("Capture timer init failed");
+    return -EIO;
+  }
+
+  for (size_t i = 0; i < IR_HAL_RX_CHANNELS; i++) {
+    rx_channel_t *ch = &rx_channels[i];
+
+    if (nrfx_gpiote_channel_alloc(&rx_gpiote, &ch->gpiote_ch) !=
+        NRFX_SUCCESS) {
+      LOG_ERR("No free GPIOTE channel");
+      return -EBUSY;
+    }
+
+    if (rx_input_configure(ch, false) < 0) {
+      LOG_ERR("GPIOTE input config failed");
+      return -EIO;
+    }
+
+    if (nrfx_gppi_channel_alloc(&ch->ppi_ch) != NRFX_SUCCESS) {
+      LOG_ERR("No free PPI channel");
+      return -EBUSY;
+    }
+
+    nrfx_gppi_channel_endpoints_setup(
+        ch->ppi_ch, nrfx_gpiote_in_event_address_get(&rx_gpiote, rx_psel[i]),
+        nrfx_timer_task_address_get(&rx_timer, nrf_timer_capture_task_get(i)));
+
+    LOG_DBG("RX%u capture: GPIOTE ch %u, PPI ch %u", i, ch->gpiote_ch,
+            ch->ppi_ch);
+  }
+  return 0;
+}
+#elif defined(IR_HAL_RX_ADC)
+/* 波形后端: SAADC内部定时器连续采样一个AIN，EasyDMA写满一块即由驱动在
+ * END时START另一块(两块交替，之间不丢样点)。CPU不逐样点进中断，每块在
+ * SAADC中断中处理一次:
+ *   - 静默时以IIR跟踪基线和噪声(平均偏差)，门限取噪声的4倍与
+ *     IR_HAL_RX_ADC_MIN_SWING中的较大者，每块更新一次，mark期间冻结;
+ *   - 越过门限的样点为载波的发光部分: 首个越过的样点为mark起点，超过
+ *     IR_HAL_RX_ADC_HOLD_US没有越过的即mark结束，终点在最后一个越过的
+ *     样点之后;
+ *   - mark内首个到最后一个上升(未越过->越过)之间为整数个载波周期，越过
+ *     的样点占比为占空比。采样与载波不同步，量化误差在多个周期上平均。
+ * 边沿时刻由样点序号换算，与处理的时延无关; 帧间以运行时间重新对齐，
+ * HFCLK与RTC的偏差不随运行时间累积 */
+BUILD_ASSERT(IR_HAL_RX_CHANNELS == 1, "waveform backend has a single channel");
+
+#define ADC_CLOCK 16000000                       // 内部定时器时钟
+#define ADC_CC (ADC_CLOCK / IR_HAL_RX_ADC_RATE)  // 每个样点的时钟数
+BUILD_ASSERT(ADC_CC >= 80 && ADC_CC <= 2047, "SAADC sample rate out of range");
+#define ADC_HOLD (IR_HAL_RX_ADC_HOLD_US * (ADC_CLOCK / USEC_PER_SEC) / ADC_CC)
+#define ADC_Q 4   // 基线、噪声和门限的定点小数位
+#define ADC_IIR 6 // 基线和噪声的时间常数 (2^6个样点)
+
+static struct {
+  nrf_saadc_value_t buf[2][IR_HAL_RX_ADC_SAMPLES];
+  uint8_t next; // 下一块交给DMA的缓冲
+  bool running;
+  bool primed;        // 基线已由首个样点初始化
+  uint64_t n;         // 下一个样点的序号
+  uint64_t base_n;    // 时基锚点: 样点base_n对应base_us
+  uint64_t base_us;
+  int32_t level;      // 基线 (Q4)
+  int32_t noise;      // 平均偏差 (Q4)
+  int32_t threshold;  // 判决门限 (Q4)
+  bool mark;          // 包络处于mark
+  bool high;          // 上一个样点越过门限
+  bool in_frame;      // 本帧有mark，静默满帧间隔时冲刷
+  uint64_t mark_start;
+  uint64_t last_high; // 最近一个越过门限的样点
+  uint64_t last_rise;
+  uint32_t rises;
+  uint32_t high_count; // 本mark越过门限的样点
+  int32_t peak;        // 本帧的峰值摆幅 (Q4)
+  /* 载波测量 - 上次读取以来各mark的累计，持rx_edge_lock */
+  uint32_t carrier_periods;
+  uint32_t carrier_span; // 首个到最后一个上升的样点数之和
+  uint32_t carrier_high;
+  uint32_t carrier_total;
+  ir_hal_rx_adc_stats_t stats; // 持rx_edge_lock
+} rx_adc;
+
+/* 样点序号 -> 扩展时间戳 */
+static uint64_t adc_time_us(uint64_t n) {
+  return rx_adc.base_us +
+         (n - rx_adc.base_n) * ADC_CC / (ADC_CLOCK / USEC_PER_SEC);
+}
+
+static void adc_mark_start(uint64_t n) {
+  k_spinlock_key_t key = k_spin_lock(&rx_edge_lock);
+  rx_edge(&rx_channels[0], adc_time_us(n), false);
+  k_spin_unlock(&rx_edge_lock, key);
+
+  rx_adc.mark = true;
+  rx_adc.in_frame = true;
+  rx_adc.mark_start = n;
+  rx_adc.rises = 0;
+  rx_adc.high_count = 0;
+}
+
+/* mark结束 - 少于两个上升的mark没有完整的载波周期，不参与测量 */
+static void adc_mark_end(void) {
+  uint64_t end = rx_adc.last_high + 1;
+
+  k_spinlock_key_t key = k_spin_lock(&rx_edge_lock);
+  rx_edge(&rx_channels[0], adc_time_us(end), true);
+  if (rx_adc.rises > 1) {
+    rx_adc.carrier_periods += rx_adc.rises - 1;
+    rx_adc.carrier_span += rx_adc.last_rise - rx_adc.mark_start;
+    rx_adc.carrier_high += rx_adc.high_count;
+    rx_adc.carrier_total += end - rx_adc.mark_start;
+  }
+  rx_adc.stats.marks++;
+  k_spin_unlock(&rx_edge_lock, key);
+
+  rx_adc.mark = false;
+}
+
+/* 帧结束 - 记下本帧的峰值摆幅 */
+static void adc_frame_end(void) {
+  uint16_t peak = rx_adc.peak >> ADC_Q;
+
+  k_spinlock_key_t key = k_spin_lock(&rx_edge_lock);
+  rx_adc.stats.last_peak = peak;
+  rx_adc.stats.max_peak = MAX(rx_adc.stats.max_peak, peak);
+  if (rx_adc.stats.min_peak == 0 || peak < rx_adc.stats.min_peak) {
+    rx_adc.stats.min_peak = peak;
+  }
+  k_spin_unlock(&rx_edge_lock, key);
+
+  rx_adc.in_frame = false;
+  rx_adc.peak = 0;
+  rx_flush();
+  rx_wake();
+}
+
+/* 包络检测一块样点 - now_us为该块最后一个样点的大致时刻 */
+static void adc_process(const nrf_saadc_value_t *samples, size_t count,
+                        uint64_t now_us) {
+  uint64_t gap = (uint64_t)rx_frame_gap_us * (ADC_CLOCK / USEC_PER_SEC) /
+                 ADC_CC;
+
+  if (!rx_adc.primed && count > 0) {
+    rx_adc.level = samples[0] << ADC_Q;
+    rx_adc.primed = true;
+  }
+
+  for (size_t i = 0; i < count; i++, rx_adc.n++) {
+    int32_t delta = ((int32_t)samples[i] << ADC_Q) - rx_adc.level;
+    int32_t swing =
+        IS_ENABLED(CONFIG_IR_HAL_RX_ADC_INVERT) ? -delta : delta;
+    bool high = swing > rx_adc.threshold;
+
+    if (high) {
+      if (!rx_adc.mark) {
+        adc_mark_start(rx_adc.n);
+      }
+      if (!rx_adc.high) {
+        rx_adc.last_rise = rx_adc.n;
+        rx_adc.rises++;
+      }
+      rx_adc.high_count++;
+      rx_adc.last_high = rx_adc.n;
+      rx_adc.peak = MAX(rx_adc.peak, swing);
+    } else if (rx_adc.mark) {
+      if (rx_adc.n - rx_adc.last_high > ADC_HOLD) {
+        adc_mark_end();
+      }
+    } else {
+      rx_adc.level += delta >> ADC_IIR;
+      rx_adc.noise += (abs(delta) - rx_adc.noise) >> ADC_IIR;
+      if (rx_adc.in_frame && rx_adc.n - rx_adc.last_high > gap) {
+        adc_frame_end();
+      }
+    }
+    rx_adc.high = high;
+  }
+
+  /* 帧间重新对齐时基 */
+  if (!rx_adc.in_frame) {
+    rx_adc.base_n = rx_adc.n;
+    rx_adc.base_us = now_us;
+  }
+
+  rx_adc.threshold =
+      MAX(IR_HAL_RX_ADC_MIN_SWING << ADC_Q, rx_adc.noise * 4);
+
+  k_spinlock_key_t key = k_spin_lock(&rx_edge_lock);
+  rx_adc.stats.buffers++;
+  rx_adc.stats.baseline = rx_adc.level >> ADC_Q;
+  rx_adc.stats.noise = rx_adc.noise >> ADC_Q;
+  rx_adc.stats.threshold = rx_adc.threshold >> ADC_Q;
+  k_spin_unlock(&rx_edge_lock, key);
+}
+
+/* 开始采样 - 包络状态从静默开始，基线沿用上次的 */
+static int adc_start(void) {
+  rx_adc.mark = false;
+  rx_adc.high = false;
+  rx_adc.in_frame = false;
+  rx_adc.peak = 0;
+  rx_adc.next = 1;
+  rx_adc.n = 0;
+  rx_adc.base_n = 0;
+  rx_adc.base_us = rx_time_now();
+  rx_adc.running = true;
+
+  if (nrfx_saadc_buffer_set(rx_adc.buf[0], IR_HAL_RX_ADC_SAMPLES) !=
+          NRFX_SUCCESS ||
+      nrfx_saadc_mode_trigger() != NRFX_SUCCESS) {
+    rx_adc.running = false;
+    return -EIO;
+  }
+  return 0;
+}
+
+static void adc_handler(nrfx_saadc_evt_t const *event) {
+  switch (event->type) {
+  case NRFX_SAADC_EVT_BUF_REQ:
+    /* 正在写的是另一块，这一块已在上次DONE中处理完 */
+    nrfx_saadc_buffer_set(rx_adc.buf[rx_adc.next], IR_HAL_RX_ADC_SAMPLES);
+    rx_adc.next ^= 1;
+    break;
+  case NRFX_SAADC_EVT_DONE:
+    if (rx_adc.running) {
+      adc_process(event->data.done.p_buffer, event->data.done.size,
+                  rx_time_now());
+    }
+    break;
+  case NRFX_SAADC_EVT_FINISHED:
+    /* 两块都已写满而未处理(中断被长时间阻塞)，采样停止: 结束当前帧，
+     * 从静默重新开始 */
+    if (rx_adc.running) {
+      rx_adc.stats.overruns++;
+      if (rx_adc.mark) {
+        adc_mark_end();
+      }
+      if (rx_adc.in_frame) {
+        adc_frame_end();
+      }
+      k_spinlock_key_t key = k_spin_lock(&rx_edge_lock);
+      rx_channels[0].has_edge = false;
+      k_spin_unlock(&rx_edge_lock, key);
+      adc_start();
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+static void rx_adc_enable(rx_channel_t *ch) {
+  if (adc_start() < 0) {
+    LOG_ERR("SAADC start failed");
+  }
+}
+
+/* 停止采样 - 驱动在中断中报告FINISHED，running已清除，不再重启 */
+static void rx_adc_disable(rx_channel_t *ch) {
+  rx_adc.running = false;
+  nrfx_saadc_abort();
+}
+
+static int rx_adc_init(void) {
+  nrfx_saadc_channel_t channel = NRFX_SAADC_DEFAULT_CHANNEL_SE(
+      NRF_SAADC_INPUT_AIN0 + IR_HAL_RX_ADC_AIN, 0);
+  nrfx_saadc_adv_config_t config = NRFX_SAADC_DEFAULT_ADV_CONFIG;
+
+  /* tACQ 3us + 转换2us，200kHz下没有余量 */
+  channel.channel_config.acq_time = NRF_SAADC_ACQTIME_3US;
+  config.internal_timer_cc = ADC_CC;
+  config.start_on_end = true;
+
+  IRQ_CONNECT(SAADC_IRQn, IRQ_PRIO_LOWEST, nrfx_saadc_irq_handler, 0, 0);
+
+  if (nrfx_saadc_init(IRQ_PRIO_LOWEST) != NRFX_SUCCESS ||
+      nrfx_saadc_channel_config(&channel) != NRFX_SUCCESS ||
+      nrfx_saadc_advanced_mode_set(BIT(0), NRF_SAADC_RESOLUTION_10BIT,
+                                   &config, adc_handler) != NRFX_SUCCESS) {
+    LOG_ERR("SAADC init failed");
+    return -EIO;
+  }
+
+  rx_adc.stats.sample_rate = ADC_CLOCK / ADC_CC;
+  rx_adc.threshold = IR_HAL_RX_ADC_MIN_SWING << ADC_Q;
+  LOG_INF("RX waveform capture: AIN%u at %u Hz, %u-sample buffers",
+          IR_HAL_RX_ADC_AIN, rx_adc.stats.sample_rate, IR_HAL_RX_ADC_SAMPLES);
+  return 0;
+}
+
+/* 载波测量 - 样点始终在处理，start只清零累计 */
+int ir_hal_carrier_start(void) {
+  k_spinlock_key_t key = k_spin_lock(&rx_edge_lock);
+  rx_adc.carrier_periods = 0;
+  rx_adc.carrier_span = 0;
+  rx_adc.carrier_high = 0;
+  rx_adc.carrier_total = 0;
+  k_spin_unlock(&rx_edge_lock, key);
+  return 0;
+}
+
+/* 取出上次读取以来各mark的累计 - mark_us不适用，见头文件 */
+int ir_hal_carrier_read(uint32_t mark_us, ir_carrier_t *carrier) {
+  if (!carrier) {
+    return -EINVAL;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&rx_edge_lock);
+  uint32_t periods = rx_adc.carrier_periods;
+  uint32_t span = rx_adc.carrier_span;
+  uint32_t high = rx_adc.carrier_high;
+  uint32_t total = rx_adc.carrier_total;
+
+  /* 周期不足时继续累计到下一个mark */
+  bool enough = periods >= IR_CARRIER_MIN_EDGES / 2 && span > 0 && total > 0;
+  if (enough) {
+    rx_adc.carrier_periods = 0;
+    rx_adc.carrier_span = 0;
+    rx_adc.carrier_high = 0;
+    rx_adc.carrier_total = 0;
+  }
+  k_spin_unlock(&rx_edge_lock, key);
+
+  if (!enough) {
+    return -ENODATA;
+  }
+
+  carrier->frequency =
+      (uint64_t)periods * ADC_CLOCK / ((uint64_t)span * ADC_CC);
+  carrier->duty_cycle = MIN((uint64_t)high * 100 / total, 100);
+  carrier->periods = MIN(periods, UINT16_MAX);
+  return 0;
+}
+
+int ir_hal_carrier_stop(void) { return 0; }
+
+int ir_hal_rx_adc_get_stats(ir_hal_rx_adc_stats_t *stats) {
+  if (!stats) {
+    return -EINVAL;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&rx_edge_lock);
+  *stats = rx_adc.stats;
+  k_spin_unlock(&rx_edge_lock, key);
+  return 0;
+}
+#else
+/* 帧结束 - 无硬件比较可用，静默超过帧间隔后由内核定时器冲刷 */
+static void rx_flush_handler(struct k_timer *timer) {
+  rx_flush();
+  rx_wake();
+}
+
+static K_TIMER_DEFINE(rx_flush_timer, rx_flush_handler, NULL);
+
+/* GPIO中断处理 - 接收边沿检测 */
+static void gpio_callback_handler(const struct device *dev,
+                                  struct gpio_callback *cb, uint32_t pins) {
+  rx_channel_t *ch = CONTAINER_OF(cb, rx_channel_t, gpio_cb);
+
+  /* 安全检查 */
+  if (!ch->active) {
+    return;
+  }
+
+  uint64_t now_us = rx_time_now();
+  int current_state = gpio_pin_get_dt(&rx_gpios[ch->index]);
+
+  /* 检查GPIO读取是否成功 */
+  if (current_state < 0) {
+    return;
+  }
+
+  /* 64位时间戳，单次减法即得时长 */
+  k_spinlock_key_t key = k_spin_lock(&rx_edge_lock);
+  rx_edge(ch, now_us, current_state != 0);
+  k_spin_unlock(&rx_edge_lock, key);
+  rx_wake();
+
+  k_timer_start(&rx_flush_timer, K_USEC(rx_frame_gap_us), K_NO_WAIT);
+}
+#endif
+
+#ifdef IR_HAL_CARRIER
+/* 载波测量 - 光电二极管输出每个边沿:
+ *   GPIOTE IN -> PPI -> TIMER2 COUNT (计数模式) + TIMER3 CAPTURE0 (最后边沿)
+ *   TIMER2 COMPARE0(第3个边沿) -> TIMER3 CAPTURE1 (某个载波脉冲的起点)
+ *   TIMER2 COMPARE1(第4个边沿) -> TIMER3 CAPTURE2 (该脉冲的终点)
+ * 奇数边沿总是发光的起点，与输出极性无关。跳过前两个边沿避开放大器建立 */
+static const nrfx_timer_t carrier_counter = NRFX_TIMER_INSTANCE(2);
+static const nrfx_timer_t carrier_clock = NRFX_TIMER_INSTANCE(3);
+static uint8_t carrier_gpiote_ch;
+static uint8_t carrier_ppi[3];
+static bool carrier_ready;
+
+static void carrier_timer_handler(nrf_timer_event_t event_type,
+                                  void *p_context) {}
+
+static int carrier_init(void) {
+  nrfx_timer_config_t counter_config =
+      NRFX_TIMER_DEFAULT_CONFIG(IR_CARRIER_CLOCK);
+  counter_config.mode = NRF_TIMER_MODE_COUNTER;
+  counter_config.bit_width = NRF_TIMER_BIT_WIDTH_32;
+
+  nrfx_timer_config_t clock_config =
+      NRFX_TIMER_DEFAULT_CONFIG(IR_CARRIER_CLOCK);
+  clock_config.bit_width = NRF_TIMER_BIT_WIDTH_32;
+
+  IRQ_CONNECT(TIMER2_IRQn, IRQ_PRIO_LOWEST, nrfx_timer_2_irq_handler, 0, 0);
+  IRQ_CONNECT(TIMER3_IRQn, IRQ_PRIO_LOWEST, nrfx_timer_3_irq_handler, 0, 0);
+
+  if (nrfx_timer_init(&carrier_counter, &counter_config,
+                      carrier_timer_handler) != NRFX_SUCCESS ||
+      nrfx_timer_init(&carrier_clock, &clock_config, carrier_timer_handler) !=
+          NRFX_SUCCESS) {
+    LOG_ERR("Carrier timer init failed");
+    return -EIO;
+  }
+
+  nrfx_timer_compare(&carrier_counter, NRF_TIMER_CC_CHANNEL0, 3, false);
+  nrfx_timer_compare(&carrier_counter, NRF_TIMER_CC_CHANNEL1, 4, false);
+
+  if (nrfx_gpiote_channel_alloc(&rx_gpiote, &carrier_gpiote_ch) !=
+      NRFX_SUCCESS) {
+    LOG_ERR("No free GPIOTE channel for carrier input");
+    return -EBUSY;
+  }
+
+  static const nrf_gpio_pin_pull_t pull = NRF_GPIO_PIN_NOPULL;
+  nrfx_gpiote_trigger_config_t trigger_config = {
+      .trigger = NRFX_GPIOTE_TRIGGER_TOGGLE,
+      .p_in_channel = &carrier_gpiote_ch,
+  };
+  nrfx_gpiote_input_pin_config_t input_config = {
+      .p_pull_config = &pull,
+      .p_trigger_config = &trigger_config,
+      .p_handler_config = NULL,
+  };
+
+  if (nrfx_gpiote_input_configure(&rx_gpiote, IR_CARRIER_PSEL,
+                                  &input_config) != NRFX_SUCCESS) {
+    LOG_ERR("Carrier input config failed");
+    return -EIO;
+  }
+
+  for (size_t i = 0; i < ARRAY_SIZE(carrier_ppi); i++) {
+    if (nrfx_gppi_channel_alloc(&carrier_ppi[i]) != NRFX_SUCCESS) {
+      LOG_ERR("No free PPI channel for carrier input");
+      return -EBUSY;
+    }
+  }
+
+  nrfx_gppi_channel_endpoints_setup(
+      carrier_ppi[0],
+      nrfx_gpiote_in_event_address_get(&rx_gpiote, IR_CARRIER_PSEL),
+      nrfx_timer_task_address_get(&carrier_counter, NRF_TIMER_TASK_COUNT));
+  nrfx_gppi_fork_endpoint_setup(
+      carrier_ppi[0],
+      nrfx_timer_task_address_get(&carrier_clock, NRF_TIMER_TASK_CAPTURE0));
+  nrfx_gppi_channel_endpoints_setup(
+      carrier_ppi[1],
+      nrfx_timer_event_address_get(&carrier_counter, NRF_TIMER_EVENT_COMPARE0),
+      nrfx_timer_task_address_get(&carrier_clock, NRF_TIMER_TASK_CAPTURE1));
+  nrfx_gppi_channel_endpoints_setup(
+      carrier_ppi[2],
+      nrfx_timer_event_address_get(&carrier_counter, NRF_TIMER_EVENT_COMPARE1),
+      nrfx_timer_task_address_get(&carrier_clock, NRF_TIMER_TASK_CAPTURE2));
+
+  carrier_ready = true;
+  LOG_DBG("Carrier input: GPIOTE ch %u", carrier_gpiote_ch);
+  return 0;
+}
+
+static uint32_t carrier_ppi_mask(void) {
+  return BIT(carrier_ppi[0]) | BIT(carrier_ppi[1]) | BIT(carrier_ppi[2]);
+}
+
+/* 开始测量 */
+int ir_hal_carrier_start(void) {
+  if (!carrier_ready) {
+    return -ENODEV;
+  }
+
+  nrfx_timer_clear(&carrier_counter);
+  nrfx_timer_clear(&carrier_clock);
+  nrfx_timer_enable(&carrier_counter);
+  nrfx_timer_enable(&carrier_clock);
+  nrfx_gppi_channels_enable(carrier_ppi_mask());
+  nrfx_gpiote_trigger_enable(&rx_gpiote, IR_CARRIER_PSEL, false);
+  return 0;
+}
+
+/* 取出上一个mark的测量 - 第3个边沿(起点)或第4个边沿(终点)到最后边沿之间
+ * 为整数个载波周期，占空比取第3、4个边沿之间的发光时长 */
+int ir_hal_carrier_read(uint32_t mark_us, ir_carrier_t *carrier) {
+  if (!carrier_ready || !carrier) {
+    return -ENODEV;
+  }
+
+  uint32_t edges = nrfx_timer_capture(&carrier_counter, NRF_TIMER_CC_CHANNEL2);
+  uint32_t now = nrfx_timer_capture(&carrier_clock, NRF_TIMER_CC_CHANNEL3);
+  uint32_t last = nrfx_timer_capture_get(&carrier_clock, NRF_TIMER_CC_CHANNEL0);
+  uint32_t lead = nrfx_timer_capture_get(&carrier_clock, NRF_TIMER_CC_CHANNEL1);
+  uint32_t trail =
+      nrfx_timer_capture_get(&carrier_clock, NRF_TIMER_CC_CHANNEL2);
+
+  /* 只在载波静默时清零计数，保证下一个mark的第1个边沿是发光起点；
+   * 读取晚于下一个mark开始时不清零，该次与下一次读取均因跨度过长丢弃 */
+  if (now - last < IR_CARRIER_IDLE_US * (IR_CARRIER_CLOCK / USEC_PER_SEC)) {
+    return -EAGAIN;
+  }
+  nrfx_timer_clear(&carrier_counter);
+
+  if (edges < IR_CARRIER_MIN_EDGES) {
+    return -ENODATA;
+  }
+
+  uint32_t periods = (edges - 3) / 2;
+  uint32_t span = (edges % 2) ? last - lead : last - trail;
+  uint32_t high = trail - lead;
+
+  /* 读取晚于下一个mark开始时跨度包含space，丢弃 */
+  uint64_t span_us = (uint64_t)span * USEC_PER_SEC / IR_CARRIER_CLOCK;
+  if (span == 0 || high == 0 || span_us > mark_us + mark_us / 2) {
+    return -EAGAIN;
+  }
+
+  carrier->frequency = (uint64_t)periods * IR_CARRIER_CLOCK / span;
+  carrier->duty_cycle = MIN((uint64_t)high * 100 * periods / span, 100);
+  carrier->periods = MIN(periods, UINT16_MAX);
+  return 0;
+}
+
+/* 停止测量 */
+int ir_hal_carrier_stop(void) {
+  if (!carrier_ready) {
+    return -ENODEV;
+  }
+
+  nrfx_gpiote_trigger_disable(&rx_gpiote, IR_CARRIER_PSEL);
+  nrfx_gppi_channels_disable(carrier_ppi_mask());
+  nrfx_timer_disable(&carrier_counter);
+  nrfx_timer_disable(&carrier_clock);
+  return 0;
+}
+#elif !defined(IR_HAL_RX_ADC)
+int ir_hal_carrier_start(void) { return -ENOTSUP; }
+
+int ir_hal_carrier_read(uint32_t mark_us, ir_carrier_t *carrier) {
+  return -ENOTSUP;
+}
+
+int ir_hal_carrier_stop(void) { return -ENOTSUP; }
+#endif
+#endif /* !IR_HAL_RX_IPC */
+
+#ifndef IR_HAL_RX_WAKE_OFF
+int ir_hal_rx_poweroff(void) { return -ENOTSUP; }
+#endif
+
+#ifndef IR_HAL_RX_ADC
+int ir_hal_rx_adc_get_stats(ir_hal_rx_adc_stats_t *stats) {
+  return -ENOTSUP;
+}
+#endif
+
+/* HAL初始化 */
+int ir_hal_init(void) {
+  int ret;
+
+  LOG_INF("Initializing IR HAL...");
+
+#ifdef IR_HAL_TX_SEQ
+  ret = tx_seq_init();
+  if (ret < 0) {
+    return ret;
+  }
+#elif defined(IR_HAL_TX_I2S)
+  ret = tx_i2s_init();
+  if (ret < 0) {
+    return ret;
+  }
+#elif defined(IR_HAL_TX_GATE)
+  /* GPIOTE由捕获后端的同一实例分配，在其后初始化 */
+#elif defined(IR_HAL_TX_ZLI)
+  ret = tx_zli_init();
+  if (ret < 0) {
+    return ret;
+  }
+#elif defined(IR_HAL_TX_NONE)
+  /* 接收引擎没有发送后端 */
+#else
+  /* 检查PWM设备 */
+  if (!device_is_ready(pwm_ir.dev)) {
+    LOG_ERR("PWM device not ready");
+    return -ENODEV;
+  }
+  LOG_DBG("PWM device ready");
+#endif
+
+#ifdef IR_HAL_RX_IPC
+  /* 接收在网络核，本核只建立边沿批次和接收控制的通道 */
+  ret = ir_hal_ipc_init();
+  if (ret < 0) {
+    return ret;
+  }
+#else
+  /* 初始化接收状态 */
+  memset(&rx_state, 0, sizeof(rx_state));
+  k_sem_init(&rx_state.wake, 0, 1);
+
+  for (size_t i = 0; i < IR_HAL_RX_CHANNELS; i++) {
+    rx_channel_t *ch = &rx_channels[i];
+
+    memset(ch, 0, sizeof(*ch));
+    ch->index = i;
+    ir_ring_init(&ch->ring, ch->ring_buf, IR_HAL_RX_RING_SIZE);
+
+    /* 检查GPIO设备 */
+    if (!gpio_is_ready_dt(&rx_gpios[i])) {
+      LOG_ERR("RX%u GPIO device not ready", i);
+      return -ENODEV;
+    }
+
+    /* 配置RX GPIO为输入，上拉等标志来自设备树 */
+    ret = gpio_pin_configure_dt(&rx_gpios[i], GPIO_INPUT);
+    if (ret < 0) {
+      LOG_ERR("Failed to configure RX%u pin %d: %d", i, rx_gpios[i].pin,
+              ret);
+      return ret;
+    }
+    LOG_DBG("RX%u pin %d configured", i, rx_gpios[i].pin);
+
+#if !defined(IR_HAL_RX_CAPTURE) && !defined(IR_HAL_RX_ADC)
+    /* 禁用GPIO中断（初始状态） */
+    ret = gpio_pin_interrupt_configure_dt(&rx_gpios[i], GPIO_INT_DISABLE);
+    if (ret < 0) {
+      LOG_ERR("Failed to configure interrupt: %d", ret);
+      return ret;
+    }
+
+    /* 初始化GPIO回调 */
+    gpio_init_callback(&ch->gpio_cb, gpio_callback_handler,
+                       BIT(rx_gpios[i].pin));
+
+    ret = gpio_add_callback_dt(&rx_gpios[i], &ch->gpio_cb);
+    if (ret < 0) {
+      LOG_ERR("Failed to add callback: %d", ret);
+      return ret;
+    }
+#endif
+  }
+  LOG_DBG("%u RX channel(s) configured", IR_HAL_RX_CHANNELS);
+
+#ifdef IR_HAL_RX_CAPTURE
+  ret = rx_capture_init();
+  if (ret < 0) {
+    return ret;
+  }
+#ifdef IR_HAL_TX_GATE
+  ret = tx_gate_init();
+  if (ret < 0) {
+    return ret;
+  }
+#endif
+#endif
+
+#ifdef IR_HAL_RX_ADC
+  ret = rx_adc_init();
+  if (ret < 0) {
+    return ret;
+  }
+#endif
+
+#ifdef IR_HAL_CARRIER
+  /* 载波测量不可用时学习照常进行，只是不测载波 */
+  if (carrier_init() < 0) {
+    LOG_WRN("Carrier measurement unavailable");
+  }
+#endif
+
+  k_thread_create(&rx_thread, rx_thread_stack,
+                  K_THREAD_STACK_SIZEOF(rx_thread_stack), rx_thread_entry, NULL,
+                  NULL, NULL, K_PRIO_PREEMPT(IR_HAL_RX_THREAD_PRIORITY), 0,
+                  K_NO_WAIT);
+  k_thread_name_set(&rx_thread, "ir_rx");
+#endif
+
+#if !defined(IR_HAL_TX_SEQ) && !defined(IR_HAL_TX_GATE) &&                     \
+    !defined(IR_HAL_TX_I2S) && !defined(IR_HAL_TX_ZLI) &&                      \
+    !defined(IR_HAL_TX_NONE)
+  /* 确保PWM初始关闭 */
+  ret = pwm_set_dt(&pwm_ir, 0, 0);
+  if (ret < 0) {
+    LOG_WRN("Failed to stop PWM initially: %d", ret);
+  }
+#ifdef CONFIG_PM_DEVICE_RUNTIME
+  /* 无人持有时挂起PWM */
+  ret = pm_device_runtime_enable(pwm_ir.dev);
+  if (ret < 0) {
+    LOG_WRN("PWM runtime PM unavailable: %d", ret);
+  }
+#endif
+#endif
+
+  LOG_INF("IR HAL initialized successfully");
+  return 0;
+}
+
+/* 全局占空比覆盖 */
+static uint8_t tx_duty_override = IR_HAL_TX_DUTY_OVERRIDE;
+
+void ir_hal_tx_set_duty_override(uint8_t duty_cycle) {
+  tx_duty_override = duty_cycle;
+}
+
+uint8_t ir_hal_tx_get_duty_override(void) { return tx_duty_override; }
+
+/* 包络输出 - 环回测试时mark不调制载波 */
+static bool tx_envelope;
+
+void ir_hal_tx_set_envelope(bool enable) { tx_envelope = enable; }
+
+bool ir_hal_tx_get_envelope(void) { return tx_envelope; }
+
+/* 实际发送的占空比 */
+static uint8_t tx_duty(uint8_t duty_cycle) {
+  if (tx_duty_override > 0) {
+    duty_cycle = tx_duty_override;
+  } else if (duty_cycle == 0) {
+    duty_cycle = IR_PWM_DUTY;
+  }
+  return CLAMP(duty_cycle, IR_PWM_DUTY_MIN, IR_PWM_DUTY_MAX);
+}
+
+#if defined(IR_HAL_TX_SEQ) || defined(IR_HAL_TX_I2S)
+/* 序列编译 - PWM序列引擎与I2S比特流引擎共用。段为一个mark/space(多路时
+ * 为任一路的两个边沿之间)，低24位为载波周期数-1，高8位为mark通道掩码 */
+#define SEQ_RUN_MAX BIT(24)
+#define SEQ_SEG(periods, mask) (((periods) - 1) | ((uint32_t)(mask) << 24))
+
+/* 时长换算为整数个载波周期 */
+static uint32_t tx_seq_periods(ir_timing_t timing) {
+  return ((uint64_t)ir_timing_us(timing) * tx_state.carrier_freq +
+          USEC_PER_SEC / 2) /
+         USEC_PER_SEC;
+}
+
+/* 编译游标 - 每路一个，mark/space交替，时长为微秒时序或载波周期数 */
+typedef struct {
+  const ir_timing_t *timings;
+  const uint16_t *periods;
+  size_t count;
+  size_t index;  // 下一个时长
+  uint32_t left; // 当前时长剩余的载波周期
+  uint8_t mask;  // mark期间在比较值掩码中置位的位
+} seq_lane_t;
+
+/* 段来源 - 只在TX线程中使用 */
+static struct {
+  seq_lane_t lanes[IR_HAL_TX_CHANNELS];
+  size_t n;
+  uint32_t run; // 预读的下一个时长(周期)，0为已耗尽
+  uint8_t mask;
+} seq_src;
+
+static uint32_t tx_seq_lane_periods(const seq_lane_t *lane, size_t i) {
+  return lane->periods ? lane->periods[i] : tx_seq_periods(lane->timings[i]);
+}
+
+/* 各路到最近一个边沿为止的时长，掩码为此期间处于mark的路 */
+static uint32_t tx_seq_raw(uint8_t *mask) {
+  uint32_t run = UINT32_MAX;
+
+  *mask = 0;
+  for (size_t l = 0; l < seq_src.n; l++) {
+    seq_lane_t *lane = &seq_src.lanes[l];
+
+    /* 长度为0的时长直接跳过，mark/space的奇偶不变 */
+    while (lane->left == 0 && lane->index < lane->count) {
+      lane->left = tx_seq_lane_periods(lane, lane->index++);
+    }
+    if (lane->left == 0) {
+      continue;
+    }
+    run = MIN(run, lane->left);
+    if (lane->index % 2 == 1) {
+      *mask |= lane->mask;
+    }
+  }
+  if (run == UINT32_MAX) {
+    return 0;
+  }
+
+  for (size_t l = 0; l < seq_src.n; l++) {
+    if (seq_src.lanes[l].left) {
+      seq_src.lanes[l].left -= run;
+    }
+  }
+  return run;
+}
+
+/* 回到第一个时长 */
+static void tx_seq_rewind(void) {
+  for (size_t l = 0; l < seq_src.n; l++) {
+    seq_src.lanes[l].index = 0;
+    seq_src.lanes[l].left = 0;
+  }
+  seq_src.run = tx_seq_raw(&seq_src.mask);
+}
+
+/* 设置段来源 - 单路(COMMON)的mark掩码为1，多路为各路的通道 */
+static void tx_seq_source(const ir_hal_tx_lane_t *lanes, size_t n,
+                          const uint16_t *periods, size_t count) {
+  memset(&seq_src, 0, sizeof(seq_src));
+  if (periods) {
+    seq_src.lanes[0] = (seq_lane_t){
+        .periods = periods, .count = count, .mask = BIT(0)};
+    seq_src.n = 1;
+  } else {
+    for (size_t l = 0; l < n; l++) {
+      seq_src.lanes[l] = (seq_lane_t){
+          .timings = lanes[l].timings,
+          .count = lanes[l].count,
+          .mask = n > 1 ? lanes[l].channels : BIT(0),
+      };
+    }
+    seq_src.n = n;
+  }
+  tx_seq_rewind();
+}
+
+/* 下一段 - 掩码相同的相邻时长合并为一段，来源耗尽返回false */
+static bool tx_seq_next(uint32_t *seg) {
+  uint32_t run = seq_src.run;
+  uint8_t mask = seq_src.mask;
+
+  if (run == 0) {
+    return false;
+  }
+
+  for (;;) {
+    seq_src.run = tx_seq_raw(&seq_src.mask);
+    if (seq_src.run == 0 || seq_src.mask != mask ||
+        run + seq_src.run > SEQ_RUN_MAX) {
+      break;
+    }
+    run += seq_src.run;
+  }
+
+  *seg = SEQ_SEG(run, mask);
+  return true;
+}
+#endif
+
+#ifdef IR_HAL_TX_SEQ
+static void tx_seq_refill(uint8_t seq_id);
+
+/* PWM事件回调 - 一段结束装入下一段，回放结束唤醒TX线程 */
+static void pwm_seq_handler(nrfx_pwm_evt_type_t event_type, void *p_context) {
+  switch (event_type) {
+  case NRFX_PWM_EVT_END_SEQ0:
+    tx_seq_refill(0);
+    break;
+  case NRFX_PWM_EVT_END_SEQ1:
+    tx_seq_refill(1);
+    break;
+  case NRFX_PWM_EVT_STOPPED:
+    tx_state.busy = false;
+    k_sem_give(&tx_state.done);
+    break;
+  default:
+    break;
+  }
+}
+
+/* 按载波频率配置PWM周期 */
+static nrfx_pwm_config_t tx_seq_config(uint32_t carrier_freq) {
+  nrfx_pwm_config_t config = NRFX_PWM_DEFAULT_CONFIG(
+      tx_seq_pins[0], tx_seq_pins[1], tx_seq_pins[2], tx_seq_pins[3]);
+
+  config.base_clock = NRF_PWM_CLK_16MHz;
+  config.count_mode = NRF_PWM_MODE_UP;
+  config.top_value = IR_PWM_BASE_CLOCK / carrier_freq;
+  config.load_mode = NRF_PWM_LOAD_COMMON;
+  config.step_mode = NRF_PWM_STEP_AUTO;
+  return config;
+}
+
+/* 初始化序列引擎 */
+static int tx_seq_init(void) {
+  nrfx_pwm_config_t config = tx_seq_config(IR_CARRIER_FREQ);
+
+  IRQ_CONNECT(PWM0_IRQn, IRQ_PRIO_LOWEST, nrfx_pwm_0_irq_handler, 0, 0);
+
+  nrfx_err_t err = nrfx_pwm_init(&pwm_seq, &config, pwm_seq_handler, NULL);
+  if (err != NRFX_SUCCESS && err != NRFX_ERROR_ALREADY) {
+    LOG_ERR("PWM sequence init failed: 0x%08x", err);
+    return -EIO;
+  }
+
+  k_sem_init(&tx_state.done, 0, 1);
+  k_sem_init(&tx_state.space, 0, IR_HAL_SEQ_SEGMENTS);
+  tx_state.carrier_freq = IR_CARRIER_FREQ;
+  tx_state.top_value = config.top_value;
+  tx_state.duty_cycle = 0;
+  tx_state.route = SEQ_ROUTE_NONE;
+  tx_state.seq_len = 1;
+  tx_state.busy = false;
+
+  /* 空闲时关闭PWM0，引脚交回GPIO并保持低电平 */
+  nrf_pwm_disable(pwm_seq.p_reg);
+
+  LOG_DBG("PWM sequence engine ready");
+  return 0;
+}
+
+/* 上电/挂起 - 关闭后PWM0不再请求HFCLK */
+static void tx_backend_resume(void) { nrf_pwm_enable(pwm_seq.p_reg); }
+
+static void tx_backend_suspend(void) { nrf_pwm_disable(pwm_seq.p_reg); }
+
+/* 切换载波频率并按占空比计算mark的比较值 */
+static int tx_seq_set_carrier(uint32_t carrier_freq, uint8_t duty_cycle) {
+  if (carrier_freq != tx_state.carrier_freq) {
+    nrfx_pwm_config_t config = tx_seq_config(carrier_freq);
+    if (nrfx_pwm_reconfigure(&pwm_seq, &config) != NRFX_SUCCESS) {
+      return -EIO;
+    }
+
+    tx_state.carrier_freq = carrier_freq;
+    tx_state.top_value = config.top_value;
+    tx_state.route = SEQ_ROUTE_NONE; // 重新配置恢复了COMMON装载
+    tx_state.seq_len = 1;
+  }
+
+  /* 包络输出时比较值等于周期，mark内输出恒为高 */
+  tx_state.mark_value =
+      (tx_envelope ? tx_state.top_value
+                   : tx_state.top_value * tx_duty(duty_cycle) / 100) |
+      SEQ_POLARITY;
+
+  for (size_t m = 0; m < ARRAY_SIZE(seq_table); m++) {
+    for (size_t ch = 0; ch < SEQ_SLOTS; ch++) {
+      seq_table[m][ch] = (m & BIT(ch)) ? tx_state.mark_value : SEQ_POLARITY;
+    }
+  }
+  return 0;
+}
+
+/* 选择输出通道和装载模式 - PSEL在PWM关闭时修改，断开的通道引脚由GPIO
+ * 保持低电平 */
+static void tx_seq_route(uint8_t channels, bool individual) {
+  uint8_t route = channels | (individual ? SEQ_ROUTE_INDIVIDUAL : 0);
+  uint32_t pins[NRF_PWM_CHANNEL_COUNT];
+
+  if (route == tx_state.route) {
+    return;
+  }
+
+  for (size_t ch = 0; ch < NRF_PWM_CHANNEL_COUNT; ch++) {
+    pins[ch] = (channels & BIT(ch)) ? tx_seq_pins[ch]
+                                    : NRF_PWM_PIN_NOT_CONNECTED;
+  }
+
+  nrf_pwm_disable(pwm_seq.p_reg);
+  nrf_pwm_pins_set(pwm_seq.p_reg, pins);
+  nrf_pwm_decoder_set(pwm_seq.p_reg,
+                      individual ? NRF_PWM_LOAD_INDIVIDUAL
+                                 : NRF_PWM_LOAD_COMMON,
+                      NRF_PWM_STEP_AUTO);
+  nrf_pwm_enable(pwm_seq.p_reg);
+  tx_state.route = route;
+  tx_state.seq_len = individual ? NRF_PWM_CHANNEL_COUNT : 1;
+}
+
+static void tx_seq_segment(nrf_pwm_sequence_t *seq, uint32_t seg) {
+  *seq = (nrf_pwm_sequence_t){
+      .values.p_common = seq_table[seg >> 24],
+      .length = tx_state.seq_len,
+      .repeats = seg & (SEQ_RUN_MAX - 1),
+      .end_delay = 0,
+  };
+}
+
+/* 序列结束中断 - 刚结束的序列要等另一个序列放完才再次开始，此时装入
+ * 下一段。中断迟于另一段的时长才会放错，最短的mark/space也有数百微秒 */
+static void tx_seq_refill(uint8_t seq_id) {
+  nrf_pwm_sequence_t seq;
+  uint32_t seg;
+
+  if (tx_state.seq_left == 0) {
+    return;
+  }
+  if (!ir_ring_get(&seq_ring, &seg)) {
+    /* TX线程没有及时补充，继续回放会重复旧段，立即停止 */
+    tx_state.seq_left = 0;
+    tx_state.underrun = true;
+    nrfx_pwm_stop(&pwm_seq, false);
+    k_sem_give(&tx_state.space);
+    return;
+  }
+
+  tx_state.seq_left--;
+  tx_seq_segment(&seq, seg);
+  nrfx_pwm_sequence_update(&pwm_seq, seq_id, &seq);
+  k_sem_give(&tx_state.space);
+}
+
+/* 把段写入环形缓冲直到写满或全部写入，real之后为补齐的space。全部写入
+ * 返回true */
+static bool tx_seq_fill(uint32_t *pushed, uint32_t real, uint32_t total) {
+  while (*pushed < total && ir_ring_count(&seq_ring) < IR_HAL_SEQ_SEGMENTS) {
+    uint32_t seg;
+
+    if (!tx_seq_next(&seg)) {
+      /* 第一个补齐的space给装入最后一段的中断留出余量 */
+      seg = SEQ_SEG(*pushed == real
+                        ? tx_seq_periods(ir_timing_pack(SEQ_GUARD_US))
+                        : 1,
+                    0);
+    }
+    ir_ring_put(&seq_ring, seg);
+    (*pushed)++;
+  }
+  return *pushed == total;
+}
+
+/* 回放来源中的全部段 - SEQ0/SEQ1交替各放一段，LOOP覆盖全部段对，每段
+ * 结束的中断装入下一段; 环形缓冲放不下整帧时TX线程边放边补 */
+static int tx_seq_run(void) {
+  uint64_t periods = 0;
+  uint32_t real = 0;
+  uint32_t seg;
+
+  /* 第一遍只统计段数和总时长 */
+  while (tx_seq_next(&seg)) {
+    periods += (seg & (SEQ_RUN_MAX - 1)) + 1;
+    real++;
+  }
+  tx_seq_rewind();
+
+  /* 末尾至少一个space，段数凑成偶数 */
+  uint32_t total = real + (real % 2 ? 1 : 2);
+  if (total / 2 > UINT16_MAX) {
+    LOG_ERR("Frame too long for sequence loop");
+    return -ENOMEM;
+  }
+
+  uint32_t total_us =
+      periods * USEC_PER_SEC / tx_state.carrier_freq + SEQ_GUARD_US;
+  k_timeout_t timeout = K_USEC(total_us + 20000);
+  nrf_pwm_sequence_t seq0;
+  nrf_pwm_sequence_t seq1;
+  uint32_t pushed = 0;
+
+  ir_ring_reset(&seq_ring);
+  bool filled = tx_seq_fill(&pushed, real, total);
+  ir_ring_get(&seq_ring, &seg);
+  tx_seq_segment(&seq0, seg);
+  ir_ring_get(&seq_ring, &seg);
+  tx_seq_segment(&seq1, seg);
+
+  tx_state.seq_left = total - 2;
+  tx_state.underrun = false;
+  tx_state.busy = true;
+  k_sem_reset(&tx_state.done);
+  k_sem_reset(&tx_state.space);
+  nrfx_pwm_complex_playback(&pwm_seq, &seq0, &seq1, total / 2,
+                            NRFX_PWM_FLAG_SIGNAL_END_SEQ0 |
+                                NRFX_PWM_FLAG_SIGNAL_END_SEQ1 |
+                                NRFX_PWM_FLAG_STOP);
+
+  /* 回放期间只在缓冲有空位时补充，其余时间CPU可休眠或处理其他任务 */
+  int ret = 0;
+  while (!filled && ret == 0 && !tx_state.underrun) {
+    ret = k_sem_take(&tx_state.space, timeout);
+    filled = tx_seq_fill(&pushed, real, total);
+  }
+  if (ret == 0) {
+    ret = k_sem_take(&tx_state.done, timeout);
+  }
+
+  if (ret < 0) {
+    LOG_ERR("Sequence playback timeout");
+    nrfx_pwm_stop(&pwm_seq, true);
+    tx_state.busy = false;
+    return ret;
+  }
+  if (tx_state.underrun) {
+    LOG_ERR("Sequence underrun after %u segments", pushed);
+    return -EIO;
+  }
+  return 0;
+}
+
+/* 编译时序并回放 */
+static int tx_seq_play(const ir_timing_t *timings, size_t count,
+                       uint32_t carrier_freq, uint8_t duty_cycle) {
+  if (tx_state.busy) {
+    return -EBUSY;
+  }
+
+  int ret = tx_seq_set_carrier(carrier_freq, duty_cycle);
+  if (ret < 0) {
+    return ret;
+  }
+  tx_seq_route(IR_HAL_TX_CH_DEFAULT, false);
+
+  ir_hal_tx_lane_t lane = {
+      .timings = timings, .count = count, .channels = IR_HAL_TX_CH_DEFAULT};
+  tx_seq_source(&lane, 1, NULL, 0);
+  return tx_seq_run();
+}
+
+/* 启动发送 - 记录载波频率和占空比 */
+static int tx_start(uint32_t carrier_freq, uint8_t duty_cycle) {
+  int ret = tx_seq_set_carrier(carrier_freq, duty_cycle);
+  if (ret < 0) {
+    LOG_ERR("Failed to set carrier: %d", ret);
+    return ret;
+  }
+
+  tx_state.duty_cycle = duty_cycle;
+  LOG_DBG("TX started: %u Hz, %u%%", carrier_freq, tx_duty(duty_cycle));
+  return 0;
+}
+
+/* 停止发送 */
+static int tx_stop(void) {
+  nrfx_pwm_stop(&pwm_seq, true);
+  LOG_DBG("TX stopped");
+  return 0;
+}
+
+/* 发送单个脉冲 - 兼容接口，mark由序列引擎回放 */
+int ir_hal_tx_pulse(uint32_t duration_us, bool is_mark) {
+  if (!is_mark) {
+    /* 序列停止后输出保持低电平 */
+    k_busy_wait(duration_us);
+    return 0;
+  }
+
+  ir_timing_t timing = ir_timing_pack(duration_us);
+  return tx_seq_play(&timing, 1, tx_state.carrier_freq, tx_state.duty_cycle);
+}
+
+/* 发送整帧 */
+static int tx_frame(const ir_timing_t *timings, size_t count,
+                    uint32_t carrier_freq, uint8_t duty_cycle) {
+  return tx_seq_play(timings, count, carrier_freq, duty_cycle);
+}
+
+/* 按载波周期数发送 - 周期数直接展开为序列值，不经微秒换算 */
+static int tx_periods(const uint16_t *periods, size_t count,
+                      uint32_t carrier_freq, uint8_t duty_cycle) {
+  if (tx_state.busy) {
+    return -EBUSY;
+  }
+
+  int ret = tx_seq_set_carrier(carrier_freq, duty_cycle);
+  if (ret < 0) {
+    return ret;
+  }
+  tx_seq_route(IR_HAL_TX_CH_DEFAULT, false);
+
+  /* 末尾的lead-out间隔不回放，结束后休眠等待 */
+  size_t played = count - (count % 2 == 0);
+
+  tx_seq_source(NULL, 0, periods, played);
+  ret = tx_seq_run();
+  if (ret == 0 && played < count) {
+    k_usleep((uint64_t)periods[played] * USEC_PER_SEC / carrier_freq);
+  }
+  return ret;
+}
+
+/* 多路发送 - 单路用COMMON装载只连接所选通道，多路用INDIVIDUAL装载，
+ * 任一路的边沿处分段，每段4个比较值 */
+static int tx_lanes(const ir_hal_tx_lane_t *lanes, size_t n,
+                    uint32_t carrier_freq, uint8_t duty_cycle) {
+  if (tx_state.busy) {
+    return -EBUSY;
+  }
+
+  int ret = tx_seq_set_carrier(carrier_freq, duty_cycle);
+  if (ret < 0) {
+    return ret;
+  }
+
+  if (n == 1) {
+    tx_seq_route(lanes[0].channels, false);
+  } else {
+    uint8_t channels = 0;
+    for (size_t l = 0; l < n; l++) {
+      channels |= lanes[l].channels;
+    }
+    tx_seq_route(channels, true);
+  }
+
+  tx_seq_source(lanes, n, NULL, 0);
+  return tx_seq_run();
+}
+#elif defined(IR_HAL_TX_I2S)
+/* 比特流回放 - I2S主模式16位立体声，RATIO 32X时SCK等于MCK，SDOUT上是
+ * 连续的2Mbps比特流。载波周期起点在k * period_fx处(四舍五入到比特)，
+ * mark内每个周期开头mark_bits个比特为高，space全为低; 段边界总在周期
+ * 起点上，周期数与PWM序列引擎一致 */
+static struct {
+  uint64_t base;    // 下一块缓冲第一个比特的位置
+  uint32_t period;  // 下一个要展开的载波周期
+  uint32_t seg_end; // 当前段之后第一个载波周期
+  bool mark;
+  bool done; // 来源已耗尽，seg_end即帧结束
+} i2s_cur;
+
+/* 第k个载波周期起点的比特位置 */
+static uint64_t tx_i2s_bit(uint32_t k) {
+  return ((uint64_t)k * tx_state.period_fx + 0x8000) >> 16;
+}
+
+/* 16位立体声: 先发送的左声道在低半字，各自MSB先发 */
+static inline uint32_t tx_i2s_word(uint32_t bits) {
+  return (bits >> 16) | (bits << 16);
+}
+
+/* 把缓冲中[from, to)的比特置1 */
+static void tx_i2s_set(uint32_t *buf, uint32_t from, uint32_t to) {
+  while (from < to) {
+    uint32_t lo = from % 32;
+    uint32_t n = MIN(to - from, 32 - lo);
+    uint32_t bits = n == 32 ? UINT32_MAX : BIT_MASK(n) << (32 - lo - n);
+
+    buf[from / 32] |= tx_i2s_word(bits);
+    from += n;
+  }
+}
+
+/* 展开一块缓冲 - mark逐个载波周期置位，space整段跳过，跨块的周期在下一
+ * 块中继续。返回true表示这一块整个在帧结束之后 */
+static bool tx_i2s_render(uint32_t *buf) {
+  uint64_t base = i2s_cur.base;
+  uint64_t end = base + I2S_BITS;
+
+  memset(buf, 0, I2S_BITS / 8);
+  while (!i2s_cur.done) {
+    uint32_t seg;
+
+    if (i2s_cur.period == i2s_cur.seg_end) {
+      if (!tx_seq_next(&seg)) {
+        i2s_cur.done = true;
+        break;
+      }
+      i2s_cur.seg_end += (seg & (SEQ_RUN_MAX - 1)) + 1;
+      i2s_cur.mark = (seg >> 24) != 0;
+      continue;
+    }
+
+    uint64_t at = tx_i2s_bit(i2s_cur.period);
+    if (at >= end) {
+      break;
+    }
+    if (!i2s_cur.mark) {
+      i2s_cur.period = i2s_cur.seg_end;
+      continue;
+    }
+
+    uint64_t high = at + tx_state.mark_bits;
+    tx_i2s_set(buf, MAX(at, base) - base, MIN(high, end) - base);
+    if (high > end) {
+      break;
+    }
+    i2s_cur.period++;
+  }
+
+  i2s_cur.base = end;
+  return i2s_cur.done && tx_i2s_bit(i2s_cur.seg_end) <= base;
+}
+
+/* 缓冲回调 - 每块开始回放时请求下一块，交回刚放完的一块; 最后一块开始
+ * 回放时之前的信号都已发出，停止 */
+static void i2s_tx_handler(nrfx_i2s_buffers_t const *p_released,
+                           uint32_t status) {
+  if (status & NRFX_I2S_STATUS_TRANSFER_STOPPED) {
+    tx_state.busy = false;
+    k_sem_give(&tx_state.done);
+    return;
+  }
+  if (!(status & NRFX_I2S_STATUS_NEXT_BUFFERS_NEEDED)) {
+    return;
+  }
+
+  if (tx_state.last) {
+    nrfx_i2s_stop(&i2s_tx);
+    return;
+  }
+  if (tx_state.wanted) {
+    /* TX线程没有及时给出，硬件会重放旧的一块，立即停止 */
+    tx_state.underrun = true;
+    nrfx_i2s_stop(&i2s_tx);
+    k_sem_give(&tx_state.space);
+    return;
+  }
+
+  tx_state.released = p_released ? (uint32_t *)p_released->p_tx_buffer : NULL;
+  tx_state.wanted = true;
+  k_sem_give(&tx_state.space);
+}
+
+/* 初始化比特流引擎 */
+static int tx_i2s_init(void) {
+  nrfx_i2s_config_t config = NRFX_I2S_DEFAULT_CONFIG(
+      NRF_I2S_PIN_NOT_CONNECTED, NRF_I2S_PIN_NOT_CONNECTED,
+      NRF_I2S_PIN_NOT_CONNECTED, IR_TX_PIN, NRF_I2S_PIN_NOT_CONNECTED);
+
+  config.mode = NRF_I2S_MODE_MASTER;
+  config.format = NRF_I2S_FORMAT_ALIGNED;
+  config.alignment = NRF_I2S_ALIGN_LEFT;
+  config.sample_width = NRF_I2S_SWIDTH_16BIT;
+  config.channels = NRF_I2S_CHANNELS_STEREO;
+  config.mck_setup = NRF_I2S_MCK_32MDIV16;
+  config.ratio = NRF_I2S_RATIO_32X;
+
+  IRQ_CONNECT(I2S_IRQn, IRQ_PRIO_LOWEST, nrfx_i2s_0_irq_handler, 0, 0);
+
+  nrfx_err_t err = nrfx_i2s_init(&i2s_tx, &config, i2s_tx_handler);
+  if (err != NRFX_SUCCESS && err != NRFX_ERROR_ALREADY) {
+    LOG_ERR("I2S bitstream init failed: 0x%08x", err);
+    return -EIO;
+  }
+
+  k_sem_init(&tx_state.done, 0, 1);
+  k_sem_init(&tx_state.space, 0, 1);
+  tx_state.carrier_freq = IR_CARRIER_FREQ;
+  tx_state.duty_cycle = 0;
+  tx_state.busy = false;
+
+  LOG_DBG("I2S bitstream engine ready");
+  return 0;
+}
+
+/* 停止时I2S不请求HFCLK，SDOUT由GPIO保持低电平 */
+static void tx_backend_resume(void) {}
+
+static void tx_backend_suspend(void) {}
+
+/* 按载波频率和占空比计算周期和高电平比特数 */
+static void tx_i2s_set_carrier(uint32_t carrier_freq, uint8_t duty_cycle) {
+  tx_state.carrier_freq = carrier_freq;
+  tx_state.period_fx = ((uint64_t)IR_I2S_BIT_RATE << 16) / carrier_freq;
+
+  /* 包络输出时向上取整，相邻周期的高电平首尾相接 */
+  uint32_t mark_fx = tx_envelope
+                         ? tx_state.period_fx + 0x7FFF
+                         : tx_state.period_fx * tx_duty(duty_cycle) / 100;
+  tx_state.mark_bits = MAX((mark_fx + 0x8000) >> 16, 1);
+}
+
+/* 回放来源中的全部段 - 先展开两块，此后每块开始回放时中断请求下一块，
+ * TX线程把放完的一块重新展开后交回; 帧结束后再放一块全低的缓冲 */
+static int tx_i2s_run(void) {
+  uint64_t periods = 0;
+  uint32_t seg;
+
+  /* 第一遍只统计总时长 */
+  while (tx_seq_next(&seg)) {
+    periods += (seg & (SEQ_RUN_MAX - 1)) + 1;
+  }
+  tx_seq_rewind();
+
+  uint32_t total_us = periods * USEC_PER_SEC / tx_state.carrier_freq +
+                      2 * I2S_BITS / (IR_I2S_BIT_RATE / USEC_PER_SEC);
+  k_timeout_t timeout = K_USEC(total_us + 20000);
+
+  memset(&i2s_cur, 0, sizeof(i2s_cur));
+  bool tail = tx_i2s_render(i2s_buffers[0]);
+  uint32_t *next = i2s_buffers[1];
+  bool next_tail = tx_i2s_render(next);
+
+  tx_state.last = tail;
+  tx_state.wanted = false;
+  tx_state.underrun = false;
+  tx_state.busy = true;
+  k_sem_reset(&tx_state.done);
+  k_sem_reset(&tx_state.space);
+
+  nrfx_i2s_buffers_t buffers = {
+      .p_tx_buffer = i2s_buffers[0], .buffer_size = IR_HAL_TX_I2S_WORDS};
+  if (nrfx_i2s_start(&i2s_tx, &buffers, IR_HAL_TX_I2S_WORDS, 0) !=
+      NRFX_SUCCESS) {
+    tx_state.busy = false;
+    return -EIO;
+  }
+
+  /* 第一次请求时第二块已展开，此后展开中断交回的一块 */
+  int ret = 0;
+  while (!tx_state.last && ret == 0) {
+    ret = k_sem_take(&tx_state.space, timeout);
+    if (ret < 0 || tx_state.underrun) {
+      break;
+    }
+    if (!next) {
+      next = tx_state.released;
+      next_tail = tx_i2s_render(next);
+    }
+
+    tx_state.last = next_tail;
+    tx_state.wanted = false;
+    buffers.p_tx_buffer = next;
+    nrfx_i2s_next_buffers_set(&i2s_tx, &buffers);
+    next = NULL;
+  }
+  if (ret == 0) {
+    ret = k_sem_take(&tx_state.done, timeout);
+  }
+
+  if (ret < 0) {
+    LOG_ERR("Bitstream playback timeout");
+    nrfx_i2s_stop(&i2s_tx);
+    tx_state.busy = false;
+    return ret;
+  }
+  if (tx_state.underrun) {
+    LOG_ERR("Bitstream underrun at bit %llu", i2s_cur.base);
+    return -EIO;
+  }
+  return 0;
+}
+
+/* 编译时序并回放 */
+static int tx_i2s_play(const ir_timing_t *timings, size_t count,
+                       uint32_t carrier_freq, uint8_t duty_cycle) {
+  if (tx_state.busy) {
+    return -EBUSY;
+  }
+  tx_i2s_set_carrier(carrier_freq, duty_cycle);
+
+  ir_hal_tx_lane_t lane = {
+      .timings = timings, .count = count, .channels = IR_HAL_TX_CH_DEFAULT};
+  tx_seq_source(&lane, 1, NULL, 0);
+  return tx_i2s_run();
+}
+
+/* 启动发送 - 记录载波频率和占空比 */
+static int tx_start(uint32_t carrier_freq, uint8_t duty_cycle) {
+  tx_i2s_set_carrier(carrier_freq, duty_cycle);
+  tx_state.duty_cycle = duty_cycle;
+  LOG_DBG("TX started: %u Hz, %u%%", carrier_freq, tx_duty(duty_cycle));
+  return 0;
+}
+
+/* 停止发送 */
+static int tx_stop(void) {
+  if (tx_state.busy) {
+    nrfx_i2s_stop(&i2s_tx);
+  }
+  LOG_DBG("TX stopped");
+  return 0;
+}
+
+/* 发送单个脉冲 - 兼容接口，mark展开为比特流回放 */
+int ir_hal_tx_pulse(uint32_t duration_us, bool is_mark) {
+  if (!is_mark) {
+    /* 停止后SDOUT保持低电平 */
+    k_busy_wait(duration_us);
+    return 0;
+  }
+
+  ir_timing_t timing = ir_timing_pack(duration_us);
+  return tx_i2s_play(&timing, 1, tx_state.carrier_freq, tx_state.duty_cycle);
+}
+
+/* 发送整帧 */
+static int tx_frame(const ir_timing_t *timings, size_t count,
+                    uint32_t carrier_freq, uint8_t duty_cycle) {
+  return tx_i2s_play(timings, count, carrier_freq, duty_cycle);
+}
+
+/* 按载波周期数发送 - 周期数直接作为段长，不经微秒换算 */
+static int tx_periods(const uint16_t *periods, size_t count,
+                      uint32_t carrier_freq, uint8_t duty_cycle) {
+  if (tx_state.busy) {
+    return -EBUSY;
+  }
+  tx_i2s_set_carrier(carrier_freq, duty_cycle);
+
+  /* 末尾的lead-out间隔不回放，结束后休眠等待 */
+  size_t played = count - (count % 2 == 0);
+
+  tx_seq_source(NULL, 0, periods, played);
+  int ret = tx_i2s_run();
+  if (ret == 0 && played < count) {
+    k_usleep((uint64_t)periods[played] * USEC_PER_SEC / carrier_freq);
+  }
+  return ret;
+}
+#elif defined(IR_HAL_TX_GATE)
+/* 门控发送 - TIMER4为载波，计数到CC1清零:
+ *   CC0(第1个tick) -> GPIOTE SET，该PPI通道在通道组内，只在mark期间使能
+ *   CC2(占空比处)  -> GPIOTE CLR，始终使能，正在发光的载波脉冲总能结束
+ * TIMER3给出边沿时刻，偶数边沿(mark起点)在CC0，奇数边沿(mark终点)在CC1:
+ *   CC0 -> TIMER4 CLEAR + 通道组EN，载波从相位0开始
+ *   CC1 -> 通道组DIS
+ * 每个边沿的中断只把下一个边沿写入刚触发的CC通道，有一个mark加一个space
+ * 的余量，中断延迟不影响边沿时刻 */
+static const nrfx_timer_t gate_carrier = NRFX_TIMER_INSTANCE(4);
+static const nrfx_timer_t gate_envelope = NRFX_TIMER_INSTANCE(3);
+static uint8_t gate_gpiote_ch;
+static uint8_t gate_ppi[4]; // SET, CLR, mark起点, mark终点
+static nrfx_gppi_channel_group_t gate_group;
+
+/* 发送状态 */
+static struct {
+  struct k_sem done;
+  uint32_t carrier_freq;
+  uint32_t top_value;         // 载波周期(tick)
+  uint8_t duty_cycle;         // ir_hal_tx_start设置，供ir_hal_tx_pulse使用
+  const ir_timing_t *timings; // 二选一: 微秒时序或载波周期数
+  const uint16_t *periods;
+  size_t count;  // 门控的时长个数(以mark结束)
+  size_t edge;   // 已写入CC的最后一个边沿
+  size_t fired;  // 已发生的边沿数
+  uint32_t at;   // 最后一个已写入边沿的时刻(tick)
+  bool busy;
+} tx_state;
+
+/* 第i个时长(tick) - 周期数按载波周期换算，与载波严格同步 */
+static uint32_t tx_gate_ticks(size_t i) {
+  if (tx_state.periods) {
+    return tx_state.periods[i] * tx_state.top_value;
+  }
+  return ir_timing_us(tx_state.timings[i]) * (IR_GATE_CLOCK / USEC_PER_SEC);
+}
+
+/* 把下一个边沿写入对应的CC通道 */
+static void tx_gate_next_edge(void) {
+  if (tx_state.edge >= tx_state.count) {
+    return;
+  }
+
+  tx_state.at += tx_gate_ticks(tx_state.edge++);
+  nrfx_timer_compare(&gate_envelope,
+                     (tx_state.edge % 2) ? NRF_TIMER_CC_CHANNEL1
+                                         : NRF_TIMER_CC_CHANNEL0,
+                     tx_state.at, true);
+}
+
+/* 边沿中断 - 最后一个mark结束即整帧结束 */
+static void gate_envelope_handler(nrf_timer_event_t event_type,
+                                  void *p_context) {
+  if (event_type != NRF_TIMER_EVENT_COMPARE0 &&
+      event_type != NRF_TIMER_EVENT_COMPARE1) {
+    return;
+  }
+
+  if (++tx_state.fired > tx_state.count) {
+    k_sem_give(&tx_state.done);
+    return;
+  }
+  tx_gate_next_edge();
+}
+
+static void gate_carrier_handler(nrf_timer_event_t event_type,
+                                 void *p_context) {}
+
+/* 初始化门控链路 */
+static int tx_gate_init(void) {
+  nrfx_timer_config_t config = NRFX_TIMER_DEFAULT_CONFIG(IR_GATE_CLOCK);
+  config.bit_width = NRF_TIMER_BIT_WIDTH_32;
+
+  IRQ_CONNECT(TIMER3_IRQn, IRQ_PRIO_LOWEST, nrfx_timer_3_irq_handler, 0, 0);
+  IRQ_CONNECT(TIMER4_IRQn, IRQ_PRIO_LOWEST, nrfx_timer_4_irq_handler, 0, 0);
+
+  if (nrfx_timer_init(&gate_carrier, &config, gate_carrier_handler) !=
+          NRFX_SUCCESS ||
+      nrfx_timer_init(&gate_envelope, &config, gate_envelope_handler) !=
+          NRFX_SUCCESS) {
+    LOG_ERR("Gate timer init failed");
+    return -EIO;
+  }
+
+  if (nrfx_gpiote_channel_alloc(&rx_gpiote, &gate_gpiote_ch) !=
+      NRFX_SUCCESS) {
+    LOG_ERR("No free GPIOTE channel for TX");
+    return -EBUSY;
+  }
+
+  nrfx_gpiote_output_config_t output_config =
+      NRFX_GPIOTE_DEFAULT_OUTPUT_CONFIG;
+  nrfx_gpiote_task_config_t task_config = {
+      .task_ch = gate_gpiote_ch,
+      .polarity = NRF_GPIOTE_POLARITY_TOGGLE,
+      .init_val = NRF_GPIOTE_INITIAL_VALUE_LOW,
+  };
+
+  if (nrfx_gpiote_output_configure(&rx_gpiote, IR_TX_PIN, &output_config,
+                                   &task_config) != NRFX_SUCCESS) {
+    LOG_ERR("GPIOTE output config failed");
+    return -EIO;
+  }
+  nrfx_gpiote_out_task_enable(&rx_gpiote, IR_TX_PIN);
+
+  for (size_t i = 0; i < ARRAY_SIZE(gate_ppi); i++) {
+    if (nrfx_gppi_channel_alloc(&gate_ppi[i]) != NRFX_SUCCESS) {
+      LOG_ERR("No free PPI channel for TX");
+      return -EBUSY;
+    }
+  }
+  if (nrfx_gppi_group_alloc(&gate_group) != NRFX_SUCCESS) {
+    LOG_ERR("No free PPI channel group for TX");
+    return -EBUSY;
+  }
+
+  nrfx_gppi_channel_endpoints_setup(
+      gate_ppi[0],
+      nrfx_timer_event_address_get(&gate_carrier, NRF_TIMER_EVENT_COMPARE0),
+      nrfx_gpiote_set_task_address_get(&rx_gpiote, IR_TX_PIN));
+  nrfx_gppi_channel_endpoints_setup(
+      gate_ppi[1],
+      nrfx_timer_event_address_get(&gate_carrier, NRF_TIMER_EVENT_COMPARE2),
+      nrfx_gpiote_clr_task_address_get(&rx_gpiote, IR_TX_PIN));
+  nrfx_gppi_channel_endpoints_setup(
+      gate_ppi[2],
+      nrfx_timer_event_address_get(&gate_envelope, NRF_TIMER_EVENT_COMPARE0),
+      nrfx_timer_task_address_get(&gate_carrier, NRF_TIMER_TASK_CLEAR));
+  nrfx_gppi_fork_endpoint_setup(
+      gate_ppi[2],
+      nrfx_gppi_task_address_get(nrfx_gppi_group_enable_task_get(gate_group)));
+  nrfx_gppi_channel_endpoints_setup(
+      gate_ppi[3],
+      nrfx_timer_event_address_get(&gate_envelope, NRF_TIMER_EVENT_COMPARE1),
+      nrfx_gppi_task_address_get(
+          nrfx_gppi_group_disable_task_get(gate_group)));
+  nrfx_gppi_channels_include_in_group(BIT(gate_ppi[0]), gate_group);
+
+  k_sem_init(&tx_state.done, 0, 1);
+  tx_state.busy = false;
+
+  LOG_DBG("TX gate: GPIOTE ch %u", gate_gpiote_ch);
+  return 0;
+}
+
+/* 上电/挂起 - 定时器只在回放期间运行，无需额外处理 */
+static void tx_backend_resume(void) {}
+
+static void tx_backend_suspend(void) {}
+
+/* 切换SET/CLR的事件源 - 载波模式由TIMER4的CC0/CC2在mark内逐周期开关
+ * (SET在通道组内); 包络模式直接由TIMER3的边沿SET/CLR，不产生载波 */
+static void tx_gate_route(bool envelope) {
+  static bool routed_envelope;
+
+  if (envelope == routed_envelope) {
+    return;
+  }
+
+  if (envelope) {
+    nrfx_gppi_channels_remove_from_group(BIT(gate_ppi[0]), gate_group);
+    nrfx_gppi_channel_endpoints_setup(
+        gate_ppi[0],
+        nrfx_timer_event_address_get(&gate_envelope,
+                                     NRF_TIMER_EVENT_COMPARE0),
+        nrfx_gpiote_set_task_address_get(&rx_gpiote, IR_TX_PIN));
+    nrfx_gppi_channel_endpoints_setup(
+        gate_ppi[1],
+        nrfx_timer_event_address_get(&gate_envelope,
+                                     NRF_TIMER_EVENT_COMPARE1),
+        nrfx_gpiote_clr_task_address_get(&rx_gpiote, IR_TX_PIN));
+  } else {
+    nrfx_gppi_channel_endpoints_setup(
+        gate_ppi[0],
+        nrfx_timer_event_address_get(&gate_carrier, NRF_TIMER_EVENT_COMPARE0),
+        nrfx_gpiote_set_task_address_get(&rx_gpiote, IR_TX_PIN));
+    nrfx_gppi_channel_endpoints_setup(
+        gate_ppi[1],
+        nrfx_timer_event_address_get(&gate_carrier, NRF_TIMER_EVENT_COMPARE2),
+        nrfx_gpiote_clr_task_address_get(&rx_gpiote, IR_TX_PIN));
+    nrfx_gppi_channels_include_in_group(BIT(gate_ppi[0]), gate_group);
+  }
+  routed_envelope = envelope;
+}
+
+/* 设置载波周期和占空比 (CC0 -> CC2为发光时段) */
+static void tx_gate_set_carrier(uint32_t carrier_freq, uint8_t duty_cycle) {
+  uint32_t top = IR_GATE_CLOCK / carrier_freq;
+
+  nrfx_timer_compare(&gate_carrier, NRF_TIMER_CC_CHANNEL0, 1, false);
+  nrfx_timer_compare(&gate_carrier, NRF_TIMER_CC_CHANNEL2,
+                     1 + top * tx_duty(duty_cycle) / 100, false);
+  nrfx_timer_extended_compare(&gate_carrier, NRF_TIMER_CC_CHANNEL1, top,
+                              NRF_TIMER_SHORT_COMPARE1_CLEAR_MASK, false);
+  tx_state.carrier_freq = carrier_freq;
+  tx_state.top_value = top;
+}
+
+/* 门控发送count个时长，末尾的space不进门控，结束后休眠等待 */
+static int tx_gate_play(const ir_timing_t *timings, const uint16_t *periods,
+                        size_t count, uint32_t carrier_freq,
+                        uint8_t duty_cycle) {
+  if (tx_state.busy) {
+    return -EBUSY;
+  }
+
+  bool envelope = tx_envelope;
+
+  tx_gate_route(envelope);
+  tx_gate_set_carrier(carrier_freq, duty_cycle);
+  tx_state.timings = timings;
+  tx_state.periods = periods;
+  tx_state.count = count - (count % 2 == 0);
+  tx_state.edge = 0;
+  tx_state.fired = 0;
+  tx_state.at = IR_GATE_LEAD_US * (IR_GATE_CLOCK / USEC_PER_SEC);
+
+  uint64_t total_ticks = 0;
+  for (size_t i = 0; i < tx_state.count; i++) {
+    total_ticks += tx_gate_ticks(i);
+  }
+
+  tx_state.busy = true;
+  k_sem_reset(&tx_state.done);
+  nrfx_gppi_group_disable(gate_group);
+  nrfx_timer_clear(&gate_envelope);
+  nrfx_timer_compare(&gate_envelope, NRF_TIMER_CC_CHANNEL0, tx_state.at,
+                     true);
+  tx_gate_next_edge();
+
+  uint32_t ppi_mask = BIT(gate_ppi[1]) | BIT(gate_ppi[2]) | BIT(gate_ppi[3]) |
+                      (envelope ? BIT(gate_ppi[0]) : 0);
+
+  nrfx_gppi_channels_enable(ppi_mask);
+  nrfx_timer_enable(&gate_carrier);
+  nrfx_timer_enable(&gate_envelope);
+
+  /* 发送期间CPU只在每个边沿处理一次中断 */
+  uint32_t total_us = total_ticks / (IR_GATE_CLOCK / USEC_PER_SEC);
+  int ret = k_sem_take(&tx_state.done, K_USEC(total_us + 20000));
+
+  nrfx_timer_disable(&gate_envelope);
+  nrfx_timer_disable(&gate_carrier);
+  nrfx_gppi_group_disable(gate_group);
+  nrfx_gppi_channels_disable(ppi_mask);
+  nrfx_gpiote_out_clear(&rx_gpiote, IR_TX_PIN);
+  tx_state.busy = false;
+
+  if (ret < 0) {
+    LOG_ERR("Gated TX timeout at edge %u/%u", tx_state.fired,
+            tx_state.count + 1);
+    return ret;
+  }
+
+  if (tx_state.count < count) {
+    k_usleep((uint64_t)tx_gate_ticks(tx_state.count) * USEC_PER_SEC /
+             IR_GATE_CLOCK);
+  }
+  return 0;
+}
+
+/* 启动发送 - 记录载波频率和占空比 */
+static int tx_start(uint32_t carrier_freq, uint8_t duty_cycle) {
+  tx_state.carrier_freq = carrier_freq;
+  tx_state.duty_cycle = duty_cycle;
+  LOG_DBG("TX started: %u Hz, %u%%", carrier_freq, tx_duty(duty_cycle));
+  return 0;
+}
+
+/* 停止发送 */
+static int tx_stop(void) {
+  nrfx_gpiote_out_clear(&rx_gpiote, IR_TX_PIN);
+  LOG_DBG("TX stopped");
+  return 0;
+}
+
+/* 发送单个脉冲 - 兼容接口，mark门控发送 */
+int ir_hal_tx_pulse(uint32_t duration_us, bool is_mark) {
+  if (!is_mark) {
+    k_busy_wait(duration_us);
+    return 0;
+  }
+
+  ir_timing_t timing = ir_timing_pack(duration_us);
+  return tx_gate_play(&timing, NULL, 1,
+                      tx_state.carrier_freq ? tx_state.carrier_freq
+                                            : IR_CARRIER_FREQ,
+                      tx_state.duty_cycle);
+}
+
+/* 发送整帧 */
+static int tx_frame(const ir_timing_t *timings, size_t count,
+                    uint32_t carrier_freq, uint8_t duty_cycle) {
+  return tx_gate_play(timings, NULL, count, carrier_freq, duty_cycle);
+}
+
+/* 按载波周期数发送 - 边沿落在载波周期边界上 */
+static int tx_periods(const uint16_t *periods, size_t count,
+                      uint32_t carrier_freq, uint8_t duty_cycle) {
+  return tx_gate_play(NULL, periods, count, carrier_freq, duty_cycle);
+}
+#elif defined(IR_HAL_TX_ZLI)
+/* 零延迟中断发送 - TIMER4的两个比较通道:
+ *   CC0 载波边沿: mark内在周期起点置高、占空比处置低
+ *   CC1 mark/space边沿: 取自边沿表，mark起点开始载波，终点置低
+ * 处理函数只读写寄存器和本文件的状态，不调用内核; 整帧结束后挂起SWI3，
+ * 由普通优先级的中断唤醒TX线程 */
+static const nrfx_timer_t zli_timer = NRFX_TIMER_INSTANCE(4);
+#define ZLI_DONE_IRQn SWI3_EGU3_IRQn
+#define ZLI_MARGIN 16 // 比较值至少领先当前计数的tick数
+
+/* 边沿表 - 各mark/space起点和最后一个mark终点的时刻(tick) */
+static uint32_t zli_edges[IR_HAL_TX_ZLI_EDGES + 1];
+
+/* 发送状态 */
+static struct {
+  struct k_sem done;
+  uint32_t carrier_freq;
+  uint8_t duty_cycle;  // ir_hal_tx_start设置，供ir_hal_tx_pulse使用
+  uint32_t period;     // 载波周期(tick)
+  uint32_t high;       // 每个周期的高电平(tick)，包络输出时为0
+  size_t count;        // 边沿数
+  size_t edge;         // 下一个要写入CC1的边沿
+  uint32_t cycle;      // 当前载波周期的起点
+  bool mark;
+  bool on;             // 引脚当前为高
+  bool busy;
+} tx_state;
+
+/* 载波边沿 - 被同为0优先级的无线电中断推迟到下一个边沿之后时，引脚置低
+ * 并跳到下一个未过去的周期，否则比较值已过要等计数器回绕 */
+static void zli_carrier_edge(void) {
+  uint32_t next;
+
+  if (!tx_state.mark) {
+    return;
+  }
+  if (tx_state.on) {
+    nrf_gpio_pin_clear(IR_TX_PIN);
+    tx_state.cycle += tx_state.period;
+    next = tx_state.cycle;
+  } else {
+    nrf_gpio_pin_set(IR_TX_PIN);
+    next = tx_state.cycle + tx_state.high;
+  }
+  tx_state.on = !tx_state.on;
+
+  uint32_t now = nrfx_timer_capture(&zli_timer, NRF_TIMER_CC_CHANNEL2);
+  if ((int32_t)(next - now) < ZLI_MARGIN) {
+    nrf_gpio_pin_clear(IR_TX_PIN);
+    tx_state.on = false;
+    while ((int32_t)(tx_state.cycle - now) < ZLI_MARGIN) {
+      tx_state.cycle += tx_state.period;
+    }
+    next = tx_state.cycle;
+  }
+
+  /* mark终点之前已没有周期起点时不再置高，以免与终点同时出现毛刺 */
+  if (!tx_state.on && (int32_t)(zli_edges[tx_state.edge] - next) <= 0) {
+    return;
+  }
+  nrfx_timer_compare(&zli_timer, NRF_TIMER_CC_CHANNEL0, next, true);
+}
+
+/* mark/space边沿 - 最后一个mark结束即整帧结束 */
+static void zli_envelope_edge(void) {
+  size_t i = tx_state.edge++;
+
+  if (i % 2 == 0) {
+    nrf_gpio_pin_set(IR_TX_PIN);
+    tx_state.mark = true;
+    tx_state.on = true;
+    tx_state.cycle = zli_edges[i];
+    if (tx_state.high) {
+      nrfx_timer_compare(&zli_timer, NRF_TIMER_CC_CHANNEL0,
+                         tx_state.cycle + tx_state.high, true);
+    }
+  } else {
+    nrf_gpio_pin_clear(IR_TX_PIN);
+    tx_state.mark = false;
+    tx_state.on = false;
+    nrfx_timer_compare_int_disable(&zli_timer, NRF_TIMER_CC_CHANNEL0);
+  }
+
+  if (tx_state.edge < tx_state.count) {
+    nrfx_timer_compare(&zli_timer, NRF_TIMER_CC_CHANNEL1,
+                       zli_edges[tx_state.edge], true);
+  } else {
+    nrfx_timer_disable(&zli_timer);
+    NVIC_SetPendingIRQ(ZLI_DONE_IRQn);
   }
+}
 
-  uint32_t now_us = k_cyc_to_us_floor32(k_cycle_get_32());
-  int current_state = gpio_pin_get(gpio_dev, IR_RX_PIN);
-
-  /* 检查GPIO读取是否成功 */
-  if (current_state < 0) {
-    return;
+static void zli_timer_handler(nrf_timer_event_t event_type,
+                              void *p_context) {
+  if (event_type == NRF_TIMER_EVENT_COMPARE0) {
+    zli_carrier_edge();
+  } else if (event_type == NRF_TIMER_EVENT_COMPARE1) {
+    zli_envelope_edge();
   }
+}
 
-  if (rx_state.last_edge_us > 0) {
-    uint32_t duration;
+/* 零延迟中断入口 - 不经内核的中断处理，返回0不做调度 */
+ISR_DIRECT_DECLARE(zli_timer_isr) {
+  nrfx_timer_4_irq_handler();
+  return 0;
+}
 
-    /* 处理32位计数器溢出 */
-    if (now_us >= rx_state.last_edge_us) {
-      duration = now_us - rx_state.last_edge_us;
-    } else {
-      /* 溢出情况 */
-      duration = (UINT32_MAX - rx_state.last_edge_us) + now_us + 1;
-    }
+/* 帧结束 - 普通优先级，可以调用内核 */
+static void zli_done_isr(const void *arg) {
+  tx_state.busy = false;
+  k_sem_give(&tx_state.done);
+}
 
-    if (duration > 0 && duration < IR_MAX_PULSE_US) {
-      ir_pulse_t pulse = {
-          .duration_us = duration,
-          .is_mark = !rx_state.last_state // 上一个状态
-      };
+/* 初始化零延迟中断发送 */
+static int tx_zli_init(void) {
+  nrfx_timer_config_t config = NRFX_TIMER_DEFAULT_CONFIG(IR_ZLI_CLOCK);
+  config.bit_width = NRF_TIMER_BIT_WIDTH_32;
 
-      if (rx_state.callback) {
-        rx_state.callback(&pulse, rx_state.user_data);
-      }
-    }
+  IRQ_DIRECT_CONNECT(TIMER4_IRQn, 0, zli_timer_isr, IRQ_ZERO_LATENCY);
+  IRQ_CONNECT(ZLI_DONE_IRQn, IRQ_PRIO_LOWEST, zli_done_isr, NULL, 0);
+  irq_enable(ZLI_DONE_IRQn);
+
+  if (nrfx_timer_init(&zli_timer, &config, zli_timer_handler) !=
+      NRFX_SUCCESS) {
+    LOG_ERR("Zero-latency TX timer init failed");
+    return -EIO;
   }
 
-  rx_state.last_edge_us = now_us;
-  rx_state.last_state = (current_state != 0);
+  nrf_gpio_cfg_output(IR_TX_PIN);
+  nrf_gpio_pin_clear(IR_TX_PIN);
+
+  k_sem_init(&tx_state.done, 0, 1);
+  tx_state.carrier_freq = IR_CARRIER_FREQ;
+  tx_state.duty_cycle = 0;
+  tx_state.busy = false;
+
+  LOG_DBG("Zero-latency TX engine ready");
+  return 0;
 }
 
-/* HAL初始化 */
-int ir_hal_init(void) {
-  int ret;
+/* 计时器只在发送期间运行 */
+static void tx_backend_resume(void) {}
 
-  LOG_INF("Initializing IR HAL...");
+static void tx_backend_suspend(void) {}
 
-  /* 检查PWM设备 */
-  if (!device_is_ready(pwm_ir.dev)) {
-    LOG_ERR("PWM device not ready");
-    return -ENODEV;
+/* 第i个时长(tick) - 周期数按载波周期换算，与载波严格同步 */
+static uint32_t tx_zli_ticks(const ir_timing_t *timings,
+                             const uint16_t *periods, size_t i) {
+  if (periods) {
+    return periods[i] * tx_state.period;
   }
-  LOG_DBG("PWM device ready");
+  return ir_timing_us(timings[i]) * (IR_ZLI_CLOCK / USEC_PER_SEC);
+}
 
-  /* 检查GPIO设备 */
-  if (!gpio_dev) {
-    LOG_ERR("GPIO device is NULL");
-    return -ENODEV;
+/* 预先算好边沿表再启动计时器，发送期间只在每个边沿进一次中断 */
+static int tx_zli_play(const ir_timing_t *timings, const uint16_t *periods,
+                       size_t count, uint32_t carrier_freq,
+                       uint8_t duty_cycle) {
+  if (tx_state.busy) {
+    return -EBUSY;
   }
 
-  if (!device_is_ready(gpio_dev)) {
-    LOG_ERR("GPIO device not ready");
-    return -ENODEV;
+  /* 末尾的space不需要边沿，结束后休眠等待 */
+  size_t played = count - (count % 2 == 0);
+  if (played > IR_HAL_TX_ZLI_EDGES) {
+    LOG_ERR("Frame too long for edge table (%u)", count);
+    return -ENOMEM;
   }
-  LOG_DBG("GPIO device ready");
 
-  /* 配置RX GPIO为输入，带上拉 */
-  ret = gpio_pin_configure(gpio_dev, IR_RX_PIN, GPIO_INPUT | GPIO_PULL_UP);
-  if (ret < 0) {
-    LOG_ERR("Failed to configure RX pin %d: %d", IR_RX_PIN, ret);
-    return ret;
-  }
-  LOG_DBG("RX pin %d configured", IR_RX_PIN);
+  tx_state.carrier_freq = carrier_freq;
+  tx_state.period = IR_ZLI_CLOCK / carrier_freq;
+  tx_state.high =
+      tx_envelope ? 0 : tx_state.period * tx_duty(duty_cycle) / 100;
 
-  /* 禁用GPIO中断（初始状态） */
-  ret = gpio_pin_interrupt_configure(gpio_dev, IR_RX_PIN, GPIO_INT_DISABLE);
-  if (ret < 0) {
-    LOG_ERR("Failed to configure interrupt: %d", ret);
-    return ret;
+  zli_edges[0] = IR_ZLI_LEAD_US * (IR_ZLI_CLOCK / USEC_PER_SEC);
+  for (size_t i = 0; i < played; i++) {
+    zli_edges[i + 1] = zli_edges[i] + tx_zli_ticks(timings, periods, i);
   }
 
-  /* 初始化GPIO回调 */
-  gpio_init_callback(&gpio_cb, gpio_callback_handler, BIT(IR_RX_PIN));
+  tx_state.count = played + 1;
+  tx_state.edge = 0;
+  tx_state.mark = false;
+  tx_state.on = false;
+  tx_state.busy = true;
+  k_sem_reset(&tx_state.done);
+
+  nrfx_timer_clear(&zli_timer);
+  nrfx_timer_compare(&zli_timer, NRF_TIMER_CC_CHANNEL1, zli_edges[0], true);
+  nrfx_timer_enable(&zli_timer);
+
+  uint32_t total_us = zli_edges[played] / (IR_ZLI_CLOCK / USEC_PER_SEC);
+  int ret = k_sem_take(&tx_state.done, K_USEC(total_us + 20000));
 
-  ret = gpio_add_callback(gpio_dev, &gpio_cb);
   if (ret < 0) {
-    LOG_ERR("Failed to add callback: %d", ret);
+    nrfx_timer_disable(&zli_timer);
+    nrfx_timer_compare_int_disable(&zli_timer, NRF_TIMER_CC_CHANNEL0);
+    nrfx_timer_compare_int_disable(&zli_timer, NRF_TIMER_CC_CHANNEL1);
+    nrf_gpio_pin_clear(IR_TX_PIN);
+    tx_state.busy = false;
+    LOG_ERR("Zero-latency TX timeout at edge %u/%u", tx_state.edge,
+            tx_state.count);
     return ret;
   }
-  LOG_DBG("GPIO callback added");
-
-  /* 初始化接收状态 */
-  memset(&rx_state, 0, sizeof(rx_state));
 
-  /* 确保PWM初始关闭 */
-  ret = pwm_set_dt(&pwm_ir, 0, 0);
-  if (ret < 0) {
-    LOG_WRN("Failed to stop PWM initially: %d", ret);
+  if (played < count) {
+    k_usleep((uint64_t)tx_zli_ticks(timings, periods, played) *
+             USEC_PER_SEC / IR_ZLI_CLOCK);
   }
+  return 0;
+}
 
-  LOG_INF("IR HAL initialized successfully");
+/* 启动发送 - 记录载波频率和占空比 */
+static int tx_start(uint32_t carrier_freq, uint8_t duty_cycle) {
+  tx_state.carrier_freq = carrier_freq;
+  tx_state.duty_cycle = duty_cycle;
+  LOG_DBG("TX started: %u Hz, %u%%", carrier_freq, tx_duty(duty_cycle));
+  return 0;
+}
+
+/* 停止发送 */
+static int tx_stop(void) {
+  nrf_gpio_pin_clear(IR_TX_PIN);
+  LOG_DBG("TX stopped");
   return 0;
 }
 
-/* 启动发送 - 配置载波频率 */
-int ir_hal_tx_start(uint32_t carrier_freq) {
+/* 发送单个脉冲 - 兼容接口，mark由中断逐个载波周期输出 */
+int ir_hal_tx_pulse(uint32_t duration_us, bool is_mark) {
+  if (!is_mark) {
+    k_busy_wait(duration_us);
+    return 0;
+  }
+
+  ir_timing_t timing = ir_timing_pack(duration_us);
+  return tx_zli_play(&timing, NULL, 1,
+                     tx_state.carrier_freq ? tx_state.carrier_freq
+                                           : IR_CARRIER_FREQ,
+                     tx_state.duty_cycle);
+}
+
+/* 发送整帧 */
+static int tx_frame(const ir_timing_t *timings, size_t count,
+                    uint32_t carrier_freq, uint8_t duty_cycle) {
+  return tx_zli_play(timings, NULL, count, carrier_freq, duty_cycle);
+}
+
+/* 按载波周期数发送 - 边沿落在载波周期边界上 */
+static int tx_periods(const uint16_t *periods, size_t count,
+                      uint32_t carrier_freq, uint8_t duty_cycle) {
+  return tx_zli_play(NULL, periods, count, carrier_freq, duty_cycle);
+}
+#elif defined(IR_HAL_TX_NONE)
+/* 接收引擎 - 发射管接在应用核，发送接口一律不支持 */
+static void tx_backend_resume(void) {}
+
+static void tx_backend_suspend(void) {}
+
+static int tx_start(uint32_t carrier_freq, uint8_t duty_cycle) {
+  return -ENOTSUP;
+}
+
+static int tx_stop(void) { return 0; }
+
+int ir_hal_tx_pulse(uint32_t duration_us, bool is_mark) { return -ENOTSUP; }
+
+static int tx_frame(const ir_timing_t *timings, size_t count,
+                    uint32_t carrier_freq, uint8_t duty_cycle) {
+  return -ENOTSUP;
+}
+
+static int tx_periods(const uint16_t *periods, size_t count,
+                      uint32_t carrier_freq, uint8_t duty_cycle) {
+  return -ENOTSUP;
+}
+#else
+/* 上电/挂起 - 设备运行时PM，挂起时PWM驱动切到pwm0_sleep引脚状态 */
+static void tx_backend_resume(void) {
+#ifdef CONFIG_PM_DEVICE_RUNTIME
+  pm_device_runtime_get(pwm_ir.dev);
+#endif
+}
+
+static void tx_backend_suspend(void) {
+#ifdef CONFIG_PM_DEVICE_RUNTIME
+  pm_device_runtime_put(pwm_ir.dev);
+#endif
+}
+
+/* 当前载波 - space之后按此恢复，而非固定的IR_CARRIER_FREQ */
+static uint32_t tx_period_ns = NSEC_PER_SEC / IR_CARRIER_FREQ;
+static uint32_t tx_pulse_ns =
+    NSEC_PER_SEC / IR_CARRIER_FREQ * IR_PWM_DUTY / 100;
+
+/* 启动发送 - 配置载波频率和占空比 */
+static int tx_start(uint32_t carrier_freq, uint8_t duty_cycle) {
   uint32_t period_ns = NSEC_PER_SEC / carrier_freq;
-  uint32_t pulse_ns = period_ns * IR_PWM_DUTY / 100;
+  uint32_t pulse_ns =
+      tx_envelope ? period_ns : period_ns * tx_duty(duty_cycle) / 100;
 
+  tx_period_ns = period_ns;
+  tx_pulse_ns = pulse_ns;
   int ret = pwm_set_dt(&pwm_ir, period_ns, pulse_ns);
   if (ret < 0) {
     LOG_ERR("Failed to start PWM: %d", ret);
     return ret;
   }
 
-  LOG_DBG("TX started: %u Hz", carrier_freq);
+  LOG_DBG("TX started: %u Hz, %u%%", carrier_freq, tx_duty(duty_cycle));
   return 0;
 }
 
 /* 停止发送 */
-int ir_hal_tx_stop(void) {
+static int tx_stop(void) {
   pwm_set_dt(&pwm_ir, 0, 0);
   LOG_DBG("TX stopped");
   return 0;
@@ -174,43 +2837,578 @@ int ir_hal_tx_pulse(uint32_t duration_us, bool is_mark) {
 
   /* 如果是space后，恢复PWM为下一个mark做准备 */
   if (!is_mark) {
-    uint32_t period_ns = NSEC_PER_SEC / IR_CARRIER_FREQ;
-    uint32_t pulse_ns = period_ns * IR_PWM_DUTY / 100;
-    pwm_set_dt(&pwm_ir, period_ns, pulse_ns);
+    pwm_set_dt(&pwm_ir, tx_period_ns, tx_pulse_ns);
   }
 
   return 0;
 }
 
-/* 启动接收 */
-int ir_hal_rx_start(ir_rx_callback_t callback, void *user_data) {
-  if (!callback) {
-    return -EINVAL;
+/* 发送整帧 - 无序列引擎时逐脉冲发送 */
+static int tx_frame(const ir_timing_t *timings, size_t count,
+                    uint32_t carrier_freq, uint8_t duty_cycle) {
+  int ret = tx_start(carrier_freq, duty_cycle);
+  if (ret < 0) {
+    return ret;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    ir_hal_tx_pulse(ir_timing_us(timings[i]), i % 2 == 0);
+  }
+
+  return tx_stop();
+}
+
+/* 按载波周期数发送 - 无序列引擎时换算为微秒逐脉冲发送 */
+static int tx_periods(const uint16_t *periods, size_t count,
+                      uint32_t carrier_freq, uint8_t duty_cycle) {
+  int ret = tx_start(carrier_freq, duty_cycle);
+  if (ret < 0) {
+    return ret;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    ir_hal_tx_pulse((uint64_t)periods[i] * USEC_PER_SEC / carrier_freq,
+                    i % 2 == 0);
   }
 
-  rx_state.callback = callback;
-  rx_state.user_data = user_data;
-  rx_state.last_edge_us = 0;
-  rx_state.last_state = false;
-  rx_state.active = true;
+  return tx_stop();
+}
+#endif
+
+/* TX电源 - 引用计数，首个get请求HFXO(载波精度)并恢复发送外设，
+ * 最后一个put挂起外设并释放HFXO */
+static K_MUTEX_DEFINE(tx_power_lock);
+static struct {
+  uint32_t refs;
+  uint32_t since; // 本次上电时刻(周期)
+  bool legacy;    // ir_hal_tx_start持有的引用
+  uint32_t frames;
+  uint32_t resumes;
+  uint64_t powered_us;
+  uint64_t airtime_us;
+  uint64_t carrier_us;
+#ifdef CONFIG_CLOCK_CONTROL_NRF
+  struct onoff_client hfxo;
+#endif
+} tx_power;
+
+/* 请求HFXO并等待起振 (约0.3ms)，HFINT精度不足以保证载波频率 */
+static int tx_hfxo_request(void) {
+#ifdef CONFIG_CLOCK_CONTROL_NRF
+  struct onoff_manager *mgr =
+      z_nrf_clock_control_get_onoff(CLOCK_CONTROL_NRF_SUBSYS_HF);
+  int res;
 
-  /* 启用双边沿中断 */
-  int ret =
-      gpio_pin_interrupt_configure(gpio_dev, IR_RX_PIN, GPIO_INT_EDGE_BOTH);
+  sys_notify_init_spinwait(&tx_power.hfxo.notify);
+  int ret = onoff_request(mgr, &tx_power.hfxo);
   if (ret < 0) {
-    LOG_ERR("Failed to enable RX interrupt: %d", ret);
     return ret;
   }
 
-  LOG_INF("RX started");
+  while (sys_notify_fetch_result(&tx_power.hfxo.notify, &res) == -EAGAIN) {
+    k_yield();
+  }
+  return res;
+#else
   return 0;
+#endif
+}
+
+static void tx_hfxo_release(void) {
+#ifdef CONFIG_CLOCK_CONTROL_NRF
+  onoff_release(z_nrf_clock_control_get_onoff(CLOCK_CONTROL_NRF_SUBSYS_HF));
+#endif
+}
+
+void ir_hal_tx_power_get(void) {
+  k_mutex_lock(&tx_power_lock, K_FOREVER);
+  if (tx_power.refs == 0) {
+    int ret = tx_hfxo_request();
+    if (ret < 0) {
+      LOG_WRN("HFXO request failed: %d", ret);
+    }
+    tx_backend_resume();
+    tx_power.since = k_cycle_get_32();
+    tx_power.resumes++;
+  }
+  tx_power.refs++;
+  k_mutex_unlock(&tx_power_lock);
+}
+
+void ir_hal_tx_power_put(void) {
+  k_mutex_lock(&tx_power_lock, K_FOREVER);
+  if (tx_power.refs > 0 && --tx_power.refs == 0) {
+    tx_backend_suspend();
+    tx_hfxo_release();
+    tx_power.powered_us += k_cyc_to_us_floor32(k_cycle_get_32() -
+                                               tx_power.since);
+  }
+  k_mutex_unlock(&tx_power_lock);
+}
+
+/* 记账 - LED导通时间 = mark时长 x 占空比 */
+static void tx_power_account(const ir_timing_t *timings,
+                             const uint16_t *periods, size_t count,
+                             uint32_t carrier_freq, uint8_t duty_cycle) {
+  uint64_t mark_us = 0;
+  uint64_t frame_us = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    uint64_t us = timings ? ir_timing_us(timings[i])
+                          : (uint64_t)periods[i] * USEC_PER_SEC / carrier_freq;
+
+    frame_us += us;
+    if (i % 2 == 0) {
+      mark_us += us;
+    }
+  }
+
+  k_mutex_lock(&tx_power_lock, K_FOREVER);
+  tx_power.frames++;
+  tx_power.airtime_us += frame_us;
+  tx_power.carrier_us += mark_us * tx_duty(duty_cycle) / 100;
+  k_mutex_unlock(&tx_power_lock);
+}
+
+void ir_hal_tx_get_power_stats(ir_hal_tx_power_stats_t *stats) {
+  if (!stats) {
+    return;
+  }
+
+  k_mutex_lock(&tx_power_lock, K_FOREVER);
+  stats->frames = tx_power.frames;
+  stats->resumes = tx_power.resumes;
+  stats->powered_us = tx_power.powered_us;
+  if (tx_power.refs > 0) {
+    stats->powered_us += k_cyc_to_us_floor32(k_cycle_get_32() -
+                                             tx_power.since);
+  }
+  stats->airtime_us = tx_power.airtime_us;
+  stats->carrier_us = tx_power.carrier_us;
+  k_mutex_unlock(&tx_power_lock);
+
+  /* mV x (mA x us + uA x us / 1000) = 1e-12 J */
+  stats->energy_uj =
+      (uint64_t)IR_HAL_TX_SUPPLY_MV *
+      (IR_HAL_TX_LED_MA * stats->carrier_us +
+       IR_HAL_TX_ACTIVE_UA * stats->powered_us / 1000) /
+      1000000;
+}
+
+#ifndef IR_HAL_RX_IPC
+/* 发送开始/结束 - 其间及结束后IR_HAL_RX_ECHO_GUARD_US内为回波窗口 */
+void ir_hal_rx_echo_begin(void) {
+  k_spinlock_key_t key = k_spin_lock(&rx_edge_lock);
+  rx_echo.depth++;
+  k_spin_unlock(&rx_edge_lock, key);
+}
+
+void ir_hal_rx_echo_end(void) {
+  k_spinlock_key_t key = k_spin_lock(&rx_edge_lock);
+  if (rx_echo.depth > 0 && --rx_echo.depth == 0) {
+    rx_echo.until =
+        k_uptime_ticks() + k_us_to_ticks_ceil64(IR_HAL_RX_ECHO_GUARD_US);
+  }
+  k_spin_unlock(&rx_edge_lock, key);
+}
+#endif
+
+/* 启动发送 - 兼容接口，start到stop之间保持上电 */
+int ir_hal_tx_start(uint32_t carrier_freq, uint8_t duty_cycle) {
+  if (carrier_freq == 0) {
+    return -EINVAL;
+  }
+
+  if (!tx_power.legacy) {
+    ir_hal_tx_power_get();
+    ir_hal_rx_echo_begin();
+    tx_power.legacy = true;
+  }
+  return tx_start(carrier_freq, duty_cycle);
+}
+
+/* 停止发送 */
+int ir_hal_tx_stop(void) {
+  int ret = tx_stop();
+
+  if (tx_power.legacy) {
+    tx_power.legacy = false;
+    ir_hal_rx_echo_end();
+    ir_hal_tx_power_put();
+  }
+  return ret;
+}
+
+/* 发送整帧 */
+int ir_hal_tx_frame(const ir_timing_t *timings, size_t count,
+                    uint32_t carrier_freq, uint8_t duty_cycle) {
+  if (!timings || count == 0 || carrier_freq == 0) {
+    return -EINVAL;
+  }
+
+  ir_hal_tx_power_get();
+  ir_hal_rx_echo_begin();
+  int ret = tx_frame(timings, count, carrier_freq, duty_cycle);
+  ir_hal_rx_echo_end();
+  if (ret == 0) {
+    tx_power_account(timings, NULL, count, carrier_freq, duty_cycle);
+  }
+  ir_hal_tx_power_put();
+  return ret;
+}
+
+/* 按载波周期数发送 */
+int ir_hal_tx_periods(const uint16_t *periods, size_t count,
+                      uint32_t carrier_freq, uint8_t duty_cycle) {
+  if (!periods || count == 0 || carrier_freq == 0) {
+    return -EINVAL;
+  }
+
+  ir_hal_tx_power_get();
+  ir_hal_rx_echo_begin();
+  int ret = tx_periods(periods, count, carrier_freq, duty_cycle);
+  ir_hal_rx_echo_end();
+  if (ret == 0) {
+    tx_power_account(NULL, periods, count, carrier_freq, duty_cycle);
+  }
+  ir_hal_tx_power_put();
+  return ret;
+}
+
+/* 多路同时发送 */
+int ir_hal_tx_lanes(const ir_hal_tx_lane_t *lanes, size_t n,
+                    uint32_t carrier_freq, uint8_t duty_cycle) {
+  uint8_t used = 0;
+
+  if (!lanes || n == 0 || n > IR_HAL_TX_CHANNELS || carrier_freq == 0) {
+    return -EINVAL;
+  }
+
+  for (size_t l = 0; l < n; l++) {
+    if (!lanes[l].timings || lanes[l].count == 0 ||
+        lanes[l].channels == 0 || (lanes[l].channels & used) ||
+        (lanes[l].channels & ~IR_HAL_TX_CH_ALL)) {
+      return -EINVAL;
+    }
+    used |= lanes[l].channels;
+  }
+
+  ir_hal_tx_power_get();
+  ir_hal_rx_echo_begin();
+#ifdef IR_HAL_TX_SEQ
+  int ret = tx_lanes(lanes, n, carrier_freq, duty_cycle);
+#else
+  /* 单路后端: 校验后只可能是通道0 */
+  int ret = tx_frame(lanes[0].timings, lanes[0].count, carrier_freq,
+                     duty_cycle);
+#endif
+  ir_hal_rx_echo_end();
+  if (ret == 0) {
+    for (size_t l = 0; l < n; l++) {
+      tx_power_account(lanes[l].timings, NULL, lanes[l].count, carrier_freq,
+                       duty_cycle);
+    }
+  }
+  ir_hal_tx_power_put();
+  return ret;
+}
+
+#ifndef IR_HAL_RX_IPC
+#ifdef IR_HAL_RX_WAKE_OFF
+/* 唤醒帧 - System OFF唤醒时启动早期捕获的帧在通道0首次启动时作为一帧
+ * 入队，时间戳为启动时刻 - 持rx_subs_lock调用 */
+static void rx_wake_replay(rx_channel_t *ch) {
+  const ir_hal_wake_capture_t *cap = ir_hal_wake_take();
+
+  if (!cap) {
+    return;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&rx_edge_lock);
+  rx_push_stamp(ch, 0);
+  for (uint32_t i = 0; i < cap->count; i++) {
+    rx_push_pulse(ch, cap->pulses[i], i % 2 == 0, false);
+  }
+  if (ir_ring_put(&ch->ring, RX_FRAME_END)) {
+    ch->in_frame = false;
+    ch->frame_real = false;
+  }
+  rx_state.wake_frames++;
+  k_spin_unlock(&rx_edge_lock, key);
+  rx_wake();
 }
+#endif
+
+/* 按订阅表的通道并集起停各通道硬件 - 持rx_subs_lock调用 */
+static int rx_apply_channels(void) {
+  uint8_t wanted = 0;
+  uint8_t echo = 0;
+
+  for (size_t s = 0; s < IR_HAL_RX_SUBSCRIBERS; s++) {
+    if (rx_subs[s].callback) {
+      wanted |= rx_subs[s].channels;
+      echo |= rx_subs[s].echo ? rx_subs[s].channels : 0;
+    }
+  }
+  rx_echo.wanted = echo;
+
+  for (size_t i = 0; i < IR_HAL_RX_CHANNELS; i++) {
+    rx_channel_t *ch = &rx_channels[i];
+    bool want = (wanted & BIT(i)) != 0;
+
+    if (want == ch->active) {
+      continue;
+    }
+
+    if (!want) {
+      ch->active = false;
+#ifdef IR_HAL_RX_CAPTURE
+      rx_capture_disable(ch);
+#elif defined(IR_HAL_RX_ADC)
+      rx_adc_disable(ch);
+#else
+      gpio_pin_interrupt_configure_dt(&rx_gpios[i], GPIO_INT_DISABLE);
+#endif
+      continue;
+    }
 
-/* 停止接收 */
-int ir_hal_rx_stop(void) {
-  rx_state.active = false;
-  gpio_pin_interrupt_configure(gpio_dev, IR_RX_PIN, GPIO_INT_DISABLE);
+    ch->last_state = false;
+    ch->has_edge = false;
+    ch->has_pending = false;
+    ch->in_frame = false;
+    ch->frame_real = false;
+    ch->active = true;
 
-  LOG_INF("RX stopped");
+#ifdef IR_HAL_RX_LOWPOWER
+    rx_sense_arm(ch);
+#elif defined(IR_HAL_RX_CAPTURE)
+    rx_capture_enable(ch);
+#elif defined(IR_HAL_RX_ADC)
+    rx_adc_enable(ch);
+#else
+    /* 启用双边沿中断 */
+    int ret =
+        gpio_pin_interrupt_configure_dt(&rx_gpios[i], GPIO_INT_EDGE_BOTH);
+    if (ret < 0) {
+      ch->active = false;
+      return ret;
+    }
+#endif
+#ifdef IR_HAL_RX_WAKE_OFF
+    if (i == 0) {
+      rx_wake_replay(ch);
+    }
+#endif
+  }
   return 0;
-}
\ No newline at end of file
+}
+
+/* 更改订阅的通道 */
+int ir_hal_rx_set_channels(int id, uint8_t channels) {
+  if (id < 0 || id >= IR_HAL_RX_SUBSCRIBERS || channels == 0 ||
+      (channels & ~IR_HAL_RX_CH_ALL)) {
+    return -EINVAL;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&rx_subs_lock);
+  int ret = -ENOENT;
+
+  if (rx_subs[id].callback) {
+    uint8_t previous = rx_subs[id].channels;
+
+    rx_subs[id].channels = channels;
+    ret = rx_apply_channels();
+    if (ret < 0) {
+      rx_subs[id].channels = previous;
+      rx_apply_channels();
+    }
+  }
+  k_spin_unlock(&rx_subs_lock, key);
+
+  if (ret < 0) {
+    LOG_ERR("RX subscriber %d channels 0x%x: %d", id, channels, ret);
+  }
+  return ret;
+}
+
+/* 订阅边沿流 */
+int ir_hal_rx_subscribe(uint8_t channels, ir_rx_callback_t callback,
+                        void *user_data) {
+  if (!callback || channels == 0 || (channels & ~IR_HAL_RX_CH_ALL)) {
+    return -EINVAL;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&rx_subs_lock);
+  int id = -ENOMEM;
+
+  for (size_t s = 0; s < IR_HAL_RX_SUBSCRIBERS; s++) {
+    if (!rx_subs[s].callback) {
+      id = s;
+      break;
+    }
+  }
+
+  if (id >= 0) {
+    rx_subs[id].callback = callback;
+    rx_subs[id].user_data = user_data;
+    rx_subs[id].channels = channels;
+    rx_subs[id].echo = false;
+
+    int ret = rx_apply_channels();
+    if (ret < 0) {
+      rx_subs[id].callback = NULL;
+      rx_apply_channels();
+      id = ret;
+    }
+  }
+  k_spin_unlock(&rx_subs_lock, key);
+
+  if (id < 0) {
+    LOG_ERR("RX subscribe failed: %d", id);
+    return id;
+  }
+
+  LOG_INF("RX subscriber %d on channels 0x%x", id, channels);
+  return id;
+}
+
+/* 取消订阅 */
+int ir_hal_rx_unsubscribe(int id) {
+  if (id < 0 || id >= IR_HAL_RX_SUBSCRIBERS) {
+    return -EINVAL;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&rx_subs_lock);
+  int ret = rx_subs[id].callback ? 0 : -ENOENT;
+
+  rx_subs[id].callback = NULL;
+  rx_subs[id].channels = 0;
+  rx_subs[id].echo = false;
+  rx_apply_channels();
+  k_spin_unlock(&rx_subs_lock, key);
+
+  if (ret == 0) {
+    LOG_INF("RX subscriber %d removed", id);
+  }
+  return ret;
+}
+
+#ifdef IR_HAL_RX_WAKE_OFF
+/* 关机 - 停止各通道的采集，通道0的引脚交回GPIO并挂SENSE(mark拉低唤醒) */
+int ir_hal_rx_poweroff(void) {
+  k_spinlock_key_t key = k_spin_lock(&rx_subs_lock);
+  for (size_t i = 0; i < IR_HAL_RX_CHANNELS; i++) {
+    if (rx_channels[i].active) {
+      rx_channels[i].active = false;
+      rx_capture_disable(&rx_channels[i]);
+    }
+  }
+  k_spin_unlock(&rx_subs_lock, key);
+
+  nrfx_gpiote_pin_uninit(&rx_gpiote, rx_psel[0]);
+  nrf_gpio_cfg_sense_input(rx_psel[0], NRF_GPIO_PIN_PULLUP,
+                           NRF_GPIO_PIN_SENSE_LOW);
+
+  LOG_INF("System OFF, wake on RX pin %u", rx_psel[0]);
+  LOG_PANIC();
+  sys_poweroff();
+}
+#endif
+
+/* 订阅者是否接收回波 */
+int ir_hal_rx_set_echo(int id, bool receive) {
+  if (id < 0 || id >= IR_HAL_RX_SUBSCRIBERS) {
+    return -EINVAL;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&rx_subs_lock);
+  int ret = rx_subs[id].callback ? 0 : -ENOENT;
+
+  if (ret == 0) {
+    rx_subs[id].echo = receive;
+    rx_apply_channels();
+  }
+  k_spin_unlock(&rx_subs_lock, key);
+  return ret;
+}
+
+/* 设置帧间隔 - 下一个边沿起生效 */
+void ir_hal_rx_set_frame_gap(uint32_t gap_us) {
+  if (gap_us == 0) {
+    gap_us = IR_HAL_FRAME_GAP_US;
+  }
+  rx_frame_gap_us = CLAMP(gap_us, IR_HAL_FRAME_GAP_MIN_US, IR_MAX_PULSE_US);
+  LOG_INF("RX frame gap %u us", rx_frame_gap_us);
+}
+
+uint32_t ir_hal_rx_get_frame_gap(void) { return rx_frame_gap_us; }
+
+/* 设置反相通道 - 应在通道启动前设置 */
+void ir_hal_rx_set_inverted(uint8_t channels) {
+  rx_inverted = channels & IR_HAL_RX_CH_ALL;
+}
+
+uint8_t ir_hal_rx_get_inverted(void) { return rx_inverted; }
+
+/* 设置接收头补偿 - 消费线程逐脉冲读取，改动从下一个脉冲起生效 */
+void ir_hal_rx_set_bias(uint8_t channel, int16_t mark_us, int16_t space_us) {
+  if (channel < IR_HAL_RX_CHANNELS) {
+    rx_bias[channel][1] = mark_us;
+    rx_bias[channel][0] = space_us;
+  }
+}
+
+void ir_hal_rx_get_bias(uint8_t channel, int16_t *mark_us, int16_t *space_us) {
+  bool valid = channel < IR_HAL_RX_CHANNELS;
+
+  *mark_us = valid ? rx_bias[channel][1] : 0;
+  *space_us = valid ? rx_bias[channel][0] : 0;
+}
+
+/* 接收头静默的时长 - 正处于mark的通道按0计，其余取最近处理的边沿 */
+uint32_t ir_hal_rx_idle_us(void) {
+  int64_t now = k_uptime_ticks();
+  int64_t last = 0;
+  bool receiving = false;
+
+  k_spinlock_key_t key = k_spin_lock(&rx_edge_lock);
+  for (size_t i = 0; i < IR_HAL_RX_CHANNELS; i++) {
+    const rx_channel_t *ch = &rx_channels[i];
+
+    if (!ch->active) {
+      continue;
+    }
+    receiving = true;
+    if (ch->has_edge) {
+      last = MAX(last, ch->last_state ? ch->last_seen : now);
+    }
+  }
+  k_spin_unlock(&rx_edge_lock, key);
+
+  if (!receiving) {
+    return UINT32_MAX;
+  }
+  return (uint32_t)MIN(k_ticks_to_us_floor64(now - last), UINT32_MAX - 1);
+}
+
+/* 获取RX统计 */
+void ir_hal_rx_get_stats(ir_hal_rx_stats_t *stats) {
+  if (!stats) {
+    return;
+  }
+
+  memset(stats, 0, sizeof(*stats));
+  for (size_t i = 0; i < IR_HAL_RX_CHANNELS; i++) {
+    stats->edges += rx_channels[i].edges;
+    stats->frames += rx_channels[i].frames;
+    stats->glitches += rx_channels[i].glitches;
+    stats->overflows += rx_channels[i].ring.overflows;
+    stats->max_fill = MAX(stats->max_fill, rx_channels[i].max_fill);
+    stats->echo_dropped += rx_channels[i].echo_dropped;
+    stats->echo_tagged += rx_channels[i].echo_tagged;
+  }
+  stats->wakeups = rx_state.wakeups;
+  stats->sense_wakeups = rx_state.sense_wakeups;
+  stats->wake_frames = rx_state.wake_frames;
+}
+#endif /* !IR_HAL_RX_IPC */
@@ -0,0 +1,519 @@
+/**
+ * @file ir_hal_ipc.c
+ * @brief nRF5340应用核的接收接口 - 由网络核的接收引擎采集，经ipc_service
+ *        送回本核分发
+ *
+ * 订阅表和回调语义与ir_hal.c相同: 订阅者的通道并集和回波通道转发给网络
+ * 核，网络核的单个订阅者采集这些通道; 回波是否送达按本地订阅表逐个判断。
+ * 接收配置(通道、帧间隔、反相、补偿)在本地保留一份，由工作队列整体发送，
+ * 订阅类接口因而仍可在ISR中调用，网络核重启(READY)后也按此恢复。
+ */
+
+#include "ir_hal_ipc.h"
+#include <string.h>
+#include <zephyr/ipc/ipc_service.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(ir_hal_ipc, LOG_LEVEL_INF);
+
+#define IPC_NODE DT_NODELABEL(ipc0)
+
+/* 订阅表 - callback为NULL的槽位空闲 */
+typedef struct {
+  ir_rx_callback_t callback;
+  void *user_data;
+  uint8_t channels;
+  bool echo; // 接收回波
+} rx_subscriber_t;
+
+static rx_subscriber_t rx_subs[IR_HAL_RX_SUBSCRIBERS];
+static struct k_spinlock rx_subs_lock; // 订阅表与接收配置，可在ISR中取
+
+/* 网络核上的接收配置 (持rx_subs_lock) */
+typedef struct {
+  uint8_t channels; // 采集的通道
+  uint8_t echo;     // 有订阅者接收回波的通道
+  uint8_t inverted;
+  uint32_t frame_gap_us;
+  int16_t bias[IR_HAL_RX_CHANNELS][2]; // [space, mark]
+} rx_config_t;
+
+static rx_config_t rx_config = {.frame_gap_us = IR_HAL_FRAME_GAP_US};
+
+/* 端点 */
+static struct ipc_ept rx_ept;
+static atomic_t rx_bound;
+static struct k_work rx_config_work;
+
+/* 分发队列 - 端点回调入队(时间戳已换算)，分发线程回调订阅者 */
+K_MSGQ_DEFINE(rx_queue, sizeof(ir_hal_ipc_pulse_t), IR_HAL_IPC_RX_QUEUE, 8);
+
+K_THREAD_STACK_DEFINE(rx_thread_stack, IR_HAL_RX_THREAD_STACK_SIZE);
+static struct k_thread rx_thread;
+
+/* 时间戳换算与统计 (端点回调中更新) */
+static struct {
+  int64_t offset_us; // 本核运行时间 - 网络核运行时间
+  bool synced;
+  uint32_t batches;
+  uint32_t overflows;      // 分发队列满丢弃
+  uint32_t remote_dropped; // 网络核发送失败丢弃
+} rx_link;
+
+/* 回波窗口(本核运行时间) - 开窗请求不等网络核应答，请求到达之前网络核
+ * 已转发的边沿在分发时按时间戳补标为回波 */
+static struct k_spinlock echo_lock;
+static struct {
+  int64_t start_us;
+  int64_t until_us;
+  uint8_t depth;
+} echo_window;
+
+/* 查询 - 同一时刻一个，应答按seq匹配 */
+static K_MUTEX_DEFINE(query_lock);
+static K_SEM_DEFINE(query_done, 0, 1);
+static struct k_spinlock query_spin;
+static struct {
+  uint8_t seq;
+  bool waiting;
+  int32_t ret;
+  void *out;
+  size_t size;
+} query;
+
+static int ept_send(uint8_t op, uint8_t seq, uint32_t arg0, uint32_t arg1) {
+  ir_hal_ipc_req_t req = {
+      .hdr = {.op = op, .seq = seq},
+      .arg = {arg0, arg1},
+  };
+
+  if (!atomic_get(&rx_bound)) {
+    return -ENOTCONN;
+  }
+  int ret = ipc_service_send(&rx_ept, &req, sizeof(req));
+  return ret < 0 ? ret : 0;
+}
+
+/* 同步查询 - 返回网络核的结果，out为应答数据(可为NULL) */
+static int ept_query(uint8_t op, uint32_t arg0, void *out, size_t size) {
+  k_mutex_lock(&query_lock, K_FOREVER);
+
+  k_spinlock_key_t key = k_spin_lock(&query_spin);
+  query.seq++;
+  query.waiting = true;
+  query.ret = -EIO;
+  query.out = out;
+  query.size = size;
+  uint8_t seq = query.seq;
+  k_spin_unlock(&query_spin, key);
+
+  k_sem_reset(&query_done);
+  int ret = ept_send(op, seq, arg0, 0);
+  if (ret == 0) {
+    ret = k_sem_take(&query_done, K_MSEC(IR_HAL_IPC_TIMEOUT_MS)) == 0
+              ? query.ret
+              : -ETIMEDOUT;
+  }
+
+  key = k_spin_lock(&query_spin);
+  query.waiting = false;
+  k_spin_unlock(&query_spin, key);
+
+  k_mutex_unlock(&query_lock);
+  return ret;
+}
+
+/* 整体发送接收配置 - 配置变化、端点绑定和网络核重启时 */
+static void rx_config_handler(struct k_work *work) {
+  k_spinlock_key_t key = k_spin_lock(&rx_subs_lock);
+  rx_config_t config = rx_config;
+  k_spin_unlock(&rx_subs_lock, key);
+
+  if (!atomic_get(&rx_bound)) {
+    return;
+  }
+
+  ept_send(IR_HAL_IPC_FRAME_GAP, 0, config.frame_gap_us, 0);
+  ept_send(IR_HAL_IPC_INVERTED, 0, config.inverted, 0);
+  for (size_t i = 0; i < IR_HAL_RX_CHANNELS; i++) {
+    ept_send(IR_HAL_IPC_BIAS, 0, i,
+             (uint16_t)config.bias[i][1] |
+                 ((uint32_t)(uint16_t)config.bias[i][0] << 16));
+  }
+  int ret = ept_send(IR_HAL_IPC_CHANNELS, 0, config.channels, config.echo);
+  if (ret < 0) {
+    LOG_ERR("RX config to network core: %d", ret);
+  }
+}
+
+/* 脉冲起点(已换算为本核时间)在本地记录的回波窗口内 */
+static bool rx_in_echo_window(uint64_t timestamp_us) {
+  k_spinlock_key_t key = k_spin_lock(&echo_lock);
+  bool in = (int64_t)timestamp_us >= echo_window.start_us &&
+            (echo_window.depth > 0 ||
+             (int64_t)timestamp_us < echo_window.until_us);
+  k_spin_unlock(&echo_lock, key);
+  return in;
+}
+
+/* 边沿批次 - 换算时间戳后入队 */
+static void rx_batch(const ir_hal_ipc_batch_t *batch, size_t len) {
+  if (len < sizeof(*batch) ||
+      len < sizeof(*batch) + batch->hdr.count * sizeof(ir_hal_ipc_pulse_t)) {
+    return;
+  }
+
+  /* 传输延迟最小的一次最接近真实的时钟差 */
+  int64_t offset = k_ticks_to_us_floor64(k_uptime_ticks()) - batch->sent_us;
+  if (!rx_link.synced || offset < rx_link.offset_us) {
+    rx_link.offset_us = offset;
+    rx_link.synced = true;
+  }
+  rx_link.batches++;
+  rx_link.remote_dropped = batch->dropped;
+
+  for (size_t i = 0; i < batch->hdr.count; i++) {
+    ir_hal_ipc_pulse_t pulse = batch->pulses[i];
+
+    pulse.timestamp_us += rx_link.offset_us;
+    if (k_msgq_put(&rx_queue, &pulse, K_NO_WAIT) < 0) {
+      rx_link.overflows++;
+    }
+  }
+}
+
+/* 查询应答 */
+static void rx_reply(const ir_hal_ipc_reply_t *reply, size_t len) {
+  if (len < sizeof(*reply) || len < sizeof(*reply) + reply->hdr.count) {
+    return;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&query_spin);
+  if (query.waiting && reply->hdr.seq == query.seq) {
+    if (query.out) {
+      memcpy(query.out, reply->data, MIN(query.size, reply->hdr.count));
+    }
+    query.ret = reply->ret;
+    query.waiting = false;
+    k_sem_give(&query_done);
+  }
+  k_spin_unlock(&query_spin, key);
+}
+
+static void ept_received(const void *data, size_t len, void *priv) {
+  const ir_hal_ipc_hdr_t *hdr = data;
+
+  if (len < sizeof(*hdr)) {
+    return;
+  }
+
+  switch (hdr->op) {
+  case IR_HAL_IPC_PULSES:
+    rx_batch(data, len);
+    break;
+  case IR_HAL_IPC_REPLY:
+    rx_reply(data, len);
+    break;
+  case IR_HAL_IPC_READY:
+    /* 网络核重启: 时钟差重新测定，接收配置重发 */
+    LOG_INF("Network core RX engine ready");
+    rx_link.synced = false;
+    k_work_submit(&rx_config_work);
+    break;
+  default:
+    break;
+  }
+}
+
+static void ept_bound(void *priv) {
+  atomic_set(&rx_bound, 1);
+  LOG_INF("RX endpoint bound");
+  k_work_submit(&rx_config_work);
+}
+
+static struct ipc_ept_cfg rx_ept_cfg = {
+    .name = IR_HAL_IPC_ENDPOINT,
+    .cb =
+        {
+            .bound = ept_bound,
+            .received = ept_received,
+        },
+};
+
+/* 分发线程 - 与ir_hal.c的消费线程相同，订阅表每个脉冲取一次快照 */
+static void rx_thread_entry(void *p1, void *p2, void *p3) {
+  rx_subscriber_t subs[IR_HAL_RX_SUBSCRIBERS];
+  ir_hal_ipc_pulse_t in;
+
+  while (1) {
+    k_msgq_get(&rx_queue, &in, K_FOREVER);
+
+    k_spinlock_key_t key = k_spin_lock(&rx_subs_lock);
+    memcpy(subs, rx_subs, sizeof(subs));
+    uint8_t channels = rx_config.channels;
+    k_spin_unlock(&rx_subs_lock, key);
+
+    if (in.channel >= IR_HAL_RX_CHANNELS || !(channels & BIT(in.channel))) {
+      continue;
+    }
+
+    bool echo = (in.flags & IR_HAL_IPC_ECHO) != 0 ||
+                rx_in_echo_window(in.timestamp_us);
+    ir_pulse_t pulse = {
+        .duration_us = in.duration_us,
+        .is_mark = (in.flags & IR_HAL_IPC_MARK) != 0,
+        .channel = in.channel,
+        .timestamp_us = in.timestamp_us,
+        .frame_end = (in.flags & IR_HAL_IPC_FRAME_END) != 0,
+        .echo = echo,
+    };
+
+    for (size_t s = 0; s < ARRAY_SIZE(subs); s++) {
+      if (subs[s].callback && (subs[s].channels & BIT(in.channel)) &&
+          (!echo || subs[s].echo)) {
+        subs[s].callback(&pulse, subs[s].user_data);
+      }
+    }
+  }
+}
+
+int ir_hal_ipc_init(void) {
+  const struct device *ipc = DEVICE_DT_GET(IPC_NODE);
+
+  k_work_init(&rx_config_work, rx_config_handler);
+
+  int ret = ipc_service_open_instance(ipc);
+  if (ret < 0 && ret != -EALREADY) {
+    LOG_ERR("Failed to open IPC instance: %d", ret);
+    return ret;
+  }
+
+  /* 绑定是异步的: 之前的订阅在绑定后随接收配置一并发出 */
+  ret = ipc_service_register_endpoint(ipc, &rx_ept, &rx_ept_cfg);
+  if (ret < 0) {
+    LOG_ERR("Failed to register RX endpoint: %d", ret);
+    return ret;
+  }
+
+  k_thread_create(&rx_thread, rx_thread_stack,
+                  K_THREAD_STACK_SIZEOF(rx_thread_stack), rx_thread_entry, NULL,
+                  NULL, NULL, K_PRIO_PREEMPT(IR_HAL_RX_THREAD_PRIORITY), 0,
+                  K_NO_WAIT);
+  k_thread_name_set(&rx_thread, "ir_rx");
+
+  LOG_INF("RX on network core, %u channel(s)", IR_HAL_RX_CHANNELS);
+  return 0;
+}
+
+/* 回波窗口 - 本地记下起点后只发出开窗请求，发送不等IPC往返。网络核
+ * 开窗之前的边沿由分发线程按时间戳补标 */
+void ir_hal_rx_echo_begin(void) {
+  k_spinlock_key_t key = k_spin_lock(&echo_lock);
+  if (echo_window.depth++ == 0) {
+    echo_window.start_us = k_ticks_to_us_floor64(k_uptime_ticks());
+  }
+  k_spin_unlock(&echo_lock, key);
+
+  ept_send(IR_HAL_IPC_ECHO_BEGIN, 0, 0, 0);
+}
+
+void ir_hal_rx_echo_end(void) {
+  k_spinlock_key_t key = k_spin_lock(&echo_lock);
+  if (echo_window.depth > 0 && --echo_window.depth == 0) {
+    echo_window.until_us =
+        k_ticks_to_us_floor64(k_uptime_ticks()) + IR_HAL_RX_ECHO_GUARD_US;
+  }
+  k_spin_unlock(&echo_lock, key);
+
+  ept_send(IR_HAL_IPC_ECHO_END, 0, 0, 0);
+}
+
+/* 按订阅表更新通道与回波掩码 - 持rx_subs_lock调用 */
+static void rx_apply_channels(void) {
+  uint8_t wanted = 0;
+  uint8_t echo = 0;
+
+  for (size_t s = 0; s < IR_HAL_RX_SUBSCRIBERS; s++) {
+    if (rx_subs[s].callback) {
+      wanted |= rx_subs[s].channels;
+      echo |= rx_subs[s].echo ? rx_subs[s].channels : 0;
+    }
+  }
+
+  if (wanted != rx_config.channels || echo != rx_config.echo) {
+    rx_config.channels = wanted;
+    rx_config.echo = echo;
+    k_work_submit(&rx_config_work);
+  }
+}
+
+int ir_hal_rx_set_channels(int id, uint8_t channels) {
+  if (id < 0 || id >= IR_HAL_RX_SUBSCRIBERS || channels == 0 ||
+      (channels & ~IR_HAL_RX_CH_ALL)) {
+    return -EINVAL;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&rx_subs_lock);
+  int ret = -ENOENT;
+
+  if (rx_subs[id].callback) {
+    rx_subs[id].channels = channels;
+    rx_apply_channels();
+    ret = 0;
+  }
+  k_spin_unlock(&rx_subs_lock, key);
+  return ret;
+}
+
+int ir_hal_rx_subscribe(uint8_t channels, ir_rx_callback_t callback,
+                        void *user_data) {
+  if (!callback || channels == 0 || (channels & ~IR_HAL_RX_CH_ALL)) {
+    return -EINVAL;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&rx_subs_lock);
+  int id = -ENOMEM;
+
+  for (size_t s = 0; s < IR_HAL_RX_SUBSCRIBERS; s++) {
+    if (!rx_subs[s].callback) {
+      id = s;
+      break;
+    }
+  }
+
+  if (id >= 0) {
+    rx_subs[id].callback = callback;
+    rx_subs[id].user_data = user_data;
+    rx_subs[id].channels = channels;
+    rx_subs[id].echo = false;
+    rx_apply_channels();
+  }
+  k_spin_unlock(&rx_subs_lock, key);
+
+  if (id < 0) {
+    LOG_ERR("RX subscribe failed: %d", id);
+    return id;
+  }
+
+  LOG_INF("RX subscriber %d on channels 0x%x", id, channels);
+  return id;
+}
+
+int ir_hal_rx_unsubscribe(int id) {
+  if (id < 0 || id >= IR_HAL_RX_SUBSCRIBERS) {
+    return -EINVAL;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&rx_subs_lock);
+  int ret = rx_subs[id].callback ? 0 : -ENOENT;
+
+  rx_subs[id].callback = NULL;
+  rx_subs[id].channels = 0;
+  rx_subs[id].echo = false;
+  rx_apply_channels();
+  k_spin_unlock(&rx_subs_lock, key);
+
+  if (ret == 0) {
+    LOG_INF("RX subscriber %d removed", id);
+  }
+  return ret;
+}
+
+int ir_hal_rx_set_echo(int id, bool receive) {
+  if (id < 0 || id >= IR_HAL_RX_SUBSCRIBERS) {
+    return -EINVAL;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&rx_subs_lock);
+  int ret = rx_subs[id].callback ? 0 : -ENOENT;
+
+  if (ret == 0) {
+    rx_subs[id].echo = receive;
+    rx_apply_channels();
+  }
+  k_spin_unlock(&rx_subs_lock, key);
+  return ret;
+}
+
+void ir_hal_rx_set_frame_gap(uint32_t gap_us) {
+  if (gap_us == 0) {
+    gap_us = IR_HAL_FRAME_GAP_US;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&rx_subs_lock);
+  rx_config.frame_gap_us =
+      CLAMP(gap_us, IR_HAL_FRAME_GAP_MIN_US, IR_MAX_PULSE_US);
+  k_spin_unlock(&rx_subs_lock, key);
+
+  k_work_submit(&rx_config_work);
+  LOG_INF("RX frame gap %u us", rx_config.frame_gap_us);
+}
+
+uint32_t ir_hal_rx_get_frame_gap(void) { return rx_config.frame_gap_us; }
+
+void ir_hal_rx_set_inverted(uint8_t channels) {
+  k_spinlock_key_t key = k_spin_lock(&rx_subs_lock);
+  rx_config.inverted = channels & IR_HAL_RX_CH_ALL;
+  k_spin_unlock(&rx_subs_lock, key);
+
+  k_work_submit(&rx_config_work);
+}
+
+uint8_t ir_hal_rx_get_inverted(void) { return rx_config.inverted; }
+
+/* 补偿在网络核的消费线程中施加，本地一份供读取 */
+void ir_hal_rx_set_bias(uint8_t channel, int16_t mark_us, int16_t space_us) {
+  if (channel >= IR_HAL_RX_CHANNELS) {
+    return;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&rx_subs_lock);
+  rx_config.bias[channel][1] = mark_us;
+  rx_config.bias[channel][0] = space_us;
+  k_spin_unlock(&rx_subs_lock, key);
+
+  k_work_submit(&rx_config_work);
+}
+
+void ir_hal_rx_get_bias(uint8_t channel, int16_t *mark_us, int16_t *space_us) {
+  bool valid = channel < IR_HAL_RX_CHANNELS;
+
+  *mark_us = valid ? rx_config.bias[channel][1] : 0;
+  *space_us = valid ? rx_config.bias[channel][0] : 0;
+}
+
+/* 静默时长 - 网络核不可达时无从判断 */
+uint32_t ir_hal_rx_idle_us(void) {
+  uint32_t idle_us;
+
+  if (ept_query(IR_HAL_IPC_IDLE, 0, &idle_us, sizeof(idle_us)) < 0) {
+    return UINT32_MAX;
+  }
+  return idle_us;
+}
+
+/* 统计 - 网络核的统计加上本核分发队列和链路的丢弃 */
+void ir_hal_rx_get_stats(ir_hal_rx_stats_t *stats) {
+  if (!stats) {
+    return;
+  }
+
+  memset(stats, 0, sizeof(*stats));
+  if (ept_query(IR_HAL_IPC_STATS, 0, stats, sizeof(*stats)) < 0) {
+    memset(stats, 0, sizeof(*stats));
+  }
+  stats->overflows += rx_link.overflows + rx_link.remote_dropped;
+}
+
+int ir_hal_carrier_start(void) {
+  return ept_query(IR_HAL_IPC_CARRIER_START, 0, NULL, 0);
+}
+
+int ir_hal_carrier_read(uint32_t mark_us, ir_carrier_t *carrier) {
+  return ept_query(IR_HAL_IPC_CARRIER_READ, mark_us, carrier,
+                   sizeof(*carrier));
+}
+
+int ir_hal_carrier_stop(void) {
+  return ept_query(IR_HAL_IPC_CARRIER_STOP, 0, NULL, 0);
+}
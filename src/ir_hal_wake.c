@@ -0,0 +1,155 @@
+/**
+ * @file ir_hal_wake.c
+ * @brief System OFF红外唤醒 - EARLY初始化级轮询硬件锁存的边沿时间戳
+ *
+ * 此时内核尚未初始化: 不能用中断、日志和nrfx驱动，直接操作寄存器。
+ */
+
+#include "ir_hal_wake.h"
+#include <hal/nrf_gpio.h>
+#include <hal/nrf_gpiote.h>
+#include <hal/nrf_power.h>
+#include <hal/nrf_ppi.h>
+#include <hal/nrf_timer.h>
+#include <zephyr/init.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(ir_hal_wake, LOG_LEVEL_INF);
+
+/* 借用的资源 - 捕获后端在ir_hal_init()中才分配，用完即恢复复位状态 */
+#define WAKE_TIMER NRF_TIMER1
+#define WAKE_GPIOTE_CH 7
+#define WAKE_PPI_CH 19
+#define WAKE_EDGE_CC NRF_TIMER_CC_CHANNEL0 // 边沿锁存
+#define WAKE_NOW_CC NRF_TIMER_CC_CHANNEL1  // 轮询时读当前计数
+
+static ir_hal_wake_capture_t wake_capture;
+static bool wake_ready; // 捕获到了帧，尚未取走
+
+static void wake_hw_start(void) {
+  nrf_gpiote_event_t event = nrf_gpiote_in_event_get(WAKE_GPIOTE_CH);
+
+  nrf_gpio_cfg_input(IR_HAL_RX_WAKE_PSEL, NRF_GPIO_PIN_PULLUP);
+
+  nrf_timer_mode_set(WAKE_TIMER, NRF_TIMER_MODE_TIMER);
+  nrf_timer_bit_width_set(WAKE_TIMER, NRF_TIMER_BIT_WIDTH_32);
+  nrf_timer_prescaler_set(
+      WAKE_TIMER,
+      NRF_TIMER_PRESCALER_CALCULATE(NRF_TIMER_BASE_FREQUENCY_GET(WAKE_TIMER),
+                                    IR_TIMER_FREQ));
+  nrf_timer_task_trigger(WAKE_TIMER, NRF_TIMER_TASK_CLEAR);
+
+  nrf_gpiote_event_configure(NRF_GPIOTE, WAKE_GPIOTE_CH, IR_HAL_RX_WAKE_PSEL,
+                             NRF_GPIOTE_POLARITY_TOGGLE);
+  nrf_gpiote_event_enable(NRF_GPIOTE, WAKE_GPIOTE_CH);
+  nrf_gpiote_event_clear(NRF_GPIOTE, event);
+
+  nrf_ppi_channel_endpoint_setup(
+      NRF_PPI, WAKE_PPI_CH, nrf_gpiote_event_address_get(NRF_GPIOTE, event),
+      nrf_timer_task_address_get(WAKE_TIMER,
+                                 nrf_timer_capture_task_get(WAKE_EDGE_CC)));
+  nrf_ppi_channel_enable(NRF_PPI, WAKE_PPI_CH);
+
+  nrf_timer_task_trigger(WAKE_TIMER, NRF_TIMER_TASK_START);
+}
+
+static void wake_hw_stop(void) {
+  nrf_ppi_channel_disable(NRF_PPI, WAKE_PPI_CH);
+  nrf_ppi_channel_endpoint_setup(NRF_PPI, WAKE_PPI_CH, 0, 0);
+  nrf_gpiote_te_default(NRF_GPIOTE, WAKE_GPIOTE_CH);
+  nrf_gpiote_event_clear(NRF_GPIOTE, nrf_gpiote_in_event_get(WAKE_GPIOTE_CH));
+
+  nrf_timer_task_trigger(WAKE_TIMER, NRF_TIMER_TASK_STOP);
+  nrf_timer_task_trigger(WAKE_TIMER, NRF_TIMER_TASK_CLEAR);
+  nrf_timer_task_trigger(WAKE_TIMER, NRF_TIMER_TASK_SHUTDOWN);
+  nrf_timer_cc_set(WAKE_TIMER, WAKE_EDGE_CC, 0);
+  nrf_timer_cc_set(WAKE_TIMER, WAKE_NOW_CC, 0);
+}
+
+static uint32_t wake_now(void) {
+  nrf_timer_task_trigger(WAKE_TIMER, nrf_timer_capture_task_get(WAKE_NOW_CC));
+  return nrf_timer_cc_get(WAKE_TIMER, WAKE_NOW_CC);
+}
+
+/* 轮询边沿直到帧结束 - 边沿时刻由PPI锁存，轮询的快慢不影响时长。开始
+ * 时处于mark即为唤醒帧的引导码，否则跳过残帧，静默满帧间隔之后的下降沿
+ * 为下一帧的起点 */
+static void wake_poll(void) {
+  nrf_gpiote_event_t event = nrf_gpiote_in_event_get(WAKE_GPIOTE_CH);
+  ir_hal_wake_capture_t *cap = &wake_capture;
+  bool started = nrf_gpio_pin_read(IR_HAL_RX_WAKE_PSEL) == 0;
+  uint32_t last = 0;
+  uint32_t lead = started ? IR_HAL_RX_WAKE_LATENCY_US : 0;
+
+  cap->missed = !started;
+
+  while (1) {
+    if (nrf_gpiote_event_check(NRF_GPIOTE, event)) {
+      nrf_gpiote_event_clear(NRF_GPIOTE, event);
+      uint32_t edge = nrf_timer_cc_get(WAKE_TIMER, WAKE_EDGE_CC);
+
+      if (!started) {
+        started = edge - last >= IR_HAL_FRAME_GAP_US &&
+                  nrf_gpio_pin_read(IR_HAL_RX_WAKE_PSEL) == 0;
+      } else if (cap->count < IR_HAL_RX_WAKE_PULSES) {
+        cap->pulses[cap->count++] = MIN(edge - last + lead, IR_MAX_PULSE_US);
+        lead = 0;
+      } else {
+        cap->truncated = true;
+      }
+      last = edge;
+      continue;
+    }
+
+    uint32_t now = wake_now();
+    if (started ? now - last >= IR_HAL_FRAME_GAP_US
+                : now >= IR_HAL_RX_WAKE_WAIT_MS * USEC_PER_MSEC) {
+      break;
+    }
+  }
+
+  /* 帧以mark结束，末尾的静默不是脉冲 */
+  if (cap->count % 2 == 0 && cap->count > 0 && !cap->truncated) {
+    cap->count--;
+  }
+}
+
+/* 复位原因为System OFF唤醒、且是RX引脚唤醒时捕获一帧 */
+static int wake_capture_init(void) {
+  uint32_t reason = nrf_power_resetreas_get(NRF_POWER);
+  uint32_t psel = IR_HAL_RX_WAKE_PSEL;
+
+  if (!(reason & NRF_POWER_RESETREAS_OFF_MASK)) {
+    return 0;
+  }
+  /* 复位原因逐位累积，清掉本位，之后的其他复位不会误判 */
+  nrf_power_resetreas_clear(NRF_POWER, NRF_POWER_RESETREAS_OFF_MASK);
+
+  bool latched = nrf_gpio_pin_latch_get(psel);
+  nrf_gpio_pin_latch_clear(psel);
+  nrf_gpio_cfg_sense_set(psel, NRF_GPIO_PIN_NOSENSE);
+  if (!latched && nrf_gpio_pin_read(psel) != 0) {
+    return 0; // 其他唤醒源
+  }
+
+  wake_hw_start();
+  wake_poll();
+  wake_hw_stop();
+
+  wake_ready = wake_capture.count > 0;
+  return 0;
+}
+
+SYS_INIT(wake_capture_init, EARLY, 0);
+
+const ir_hal_wake_capture_t *ir_hal_wake_take(void) {
+  if (!wake_ready) {
+    return NULL;
+  }
+  wake_ready = false;
+
+  LOG_INF("Woken by IR: %u pulses captured at boot%s%s", wake_capture.count,
+          wake_capture.missed ? " (first frame missed)" : "",
+          wake_capture.truncated ? " (truncated)" : "");
+  return &wake_capture;
+}
@@ -0,0 +1,373 @@
+/**
+ * @file ir_infer.c
+ * @brief 未知协议推断 - 直方图聚类与位编码判别
+ */
+
+#include "ir_infer.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(ir_infer, LOG_LEVEL_INF);
+
+#define INFER_FRAME_GAP_US 8000 // 超过此长度的space视为帧间隔(同学习模块)
+#define INFER_CLUSTER_MIN_US 60 // 聚类容差下限，覆盖接收头的固定抖动
+#define INFER_MATCH_MIN_US 120  // 重新编码比对的容差下限
+#define INFER_MAX_CLUSTERS 4
+#define INFER_FRAME_MAX (2 * IR_INFER_MAX_BITS + 4) // 引导码+数据位+结束标记
+#define INFER_DUTY_CYCLE 33
+
+/* 时长类 - 按升序排列 */
+typedef struct {
+  uint32_t sum;
+  uint16_t count;
+} infer_cluster_t;
+
+static inline uint32_t cluster_center(const infer_cluster_t *c) {
+  return c->sum / c->count;
+}
+
+/* 重新编码的时长是否吻合: 25%，不小于INFER_MATCH_MIN_US */
+static bool infer_close(uint32_t measured, uint32_t expected) {
+  uint32_t tolerance = MAX(expected / 4, INFER_MATCH_MIN_US);
+  uint32_t diff =
+      measured > expected ? measured - expected : expected - measured;
+  return diff <= tolerance;
+}
+
+/* 直方图聚类 - 取[from, to)中每隔step个的时长排序后从短到长扫描，
+ * 与前一个时长相差超过其25%(不小于INFER_CLUSTER_MIN_US)即开新类:
+ * 同一类的抖动连成一片，类之间是直方图上的空档。
+ * 返回类数，超过INFER_MAX_CLUSTERS返回-1 */
+static int infer_cluster(const ir_timing_t *timings, uint16_t from,
+                         uint16_t to, uint16_t step,
+                         infer_cluster_t clusters[INFER_MAX_CLUSTERS]) {
+  uint16_t values[INFER_FRAME_MAX];
+  uint16_t n = 0;
+
+  for (uint16_t i = from; i < to; i += step) {
+    uint16_t v = ir_timing_us(timings[i]);
+    uint16_t j = n++;
+
+    /* 插入排序，帧内最多百来个时长 */
+    while (j > 0 && values[j - 1] > v) {
+      values[j] = values[j - 1];
+      j--;
+    }
+    values[j] = v;
+  }
+
+  int count = 0;
+  for (uint16_t i = 0; i < n; i++) {
+    infer_cluster_t *c = count > 0 ? &clusters[count - 1] : NULL;
+
+    if (!c || values[i] - values[i - 1] >
+                  MAX(values[i - 1] / 4, INFER_CLUSTER_MIN_US)) {
+      if (count == INFER_MAX_CLUSTERS) {
+        return -1;
+      }
+      c = &clusters[count++];
+      c->sum = 0;
+      c->count = 0;
+    }
+    c->sum += values[i];
+    c->count++;
+  }
+  return count;
+}
+
+/* 码字拆成设备码/子设备码/功能码，各不超过16位 (先发位在高位) */
+static void infer_split(uint64_t code, uint8_t bits,
+                        irdb_protocol_params_t *params, irdb_entry_t *entry) {
+  params->function_bits = MIN(bits, 16);
+  params->subdevice_bits = MIN(bits - params->function_bits, 16);
+  params->device_bits =
+      bits - params->function_bits - params->subdevice_bits;
+
+  memset(entry, 0, sizeof(*entry));
+  entry->name = IRDB_NAME_NONE;
+  entry->function = code & BIT_MASK(params->function_bits);
+  code >>= params->function_bits;
+  entry->subdevice = code & BIT_MASK(params->subdevice_bits);
+  code >>= params->subdevice_bits;
+  entry->device = code;
+}
+
+/* 脉冲距离/脉冲宽度 - s为数据起点(有引导码时为2)，返回码字位数 */
+static int infer_pulse(const ir_timing_t *timings, uint16_t n, uint16_t s,
+                       irdb_protocol_params_t *params, uint64_t *code) {
+  infer_cluster_t marks[INFER_MAX_CLUSTERS];
+  infer_cluster_t spaces[INFER_MAX_CLUSTERS];
+  int mark_count = infer_cluster(timings, s, n, 2, marks);
+  int space_count = infer_cluster(timings, s + 1, n, 2, spaces);
+  uint16_t first, bits;
+  uint32_t threshold;
+
+  if (mark_count == 1 && space_count == 2 &&
+      cluster_center(&spaces[1]) >= cluster_center(&spaces[0]) * 3 / 2) {
+    /* 脉冲距离: 每位mark+space，末尾一个结束标记 */
+    params->coding = IRDB_CODING_PULSE_DISTANCE;
+    params->bit_mark = cluster_center(&marks[0]);
+    params->bit_0_space = cluster_center(&spaces[0]);
+    params->bit_1_space = cluster_center(&spaces[1]);
+    params->trailer_mark = params->bit_mark;
+    threshold = (params->bit_0_space + params->bit_1_space) / 2;
+    first = s + 1;
+    bits = (n - s - 1) / 2;
+  } else if (mark_count == 2 && space_count == 1 &&
+             cluster_center(&marks[1]) >= cluster_center(&marks[0]) * 3 / 2) {
+    /* 脉冲宽度: 末位的space并入帧间隔 */
+    params->coding = IRDB_CODING_PULSE_WIDTH;
+    params->bit_mark = cluster_center(&marks[1]);
+    params->bit_0_space = cluster_center(&spaces[0]);
+    params->bit_1_space = params->bit_0_space;
+    threshold = (cluster_center(&marks[0]) + params->bit_mark) / 2;
+    first = s;
+    bits = (n - s + 1) / 2;
+  } else {
+    return -ENOENT;
+  }
+
+  if (bits < IR_INFER_MIN_BITS || bits > IR_INFER_MAX_BITS) {
+    return -ENOENT;
+  }
+
+  if (s > 0) {
+    params->header_mark = ir_timing_us(timings[0]);
+    params->header_space = ir_timing_us(timings[1]);
+  }
+
+  *code = 0;
+  for (uint16_t i = 0; i < bits; i++) {
+    *code = (*code << 1) | (ir_timing_us(timings[first + 2 * i]) > threshold);
+  }
+  return bits;
+}
+
+/* 双相 - 时长为T或2T，展开成半位电平后两两成对: space-mark为1，
+ * mark-space为0。帧首1的前半个space和帧尾0的后半个space已并入帧间
+ * 静默，lead为true时补回帧首的space */
+static int infer_biphase(const ir_timing_t *timings, uint16_t n, bool lead,
+                         irdb_protocol_params_t *params, uint64_t *code) {
+  infer_cluster_t levels[INFER_MAX_CLUSTERS];
+  int count = infer_cluster(timings, 0, n, 1, levels);
+
+  if (count < 1 || count > 2) {
+    return -ENOENT;
+  }
+
+  uint32_t t = cluster_center(&levels[0]);
+  if (count == 2 && !infer_close(cluster_center(&levels[1]), 2 * t)) {
+    return -ENOENT;
+  }
+
+  bool half[2 * IR_INFER_MAX_BITS];
+  uint16_t halves = 0;
+
+  if (lead) {
+    half[halves++] = false;
+  }
+  for (uint16_t i = 0; i < n; i++) {
+    uint8_t units = ir_timing_us(timings[i]) > t * 3 / 2 ? 2 : 1;
+
+    for (uint8_t u = 0; u < units; u++) {
+      if (halves == ARRAY_SIZE(half)) {
+        return -ENOENT;
+      }
+      half[halves++] = (i & 1) == 0; // 偶数下标为mark
+    }
+  }
+  if (halves & 1) {
+    half[halves++] = false;
+  }
+
+  uint16_t bits = halves / 2;
+  if (bits < IR_INFER_MIN_BITS) {
+    return -ENOENT;
+  }
+
+  *code = 0;
+  for (uint16_t i = 0; i < bits; i++) {
+    if (half[2 * i] == half[2 * i + 1]) {
+      return -ENOENT; // 同电平三个半位，不是曼彻斯特编码
+    }
+    *code = (*code << 1) | half[2 * i + 1];
+  }
+
+  params->coding = IRDB_CODING_BIPHASE;
+  params->bit_mark = t;
+  return bits;
+}
+
+/* 重新编码首帧并与录制逐个比对。以space结尾的编码(脉冲宽度)多出的
+ * 末位space不比较 */
+static bool infer_verify(const ir_timing_t *timings, uint16_t n,
+                         const irdb_protocol_params_t *params,
+                         const irdb_entry_t *code) {
+  ir_timing_t encoded[INFER_FRAME_MAX + 1];
+  uint32_t len = 0;
+
+  if (irdb_encode_params(params, code, 0, encoded, &len,
+                         ARRAY_SIZE(encoded)) < 0 ||
+      (len != n && !(len == n + 1U && (len & 1) == 0))) {
+    return false;
+  }
+
+  for (uint16_t i = 0; i < n; i++) {
+    if (!infer_close(ir_timing_us(timings[i]), ir_timing_us(encoded[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* 按一种假设推断首帧: 0/1为脉冲编码无/有引导码，2/3为双相不补/补帧首 */
+static bool infer_frame(const ir_timing_t *timings, uint16_t n,
+                        uint8_t variant, ir_infer_result_t *result) {
+  irdb_protocol_params_t *params = &result->params;
+  uint64_t code;
+  int bits;
+
+  memset(params, 0, sizeof(*params));
+  if (variant < 2) {
+    bits = infer_pulse(timings, n, variant ? 2 : 0, params, &code);
+  } else {
+    bits = infer_biphase(timings, n, variant == 3, params, &code);
+  }
+  if (bits < 0) {
+    return false;
+  }
+
+  result->bits = bits;
+  infer_split(code, bits, params, &result->code);
+  return infer_verify(timings, n, params, &result->code);
+}
+
+/* 首帧之后的帧须与首帧吻合，返回总帧数，首个帧间隔折算为params.gap */
+static int infer_repeats(const ir_timing_t *timings, uint16_t count,
+                         uint16_t n, irdb_protocol_params_t *params) {
+  uint32_t frame_us = 0;
+  uint8_t frames = 1;
+
+  for (uint16_t i = 0; i < n; i++) {
+    frame_us += ir_timing_us(timings[i]);
+  }
+
+  /* pos指向帧后的space，最后一个space(录制以space结尾)不算帧 */
+  for (uint16_t pos = n; pos + 1 < count; pos += n + 1) {
+    if (pos + 1 + n > count || frames == IR_INFER_MAX_FRAMES) {
+      return -ENOENT;
+    }
+    if (ir_timing_us(timings[pos]) < INFER_FRAME_GAP_US) {
+      return -ENOENT;
+    }
+    for (uint16_t i = 0; i < n; i++) {
+      if (!infer_close(ir_timing_us(timings[pos + 1 + i]),
+                       ir_timing_us(timings[i]))) {
+        return -ENOENT;
+      }
+    }
+    if (frames == 1) {
+      params->gap = frame_us + ir_timing_us(timings[pos]);
+    }
+    frames++;
+  }
+  return frames;
+}
+
+int ir_infer_protocol(const ir_timing_t *timings, uint16_t count,
+                      uint32_t carrier_freq, ir_infer_result_t *result) {
+  if (!timings || !result || count == 0) {
+    return -EINVAL;
+  }
+
+  /* 首帧 - 第一个帧间隔之前，以mark结尾 */
+  uint16_t n = count - ((count & 1) == 0);
+  for (uint16_t i = 1; i < count; i += 2) {
+    if (ir_timing_us(timings[i]) >= INFER_FRAME_GAP_US) {
+      n = i;
+      break;
+    }
+  }
+  if (n > INFER_FRAME_MAX) {
+    return -ENOENT;
+  }
+
+  uint8_t variant;
+  for (variant = 0; variant < 4; variant++) {
+    if (infer_frame(timings, n, variant, result)) {
+      break;
+    }
+  }
+  if (variant == 4) {
+    return -ENOENT;
+  }
+
+  int frames = infer_repeats(timings, count, n, &result->params);
+  if (frames < 0) {
+    return frames;
+  }
+
+  result->params.name = "inferred";
+  result->params.frequency = carrier_freq > 0 ? carrier_freq : 38000;
+  result->params.duty_cycle = INFER_DUTY_CYCLE;
+  result->frames = frames;
+  result->frame_length = n;
+
+  LOG_DBG("Inferred %s, %u bits x%u",
+          ir_infer_coding_name(result->params.coding), result->bits,
+          result->frames);
+  return 0;
+}
+
+int ir_infer_encode(const ir_infer_result_t *result, ir_timing_t *timings_out,
+                    uint32_t *length_out, uint32_t max_length) {
+  if (!result || !timings_out || !length_out || result->frames == 0) {
+    return -EINVAL;
+  }
+
+  uint32_t len = 0;
+  int ret = irdb_encode_params(&result->params, &result->code, 0, timings_out,
+                               &len, max_length);
+  if (ret < 0) {
+    return ret;
+  }
+  if ((len & 1) == 0) {
+    len--; // 末位space并入帧间隔
+  }
+
+  uint32_t frame_us = 0;
+  for (uint32_t i = 0; i < len; i++) {
+    frame_us += ir_timing_us(timings_out[i]);
+  }
+
+  uint32_t total = (len + 1) * result->frames - 1;
+  if (total > max_length) {
+    return -ENOMEM;
+  }
+
+  uint32_t gap = result->params.gap > frame_us + INFER_FRAME_GAP_US
+                     ? result->params.gap - frame_us
+                     : INFER_FRAME_GAP_US;
+  for (uint32_t pos = len; pos < total; pos += len + 1) {
+    timings_out[pos] = ir_timing_pack(gap);
+    memcpy(&timings_out[pos + 1], timings_out, len * sizeof(ir_timing_t));
+  }
+
+  *length_out = total;
+  return 0;
+}
+
+const char *ir_infer_coding_name(uint8_t coding) {
+  switch (coding) {
+  case IRDB_CODING_PULSE_DISTANCE:
+    return "pulse-distance";
+  case IRDB_CODING_PULSE_WIDTH:
+    return "pulse-width";
+  case IRDB_CODING_BIPHASE:
+    return "biphase";
+  default:
+    return "unknown";
+  }
+}
@@ -0,0 +1,240 @@
+/**
+ * @file ir_io.c
+ * @brief 异步I/O执行器实现 - 作业链按批放入RTIO，执行线程提交并收割完成
+ */
+
+#include "ir_io.h"
+#include <zephyr/logging/log.h>
+#include <zephyr/rtio/rtio.h>
+
+LOG_MODULE_REGISTER(ir_io, LOG_LEVEL_INF);
+
+#ifdef CONFIG_IR_IO_STACK_SIZE
+#define IO_STACK_SIZE CONFIG_IR_IO_STACK_SIZE
+#else
+#define IO_STACK_SIZE 2048
+#endif
+
+/* 作业状态 */
+enum {
+  IO_IDLE = 0,
+  IO_QUEUED,
+  IO_CANCELED, // 已排队、执行时直接以-ECANCELED完成
+  IO_RUNNING,
+};
+
+/* 提交/完成队列只由执行线程存取，生产者经pending表交给它 */
+RTIO_DEFINE(io_rtio, IR_IO_BATCH, IR_IO_BATCH);
+
+static sys_slist_t io_pending; // 待执行的链首
+static struct k_spinlock io_lock;
+static K_SEM_DEFINE(io_wake, 0, 1);
+
+K_THREAD_STACK_DEFINE(io_stack, IO_STACK_SIZE);
+static struct k_thread io_thread;
+static bool io_started;
+
+/* 提交序号与完成序号 - 阶段按提交顺序完成，flush等完成序号追上 */
+static uint32_t io_submitted_seq;
+static uint32_t io_completed_seq;
+static K_MUTEX_DEFINE(io_flush_lock);
+static K_CONDVAR_DEFINE(io_flush_cond);
+
+static ir_io_stats_t io_stats;
+
+/* RTIO回调 - rtio_submit中按链顺序同步执行 */
+static void io_stage(struct rtio *r, const struct rtio_sqe *sqe, void *arg0) {
+  ir_io_job_t *job = arg0;
+  uint32_t now = k_cycle_get_32();
+
+  io_stats.max_wait_us = MAX(io_stats.max_wait_us,
+                             k_cyc_to_us_floor32(now - job->queued_at));
+
+  if ((job->prev && job->prev->result < 0) ||
+      !atomic_cas(&job->state, IO_QUEUED, IO_RUNNING)) {
+    job->result = -ECANCELED;
+    return;
+  }
+
+  job->result = job->fn(job);
+  io_stats.max_run_us = MAX(io_stats.max_run_us,
+                            k_cyc_to_us_floor32(k_cycle_get_32() - now));
+}
+
+/* 收割完成队列 - done之后作业归调用者 */
+static void io_reap(void) {
+  struct rtio_cqe *cqe;
+
+  while ((cqe = rtio_cqe_consume(&io_rtio)) != NULL) {
+    ir_io_job_t *job = cqe->userdata;
+    int result = job->result;
+
+    rtio_cqe_release(&io_rtio, cqe);
+
+    if (result == -ECANCELED) {
+      io_stats.canceled++;
+    } else if (result < 0) {
+      io_stats.failed++;
+    }
+    io_stats.completed++;
+
+    atomic_set(&job->state, IO_IDLE);
+    if (job->done) {
+      job->done(job, result);
+    }
+
+    k_mutex_lock(&io_flush_lock, K_FOREVER);
+    io_completed_seq++;
+    k_condvar_broadcast(&io_flush_cond);
+    k_mutex_unlock(&io_flush_lock);
+  }
+}
+
+/* 取出放得下的若干条链，各阶段依次入提交队列 */
+static uint32_t io_fill(void) {
+  uint32_t stages = 0;
+
+  while (1) {
+    k_spinlock_key_t key = k_spin_lock(&io_lock);
+    sys_snode_t *node = sys_slist_peek_head(&io_pending);
+    ir_io_job_t *head = node ? CONTAINER_OF(node, ir_io_job_t, node) : NULL;
+    uint32_t len = 0;
+
+    for (ir_io_job_t *j = head; j; j = j->next) {
+      len++;
+    }
+    if (!head || stages + len > IR_IO_BATCH) {
+      k_spin_unlock(&io_lock, key);
+      return stages;
+    }
+    sys_slist_get(&io_pending);
+    k_spin_unlock(&io_lock, key);
+
+    for (ir_io_job_t *j = head; j; j = j->next) {
+      struct rtio_sqe *sqe = rtio_sqe_acquire(&io_rtio);
+
+      /* 队列深度为IR_IO_BATCH，按上面的计数不会取空 */
+      __ASSERT_NO_MSG(sqe != NULL);
+      rtio_sqe_prep_callback(sqe, io_stage, j, j);
+      if (j->next) {
+        sqe->flags |= RTIO_SQE_CHAINED;
+      }
+    }
+    stages += len;
+  }
+}
+
+static void io_thread_entry(void *p1, void *p2, void *p3) {
+  while (1) {
+    k_sem_take(&io_wake, K_FOREVER);
+
+    uint32_t stages;
+    while ((stages = io_fill()) > 0) {
+      io_stats.batches++;
+      io_stats.max_batch = MAX(io_stats.max_batch, stages);
+      rtio_submit(&io_rtio, 0);
+      io_reap();
+    }
+  }
+}
+
+int ir_io_init(void) {
+  if (io_started) {
+    return 0;
+  }
+
+  sys_slist_init(&io_pending);
+  k_thread_create(&io_thread, io_stack, K_THREAD_STACK_SIZEOF(io_stack),
+                  io_thread_entry, NULL, NULL, NULL,
+                  K_LOWEST_APPLICATION_THREAD_PRIO, 0, K_NO_WAIT);
+  k_thread_name_set(&io_thread, "ir_io");
+  io_started = true;
+  return 0;
+}
+
+int ir_io_submit(ir_io_job_t *job) {
+  uint32_t len = 0;
+
+  if (!job) {
+    return -EINVAL;
+  }
+  if (!io_started) {
+    return -ENODEV;
+  }
+
+  for (ir_io_job_t *j = job; j; j = j->next) {
+    if (!j->fn) {
+      return -EINVAL;
+    }
+    if (++len > IR_IO_BATCH) {
+      return -E2BIG;
+    }
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&io_lock);
+  for (ir_io_job_t *j = job; j; j = j->next) {
+    if (atomic_get(&j->state) != IO_IDLE) {
+      k_spin_unlock(&io_lock, key);
+      return -EBUSY;
+    }
+  }
+
+  uint32_t now = k_cycle_get_32();
+  ir_io_job_t *prev = NULL;
+  for (ir_io_job_t *j = job; j; j = j->next) {
+    j->prev = prev;
+    j->queued_at = now;
+    j->result = 0;
+    atomic_set(&j->state, IO_QUEUED);
+    prev = j;
+  }
+  sys_slist_append(&io_pending, &job->node);
+  io_submitted_seq += len;
+  io_stats.submitted += len;
+  k_spin_unlock(&io_lock, key);
+
+  k_sem_give(&io_wake);
+  return 0;
+}
+
+int ir_io_cancel(ir_io_job_t *job) {
+  if (!job) {
+    return -EINVAL;
+  }
+  return atomic_cas(&job->state, IO_QUEUED, IO_CANCELED) ? 0 : -EALREADY;
+}
+
+bool ir_io_busy(const ir_io_job_t *job) {
+  return atomic_get(&job->state) != IO_IDLE;
+}
+
+void ir_io_flush(void) {
+  if (!io_started || ir_io_in_executor()) {
+    return;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&io_lock);
+  uint32_t target = io_submitted_seq;
+  k_spin_unlock(&io_lock, key);
+
+  k_mutex_lock(&io_flush_lock, K_FOREVER);
+  while ((int32_t)(io_completed_seq - target) < 0) {
+    k_condvar_wait(&io_flush_cond, &io_flush_lock, K_FOREVER);
+  }
+  k_mutex_unlock(&io_flush_lock);
+}
+
+bool ir_io_in_executor(void) {
+  return io_started && k_current_get() == &io_thread;
+}
+
+void ir_io_get_stats(ir_io_stats_t *stats) {
+  if (!stats) {
+    return;
+  }
+
+  *stats = io_stats;
+  k_spinlock_key_t key = k_spin_lock(&io_lock);
+  stats->pending = io_submitted_seq - io_completed_seq;
+  k_spin_unlock(&io_lock, key);
+}
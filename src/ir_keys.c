@@ -0,0 +1,85 @@
+/**
+ * @file ir_keys.c
+ * @brief 按键事件整形实现
+ */
+
+#include "ir_keys.h"
+#include <string.h>
+
+void ir_keys_init(ir_keys_state_t *st, uint8_t channel) {
+  memset(st, 0, sizeof(*st));
+  st->key.channel = channel;
+}
+
+static bool same_key(const irdb_entry_t *a, const irdb_entry_t *b) {
+  return a->protocol == b->protocol && a->device == b->device &&
+         a->subdevice == b->subdevice && a->function == b->function;
+}
+
+/* 以当前键生成一个事件 */
+static void key_event(ir_keys_state_t *st, ir_key_action_t action,
+                      uint32_t now_ms, ir_key_event_t *out) {
+  *out = st->key;
+  out->action = action;
+  out->held_ms = now_ms - st->press_ms;
+  st->reported_ms = now_ms;
+}
+
+int ir_keys_frame(ir_keys_state_t *st, const irdb_entry_t *code,
+                  uint8_t remote, int toggle, uint32_t now_ms,
+                  ir_key_event_t *out) {
+  int n = 0;
+  bool held = st->down && now_ms - st->last_ms <= IR_KEY_RELEASE_MS &&
+              (!code || (same_key(code, &st->key.code) &&
+                         toggle == st->toggle));
+
+  if (!code && !held) {
+    return 0; // 重复码前没有按下的键
+  }
+
+  if (held) {
+    st->last_ms = now_ms;
+    if (st->key.frames < UINT16_MAX) {
+      st->key.frames++;
+    }
+    if (now_ms - st->reported_ms < IR_KEY_HOLD_INTERVAL) {
+      st->coalesced++;
+      return 0;
+    }
+    key_event(st, IR_KEY_HOLD, now_ms, &out[n++]);
+    return n;
+  }
+
+  if (st->down) {
+    key_event(st, IR_KEY_RELEASE, st->last_ms, &out[n++]);
+  }
+
+  st->key.code = *code;
+  st->key.remote = remote;
+  st->key.frames = 1;
+  st->toggle = toggle;
+  st->down = true;
+  st->press_ms = now_ms;
+  st->last_ms = now_ms;
+  key_event(st, IR_KEY_PRESS, now_ms, &out[n++]);
+  return n;
+}
+
+int ir_keys_expire(ir_keys_state_t *st, uint32_t now_ms, ir_key_event_t *out,
+                   uint32_t *due_ms) {
+  *due_ms = 0;
+  if (!st->down) {
+    return 0;
+  }
+
+  uint32_t idle = now_ms - st->last_ms;
+  if (idle < IR_KEY_RELEASE_MS) {
+    *due_ms = IR_KEY_RELEASE_MS - idle;
+    return 0;
+  }
+
+  /* 松开时刻记为最后一帧，held_ms即实际按住的时长 */
+  key_event(st, IR_KEY_RELEASE, st->last_ms, out);
+  st->down = false;
+  return 1;
+}
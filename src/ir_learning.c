@@ -4,12 +4,30 @@
  */
 
 #include "ir_learning.h"
+#include "ir_event.h"
 #include "ir_hal.h"
+#include "ir_infer.h"
+#include "ir_io.h"
+#include "ir_mem.h"
+#include "ir_service.h"
+#include "irdb_pronto.h"
+#include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 
+#if defined(__ARM_FEATURE_DSP)
+#include <cmsis_core.h>
+#endif
+
+/* 信号存储后端: LittleFS信号库文件或NVS (CONFIG_IR_LEARNING_STORAGE) */
+#if defined(CONFIG_IR_LEARNING_STORAGE_LFS) ||                                \
+    defined(CONFIG_IR_LEARNING_STORAGE_NVS)
+#define LEARNING_STORAGE 1
+#include "ir_signal_lib.h"
+#include <zephyr/sys/crc.h>
+#endif
 
 #ifdef CONFIG_FILE_SYSTEM
 #include <zephyr/fs/fs.h>
@@ -19,57 +37,459 @@ LOG_MODULE_REGISTER(ir_learning, LOG_LEVEL_INF);
 
 #define LEARNING_TIMEOUT_DEFAULT_MS 5000
 #define SIGNAL_END_TIMEOUT_MS 150
-#define MIN_PULSE_US 50
-#define LEARNING_STORAGE_PATH "/lfs/ir_learned"
+#define LEARNING_STORAGE_PATH "/lfs/ir_learned" // 旧版每信号一个文件的目录
+
+/* 信号正文格式 (信号库记录的正文，旧版.dat文件同此格式):
+ *   v5: 魔数 + 名称 + 载波 + 推断的协议参数 + 码字 + CRC32 (未知协议
+ *       但可由ir_infer推断参数的信号，加载时重新编码)
+ *   v4: 魔数 + 名称 + 载波 + 协议码 + CRC32 (识别为已知协议的信号)
+ *   v3: 魔数 + 头部 + 时长字母表 + 按位打包的字母表下标 + CRC32
+ *   v2: 魔数 + 头部 + 16位紧凑时序 (字母表放不下时仍按此格式保存)
+ *   无魔数的旧文件为32位微秒时序 */
+static const uint8_t learning_file_magic[4] = {0xA5, 'I', 'R', 0x02};
+static const uint8_t learning_file_magic_v3[4] = {0xA5, 'I', 'R', 0x03};
+static const uint8_t learning_file_magic_v4[4] = {0xA5, 'I', 'R', 0x04};
+static const uint8_t learning_file_magic_v5[4] = {0xA5, 'I', 'R', 0x05};
+
+/* 字母表 - 容差内的时长归为一类，以类均值代表 */
+#define LEARNING_ALPHABET_MAX 64
+#define LEARNING_CLUSTER_MIN_US 60 // 容差下限，覆盖接收头的固定抖动
+
+/* 协议识别 - 重新编码后须与录制的首帧逐个时长吻合 */
+#define LEARNING_FRAME_GAP_US 8000 // 超过此长度的space视为帧间隔
+#define LEARNING_MATCH_MIN_US 120  // 比对容差下限
+#define LEARNING_ENCODE_MAX 160    // 重新编码单帧的最大时序数
+#define LEARNING_REPEAT_CODE_MAX 4 // 不超过此时序数的帧视为重复码(NEC 9ms+2.25ms)
+
+/* 录制缓冲 - 定长块按到达顺序挂到块表上，块取自学习期间的块池 */
+#define LEARNING_CHUNK_EDGES 64 // 每块时序数
+#define LEARNING_CHUNK_MAX                                                     \
+  DIV_ROUND_UP(IR_LEARNING_MAX_EDGES, LEARNING_CHUNK_EDGES)
+
+typedef struct {
+  ir_timing_t *chunks[LEARNING_CHUNK_MAX];
+  uint16_t count; // 按键结束时的时序数
+} learning_capture_t;
 
 /* 学习状态 */
 static struct {
-  ir_learned_signal_t current_signal;
+  ir_learned_signal_t current_signal; // timings为时序缓冲池的一块
   ir_learn_callback_t callback;
   void *user_data;
   struct k_timer timeout_timer;
   struct k_timer end_timer;
+  bool initialized;
   bool active;
   uint32_t edge_count;
+  bool in_frame; // 已停止结束定时器，等待HAL的帧结束通知
+  uint32_t frame_us; // 当前帧起点以来的时长，量帧周期用
   uint32_t start_time_us;
+  uint64_t carrier_sum; // 按载波周期数加权的频率、占空比之和
+  uint32_t duty_sum;
+  uint32_t carrier_periods;
+  struct k_mem_slab chunk_slab;
+  void *chunk_mem;
+  /* 每次按键一条块链，多次学习只保留互不相同的帧 */
+  learning_capture_t captures[IR_LEARNING_MAX_PRESSES];
+  uint8_t presses;
+  uint8_t press;
+  uint16_t frame_start; // 当前帧起点
+  uint16_t prev_start;  // 上一个保留帧的起点
+  uint32_t timeout_ms;
+  atomic_t rx_subscriber; // HAL订阅号，-1为未订阅
+  /* 收尾 - 定时器回调结束录制后，识别和通知在系统工作队列中进行 */
+  struct k_work finish_work;
+  ir_learn_status_t finish_status;
+  bool finishing; // 已结束录制，收尾尚未完成，此时不能开始新的学习
+  /* 实时分析 - 接收回调中逐沿累计，lock保护与读取者之间的一致性 */
+  ir_analytics_t live;
+  struct k_spinlock live_lock;
+  bool live_valid;
 } learn_state;
 
-/* 信号结束检测定时器 */
-static void signal_end_handler(struct k_timer *timer) {
-  if (!learn_state.active || learn_state.edge_count == 0) {
+/* 统计 - 在收尾工作和定时器回调中更新 */
+static struct {
+  atomic_t completed;
+  atomic_t recognized;
+  atomic_t timeouts;
+  atomic_t errors;
+} learn_stats;
+
+/* 录制时长与编码时长是否吻合: 25%，不小于LEARNING_MATCH_MIN_US */
+static bool learning_timing_close(uint32_t measured, uint32_t expected) {
+  uint32_t tolerance = MAX(expected / 4, LEARNING_MATCH_MIN_US);
+  uint32_t diff = measured > expected ? measured - expected : expected - measured;
+  return diff <= tolerance;
+}
+
+/* 首帧长度 - 第一个帧间隔之前的时序数 */
+static uint16_t learning_frame_length(const ir_learned_signal_t *signal) {
+  for (uint16_t i = 1; i < signal->timing_count; i += 2) {
+    if (ir_timing_us(signal->timings[i]) >= LEARNING_FRAME_GAP_US) {
+      return i;
+    }
+  }
+  return signal->timing_count;
+}
+
+/* 校验识别结果: 解码器只看码字位，这里确认首帧在码字后结束(排除更长的
+ * 未知协议被截成已知协议)且重新编码后与录制一致 */
+static bool learning_verify(const ir_learned_signal_t *signal,
+                            const irdb_entry_t *code, int toggle) {
+  ir_timing_t encoded[LEARNING_ENCODE_MAX];
+  uint32_t n = 0;
+
+  /* 按录制帧中的toggle位重新编码，RC5/RC6也能逐段比较 */
+  if (irdb_encode_with_toggle(code, toggle == 1, encoded, &n,
+                              ARRAY_SIZE(encoded)) < 0 ||
+      n == 0) {
+    return false;
+  }
+
+  uint16_t frame = learning_frame_length(signal);
+
+  /* 以space结尾的帧(Sony)末位space并入帧间隔 */
+  if (frame != n && !(n % 2 == 0 && frame == n - 1)) {
+    return false;
+  }
+
+  for (uint16_t i = 0; i < frame; i++) {
+    if (!learning_timing_close(ir_timing_us(signal->timings[i]),
+                               ir_timing_us(encoded[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* 用各协议解码器识别录制的信号，按时序误差从小到大取首个复核通过的
+ * 候选记下协议码 */
+static void learning_recognize(ir_learned_signal_t *signal) {
+  irdb_candidate_t cand[IRDB_MAX_CANDIDATES];
+
+  signal->parametric = false;
+
+  int n = irdb_decode_ranked(NULL, 0, signal->timings, signal->timing_count,
+                             cand, ARRAY_SIZE(cand));
+  for (int i = 0; i < n; i++) {
+    const irdb_entry_t *code = &cand[i].entry;
+
+    if (!learning_verify(signal, code, cand[i].toggle)) {
+      continue;
+    }
+
+    signal->code = *code;
+    signal->parametric = true;
+    LOG_INF("Recognized as %s (D:%u.%u F:%u, confidence %u)",
+            irdb_get_protocol_params(code->protocol)->name, code->device,
+            code->subdevice, code->function, cand[i].confidence);
+    return;
+  }
+}
+
+/* 录制块链的第i个时长 */
+static inline uint32_t capture_us(const learning_capture_t *cap, uint16_t i) {
+  return ir_timing_us(
+      cap->chunks[i / LEARNING_CHUNK_EDGES][i % LEARNING_CHUNK_EDGES]);
+}
+
+/* 追加第index个时序，块用完时从块池取下一块 */
+static int capture_append(learning_capture_t *cap, uint16_t index,
+                          ir_timing_t timing) {
+  ir_timing_t **chunk = &cap->chunks[index / LEARNING_CHUNK_EDGES];
+
+  if (!*chunk &&
+      k_mem_slab_alloc(&learn_state.chunk_slab, (void **)chunk, K_NO_WAIT) <
+          0) {
+    *chunk = NULL;
+    return -ENOMEM;
+  }
+
+  (*chunk)[index % LEARNING_CHUNK_EDGES] = timing;
+  return 0;
+}
+
+/* 截断到count个时序，多余的块归还块池 */
+static void capture_truncate(learning_capture_t *cap, uint16_t count) {
+  for (uint16_t c = DIV_ROUND_UP(count, LEARNING_CHUNK_EDGES);
+       c < LEARNING_CHUNK_MAX && cap->chunks[c]; c++) {
+    k_mem_slab_free(&learn_state.chunk_slab, cap->chunks[c]);
+    cap->chunks[c] = NULL;
+  }
+}
+
+/* 两段录制逐个吻合 */
+static bool capture_close(const learning_capture_t *a, uint16_t a_start,
+                          const learning_capture_t *b, uint16_t b_start,
+                          uint16_t length) {
+  for (uint16_t i = 0; i < length; i++) {
+    if (!learning_timing_close(capture_us(a, a_start + i),
+                               capture_us(b, b_start + i))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* 学习期间从数据库堆取得块池，结束即整体释放，空闲时不占内存 */
+static int learning_pool_alloc(void) {
+  size_t block = LEARNING_CHUNK_EDGES * sizeof(ir_timing_t);
+
+  learn_state.chunk_mem = irdb_heap_alloc(block * IR_LEARNING_CAPTURE_BLOCKS);
+  if (!learn_state.chunk_mem) {
+    return -ENOMEM;
+  }
+
+  memset(learn_state.captures, 0, sizeof(learn_state.captures));
+  return k_mem_slab_init(&learn_state.chunk_slab, learn_state.chunk_mem,
+                         block, IR_LEARNING_CAPTURE_BLOCKS);
+}
+
+static void learning_pool_release(void) {
+  irdb_heap_free(learn_state.chunk_mem);
+  learn_state.chunk_mem = NULL;
+  memset(learn_state.captures, 0, sizeof(learn_state.captures));
+}
+
+/* 退订HAL边沿流 - 结束工作项与停止学习的线程都可能调用，只退订一次;
+ * 同时进行的协议接收不受影响 */
+static void learning_rx_release(void) {
+  int id = atomic_set(&learn_state.rx_subscriber, -1);
+
+  if (id >= 0) {
+    ir_hal_rx_unsubscribe(id);
+  }
+}
+
+/* 多次学习: 帧[frame_start, end)录完。重复码、与上一个保留帧相同的重复帧
+ * 连同其前的帧间隔一并丢弃，不同的帧(空调的多段帧)保留 */
+static void learning_press_frame(uint16_t end) {
+  learning_capture_t *cap = &learn_state.captures[learn_state.press];
+  uint16_t start = learn_state.frame_start;
+  uint16_t length = end - start;
+  bool repeat = length <= LEARNING_REPEAT_CODE_MAX;
+
+  if (!repeat && start > 0) {
+    uint16_t prev = learn_state.prev_start;
+    repeat = start - 1 - prev == length &&
+             capture_close(cap, prev, cap, start, length);
+  }
+
+  if (repeat) {
+    learn_state.edge_count = start;
+    capture_truncate(cap, start);
+    return;
+  }
+
+  learn_state.prev_start = start;
+  learn_state.frame_start = end + 1;
+}
+
+/* 多次学习: 一次按键结束，返回是否已录够 */
+static bool learning_press_done(void) {
+  learning_capture_t *cap = &learn_state.captures[learn_state.press];
+
+  learning_press_frame(learn_state.edge_count);
+
+  /* 末帧被丢弃时留下的帧间隔 */
+  if (learn_state.edge_count % 2 == 0 && learn_state.edge_count > 0) {
+    learn_state.edge_count--;
+  }
+
+  if (learn_state.edge_count > 0) {
+    cap->count = learn_state.edge_count;
+    learn_state.press++;
+    ir_event_emit(IR_EVENT_LEARN_PRESS, learn_state.press,
+                  learn_state.presses, learn_state.edge_count);
+  } else {
+    /* 只有噪声或重复码的按键不计数 */
+    capture_truncate(cap, 0);
+  }
+
+  if (learn_state.press == learn_state.presses) {
+    return true;
+  }
+
+  learn_state.edge_count = 0;
+  learn_state.frame_start = 0;
+  learn_state.prev_start = 0;
+
+  /* 实时分析只反映当前这次按键 */
+  k_spinlock_key_t key = k_spin_lock(&learn_state.live_lock);
+  ir_analytics_reset(&learn_state.live);
+  k_spin_unlock(&learn_state.live_lock, key);
+
+  k_timer_start(&learn_state.timeout_timer, K_MSEC(learn_state.timeout_ms),
+                K_NO_WAIT);
+
+  if (learn_state.callback) {
+    learn_state.callback(IR_LEARN_NEXT_PRESS, NULL, learn_state.user_data);
+  }
+  return false;
+}
+
+/* 按位置取中值 */
+static uint32_t learning_median(uint32_t *values, uint8_t count) {
+  for (uint8_t i = 1; i < count; i++) {
+    uint32_t v = values[i];
+    uint8_t j = i;
+    for (; j > 0 && values[j - 1] > v; j--) {
+      values[j] = values[j - 1];
+    }
+    values[j] = v;
+  }
+  return count % 2 ? values[count / 2]
+                   : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+/* 选出与最多其它按键吻合的一次，与之吻合的按键逐个时长取中值。漏沿、
+ * 多沿或被干扰的按键长度或时长不符，不参与。单次学习即原样拷贝 */
+static void learning_press_combine(ir_learned_signal_t *signal) {
+  const learning_capture_t *caps = learn_state.captures;
+  uint8_t best = 0, best_votes = 0;
+
+  for (uint8_t p = 0; p < learn_state.press; p++) {
+    uint8_t votes = 0;
+
+    for (uint8_t q = 0; q < learn_state.press; q++) {
+      votes += caps[q].count == caps[p].count &&
+               capture_close(&caps[p], 0, &caps[q], 0, caps[p].count);
+    }
+    if (votes > best_votes) {
+      best = p;
+      best_votes = votes;
+    }
+  }
+
+  const learning_capture_t *members[IR_LEARNING_MAX_PRESSES];
+  uint16_t count = caps[best].count;
+  uint8_t n = 0;
+
+  for (uint8_t q = 0; q < learn_state.press; q++) {
+    if (caps[q].count == count &&
+        capture_close(&caps[best], 0, &caps[q], 0, count)) {
+      members[n++] = &caps[q];
+    }
+  }
+
+  for (uint16_t i = 0; i < count; i++) {
+    uint32_t values[IR_LEARNING_MAX_PRESSES];
+    for (uint8_t k = 0; k < n; k++) {
+      values[k] = capture_us(members[k], i);
+    }
+    signal->timings[i] = ir_timing_pack(learning_median(values, n));
+  }
+  signal->timing_count = count;
+
+  ir_event_emit(IR_EVENT_LEARN_DONE, n, learn_state.press, count);
+}
+
+/* 载波测量已结束，按周期数加权平均各mark的测量结果 */
+static void learning_carrier_finish(void) {
+  if (learn_state.carrier_periods == 0) {
     return;
   }
 
-  LOG_INF("Signal capture completed: %u edges", learn_state.edge_count);
+  ir_learned_signal_t *signal = &learn_state.current_signal;
+  signal->carrier_freq = learn_state.carrier_sum / learn_state.carrier_periods;
+  signal->duty_cycle = learn_state.duty_sum / learn_state.carrier_periods;
+  LOG_INF("Carrier: %u Hz, duty %u%% (%u periods)", signal->carrier_freq,
+          signal->duty_cycle, learn_state.carrier_periods);
+}
 
-  learn_state.current_signal.timing_count = learn_state.edge_count;
-  learn_state.current_signal.valid = true;
+/* 结束录制 - 定时器回调(中断)中只改状态，合并按键、分配释放内存、识别
+ * 和通知都在收尾工作中 */
+static void learning_finish(ir_learn_status_t status) {
+  k_timer_stop(&learn_state.timeout_timer);
   learn_state.active = false;
+  learn_state.finish_status = status;
+  learn_state.finishing = true;
+  k_work_submit(&learn_state.finish_work);
+}
+
+/* 录制完成 - 各次按键合并到时序缓冲池的一块，识别协议 */
+static int learning_complete(void) {
+  ir_learned_signal_t *signal = &learn_state.current_signal;
+  uint16_t count = 0;
+
+  if (learn_state.presses == 1) {
+    learn_state.captures[0].count = learn_state.edge_count;
+    learn_state.press = 1;
+  }
+  for (uint8_t p = 0; p < learn_state.press; p++) {
+    count = MAX(count, learn_state.captures[p].count);
+  }
+
+  signal->timings = ir_timing_buf_alloc();
+  if (!signal->timings) {
+    LOG_ERR("Failed to allocate %u timings", count);
+    atomic_inc(&learn_stats.errors);
+    return -ENOMEM;
+  }
+
+  learning_press_combine(signal);
+  learning_recognize(signal);
+  signal->valid = true;
+  learning_carrier_finish();
+
+  atomic_inc(&learn_stats.completed);
+  if (signal->parametric) {
+    atomic_inc(&learn_stats.recognized);
+  }
+  return 0;
+}
 
-  /* 停止HAL接收 */
-  ir_hal_rx_stop();
+/* 收尾工作 - 中值合并(最多数千个时长)、堆分配释放、协议识别(逐协议
+ * 解码、重新编码比对)和用户回调不在定时器中断中进行 */
+static void learning_finish_handler(struct k_work *work) {
+  ir_learned_signal_t *signal = &learn_state.current_signal;
+  ir_learn_status_t status = learn_state.finish_status;
 
-  /* 通知完成 */
+  learning_rx_release();
+  ir_hal_carrier_stop();
+  if (status == IR_LEARN_COMPLETED && learning_complete() < 0) {
+    status = IR_LEARN_ERROR;
+  }
+  learning_pool_release();
+
+  /* 回调中可以开始下一次学习 */
+  learn_state.finishing = false;
   if (learn_state.callback) {
-    learn_state.callback(IR_LEARN_COMPLETED, &learn_state.current_signal,
+    learn_state.callback(status, status == IR_LEARN_COMPLETED ? signal : NULL,
                          learn_state.user_data);
   }
 }
 
+/* 信号结束检测定时器 */
+static void signal_end_handler(struct k_timer *timer) {
+  if (!learn_state.active || learn_state.edge_count == 0) {
+    return;
+  }
+
+  if (learn_state.presses > 1 && !learning_press_done()) {
+    return;
+  }
+  learning_finish(IR_LEARN_COMPLETED);
+}
+
 /* 学习超时处理 */
 static void learning_timeout_handler(struct k_timer *timer) {
   if (!learn_state.active) {
     return;
   }
 
-  LOG_WRN("Learning timeout");
-
-  learn_state.active = false;
-  ir_hal_rx_stop();
-
-  if (learn_state.callback) {
-    learn_state.callback(IR_LEARN_TIMEOUT, NULL, learn_state.user_data);
+  /* 多次学习已录到按键时以已有的为准 */
+  if (learn_state.press > 0) {
+    LOG_WRN("Learning timeout after %u/%u presses", learn_state.press,
+            learn_state.presses);
+    k_timer_stop(&learn_state.end_timer);
+    learning_finish(IR_LEARN_COMPLETED);
+    return;
   }
+
+  LOG_WRN("Learning timeout");
+  atomic_inc(&learn_stats.timeouts);
+  learning_finish(IR_LEARN_TIMEOUT);
 }
 
 /* HAL接收回调 - 记录时序 */
@@ -84,120 +504,284 @@ static void learning_rx_callback(ir_pulse_t *pulse, void *user_data) {
     return;
   }
 
-  /* 过滤过短的脉冲（噪声） */
-  if (pulse->duration_us < MIN_PULSE_US) {
+  /* 帧结束 - 静默超过SIGNAL_END_TIMEOUT_MS且无新帧即按键结束。帧内不再
+   * 逐边沿重启定时器 */
+  if (pulse->frame_end) {
+    learn_state.in_frame = false;
+    k_timer_start(&learn_state.end_timer, K_MSEC(SIGNAL_END_TIMEOUT_MS),
+                  K_NO_WAIT);
     return;
   }
-
-  /* 关键检查：缓冲区是否存在 */
-  if (!learn_state.current_signal.timings) {
-    LOG_ERR("Timing buffer is NULL - learning not initialized!");
-    /* 尝试恢复：停止学习 */
-    learn_state.active = false;
-    ir_hal_rx_stop();
-    if (learn_state.callback) {
-      learn_state.callback(IR_LEARN_ERROR, NULL, learn_state.user_data);
-    }
-    return;
+  if (!learn_state.in_frame) {
+    learn_state.in_frame = true;
+    k_timer_stop(&learn_state.end_timer);
   }
 
   /* 第一个脉冲 - 开始录制 */
   if (learn_state.edge_count == 0) {
-    LOG_INF("Signal detected, recording...");
+    ir_event_emit(IR_EVENT_LEARN_DETECT, learn_state.press + 1,
+                  learn_state.presses, 0);
     learn_state.start_time_us = k_cyc_to_us_floor32(k_cycle_get_32());
+    learn_state.frame_us = 0;
 
     if (learn_state.callback) {
       learn_state.callback(IR_LEARN_RECEIVING, NULL, learn_state.user_data);
     }
   }
 
-  /* 检查是否超出缓冲区 */
-  if (learn_state.edge_count >= IR_LEARNING_MAX_EDGES) {
+  /* 帧周期 - 帧间隔只在下一帧开始时送达，第一个帧间隔结束即量得首帧
+   * 起点到次帧起点。多次学习丢弃的重复帧在此之前已量过 */
+  learn_state.frame_us += pulse->duration_us;
+  if (!pulse->is_mark && pulse->duration_us >= LEARNING_FRAME_GAP_US) {
+    if (learn_state.current_signal.repeat_period_us == 0) {
+      learn_state.current_signal.repeat_period_us = learn_state.frame_us;
+    }
+    learn_state.frame_us = 0;
+  }
+
+  /* 记录时序 - 超出上限或块池用尽时单次学习就此结束，多次学习截断本次
+   * 按键，静默后再换下一次 */
+  learning_capture_t *cap = &learn_state.captures[learn_state.press];
+  if (learn_state.edge_count >= IR_LEARNING_MAX_EDGES ||
+      capture_append(cap, learn_state.edge_count,
+                     ir_timing_pack(pulse->duration_us)) < 0) {
+    if (learn_state.presses > 1) {
+      return;
+    }
     LOG_ERR("Buffer overflow (%u edges), stopping", learn_state.edge_count);
     k_timer_stop(&learn_state.end_timer);
     signal_end_handler(NULL);
     return;
   }
+  learn_state.edge_count++;
 
-  /* 记录时序 */
-  learn_state.current_signal.timings[learn_state.edge_count++] =
-      pulse->duration_us;
+  k_spinlock_key_t key = k_spin_lock(&learn_state.live_lock);
+  ir_analytics_push(&learn_state.live, ir_timing_pack(pulse->duration_us));
+  k_spin_unlock(&learn_state.live_lock, key);
 
-  /* 调试：每10个脉冲打印一次 */
-  if (learn_state.edge_count % 10 == 0) {
-    LOG_DBG("Recorded %u edges", learn_state.edge_count);
+  if (learn_state.presses > 1 && !pulse->is_mark &&
+      pulse->duration_us >= LEARNING_FRAME_GAP_US) {
+    learning_press_frame(learn_state.edge_count - 1);
   }
 
-  /* 重置信号结束定时器 */
-  k_timer_start(&learn_state.end_timer, K_MSEC(SIGNAL_END_TIMEOUT_MS),
-                K_NO_WAIT);
+  /* 取出这个mark内的载波测量 - 太短或读取时已跨入下一个mark的被丢弃 */
+  ir_carrier_t carrier;
+  if (pulse->is_mark &&
+      ir_hal_carrier_read(pulse->duration_us, &carrier) == 0) {
+    learn_state.carrier_sum += (uint64_t)carrier.frequency * carrier.periods;
+    learn_state.duty_sum += carrier.duty_cycle * carrier.periods;
+    learn_state.carrier_periods += carrier.periods;
+  }
 }
 
-/* 初始化学习模块 */
-int ir_learning_init(void) {
-  memset(&learn_state, 0, sizeof(learn_state));
+#ifdef LEARNING_STORAGE
+#ifdef CONFIG_FILE_SYSTEM
+static void learning_migrate(void);
+#endif
 
-  /* 初始化定时器 */
-  k_timer_init(&learn_state.timeout_timer, learning_timeout_handler, NULL);
-  k_timer_init(&learn_state.end_timer, signal_end_handler, NULL);
+/* 信号库在第一次存取时才打开 (挂载LittleFS、扫描建索引、迁移旧文件)，
+ * 启动路径上不碰flash。迁移中保存信号会重入，k_mutex允许同线程重入 */
+static K_MUTEX_DEFINE(storage_mutex);
+static bool storage_opened;
 
-  /* 分配时序缓冲区 - 关键！必须在这里分配 */
-  learn_state.current_signal.timings =
-      k_malloc(IR_LEARNING_MAX_EDGES * sizeof(uint32_t));
+static void learning_storage_open(void) {
+  k_mutex_lock(&storage_mutex, K_FOREVER);
+  if (!storage_opened) {
+    storage_opened = true;
+    if (ir_signal_lib_init() == 0) {
+#ifdef CONFIG_FILE_SYSTEM
+      learning_migrate();
+#endif
+    } else {
+      storage_opened = false; // 下次存取时重试
+    }
+  }
+  k_mutex_unlock(&storage_mutex);
+}
 
-  if (!learn_state.current_signal.timings) {
-    LOG_ERR("Failed to allocate timing buffer");
-    return -ENOMEM;
+/* 异步保存 - 请求拷贝进固定槽位，作为作业交给I/O执行器(ir_io)逐个写入，
+ * 单线程执行保证按提交顺序落盘 */
+#ifdef CONFIG_IR_LEARNING_SAVE_QUEUE
+#define LEARNING_SAVE_QUEUE CONFIG_IR_LEARNING_SAVE_QUEUE
+#else
+#define LEARNING_SAVE_QUEUE 4
+#endif
+
+typedef struct {
+  ir_io_job_t job;
+  ir_learned_signal_t signal; // timings为时序缓冲池的一块，写完归还
+  char name[IR_SIGNAL_LIB_NAME_MAX];
+  ir_learning_save_cb_t cb;
+  void *user_data;
+  bool used;
+} learning_save_req_t;
+
+static learning_save_req_t save_reqs[LEARNING_SAVE_QUEUE];
+static struct k_spinlock save_lock;
+static atomic_t save_pending; // 已提交未写完的请求
+
+static int learning_save_stage(ir_io_job_t *job) {
+  learning_save_req_t *req = CONTAINER_OF(job, learning_save_req_t, job);
+
+  return ir_learning_save(&req->signal, req->name);
+}
+
+static void learning_save_done(ir_io_job_t *job, int result) {
+  learning_save_req_t *req = CONTAINER_OF(job, learning_save_req_t, job);
+  char name[IR_SIGNAL_LIB_NAME_MAX];
+  ir_learning_save_cb_t cb = req->cb;
+  void *user_data = req->user_data;
+
+  strcpy(name, req->name);
+  ir_timing_buf_free(req->signal.timings);
+
+  k_spinlock_key_t key = k_spin_lock(&save_lock);
+  req->used = false;
+  k_spin_unlock(&save_lock, key);
+  atomic_dec(&save_pending);
+
+  if (cb) {
+    cb(name, result, user_data);
   }
+}
 
-  /* 清零缓冲区 */
-  memset(learn_state.current_signal.timings, 0,
-         IR_LEARNING_MAX_EDGES * sizeof(uint32_t));
+/* 读取前等已提交的保存写完，读到的是最新内容。执行线程自己(完成回调
+ * 中)不等待 */
+static void learning_save_wait(void) {
+  if (atomic_get(&save_pending) > 0) {
+    ir_io_flush();
+  }
+}
 
-#ifdef CONFIG_FILE_SYSTEM
-  /* 创建存储目录 */
-  struct fs_dir_t dir;
-  fs_dir_t_init(&dir);
-  int ret = fs_opendir(&dir, LEARNING_STORAGE_PATH);
-  if (ret < 0) {
-    ret = fs_mkdir(LEARNING_STORAGE_PATH);
-    if (ret < 0 && ret != -EEXIST) {
-      LOG_WRN("Failed to create storage directory: %d", ret);
+int ir_learning_save_async(const ir_learned_signal_t *signal,
+                           const char *name, ir_learning_save_cb_t cb,
+                           void *user_data) {
+  if (!signal || !signal->valid || !name ||
+      strlen(name) >= IR_SIGNAL_LIB_NAME_MAX ||
+      signal->timing_count > IR_TIMING_BUF_TIMINGS) {
+    return -EINVAL;
+  }
+  ir_timing_t *timings = NULL;
+  if (signal->timings && signal->timing_count > 0) {
+    timings = ir_timing_buf_alloc();
+    if (!timings) {
+      return -ENOMEM;
+    }
+  }
+
+  learning_save_req_t *req = NULL;
+  k_spinlock_key_t key = k_spin_lock(&save_lock);
+  for (size_t i = 0; i < ARRAY_SIZE(save_reqs); i++) {
+    if (!save_reqs[i].used) {
+      req = &save_reqs[i];
+      req->used = true;
+      break;
     }
-  } else {
-    fs_closedir(&dir);
   }
+  k_spin_unlock(&save_lock, key);
+
+  if (!req) {
+    ir_timing_buf_free(timings);
+    return -EBUSY;
+  }
+
+  req->signal = *signal;
+  req->signal.timings = timings;
+  if (timings) {
+    memcpy(timings, signal->timings,
+           signal->timing_count * sizeof(ir_timing_t));
+  }
+  strcpy(req->name, name);
+  req->cb = cb;
+  req->user_data = user_data;
+  ir_io_job_init(&req->job, learning_save_stage, learning_save_done, NULL);
+
+  atomic_inc(&save_pending);
+  int ret = ir_io_submit(&req->job);
+  if (ret < 0) {
+    atomic_dec(&save_pending);
+    ir_timing_buf_free(timings);
+    key = k_spin_lock(&save_lock);
+    req->used = false;
+    k_spin_unlock(&save_lock, key);
+  }
+  return ret;
+}
+
+void ir_learning_save_flush(void) {
+  learning_save_wait();
+}
+#endif
+
+/* 初始化学习模块 - 录制缓冲在学习开始时才分配，信号库在首次存取时打开 */
+int ir_learning_init(void) {
+  memset(&learn_state, 0, sizeof(learn_state));
+  atomic_set(&learn_state.rx_subscriber, -1);
+
+  /* 初始化定时器 */
+  k_timer_init(&learn_state.timeout_timer, learning_timeout_handler, NULL);
+  k_timer_init(&learn_state.end_timer, signal_end_handler, NULL);
+  k_work_init(&learn_state.finish_work, learning_finish_handler);
+
+#ifdef LEARNING_STORAGE
+  ir_io_init();
 #endif
 
-  LOG_INF("IR Learning initialized, buffer at %p",
-          (void *)learn_state.current_signal.timings);
+  learn_state.initialized = true;
+  LOG_INF("IR Learning initialized");
   return 0;
 }
 
 /* 开始学习 */
 int ir_learning_start(const char *signal_name, ir_learn_callback_t callback,
                       void *user_data, uint32_t timeout_ms) {
-  if (learn_state.active) {
+  return ir_learning_start_multi(signal_name, 1, callback, user_data,
+                                 timeout_ms);
+}
+
+/* 开始多次学习 */
+int ir_learning_start_multi(const char *signal_name, uint8_t presses,
+                            ir_learn_callback_t callback, void *user_data,
+                            uint32_t timeout_ms) {
+  if (learn_state.active || learn_state.finishing) {
     LOG_ERR("Learning already in progress");
     return -EBUSY;
   }
 
-  /* 检查缓冲区是否已分配 */
-  if (!learn_state.current_signal.timings) {
+  if (!learn_state.initialized) {
     LOG_ERR("Learning not initialized! Call ir_learning_init() first");
     return -EINVAL;
   }
 
-  /* 重置信号数据（但保留timings指针） */
-  uint32_t *timings_backup = learn_state.current_signal.timings;
+  if (presses == 0 || presses > IR_LEARNING_MAX_PRESSES) {
+    return -EINVAL;
+  }
+
+  /* 上一次的学习结果在此之前一直有效 */
+  ir_timing_buf_free(learn_state.current_signal.timings);
   memset(&learn_state.current_signal, 0, sizeof(ir_learned_signal_t));
-  learn_state.current_signal.timings = timings_backup;
 
-  /* 清零缓冲区内容 */
-  memset(learn_state.current_signal.timings, 0,
-         IR_LEARNING_MAX_EDGES * sizeof(uint32_t));
+  int ret = learning_pool_alloc();
+  if (ret < 0) {
+    LOG_ERR("Failed to allocate capture pool: %d", ret);
+    learning_pool_release();
+    return ret;
+  }
 
   learn_state.edge_count = 0;
+  learn_state.in_frame = false;
+  learn_state.presses = presses;
+  learn_state.press = 0;
+  learn_state.frame_start = 0;
+  learn_state.prev_start = 0;
+  learn_state.carrier_sum = 0;
+  learn_state.duty_sum = 0;
+  learn_state.carrier_periods = 0;
+
+  k_spinlock_key_t key = k_spin_lock(&learn_state.live_lock);
+  ir_analytics_reset(&learn_state.live);
+  learn_state.live_valid = true;
+  k_spin_unlock(&learn_state.live_lock, key);
 
   if (signal_name) {
     strncpy(learn_state.current_signal.name, signal_name,
@@ -208,23 +792,27 @@ int ir_learning_start(const char *signal_name, ir_learn_callback_t callback,
   learn_state.user_data = user_data;
   learn_state.active = true;
 
-  LOG_DBG("Learning buffer check: timings=%p, count=%u",
-          (void *)learn_state.current_signal.timings, learn_state.edge_count);
+  /* 载波测量先于接收启动，第一个mark的边沿不丢失；不可用时不测载波 */
+  ir_hal_carrier_start();
 
-  /* 启动HAL接收 */
-  int ret = ir_hal_rx_start(learning_rx_callback, NULL);
+  /* 订阅HAL边沿流 - 与协议接收共用同一采集，互不打断 */
+  ret = ir_hal_rx_subscribe(IR_HAL_RX_CH_DEFAULT, learning_rx_callback, NULL);
   if (ret < 0) {
     LOG_ERR("Failed to start RX: %d", ret);
     learn_state.active = false;
+    ir_hal_carrier_stop();
+    learning_pool_release();
     return ret;
   }
+  atomic_set(&learn_state.rx_subscriber, ret);
 
-  /* 启动超时定时器 */
+  /* 启动超时定时器 - 多次学习每次按键重新计时 */
   uint32_t timeout = timeout_ms > 0 ? timeout_ms : LEARNING_TIMEOUT_DEFAULT_MS;
+  learn_state.timeout_ms = timeout;
   k_timer_start(&learn_state.timeout_timer, K_MSEC(timeout), K_NO_WAIT);
 
-  LOG_INF("Learning started: '%s', timeout: %u ms",
-          signal_name ? signal_name : "(unnamed)", timeout);
+  LOG_INF("Learning started: '%s', %u press(es), timeout: %u ms",
+          signal_name ? signal_name : "(unnamed)", presses, timeout);
 
   if (callback) {
     callback(IR_LEARN_WAITING, NULL, user_data);
@@ -242,12 +830,62 @@ int ir_learning_stop(void) {
   learn_state.active = false;
   k_timer_stop(&learn_state.timeout_timer);
   k_timer_stop(&learn_state.end_timer);
-  ir_hal_rx_stop();
+  learning_rx_release();
+  ir_hal_carrier_stop();
+  learning_pool_release();
 
   LOG_INF("Learning stopped");
   return 0;
 }
 
+void ir_learning_get_stats(ir_learning_stats_t *stats) {
+  if (!stats) {
+    return;
+  }
+
+  stats->completed = atomic_get(&learn_stats.completed);
+  stats->recognized = atomic_get(&learn_stats.recognized);
+  stats->timeouts = atomic_get(&learn_stats.timeouts);
+  stats->errors = atomic_get(&learn_stats.errors);
+}
+
+/* 时序中第一个帧间隔给出的帧周期 (首帧连同帧间隔)，没有帧间隔时为0 */
+static uint32_t learning_frame_period(const ir_learned_signal_t *signal) {
+  uint16_t frame = learning_frame_length(signal);
+  uint32_t us = 0;
+
+  if (frame >= signal->timing_count) {
+    return 0;
+  }
+  for (uint16_t i = 0; i <= frame; i++) {
+    us += ir_timing_us(signal->timings[i]);
+  }
+  return us;
+}
+
+uint32_t ir_learning_replay_period_us(const ir_learned_signal_t *signal) {
+  uint16_t frame = learning_frame_length(signal);
+  uint32_t period = signal->repeat_period_us > 0
+                        ? signal->repeat_period_us
+                        : learning_frame_period(signal);
+  uint32_t total = 0;
+  uint32_t first = 0;
+
+  for (uint16_t i = 0; i < signal->timing_count; i++) {
+    uint32_t us = ir_timing_us(signal->timings[i]);
+
+    total += us;
+    if (i < frame) {
+      first += us;
+    }
+  }
+
+  if (period > first) {
+    return total + (period - first);
+  }
+  return MAX(IR_LEARNING_REPEAT_GAP_US, total + LEARNING_FRAME_GAP_US);
+}
+
 /* 重放学习的信号 */
 int ir_learning_replay(const ir_learned_signal_t *signal,
                        uint32_t repeat_count) {
@@ -259,187 +897,1420 @@ int ir_learning_replay(const ir_learned_signal_t *signal,
   LOG_INF("Replaying signal: '%s' (%u edges, %u repeats)", signal->name,
           signal->timing_count, repeat_count);
 
+  /* 已识别的协议走编码发送路径 (发送缓存 + 协议重复码) */
+  if (signal->parametric) {
+    return ir_service_send_entry(&signal->code, repeat_count);
+  }
+
   /* 使用检测到的载波频率，默认38kHz */
   uint32_t carrier = signal->carrier_freq > 0 ? signal->carrier_freq : 38000;
-
-  int ret = ir_hal_tx_start(carrier);
-  if (ret < 0) {
-    return ret;
-  }
+  int64_t period = k_us_to_ticks_ceil64(ir_learning_replay_period_us(signal));
+  int64_t start = k_uptime_ticks();
 
   for (uint32_t r = 0; r < repeat_count; r++) {
-    /* 发送所有时序 */
-    for (uint16_t i = 0; i < signal->timing_count; i++) {
-      bool is_mark = (i % 2 == 0); // 偶数索引为mark
-      ir_hal_tx_pulse(signal->timings[i], is_mark);
+    /* 整帧交给HAL硬件回放 */
+    int ret = ir_hal_tx_frame(signal->timings, signal->timing_count, carrier,
+                              signal->duty_cycle);
+    if (ret < 0) {
+      LOG_ERR("TX frame failed: %d", ret);
+      return ret;
     }
 
-    /* 重复间隔 */
+    /* 下一次在本次起点一个周期后开始 */
     if (r < repeat_count - 1) {
-      k_usleep(108000); // 标准间隔
+      start += period;
+      k_sleep(K_TIMEOUT_ABS_TICKS(start));
     }
   }
 
-  ir_hal_tx_stop();
-
   LOG_INF("Replay completed");
   return 0;
 }
 
-#ifdef CONFIG_FILE_SYSTEM
-/* 保存学习的信号 */
-int ir_learning_save(const ir_learned_signal_t *signal, const char *name) {
-  if (!signal || !signal->valid || !name) {
-    return -EINVAL;
-  }
+#ifdef LEARNING_STORAGE
+/* 聚类容差: 1/8 (12.5%)，不小于LEARNING_CLUSTER_MIN_US */
+static uint32_t cluster_tolerance(uint32_t us) {
+  return MAX(us / 8, LEARNING_CLUSTER_MIN_US);
+}
 
-  char filepath[128];
-  snprintf(filepath, sizeof(filepath), "%s/%s.dat", LEARNING_STORAGE_PATH,
-           name);
+/* 时长聚类为字母表，类数超过LEARNING_ALPHABET_MAX返回-E2BIG */
+static int learning_build_alphabet(const ir_learned_signal_t *signal,
+                                   ir_timing_t *alphabet, uint8_t *count_out) {
+  uint32_t sum[LEARNING_ALPHABET_MAX];
+  uint16_t members[LEARNING_ALPHABET_MAX];
+  uint8_t count = 0;
 
-  struct fs_file_t file;
-  fs_file_t_init(&file);
+  for (uint16_t i = 0; i < signal->timing_count; i++) {
+    uint32_t us = ir_timing_us(signal->timings[i]);
+    uint8_t k;
+
+    for (k = 0; k < count; k++) {
+      uint32_t mean = sum[k] / members[k];
+      uint32_t diff = us > mean ? us - mean : mean - us;
+      if (diff <= cluster_tolerance(mean)) {
+        break;
+      }
+    }
 
-  int ret = fs_open(&file, filepath, FS_O_CREATE | FS_O_WRITE | FS_O_TRUNC);
-  if (ret < 0) {
-    LOG_ERR("Failed to open file: %d", ret);
+    if (k == count) {
+      if (count == LEARNING_ALPHABET_MAX) {
+        return -E2BIG;
+      }
+      sum[k] = 0;
+      members[k] = 0;
+      count++;
+    }
+    sum[k] += us;
+    members[k]++;
+  }
+
+  for (uint8_t k = 0; k < count; k++) {
+    alphabet[k] = ir_timing_pack((sum[k] + members[k] / 2) / members[k]);
+  }
+  *count_out = count;
+  return 0;
+}
+
+/* 最接近的字母表下标 */
+static uint8_t learning_nearest(const ir_timing_t *alphabet, uint8_t count,
+                                ir_timing_t t) {
+  uint32_t us = ir_timing_us(t);
+  uint32_t best_diff = UINT32_MAX;
+  uint8_t best = 0;
+
+  for (uint8_t k = 0; k < count; k++) {
+    uint32_t a = ir_timing_us(alphabet[k]);
+    uint32_t diff = us > a ? us - a : a - us;
+    if (diff < best_diff) {
+      best_diff = diff;
+      best = k;
+    }
+  }
+  return best;
+}
+
+/* 表示count个下标所需的位数 */
+static uint8_t learning_index_bits(uint8_t count) {
+  uint8_t bits = 1;
+  while ((1U << bits) < count) {
+    bits++;
+  }
+  return bits;
+}
+
+/* 写入并累加CRC */
+static int learning_write(ir_signal_stream_t *st, const void *data, size_t len,
+                          uint32_t *crc) {
+  *crc = crc32_ieee_update(*crc, data, len);
+  ssize_t ret = ir_signal_stream_write(st, data, len);
+  return ret == (ssize_t)len ? 0 : (ret < 0 ? ret : -ENOSPC);
+}
+
+static int learning_read(ir_signal_stream_t *st, void *data, size_t len,
+                         uint32_t *crc) {
+  ssize_t ret = ir_signal_stream_read(st, data, len);
+  if (ret != (ssize_t)len) {
+    return ret < 0 ? ret : -EIO;
+  }
+  *crc = crc32_ieee_update(*crc, data, len);
+  return 0;
+}
+
+/* v3格式正文: 名称长度 + 名称 + 头部 + 字母表 + 打包下标，CRC覆盖全部正文 */
+static int learning_save_v3(ir_signal_stream_t *st,
+                            const ir_learned_signal_t *signal,
+                            const ir_timing_t *alphabet, uint8_t count) {
+  uint8_t name_len = strnlen(signal->name, sizeof(signal->name));
+  uint8_t bits = learning_index_bits(count);
+  uint32_t crc = 0;
+  int ret;
+
+  ret = ir_signal_stream_write(st, learning_file_magic_v3,
+                               sizeof(learning_file_magic_v3));
+  if (ret != sizeof(learning_file_magic_v3)) {
+    return ret < 0 ? ret : -ENOSPC;
+  }
+
+  ret = learning_write(st, &name_len, sizeof(name_len), &crc);
+  if (ret == 0) {
+    ret = learning_write(st, signal->name, name_len, &crc);
+  }
+  if (ret == 0) {
+    ret = learning_write(st, &signal->timing_count,
+                         sizeof(signal->timing_count), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_write(st, &signal->carrier_freq,
+                         sizeof(signal->carrier_freq), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_write(st, &signal->total_duration_us,
+                         sizeof(signal->total_duration_us), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_write(st, &count, sizeof(count), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_write(st, alphabet, count * sizeof(ir_timing_t), &crc);
+  }
+
+  /* 下标低位在前连续打包 */
+  uint8_t chunk[32];
+  size_t chunk_len = 0;
+  uint32_t acc = 0;
+  uint8_t acc_bits = 0;
+
+  for (uint16_t i = 0; ret == 0 && i < signal->timing_count; i++) {
+    acc |= (uint32_t)learning_nearest(alphabet, count, signal->timings[i])
+           << acc_bits;
+    acc_bits += bits;
+
+    while (acc_bits >= 8 || (i == signal->timing_count - 1 && acc_bits > 0)) {
+      chunk[chunk_len++] = acc & 0xFF;
+      acc >>= 8;
+      acc_bits = acc_bits >= 8 ? acc_bits - 8 : 0;
+
+      if (chunk_len == sizeof(chunk)) {
+        ret = learning_write(st, chunk, chunk_len, &crc);
+        chunk_len = 0;
+      }
+    }
+  }
+  if (ret == 0 && chunk_len > 0) {
+    ret = learning_write(st, chunk, chunk_len, &crc);
+  }
+
+  if (ret == 0) {
+    ret = ir_signal_stream_write(st, &crc, sizeof(crc));
+    ret = ret == sizeof(crc) ? 0 : (ret < 0 ? ret : -ENOSPC);
+  }
+  return ret;
+}
+
+/* v4格式正文: 名称长度 + 名称 + 载波 + 协议码，重放时重新编码 */
+static int learning_save_v4(ir_signal_stream_t *st,
+                            const ir_learned_signal_t *signal) {
+  uint8_t name_len = strnlen(signal->name, sizeof(signal->name));
+  uint16_t code[4] = {signal->code.protocol, signal->code.device,
+                      signal->code.subdevice, signal->code.function};
+  uint32_t crc = 0;
+  int ret;
+
+  ret = ir_signal_stream_write(st, learning_file_magic_v4,
+                               sizeof(learning_file_magic_v4));
+  if (ret != sizeof(learning_file_magic_v4)) {
+    return ret < 0 ? ret : -ENOSPC;
+  }
+
+  ret = learning_write(st, &name_len, sizeof(name_len), &crc);
+  if (ret == 0) {
+    ret = learning_write(st, signal->name, name_len, &crc);
+  }
+  if (ret == 0) {
+    ret = learning_write(st, &signal->carrier_freq,
+                         sizeof(signal->carrier_freq), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_write(st, code, sizeof(code), &crc);
+  }
+
+  if (ret == 0) {
+    ret = ir_signal_stream_write(st, &crc, sizeof(crc));
+    ret = ret == sizeof(crc) ? 0 : (ret < 0 ? ret : -ENOSPC);
+  }
+  return ret;
+}
+
+/* v5格式正文: 名称长度 + 名称 + 载波 + 编码/位数/帧数 + 时序参数 + 帧间隔
+ * + 码字，几十字节代替逐个时长 */
+static int learning_save_v5(ir_signal_stream_t *st,
+                            const ir_learned_signal_t *signal,
+                            const ir_infer_result_t *inferred) {
+  const irdb_protocol_params_t *p = &inferred->params;
+  uint8_t name_len = strnlen(signal->name, sizeof(signal->name));
+  uint8_t shape[5] = {p->coding, p->device_bits, p->subdevice_bits,
+                      p->function_bits, inferred->frames};
+  uint16_t timing[6] = {p->header_mark, p->header_space, p->bit_mark,
+                        p->bit_0_space, p->bit_1_space, p->trailer_mark};
+  uint16_t code[3] = {inferred->code.device, inferred->code.subdevice,
+                      inferred->code.function};
+  uint32_t crc = 0;
+  int ret;
+
+  ret = ir_signal_stream_write(st, learning_file_magic_v5,
+                               sizeof(learning_file_magic_v5));
+  if (ret != sizeof(learning_file_magic_v5)) {
+    return ret < 0 ? ret : -ENOSPC;
+  }
+
+  ret = learning_write(st, &name_len, sizeof(name_len), &crc);
+  if (ret == 0) {
+    ret = learning_write(st, signal->name, name_len, &crc);
+  }
+  if (ret == 0) {
+    ret = learning_write(st, &signal->carrier_freq,
+                         sizeof(signal->carrier_freq), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_write(st, shape, sizeof(shape), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_write(st, timing, sizeof(timing), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_write(st, &p->gap, sizeof(p->gap), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_write(st, code, sizeof(code), &crc);
+  }
+
+  if (ret == 0) {
+    ret = ir_signal_stream_write(st, &crc, sizeof(crc));
+    ret = ret == sizeof(crc) ? 0 : (ret < 0 ? ret : -ENOSPC);
+  }
+  return ret;
+}
+
+/* v2格式: 字母表放不下的信号(如噪声较多)原样保存 */
+static int learning_save_v2(ir_signal_stream_t *st,
+                            const ir_learned_signal_t *signal) {
+  uint32_t crc = 0; // v2不带CRC，借用learning_write检查每次写入
+
+  int ret = learning_write(st, learning_file_magic,
+                           sizeof(learning_file_magic), &crc);
+  if (ret == 0) {
+    ret = learning_write(st, signal->name, sizeof(signal->name), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_write(st, &signal->timing_count,
+                         sizeof(signal->timing_count), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_write(st, &signal->carrier_freq,
+                         sizeof(signal->carrier_freq), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_write(st, &signal->total_duration_us,
+                         sizeof(signal->total_duration_us), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_write(st, signal->timings,
+                         signal->timing_count * sizeof(ir_timing_t), &crc);
+  }
+  return ret;
+}
+
+/* 指纹索引 - "收到的帧是哪个学习信号"只需一次哈希查找加一次比对。
+ * 指纹取首帧(去掉末尾space)的时长类序列: 时长按相邻不超过
+ * LEARNING_FP_SPREAD_PCT的原则归类(与出现顺序无关)，按类从短到长编号，
+ * 类号序列做FNV-1a。同一按键的两次录制抖动落在同一类内，指纹相同 */
+#define LEARNING_FP_SPREAD_PCT 130 // 同类相邻时长的最大比例
+#define LEARNING_FP_CLASSES 16     // 类数上限，超过视为噪声不建指纹
+#define LEARNING_FP_SLOTS (2 * IR_SIGNAL_LIB_MAX)
+
+typedef struct {
+  uint32_t fingerprint;
+  char name[IR_SIGNAL_LIB_NAME_MAX];
+} learning_fp_entry_t;
+
+static struct {
+  learning_fp_entry_t entries[IR_SIGNAL_LIB_MAX];
+  uint16_t slots[LEARNING_FP_SLOTS]; // 条目下标+1，0为空
+  uint16_t count;
+  bool built; // 首次查找时扫描信号库建立
+  ir_timing_t *candidate; // 比对期间从时序缓冲池取得，加载候选信号
+} fp_index;
+
+static K_MUTEX_DEFINE(fp_mutex);
+
+static int learning_read_body(ir_signal_stream_t *st,
+                              ir_learned_signal_t *signal, bool legacy);
+
+/* 指纹比对的帧: 首帧，以space结尾时去掉该space (可能并入帧间隔) */
+static uint16_t learning_fp_frame(const ir_timing_t *timings, uint16_t count) {
+  uint16_t n = count;
+
+  for (uint16_t i = 1; i < count; i += 2) {
+    if (ir_timing_us(timings[i]) >= LEARNING_FRAME_GAP_US) {
+      n = i;
+      break;
+    }
+  }
+  return n - (n % 2 == 0 && n > 0);
+}
+
+/* 计算指纹，帧太短或时长类过多返回0 */
+static uint32_t learning_fingerprint(const ir_timing_t *timings,
+                                     uint16_t count) {
+  uint16_t frame = learning_fp_frame(timings, count);
+  uint32_t lo[LEARNING_FP_CLASSES];
+  uint32_t hi[LEARNING_FP_CLASSES];
+  uint8_t classes = 0;
+
+  if (frame < 3) {
+    return 0;
+  }
+
+  /* 每个时长覆盖[d, d*SPREAD]，重叠的区间合并为一类 */
+  for (uint16_t i = 0; i < frame; i++) {
+    uint32_t d = ir_timing_us(timings[i]);
+    uint32_t l = d;
+    uint32_t h = d * LEARNING_FP_SPREAD_PCT / 100;
+    uint8_t k = 0;
+
+    while (k < classes) {
+      if (lo[k] <= h && l <= hi[k]) {
+        l = MIN(l, lo[k]);
+        h = MAX(h, hi[k]);
+        lo[k] = lo[classes - 1];
+        hi[k] = hi[--classes];
+      } else {
+        k++;
+      }
+    }
+    if (classes == LEARNING_FP_CLASSES) {
+      return 0;
+    }
+    lo[classes] = l;
+    hi[classes++] = h;
+  }
+
+  uint32_t h = 2166136261u;
+  for (uint16_t i = 0; i < frame; i++) {
+    uint32_t d = ir_timing_us(timings[i]);
+    uint8_t rank = 0;
+    for (uint8_t k = 0; k < classes; k++) {
+      rank += hi[k] < d;
+    }
+    h = (h ^ rank) * 16777619u;
+  }
+  h = (h ^ frame) * 16777619u;
+  return h ? h : 1;
+}
+
+static void fp_slot_insert(uint16_t idx) {
+  uint32_t slot = fp_index.entries[idx].fingerprint % LEARNING_FP_SLOTS;
+  while (fp_index.slots[slot] != 0) {
+    slot = (slot + 1) % LEARNING_FP_SLOTS;
+  }
+  fp_index.slots[slot] = idx + 1;
+}
+
+/* 移除同名条目 - 末尾条目补位后重建槽 */
+static void fp_remove(const char *name) {
+  for (uint16_t i = 0; i < fp_index.count; i++) {
+    if (strcmp(fp_index.entries[i].name, name) != 0) {
+      continue;
+    }
+    fp_index.entries[i] = fp_index.entries[--fp_index.count];
+    memset(fp_index.slots, 0, sizeof(fp_index.slots));
+    for (uint16_t j = 0; j < fp_index.count; j++) {
+      fp_slot_insert(j);
+    }
+    return;
+  }
+}
+
+static void fp_add(const char *name, uint32_t fingerprint) {
+  if (fingerprint == 0 || fp_index.count == IR_SIGNAL_LIB_MAX) {
+    return;
+  }
+
+  learning_fp_entry_t *e = &fp_index.entries[fp_index.count];
+  e->fingerprint = fingerprint;
+  strncpy(e->name, name, sizeof(e->name) - 1);
+  e->name[sizeof(e->name) - 1] = '\0';
+  fp_slot_insert(fp_index.count++);
+}
+
+/* 加载信号到候选缓冲 (不打印日志，供建索引和比对使用) */
+static int fp_load(const char *name, ir_learned_signal_t *signal) {
+  ir_signal_stream_t *st;
+
+  memset(signal, 0, sizeof(*signal));
+  signal->timings = fp_index.candidate;
+
+  int ret = ir_signal_lib_read_begin(name, &st);
+  if (ret < 0) {
+    return ret;
+  }
+  ret = learning_read_body(st, signal, false);
+  ir_signal_lib_read_end();
+  return ret;
+}
+
+/* 扫描信号库，每个信号加载一次计算指纹 */
+static void fp_build(void) {
+  uint16_t count = ir_signal_lib_count();
+
+  fp_index.count = 0;
+  memset(fp_index.slots, 0, sizeof(fp_index.slots));
+
+  for (uint16_t i = 0; i < count; i++) {
+    char name[IR_SIGNAL_LIB_NAME_MAX];
+    ir_learned_signal_t signal;
+
+    if (ir_signal_lib_name(i, name, sizeof(name)) == 0 &&
+        fp_load(name, &signal) == 0) {
+      fp_add(name, learning_fingerprint(signal.timings, signal.timing_count));
+    }
+  }
+
+  fp_index.built = true;
+  LOG_INF("Fingerprint index: %u of %u signals", fp_index.count, count);
+}
+
+/* 保存/删除时更新索引 (未建立时留给首次查找) */
+static void learning_index_update(const char *name,
+                                  const ir_learned_signal_t *signal) {
+  k_mutex_lock(&fp_mutex, K_FOREVER);
+  if (fp_index.built) {
+    fp_remove(name);
+    if (signal) {
+      fp_add(name, learning_fingerprint(signal->timings, signal->timing_count));
+    }
+  }
+  k_mutex_unlock(&fp_mutex);
+}
+
+/* 候选确认: 首帧逐个时长比对。压缩保存的信号取的是聚类均值，容差按
+ * 较长一方的1/3，不小于LEARNING_MATCH_MIN_US */
+static bool fp_verify(const ir_timing_t *timings, uint16_t count,
+                      const ir_learned_signal_t *candidate) {
+  uint16_t frame = learning_fp_frame(timings, count);
+
+  if (learning_fp_frame(candidate->timings, candidate->timing_count) !=
+      frame) {
+    return false;
+  }
+
+  for (uint16_t i = 0; i < frame; i++) {
+    uint32_t a = ir_timing_us(timings[i]);
+    uint32_t b = ir_timing_us(candidate->timings[i]);
+    uint32_t tolerance = MAX(MAX(a, b) / 3, LEARNING_MATCH_MIN_US);
+    if ((a > b ? a - b : b - a) > tolerance) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int ir_learning_match(const ir_timing_t *timings, uint16_t count, char *name,
+                      size_t size) {
+  if (!timings || !name || size == 0) {
+    return -EINVAL;
+  }
+
+  uint32_t fingerprint = learning_fingerprint(timings, count);
+  if (fingerprint == 0) {
+    return -ENOENT;
+  }
+
+  learning_storage_open();
+  k_mutex_lock(&fp_mutex, K_FOREVER);
+  fp_index.candidate = ir_timing_buf_alloc();
+  if (!fp_index.candidate) {
+    k_mutex_unlock(&fp_mutex);
+    return -ENOMEM;
+  }
+  if (!fp_index.built) {
+    fp_build();
+  }
+
+  int ret = -ENOENT;
+  for (uint32_t i = 0, slot = fingerprint % LEARNING_FP_SLOTS;
+       i < LEARNING_FP_SLOTS; i++, slot = (slot + 1) % LEARNING_FP_SLOTS) {
+    uint16_t idx = fp_index.slots[slot];
+    if (idx == 0) {
+      break;
+    }
+
+    const learning_fp_entry_t *e = &fp_index.entries[idx - 1];
+    ir_learned_signal_t candidate;
+    if (e->fingerprint == fingerprint && fp_load(e->name, &candidate) == 0 &&
+        fp_verify(timings, count, &candidate)) {
+      strncpy(name, e->name, size - 1);
+      name[size - 1] = '\0';
+      ret = 0;
+      break;
+    }
+  }
+  ir_timing_buf_free(fp_index.candidate);
+  fp_index.candidate = NULL;
+  k_mutex_unlock(&fp_mutex);
+  return ret;
+}
+
+/* 热集 - 用过的学习信号解码后留在数据库堆中，加载和重放命中时不读
+ * flash。按字节预算淘汰：使用次数达到LEARNING_HOT_PIN_USES的信号钉住，
+ * 先按LRU淘汰未钉住的，全部钉住时才淘汰最久未用的钉住信号。条目带
+ * 引用计数，重放期间被覆盖或删除的在最后一次释放时回收 */
+#ifdef CONFIG_IR_LEARNING_HOT_BYTES
+#define LEARNING_HOT_BYTES CONFIG_IR_LEARNING_HOT_BYTES
+#else
+#define LEARNING_HOT_BYTES 4096
+#endif
+
+#ifdef CONFIG_IR_LEARNING_HOT_PIN_USES
+#define LEARNING_HOT_PIN_USES CONFIG_IR_LEARNING_HOT_PIN_USES
+#else
+#define LEARNING_HOT_PIN_USES 8
+#endif
+
+#define LEARNING_HOT_SLOTS 16
+
+typedef struct {
+  ir_learned_signal_t signal; // timings指向data
+  size_t cost;                // 计入预算的字节数
+  uint32_t last_access;       // 访问序号，按差值比较
+  uint32_t uses;              // 加载和重放次数
+  uint16_t refs;
+  bool valid; // 失效(覆盖、删除)后不再命中
+  ir_timing_t data[];
+} hot_entry_t;
+
+static struct {
+  hot_entry_t *slots[LEARNING_HOT_SLOTS];
+  size_t used;
+  uint32_t clock;
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t evictions;
+} hot;
+static K_MUTEX_DEFINE(hot_mutex);
+
+static bool hot_pinned(const hot_entry_t *e) {
+  return e->uses >= LEARNING_HOT_PIN_USES;
+}
+
+/* 调用者持有hot_mutex */
+static int hot_find(const char *name) {
+  for (int i = 0; i < ARRAY_SIZE(hot.slots); i++) {
+    if (hot.slots[i] && strcmp(hot.slots[i]->signal.name, name) == 0) {
+      return i;
+    }
+  }
+  return -ENOENT;
+}
+
+static int hot_find_free(void) {
+  for (int i = 0; i < ARRAY_SIZE(hot.slots); i++) {
+    if (!hot.slots[i]) {
+      return i;
+    }
+  }
+  return -ENOSPC;
+}
+
+static void hot_free(hot_entry_t *e) {
+  hot.used -= e->cost;
+  irdb_heap_free(e);
+}
+
+/* 移出热集，没有引用时立即回收。调用者持有hot_mutex */
+static void hot_remove(int slot) {
+  hot_entry_t *e = hot.slots[slot];
+
+  hot.slots[slot] = NULL;
+  e->valid = false;
+  if (e->refs == 0) {
+    hot_free(e);
+  }
+}
+
+/* 淘汰一个未被引用的条目，没有可淘汰的返回false。调用者持有hot_mutex */
+static bool hot_evict(void) {
+  int victim = -1;
+
+  for (int i = 0; i < ARRAY_SIZE(hot.slots); i++) {
+    const hot_entry_t *e = hot.slots[i];
+
+    if (!e || e->refs > 0) {
+      continue;
+    }
+    if (victim < 0) {
+      victim = i;
+      continue;
+    }
+
+    const hot_entry_t *v = hot.slots[victim];
+    if (hot_pinned(v) != hot_pinned(e)) {
+      victim = hot_pinned(v) ? i : victim;
+    } else if ((int32_t)(e->last_access - v->last_access) < 0) {
+      victim = i;
+    }
+  }
+
+  if (victim < 0) {
+    return false;
+  }
+  hot_remove(victim);
+  hot.evictions++;
+  return true;
+}
+
+/* 命中时加引用，count为真时计一次使用 */
+static hot_entry_t *hot_get(const char *name, bool count) {
+  hot_entry_t *e = NULL;
+
+  k_mutex_lock(&hot_mutex, K_FOREVER);
+  int slot = hot_find(name);
+  if (slot >= 0) {
+    e = hot.slots[slot];
+    e->refs++;
+    e->last_access = ++hot.clock;
+    e->uses += count;
+  }
+  if (count && e) {
+    hot.hits++;
+  } else if (count) {
+    hot.misses++;
+  }
+  k_mutex_unlock(&hot_mutex);
+  return e;
+}
+
+static void hot_release(hot_entry_t *e) {
+  k_mutex_lock(&hot_mutex, K_FOREVER);
+  if (--e->refs == 0 && !e->valid) {
+    hot_free(e);
+  }
+  k_mutex_unlock(&hot_mutex);
+}
+
+/* 从flash加载的信号放入热集，放不下时不放 */
+static void hot_put(const ir_learned_signal_t *signal, const char *name) {
+  size_t timings = signal->timing_count;
+  size_t cost = sizeof(hot_entry_t) + timings * sizeof(ir_timing_t);
+
+  if (LEARNING_HOT_BYTES == 0 || cost > LEARNING_HOT_BYTES) {
+    return;
+  }
+
+  k_mutex_lock(&hot_mutex, K_FOREVER);
+  int slot = hot_find(name);
+  if (slot >= 0) {
+    hot_remove(slot);
+  }
+
+  while (hot.used + cost > LEARNING_HOT_BYTES || hot_find_free() < 0) {
+    if (!hot_evict()) {
+      k_mutex_unlock(&hot_mutex);
+      return;
+    }
+  }
+
+  hot_entry_t *e = irdb_heap_alloc(cost);
+  if (e) {
+    e->signal = *signal;
+    e->signal.timings = e->data;
+    e->signal.timing_count = timings;
+    strncpy(e->signal.name, name, sizeof(e->signal.name) - 1);
+    e->signal.name[sizeof(e->signal.name) - 1] = '\0';
+    memcpy(e->data, signal->timings, timings * sizeof(ir_timing_t));
+    e->cost = cost;
+    e->last_access = ++hot.clock;
+    e->uses = 1;
+    e->refs = 0;
+    e->valid = true;
+    hot.slots[hot_find_free()] = e;
+    hot.used += cost;
+  }
+  k_mutex_unlock(&hot_mutex);
+}
+
+/* 信号被覆盖或删除 */
+static void hot_invalidate(const char *name) {
+  k_mutex_lock(&hot_mutex, K_FOREVER);
+  int slot = hot_find(name);
+  if (slot >= 0) {
+    hot_remove(slot);
+  }
+  k_mutex_unlock(&hot_mutex);
+}
+
+/* 保存学习的信号 - 追加到信号库，同名信号被覆盖 */
+int ir_learning_save(const ir_learned_signal_t *signal, const char *name) {
+  if (!signal || !signal->valid || !name) {
+    return -EINVAL;
+  }
+
+  /* 未识别的信号先尝试推断协议参数，失败再按字母表压缩 */
+  ir_infer_result_t inferred;
+  bool infer = !signal->parametric &&
+               ir_infer_protocol(signal->timings, signal->timing_count,
+                                 signal->carrier_freq, &inferred) == 0;
+
+  ir_timing_t alphabet[LEARNING_ALPHABET_MAX];
+  uint8_t count = 0;
+  bool compact = !signal->parametric && !infer &&
+                 learning_build_alphabet(signal, alphabet, &count) == 0 &&
+                 count > 0;
+
+  learning_storage_open();
+
+  ir_signal_stream_t *st;
+  int ret = ir_signal_lib_write_begin(name, &st);
+  if (ret < 0) {
+    LOG_ERR("Failed to add %s to signal library: %d", name, ret);
+    return ret;
+  }
+
+  if (signal->parametric) {
+    ret = learning_save_v4(st, signal);
+  } else if (infer) {
+    ret = learning_save_v5(st, signal, &inferred);
+  } else {
+    ret = compact ? learning_save_v3(st, signal, alphabet, count)
+                  : learning_save_v2(st, signal);
+  }
+  size_t size = st->pos;
+
+  int commit = ir_signal_lib_write_end(ret == 0);
+  ret = ret < 0 ? ret : commit;
+  if (ret < 0) {
+    LOG_ERR("Failed to write %s: %d", name, ret);
+    return ret;
+  }
+
+  learning_index_update(name, signal);
+  hot_invalidate(name);
+
+  if (signal->parametric) {
+    LOG_INF("Signal saved: %s (%d bytes, protocol %u)", name, (int)size,
+            signal->code.protocol);
+  } else if (infer) {
+    LOG_INF("Signal saved: %s (%d bytes, inferred %s, %u bits)", name,
+            (int)size, ir_infer_coding_name(inferred.params.coding),
+            inferred.bits);
+  } else {
+    LOG_INF("Signal saved: %s (%d bytes, %u symbols)", name, (int)size,
+            compact ? count : 0);
+  }
+  return 0;
+}
+
+/* 读取v3正文，校验CRC */
+static int learning_load_v3(ir_signal_stream_t *st,
+                            ir_learned_signal_t *signal) {
+  ir_timing_t alphabet[LEARNING_ALPHABET_MAX];
+  uint8_t name_len = 0;
+  uint8_t count = 0;
+  uint32_t crc = 0;
+  uint32_t stored_crc;
+
+  memset(signal->name, 0, sizeof(signal->name));
+
+  int ret = learning_read(st, &name_len, sizeof(name_len), &crc);
+  if (ret == 0 && name_len >= sizeof(signal->name)) {
+    ret = -EINVAL;
+  }
+  if (ret == 0) {
+    ret = learning_read(st, signal->name, name_len, &crc);
+  }
+  if (ret == 0) {
+    ret = learning_read(st, &signal->timing_count,
+                        sizeof(signal->timing_count), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_read(st, &signal->carrier_freq,
+                        sizeof(signal->carrier_freq), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_read(st, &signal->total_duration_us,
+                        sizeof(signal->total_duration_us), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_read(st, &count, sizeof(count), &crc);
+  }
+  if (ret == 0 && (count == 0 || count > LEARNING_ALPHABET_MAX ||
+                   signal->timing_count > IR_LEARNING_MAX_EDGES)) {
+    ret = -EINVAL;
+  }
+  if (ret == 0) {
+    ret = learning_read(st, alphabet, count * sizeof(ir_timing_t), &crc);
+  }
+
+  /* 按位解包下标 */
+  uint8_t bits = learning_index_bits(count);
+  uint8_t mask = (1U << bits) - 1;
+  uint8_t chunk[32];
+  size_t chunk_len = 0;
+  size_t chunk_pos = 0;
+  size_t remaining = (signal->timing_count * bits + 7) / 8;
+  uint32_t acc = 0;
+  uint8_t acc_bits = 0;
+
+  for (uint16_t i = 0; ret == 0 && i < signal->timing_count; i++) {
+    while (ret == 0 && acc_bits < bits) {
+      if (chunk_pos == chunk_len) {
+        chunk_len = MIN(remaining, sizeof(chunk));
+        chunk_pos = 0;
+        remaining -= chunk_len;
+        ret = chunk_len ? learning_read(st, chunk, chunk_len, &crc) : -EIO;
+        if (ret < 0) {
+          break;
+        }
+      }
+      acc |= (uint32_t)chunk[chunk_pos++] << acc_bits;
+      acc_bits += 8;
+    }
+    if (ret < 0) {
+      break;
+    }
+
+    uint8_t k = acc & mask;
+    acc >>= bits;
+    acc_bits -= bits;
+    if (k >= count) {
+      ret = -EINVAL;
+      break;
+    }
+    signal->timings[i] = alphabet[k];
+  }
+
+  if (ret == 0) {
+    ssize_t n = ir_signal_stream_read(st, &stored_crc, sizeof(stored_crc));
+    ret = n == sizeof(stored_crc) ? 0 : -EIO;
+  }
+  if (ret == 0 && stored_crc != crc) {
+    ret = -EBADMSG;
+  }
+  return ret;
+}
+
+/* 读取v4正文，重新编码出时序供导出、分析和比较使用 */
+static int learning_load_v4(ir_signal_stream_t *st,
+                            ir_learned_signal_t *signal) {
+  uint8_t name_len = 0;
+  uint16_t code[4];
+  uint32_t crc = 0;
+  uint32_t stored_crc;
+
+  memset(signal->name, 0, sizeof(signal->name));
+
+  int ret = learning_read(st, &name_len, sizeof(name_len), &crc);
+  if (ret == 0 && name_len >= sizeof(signal->name)) {
+    ret = -EINVAL;
+  }
+  if (ret == 0) {
+    ret = learning_read(st, signal->name, name_len, &crc);
+  }
+  if (ret == 0) {
+    ret = learning_read(st, &signal->carrier_freq,
+                        sizeof(signal->carrier_freq), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_read(st, code, sizeof(code), &crc);
+  }
+  if (ret == 0) {
+    ssize_t n = ir_signal_stream_read(st, &stored_crc, sizeof(stored_crc));
+    ret = n == sizeof(stored_crc) ? 0 : -EIO;
+  }
+  if (ret == 0 && stored_crc != crc) {
+    ret = -EBADMSG;
+  }
+  if (ret < 0) {
+    return ret;
+  }
+
+  memset(&signal->code, 0, sizeof(signal->code));
+  signal->code.protocol = code[0];
+  signal->code.device = code[1];
+  signal->code.subdevice = code[2];
+  signal->code.function = code[3];
+
+  uint32_t count = 0;
+  ret = irdb_encode_to_raw(&signal->code, signal->timings, &count,
+                           IR_LEARNING_MAX_EDGES);
+  if (ret < 0) {
+    return ret;
+  }
+
+  signal->timing_count = count;
+  signal->total_duration_us = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    signal->total_duration_us += ir_timing_us(signal->timings[i]);
+  }
+  signal->parametric = true;
+  return 0;
+}
+
+/* 读取v5正文，按推断的参数重新编码出时序 */
+static int learning_load_v5(ir_signal_stream_t *st,
+                            ir_learned_signal_t *signal) {
+  ir_infer_result_t inferred;
+  irdb_protocol_params_t *p = &inferred.params;
+  uint8_t name_len = 0;
+  uint8_t shape[5];
+  uint16_t timing[6];
+  uint16_t code[3];
+  uint32_t crc = 0;
+  uint32_t stored_crc;
+
+  memset(signal->name, 0, sizeof(signal->name));
+  memset(&inferred, 0, sizeof(inferred));
+
+  int ret = learning_read(st, &name_len, sizeof(name_len), &crc);
+  if (ret == 0 && name_len >= sizeof(signal->name)) {
+    ret = -EINVAL;
+  }
+  if (ret == 0) {
+    ret = learning_read(st, signal->name, name_len, &crc);
+  }
+  if (ret == 0) {
+    ret = learning_read(st, &signal->carrier_freq,
+                        sizeof(signal->carrier_freq), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_read(st, shape, sizeof(shape), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_read(st, timing, sizeof(timing), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_read(st, &p->gap, sizeof(p->gap), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_read(st, code, sizeof(code), &crc);
+  }
+  if (ret == 0) {
+    ssize_t n = ir_signal_stream_read(st, &stored_crc, sizeof(stored_crc));
+    ret = n == sizeof(stored_crc) ? 0 : -EIO;
+  }
+  if (ret == 0 && stored_crc != crc) {
+    ret = -EBADMSG;
+  }
+  if (ret == 0 && (shape[0] > IRDB_CODING_BIPHASE ||
+                   shape[1] + shape[2] + shape[3] > IR_INFER_MAX_BITS)) {
+    ret = -EINVAL;
+  }
+  if (ret < 0) {
     return ret;
   }
 
-  /* 写入头部信息 */
-  fs_write(&file, signal->name, sizeof(signal->name));
-  fs_write(&file, &signal->timing_count, sizeof(signal->timing_count));
-  fs_write(&file, &signal->carrier_freq, sizeof(signal->carrier_freq));
-  fs_write(&file, &signal->total_duration_us,
-           sizeof(signal->total_duration_us));
-
-  /* 写入时序数据 */
-  fs_write(&file, signal->timings, signal->timing_count * sizeof(uint32_t));
-
-  fs_close(&file);
+  p->coding = shape[0];
+  p->device_bits = shape[1];
+  p->subdevice_bits = shape[2];
+  p->function_bits = shape[3];
+  inferred.frames = shape[4];
+  p->header_mark = timing[0];
+  p->header_space = timing[1];
+  p->bit_mark = timing[2];
+  p->bit_0_space = timing[3];
+  p->bit_1_space = timing[4];
+  p->trailer_mark = timing[5];
+  inferred.code.device = code[0];
+  inferred.code.subdevice = code[1];
+  inferred.code.function = code[2];
+
+  uint32_t count = 0;
+  ret = ir_infer_encode(&inferred, signal->timings, &count,
+                        IR_LEARNING_MAX_EDGES);
+  if (ret < 0) {
+    return ret;
+  }
 
-  LOG_INF("Signal saved: %s (%u bytes)", name,
-          signal->timing_count * sizeof(uint32_t));
+  signal->timing_count = count;
+  signal->total_duration_us = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    signal->total_duration_us += ir_timing_us(signal->timings[i]);
+  }
   return 0;
 }
 
-/* 从存储加载信号 */
-int ir_learning_load(ir_learned_signal_t *signal, const char *name) {
-  if (!signal || !name) {
-    return -EINVAL;
+/* 按魔数读取正文；legacy为true时无魔数的内容按旧格式从文件头重读 */
+static int learning_read_body(ir_signal_stream_t *st,
+                              ir_learned_signal_t *signal, bool legacy) {
+  uint8_t magic[sizeof(learning_file_magic)];
+  bool has_magic = ir_signal_stream_read(st, magic, sizeof(magic)) == sizeof(magic);
+
+  signal->parametric = false;
+
+  if (has_magic && memcmp(magic, learning_file_magic_v5, sizeof(magic)) == 0) {
+    return learning_load_v5(st, signal);
+  }
+  if (has_magic && memcmp(magic, learning_file_magic_v4, sizeof(magic)) == 0) {
+    return learning_load_v4(st, signal);
+  }
+  if (has_magic && memcmp(magic, learning_file_magic_v3, sizeof(magic)) == 0) {
+    return learning_load_v3(st, signal);
+  }
+
+  bool v2 = has_magic && memcmp(magic, learning_file_magic, sizeof(magic)) == 0;
+  if (!v2) {
+    if (!legacy) {
+      return -EBADMSG;
+    }
+    ir_signal_stream_rewind(st);
+  }
+
+  /* v2和旧格式无校验，至少确认长度完整 */
+  uint32_t crc = 0;
+  int ret = learning_read(st, signal->name, sizeof(signal->name), &crc);
+  if (ret == 0) {
+    ret = learning_read(st, &signal->timing_count,
+                        sizeof(signal->timing_count), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_read(st, &signal->carrier_freq,
+                        sizeof(signal->carrier_freq), &crc);
+  }
+  if (ret == 0) {
+    ret = learning_read(st, &signal->total_duration_us,
+                        sizeof(signal->total_duration_us), &crc);
+  }
+  if (ret == 0 && signal->timing_count > IR_LEARNING_MAX_EDGES) {
+    ret = -EINVAL;
+  }
+  signal->name[sizeof(signal->name) - 1] = '\0';
+
+  if (ret == 0 && !v2) {
+    /* 旧格式逐个转换 */
+    for (uint16_t i = 0; ret == 0 && i < signal->timing_count; i++) {
+      uint32_t us = 0;
+      ret = learning_read(st, &us, sizeof(us), &crc);
+      signal->timings[i] = ir_timing_pack(us);
+    }
+  } else if (ret == 0) {
+    ret = learning_read(st, signal->timings,
+                        signal->timing_count * sizeof(ir_timing_t), &crc);
   }
+  return ret;
+}
 
-  char filepath[128];
-  snprintf(filepath, sizeof(filepath), "%s/%s.dat", LEARNING_STORAGE_PATH,
-           name);
+/* 从flash读出信号 */
+static int learning_load_flash(ir_learned_signal_t *signal, const char *name) {
+  learning_save_wait();
+  learning_storage_open();
+
+  ir_signal_stream_t *st;
+  int ret = ir_signal_lib_read_begin(name, &st);
+  if (ret < 0) {
+    LOG_ERR("Signal not found: %s (%d)", name, ret);
+    return ret;
+  }
 
-  struct fs_file_t file;
-  fs_file_t_init(&file);
+  ret = learning_read_body(st, signal, false);
+  ir_signal_lib_read_end();
 
-  int ret = fs_open(&file, filepath, FS_O_READ);
   if (ret < 0) {
-    LOG_ERR("Failed to open file: %d", ret);
+    LOG_ERR("Corrupt signal %s: %d", name, ret);
+    signal->valid = false;
     return ret;
   }
 
-  /* 读取头部 */
-  fs_read(&file, signal->name, sizeof(signal->name));
-  fs_read(&file, &signal->timing_count, sizeof(signal->timing_count));
-  fs_read(&file, &signal->carrier_freq, sizeof(signal->carrier_freq));
-  fs_read(&file, &signal->total_duration_us, sizeof(signal->total_duration_us));
+  signal->valid = true;
+  signal->repeat_period_us = 0; // 不保存，重放时从时序中的帧间隔得出
+  hot_put(signal, name);
+  LOG_INF("Signal loaded: %s", name);
+  return 0;
+}
+
+/* 从存储加载信号 - 热集命中时从RAM拷贝 */
+int ir_learning_load(ir_learned_signal_t *signal, const char *name) {
+  if (!signal || !name) {
+    return -EINVAL;
+  }
 
-  /* 分配并读取时序数据 */
+  /* 分配时序缓冲区 */
   if (!signal->timings) {
-    signal->timings = k_malloc(IR_LEARNING_MAX_EDGES * sizeof(uint32_t));
+    signal->timings = ir_timing_buf_alloc();
     if (!signal->timings) {
-      fs_close(&file);
       return -ENOMEM;
     }
   }
 
-  fs_read(&file, signal->timings, signal->timing_count * sizeof(uint32_t));
+  hot_entry_t *e = hot_get(name, true);
+  if (!e) {
+    return learning_load_flash(signal, name);
+  }
 
-  fs_close(&file);
-  signal->valid = true;
+  ir_timing_t *timings = signal->timings;
+  *signal = e->signal;
+  signal->timings = timings;
+  memcpy(timings, e->data, e->signal.timing_count * sizeof(ir_timing_t));
+  hot_release(e);
+  return 0;
+}
 
-  LOG_INF("Signal loaded: %s", name);
+/* 按名称重放 - 直接从热集条目发送，不需要时序缓冲；未命中时先从flash
+ * 载入热集，放不进热集(预算不足或已关闭)时借一块时序缓冲 */
+int ir_learning_replay_name(const char *name, uint32_t repeat_count) {
+  if (!name) {
+    return -EINVAL;
+  }
+
+  hot_entry_t *e = hot_get(name, true);
+  if (!e) {
+    ir_learned_signal_t signal = {.timings = ir_timing_buf_alloc()};
+    if (!signal.timings) {
+      return -ENOMEM;
+    }
+
+    int ret = learning_load_flash(&signal, name);
+    if (ret == 0) {
+      e = hot_get(name, false);
+      if (!e) {
+        ret = ir_learning_replay(&signal, repeat_count);
+      }
+    }
+    ir_timing_buf_free(signal.timings);
+    if (!e) {
+      return ret;
+    }
+  }
+
+  int ret = ir_learning_replay(&e->signal, repeat_count);
+  hot_release(e);
+  return ret;
+}
+
+/* 预载入热集 */
+int ir_learning_hot_preload(const char *name) {
+  if (!name) {
+    return -EINVAL;
+  }
+
+  hot_entry_t *e = hot_get(name, false);
+  if (e) {
+    hot_release(e);
+    return 0;
+  }
+
+  ir_learned_signal_t signal = {.timings = ir_timing_buf_alloc()};
+  if (!signal.timings) {
+    return -ENOMEM;
+  }
+
+  int ret = learning_load_flash(&signal, name);
+  ir_timing_buf_free(signal.timings);
+  if (ret < 0) {
+    return ret;
+  }
+
+  e = hot_get(name, false);
+  if (!e) {
+    return -ENOSPC;
+  }
+  hot_release(e);
   return 0;
 }
 
+void ir_learning_hot_get_stats(ir_learning_hot_stats_t *stats) {
+  memset(stats, 0, sizeof(*stats));
+
+  k_mutex_lock(&hot_mutex, K_FOREVER);
+  stats->hits = hot.hits;
+  stats->misses = hot.misses;
+  stats->evictions = hot.evictions;
+  stats->bytes = hot.used;
+  for (int i = 0; i < ARRAY_SIZE(hot.slots); i++) {
+    if (hot.slots[i]) {
+      stats->signals++;
+      stats->pinned += hot_pinned(hot.slots[i]);
+    }
+  }
+  k_mutex_unlock(&hot_mutex);
+}
+
 /* 删除信号 */
 int ir_learning_delete(const char *name) {
   if (!name) {
     return -EINVAL;
   }
 
-  char filepath[128];
-  snprintf(filepath, sizeof(filepath), "%s/%s.dat", LEARNING_STORAGE_PATH,
-           name);
+  learning_save_wait();
+  learning_storage_open();
 
-  int ret = fs_unlink(filepath);
+  int ret = ir_signal_lib_delete(name);
   if (ret < 0) {
     LOG_ERR("Failed to delete: %d", ret);
     return ret;
   }
 
+  learning_index_update(name, NULL);
+  hot_invalidate(name);
   LOG_INF("Signal deleted: %s", name);
   return 0;
 }
 
-/* 列出所有信号 */
+void ir_learning_iter_init(ir_learning_iter_t *it) {
+  it->index = 0;
+  it->started = false;
+}
+
+/* 游标取名称 - 按信号库索引下标前进，不必一次列出全部 */
+int ir_learning_iter_next(ir_learning_iter_t *it, char *name, size_t size) {
+  if (!it || !name || size == 0) {
+    return -EINVAL;
+  }
+
+  if (!it->started) {
+    learning_save_wait();
+    learning_storage_open();
+    it->started = true;
+  }
+
+  /* 读取失败的条目跳过 */
+  while (it->index < ir_signal_lib_count()) {
+    if (ir_signal_lib_name(it->index++, name, size) == 0) {
+      return 0;
+    }
+  }
+  return -ENOENT;
+}
+
+/* 列出所有信号 - 名称来自信号库索引，无需遍历目录；放不下时截断 */
 int ir_learning_list(char *buf, size_t buf_size) {
-  if (!buf) {
+  if (!buf || buf_size == 0) {
     return -EINVAL;
   }
 
-  struct fs_dir_t dir;
-  fs_dir_t_init(&dir);
+  ir_learning_iter_t it;
+  char name[IR_SIGNAL_LIB_NAME_MAX];
+  size_t offset = snprintf(buf, buf_size, "Learned signals:\n");
 
-  int ret = fs_opendir(&dir, LEARNING_STORAGE_PATH);
-  if (ret < 0) {
-    return ret;
+  ir_learning_iter_init(&it);
+  while (offset + 1 < buf_size &&
+         ir_learning_iter_next(&it, name, sizeof(name)) == 0) {
+    offset += snprintf(buf + offset, buf_size - offset, "  %s\n", name);
   }
 
-  size_t offset = 0;
-  offset += snprintf(buf + offset, buf_size - offset, "Learned signals:\n");
+  return 0;
+}
 
+#ifdef CONFIG_FILE_SYSTEM
+/* 旧版每信号一个文件(LEARNING_STORAGE_PATH/<name>.dat)，导入信号库后删除。
+ * 导入失败的文件改名为.old保留 */
+static void learning_migrate(void) {
+  ir_learned_signal_t signal = {0};
+  struct fs_dir_t dir;
   struct fs_dirent entry;
-  while (fs_readdir(&dir, &entry) == 0 && entry.name[0] != '\0') {
-    if (entry.type == FS_DIR_ENTRY_FILE) {
-      /* 去除 .dat 后缀 */
-      char *dot = strrchr(entry.name, '.');
-      if (dot)
-        *dot = '\0';
+  uint16_t migrated = 0;
+
+  for (;;) {
+    char name[IR_SIGNAL_LIB_NAME_MAX] = "";
+
+    /* 每次只取一个文件，避免边遍历边删除 */
+    fs_dir_t_init(&dir);
+    if (fs_opendir(&dir, LEARNING_STORAGE_PATH) < 0) {
+      break;
+    }
+    while (fs_readdir(&dir, &entry) == 0 && entry.name[0] != '\0') {
+      size_t len = strlen(entry.name);
+      if (entry.type == FS_DIR_ENTRY_FILE && len > 4 &&
+          len - 4 < sizeof(name) && strcmp(entry.name + len - 4, ".dat") == 0) {
+        memcpy(name, entry.name, len - 4);
+        name[len - 4] = '\0';
+        break;
+      }
+    }
+    fs_closedir(&dir);
+
+    if (name[0] == '\0') {
+      break;
+    }
+
+    /* 读取缓冲只在确有旧文件时分配，不借用正在学习的信号 */
+    if (!signal.timings) {
+      signal.timings = ir_timing_buf_alloc();
+      if (!signal.timings) {
+        LOG_ERR("No memory to migrate %s", name);
+        break;
+      }
+    }
+
+    char path[128];
+    struct fs_file_t file;
+    snprintf(path, sizeof(path), "%s/%s.dat", LEARNING_STORAGE_PATH, name);
+    fs_file_t_init(&file);
+
+    int ret = fs_open(&file, path, FS_O_READ);
+    if (ret == 0) {
+      ir_signal_stream_t st = {.file = &file};
+      ret = learning_read_body(&st, &signal, true);
+      fs_close(&file);
+    }
+    if (ret == 0) {
+      signal.valid = true;
+      ret = ir_learning_save(&signal, name);
+    }
 
-      offset += snprintf(buf + offset, buf_size - offset, "  %s\n", entry.name);
+    if (ret == 0) {
+      fs_unlink(path);
+      migrated++;
+    } else {
+      char old[128];
+      snprintf(old, sizeof(old), "%s/%s.old", LEARNING_STORAGE_PATH, name);
+      LOG_WRN("Failed to migrate %s: %d", path, ret);
+      fs_rename(path, old);
     }
   }
 
-  fs_closedir(&dir);
-  return 0;
+  ir_timing_buf_free(signal.timings);
+
+  /* 目录为空时才能删除 */
+  fs_unlink(LEARNING_STORAGE_PATH);
+  if (migrated > 0) {
+    LOG_INF("Migrated %u signals into the signal library", migrated);
+  }
 }
+#endif /* CONFIG_FILE_SYSTEM */
 #else
 int ir_learning_save(const ir_learned_signal_t *signal, const char *name) {
-  LOG_ERR("File system not enabled");
+  LOG_ERR("Signal storage not enabled");
   return -ENOTSUP;
 }
 
 int ir_learning_load(ir_learned_signal_t *signal, const char *name) {
-  LOG_ERR("File system not enabled");
+  LOG_ERR("Signal storage not enabled");
   return -ENOTSUP;
 }
 
 int ir_learning_delete(const char *name) {
-  LOG_ERR("File system not enabled");
+  LOG_ERR("Signal storage not enabled");
   return -ENOTSUP;
 }
 
 int ir_learning_list(char *buf, size_t buf_size) {
   if (buf && buf_size > 0) {
-    snprintf(buf, buf_size, "File system not enabled\n");
+    snprintf(buf, buf_size, "Signal storage not enabled\n");
   }
   return -ENOTSUP;
 }
+
+void ir_learning_iter_init(ir_learning_iter_t *it) {
+  it->index = 0;
+  it->started = false;
+}
+
+int ir_learning_iter_next(ir_learning_iter_t *it, char *name, size_t size) {
+  return -ENOTSUP;
+}
+
+int ir_learning_replay_name(const char *name, uint32_t repeat_count) {
+  return -ENOTSUP;
+}
+
+int ir_learning_hot_preload(const char *name) { return -ENOTSUP; }
+
+void ir_learning_hot_get_stats(ir_learning_hot_stats_t *stats) {
+  memset(stats, 0, sizeof(*stats));
+}
+
+int ir_learning_match(const ir_timing_t *timings, uint16_t count, char *name,
+                      size_t size) {
+  return -ENOTSUP;
+}
+
+int ir_learning_save_async(const ir_learned_signal_t *signal,
+                           const char *name, ir_learning_save_cb_t cb,
+                           void *user_data) {
+  return -ENOTSUP;
+}
+
+void ir_learning_save_flush(void) {}
 #endif
 
 /* 导出为原始格式 */
@@ -460,105 +2331,454 @@ int ir_learning_export_raw(const ir_learned_signal_t *signal, char *buf,
 
   for (uint16_t i = 0; i < signal->timing_count && offset < buf_size; i++) {
     offset +=
-        snprintf(buf + offset, buf_size - offset, "%u\n", signal->timings[i]);
+        snprintf(buf + offset, buf_size - offset, "%u\n",
+                 ir_timing_us(signal->timings[i]));
   }
 
   return 0;
 }
 
-/* 分析信号 */
-int ir_learning_analyze(const ir_learned_signal_t *signal,
-                        ir_signal_analysis_t *analysis) {
-  if (!signal || !signal->valid || !analysis) {
+/* 导出为Pronto学习码 - 已识别的协议按协议码生成(含重复码)，
+ * 其余整段作为单次序列，lead-out补足到重放周期 */
+int ir_learning_export_pronto(const ir_learned_signal_t *signal, char *buf,
+                              size_t buf_size) {
+  if (!signal || !signal->valid || !buf) {
     return -EINVAL;
   }
 
-  memset(analysis, 0, sizeof(ir_signal_analysis_t));
-
-  uint64_t mark_sum = 0, space_sum = 0;
-  uint32_t mark_count = 0, space_count = 0;
+  if (signal->parametric) {
+    return irdb_encode_pronto(&signal->code, buf, buf_size);
+  }
 
-  analysis->min_pulse = UINT32_MAX;
-  analysis->max_pulse = 0;
-  analysis->pulse_count = signal->timing_count;
+  uint32_t carrier = signal->carrier_freq > 0 ? signal->carrier_freq : 38000;
+  uint32_t lead_out = ir_learning_replay_period_us(signal);
 
   for (uint16_t i = 0; i < signal->timing_count; i++) {
-    uint32_t duration = signal->timings[i];
+    lead_out -= ir_timing_us(signal->timings[i]);
+  }
+  return irdb_pronto_from_raw(signal->timings, signal->timing_count, NULL, 0,
+                              carrier, lead_out, buf, buf_size);
+}
+
+/* 导入 - 直接解析进signal->timings，不经中间数组。支持的格式:
+ *   ir_learning_export_raw()的导出: "# IR Signal:"/"# Edges:"注释 + 每行一个微秒值
+ *   IrScrutinizer raw: "Freq=38000Hz[+9024,-4512,...]" 或 "+9024 -4512 ..."
+ *   Pronto hex: "0000 006D 0022 0002 ..." (仅学习码0000)
+ * 遇到第二个"# IR Signal:"标题即停止，next返回其位置供批量导入继续 */
+#define LEARNING_IMPORT_HEADER "# IR Signal:"
+
+static bool import_is_sep(char c) {
+  return c == ' ' || c == '\t' || c == ',' || c == ';' || c == '[' ||
+         c == ']' || c == '+' || c == '-';
+}
+
+static int import_section(ir_learned_signal_t *signal, const char *text,
+                          const char **next) {
+  const char *p = text;
+  bool have_header = false;
+
+  signal->timing_count = 0;
+  signal->carrier_freq = 0;
+
+  while (*p) {
+    const char *line = p;
+    const char *eol = strchr(p, '\n');
+    if (!eol) {
+      eol = p + strlen(p);
+    }
+    p = *eol ? eol + 1 : eol;
+
+    while (line < eol && (*line == ' ' || *line == '\t')) {
+      line++;
+    }
+
+    if (*line == '#') {
+      size_t hlen = strlen(LEARNING_IMPORT_HEADER);
+      if (strncmp(line, LEARNING_IMPORT_HEADER, hlen) == 0) {
+        if (have_header || signal->timing_count > 0) {
+          p = line;
+          break;
+        }
+        const char *name = line + hlen;
+        while (name < eol && *name == ' ') {
+          name++;
+        }
+        size_t len = eol - name;
+        while (len > 0 && (name[len - 1] == '\r' || name[len - 1] == ' ')) {
+          len--;
+        }
+        len = MIN(len, sizeof(signal->name) - 1);
+        memcpy(signal->name, name, len);
+        signal->name[len] = '\0';
+        have_header = true;
+      } else {
+        const char *carrier = strstr(line, "Carrier:");
+        if (carrier && carrier < eol) {
+          signal->carrier_freq = strtoul(carrier + 8, NULL, 10);
+        }
+      }
+      continue;
+    }
 
-    if (duration < analysis->min_pulse) {
-      analysis->min_pulse = duration;
+    /* Pronto: 首个数据行以补零的4位十六进制字开头 (如"0000 006D") */
+    if (signal->timing_count == 0 && eol - line >= 5 && line[0] == '0' &&
+        isxdigit((unsigned char)line[1]) && isxdigit((unsigned char)line[2]) &&
+        isxdigit((unsigned char)line[3]) && line[4] == ' ') {
+      const char *end = p;
+      while (*end && strncmp(end, LEARNING_IMPORT_HEADER,
+                             strlen(LEARNING_IMPORT_HEADER)) != 0) {
+        end += strcspn(end, "\n");
+        end += *end ? 1 : 0;
+      }
+      /* 单次序列与重复序列依次导入 */
+      irdb_pronto_info_t info;
+      int ret = irdb_pronto_to_raw(line, end - line, signal->timings,
+                                   IR_LEARNING_MAX_EDGES, &info);
+      if (ret < 0) {
+        return ret;
+      }
+      signal->carrier_freq = info.carrier_freq;
+      signal->timing_count = info.once_length + info.repeat_length;
+      p = end;
+      break;
     }
-    if (duration > analysis->max_pulse) {
-      analysis->max_pulse = duration;
+
+    while (line < eol) {
+      if (import_is_sep(*line) || *line == '\r') {
+        line++;
+        continue;
+      }
+      if (strncmp(line, "Freq=", 5) == 0) {
+        signal->carrier_freq = strtoul(line + 5, (char **)&line, 10);
+        while (line < eol && !import_is_sep(*line)) {
+          line++; // "Hz"
+        }
+        continue;
+      }
+
+      char *end;
+      uint32_t us = strtoul(line, &end, 10);
+      if (end == line || end > eol) {
+        return -EINVAL;
+      }
+      if (signal->timing_count == IR_LEARNING_MAX_EDGES) {
+        return -E2BIG;
+      }
+      signal->timings[signal->timing_count++] = ir_timing_pack(us);
+      line = end;
     }
+  }
+
+  if (next) {
+    *next = p;
+  }
+  if (signal->timing_count == 0) {
+    return -ENODATA;
+  }
+
+  signal->repeat_period_us = 0;
+  signal->total_duration_us = 0;
+  for (uint16_t i = 0; i < signal->timing_count; i++) {
+    signal->total_duration_us += ir_timing_us(signal->timings[i]);
+  }
+  return 0;
+}
+
+/* 从原始格式导入 */
+int ir_learning_import_raw(ir_learned_signal_t *signal, const char *raw_data) {
+  if (!signal || !raw_data) {
+    return -EINVAL;
+  }
 
-    if (i % 2 == 0) { // Mark
-      mark_sum += duration;
-      mark_count++;
-    } else { // Space
-      space_sum += duration;
-      space_count++;
+  if (!signal->timings) {
+    signal->timings = ir_timing_buf_alloc();
+    if (!signal->timings) {
+      return -ENOMEM;
     }
   }
 
-  if (mark_count > 0) {
-    analysis->avg_mark = mark_sum / mark_count;
+  signal->valid = false;
+  signal->parametric = false;
+
+  int ret = import_section(signal, raw_data, NULL);
+  if (ret < 0) {
+    LOG_ERR("Failed to import signal: %d", ret);
+    return ret;
+  }
+
+  learning_recognize(signal);
+  signal->valid = true;
+
+  LOG_INF("Signal imported: '%s' (%u edges, %u Hz)", signal->name,
+          signal->timing_count, signal->carrier_freq);
+  return 0;
+}
+
+/* 批量导入 - 逐段解析进同一缓冲并直接保存，每段须有"# IR Signal:"标题 */
+int ir_learning_import_bundle(const char *bundle, uint16_t *failed) {
+  if (!bundle) {
+    return -EINVAL;
   }
-  if (space_count > 0) {
-    analysis->avg_space = space_sum / space_count;
+
+  ir_learned_signal_t signal = {0};
+  signal.timings = ir_timing_buf_alloc();
+  if (!signal.timings) {
+    return -ENOMEM;
   }
 
-  /* 估算载波频率 (基于最短mark脉冲) */
-  if (analysis->min_pulse > 0) {
-    analysis->estimated_freq = 1000000 / (analysis->min_pulse * 2);
-    /* 四舍五入到常见频率 */
-    if (analysis->estimated_freq > 35000 && analysis->estimated_freq < 41000) {
-      analysis->estimated_freq = 38000;
-    } else if (analysis->estimated_freq > 33000 &&
-               analysis->estimated_freq < 37000) {
-      analysis->estimated_freq = 36000;
-    } else if (analysis->estimated_freq > 38000 &&
-               analysis->estimated_freq < 42000) {
-      analysis->estimated_freq = 40000;
+  uint32_t start = k_uptime_get_32();
+  uint16_t imported = 0;
+  uint16_t errors = 0;
+  const char *p = bundle;
+
+  while (*p) {
+    const char *next = p;
+
+    signal.name[0] = '\0';
+    signal.parametric = false;
+    int ret = import_section(&signal, p, &next);
+    if (ret == -ENODATA && *next == '\0') {
+      break; // 末尾只剩注释或空行
+    }
+
+    if (ret == 0 && signal.name[0] == '\0') {
+      ret = -EINVAL;
+    }
+    if (ret == 0) {
+      learning_recognize(&signal);
+      signal.valid = true;
+      ret = ir_learning_save(&signal, signal.name);
+    }
+
+    if (ret < 0) {
+      LOG_WRN("Bundle entry '%s' failed: %d", signal.name, ret);
+      errors++;
+    } else {
+      imported++;
     }
+
+    /* 解析失败时跳到下一个标题 */
+    if (next == p) {
+      const char *hdr = strstr(p + 1, LEARNING_IMPORT_HEADER);
+      next = hdr ? hdr : p + strlen(p);
+    }
+    p = next;
+  }
+
+  ir_timing_buf_free(signal.timings);
+
+  LOG_INF("Bundle imported: %u signals, %u failed, %u ms", imported, errors,
+          k_uptime_get_32() - start);
+  if (failed) {
+    *failed = errors;
+  }
+  return imported;
+}
+
+/* 分析已保存或导入的信号 - 累计状态较大，静态分配，调用互斥 */
+static ir_analytics_t analyze_state;
+static K_MUTEX_DEFINE(analyze_mutex);
+
+int ir_learning_analyze(const ir_learned_signal_t *signal,
+                        ir_signal_analysis_t *analysis) {
+  if (!signal || !signal->valid || !analysis) {
+    return -EINVAL;
   }
 
-  LOG_INF("Analysis: avg_mark=%u, avg_space=%u, freq=%u Hz", analysis->avg_mark,
-          analysis->avg_space, analysis->estimated_freq);
+  memset(analysis, 0, sizeof(ir_signal_analysis_t));
+
+  k_mutex_lock(&analyze_mutex, K_FOREVER);
+  ir_analytics_reset(&analyze_state);
+  ir_analytics_feed(&analyze_state, signal->timings, signal->timing_count);
+  ir_analytics_result(&analyze_state, analysis);
+  k_mutex_unlock(&analyze_mutex);
+
+  /* 载波无法从解调后的包络推断，只报告学习时实测的频率 */
+  analysis->estimated_freq = signal->carrier_freq;
+
+  /* 已知协议之外的信号再推断协议参数 */
+  analysis->inferred =
+      !signal->parametric &&
+      ir_infer_protocol(signal->timings, signal->timing_count,
+                        signal->carrier_freq, &analysis->infer) == 0;
+
+  LOG_INF("Analysis: avg_mark=%u, avg_space=%u, freq=%u Hz, %u frame(s)",
+          analysis->avg_mark, analysis->avg_space, analysis->estimated_freq,
+          analysis->frame_count);
 
   return 0;
 }
 
-/* 比较两个信号 */
+/* 实时分析结果 */
+int ir_learning_live_analysis(ir_signal_analysis_t *analysis) {
+  if (!analysis) {
+    return -EINVAL;
+  }
+
+  memset(analysis, 0, sizeof(ir_signal_analysis_t));
+
+  k_spinlock_key_t key = k_spin_lock(&learn_state.live_lock);
+  bool valid = learn_state.live_valid;
+  if (valid) {
+    ir_analytics_result(&learn_state.live, analysis);
+  }
+  k_spin_unlock(&learn_state.live_lock, key);
+
+  return valid ? 0 : -ENODATA;
+}
+
+/* 对齐比较核 - 带状编辑距离。a[i]与b[j]奇偶相同(同为mark或space)且相差
+ * 不超过较长者的1/4(不小于LEARNING_MATCH_MIN_US)时替换代价为0，否则为1；
+ * 插入/删除代价为1，单个丢失或多出的沿只计一次错误。错位超过
+ * LEARNING_ALIGN_BAND的对齐不考虑，每行只算2*BAND+1格 */
+#define LEARNING_ALIGN_BAND 4
+#define LEARNING_ALIGN_WIDTH (2 * LEARNING_ALIGN_BAND + 1)
+#define LEARNING_ALIGN_INF 0xFFFF
+
+/* 换算为16位微秒 (长间隔饱和，不影响比较) */
+static void align_load(uint16_t *out, const ir_timing_t *timings,
+                       uint16_t count) {
+  for (uint16_t i = 0; i < count; i++) {
+    out[i] = MIN(ir_timing_us(timings[i]), UINT16_MAX);
+  }
+}
+
+/* 一行中与a相近的格，第k位对应b[k] */
+#if defined(__ARM_FEATURE_DSP)
+/* 双16位SIMD: USUB16置每半字的GE标志，SEL按标志取较大/较小值 */
+static uint32_t align_row_close(uint16_t a, const uint16_t *b, int count) {
+  uint32_t aa = a | ((uint32_t)a << 16);
+  uint32_t min_tol = LEARNING_MATCH_MIN_US | (LEARNING_MATCH_MIN_US << 16);
+  uint32_t mask = 0;
+  int k = 0;
+
+  for (; k + 1 < count; k += 2) {
+    uint32_t bb;
+    memcpy(&bb, &b[k], sizeof(bb));
+
+    __USUB16(aa, bb);
+    uint32_t hi = __SEL(aa, bb);
+    uint32_t lo = __SEL(bb, aa);
+    uint32_t diff = __USUB16(hi, lo);
+
+    uint32_t tol = (hi >> 2) & 0x3FFF3FFF;
+    __USUB16(tol, min_tol);
+    tol = __SEL(tol, min_tol);
+
+    __USUB16(tol, diff);
+    uint32_t ok = __SEL(0xFFFFFFFF, 0);
+    mask |= ((ok & 1) | ((ok >> 15) & 2)) << k;
+  }
+  for (; k < count; k++) {
+    uint32_t hi = MAX(a, b[k]);
+    uint32_t diff = hi - MIN(a, b[k]);
+    mask |= (uint32_t)(diff <= MAX(hi / 4, LEARNING_MATCH_MIN_US)) << k;
+  }
+  return mask;
+}
+#else
+static uint32_t align_row_close(uint16_t a, const uint16_t *b, int count) {
+  uint32_t mask = 0;
+
+  for (int k = 0; k < count; k++) {
+    uint32_t hi = MAX(a, b[k]);
+    uint32_t diff = hi - MIN(a, b[k]);
+    mask |= (uint32_t)(diff <= MAX(hi / 4, LEARNING_MATCH_MIN_US)) << k;
+  }
+  return mask;
+}
+#endif
+
+/* 编辑距离，超过limit时提前返回limit + 1 */
+static uint32_t align_distance(const uint16_t *a, int n, const uint16_t *b,
+                               int m, uint32_t limit) {
+  uint16_t rows[2][LEARNING_ALIGN_WIDTH + 2];
+  uint16_t *prev = rows[0] + 1; // [-1]与[WIDTH]为带外哨兵
+  uint16_t *cur = rows[1] + 1;
+
+  if (abs(n - m) > LEARNING_ALIGN_BAND) {
+    return MIN((uint32_t)abs(n - m), limit + 1);
+  }
+
+  /* 第0行: D[0][j] = j，第k格对应j = i - BAND + k */
+  for (int k = -1; k <= LEARNING_ALIGN_WIDTH; k++) {
+    int j = k - LEARNING_ALIGN_BAND;
+    bool in_band = k >= 0 && k < LEARNING_ALIGN_WIDTH && j >= 0 && j <= m;
+    prev[k] = in_band ? j : LEARNING_ALIGN_INF;
+  }
+  cur[-1] = cur[LEARNING_ALIGN_WIDTH] = LEARNING_ALIGN_INF;
+
+  for (int i = 1; i <= n; i++) {
+    int j0 = i - LEARNING_ALIGN_BAND;
+    int k_lo = MAX(0, -j0);
+    int k_hi = MIN(LEARNING_ALIGN_WIDTH - 1, m - j0);
+    int k_cmp = MAX(k_lo, 1 - j0); // j >= 1才有a[i-1]与b[j-1]的比较
+    uint32_t close = 0;
+
+    if (k_hi >= k_cmp) {
+      close = align_row_close(a[i - 1], &b[j0 + k_cmp - 1], k_hi - k_cmp + 1)
+              << k_cmp;
+    }
+
+    uint32_t row_min = LEARNING_ALIGN_INF;
+    for (int k = 0; k < LEARNING_ALIGN_WIDTH; k++) {
+      uint32_t d = LEARNING_ALIGN_INF;
+
+      if (k >= k_lo && k <= k_hi) {
+        if (j0 + k == 0) {
+          d = i;
+        } else {
+          /* j - i = k - BAND为偶数时同为mark或同为space */
+          bool same = ((k - LEARNING_ALIGN_BAND) & 1) == 0;
+          uint32_t cost = same && ((close >> k) & 1) ? 0 : 1;
+          d = MIN((uint32_t)prev[k] + cost, (uint32_t)prev[k + 1] + 1);
+          d = MIN(d, (uint32_t)cur[k - 1] + 1);
+        }
+      }
+      cur[k] = MIN(d, LEARNING_ALIGN_INF);
+      row_min = MIN(row_min, cur[k]);
+    }
+
+    if (row_min > limit) {
+      return limit + 1;
+    }
+
+    uint16_t *t = prev;
+    prev = cur;
+    cur = t;
+  }
+
+  return MIN((uint32_t)prev[m - n + LEARNING_ALIGN_BAND], limit + 1);
+}
+
+/* 比较两个信号 - 相似度 = 1 - 编辑距离 / 较长信号的时序数 */
 int ir_learning_compare(const ir_learned_signal_t *sig1,
                         const ir_learned_signal_t *sig2, uint8_t *similarity) {
   if (!sig1 || !sig2 || !sig1->valid || !sig2->valid || !similarity) {
     return -EINVAL;
   }
 
-  /* 如果长度差异太大，相似度为0 */
-  if (abs((int)sig1->timing_count - (int)sig2->timing_count) > 10) {
+  uint16_t n = MIN(sig1->timing_count, IR_LEARNING_MAX_EDGES);
+  uint16_t m = MIN(sig2->timing_count, IR_LEARNING_MAX_EDGES);
+  uint16_t len = MAX(n, m);
+  if (len == 0) {
     *similarity = 0;
     return 0;
   }
 
-  uint32_t min_len = sig1->timing_count < sig2->timing_count
-                         ? sig1->timing_count
-                         : sig2->timing_count;
-
-  uint32_t matches = 0;
-  uint32_t tolerance = 200; // 200us容差
-
-  for (uint32_t i = 0; i < min_len; i++) {
-    uint32_t t1 = sig1->timings[i];
-    uint32_t t2 = sig2->timings[i];
-    uint32_t diff = t1 > t2 ? t1 - t2 : t2 - t1;
-
-    if (diff <= tolerance) {
-      matches++;
-    }
+  /* 微秒换算缓冲按两个信号的实际长度从数据库堆临时分配，不常驻。
+   * 最多2 * IR_LEARNING_MAX_EDGES个，超出一块时序缓冲 */
+  uint16_t *a = irdb_heap_alloc((n + m) * sizeof(uint16_t));
+  if (!a) {
+    return -ENOMEM;
   }
+  uint16_t *b = a + n;
 
-  *similarity = (matches * 100) / min_len;
+  align_load(a, sig1->timings, n);
+  align_load(b, sig2->timings, m);
+  uint32_t distance = align_distance(a, n, b, m, len);
+  irdb_heap_free(a);
+
+  *similarity = distance >= len ? 0 : (len - distance) * 100 / len;
   return 0;
-}
\ No newline at end of file
+}
@@ -3,8 +3,11 @@
  * @brief IR自学习功能应用示例
  */
 
+#include "ir_app.h"
 #include "ir_learning.h"
+#include "ir_mem.h"
 #include "ir_service.h"
+#include <stdio.h>
 #include <stdlib.h> // 添加：atoi
 #include <string.h> // 添加：strcmp
 #include <zephyr/kernel.h>
@@ -14,10 +17,113 @@
 
 LOG_MODULE_REGISTER(ir_learn_app, LOG_LEVEL_INF);
 
-/* 学习状态回调 */
+/* 学习结束(完成、超时或出错)时释放，等待者不必按最长时限休眠 */
+static K_SEM_DEFINE(learn_done, 0, 1);
+
+static bool learn_finished(ir_learn_status_t status) {
+  return status == IR_LEARN_COMPLETED || status == IR_LEARN_TIMEOUT ||
+         status == IR_LEARN_ERROR;
+}
+
+#ifdef CONFIG_SHELL
+/* shell发起的学习 - 接收中在RX线程、下一次按键在定时器中断中回调，
+ * 完成、超时和出错在系统工作队列中回调，都不能直接写shell: 事件连同
+ * 结果的摘要放进消息队列，阻塞的命令在shell线程中逐个取出打印;
+ * --async时命令已返回，由系统工作队列打印，其间shell照常可用 */
+typedef struct {
+  ir_learn_status_t status;
+  char name[sizeof(((ir_learned_signal_t *)0)->name)];
+  uint32_t edges;
+  uint32_t duration_us;
+  uint32_t carrier_freq;
+  uint8_t duty_cycle;
+} learn_event_t;
+
+K_MSGQ_DEFINE(learn_events, sizeof(learn_event_t), 4, 4);
+
+static struct {
+  const struct shell *shell;
+  bool async;
+} learn_session;
+
+static void learn_work_handler(struct k_work *work);
+static K_WORK_DEFINE(learn_work, learn_work_handler);
+
+static void learn_post(ir_learn_status_t status,
+                       const ir_learned_signal_t *signal) {
+  learn_event_t ev = {.status = status};
+
+  if (signal) {
+    strncpy(ev.name, signal->name, sizeof(ev.name) - 1);
+    ev.edges = signal->timing_count;
+    ev.duration_us = signal->total_duration_us;
+    ev.carrier_freq = signal->carrier_freq;
+    ev.duty_cycle = signal->duty_cycle;
+  }
+
+  if (k_msgq_put(&learn_events, &ev, K_NO_WAIT) == 0 && learn_session.async) {
+    k_work_submit(&learn_work);
+  }
+}
+
+static void learn_print(const struct shell *sh, const learn_event_t *ev) {
+  switch (ev->status) {
+  case IR_LEARN_RECEIVING:
+    shell_fprintf(sh, SHELL_NORMAL, "Learning: receiving signal...\n");
+    break;
+  case IR_LEARN_NEXT_PRESS:
+    shell_fprintf(sh, SHELL_NORMAL,
+                  "Learning: press captured, press the button again\n");
+    break;
+  case IR_LEARN_COMPLETED: {
+    ir_signal_analysis_t analysis;
+
+    shell_fprintf(sh, SHELL_INFO, "Learned '%s': %u edges, %u us\n", ev->name,
+                  ev->edges, ev->duration_us);
+    if (ev->carrier_freq > 0) {
+      shell_fprintf(sh, SHELL_NORMAL, "  Carrier: %u Hz, duty %u%%\n",
+                    ev->carrier_freq, ev->duty_cycle);
+    }
+    if (ir_learning_live_analysis(&analysis) == 0) {
+      shell_fprintf(sh, SHELL_NORMAL,
+                    "  Avg mark %u us, avg space %u us, %u frame(s)\n",
+                    analysis.avg_mark, analysis.avg_space,
+                    analysis.frame_count);
+    }
+    break;
+  }
+  case IR_LEARN_TIMEOUT:
+    shell_fprintf(sh, SHELL_WARNING, "Learning: timeout, no signal\n");
+    break;
+  case IR_LEARN_ERROR:
+    shell_fprintf(sh, SHELL_ERROR, "Learning: error\n");
+    break;
+  default:
+    break;
+  }
+}
+
+static void learn_work_handler(struct k_work *work) {
+  learn_event_t ev;
+
+  while (k_msgq_get(&learn_events, &ev, K_NO_WAIT) == 0) {
+    learn_print(learn_session.shell, &ev);
+  }
+}
+#endif
+
+/* 学习状态回调 - user_data为发起学习的shell时事件打印到该shell，否则
+ * 写日志 */
 static void learning_callback(ir_learn_status_t status,
                               const ir_learned_signal_t *signal,
                               void *user_data) {
+#ifdef CONFIG_SHELL
+  if (user_data) {
+    learn_post(status, signal);
+    return;
+  }
+#endif
+
   switch (status) {
   case IR_LEARN_IDLE:
     LOG_INF("Learning: Idle");
@@ -38,14 +144,21 @@ static void learning_callback(ir_learn_status_t status,
       LOG_INF("  Name: %s", signal->name);
       LOG_INF("  Edges: %u", signal->timing_count);
       LOG_INF("  Duration: %u us", signal->total_duration_us);
+      if (signal->carrier_freq > 0) {
+        LOG_INF("  Carrier: %u Hz, duty %u%%", signal->carrier_freq,
+                signal->duty_cycle);
+      }
 
-      /* 分析信号 */
+      /* 录制时已逐沿累计，这里只取结果 (完成回调在系统工作队列中) */
       ir_signal_analysis_t analysis;
-      if (ir_learning_analyze(signal, &analysis) == 0) {
+      if (ir_learning_live_analysis(&analysis) == 0) {
         LOG_INF("  Analysis:");
         LOG_INF("    Avg mark: %u us", analysis.avg_mark);
         LOG_INF("    Avg space: %u us", analysis.avg_space);
-        LOG_INF("    Estimated freq: %u Hz", analysis.estimated_freq);
+        LOG_INF("    Clusters: %u mark, %u space", analysis.mark_cluster_count,
+                analysis.space_cluster_count);
+        LOG_INF("    Frames: %u, period %u us", analysis.frame_count,
+                analysis.period_us);
       }
     }
     break;
@@ -57,6 +170,14 @@ static void learning_callback(ir_learn_status_t status,
   case IR_LEARN_ERROR:
     LOG_ERR("Learning: Error occurred");
     break;
+
+  case IR_LEARN_NEXT_PRESS:
+    LOG_INF("Learning: Press captured, press the button again");
+    break;
+  }
+
+  if (learn_finished(status)) {
+    k_sem_give(&learn_done);
   }
 }
 
@@ -73,55 +194,109 @@ void test_ir_learning(void) {
 
   /* 2. 学习Power按键 */
   LOG_INF("\n--- Learning 'Power' button ---");
+  k_sem_reset(&learn_done);
   ret = ir_learning_start("Power", learning_callback, NULL, 10000);
   if (ret < 0) {
     LOG_ERR("Failed to start learning: %d", ret);
     return;
   }
 
-  /* 等待学习完成 */
-  k_sleep(K_SECONDS(12));
-
-  /* 3. 如果成功，保存信号 */
-  ir_learned_signal_t power_signal;
-  memset(&power_signal, 0, sizeof(power_signal));
-  power_signal.timings = k_malloc(IR_LEARNING_MAX_EDGES * sizeof(uint32_t));
+  /* 等待学习结束 (超时由学习模块报告，这里只留余量) */
+  k_sem_take(&learn_done, K_SECONDS(12));
 
-  /* 这里假设学习成功，实际应该在回调中处理 */
+  /* 3. 学习成功时由回调保存信号 */
 
   /* 4. 学习Volume Up */
   LOG_INF("\n--- Learning 'Volume Up' button ---");
   k_sleep(K_SECONDS(2));
 
+  k_sem_reset(&learn_done);
   ret = ir_learning_start("VolumeUp", learning_callback, NULL, 10000);
-  k_sleep(K_SECONDS(12));
+  if (ret == 0) {
+    k_sem_take(&learn_done, K_SECONDS(12));
+  }
 
   LOG_INF("\n=== Learning Test Complete ===");
 }
 
 #ifdef CONFIG_SHELL
 
-/* Shell命令: learn - 学习新信号 */
+/* Shell命令: learn - 学习新信号。默认等学习结束再返回; --async立即
+ * 返回，结果稍后打印，其间可用其他命令(irlearn live、irlearn stop) */
 static int cmd_learn(const struct shell *sh, size_t argc, char **argv) {
+  bool async = false;
+
+  if (argc > 1 && strcmp(argv[argc - 1], "--async") == 0) {
+    async = true;
+    argc--;
+  }
   if (argc < 2) {
-    shell_error(sh, "Usage: learn <signal_name> [timeout_ms]");
+    shell_error(sh,
+                "Usage: learn <signal_name> [timeout_ms] [presses] [--async]");
     return -EINVAL;
   }
 
   const char *name = argv[1];
   uint32_t timeout = argc > 2 ? atoi(argv[2]) : 5000;
+  uint8_t presses = argc > 3 ? atoi(argv[3]) : 1;
 
   shell_print(sh, "Starting learning mode...");
   shell_print(sh, "Signal name: %s", name);
   shell_print(sh, "Timeout: %u ms", timeout);
+  if (presses > 1) {
+    shell_print(sh, "Press the button %u times, one press at a time",
+                presses);
+  }
   shell_print(sh, "Point your remote and press the button NOW!");
 
-  int ret = ir_learning_start(name, learning_callback, (void *)sh, timeout);
+  /* 上一次--async的事件已打印或作废 */
+  k_work_cancel(&learn_work);
+  k_msgq_purge(&learn_events);
+  k_sem_reset(&learn_done);
+  learn_session.shell = sh;
+  learn_session.async = async;
+
+  int ret = ir_learning_start_multi(name, presses, learning_callback,
+                                    (void *)sh, timeout);
   if (ret < 0) {
     shell_error(sh, "Failed to start learning: %d", ret);
     return ret;
   }
+  if (async) {
+    shell_print(sh, "Learning in background");
+    return 0;
+  }
+
+  /* 每次按键各有timeout，学习模块到时报告超时，这里只是兜底 */
+  int64_t deadline =
+      k_uptime_get() + (int64_t)timeout * MAX(presses, 1) + 2000;
+  learn_event_t ev;
+
+  while (k_msgq_get(&learn_events, &ev,
+                    K_MSEC(MAX(deadline - k_uptime_get(), 0))) == 0) {
+    learn_print(sh, &ev);
+    if (ev.status == IR_LEARN_COMPLETED) {
+      return 0;
+    }
+    if (learn_finished(ev.status)) {
+      return ev.status == IR_LEARN_TIMEOUT ? -ETIMEDOUT : -EIO;
+    }
+  }
 
+  ir_learning_stop();
+  shell_error(sh, "Learning did not finish");
+  return -ETIMEDOUT;
+}
+
+/* Shell命令: stop - 取消进行中的学习 */
+static int cmd_learn_stop(const struct shell *sh, size_t argc, char **argv) {
+  int ret = ir_learning_stop();
+
+  if (ret < 0) {
+    shell_error(sh, "Failed to stop learning: %d", ret);
+    return ret;
+  }
+  shell_print(sh, "Learning stopped");
   return 0;
 }
 
@@ -135,34 +310,36 @@ static int cmd_replay(const struct shell *sh, size_t argc, char **argv) {
   const char *name = argv[1];
   uint32_t repeat = argc > 2 ? atoi(argv[2]) : 1;
 
-  /* 从存储加载信号 */
-  ir_learned_signal_t signal;
-  memset(&signal, 0, sizeof(signal));
-  signal.timings = k_malloc(IR_LEARNING_MAX_EDGES * sizeof(uint32_t));
-
-  if (!signal.timings) {
-    shell_error(sh, "Memory allocation failed");
-    return -ENOMEM;
-  }
+  shell_print(sh, "Replaying: %s (%u times)", name, repeat);
 
-  int ret = ir_learning_load(&signal, name);
+  /* 热集命中时不读flash */
+  int ret = ir_learning_replay_name(name, repeat);
   if (ret < 0) {
-    shell_error(sh, "Failed to load signal: %d", ret);
-    k_free(signal.timings);
+    shell_error(sh, "Replay failed: %d", ret);
     return ret;
   }
 
-  shell_print(sh, "Replaying: %s (%u times)", name, repeat);
+  shell_print(sh, "Replay completed");
+  return 0;
+}
 
-  ret = ir_learning_replay(&signal, repeat);
-  k_free(signal.timings);
+/* Shell命令: hot - 热集统计，带名称时预先载入 */
+static int cmd_hot(const struct shell *sh, size_t argc, char **argv) {
+  ir_learning_hot_stats_t stats;
 
-  if (ret < 0) {
-    shell_error(sh, "Replay failed: %d", ret);
-    return ret;
+  for (size_t i = 1; i < argc; i++) {
+    int ret = ir_learning_hot_preload(argv[i]);
+    if (ret < 0) {
+      shell_error(sh, "Failed to preload %s: %d", argv[i], ret);
+      return ret;
+    }
   }
 
-  shell_print(sh, "Replay completed");
+  ir_learning_hot_get_stats(&stats);
+  shell_print(sh, "Hot signals: %u (%u pinned), %u bytes", stats.signals,
+              stats.pinned, stats.bytes);
+  shell_print(sh, "Hits: %u, misses: %u, evictions: %u", stats.hits,
+              stats.misses, stats.evictions);
   return 0;
 }
 
@@ -183,15 +360,23 @@ static int cmd_save(const struct shell *sh, size_t argc, char **argv)
 
 /* Shell命令: list - 列出所有学习的信号 */
 static int cmd_list_learned(const struct shell *sh, size_t argc, char **argv) {
-  char buf[1024];
-
-  int ret = ir_learning_list(buf, sizeof(buf));
-  if (ret < 0) {
+  ir_learning_iter_t it;
+  char name[sizeof(((ir_learned_signal_t *)0)->name)];
+  int ret;
+  int count = 0;
+
+  shell_print(sh, "Learned signals:");
+  ir_learning_iter_init(&it);
+  while ((ret = ir_learning_iter_next(&it, name, sizeof(name))) == 0) {
+    shell_print(sh, "  %s", name);
+    count++;
+  }
+  if (ret != -ENOENT) {
     shell_error(sh, "Failed to list signals: %d", ret);
     return ret;
   }
 
-  shell_print(sh, "%s", buf);
+  shell_print(sh, "%d signals", count);
   return 0;
 }
 
@@ -214,6 +399,37 @@ static int cmd_delete(const struct shell *sh, size_t argc, char **argv) {
   return 0;
 }
 
+/* 时长类与直方图 - 直方图只打印非空格 */
+static void print_distribution(const struct shell *sh, const char *label,
+                               const ir_duration_cluster_t *clusters,
+                               uint8_t count, const uint16_t *hist) {
+  char line[96];
+  int len = 0;
+
+  for (uint8_t i = 0; i < count && len < (int)sizeof(line); i++) {
+    len += snprintf(line + len, sizeof(line) - len, " %u(x%u)",
+                    clusters[i].centroid_us, clusters[i].count);
+  }
+  shell_print(sh, "  %s clusters:%s", label, count ? line : " none");
+
+  for (uint32_t bin = 0; bin < IR_ANALYTICS_BINS; bin++) {
+    if (hist[bin] > 0) {
+      shell_print(sh, "    %5u us: %u", bin << IR_ANALYTICS_BIN_SHIFT,
+                  hist[bin]);
+    }
+  }
+}
+
+static void print_analysis(const struct shell *sh,
+                           const ir_signal_analysis_t *analysis) {
+  print_distribution(sh, "Mark", analysis->mark_clusters,
+                     analysis->mark_cluster_count, analysis->mark_hist);
+  print_distribution(sh, "Space", analysis->space_clusters,
+                     analysis->space_cluster_count, analysis->space_hist);
+  shell_print(sh, "  Frames: %u, repeat period %u us", analysis->frame_count,
+              analysis->period_us);
+}
+
 /* Shell命令: analyze - 分析信号 */
 static int cmd_analyze(const struct shell *sh, size_t argc, char **argv) {
   if (argc < 2) {
@@ -226,7 +442,7 @@ static int cmd_analyze(const struct shell *sh, size_t argc, char **argv) {
   /* 加载信号 */
   ir_learned_signal_t signal;
   memset(&signal, 0, sizeof(signal));
-  signal.timings = k_malloc(IR_LEARNING_MAX_EDGES * sizeof(uint32_t));
+  signal.timings = ir_timing_buf_alloc();
 
   if (!signal.timings) {
     shell_error(sh, "Memory allocation failed");
@@ -236,7 +452,7 @@ static int cmd_analyze(const struct shell *sh, size_t argc, char **argv) {
   int ret = ir_learning_load(&signal, name);
   if (ret < 0) {
     shell_error(sh, "Failed to load signal: %d", ret);
-    k_free(signal.timings);
+    ir_timing_buf_free(signal.timings);
     return ret;
   }
 
@@ -251,13 +467,47 @@ static int cmd_analyze(const struct shell *sh, size_t argc, char **argv) {
     shell_print(sh, "  Avg space: %u us", analysis.avg_space);
     shell_print(sh, "  Min pulse: %u us", analysis.min_pulse);
     shell_print(sh, "  Max pulse: %u us", analysis.max_pulse);
-    shell_print(sh, "  Estimated carrier: %u Hz", analysis.estimated_freq);
+    if (analysis.estimated_freq > 0) {
+      shell_print(sh, "  Carrier: %u Hz (measured)", analysis.estimated_freq);
+    } else {
+      shell_print(sh, "  Carrier: not measured (sent at 38000 Hz)");
+    }
+    print_analysis(sh, &analysis);
+    if (analysis.inferred) {
+      const ir_infer_result_t *inf = &analysis.infer;
+      const irdb_protocol_params_t *p = &inf->params;
+
+      shell_print(sh, "  Inferred: %s, %u bits, %u frame(s), gap %u us",
+                  ir_infer_coding_name(p->coding), inf->bits, inf->frames,
+                  p->gap);
+      shell_print(sh, "    Header: %u/%u us, bit %u/%u/%u us, trailer %u us",
+                  p->header_mark, p->header_space, p->bit_mark,
+                  p->bit_0_space, p->bit_1_space, p->trailer_mark);
+      shell_print(sh, "    Code: D:%u S:%u F:%u (saved as parameters)",
+                  inf->code.device, inf->code.subdevice, inf->code.function);
+    }
   }
 
-  k_free(signal.timings);
+  ir_timing_buf_free(signal.timings);
   return ret;
 }
 
+/* Shell命令: live - 录制中的实时分析 */
+static int cmd_live(const struct shell *sh, size_t argc, char **argv) {
+  ir_signal_analysis_t analysis;
+  int ret = ir_learning_live_analysis(&analysis);
+
+  if (ret < 0) {
+    shell_error(sh, "No learning capture yet");
+    return ret;
+  }
+
+  shell_print(sh, "Live analysis: %u edges, avg mark %u us, avg space %u us",
+              analysis.pulse_count, analysis.avg_mark, analysis.avg_space);
+  print_analysis(sh, &analysis);
+  return 0;
+}
+
 /* Shell命令: compare - 比较两个信号 */
 static int cmd_compare(const struct shell *sh, size_t argc, char **argv) {
   if (argc < 3) {
@@ -269,15 +519,15 @@ static int cmd_compare(const struct shell *sh, size_t argc, char **argv) {
   memset(&sig1, 0, sizeof(sig1));
   memset(&sig2, 0, sizeof(sig2));
 
-  sig1.timings = k_malloc(IR_LEARNING_MAX_EDGES * sizeof(uint32_t));
-  sig2.timings = k_malloc(IR_LEARNING_MAX_EDGES * sizeof(uint32_t));
+  sig1.timings = ir_timing_buf_alloc();
+  sig2.timings = ir_timing_buf_alloc();
 
   if (!sig1.timings || !sig2.timings) {
     shell_error(sh, "Memory allocation failed");
     if (sig1.timings)
-      k_free(sig1.timings);
+      ir_timing_buf_free(sig1.timings);
     if (sig2.timings)
-      k_free(sig2.timings);
+      ir_timing_buf_free(sig2.timings);
     return -ENOMEM;
   }
 
@@ -287,8 +537,8 @@ static int cmd_compare(const struct shell *sh, size_t argc, char **argv) {
 
   if (ret1 < 0 || ret2 < 0) {
     shell_error(sh, "Failed to load signals");
-    k_free(sig1.timings);
-    k_free(sig2.timings);
+    ir_timing_buf_free(sig1.timings);
+    ir_timing_buf_free(sig2.timings);
     return -EINVAL;
   }
 
@@ -311,15 +561,15 @@ static int cmd_compare(const struct shell *sh, size_t argc, char **argv) {
     }
   }
 
-  k_free(sig1.timings);
-  k_free(sig2.timings);
+  ir_timing_buf_free(sig1.timings);
+  ir_timing_buf_free(sig2.timings);
   return ret;
 }
 
 /* Shell命令: export - 导出信号为文本格式 */
 static int cmd_export(const struct shell *sh, size_t argc, char **argv) {
   if (argc < 2) {
-    shell_error(sh, "Usage: export <signal_name>");
+    shell_error(sh, "Usage: export <signal_name> [raw|pronto]");
     return -EINVAL;
   }
 
@@ -328,7 +578,7 @@ static int cmd_export(const struct shell *sh, size_t argc, char **argv) {
   /* 加载信号 */
   ir_learned_signal_t signal;
   memset(&signal, 0, sizeof(signal));
-  signal.timings = k_malloc(IR_LEARNING_MAX_EDGES * sizeof(uint32_t));
+  signal.timings = ir_timing_buf_alloc();
 
   if (!signal.timings) {
     shell_error(sh, "Memory allocation failed");
@@ -338,31 +588,84 @@ static int cmd_export(const struct shell *sh, size_t argc, char **argv) {
   int ret = ir_learning_load(&signal, name);
   if (ret < 0) {
     shell_error(sh, "Failed to load signal: %d", ret);
-    k_free(signal.timings);
+    ir_timing_buf_free(signal.timings);
     return ret;
   }
 
   /* 导出 */
   char *export_buf = k_malloc(8192);
   if (export_buf) {
-    ir_learning_export_raw(&signal, export_buf, 8192);
+    if (argc > 2 && strcmp(argv[2], "pronto") == 0) {
+      ret = ir_learning_export_pronto(&signal, export_buf, 8192);
+    } else {
+      ret = ir_learning_export_raw(&signal, export_buf, 8192);
+    }
+    if (ret < 0) {
+      shell_error(sh, "Export failed: %d", ret);
+      k_free(export_buf);
+      ir_timing_buf_free(signal.timings);
+      return ret;
+    }
     shell_print(sh, "%s", export_buf);
     k_free(export_buf);
   }
 
-  k_free(signal.timings);
+  ir_timing_buf_free(signal.timings);
+  return 0;
+}
+
+/* 接收帧匹配学习信号 - 数据库能解码的帧按IRDB条目报告 */
+static void match_rx_callback(const irdb_entry_t *entry, void *user_data) {
+  LOG_INF("Received: %s", ir_service_entry_name(entry));
+}
+
+static void match_raw_callback(const ir_timing_t *timings, uint32_t count,
+                               void *user_data) {
+  char name[32];
+
+  if (ir_learning_match(timings, count, name, sizeof(name)) == 0) {
+    LOG_INF("Matched learned signal: %s", name);
+  } else {
+    LOG_INF("No learned signal matches (%u edges)", count);
+  }
+}
+
+/* Shell命令: match - 接收并识别学习的信号 */
+static int cmd_match(const struct shell *sh, size_t argc, char **argv) {
+  uint32_t duration = argc > 1 ? atoi(argv[1]) : 10;
+
+  ir_service_set_raw_callback(match_raw_callback, NULL);
+  int ret = ir_service_start_receive(match_rx_callback, NULL);
+  if (ret < 0) {
+    ir_service_set_raw_callback(NULL, NULL);
+    shell_error(sh, "Failed to start: %d", ret);
+    return ret;
+  }
+
+  shell_print(sh, "Matching for %u seconds...", duration);
+  k_sleep(K_SECONDS(duration));
+
+  ir_service_stop_receive();
+  ir_service_set_raw_callback(NULL, NULL);
+  ir_app_rx_resume();
   return 0;
 }
 
 /* 学习命令组 */
 SHELL_STATIC_SUBCMD_SET_CREATE(
-    learn_cmds, SHELL_CMD(learn, NULL, "Learn a new signal", cmd_learn),
+    learn_cmds,
+    SHELL_CMD(learn, NULL, "Learn a new signal [timeout_ms] [presses] [--async]",
+              cmd_learn),
+    SHELL_CMD(stop, NULL, "Cancel learning in progress", cmd_learn_stop),
     SHELL_CMD(replay, NULL, "Replay learned signal", cmd_replay),
     SHELL_CMD(list, NULL, "List learned signals", cmd_list_learned),
+    SHELL_CMD(hot, NULL, "Hot set stats, preload [name...]", cmd_hot),
     SHELL_CMD(delete, NULL, "Delete learned signal", cmd_delete),
     SHELL_CMD(analyze, NULL, "Analyze signal", cmd_analyze),
+    SHELL_CMD(live, NULL, "Analysis of the capture in progress", cmd_live),
     SHELL_CMD(compare, NULL, "Compare two signals", cmd_compare),
-    SHELL_CMD(export, NULL, "Export signal to raw format", cmd_export),
+    SHELL_CMD(match, NULL, "Match received signals [seconds]", cmd_match),
+    SHELL_CMD(export, NULL, "Export signal [raw|pronto]", cmd_export),
     SHELL_SUBCMD_SET_END);
 
 SHELL_CMD_REGISTER(irlearn, &learn_cmds, "IR learning commands", NULL);
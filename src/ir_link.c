@@ -0,0 +1,588 @@
+/**
+ * @file ir_link.c
+ * @brief 二进制命令链路 - 定帧、命令分派和响应，与具体后端无关
+ */
+
+#include "ir_link.h"
+#include "ir_learning.h"
+#include "ir_service.h"
+#include "ir_stats.h"
+#include "ir_timesync.h"
+#include "irdb_protocol.h"
+#include "irdb_store.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/ring_buffer.h>
+
+LOG_MODULE_REGISTER(ir_link, LOG_LEVEL_INF);
+
+#define LINK_CRC_SEED 0xFFFF
+
+/* 单个后端 - 中断/协议栈回调写rx，命令线程读出并定帧 */
+typedef struct {
+  struct k_spinlock lock; // 生产者可能不止一个上下文(BLE多次写入)
+  struct ring_buf rx;
+  uint8_t rx_buf[IR_LINK_RX_BUFFER];
+  uint8_t frame[IR_LINK_FRAME_MAX]; // 定帧缓冲，frame[0]为同步字节
+  size_t frame_len;
+  int (*send)(const uint8_t *frame, size_t len);
+  ir_link_stats_t stats;
+} link_port_t;
+
+/* 上传中的数据库 - 一次只有一个，由DB_BEGIN/DB_STORE所在后端持有 */
+typedef struct {
+  ir_link_port_t port;
+  bool store; // DB_STORE会话，name为存储名称
+  char name[IRDB_STORE_NAME_MAX];
+  irdb_upload_t up;
+} link_upload_t;
+
+static link_port_t ports[IR_LINK_PORT_COUNT];
+static link_upload_t upload;
+static K_SEM_DEFINE(link_sem, 0, 1);
+
+K_THREAD_STACK_DEFINE(link_thread_stack, IR_LINK_THREAD_STACK_SIZE);
+static struct k_thread link_thread;
+
+/* 响应缓冲 - 只在命令线程中使用 */
+static uint8_t tx_frame[IR_LINK_FRAME_MAX];
+static ir_stats_t link_snapshot;
+
+void ir_link_receive(ir_link_port_t port, const uint8_t *data, size_t len) {
+  if (port >= IR_LINK_PORT_COUNT) {
+    return;
+  }
+
+  link_port_t *p = &ports[port];
+  k_spinlock_key_t key = k_spin_lock(&p->lock);
+  uint32_t put = ring_buf_put(&p->rx, data, len);
+
+  p->stats.overruns += len - put;
+  k_spin_unlock(&p->lock, key);
+  k_sem_give(&link_sem);
+}
+
+/* 组帧发送响应 - 负载为状态+data */
+static void link_reply(link_port_t *p, uint8_t cmd, uint8_t seq, int status,
+                       const void *data, size_t len) {
+  size_t payload = sizeof(int16_t) + len;
+
+  if (payload > IR_LINK_PAYLOAD_MAX) {
+    status = -EMSGSIZE;
+    payload = sizeof(int16_t);
+    len = 0;
+  }
+
+  tx_frame[0] = IR_LINK_SYNC;
+  sys_put_le16(payload, tx_frame + 1);
+  tx_frame[3] = cmd | IR_LINK_RESPONSE;
+  tx_frame[4] = seq;
+  sys_put_le16((uint16_t)(int16_t)status, tx_frame + IR_LINK_HEADER_SIZE);
+  if (len > 0) {
+    memcpy(tx_frame + IR_LINK_HEADER_SIZE + sizeof(int16_t), data, len);
+  }
+
+  size_t crc_at = IR_LINK_HEADER_SIZE + payload;
+  sys_put_le16(crc16_itu_t(LINK_CRC_SEED, tx_frame + 1, crc_at - 1),
+               tx_frame + crc_at);
+
+  if (status < 0) {
+    p->stats.errors++;
+  }
+  if (!p->send || p->send(tx_frame, crc_at + IR_LINK_CRC_SIZE) < 0) {
+    p->stats.tx_errors++;
+  }
+}
+
+/* 通道0为默认通道 */
+static uint8_t link_channels(uint8_t channels) {
+  return channels ? channels : IR_HAL_TX_CH_DEFAULT;
+}
+
+/* start_at_us非0时定时发送 */
+static int link_send_entry(const uint8_t *rec, uint64_t start_at_us) {
+  irdb_entry_t entry = {
+      .name = IRDB_NAME_NONE,
+      .protocol = sys_get_le16(rec),
+      .device = sys_get_le16(rec + 2),
+      .subdevice = sys_get_le16(rec + 4),
+      .function = sys_get_le16(rec + 6),
+  };
+
+  if (start_at_us > 0) {
+    return ir_service_send_entry_at(&entry, rec[8], link_channels(rec[9]),
+                                    start_at_us, NULL, NULL);
+  }
+  return ir_service_send_entry_async_on(&entry, rec[8],
+                                        link_channels(rec[9]), NULL, NULL);
+}
+
+/* 功能名复制为C字符串 */
+static int link_name(const uint8_t *data, size_t len, char *out, size_t size) {
+  if (len == 0 || len >= size) {
+    return -EINVAL;
+  }
+  memcpy(out, data, len);
+  out[len] = '\0';
+  return 0;
+}
+
+static int link_db_begin(ir_link_port_t port, bool store, const uint8_t *data,
+                         size_t len) {
+  size_t size = store ? sizeof(upload.name) : IR_SERVICE_REMOTE_ID_MAX;
+
+  irdb_upload_abort(&upload.up);
+
+  int ret = link_name(data, len, upload.name, size);
+  if (ret < 0) {
+    return ret;
+  }
+
+  ret = irdb_upload_begin(&upload.up);
+  if (ret < 0) {
+    return ret;
+  }
+  upload.port = port;
+  upload.store = store;
+  return 0;
+}
+
+static size_t link_db_end(ir_link_port_t port, int *result, uint8_t *out) {
+  if (!upload.up.active || upload.port != port) {
+    *result = -EALREADY;
+    return 0;
+  }
+
+  if (upload.store) {
+    *result = irdb_upload_save(&upload.up, upload.name);
+    if (*result < 0) {
+      return 0;
+    }
+    LOG_INF("Stored '%s': %u entries, %u bytes, %u B/s", upload.name,
+            upload.up.entries, upload.up.bytes, irdb_upload_rate(&upload.up));
+    sys_put_le32(upload.up.entries, out);
+    sys_put_le32(upload.up.bytes, out + 4);
+    sys_put_le32(upload.up.elapsed_ms, out + 8);
+    return 12;
+  }
+
+  *result = irdb_upload_end(&upload.up);
+  if (*result < 0) {
+    return 0;
+  }
+  sys_put_le32(upload.up.db.entry_count, out);
+  *result = ir_service_add_database(upload.name, &upload.up.db);
+  if (*result < 0) {
+    irdb_free_database(&upload.up.db);
+    return 0;
+  }
+  return 4;
+}
+
+static size_t link_stats(uint8_t *out) {
+  uint32_t v[IR_LINK_STAT_COUNT];
+  ir_link_stats_t link;
+  uint32_t decoded = 0;
+
+  ir_stats_get(&link_snapshot);
+  ir_link_get_stats(&link);
+  for (size_t i = 0; i < ARRAY_SIZE(link_snapshot.decode.decoded); i++) {
+    decoded += link_snapshot.decode.decoded[i];
+  }
+
+  v[IR_LINK_STAT_RX_EDGES] = link_snapshot.rx.edges;
+  v[IR_LINK_STAT_RX_FRAMES] = link_snapshot.rx.frames;
+  v[IR_LINK_STAT_RX_OVERFLOWS] = link_snapshot.rx.overflows;
+  v[IR_LINK_STAT_DECODED] = decoded;
+  v[IR_LINK_STAT_REPEATS] = link_snapshot.decode.repeats;
+  v[IR_LINK_STAT_DECODE_FAILED] = link_snapshot.decode.failed;
+  v[IR_LINK_STAT_DECODE_DROPPED] = link_snapshot.decode.dropped;
+  v[IR_LINK_STAT_TX_FRAMES] = link_snapshot.tx.frames;
+  v[IR_LINK_STAT_TX_AIRTIME_MS] = link_snapshot.tx.airtime_us / 1000;
+  v[IR_LINK_STAT_TXQ_DEPTH] = link_snapshot.tx_queue.depth;
+  v[IR_LINK_STAT_TXQ_SUBMITTED] = link_snapshot.tx_queue.submitted;
+  v[IR_LINK_STAT_TXQ_DROPPED] = link_snapshot.tx_queue.dropped;
+  v[IR_LINK_STAT_TXQ_MAX_LATENCY_US] = link_snapshot.tx_queue.max_latency_us;
+  v[IR_LINK_STAT_LEARN_COMPLETED] = link_snapshot.learning.completed;
+  v[IR_LINK_STAT_LINK_COMMANDS] = link.commands;
+  v[IR_LINK_STAT_LINK_CRC_ERRORS] = link.crc_errors;
+  v[IR_LINK_STAT_LINK_OVERRUNS] = link.overruns;
+
+  for (size_t i = 0; i < ARRAY_SIZE(v); i++) {
+    sys_put_le32(v[i], out + 4 * i);
+  }
+  return sizeof(v);
+}
+
+/* 功能列表一页 - 从start起尽量填满一帧，页内遥控器切换时返回-ESTALE */
+static size_t link_list(const uint8_t *data, size_t len, size_t size,
+                        int *result, uint8_t *out) {
+  ir_service_func_iter_t it;
+  irdb_entry_t e;
+  char name[IRDB_NAME_MAX];
+  size_t off = 8;
+  int ret;
+
+  if (len != 4) {
+    *result = -EINVAL;
+    return 0;
+  }
+
+  ir_service_func_iter_init(&it, sys_get_le32(data));
+  for (;;) {
+    uint32_t index = it.index;
+
+    ret = ir_service_func_iter_next(&it, &e, name, sizeof(name));
+    if (ret < 0) {
+      break;
+    }
+
+    size_t n = strlen(name);
+    if (off + 9 + n > size) {
+      it.index = index; // 放不下，下一页从这条开始
+      break;
+    }
+    sys_put_le16(e.protocol, out + off);
+    sys_put_le16(e.device, out + off + 2);
+    sys_put_le16(e.subdevice, out + off + 4);
+    sys_put_le16(e.function, out + off + 6);
+    out[off + 8] = n;
+    memcpy(out + off + 9, name, n);
+    off += 9 + n;
+  }
+
+  if (ret < 0 && ret != -ENOENT) {
+    *result = ret;
+    return 0;
+  }
+  sys_put_le32(it.index, out);
+  sys_put_le32(it.count, out + 4);
+  return off;
+}
+
+/* 学习信号名称一页 */
+static size_t link_list_learned(const uint8_t *data, size_t len, size_t size,
+                                int *result, uint8_t *out) {
+  ir_learning_iter_t it;
+  char name[sizeof(((ir_learned_signal_t *)0)->name)];
+  size_t off = 2;
+  int ret;
+
+  if (len != 2) {
+    *result = -EINVAL;
+    return 0;
+  }
+
+  ir_learning_iter_init(&it);
+  it.index = sys_get_le16(data);
+  for (;;) {
+    uint16_t index = it.index;
+
+    ret = ir_learning_iter_next(&it, name, sizeof(name));
+    if (ret < 0) {
+      break;
+    }
+
+    size_t n = strlen(name);
+    if (off + 1 + n > size) {
+      it.index = index;
+      break;
+    }
+    out[off] = n;
+    memcpy(out + off + 1, name, n);
+    off += 1 + n;
+  }
+
+  if (ret < 0 && ret != -ENOENT) {
+    *result = ret;
+    return 0;
+  }
+  sys_put_le16(it.index, out);
+  return off;
+}
+
+/* 前缀查找一页 - 记录为"编号:名称"，可直接用于SEND_NAME */
+#define LINK_FIND_BATCH 4
+
+static size_t link_find(const uint8_t *data, size_t len, size_t size,
+                        int *result, uint8_t *out) {
+  ir_service_match_t m[LINK_FIND_BATCH];
+  char prefix[IRDB_NAME_MAX];
+  uint16_t skip;
+  size_t off = 2;
+  int n;
+
+  if (len < 2 || len - 2 >= sizeof(prefix)) {
+    *result = -EINVAL;
+    return 0;
+  }
+  skip = sys_get_le16(data);
+  memcpy(prefix, data + 2, len - 2);
+  prefix[len - 2] = '\0';
+
+  do {
+    n = ir_service_search_functions(prefix, skip, m, ARRAY_SIZE(m));
+    for (int i = 0; i < n; i++) {
+      size_t r = strlen(m[i].remote);
+      size_t k = strlen(m[i].name);
+      size_t rec = r + (r > 0) + k;
+
+      if (off + 1 + rec > size) {
+        n = 0; // 放不下，下一页从这条开始
+        break;
+      }
+      out[off] = rec;
+      memcpy(out + off + 1, m[i].remote, r);
+      if (r > 0) {
+        out[off + 1 + r] = ':';
+      }
+      memcpy(out + off + 1 + rec - k, m[i].name, k);
+      off += 1 + rec;
+      skip++;
+    }
+  } while ((size_t)n == ARRAY_SIZE(m));
+
+  sys_put_le16(skip, out);
+  return off;
+}
+
+/* 执行一帧命令并响应 */
+static void link_dispatch(ir_link_port_t port, uint8_t cmd, uint8_t seq,
+                          const uint8_t *data, size_t len) {
+  link_port_t *p = &ports[port];
+  uint8_t out[MAX(4 * IR_LINK_STAT_COUNT,
+                  IR_LINK_PAYLOAD_MAX - sizeof(int16_t))];
+  char name[IRDB_PARSER_LINE_MAX];
+  size_t out_len = 0;
+  int ret = 0;
+
+  p->stats.commands++;
+
+  switch (cmd) {
+  case IR_LINK_CMD_PING:
+    link_reply(p, cmd, seq, 0, data, len);
+    return;
+
+  case IR_LINK_CMD_SEND_ENTRY:
+    ret = len == IR_LINK_SEND_ENTRY_SIZE ? link_send_entry(data, 0) : -EINVAL;
+    break;
+
+  case IR_LINK_CMD_SEND_ID:
+    ret = len == 6 ? ir_service_send_id_async_on(
+                         (int32_t)sys_get_le32(data), data[4],
+                         link_channels(data[5]), NULL, NULL)
+                   : -EINVAL;
+    break;
+
+  case IR_LINK_CMD_SEND_NAME:
+    ret = len > 2 ? link_name(data + 2, len - 2, name, sizeof(name))
+                  : -EINVAL;
+    if (ret == 0) {
+      ret = ir_service_send_async_on(name, data[0], link_channels(data[1]),
+                                     NULL, NULL);
+    }
+    break;
+
+  case IR_LINK_CMD_SEND_BATCH: {
+    uint8_t queued = 0;
+
+    if (len == 0 || len % IR_LINK_SEND_ENTRY_SIZE != 0) {
+      ret = -EINVAL;
+    }
+    for (size_t off = 0; ret == 0 && off < len;
+         off += IR_LINK_SEND_ENTRY_SIZE) {
+      ret = link_send_entry(data + off, 0);
+      queued += ret == 0;
+    }
+    out[0] = queued;
+    out_len = 1;
+    break;
+  }
+
+  case IR_LINK_CMD_SEND_AT:
+    ret = len == 8 + IR_LINK_SEND_ENTRY_SIZE
+              ? link_send_entry(data + 8, sys_get_le64(data))
+              : -EINVAL;
+    break;
+
+  case IR_LINK_CMD_FIND_ID:
+    ret = link_name(data, len, name, sizeof(name));
+    if (ret == 0) {
+      ret = ir_service_find_function_id(name);
+    }
+    if (ret >= 0) {
+      sys_put_le32(ret, out);
+      out_len = 4;
+      ret = 0;
+    }
+    break;
+
+  case IR_LINK_CMD_LIST:
+    out_len = link_list(data, len, sizeof(out), &ret, out);
+    break;
+
+  case IR_LINK_CMD_LIST_LEARNED:
+    out_len = link_list_learned(data, len, sizeof(out), &ret, out);
+    break;
+
+  case IR_LINK_CMD_FIND:
+    out_len = link_find(data, len, sizeof(out), &ret, out);
+    break;
+
+  case IR_LINK_CMD_DB_BEGIN:
+  case IR_LINK_CMD_DB_STORE:
+    ret = link_db_begin(port, cmd == IR_LINK_CMD_DB_STORE, data, len);
+    break;
+
+  case IR_LINK_CMD_DB_CHUNK:
+    ret = upload.up.active && upload.port == port
+              ? irdb_upload_feed(&upload.up, data, len)
+              : -EALREADY;
+    break;
+
+  case IR_LINK_CMD_DB_END:
+    out_len = link_db_end(port, &ret, out);
+    break;
+
+  case IR_LINK_CMD_STATS:
+    out_len = link_stats(out);
+    break;
+
+  case IR_LINK_CMD_TIME:
+    if (len == 8) {
+      ir_timesync_set(sys_get_le64(data));
+    } else if (len != 0) {
+      ret = -EINVAL;
+      break;
+    }
+    sys_put_le64(ir_timesync_now_us(), out);
+    out_len = 8;
+    break;
+
+  default:
+    ret = -ENOTSUP;
+    break;
+  }
+
+  link_reply(p, cmd, seq, ret < 0 ? ret : 0, out, out_len);
+}
+
+/* 丢弃定帧缓冲的前n个字节，并跳到其后的下一个同步字节 */
+static void link_skip(link_port_t *p, size_t n) {
+  const uint8_t *next = memchr(p->frame + n, IR_LINK_SYNC, p->frame_len - n);
+  size_t skip = next ? (size_t)(next - p->frame) : p->frame_len;
+
+  memmove(p->frame, p->frame + skip, p->frame_len - skip);
+  p->frame_len -= skip;
+}
+
+/* 定帧 - 凑齐一帧且CRC正确时执行；长度超限或CRC错误时丢弃同步字节，
+ * 从缓冲中的下一个同步字节重新定帧 */
+static void link_frame(ir_link_port_t port) {
+  link_port_t *p = &ports[port];
+
+  while (p->frame_len >= IR_LINK_HEADER_SIZE) {
+    size_t payload = sys_get_le16(p->frame + 1);
+    size_t total = IR_LINK_HEADER_SIZE + payload + IR_LINK_CRC_SIZE;
+
+    if (payload > IR_LINK_PAYLOAD_MAX) {
+      p->stats.crc_errors++;
+      link_skip(p, 1);
+      continue;
+    }
+    if (p->frame_len < total) {
+      return;
+    }
+
+    uint16_t crc = sys_get_le16(p->frame + total - IR_LINK_CRC_SIZE);
+    if (crc16_itu_t(LINK_CRC_SEED, p->frame + 1, total - 3) != crc) {
+      p->stats.crc_errors++;
+      link_skip(p, 1);
+      continue;
+    }
+
+    link_dispatch(port, p->frame[3], p->frame[4],
+                  p->frame + IR_LINK_HEADER_SIZE, payload);
+    link_skip(p, total);
+  }
+}
+
+/* 取出接收缓冲中的字节 - 每凑齐一帧立即执行 */
+static void link_drain(ir_link_port_t port) {
+  link_port_t *p = &ports[port];
+  uint8_t chunk[64];
+  uint32_t n;
+
+  do {
+    k_spinlock_key_t key = k_spin_lock(&p->lock);
+    n = ring_buf_get(&p->rx, chunk, sizeof(chunk));
+    k_spin_unlock(&p->lock, key);
+
+    for (uint32_t i = 0; i < n; i++) {
+      if (p->frame_len == 0 && chunk[i] != IR_LINK_SYNC) {
+        continue;
+      }
+      p->frame[p->frame_len++] = chunk[i];
+      link_frame(port);
+    }
+  } while (n == sizeof(chunk));
+}
+
+static void link_thread_entry(void *p1, void *p2, void *p3) {
+  while (1) {
+    k_sem_take(&link_sem, K_FOREVER);
+    for (int i = 0; i < IR_LINK_PORT_COUNT; i++) {
+      link_drain(i);
+    }
+  }
+}
+
+void ir_link_get_stats(ir_link_stats_t *stats) {
+  memset(stats, 0, sizeof(*stats));
+  for (int i = 0; i < IR_LINK_PORT_COUNT; i++) {
+    stats->commands += ports[i].stats.commands;
+    stats->errors += ports[i].stats.errors;
+    stats->crc_errors += ports[i].stats.crc_errors;
+    stats->overruns += ports[i].stats.overruns;
+    stats->tx_errors += ports[i].stats.tx_errors;
+  }
+}
+
+int ir_link_init(void) {
+  int ret = 0;
+
+  for (int i = 0; i < IR_LINK_PORT_COUNT; i++) {
+    ring_buf_init(&ports[i].rx, sizeof(ports[i].rx_buf), ports[i].rx_buf);
+  }
+
+  k_thread_create(&link_thread, link_thread_stack,
+                  K_THREAD_STACK_SIZEOF(link_thread_stack), link_thread_entry,
+                  NULL, NULL, NULL, K_PRIO_PREEMPT(IR_LINK_THREAD_PRIORITY), 0,
+                  K_NO_WAIT);
+  k_thread_name_set(&link_thread, "ir_link");
+
+#ifdef CONFIG_IR_LINK_USB
+  ports[IR_LINK_PORT_USB].send = ir_link_usb_send;
+  ret = ir_link_usb_init();
+  if (ret < 0) {
+    LOG_ERR("USB link init failed: %d", ret);
+    return ret;
+  }
+#endif
+
+#ifdef CONFIG_IR_LINK_BLE
+  ports[IR_LINK_PORT_BLE].send = ir_link_ble_send;
+  ret = ir_link_ble_init();
+  if (ret < 0) {
+    LOG_ERR("BLE link init failed: %d", ret);
+    return ret;
+  }
+#endif
+
+  LOG_INF("Command link ready");
+  return ret;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file ir_link_ble.c
+ * @brief 命令链路BLE后端 - GATT服务，写特征收帧，通知特征回响应
+ *
+ * 集线器写RX特征(可无响应写入)，订阅TX特征的通知。帧按字节流定帧，
+ * 一次写入可以是半帧或多帧；响应按当前ATT MTU分段通知，集线器协商
+ * 247字节MTU时一帧响应通常一次通知发完。广播与连接由ir_ble.c管理。
+ */
+
+#include "ir_ble.h"
+#include "ir_link.h"
+#include <errno.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/kernel.h>
+
+#define LINK_ATT_HEADER 3 // 通知的ATT头部 (操作码+句柄)
+
+static const struct bt_uuid_128 link_svc_uuid =
+    BT_UUID_INIT_128(IR_BLE_UUID_LINK(1));
+static const struct bt_uuid_128 link_rx_uuid =
+    BT_UUID_INIT_128(IR_BLE_UUID_LINK(2));
+static const struct bt_uuid_128 link_tx_uuid =
+    BT_UUID_INIT_128(IR_BLE_UUID_LINK(3));
+
+static bool notify_enabled;
+
+static ssize_t link_write(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                          const void *buf, uint16_t len, uint16_t offset,
+                          uint8_t flags) {
+  if (offset != 0) {
+    return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+  }
+
+  ir_link_receive(IR_LINK_PORT_BLE, buf, len);
+  return len;
+}
+
+static void link_ccc_changed(const struct bt_gatt_attr *attr, uint16_t value) {
+  notify_enabled = value == BT_GATT_CCC_NOTIFY;
+}
+
+BT_GATT_SERVICE_DEFINE(
+    link_svc, BT_GATT_PRIMARY_SERVICE(&link_svc_uuid),
+    BT_GATT_CHARACTERISTIC(&link_rx_uuid.uuid,
+                           BT_GATT_CHRC_WRITE |
+                               BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+                           BT_GATT_PERM_WRITE, NULL, link_write, NULL),
+    BT_GATT_CHARACTERISTIC(&link_tx_uuid.uuid, BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_PERM_NONE, NULL, NULL, NULL),
+    BT_GATT_CCC(link_ccc_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE));
+
+/* 通知特征的值属性 (服务, RX声明, RX值, TX声明, TX值) */
+#define LINK_TX_ATTR (&link_svc.attrs[4])
+
+int ir_link_ble_send(const uint8_t *frame, size_t len) {
+  struct bt_conn *conn = notify_enabled ? ir_ble_conn_get() : NULL;
+
+  if (!conn) {
+    return -ENOTCONN;
+  }
+
+  size_t chunk = bt_gatt_get_mtu(conn) - LINK_ATT_HEADER;
+  int ret = 0;
+
+  while (len > 0 && ret == 0) {
+    size_t n = MIN(len, chunk);
+
+    ret = bt_gatt_notify(conn, LINK_TX_ATTR, frame, n);
+    frame += n;
+    len -= n;
+  }
+
+  bt_conn_unref(conn);
+  return ret;
+}
+
+int ir_link_ble_init(void) { return ir_ble_init(); }
@@ -0,0 +1,98 @@
+/**
+ * @file ir_link_usb.c
+ * @brief 命令链路USB后端 - CDC-ACM虚拟串口，中断驱动收发
+ *
+ * shell仍在UART0上，CDC-ACM只承载二进制帧。主机未打开串口(DTR无效)时
+ * 响应直接丢弃，不阻塞命令线程。
+ */
+
+#include "ir_link.h"
+#include <errno.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/ring_buffer.h>
+#include <zephyr/usb/usb_device.h>
+
+LOG_MODULE_REGISTER(ir_link_usb, LOG_LEVEL_INF);
+
+#define USB_TX_TIMEOUT_MS 50 // 发送缓冲持续满时放弃本帧响应
+#define USB_FIFO_CHUNK 64
+
+static const struct device *const cdc_dev =
+    DEVICE_DT_GET_ONE(zephyr_cdc_acm_uart);
+
+/* 发送缓冲 - 命令线程写入，中断取出填入FIFO */
+static struct k_spinlock tx_lock;
+RING_BUF_DECLARE(usb_tx_ring, 2 * IR_LINK_FRAME_MAX);
+static K_SEM_DEFINE(usb_tx_sem, 0, 1);
+
+static void usb_isr(const struct device *dev, void *user_data) {
+  while (uart_irq_update(dev) && uart_irq_is_pending(dev)) {
+    if (uart_irq_rx_ready(dev)) {
+      uint8_t buf[USB_FIFO_CHUNK];
+      int n = uart_fifo_read(dev, buf, sizeof(buf));
+
+      if (n > 0) {
+        ir_link_receive(IR_LINK_PORT_USB, buf, n);
+      }
+    }
+
+    if (uart_irq_tx_ready(dev)) {
+      k_spinlock_key_t key = k_spin_lock(&tx_lock);
+      uint8_t *data;
+      uint32_t n = ring_buf_get_claim(&usb_tx_ring, &data, USB_FIFO_CHUNK);
+
+      if (n == 0) {
+        uart_irq_tx_disable(dev);
+      } else {
+        int sent = uart_fifo_fill(dev, data, n);
+        ring_buf_get_finish(&usb_tx_ring, MAX(sent, 0));
+      }
+      k_spin_unlock(&tx_lock, key);
+      k_sem_give(&usb_tx_sem);
+    }
+  }
+}
+
+int ir_link_usb_send(const uint8_t *frame, size_t len) {
+  uint32_t dtr = 0;
+
+  if (uart_line_ctrl_get(cdc_dev, UART_LINE_CTRL_DTR, &dtr) == 0 && !dtr) {
+    return -ENOTCONN;
+  }
+
+  while (len > 0) {
+    k_spinlock_key_t key = k_spin_lock(&tx_lock);
+    uint32_t n = ring_buf_put(&usb_tx_ring, frame, len);
+    k_spin_unlock(&tx_lock, key);
+
+    frame += n;
+    len -= n;
+    uart_irq_tx_enable(cdc_dev);
+    if (len > 0 && k_sem_take(&usb_tx_sem, K_MSEC(USB_TX_TIMEOUT_MS)) != 0) {
+      return -EAGAIN;
+    }
+  }
+  return 0;
+}
+
+int ir_link_usb_init(void) {
+  if (!device_is_ready(cdc_dev)) {
+    LOG_ERR("CDC ACM device not ready");
+    return -ENODEV;
+  }
+
+#ifdef CONFIG_USB_DEVICE_STACK
+  int ret = usb_enable(NULL);
+  if (ret < 0 && ret != -EALREADY) {
+    return ret;
+  }
+#endif
+
+  uart_irq_callback_set(cdc_dev, usb_isr);
+  uart_irq_rx_enable(cdc_dev);
+  LOG_INF("USB link on %s", cdc_dev->name);
+  return 0;
+}
@@ -0,0 +1,454 @@
+/**
+ * @file ir_loopback.c
+ * @brief TX时序环回自测实现
+ */
+
+#include "ir_loopback.h"
+#include "ir_hal.h"
+#include "irdb_protocol.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(ir_loopback, LOG_LEVEL_INF);
+
+/* 接收侧状态 - RX消费线程写，测试线程在帧结束后读 */
+static struct {
+  struct k_sem done;
+  uint32_t *durations;
+  uint32_t count;
+  uint64_t first_us; // 首个沿的时间戳
+  bool overflow;
+  bool first_mark;
+  volatile bool armed;
+} capture;
+
+static atomic_t loopback_busy;
+
+/* 逐类累计 - mark和space分别求平均误差 */
+typedef struct {
+  int64_t sum;
+  uint64_t sum_sq;
+  int32_t min;
+  int32_t max;
+  uint32_t n;
+} error_acc_t;
+
+static void capture_callback(ir_pulse_t *pulse, void *user_data) {
+  if (!capture.armed) {
+    return;
+  }
+
+  if (pulse->frame_end) {
+    if (capture.count > 0) {
+      capture.armed = false;
+      k_sem_give(&capture.done);
+    }
+    return;
+  }
+
+  if (capture.count == 0) {
+    capture.first_us = pulse->timestamp_us;
+    capture.first_mark = pulse->is_mark;
+  }
+  if (capture.count < IR_LOOPBACK_MAX_EDGES) {
+    capture.durations[capture.count++] = pulse->duration_us;
+  } else {
+    capture.overflow = true;
+  }
+}
+
+static void acc_add(error_acc_t *acc, int32_t error) {
+  if (acc->n == 0 || error < acc->min) {
+    acc->min = error;
+  }
+  if (acc->n == 0 || error > acc->max) {
+    acc->max = error;
+  }
+  acc->sum += error;
+  acc->sum_sq += (int64_t)error * error;
+  acc->n++;
+}
+
+static int32_t acc_mean(const error_acc_t *acc) {
+  return acc->n ? (int32_t)(acc->sum / (int64_t)acc->n) : 0;
+}
+
+/* 去掉平均值后的平方和 */
+static uint64_t acc_var_sum(const error_acc_t *acc) {
+  if (acc->n == 0) {
+    return 0;
+  }
+
+  int64_t centered =
+      (int64_t)acc->sum_sq - acc->sum * acc->sum / (int64_t)acc->n;
+  return centered > 0 ? centered : 0;
+}
+
+static uint32_t isqrt64(uint64_t v) {
+  uint64_t r = 0;
+
+  for (uint64_t bit = 1ULL << 62; bit; bit >>= 2) {
+    if (v >= r + bit) {
+      v -= r + bit;
+      r = (r >> 1) + bit;
+    } else {
+      r >>= 1;
+    }
+  }
+  return r;
+}
+
+static uint32_t hist_bin(int32_t error) {
+  int32_t half = IR_LOOPBACK_HIST_BINS / 2 * IR_LOOPBACK_HIST_STEP_US;
+  return (CLAMP(error, -half, half - 1) + half) / IR_LOOPBACK_HIST_STEP_US;
+}
+
+/* 对比一帧 - 沿数不符返回false，末尾的space不在帧内不参与对比 */
+static bool frame_compare(const ir_timing_t *timings, uint32_t count,
+                          error_acc_t acc[2], ir_loopback_result_t *result) {
+  uint32_t expected = count - (count % 2 == 0);
+
+  if (capture.overflow || !capture.first_mark || capture.count != expected) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < expected; i++) {
+    int32_t error =
+        (int32_t)capture.durations[i] - (int32_t)ir_timing_us(timings[i]);
+
+    acc_add(&acc[i % 2], error);
+    result->hist[hist_bin(error)]++;
+    result->max_error_us = MAX(result->max_error_us, (uint32_t)abs(error));
+  }
+  result->edges += expected;
+  return true;
+}
+
+/* 逐帧变化的测试码 */
+static void loopback_entry(const irdb_protocol_params_t *params,
+                           uint16_t protocol, uint32_t frame,
+                           irdb_entry_t *entry) {
+  memset(entry, 0, sizeof(*entry));
+  entry->name = IRDB_NAME_NONE;
+  entry->protocol = protocol;
+  entry->device = 1;
+  entry->function = (frame * 37 + 1) & BIT_MASK(params->function_bits);
+}
+
+/* 逐帧发送并对比 - 返回收到的帧数或负errno */
+static int loopback_measure(const irdb_protocol_params_t *params,
+                            uint16_t protocol, uint32_t frames,
+                            ir_timing_t *timings,
+                            ir_loopback_result_t *result) {
+  error_acc_t acc[2] = {0};
+  uint64_t latency_sum = 0;
+  uint32_t received = 0;
+  int ret = 0;
+
+  ir_hal_tx_power_get();
+  uint64_t start_us = k_ticks_to_us_floor64(k_uptime_ticks());
+
+  for (uint32_t f = 0; f < frames; f++) {
+    irdb_entry_t entry;
+    uint32_t count;
+
+    loopback_entry(params, protocol, f, &entry);
+    if (irdb_encode_to_raw(&entry, timings, &count, IR_LOOPBACK_MAX_EDGES) <
+        0) {
+      ret = -ENOTSUP;
+      break;
+    }
+
+    capture.count = 0;
+    capture.overflow = false;
+    k_sem_reset(&capture.done);
+    capture.armed = true;
+
+    uint64_t sent_us = k_ticks_to_us_floor64(k_uptime_ticks());
+    ret = ir_hal_tx_frame(timings, count, params->frequency,
+                          params->duty_cycle);
+    if (ret < 0) {
+      capture.armed = false;
+      break;
+    }
+
+    result->frames++;
+    if (k_sem_take(&capture.done, K_MSEC(IR_LOOPBACK_FRAME_TIMEOUT_MS)) <
+            0 ||
+        !frame_compare(timings, count, acc, result)) {
+      capture.armed = false;
+      result->lost++;
+      continue;
+    }
+
+    uint32_t latency = capture.first_us > sent_us
+                           ? (uint32_t)(capture.first_us - sent_us)
+                           : 0;
+    latency_sum += latency;
+    result->max_latency_us = MAX(result->max_latency_us, latency);
+    received++;
+  }
+
+  result->elapsed_us =
+      (uint32_t)(k_ticks_to_us_floor64(k_uptime_ticks()) - start_us);
+  ir_hal_tx_power_put();
+
+  /* 抖动以各自类别的平均误差为基准，mark的整体偏移不计入抖动 */
+  result->mark_bias_us = acc_mean(&acc[0]);
+  result->space_bias_us = acc_mean(&acc[1]);
+  if (result->edges > 0) {
+    result->jitter_us = isqrt64(
+        (acc_var_sum(&acc[0]) + acc_var_sum(&acc[1])) / result->edges);
+  }
+  for (size_t k = 0; k < 2; k++) {
+    if (acc[k].n > 0) {
+      int32_t mean = acc_mean(&acc[k]);
+
+      result->max_jitter_us =
+          MAX(result->max_jitter_us,
+              (uint32_t)MAX(acc[k].max - mean, mean - acc[k].min));
+    }
+  }
+  if (received > 0) {
+    result->latency_us = latency_sum / received;
+  }
+  if (result->elapsed_us > 0) {
+    result->frames_per_sec =
+        (uint64_t)result->frames * USEC_PER_SEC / result->elapsed_us;
+  }
+  return ret < 0 ? ret : (int)received;
+}
+
+/* 测试环境 - 改写前的接收/发送设置和跳线通道的订阅 */
+typedef struct {
+  uint8_t rx_channel;
+  uint32_t gap;
+  uint8_t inverted;
+  bool envelope;
+  int16_t mark;
+  int16_t space;
+  int sub;
+} loopback_env_t;
+
+/* 进入测试环境 - 帧间隔按测试信号设定，跳线通道反相、不补偿，发送只输出
+ * 包络，订阅跳线通道并接收回波 */
+static int loopback_begin(loopback_env_t *env, uint8_t rx_channel,
+                          uint32_t frame_gap) {
+  k_sem_init(&capture.done, 0, 1);
+  capture.armed = false;
+
+  env->rx_channel = rx_channel;
+  env->gap = ir_hal_rx_get_frame_gap();
+  env->inverted = ir_hal_rx_get_inverted();
+  env->envelope = ir_hal_tx_get_envelope();
+
+  /* 跳线上没有接收头，不套用接收头补偿 */
+  ir_hal_rx_get_bias(rx_channel, &env->mark, &env->space);
+  ir_hal_rx_set_bias(rx_channel, 0, 0);
+  ir_hal_rx_set_frame_gap(frame_gap);
+  ir_hal_rx_set_inverted(env->inverted | BIT(rx_channel));
+  ir_hal_tx_set_envelope(true);
+
+  env->sub = ir_hal_rx_subscribe(BIT(rx_channel), capture_callback, NULL);
+  if (env->sub >= 0) {
+    /* 测量的正是自己发出的信号 */
+    ir_hal_rx_set_echo(env->sub, true);
+  }
+  return env->sub;
+}
+
+static void loopback_end(const loopback_env_t *env) {
+  if (env->sub >= 0) {
+    ir_hal_rx_unsubscribe(env->sub);
+  }
+  ir_hal_tx_set_envelope(env->envelope);
+  ir_hal_rx_set_inverted(env->inverted);
+  ir_hal_rx_set_frame_gap(env->gap);
+  ir_hal_rx_set_bias(env->rx_channel, env->mark, env->space);
+}
+
+int ir_loopback_run(uint16_t protocol, uint8_t rx_channel, uint32_t frames,
+                    ir_loopback_result_t *result) {
+  if (!result || frames == 0 || rx_channel >= IR_HAL_RX_CHANNELS) {
+    return -EINVAL;
+  }
+
+  const irdb_protocol_params_t *params = irdb_get_protocol_params(protocol);
+  if (!params) {
+    return -ENOTSUP;
+  }
+
+  if (atomic_test_and_set_bit(&loopback_busy, 0)) {
+    return -EBUSY;
+  }
+
+  /* 编码时序和测得时长共用一次分配 */
+  ir_timing_t *timings = k_malloc(IR_LOOPBACK_MAX_EDGES *
+                                  (sizeof(ir_timing_t) + sizeof(uint32_t)));
+  if (!timings) {
+    atomic_clear_bit(&loopback_busy, 0);
+    return -ENOMEM;
+  }
+
+  memset(result, 0, sizeof(*result));
+  result->protocol = protocol;
+  capture.durations = (uint32_t *)(timings + IR_LOOPBACK_MAX_EDGES);
+
+  /* 帧间隔按本协议设定，帧结束判定不被其他协议的门限拖长 */
+  loopback_env_t env;
+  int ret = loopback_begin(&env, rx_channel, irdb_frame_end_gap(protocol));
+  if (ret >= 0) {
+    ret = loopback_measure(params, protocol, frames, timings, result);
+    if (ret == 0) {
+      ret = -ETIMEDOUT;
+    }
+  }
+  loopback_end(&env);
+
+  k_free(timings);
+  atomic_clear_bit(&loopback_busy, 0);
+
+  if (ret < 0) {
+    LOG_ERR("Loopback P:%u failed: %d", protocol, ret);
+    return ret;
+  }
+
+  LOG_INF("Loopback P:%u %d/%u frames, bias %d/%d us, jitter %u us "
+          "(max %u), latency %u us",
+          protocol, ret, result->frames, result->mark_bias_us,
+          result->space_bias_us, result->jitter_us, result->max_jitter_us,
+          result->latency_us);
+  return 0;
+}
+
+/* 压力测试的随机时长 - 固定种子，各次运行的序列相同，结果可以对比 */
+static uint32_t stress_rand(uint32_t *state) {
+  uint32_t x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+/* 一串随机时长 - [min_us, max_us]内按时钟节拍取整，mark开头和结尾 */
+static uint32_t stress_burst(ir_timing_t *timings, uint32_t min_us,
+                             uint32_t max_us, uint32_t *seed,
+                             uint64_t *airtime_us) {
+  uint32_t tick = USEC_PER_SEC / IR_LOOPBACK_STRESS_CLOCK_HZ;
+  uint32_t span = (max_us - min_us) / tick + 1;
+  uint32_t count = IR_LOOPBACK_MAX_EDGES - 1;
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t us = min_us + stress_rand(seed) % span * tick;
+
+    timings[i] = ir_timing_pack(us);
+    *airtime_us += us;
+  }
+  return count;
+}
+
+int ir_loopback_stress(uint8_t rx_channel, uint32_t min_us, uint32_t max_us,
+                       uint32_t bursts, ir_loopback_stress_t *result) {
+  uint32_t tick = USEC_PER_SEC / IR_LOOPBACK_STRESS_CLOCK_HZ;
+
+  if (!result || bursts == 0 || rx_channel >= IR_HAL_RX_CHANNELS ||
+      min_us > max_us || max_us > IR_TIMING_SHORT_MAX_US) {
+    return -EINVAL;
+  }
+  /* 取整到节拍后至少一个节拍 */
+  min_us = MAX(min_us / tick * tick, tick);
+  max_us = MAX(max_us / tick * tick, min_us);
+
+  if (atomic_test_and_set_bit(&loopback_busy, 0)) {
+    return -EBUSY;
+  }
+
+  ir_timing_t *timings = k_malloc(IR_LOOPBACK_MAX_EDGES *
+                                  (sizeof(ir_timing_t) + sizeof(uint32_t)));
+  if (!timings) {
+    atomic_clear_bit(&loopback_busy, 0);
+    return -ENOMEM;
+  }
+
+  memset(result, 0, sizeof(*result));
+  result->min_us = min_us;
+  result->max_us = max_us;
+  capture.durations = (uint32_t *)(timings + IR_LOOPBACK_MAX_EDGES);
+
+  ir_hal_rx_stats_t before, after;
+  uint64_t airtime_us = 0;
+  uint64_t error_sum = 0;
+  uint32_t seed = 0x1badb002;
+  loopback_env_t env;
+
+  /* 串内的space都短于帧间隔，每串恰好一帧 */
+  int ret = loopback_begin(&env, rx_channel,
+                           MAX(4 * max_us, IR_LOOPBACK_STRESS_MIN_GAP_US));
+  ir_hal_rx_get_stats(&before);
+  ir_hal_tx_power_get();
+
+  for (uint32_t b = 0; ret >= 0 && b < bursts; b++) {
+    uint32_t count = stress_burst(timings, min_us, max_us, &seed, &airtime_us);
+
+    capture.count = 0;
+    capture.overflow = false;
+    k_sem_reset(&capture.done);
+    capture.armed = true;
+
+    ret = ir_hal_tx_frame(timings, count, IR_LOOPBACK_STRESS_CLOCK_HZ, 0);
+    if (ret < 0) {
+      capture.armed = false;
+      break;
+    }
+
+    result->bursts++;
+    result->sent += count;
+    if (k_sem_take(&capture.done, K_MSEC(IR_LOOPBACK_FRAME_TIMEOUT_MS)) < 0) {
+      capture.armed = false;
+    }
+    result->captured += capture.count;
+
+    if (capture.overflow || !capture.first_mark || capture.count != count) {
+      result->lost_bursts++;
+      continue;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t error = abs((int32_t)capture.durations[i] -
+                           (int32_t)ir_timing_us(timings[i]));
+
+      error_sum += error;
+      result->max_error_us = MAX(result->max_error_us, error);
+    }
+    result->compared += count;
+  }
+
+  ir_hal_tx_power_put();
+  ir_hal_rx_get_stats(&after);
+  loopback_end(&env);
+  k_free(timings);
+  atomic_clear_bit(&loopback_busy, 0);
+
+  if (ret < 0) {
+    LOG_ERR("Stress %u-%u us failed: %d", min_us, max_us, ret);
+    return ret;
+  }
+
+  result->overflows = after.overflows - before.overflows;
+  result->glitches = after.glitches - before.glitches;
+  if (airtime_us > 0) {
+    result->edge_rate = (uint64_t)result->sent * USEC_PER_SEC / airtime_us;
+  }
+  if (result->compared > 0) {
+    result->mean_error_us = error_sum / result->compared;
+  }
+
+  LOG_INF("Stress %u-%u us (%u edges/s): %u/%u pulses, %u/%u bursts lost",
+          min_us, max_us, result->edge_rate, result->captured, result->sent,
+          result->lost_bursts, result->bursts);
+  return 0;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file ir_lz.c
+ * @brief LZ压缩实现
+ */
+
+#include "ir_lz.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/util.h>
+
+enum {
+  LZ_CTRL,      // 等待控制字节
+  LZ_TOKEN,     // 等待字面量或匹配距离
+  LZ_MATCH_LEN, // 等待匹配长度
+};
+
+void ir_lz_encoder_init(ir_lz_encoder_t *enc, ir_lz_sink_t sink, void *ctx) {
+  memset(enc, 0, sizeof(*enc));
+  enc->sink = sink;
+  enc->ctx = ctx;
+}
+
+static int lz_flush_group(ir_lz_encoder_t *enc) {
+  int ret = 0;
+
+  if (enc->group_tokens > 0) {
+    ret = enc->sink(enc->ctx, enc->group, enc->group_len);
+    enc->out_bytes += enc->group_len;
+  }
+  enc->group_tokens = 0;
+  enc->group_len = 0;
+  return ret;
+}
+
+/* 在窗口中找待编码区的最长匹配，允许与待编码区重叠 */
+static uint16_t lz_longest(const ir_lz_encoder_t *enc, uint16_t *dist) {
+  const uint8_t *cur = enc->buf + enc->hist;
+  uint16_t best = 0;
+
+  for (uint16_t d = 1; d <= enc->hist; d++) {
+    const uint8_t *cand = cur - d;
+
+    /* 先比较能使匹配变长的那个字节 */
+    if (cand[best] != cur[best] || cand[0] != cur[0]) {
+      continue;
+    }
+    uint16_t len = 1;
+    while (len < enc->look && cand[len] == cur[len]) {
+      len++;
+    }
+    if (len > best) {
+      best = len;
+      *dist = d;
+      if (best == enc->look) {
+        break;
+      }
+    }
+  }
+  return best;
+}
+
+/* 编码待编码区起点的一个记号 */
+static int lz_emit(ir_lz_encoder_t *enc) {
+  uint16_t dist = 0;
+  uint16_t len = lz_longest(enc, &dist);
+
+  if (enc->group_tokens == 0) {
+    enc->group[0] = 0;
+    enc->group_len = 1;
+  }
+
+  if (len >= IR_LZ_MIN_MATCH) {
+    enc->group[0] |= BIT(enc->group_tokens);
+    enc->group[enc->group_len++] = dist - 1;
+    enc->group[enc->group_len++] = len - IR_LZ_MIN_MATCH;
+  } else {
+    len = 1;
+    enc->group[enc->group_len++] = enc->buf[enc->hist];
+  }
+
+  enc->hist += len;
+  enc->look -= len;
+  if (enc->hist > IR_LZ_WINDOW) {
+    memmove(enc->buf, enc->buf + enc->hist - IR_LZ_WINDOW,
+            IR_LZ_WINDOW + enc->look);
+    enc->hist = IR_LZ_WINDOW;
+  }
+
+  return ++enc->group_tokens == 8 ? lz_flush_group(enc) : 0;
+}
+
+int ir_lz_encode(ir_lz_encoder_t *enc, const void *data, size_t len) {
+  const uint8_t *p = data;
+
+  enc->in_bytes += len;
+  while (len > 0) {
+    size_t n = MIN(len, IR_LZ_MAX_MATCH - enc->look);
+
+    memcpy(enc->buf + enc->hist + enc->look, p, n);
+    enc->look += n;
+    p += n;
+    len -= n;
+
+    /* 待编码区满一个最长匹配才编码，保证匹配不被输入分块截短 */
+    if (enc->look == IR_LZ_MAX_MATCH) {
+      int ret = lz_emit(enc);
+      if (ret < 0) {
+        return ret;
+      }
+    }
+  }
+  return 0;
+}
+
+int ir_lz_encode_finish(ir_lz_encoder_t *enc) {
+  while (enc->look > 0) {
+    int ret = lz_emit(enc);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+  return lz_flush_group(enc);
+}
+
+void ir_lz_decoder_init(ir_lz_decoder_t *dec) {
+  memset(dec, 0, sizeof(*dec));
+}
+
+static void lz_next_token(ir_lz_decoder_t *dec) {
+  dec->flags >>= 1;
+  dec->state = --dec->flag_count == 0 ? LZ_CTRL : LZ_TOKEN;
+}
+
+size_t ir_lz_decode(ir_lz_decoder_t *dec, const void *in, size_t in_len,
+                    size_t *in_used, void *out, size_t out_len) {
+  const uint8_t *src = in;
+  uint8_t *dst = out;
+  size_t i = 0;
+  size_t o = 0;
+
+  while (o < out_len) {
+    if (dec->copy_left > 0) {
+      uint8_t c = dec->window[(uint8_t)(dec->pos - dec->dist - 1)];
+      dec->window[dec->pos++] = c;
+      dst[o++] = c;
+      dec->copy_left--;
+      continue;
+    }
+    if (i == in_len) {
+      break;
+    }
+
+    uint8_t b = src[i++];
+    switch (dec->state) {
+    case LZ_CTRL:
+      dec->flags = b;
+      dec->flag_count = 8;
+      dec->state = LZ_TOKEN;
+      break;
+    case LZ_TOKEN:
+      if (dec->flags & 1) {
+        dec->dist = b;
+        dec->state = LZ_MATCH_LEN;
+      } else {
+        dec->window[dec->pos++] = b;
+        dst[o++] = b;
+        lz_next_token(dec);
+      }
+      break;
+    default:
+      dec->copy_left = b + IR_LZ_MIN_MATCH;
+      lz_next_token(dec);
+      break;
+    }
+  }
+
+  *in_used = i;
+  return o;
+}
+
+int ir_lz_decode_all(ir_lz_decoder_t *dec, ir_lz_source_t source, void *ctx,
+                     void *out, size_t out_len) {
+  uint8_t chunk[64];
+  uint8_t *dst = out;
+  size_t done = 0;
+
+  /* 上一块剩下的匹配先输出，再按需读入 */
+  while (done < out_len) {
+    size_t used;
+    done += ir_lz_decode(dec, NULL, 0, &used, dst + done, out_len - done);
+    if (done == out_len) {
+      break;
+    }
+
+    ssize_t n = source(ctx, chunk, sizeof(chunk));
+    if (n <= 0) {
+      return n < 0 ? n : -EIO;
+    }
+
+    size_t pos = 0;
+    while (pos < (size_t)n && done < out_len) {
+      done += ir_lz_decode(dec, chunk + pos, n - pos, &used, dst + done,
+                           out_len - done);
+      pos += used;
+    }
+  }
+  return 0;
+}
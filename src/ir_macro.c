@@ -0,0 +1,204 @@
+/**
+ * @file ir_macro.c
+ * @brief IR宏/场景实现
+ */
+
+#include "ir_macro.h"
+#include "ir_hal.h"
+#include "ir_learning.h"
+#include "ir_mem.h"
+#include "ir_service.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(ir_macro, LOG_LEVEL_INF);
+
+/* 编译缓冲 - 学习信号按最大长度加载，协议帧在同一缓冲中编码，
+ * 正是一块时序缓冲 */
+#define MACRO_SCRATCH_TIMINGS IR_TIMING_BUF_TIMINGS
+
+/* 时序拷贝为恰好大小 */
+static int step_set_timings(ir_tx_step_t *step, const ir_timing_t *timings,
+                            uint32_t count) {
+  ir_timing_t *copy = k_malloc(count * sizeof(ir_timing_t));
+  if (!copy) {
+    return -ENOMEM;
+  }
+
+  memcpy(copy, timings, count * sizeof(ir_timing_t));
+  step->timings = copy;
+  step->timing_count = count;
+  return 0;
+}
+
+/* 编码协议条目 - 与异步发送相同: 多次发送时首帧之后发送重复码 */
+static int step_from_entry(ir_tx_step_t *step, const irdb_entry_t *entry,
+                           ir_timing_t *scratch) {
+  const irdb_protocol_params_t *params =
+      irdb_get_protocol_params(entry->protocol);
+  if (!params) {
+    return -ENOTSUP;
+  }
+  step->repeat = irdb_send_frames(params, step->repeat);
+
+  uint32_t count;
+  int ret = irdb_encode_to_raw(entry, scratch, &count, MACRO_SCRATCH_TIMINGS);
+  if (ret < 0) {
+    return ret;
+  }
+
+  if (step->repeat > 1) {
+    irdb_encode_repeat(entry, step->repeat_timings,
+                       &step->repeat_timing_count, IR_TX_REPEAT_MAX_TIMINGS);
+  }
+
+  step->carrier_freq = params->frequency;
+  step->duty_cycle = params->duty_cycle;
+  step->gap_us = params->gap;
+  step->period = true;
+  step->target = IR_TX_TARGET(entry->protocol, entry->device);
+  return step_set_timings(step, scratch, count);
+}
+
+/* 学习信号 - 已识别协议的重新编码，其余原样回放 */
+static int step_from_signal(ir_tx_step_t *step, const char *name,
+                            ir_timing_t *scratch) {
+  ir_learned_signal_t signal = {.timings = scratch};
+
+  int ret = ir_learning_load(&signal, name);
+  if (ret < 0) {
+    return ret;
+  }
+
+  if (signal.parametric) {
+    return step_from_entry(step, &signal.code, scratch);
+  }
+
+  step->carrier_freq = signal.carrier_freq > 0 ? signal.carrier_freq : 38000;
+  step->duty_cycle = 0;
+  step->gap_us = ir_learning_replay_period_us(&signal);
+  step->period = true;
+  return step_set_timings(step, signal.timings, signal.timing_count);
+}
+
+/* 编译一步 */
+static int macro_compile_step(ir_tx_step_t *step, const ir_macro_step_t *desc,
+                              ir_timing_t *scratch) {
+  if (!desc->name || (desc->channels & ~IR_HAL_TX_CH_ALL)) {
+    return -EINVAL;
+  }
+
+  memset(step, 0, sizeof(*step));
+  step->repeat = MAX(desc->repeat, 1);
+  step->channels = desc->channels ? desc->channels : IR_HAL_TX_CH_DEFAULT;
+  step->delay_us = desc->delay_ms * USEC_PER_MSEC;
+
+  if (desc->source == IR_MACRO_SIGNAL) {
+    return step_from_signal(step, desc->name, scratch);
+  }
+
+  const irdb_entry_t *entry = ir_service_find_function(desc->name);
+  if (!entry) {
+    return -ENOENT;
+  }
+  return step_from_entry(step, entry, scratch);
+}
+
+/* 只释放时序，不检查执行状态 */
+static void macro_release(ir_macro_t *macro) {
+  for (uint32_t i = 0; i < macro->step_count; i++) {
+    k_free((void *)macro->steps[i].timings);
+    macro->steps[i].timings = NULL;
+  }
+  macro->step_count = 0;
+}
+
+int ir_macro_compile(ir_macro_t *macro, const ir_macro_step_t *steps,
+                     size_t count) {
+  if (!macro || !steps || count == 0) {
+    return -EINVAL;
+  }
+  if (count > IR_MACRO_MAX_STEPS) {
+    return -E2BIG;
+  }
+
+  ir_timing_t *scratch = ir_timing_buf_alloc();
+  if (!scratch) {
+    return -ENOMEM;
+  }
+
+  memset(macro, 0, sizeof(*macro));
+  int ret = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    ret = macro_compile_step(&macro->steps[i], &steps[i], scratch);
+    if (ret < 0) {
+      LOG_ERR("Macro step %u (%s) failed: %d", i,
+              steps[i].name ? steps[i].name : "?", ret);
+      break;
+    }
+    macro->step_count++;
+  }
+  ir_timing_buf_free(scratch);
+
+  if (ret < 0) {
+    macro_release(macro);
+    return ret;
+  }
+
+  macro->seq.steps = macro->steps;
+  macro->seq.step_count = macro->step_count;
+  LOG_INF("Macro compiled: %u steps, %u ms", macro->step_count,
+          ir_macro_duration_us(macro) / USEC_PER_MSEC);
+  return 0;
+}
+
+int ir_macro_run(ir_macro_t *macro, ir_tx_sequence_done_t callback,
+                 void *user_data) {
+  if (!macro || macro->step_count == 0) {
+    return -EINVAL;
+  }
+
+  if (atomic_test_bit(&macro->seq.busy, 0)) {
+    return -EBUSY;
+  }
+
+  macro->seq.callback = callback;
+  macro->seq.user_data = user_data;
+  return ir_tx_queue_submit_sequence(&macro->seq);
+}
+
+int ir_macro_cancel(ir_macro_t *macro) {
+  if (!macro) {
+    return -EINVAL;
+  }
+
+  return ir_tx_sequence_cancel(&macro->seq);
+}
+
+int ir_macro_free(ir_macro_t *macro) {
+  if (!macro) {
+    return -EINVAL;
+  }
+
+  if (atomic_test_bit(&macro->seq.busy, 0)) {
+    return -EBUSY;
+  }
+
+  macro_release(macro);
+  macro->seq.step_count = 0;
+  return 0;
+}
+
+uint32_t ir_macro_duration_us(const ir_macro_t *macro) {
+  uint32_t total = 0;
+
+  for (uint32_t i = 0; i < macro->step_count; i++) {
+    total += ir_tx_step_duration_us(&macro->steps[i]);
+    if (i < macro->step_count - 1) {
+      total += macro->steps[i].delay_us;
+    }
+  }
+  return total;
+}
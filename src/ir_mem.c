@@ -0,0 +1,121 @@
+/**
+ * @file ir_mem.c
+ * @brief IR专用内存实现
+ */
+
+#include "ir_mem.h"
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/math_extras.h>
+
+LOG_MODULE_REGISTER(ir_mem, LOG_LEVEL_INF);
+
+#ifdef CONFIG_IRDB_HEAP_SIZE
+#define IRDB_HEAP_SIZE CONFIG_IRDB_HEAP_SIZE
+#else
+#define IRDB_HEAP_SIZE 16384
+#endif
+
+#ifdef CONFIG_IR_TIMING_BUFFERS
+#define IR_TIMING_BUFFERS CONFIG_IR_TIMING_BUFFERS
+#else
+#define IR_TIMING_BUFFERS 4
+#endif
+
+K_HEAP_DEFINE(irdb_heap, IRDB_HEAP_SIZE);
+K_MEM_SLAB_DEFINE_STATIC(timing_slab,
+                         IR_TIMING_BUF_TIMINGS * sizeof(ir_timing_t),
+                         IR_TIMING_BUFFERS, 4);
+
+static atomic_t heap_failures;
+static atomic_t bufs_failures;
+
+void *irdb_heap_alloc(size_t size) {
+  void *ptr = k_heap_alloc(&irdb_heap, size, K_NO_WAIT);
+  if (!ptr) {
+    atomic_inc(&heap_failures);
+  }
+  return ptr;
+}
+
+void *irdb_heap_calloc(size_t nmemb, size_t size) {
+  size_t bytes;
+
+  if (size_mul_overflow(nmemb, size, &bytes)) {
+    return NULL;
+  }
+  void *ptr = irdb_heap_alloc(bytes);
+  if (ptr) {
+    memset(ptr, 0, bytes);
+  }
+  return ptr;
+}
+
+void *irdb_heap_realloc(void *ptr, size_t size) {
+  if (!ptr) {
+    return irdb_heap_alloc(size);
+  }
+  if (size == 0) {
+    irdb_heap_free(ptr);
+    return NULL;
+  }
+
+  /* 与k_heap_alloc/free共用堆锁，原地扩展不下时由sys_heap搬移 */
+  k_spinlock_key_t key = k_spin_lock(&irdb_heap.lock);
+  void *new_ptr = sys_heap_realloc(&irdb_heap.heap, ptr, size);
+  k_spin_unlock(&irdb_heap.lock, key);
+
+  if (!new_ptr) {
+    atomic_inc(&heap_failures);
+  }
+  return new_ptr;
+}
+
+void irdb_heap_free(void *ptr) {
+  if (ptr) {
+    k_heap_free(&irdb_heap, ptr);
+  }
+}
+
+ir_timing_t *ir_timing_buf_alloc(void) {
+  void *block;
+
+  if (k_mem_slab_alloc(&timing_slab, &block, K_NO_WAIT) < 0) {
+    atomic_inc(&bufs_failures);
+    LOG_WRN("Timing buffer pool empty (%u blocks)", IR_TIMING_BUFFERS);
+    return NULL;
+  }
+  return block;
+}
+
+void ir_timing_buf_free(ir_timing_t *buf) {
+  if (buf) {
+    k_mem_slab_free(&timing_slab, buf);
+  }
+}
+
+void ir_mem_get_stats(ir_mem_stats_t *stats) {
+  memset(stats, 0, sizeof(*stats));
+
+  stats->heap_size = IRDB_HEAP_SIZE;
+  stats->heap_failures = atomic_get(&heap_failures);
+#ifdef CONFIG_SYS_HEAP_RUNTIME_STATS
+  struct sys_memory_stats heap;
+
+  if (sys_heap_runtime_stats_get(&irdb_heap.heap, &heap) == 0) {
+    stats->heap_used = heap.allocated_bytes;
+    stats->heap_max_used = heap.max_allocated_bytes;
+  }
+#endif
+
+  stats->bufs_total = IR_TIMING_BUFFERS;
+  stats->bufs_used = k_mem_slab_num_used_get(&timing_slab);
+#ifdef CONFIG_MEM_SLAB_TRACE_MAX_UTILIZATION
+  stats->bufs_max_used = k_mem_slab_max_used_get(&timing_slab);
+#else
+  stats->bufs_max_used = stats->bufs_used;
+#endif
+  stats->bufs_failures = atomic_get(&bufs_failures);
+}
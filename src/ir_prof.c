@@ -0,0 +1,175 @@
+/**
+ * @file ir_prof.c
+ * @brief 采样剖析实现 - RTC2比较中断读异常帧中的PC
+ */
+
+#include "ir_prof.h"
+#include <cmsis_core.h>
+#include <errno.h>
+#include <hal/nrf_rtc.h>
+#include <string.h>
+#include <zephyr/irq.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(ir_prof, LOG_LEVEL_INF);
+
+#define PROF_RTC NRF_RTC2
+#define PROF_RTC_IRQn RTC2_IRQn
+#define PROF_RTC_MASK 0xFFFFFF // 24位计数器
+#define PROF_PROBE 8           // 线性探测的最大步数，超过算槽满
+
+static struct {
+  ir_prof_slot_t slots[IR_PROF_SLOTS];
+  uint32_t period; // RTC节拍
+  uint32_t samples;
+  uint32_t dropped;
+  uint32_t distinct;
+  bool running;
+} prof;
+
+BUILD_ASSERT((IR_PROF_SLOTS & (IR_PROF_SLOTS - 1)) == 0,
+             "IR_PROF_SLOTS must be a power of two");
+
+static inline uint32_t prof_hash(uint32_t pc) {
+  return ((pc >> 1) * 2654435761u) & (IR_PROF_SLOTS - 1);
+}
+
+/* 计入一次采样 - 只在采样中断中调用，无需加锁 */
+static void prof_record(uint32_t pc) {
+  uint32_t slot = prof_hash(pc);
+
+  for (int i = 0; i < PROF_PROBE; i++) {
+    ir_prof_slot_t *s = &prof.slots[slot];
+
+    if (s->count == 0) {
+      s->pc = pc;
+      s->count = 1;
+      prof.distinct++;
+      prof.samples++;
+      return;
+    }
+    if (s->pc == pc) {
+      s->count++;
+      prof.samples++;
+      return;
+    }
+    slot = (slot + 1) & (IR_PROF_SLOTS - 1);
+  }
+  prof.dropped++;
+}
+
+/* 采样中断的C部分 - frame为硬件压栈的异常帧(r0-r3 r12 lr pc xpsr)，
+ * 由汇编入口按符号名跳转，不能是static */
+void ir_prof_isr_sample(const uint32_t *frame);
+
+void ir_prof_isr_sample(const uint32_t *frame) {
+  nrf_rtc_event_clear(PROF_RTC, NRF_RTC_EVENT_COMPARE_0);
+  nrf_rtc_cc_set(PROF_RTC, 0,
+                 (nrf_rtc_counter_get(PROF_RTC) + prof.period) &
+                     PROF_RTC_MASK);
+  prof_record(frame[6]);
+}
+
+/* 采样中断入口 - EXC_RETURN的bit2指出被打断处用的栈(线程PSP或中断
+ * MSP)，取异常帧地址后尾调用C部分，C部分返回即异常返回 */
+static void __attribute__((naked)) prof_isr(void) {
+  __asm volatile("tst lr, #4\n"
+                 "ite eq\n"
+                 "mrseq r0, msp\n"
+                 "mrsne r0, psp\n"
+                 "b ir_prof_isr_sample\n");
+}
+
+int ir_prof_start(uint32_t hz) {
+  if (hz == 0) {
+    hz = IR_PROF_HZ_DEFAULT;
+  }
+  if (hz > IR_PROF_HZ_MAX) {
+    return -EINVAL;
+  }
+  if (prof.running) {
+    return -EALREADY;
+  }
+
+  IRQ_DIRECT_CONNECT(PROF_RTC_IRQn, 0, prof_isr, 0);
+
+  memset(prof.slots, 0, sizeof(prof.slots));
+  prof.samples = 0;
+  prof.dropped = 0;
+  prof.distinct = 0;
+  prof.period = IR_PROF_RTC_HZ / hz;
+
+  nrf_rtc_task_trigger(PROF_RTC, NRF_RTC_TASK_STOP);
+  nrf_rtc_task_trigger(PROF_RTC, NRF_RTC_TASK_CLEAR);
+  nrf_rtc_prescaler_set(PROF_RTC, 0);
+  nrf_rtc_event_clear(PROF_RTC, NRF_RTC_EVENT_COMPARE_0);
+  nrf_rtc_cc_set(PROF_RTC, 0, prof.period);
+  nrf_rtc_int_enable(PROF_RTC, NRF_RTC_INT_COMPARE0_MASK);
+  NVIC_ClearPendingIRQ(PROF_RTC_IRQn);
+  irq_enable(PROF_RTC_IRQn);
+
+  prof.running = true;
+  nrf_rtc_task_trigger(PROF_RTC, NRF_RTC_TASK_START);
+
+  LOG_INF("Profiling at %u Hz", IR_PROF_RTC_HZ / prof.period);
+  return 0;
+}
+
+void ir_prof_stop(void) {
+  if (!prof.running) {
+    return;
+  }
+
+  irq_disable(PROF_RTC_IRQn);
+  nrf_rtc_int_disable(PROF_RTC, NRF_RTC_INT_COMPARE0_MASK);
+  nrf_rtc_task_trigger(PROF_RTC, NRF_RTC_TASK_STOP);
+  nrf_rtc_event_clear(PROF_RTC, NRF_RTC_EVENT_COMPARE_0);
+  prof.running = false;
+
+  LOG_INF("Profiling stopped: %u samples, %u PCs, %u dropped", prof.samples,
+          prof.distinct, prof.dropped);
+}
+
+void ir_prof_get_stats(ir_prof_stats_t *stats) {
+  stats->running = prof.running;
+  stats->hz = prof.period ? IR_PROF_RTC_HZ / prof.period : 0;
+  stats->samples = prof.samples;
+  stats->dropped = prof.dropped;
+  stats->distinct = prof.distinct;
+}
+
+/* 前max个 - 插入排序维护有序的结果表，max很小 */
+size_t ir_prof_top(ir_prof_slot_t *out, size_t max) {
+  size_t n = 0;
+
+  if (max == 0) {
+    return 0;
+  }
+  for (size_t i = 0; i < IR_PROF_SLOTS; i++) {
+    ir_prof_slot_t s = prof.slots[i];
+    size_t j;
+
+    if (s.count == 0 || (n == max && s.count <= out[n - 1].count)) {
+      continue;
+    }
+    j = n < max ? n++ : n - 1;
+    for (; j > 0 && out[j - 1].count < s.count; j--) {
+      out[j] = out[j - 1];
+    }
+    out[j] = s;
+  }
+  return n;
+}
+
+int ir_prof_next(uint32_t *pos, ir_prof_slot_t *slot) {
+  while (*pos < IR_PROF_SLOTS) {
+    const ir_prof_slot_t *s = &prof.slots[(*pos)++];
+
+    if (s->count > 0) {
+      *slot = *s;
+      return 0;
+    }
+  }
+  return -ENOENT;
+}
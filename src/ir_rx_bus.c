@@ -0,0 +1,38 @@
+/**
+ * @file ir_rx_bus.c
+ * @brief 解码事件总线实现
+ */
+
+#include "ir_rx_bus.h"
+
+#ifdef CONFIG_IR_RX_BUS
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(ir_rx_bus, LOG_LEVEL_INF);
+
+#define IR_RX_BUS_PUB_TIMEOUT_MS 10 // 等待通道的上限，不拖住解码工作队列
+
+/* 观察者由各模块用ZBUS_CHAN_ADD_OBS自行挂接，本模块不需要知道有哪些 */
+ZBUS_CHAN_DEFINE(ir_rx_chan, ir_rx_msg_t, NULL, NULL, ZBUS_OBSERVERS_EMPTY,
+                 ZBUS_MSG_INIT(.remote = IR_RX_BUS_NO_REMOTE));
+
+static atomic_t published;
+static atomic_t dropped;
+
+void ir_rx_bus_publish(const ir_rx_msg_t *msg) {
+  int ret = zbus_chan_pub(&ir_rx_chan, msg, K_MSEC(IR_RX_BUS_PUB_TIMEOUT_MS));
+
+  if (ret < 0) {
+    atomic_inc(&dropped);
+    LOG_DBG("Publish failed: %d", ret);
+    return;
+  }
+  atomic_inc(&published);
+}
+
+void ir_rx_bus_get_stats(uint32_t *published_out, uint32_t *dropped_out) {
+  *published_out = atomic_get(&published);
+  *dropped_out = atomic_get(&dropped);
+}
+#endif /* CONFIG_IR_RX_BUS */
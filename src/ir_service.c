@@ -4,312 +4,2347 @@
  */
 
 #include "ir_service.h"
+#include "ir_adapt.h"
+#include "ir_event.h"
+#include "ir_rx_bus.h"
+#include "irdb_corpus.h"
+#include "irdb_demux.h"
+#include "irdb_image.h"
+#include "irdb_irp.h"
+#include "irdb_pronto.h"
+#include "ir_tx_cache.h"
+#include "ir_trace.h"
+#include "ir_usage.h"
+#include <stdarg.h>
+#include <stdio.h>
 #include <string.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 
 LOG_MODULE_REGISTER(ir_service, LOG_LEVEL_INF);
 
+#ifdef CONFIG_IR_SERVICE_RX_TIMINGS
+#define MAX_RAW_TIMINGS CONFIG_IR_SERVICE_RX_TIMINGS
+#else
 #define MAX_RAW_TIMINGS 512
+#endif
+#ifdef CONFIG_IR_SERVICE_DECODE_STACK_SIZE
+#define DECODE_STACK_SIZE CONFIG_IR_SERVICE_DECODE_STACK_SIZE
+#else
+#define DECODE_STACK_SIZE 2048
+#endif
+#define DECODE_THREAD_PRIORITY 5
+#ifdef CONFIG_IR_SERVICE_DECODE_MEMO
+#define DECODE_MEMO_SIZE CONFIG_IR_SERVICE_DECODE_MEMO
+#else
+#define DECODE_MEMO_SIZE 4
+#endif
+#define REPEAT_WINDOW_MS 200 // 重复码距上一帧超过该时间则忽略
+#define SERVICE_MAX_PROTOCOLS (IRDB_PROTOCOL_MAX_ID + 1) // 解码索引上限
+#define TX_TOGGLE_SLOTS 8 // 跟踪toggle位的设备数，满时替换最久未发送的
+
+/* 解码工作队列 - 解码和用户回调都在此线程执行，不占用定时器中断 */
+K_THREAD_STACK_DEFINE(decode_stack, DECODE_STACK_SIZE);
+static struct k_work_q decode_work_q;
+static bool decode_q_started;
+
+/* 单个接收通道的解码状态 - 双缓冲: 一个接收中，一个待解码 */
+typedef struct {
+  ir_service_rx_callback_t callback;
+  void *user_data;
+  ir_timing_t timings[2][MAX_RAW_TIMINGS];
+  uint32_t timing_count; // 接收缓冲区计数
+  uint8_t fill_idx;      // 接收缓冲区索引
+  uint32_t decode_count; // 待解码帧长度
+  uint8_t decode_idx;    // 待解码缓冲区索引
+  atomic_t decode_busy;
+  uint32_t frames_dropped; // 解码未完成时到达而丢弃的帧
+  ir_trace_record_t decode_trace; // 待解码帧的时延记录
+  uint32_t decode_end_us;         // 待解码帧的帧结束时刻
+
+  /* 流式解码 - 帧分离器中每个帧假设一个状态机，逐脉冲推进 */
+  irdb_demux_t demux;
+  atomic_val_t stream_gen; // 建立分离器时的活动集版本
+  bool frame_decoded;        // 当前帧已由流式解码给出结果
+  irdb_entry_t stream_entry; // 待回调的流式解码结果
+  bool stream_repeat;        // stream_entry来自重复码
+  uint8_t stream_remote;     // stream_entry所属的遥控器槽位
+  uint8_t stream_quality;
+  uint32_t stream_end_us;
+  ir_trace_record_t stream_trace;
+  ir_service_press_t stream_press;
+  atomic_t stream_busy;
+  struct k_work stream_work;
+
+  /* 重复码映射到本通道最近一次解码结果 */
+  irdb_entry_t last_entry;
+  uint8_t last_remote; // last_entry所属的遥控器槽位
+  int32_t last_id;     // last_entry的功能编号，库中没有为-ENOENT
+  uint32_t last_ms;    // 最近一次解码或重复码时刻
+  int8_t last_toggle;
+  uint32_t presses;
+  bool last_valid;
+  struct k_spinlock lock;
+  struct k_work decode_work;
+  bool active;
+
+  /* 按键事件整形 - 只在解码工作队列中访问 */
+  ir_keys_state_t keys;
+  struct k_work_delayable key_work; // 最后一帧之后判定松开
+} rx_channel_ctx_t;
+
+/* 活动集中的一个遥控器 */
+typedef struct {
+  char id[IR_SERVICE_REMOTE_ID_MAX]; // 命令前缀，默认槽位为空串
+  irdb_database_t *db;      // 指向缓存条目或local_db
+  irdb_database_t local_db; // 未进入缓存的数据库(内置镜像、嵌入CSV)
+  bool cached;              // db持有缓存引用
+  bool loaded;
+} remote_slot_t;
+
+/* 活动集快照 - 接收、查找和发送路径只读取已发布的快照，不持有
+ * db_mutex。统一解码索引为活动集所有协议的并集，每帧每个协议只解码
+ * 一次，再到各遥控器的码值哈希表中查找 */
+typedef struct {
+  const irdb_database_t *dbs[IR_SERVICE_MAX_REMOTES]; // 空槽位为NULL
+  char ids[IR_SERVICE_MAX_REMOTES][IR_SERVICE_REMOTE_ID_MAX];
+  uint8_t selected;
+  uint16_t protocols[SERVICE_MAX_PROTOCOLS];
+  uint8_t protocol_count;
+  atomic_t readers; // 正在使用本快照的读者数
+} active_set_t;
 
 /* 服务状态 */
 static struct {
-  irdb_database_t current_db;
-  bool db_loaded;
+  /* 活动集 - 多个遥控器同时加载，"编号:功能"寻址，无前缀时用selected */
+  remote_slot_t remotes[IR_SERVICE_MAX_REMOTES];
+  uint8_t selected;
+
+  /* 双缓冲快照: 修改者在未发布的一份中建好后原子切换指针，等旧快照的
+   * 读者全部退出(宽限期)后才回收旧数据库 */
+  active_set_t sets[2];
+  atomic_ptr_t active;
+  atomic_t generation; // 活动集变化时递增，流式解码器据此重建
+
+  /* 接收状态 - 每个HAL接收通道一份，解码共用解码工作队列 */
+  struct {
+    ir_service_raw_callback_t raw_callback; // 未解码帧
+    void *raw_user_data;
+    ir_service_code_callback_t code_callback; // 解出的码值，不论库中有无
+    void *code_user_data;
+    ir_service_key_callback_t key_callback; // 整形后的按键事件
+    void *key_user_data;
+    rx_channel_ctx_t ch[IR_HAL_RX_CHANNELS];
+    int subscriber;  // HAL订阅号，与学习等其他订阅者共享边沿流
+    uint8_t channels; // 当前订阅的通道
+    ir_service_press_t press; // 正在回调的帧，只在解码工作队列中读写
+  } rx;
+} service_state;
+
+/* 发送端toggle位 - 按(协议, 设备, 子设备)记录，每次发送调用翻转一次，
+ * 同一次调用的重复帧沿用; 接收方据此区分新按键和长按 */
+static struct {
+  uint16_t protocol;
+  uint16_t device;
+  uint16_t subdevice;
+  uint8_t toggle;
+  bool used;
+  uint32_t last_ms;
+} tx_toggles[TX_TOGGLE_SLOTS];
+static struct k_spinlock tx_toggle_lock;
+
+/* 写侧锁 - 串行化活动集和接收配置的修改，查找、发送和接收路径不获取。
+ * 可重入，公共接口持有时内部的remote_set等可再次获取 */
+static K_MUTEX_DEFINE(db_mutex);
+
+#define GRACE_POLL_MS 1 // 等待旧快照读者退出的轮询间隔
+
+/* 接收统计 - 解码线程和接收线程中更新 */
+static struct {
+  atomic_t decoded[IRDB_PROTOCOL_MAX_ID + 1];
+  atomic_t unmatched[IRDB_PROTOCOL_MAX_ID + 1];
+  atomic_t repeats;
+  atomic_t failed;
+  atomic_t dropped;
+  atomic_t memo_hits;
+  atomic_t overlapped;
+  atomic_t key_events;
+} rx_stats;
+
+/* 整帧解码备忘 - 量化时序的哈希 -> 解码结果。按住或连按同一键时帧相同，
+ * 命中后只用记下的协议复核一次，不再逐个协议尝试。只在解码工作队列中
+ * 读写，活动集变化(generation)后作废 */
+typedef struct {
+  uint32_t hash;
+  uint16_t count; // 0为空
+  uint8_t remote;
+  uint8_t ret; // 0或RX_CODE_ONLY
+  irdb_entry_t entry;
+  atomic_val_t gen;
+  uint32_t used; // 最近使用序号，满时替换最小的
+} decode_memo_t;
+
+#if DECODE_MEMO_SIZE > 0
+static decode_memo_t decode_memo[DECODE_MEMO_SIZE];
+static uint32_t decode_memo_clock;
+#endif
+
+static void rx_stats_count(atomic_t *table, uint16_t protocol) {
+  if (protocol <= IRDB_PROTOCOL_MAX_ID) {
+    atomic_inc(&table[protocol]);
+  }
+}
+
+/* 是否有已加载的遥控器 */
+static bool remotes_loaded(void) {
+  for (size_t r = 0; r < ARRAY_SIZE(service_state.remotes); r++) {
+    if (service_state.remotes[r].loaded) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* 加入解码索引，帧间隔取各协议门限的最大值，长帧内间隔不会被误切 */
+static void index_add(active_set_t *set, uint16_t protocol,
+                      uint32_t *gap_us) {
+  uint8_t k = 0;
+
+  while (k < set->protocol_count && set->protocols[k] != protocol) {
+    k++;
+  }
+  if (k == set->protocol_count) {
+    if (k == ARRAY_SIZE(set->protocols)) {
+      LOG_WRN("Protocol %u not indexed (limit %u)", protocol, k);
+      return;
+    }
+    set->protocols[set->protocol_count++] = protocol;
+  }
+  *gap_us = MAX(*gap_us, irdb_frame_end_gap(protocol));
+}
+
+/* 进入读侧 - 取得当前快照并登记为读者。登记后快照已换下时重取，
+ * 修改者据此保证宽限期结束后没有读者再拿到旧快照 */
+static active_set_t *active_enter(void) {
+  for (;;) {
+    active_set_t *set = atomic_ptr_get(&service_state.active);
+
+    atomic_inc(&set->readers);
+    if (atomic_ptr_get(&service_state.active) == set) {
+      return set;
+    }
+    atomic_dec(&set->readers);
+  }
+}
+
+static void active_exit(active_set_t *set) { atomic_dec(&set->readers); }
+
+/* 按槽位重建并发布快照 - 没有数据库或在嗅探码值时解码所有已注册协议，
+ * 否则只解码活动集中各库协议的并集。返回时旧快照已无读者，其引用的
+ * 数据库可以回收。调用者持有db_mutex */
+static void remotes_publish(void) {
+  active_set_t *old = atomic_ptr_get(&service_state.active);
+  active_set_t *set = old == &service_state.sets[0] ? &service_state.sets[1]
+                                                    : &service_state.sets[0];
+  uint32_t gap_us = 0;
+
+  /* 未发布的一份在上次发布的宽限期内已无读者 */
+  set->protocol_count = 0;
+  for (size_t r = 0; r < ARRAY_SIZE(service_state.remotes); r++) {
+    const remote_slot_t *slot = &service_state.remotes[r];
+
+    set->dbs[r] = slot->loaded ? slot->db : NULL;
+    strcpy(set->ids[r], slot->id);
+  }
+  set->selected = service_state.selected;
+  if (!remotes_loaded() || service_state.rx.code_callback ||
+      service_state.rx.key_callback) {
+    for (uint16_t p = 0; p <= IRDB_PROTOCOL_MAX_ID; p++) {
+      if (irdb_get_protocol_params(p)) {
+        index_add(set, p, &gap_us);
+      }
+    }
+  } else {
+    for (size_t r = 0; r < ARRAY_SIZE(set->dbs); r++) {
+      for (uint8_t i = 0; set->dbs[r] && i < set->dbs[r]->protocol_count;
+           i++) {
+        index_add(set, set->dbs[r]->protocols[i], &gap_us);
+      }
+    }
+  }
+
+  atomic_ptr_set(&service_state.active, set);
+  atomic_inc(&service_state.generation);
+  ir_hal_rx_set_frame_gap(gap_us);
+
+  /* 宽限期 - 读侧只覆盖单帧解码和查找，很快结束 */
+  while (atomic_get(&old->readers) != 0) {
+    k_msleep(GRACE_POLL_MS);
+  }
+}
+
+/* 按编号查找已加载的遥控器 - 写侧，调用者持有db_mutex */
+static remote_slot_t *remote_find(const char *id, size_t len) {
+  for (size_t r = 0; r < ARRAY_SIZE(service_state.remotes); r++) {
+    remote_slot_t *slot = &service_state.remotes[r];
+
+    if (slot->loaded && strlen(slot->id) == len &&
+        strncmp(slot->id, id, len) == 0) {
+      return slot;
+    }
+  }
+  return NULL;
+}
+
+/* 回收槽位原有的数据库 - 缓存中的只释放引用，留在缓存供快速切换。
+ * 调用者持有db_mutex，且已发布不含该数据库的快照 */
+static void remote_reclaim(irdb_database_t *db, bool cached) {
+  if (cached) {
+    irdb_cache_release(db);
+  } else {
+    irdb_free_database(db);
+  }
+}
+
+/* 发送缓存按码值索引，换下遥控器后为仍在活动集中的重新预编码 */
+static void remote_recompile(void) {
+  ir_tx_cache_clear();
+  for (size_t r = 0; r < ARRAY_SIZE(service_state.remotes); r++) {
+    if (service_state.remotes[r].loaded) {
+      ir_tx_cache_precompile(service_state.remotes[r].db);
+    }
+  }
+}
+
+/* 移出活动集 - 先发布不含该遥控器的快照，宽限期后再回收 */
+static void remote_release(remote_slot_t *slot) {
+  k_mutex_lock(&db_mutex, K_FOREVER);
+  bool was_loaded = slot->loaded;
+  if (was_loaded) {
+    slot->loaded = false;
+    remotes_publish();
+    remote_reclaim(slot->db, slot->cached);
+  }
+  slot->db = &slot->local_db;
+  slot->cached = false;
+  k_mutex_unlock(&db_mutex);
+
+  if (was_loaded) {
+    remote_recompile();
+  }
+}
+
+/* 遥控器加入活动集，替换槽位原有的数据库 - db为缓存条目(cached)或已
+ * 完整建好的本地数据库，后者移入槽位并清空*db。新库先以原地址发布，
+ * 原库宽限期后回收，接收路径始终看到完整的一份 */
+static void remote_set(remote_slot_t *slot, irdb_database_t *db, bool cached) {
+  k_mutex_lock(&db_mutex, K_FOREVER);
+  bool was_loaded = slot->loaded;
+  irdb_database_t *old_db = slot->db;
+  bool old_cached = slot->cached;
+
+  /* 前缀查找的名称序在发布前建好，缓存条目只建一次 */
+  irdb_build_name_order(db);
+
+  slot->db = db;
+  slot->cached = cached;
+  slot->loaded = true;
+  remotes_publish();
+  if (was_loaded) {
+    remote_reclaim(old_db, old_cached);
+  }
+
+  if (!cached) {
+    /* 本地库移入槽位后再发布一次，宽限期过后调用者的*db不再被引用，
+     * 这时才能清空 */
+    slot->local_db = *db;
+    slot->db = &slot->local_db;
+    remotes_publish();
+    memset(db, 0, sizeof(*db));
+  }
+  k_mutex_unlock(&db_mutex);
+
+  if (was_loaded) {
+    remote_recompile();
+  } else {
+    ir_tx_cache_precompile(slot->db);
+  }
+}
+
+/* 在快照中按码值查找，remote_out为所属槽位 */
+static const irdb_entry_t *remotes_lookup(const active_set_t *set,
+                                          const irdb_entry_t *code,
+                                          uint8_t *remote_out) {
+  for (size_t r = 0; r < ARRAY_SIZE(set->dbs); r++) {
+    const irdb_entry_t *entry;
+
+    if (!set->dbs[r]) {
+      continue;
+    }
+    entry = irdb_lookup_code(set->dbs[r], code->protocol, code->device,
+                             code->subdevice, code->function);
+    if (entry) {
+      *remote_out = r;
+      return entry;
+    }
+  }
+  *remote_out = IR_RX_BUS_NO_REMOTE;
+  return NULL;
+}
+
+/* 解码结果的功能编号 - 所属槽位已知，按码值查一次哈希 */
+static int32_t rx_entry_id(const irdb_entry_t *entry, uint8_t remote) {
+  if (remote >= IR_SERVICE_MAX_REMOTES) {
+    return -ENOENT;
+  }
+
+  active_set_t *set = active_enter();
+  const irdb_database_t *db = set->dbs[remote];
+  const irdb_entry_t *found =
+      db ? irdb_lookup_code(db, entry->protocol, entry->device,
+                            entry->subdevice, entry->function)
+         : NULL;
+  int32_t id = found
+                   ? remote << IR_SERVICE_ID_SHIFT | (found - db->entries)
+                   : -ENOENT;
+  active_exit(set);
+  return id;
+}
+
+/* 按编号在快照中查找遥控器，返回槽位下标，未找到返回-1 */
+static int set_find(const active_set_t *set, const char *id, size_t len) {
+  for (size_t r = 0; r < ARRAY_SIZE(set->dbs); r++) {
+    if (set->dbs[r] && strlen(set->ids[r]) == len &&
+        strncmp(set->ids[r], id, len) == 0) {
+      return r;
+    }
+  }
+  return -1;
+}
+
+/* 条目所属的遥控器 - 库内条目按地址判断，解码结果的副本按码值和名称
+ * 偏移判断，都不匹配时归于当前选中的遥控器 */
+static size_t set_of_entry(const active_set_t *set,
+                           const irdb_entry_t *entry) {
+  for (size_t r = 0; r < ARRAY_SIZE(set->dbs); r++) {
+    const irdb_database_t *db = set->dbs[r];
+
+    if (db && entry >= db->entries && entry < db->entries + db->entry_count) {
+      return r;
+    }
+  }
+
+  for (size_t r = 0; r < ARRAY_SIZE(set->dbs); r++) {
+    const irdb_entry_t *found;
+
+    if (!set->dbs[r]) {
+      continue;
+    }
+    found = irdb_lookup_code(set->dbs[r], entry->protocol, entry->device,
+                             entry->subdevice, entry->function);
+    if (found && found->name == entry->name) {
+      return r;
+    }
+  }
+  return set->selected;
+}
+
+/* 解析"编号:功能" - 前缀不是活动集中的编号时整串作为选中遥控器的功能名。
+ * 返回槽位下标，选中的遥控器为空时返回-1 */
+static int set_resolve(const active_set_t *set, const char *name,
+                       const char **function) {
+  const char *sep = strchr(name, IR_SERVICE_REMOTE_SEP);
+
+  if (sep) {
+    int r = set_find(set, name, sep - name);
+    if (r >= 0) {
+      *function = sep + 1;
+      return r;
+    }
+  }
+
+  *function = name;
+  return set->dbs[set->selected] ? set->selected : -1;
+}
+
+/* 在快照中按"编号:功能"查找条目 */
+static int set_find_function(const active_set_t *set, const char *name,
+                             const irdb_entry_t **entry_out) {
+  const char *function;
+  int r = set_resolve(set, name, &function);
+
+  if (r < 0) {
+    LOG_ERR("No database loaded");
+    return -EINVAL;
+  }
+
+  *entry_out = irdb_find_function(set->dbs[r], function);
+  if (!*entry_out) {
+    LOG_ERR("Function not found: %s", name);
+    return -ENOENT;
+  }
+  return 0;
+}
+
+/* 按"编号:功能"查找条目并复制 - 发送只用副本，遥控器随后被替换也无妨 */
+static int find_function(const char *name, irdb_entry_t *entry_out) {
+  const irdb_entry_t *entry;
+  active_set_t *set = active_enter();
+  int ret = set_find_function(set, name, &entry);
+
+  if (ret == 0) {
+    *entry_out = *entry;
+  }
+  active_exit(set);
+  return ret;
+}
+
+/* 同一按键 (协议和码值相同) */
+static bool same_code(const irdb_entry_t *a, const irdb_entry_t *b) {
+  return a->protocol == b->protocol && a->device == b->device &&
+         a->subdevice == b->subdevice && a->function == b->function;
+}
+
+/* 下一次发送的toggle位 - 调用一次翻转一次 */
+static uint8_t tx_toggle_next(const irdb_entry_t *entry) {
+  uint32_t now = k_uptime_get_32();
+  int slot = -1;
+
+  k_spinlock_key_t key = k_spin_lock(&tx_toggle_lock);
+  for (int i = 0; i < TX_TOGGLE_SLOTS && slot < 0; i++) {
+    if (tx_toggles[i].used && tx_toggles[i].protocol == entry->protocol &&
+        tx_toggles[i].device == entry->device &&
+        tx_toggles[i].subdevice == entry->subdevice) {
+      slot = i;
+    }
+  }
+
+  if (slot < 0) {
+    slot = 0;
+    for (int i = 0; i < TX_TOGGLE_SLOTS && tx_toggles[slot].used; i++) {
+      if (!tx_toggles[i].used ||
+          now - tx_toggles[i].last_ms > now - tx_toggles[slot].last_ms) {
+        slot = i;
+      }
+    }
+    tx_toggles[slot].protocol = entry->protocol;
+    tx_toggles[slot].device = entry->device;
+    tx_toggles[slot].subdevice = entry->subdevice;
+    tx_toggles[slot].toggle = 1; // 首次发送为0
+    tx_toggles[slot].used = true;
+  }
+
+  tx_toggles[slot].toggle ^= 1;
+  tx_toggles[slot].last_ms = now;
+  uint8_t toggle = tx_toggles[slot].toggle;
+  k_spin_unlock(&tx_toggle_lock, key);
+  return toggle;
+}
+
+/* 编码条目 - 有toggle位的协议按设备翻转 */
+static int encode_entry(const irdb_entry_t *entry,
+                        const irdb_protocol_params_t *params,
+                        ir_timing_t *timings_out, uint32_t *length_out,
+                        uint32_t max_length) {
+  uint8_t toggle = params->toggle_bit ? tx_toggle_next(entry) : 0;
+
+  return irdb_encode_with_toggle(entry, toggle, timings_out, length_out,
+                                 max_length);
+}
+
+/* 记录最近一次解码结果 - toggle位变化、码值变化或超过重复窗口为新按键。
+ * 功能编号在这里查一次，长按的重复码沿用 */
+static void rx_remember(rx_channel_ctx_t *rx, const irdb_entry_t *entry,
+                        uint8_t remote, int toggle,
+                        ir_service_press_t *press_out) {
+  uint32_t now = k_uptime_get_32();
+  int32_t id = rx_entry_id(entry, remote);
+
+  k_spinlock_key_t key = k_spin_lock(&rx->lock);
+  bool held = rx->last_valid && same_code(&rx->last_entry, entry) &&
+              now - rx->last_ms <= REPEAT_WINDOW_MS &&
+              toggle == rx->last_toggle;
+  if (!held) {
+    rx->presses++;
+  }
+  rx->last_entry = *entry;
+  rx->last_remote = remote;
+  rx->last_id = id;
+  rx->last_ms = now;
+  rx->last_toggle = toggle;
+  rx->last_valid = true;
+  *press_out = (ir_service_press_t){
+      .new_press = !held,
+      .toggle = toggle,
+      .channel = rx - service_state.rx.ch,
+      .presses = rx->presses,
+      .id = id,
+  };
+  k_spin_unlock(&rx->lock, key);
+}
+
+/* 重复码 - 在有效窗口内返回最近一次解码结果及其所属槽位 */
+static bool rx_repeat_entry(rx_channel_ctx_t *rx, irdb_entry_t *entry_out,
+                            uint8_t *remote_out,
+                            ir_service_press_t *press_out) {
+  bool ok = false;
+  uint32_t now = k_uptime_get_32();
+
+  k_spinlock_key_t key = k_spin_lock(&rx->lock);
+  if (rx->last_valid && now - rx->last_ms <= REPEAT_WINDOW_MS) {
+    *entry_out = rx->last_entry;
+    *remote_out = rx->last_remote;
+    rx->last_ms = now;
+    *press_out = (ir_service_press_t){
+        .new_press = false,
+        .toggle = rx->last_toggle,
+        .channel = rx - service_state.rx.ch,
+        .presses = rx->presses,
+        .id = rx->last_id,
+    };
+    ok = true;
+  }
+  k_spin_unlock(&rx->lock, key);
+  return ok;
+}
+
+/* 整帧是否为快照中某协议的重复码 */
+static bool rx_is_repeat(const active_set_t *set, const ir_timing_t *timings,
+                         uint32_t count) {
+  for (uint8_t i = 0; i < set->protocol_count; i++) {
+    if (irdb_is_repeat_frame(set->protocols[i], timings, count)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* 整帧解码 - 每个协议只解码一次，按时序误差排序后依次到所有遥控器中
+ * 查找，帧结构相同的协议同时解出时取误差最小的库中条目。返回0为库中
+ * 条目，RX_CODE_ONLY为库中没有的码值(误差最小的协议)，-ENOENT无法解码 */
+#define RX_CODE_ONLY 1
+
+static int rx_decode_frame(const active_set_t *set, const ir_timing_t *timings,
+                           uint32_t count, irdb_entry_t *entry_out,
+                           int *toggle_out, uint8_t *remote_out) {
+  irdb_candidate_t cand[IRDB_MAX_CANDIDATES];
+
+  *remote_out = IR_RX_BUS_NO_REMOTE;
+
+  int n = irdb_decode_ranked(set->protocols, set->protocol_count, timings,
+                             count, cand, ARRAY_SIZE(cand));
+  if (n < 0) {
+    return -ENOENT;
+  }
+
+  for (int i = 0; i < n; i++) {
+    const irdb_entry_t *entry =
+        remotes_lookup(set, &cand[i].entry, remote_out);
+    if (entry) {
+      *entry_out = *entry;
+      *toggle_out = cand[i].toggle;
+      return 0;
+    }
+  }
+
+  *entry_out = cand[0].entry;
+  *toggle_out = cand[0].toggle;
+  return RX_CODE_ONLY;
+}
+
+#if DECODE_MEMO_SIZE > 0
+/* 量化时序的哈希 - 按对数分桶(每个二进制量级4档，约20%)，接收头抖动
+ * 通常留在同一档内; 跨档的帧只是未命中，仍完整解码 */
+static uint32_t memo_hash(const ir_timing_t *timings, uint32_t count) {
+  uint32_t hash = 2166136261u;
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t us = ir_timing_us(timings[i]);
+    uint32_t bucket = us;
+
+    if (us >= 4) {
+      uint32_t msb = 31 - __builtin_clz(us);
+      bucket = (msb << 2) | ((us >> (msb - 2)) & 3);
+    }
+    hash = (hash ^ bucket) * 16777619u;
+  }
+  return hash;
+}
+
+/* 备忘命中 - 用记下的协议重新解码复核码值，toggle位取自本帧 */
+static int rx_memo_lookup(uint32_t hash, uint32_t count, atomic_val_t gen,
+                          const ir_timing_t *timings, irdb_entry_t *entry_out,
+                          int *toggle_out, uint8_t *remote_out) {
+  for (size_t i = 0; i < DECODE_MEMO_SIZE; i++) {
+    decode_memo_t *memo = &decode_memo[i];
+    irdb_entry_t code;
+
+    if (memo->count != count || memo->hash != hash || memo->gen != gen) {
+      continue;
+    }
+    if (irdb_decode_with_toggle(memo->entry.protocol, timings, count, &code,
+                                toggle_out) < 0 ||
+        !same_code(&code, &memo->entry)) {
+      memo->count = 0; // 哈希碰撞或量化过粗，作废
+      return -ENOENT;
+    }
+
+    memo->used = ++decode_memo_clock;
+    *entry_out = memo->entry;
+    *remote_out = memo->remote;
+    atomic_inc(&rx_stats.memo_hits);
+    return memo->ret;
+  }
+  return -ENOENT;
+}
+
+static void rx_memo_store(uint32_t hash, uint32_t count, atomic_val_t gen,
+                          int ret, const irdb_entry_t *entry,
+                          uint8_t remote) {
+  decode_memo_t *victim = &decode_memo[0];
+
+  for (size_t i = 1; i < DECODE_MEMO_SIZE && victim->count != 0; i++) {
+    if (decode_memo[i].count == 0 || decode_memo[i].used < victim->used) {
+      victim = &decode_memo[i];
+    }
+  }
+  *victim = (decode_memo_t){
+      .hash = hash,
+      .count = count,
+      .remote = remote,
+      .ret = ret,
+      .entry = *entry,
+      .gen = gen,
+      .used = ++decode_memo_clock,
+  };
+}
+#endif
+
+/* 整帧解码，先查备忘 - gen为取快照前读到的活动集版本 */
+static int rx_decode_memo(const active_set_t *set, atomic_val_t gen,
+                          const ir_timing_t *timings, uint32_t count,
+                          irdb_entry_t *entry_out, int *toggle_out,
+                          uint8_t *remote_out) {
+#if DECODE_MEMO_SIZE > 0
+  if (count > UINT16_MAX) {
+    return rx_decode_frame(set, timings, count, entry_out, toggle_out,
+                           remote_out);
+  }
+
+  uint32_t hash = memo_hash(timings, count);
+  int ret = rx_memo_lookup(hash, count, gen, timings, entry_out, toggle_out,
+                           remote_out);
+  if (ret >= 0) {
+    return ret;
+  }
+
+  ret = rx_decode_frame(set, timings, count, entry_out, toggle_out,
+                        remote_out);
+  if (ret >= 0) {
+    rx_memo_store(hash, count, gen, ret, entry_out, *remote_out);
+  }
+  return ret;
+#else
+  return rx_decode_frame(set, timings, count, entry_out, toggle_out,
+                         remote_out);
+#endif
+}
+
+/* 码值回调 - 库中有无该条目都调用 */
+static void rx_report_code(const irdb_entry_t *code) {
+  ir_service_code_callback_t callback = service_state.rx.code_callback;
+
+  if (callback) {
+    callback(code, service_state.rx.code_user_data);
+  }
+}
+
+/* 按键事件整形 - 逐帧调用，code为NULL为重复码。按下期间保持松开定时 */
+static void rx_keys_feed(rx_channel_ctx_t *rx, const irdb_entry_t *code,
+                         uint8_t remote, int toggle) {
+  ir_service_key_callback_t callback = service_state.rx.key_callback;
+  ir_key_event_t events[2];
+
+  if (!callback) {
+    return;
+  }
+
+  int n = ir_keys_frame(&rx->keys, code, remote, toggle, k_uptime_get_32(),
+                        events);
+  for (int i = 0; i < n; i++) {
+    callback(&events[i], service_state.rx.key_user_data);
+  }
+  atomic_add(&rx_stats.key_events, n);
+  if (rx->keys.down) {
+    k_work_reschedule_for_queue(&decode_work_q, &rx->key_work,
+                                K_MSEC(IR_KEY_RELEASE_MS));
+  }
+}
+
+/* 松开定时 - 在解码工作队列中运行，与逐帧整形不并发 */
+static void rx_key_work_handler(struct k_work *work) {
+  struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+  rx_channel_ctx_t *rx = CONTAINER_OF(dwork, rx_channel_ctx_t, key_work);
+  ir_service_key_callback_t callback = service_state.rx.key_callback;
+  ir_key_event_t event;
+  uint32_t due_ms;
+
+  if (ir_keys_expire(&rx->keys, k_uptime_get_32(), &event, &due_ms)) {
+    if (callback) {
+      callback(&event, service_state.rx.key_user_data);
+    }
+    atomic_inc(&rx_stats.key_events);
+  } else if (due_ms > 0) {
+    k_work_reschedule_for_queue(&decode_work_q, &rx->key_work,
+                                K_MSEC(due_ms));
+  }
+}
+
+/* 时序质量 - 只在发布解码事件时计算 */
+static uint8_t rx_quality(uint16_t protocol, const ir_timing_t *timings,
+                          uint32_t count) {
+  if (!IS_ENABLED(CONFIG_IR_RX_BUS)) {
+    return IR_RX_QUALITY_UNKNOWN;
+  }
+
+  int quality = irdb_timing_quality(protocol, timings, count);
+  return quality < 0 ? IR_RX_QUALITY_UNKNOWN : quality;
+}
+
+/* 发布解码事件 - 在解码工作队列中、接收回调之后调用，按键信息取自
+ * service_state.rx.press。库中没有的码值没有按键信息 */
+static void rx_publish(const rx_channel_ctx_t *rx, const irdb_entry_t *code,
+                       uint8_t remote, bool repeat, uint32_t end_us,
+                       uint8_t quality) {
+  bool in_db = remote != IR_RX_BUS_NO_REMOTE;
+  const ir_rx_msg_t msg = {
+      .code = *code,
+      .channel = rx - service_state.rx.ch,
+      .remote = remote,
+      .timestamp_us = end_us,
+      .presses = in_db ? service_state.rx.press.presses : 0,
+      .quality = quality,
+      .repeat = repeat,
+      .new_press = in_db ? service_state.rx.press.new_press : !repeat,
+  };
+
+  ir_rx_bus_publish(&msg);
+}
+
+/* 解码工作 - 在解码工作队列中运行 */
+static void rx_decode_work_handler(struct k_work *work) {
+  rx_channel_ctx_t *rx = CONTAINER_OF(work, rx_channel_ctx_t, decode_work);
+  const ir_timing_t *timings = rx->timings[rx->decode_idx];
+  irdb_entry_t decoded_entry;
+  int toggle = IRDB_TOGGLE_NONE;
+  uint8_t remote = IR_RX_BUS_NO_REMOTE;
+
+  ir_trace_mark(&rx->decode_trace, IR_TRACE_RX_DECODE_START);
+
+  /* 解码期间登记为快照读者，切换遥控器不会回收正在使用的数据库。版本
+   * 先于快照读取，其间切换时备忘记在旧版本下，下次查找即作废 */
+  atomic_val_t gen = atomic_get(&service_state.generation);
+  active_set_t *set = active_enter();
+  int ret = rx_decode_memo(set, gen, timings, rx->decode_count,
+                           &decoded_entry, &toggle, &remote);
+  bool repeat = ret < 0 && rx_is_repeat(set, timings, rx->decode_count);
+  active_exit(set);
+
+  ir_trace_mark(&rx->decode_trace, IR_TRACE_RX_DECODE_END);
+  if (ret >= 0) {
+    rx->decode_trace.protocol = decoded_entry.protocol;
+    rx_stats_count(ret == 0 ? rx_stats.decoded : rx_stats.unmatched,
+                   decoded_entry.protocol);
+  } else {
+    atomic_inc(repeat ? &rx_stats.repeats : &rx_stats.failed);
+  }
+
+  uint16_t channel = rx - service_state.rx.ch;
+  if (ret >= 0) {
+    ir_event_code(ret == 0 ? IR_EVENT_RX_DECODED : IR_EVENT_RX_CODE,
+                  &decoded_entry, channel);
+    rx_report_code(&decoded_entry);
+    rx_keys_feed(rx, &decoded_entry, remote, toggle);
+  } else if (repeat) {
+    rx_keys_feed(rx, NULL, IR_KEY_NO_REMOTE, IRDB_TOGGLE_NONE);
+  }
+
+  /* 查到码值的帧计入该遥控器的时序统计，解码窗口随之调整 */
+  if (ret == 0) {
+    ir_adapt_note(&decoded_entry, timings, rx->decode_count);
+  } else if (ret < 0 && !repeat) {
+    ir_adapt_note_miss();
+  }
+
+  if (ret == 0) {
+    rx_remember(rx, &decoded_entry, remote, toggle, &service_state.rx.press);
+    if (rx->callback) {
+      rx->callback(&decoded_entry, rx->user_data);
+    }
+  } else if (repeat) {
+    if (rx_repeat_entry(rx, &decoded_entry, &remote,
+                        &service_state.rx.press)) {
+      ir_event_code(IR_EVENT_RX_REPEAT, &decoded_entry, channel);
+      if (rx->callback) {
+        rx->callback(&decoded_entry, rx->user_data);
+      }
+      rx_publish(rx, &decoded_entry, remote, true, rx->decode_end_us,
+                 rx_quality(decoded_entry.protocol, timings,
+                            rx->decode_count));
+    }
+  } else {
+    if (ret < 0) {
+      ir_event_emit(IR_EVENT_RX_FAILED, channel, rx->decode_count, 0);
+    }
+    if (service_state.rx.raw_callback) {
+      service_state.rx.raw_callback(timings, rx->decode_count,
+                                    service_state.rx.raw_user_data);
+    }
+  }
+  if (ret >= 0) {
+    rx_publish(rx, &decoded_entry, remote, false, rx->decode_end_us,
+               rx_quality(decoded_entry.protocol, timings, rx->decode_count));
+  }
+
+  ir_trace_mark(&rx->decode_trace, IR_TRACE_RX_DISPATCH);
+  ir_trace_commit(&rx->decode_trace);
+  atomic_clear_bit(&rx->decode_busy, 0);
+}
+
+/* 流式解码结果回调 - 在解码工作队列中运行 */
+static void rx_stream_work_handler(struct k_work *work) {
+  rx_channel_ctx_t *rx = CONTAINER_OF(work, rx_channel_ctx_t, stream_work);
+  const irdb_entry_t *entry = &rx->stream_entry;
+
+  ir_event_code(rx->stream_repeat ? IR_EVENT_RX_REPEAT : IR_EVENT_RX_DECODED,
+                entry, rx - service_state.rx.ch);
+
+  if (!rx->stream_repeat) {
+    rx_report_code(entry);
+  }
+  rx_keys_feed(rx, rx->stream_repeat ? NULL : entry, rx->stream_remote,
+               rx->stream_press.toggle);
+  service_state.rx.press = rx->stream_press;
+  if (rx->callback) {
+    rx->callback(entry, rx->user_data);
+  }
+  rx_publish(rx, entry, rx->stream_remote, rx->stream_repeat,
+             rx->stream_end_us, rx->stream_quality);
+
+  ir_trace_mark(&rx->stream_trace, IR_TRACE_RX_DISPATCH);
+  ir_trace_commit(&rx->stream_trace);
+  atomic_clear_bit(&rx->stream_busy, 0);
+}
+
+/* 为活动集的协议准备帧分离器 */
+static void rx_streams_init(rx_channel_ctx_t *rx) {
+  /* 先取版本再取快照，期间再次发布时下一个脉冲会重建 */
+  rx->stream_gen = atomic_get(&service_state.generation);
+  active_set_t *set = active_enter();
+  irdb_demux_init(&rx->demux, set->protocols, set->protocol_count);
+  active_exit(set);
+  rx->frame_decoded = false;
+}
+
+/* 逐脉冲推进帧分离器，解出的帧查到条目即提交回调; 交叠的两帧各自解出。
+ * 活动集变化后在接收线程中重建，不与正在推进的解码器竞争 */
+static void rx_streams_feed(rx_channel_ctx_t *rx, const ir_pulse_t *pulse) {
+  irdb_demux_result_t results[IRDB_DEMUX_RESULTS];
+  bool reported = false;
+  uint32_t reported_start = 0;
+
+  if (rx->stream_gen != atomic_get(&service_state.generation)) {
+    rx_streams_init(rx);
+  }
+
+  int n = irdb_demux_feed(&rx->demux, pulse->duration_us, pulse->is_mark,
+                          results, ARRAY_SIZE(results));
+  for (int i = 0; i < n; i++) {
+    irdb_entry_t code = results[i].code;
+    const irdb_entry_t *entry = &code;
+    ir_trace_record_t trace;
+    ir_service_press_t press;
+    uint8_t remote;
+    int ret = results[i].repeat ? IRDB_STREAM_REPEAT : 1;
+
+    /* 同一帧可能被多个协议解出(如NEC1/NEC2)，只上报查到的第一个，
+     * 查不到的解释不影响其余解释继续 */
+    if (reported && results[i].start == reported_start) {
+      continue;
+    }
+
+    /* 流式解码逐沿进行，识别出码值时即是帧结束和解码开始 */
+    ir_trace_begin(&trace, IR_TRACE_RX, pulse->channel,
+                   IR_TRACE_NO_PROTOCOL,
+                   pulse->timestamp_us + pulse->duration_us);
+    ir_trace_mark(&trace, IR_TRACE_RX_FRAME_END);
+    ir_trace_mark(&trace, IR_TRACE_RX_DECODE_START);
+
+    if (ret == IRDB_STREAM_REPEAT) {
+      if (!rx_repeat_entry(rx, &code, &remote, &press)) {
+        continue;
+      }
+    } else {
+      active_set_t *set = active_enter();
+      entry = remotes_lookup(set, &code, &remote);
+      if (entry) {
+        code = *entry;
+        entry = &code;
+      }
+      active_exit(set);
+      if (!entry) {
+        continue;
+      }
+      rx_remember(rx, entry, remote, IRDB_TOGGLE_NONE, &press);
+    }
+    trace.protocol = entry->protocol;
+    ir_trace_mark(&trace, IR_TRACE_RX_DECODE_END);
+    if (ret == IRDB_STREAM_REPEAT) {
+      atomic_inc(&rx_stats.repeats);
+    } else {
+      rx_stats_count(rx_stats.decoded, entry->protocol);
+    }
+
+    if (results[i].overlapped) {
+      atomic_inc(&rx_stats.overlapped);
+    }
+    irdb_demux_settle(&rx->demux, &results[i]);
+    reported = true;
+    reported_start = results[i].start;
+    rx->frame_decoded = true;
+
+    if (atomic_test_and_set_bit(&rx->stream_busy, 0)) {
+      rx->frames_dropped++;
+      atomic_inc(&rx_stats.dropped);
+    } else {
+      rx->stream_entry = *entry;
+      rx->stream_repeat = ret == IRDB_STREAM_REPEAT;
+      rx->stream_trace = trace;
+      rx->stream_press = press;
+      rx->stream_remote = remote;
+      rx->stream_end_us = pulse->timestamp_us + pulse->duration_us;
+      /* 接收缓冲区即本帧已收到的时序，只有接收线程写入 */
+      rx->stream_quality = rx_quality(entry->protocol,
+                                      rx->timings[rx->fill_idx],
+                                      rx->timing_count);
+      k_work_submit_to_queue(&decode_work_q, &rx->stream_work);
+    }
+  }
+}
+
+/* 帧结束 - 仅交换缓冲区并提交解码，帧结束标记的时间戳即最后一个沿 */
+static void rx_frame_end(rx_channel_ctx_t *rx, const ir_pulse_t *pulse) {
+  k_spinlock_key_t key = k_spin_lock(&rx->lock);
+
+  if (rx->frame_decoded) {
+    /* 流式解码已上报，原始时序无需再整帧解码 */
+    rx->frame_decoded = false;
+  } else if (rx->timing_count > 0) {
+    if (atomic_test_and_set_bit(&rx->decode_busy, 0)) {
+      /* 上一帧仍在解码，丢弃本帧 */
+      rx->frames_dropped++;
+      atomic_inc(&rx_stats.dropped);
+    } else {
+      rx->decode_idx = rx->fill_idx;
+      rx->decode_count = rx->timing_count;
+      rx->decode_end_us = pulse->timestamp_us;
+      rx->fill_idx ^= 1;
+      ir_trace_begin(&rx->decode_trace, IR_TRACE_RX, pulse->channel,
+                     IR_TRACE_NO_PROTOCOL, pulse->timestamp_us);
+      ir_trace_mark(&rx->decode_trace, IR_TRACE_RX_FRAME_END);
+      k_work_submit_to_queue(&decode_work_q, &rx->decode_work);
+    }
+  }
+
+  rx->timing_count = 0;
+  k_spin_unlock(&rx->lock, key);
+}
+
+/* HAL接收回调 - 按脉冲所属通道分派到各自的解码状态 */
+static void hal_rx_callback(ir_pulse_t *pulse, void *user_data) {
+  rx_channel_ctx_t *rx = &service_state.rx.ch[pulse->channel];
+
+  if (!rx->active) {
+    return;
+  }
+
+  /* HAL按帧间隔判定帧结束 - 流式解码未命中时整帧解码兜底 */
+  if (pulse->frame_end) {
+    rx_frame_end(rx, pulse);
+    return;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&rx->lock);
+  if (rx->timing_count < MAX_RAW_TIMINGS) {
+    rx->timings[rx->fill_idx][rx->timing_count++] =
+        ir_timing_pack(pulse->duration_us);
+  }
+  k_spin_unlock(&rx->lock, key);
+
+  rx_streams_feed(rx, pulse);
+}
+
+/* 服务初始化 */
+int ir_service_init(void) {
+  memset(&service_state, 0, sizeof(service_state));
+  for (size_t r = 0; r < ARRAY_SIZE(service_state.remotes); r++) {
+    service_state.remotes[r].db = &service_state.remotes[r].local_db;
+  }
+  atomic_ptr_set(&service_state.active, &service_state.sets[0]);
+
+  /* 构建时由IRP定义编译出的协议，收发开始前注册 */
+  int count = irdb_irp_register_builtin();
+  if (count > 0) {
+    LOG_INF("%d IRP protocols registered", count);
+  }
+
+  /* 初始化HAL */
+  int ret = ir_hal_init();
+  if (ret < 0) {
+    LOG_ERR("HAL init failed: %d", ret);
+    return ret;
+  }
+
+  /* 启动异步发送队列 */
+  ret = ir_tx_queue_init();
+  if (ret < 0) {
+    LOG_ERR("TX queue init failed: %d", ret);
+    return ret;
+  }
+
+  /* 初始化各通道的解码工作 */
+  for (size_t i = 0; i < IR_HAL_RX_CHANNELS; i++) {
+    rx_channel_ctx_t *rx = &service_state.rx.ch[i];
+
+    k_work_init(&rx->decode_work, rx_decode_work_handler);
+    k_work_init(&rx->stream_work, rx_stream_work_handler);
+    k_work_init_delayable(&rx->key_work, rx_key_work_handler);
+    ir_keys_init(&rx->keys, i);
+  }
+
+  /* 启动解码工作队列 */
+  if (!decode_q_started) {
+    const struct k_work_queue_config cfg = {.name = "ir_decode"};
+
+    k_work_queue_init(&decode_work_q);
+    k_work_queue_start(&decode_work_q, decode_stack,
+                       K_THREAD_STACK_SIZEOF(decode_stack),
+                       K_PRIO_PREEMPT(DECODE_THREAD_PRIORITY), &cfg);
+    decode_q_started = true;
+  }
+
+  LOG_INF("IR Service initialized");
+  return 0;
+}
+
+/* 经RAM缓存取数据库 - 未命中时从文件、HTTP或外部flash镜像库读入后交给
+ * 缓存。成功时*db_out为缓存中的数据库并持有一个引用；缓存条目全被引用
+ * 放不下时*db_out为NULL，数据库留在*loaded中由调用者持有 */
+static int remote_fetch(const ir_service_config_t *config,
+                        irdb_load_method_t method, irdb_database_t **db_out,
+                        irdb_database_t *loaded) {
+  char path[128];
+  int ret;
+
+  const irdb_cache_key_t key = {
+      .manufacturer = config->manufacturer,
+      .device_type = config->device_type,
+      .device = config->device,
+      .subdevice = config->subdevice,
+      .source = method,
+  };
+
+  /* 最近用过的遥控器直接切换指针 */
+  if (irdb_cache_get(&key, db_out) == 0) {
+    return 0;
+  }
+
+  if (method == IRDB_LOAD_HTTP) {
+    ret = irdb_load_http_cached(&key, loaded);
+  } else if (method == IRDB_LOAD_EXTERNAL) {
+    ret = irdb_corpus_load(config->manufacturer, config->device_type,
+                           config->device, config->subdevice, loaded);
+  } else {
+    irdb_build_path(path, sizeof(path), config->manufacturer,
+                    config->device_type, config->device, config->subdevice);
+    ret = irdb_load_from_file(loaded, path);
+  }
+  if (ret < 0) {
+    return ret;
+  }
+
+  strncpy(loaded->manufacturer, config->manufacturer,
+          sizeof(loaded->manufacturer) - 1);
+  strncpy(loaded->device_type, config->device_type,
+          sizeof(loaded->device_type) - 1);
+
+  /* 所有权移交缓存 */
+  if (irdb_cache_put(&key, loaded, db_out) < 0) {
+    *db_out = NULL;
+  }
+  return 0;
+}
+
+/* 经RAM缓存加载到槽位；缓存放不下时本地持有 */
+static int remote_load_cached(remote_slot_t *slot,
+                              const ir_service_config_t *config,
+                              irdb_load_method_t method) {
+  irdb_database_t loaded = {0};
+  irdb_database_t *db;
+
+  int ret = remote_fetch(config, method, &db, &loaded);
+  if (ret < 0) {
+    return ret;
+  }
+
+  if (db) {
+    remote_set(slot, db, true);
+  } else {
+    remote_set(slot, &loaded, false);
+  }
+  return 0;
+}
+
+/* 加载遥控器数据库到槽位 - 新库完整建好后才替换原有的数据库，加载
+ * 失败时原有的保持不变 */
+static int remote_load(remote_slot_t *slot, const ir_service_config_t *config) {
+  int ret = -EINVAL;
+  irdb_database_t loaded = {0};
+
+  switch (config->load_method) {
+  case IRDB_LOAD_EMBEDDED: {
+    /* 内置遥控器镜像 (CONFIG_IRDB_BUILTIN_REMOTES)，直接引用无需缓存 */
+    const void *image =
+        irdb_builtin_find(config->manufacturer, config->device_type,
+                          config->device, config->subdevice);
+    if (!image && IS_ENABLED(CONFIG_IRDB_CORPUS)) {
+      /* 不在内置镜像中的到外部flash的整库镜像中找 */
+      ret = remote_load_cached(slot, config, IRDB_LOAD_EXTERNAL);
+      break;
+    }
+    ret = image ? irdb_load_embedded(&loaded, image) : -ENOENT;
+    if (ret == 0) {
+      strncpy(loaded.manufacturer, config->manufacturer,
+              sizeof(loaded.manufacturer) - 1);
+      strncpy(loaded.device_type, config->device_type,
+              sizeof(loaded.device_type) - 1);
+      remote_set(slot, &loaded, false);
+    }
+    break;
+  }
+
+  case IRDB_LOAD_FILESYSTEM:
+  case IRDB_LOAD_HTTP:
+  case IRDB_LOAD_EXTERNAL:
+    ret = remote_load_cached(slot, config, config->load_method);
+    break;
+
+  default:
+    LOG_ERR("Unsupported load method");
+    return -ENOTSUP;
+  }
+
+  if (ret == 0) {
+    ir_usage_note_remote(config);
+    LOG_INF("Loaded remote '%s': %s %s (%u,%u) - %u functions", slot->id,
+            config->manufacturer, config->device_type, config->device,
+            config->subdevice, slot->db->entry_count);
+  }
+
+  return ret;
+}
+
+/* 从嵌入式CSV或二进制镜像加载到槽位 - 同remote_load，建好后才替换 */
+static int remote_load_embedded(remote_slot_t *slot, const void *data,
+                                const char *manufacturer,
+                                const char *device_type) {
+  irdb_database_t loaded = {0};
+  int ret = irdb_load_embedded(&loaded, data);
+
+  if (ret == 0) {
+    if (manufacturer) {
+      strncpy(loaded.manufacturer, manufacturer,
+              sizeof(loaded.manufacturer) - 1);
+    }
+    if (device_type) {
+      strncpy(loaded.device_type, device_type,
+              sizeof(loaded.device_type) - 1);
+    }
+
+    remote_set(slot, &loaded, false);
+    LOG_INF("Loaded embedded database '%s': %u functions", slot->id,
+            slot->db->entry_count);
+  }
+
+  return ret;
+}
+
+/* 加载遥控器数据库 - 替换当前选中的遥控器 */
+int ir_service_load_remote(const ir_service_config_t *config) {
+  if (!config) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&db_mutex, K_FOREVER);
+  int ret =
+      remote_load(&service_state.remotes[service_state.selected], config);
+  k_mutex_unlock(&db_mutex);
+  return ret;
+}
+
+/* 预载入缓存 - 不加入活动集，之后加载时直接命中 */
+int ir_service_prefetch_remote(const ir_service_config_t *config) {
+  irdb_load_method_t method;
+  irdb_database_t loaded = {0};
+  irdb_database_t *db;
+
+  if (!config) {
+    return -EINVAL;
+  }
+
+  switch (config->load_method) {
+  case IRDB_LOAD_EMBEDDED:
+    /* 内置镜像直接引用flash，不经缓存 */
+    if (irdb_builtin_find(config->manufacturer, config->device_type,
+                          config->device, config->subdevice)) {
+      return 0;
+    }
+    if (!IS_ENABLED(CONFIG_IRDB_CORPUS)) {
+      return -ENOENT;
+    }
+    method = IRDB_LOAD_EXTERNAL;
+    break;
+
+  case IRDB_LOAD_FILESYSTEM:
+  case IRDB_LOAD_HTTP:
+  case IRDB_LOAD_EXTERNAL:
+    method = config->load_method;
+    break;
+
+  default:
+    return -ENOTSUP;
+  }
+
+  int ret = remote_fetch(config, method, &db, &loaded);
+  if (ret < 0) {
+    return ret;
+  }
+
+  if (!db) {
+    irdb_free_database(&loaded);
+    return -EBUSY;
+  }
+  irdb_cache_release(db);
+  return 0;
+}
+
+/* 从嵌入式CSV或二进制镜像加载 - 替换当前选中的遥控器 */
+int ir_service_load_embedded_csv(const void *data, const char *manufacturer,
+                                 const char *device_type) {
+  if (!data) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&db_mutex, K_FOREVER);
+  int ret = remote_load_embedded(
+      &service_state.remotes[service_state.selected], data, manufacturer,
+      device_type);
+  k_mutex_unlock(&db_mutex);
+  return ret;
+}
+
+/* 为编号取得槽位 - 已有同编号的遥控器时替换，否则取空闲槽位。调用者
+ * 持有db_mutex */
+static remote_slot_t *remote_slot_for(const char *remote_id) {
+  size_t len = strlen(remote_id);
+  remote_slot_t *slot = remote_find(remote_id, len);
+
+  if (slot) {
+    return slot;
+  }
+  if (len == 0 || len >= IR_SERVICE_REMOTE_ID_MAX ||
+      strchr(remote_id, IR_SERVICE_REMOTE_SEP)) {
+    return NULL;
+  }
+
+  for (size_t r = 0; r < ARRAY_SIZE(service_state.remotes); r++) {
+    slot = &service_state.remotes[r];
+    if (!slot->loaded) {
+      strcpy(slot->id, remote_id);
+      return slot;
+    }
+  }
+  return NULL;
+}
+
+/* 加入后选中的遥控器仍为空时改选新加入的，并释放写侧锁 */
+static int remote_added(remote_slot_t *slot, int ret) {
+  if (ret == 0 && !service_state.remotes[service_state.selected].loaded) {
+    service_state.selected = slot - service_state.remotes;
+    remotes_publish();
+  }
+  k_mutex_unlock(&db_mutex);
+  return ret;
+}
+
+/* 取得写侧锁和槽位 - 成功时由remote_added释放锁 */
+static remote_slot_t *remote_adding(const char *remote_id) {
+  k_mutex_lock(&db_mutex, K_FOREVER);
+  remote_slot_t *slot = remote_slot_for(remote_id);
+  if (!slot) {
+    k_mutex_unlock(&db_mutex);
+    LOG_ERR("No slot for remote '%s'", remote_id);
+  }
+  return slot;
+}
+
+/* 加入活动集 */
+int ir_service_add_remote(const char *remote_id,
+                          const ir_service_config_t *config) {
+  if (!remote_id || !config) {
+    return -EINVAL;
+  }
+
+  remote_slot_t *slot = remote_adding(remote_id);
+  if (!slot) {
+    return -ENOMEM;
+  }
+  return remote_added(slot, remote_load(slot, config));
+}
+
+int ir_service_add_embedded(const char *remote_id, const void *data,
+                            const char *manufacturer,
+                            const char *device_type) {
+  if (!remote_id || !data) {
+    return -EINVAL;
+  }
+
+  remote_slot_t *slot = remote_adding(remote_id);
+  if (!slot) {
+    return -ENOMEM;
+  }
+  return remote_added(slot, remote_load_embedded(slot, data, manufacturer,
+                                                 device_type));
+}
+
+/* 加入已解析的数据库 - 接管db的条目和索引，成功后db被清空 */
+int ir_service_add_database(const char *remote_id, irdb_database_t *db) {
+  if (!remote_id || !db || (!db->entries && db->entry_count > 0)) {
+    return -EINVAL;
+  }
+
+  remote_slot_t *slot = remote_adding(remote_id);
+  if (!slot) {
+    return -ENOMEM;
+  }
+
+  remote_set(slot, db, false);
+  LOG_INF("Added database '%s': %u functions", slot->id,
+          slot->local_db.entry_count);
+  return remote_added(slot, 0);
+}
+
+/* 移出活动集 */
+int ir_service_remove_remote(const char *remote_id) {
+  if (!remote_id) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&db_mutex, K_FOREVER);
+  remote_slot_t *slot = remote_find(remote_id, strlen(remote_id));
+  if (slot) {
+    remote_release(slot);
+  }
+  k_mutex_unlock(&db_mutex);
+
+  if (!slot) {
+    return -ENOENT;
+  }
+  LOG_INF("Removed remote '%s'", remote_id);
+  return 0;
+}
+
+/* 选择无前缀功能名所用的遥控器 */
+int ir_service_select_remote(const char *remote_id) {
+  if (!remote_id) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&db_mutex, K_FOREVER);
+  remote_slot_t *slot = remote_find(remote_id, strlen(remote_id));
+  if (slot) {
+    service_state.selected = slot - service_state.remotes;
+    remotes_publish();
+  }
+  k_mutex_unlock(&db_mutex);
+  return slot ? 0 : -ENOENT;
+}
+
+static int send_entry(const irdb_entry_t *entry, uint32_t repeat,
+                      ir_trace_record_t *trace);
+
+/* 发送时延记录从调用发送接口开始 */
+static void send_trace_begin(ir_trace_record_t *trace, uint8_t channels) {
+  ir_trace_begin(trace, IR_TRACE_TX, channels, IR_TRACE_NO_PROTOCOL,
+                 ir_trace_now_us());
+}
+
+/* 发送命令 */
+int ir_service_send_command(const char *function_name, uint32_t repeat) {
+  if (!function_name) {
+    return -EINVAL;
+  }
+
+  ir_trace_record_t trace;
+  send_trace_begin(&trace, IR_HAL_TX_CH_DEFAULT);
+
+  /* 查找功能 */
+  irdb_entry_t entry;
+  int ret = find_function(function_name, &entry);
+  if (ret < 0) {
+    return ret;
+  }
+  ir_trace_mark(&trace, IR_TRACE_TX_LOOKUP);
+
+  return send_entry(&entry, repeat, &trace);
+}
+
+/* 查找条目 - 返回库中的条目 */
+const irdb_entry_t *ir_service_find_function(const char *function_name) {
+  const irdb_entry_t *entry = NULL;
+
+  if (function_name) {
+    active_set_t *set = active_enter();
+    if (set_find_function(set, function_name, &entry) < 0) {
+      entry = NULL;
+    }
+    active_exit(set);
+  }
+  return entry;
+}
+
+/* 查找功能编号 - 编号带遥控器槽位 */
+int ir_service_find_function_id(const char *function_name) {
+  if (!function_name) {
+    return -EINVAL;
+  }
+
+  const char *function;
+  active_set_t *set = active_enter();
+  int r = set_resolve(set, function_name, &function);
+  int id = r >= 0 ? irdb_find_function_id(set->dbs[r], function) : -EINVAL;
+  active_exit(set);
+
+  if (id < 0) {
+    return id;
+  }
+  return r << IR_SERVICE_ID_SHIFT | id;
+}
+
+typedef struct {
+  int32_t *ids;
+  size_t max;
+  size_t count;
+  uint32_t remote;
+} find_ids_ctx_t;
 
-  /* 接收状态 */
-  struct {
-    ir_service_rx_callback_t callback;
-    void *user_data;
-    uint32_t timings[MAX_RAW_TIMINGS];
-    uint32_t timing_count;
-    struct k_timer timeout_timer;
-    bool active;
-  } rx;
-} service_state;
+static int find_ids_cb(const irdb_database_t *db, uint32_t index,
+                       const irdb_entry_t *entry, void *user_data) {
+  find_ids_ctx_t *ctx = user_data;
 
-/* 接收超时处理 */
-static void rx_timeout_handler(struct k_timer *timer) {
-  if (service_state.rx.timing_count > 0 && service_state.rx.callback) {
-    irdb_entry_t decoded_entry;
+  if (ctx->count < ctx->max) {
+    ctx->ids[ctx->count] = ctx->remote << IR_SERVICE_ID_SHIFT | index;
+  }
+  ctx->count++;
+  return 0;
+}
 
-    int ret = irdb_decode_from_raw(
-        &service_state.current_db, service_state.rx.timings,
-        service_state.rx.timing_count, &decoded_entry);
+/* 查找全部功能编号 - 前缀不是活动集中的编号时整串作为功能名查每个遥控器 */
+int ir_service_find_function_ids(const char *function_name, int32_t *ids,
+                                 size_t max) {
+  if (!function_name || (!ids && max > 0)) {
+    return -EINVAL;
+  }
 
-    if (ret == 0) {
-      LOG_INF("Decoded: %s (P:%u D:%u.%u F:%u)", decoded_entry.function_name,
-              decoded_entry.protocol, decoded_entry.device,
-              decoded_entry.subdevice, decoded_entry.function);
+  find_ids_ctx_t ctx = {.ids = ids, .max = max};
+  const char *function = function_name;
+  const char *sep = strchr(function_name, IR_SERVICE_REMOTE_SEP);
+  active_set_t *set = active_enter();
+  int only = sep ? set_find(set, function_name, sep - function_name) : -1;
 
-      service_state.rx.callback(&decoded_entry, service_state.rx.user_data);
-    } else {
-      LOG_WRN("Failed to decode signal");
+  if (only >= 0) {
+    function = sep + 1;
+  }
+  for (size_t r = 0; r < ARRAY_SIZE(set->dbs); r++) {
+    if (set->dbs[r] && (only < 0 || (int)r == only)) {
+      ctx.remote = r;
+      irdb_for_each_named(set->dbs[r], function, find_ids_cb, &ctx);
     }
-
-    service_state.rx.timing_count = 0;
   }
+  active_exit(set);
+  return ctx.count;
 }
 
-/* HAL接收回调 */
-static void hal_rx_callback(ir_pulse_t *pulse, void *user_data) {
-  if (!service_state.rx.active) {
-    return;
+/* 功能编号对应的条目，复制出快照 */
+static int entry_of_id(int id, irdb_entry_t *entry_out) {
+  if (id < 0) {
+    return -EINVAL;
+  }
+
+  size_t r = id >> IR_SERVICE_ID_SHIFT;
+  if (r >= IR_SERVICE_MAX_REMOTES) {
+    return -EINVAL;
   }
 
-  if (service_state.rx.timing_count < MAX_RAW_TIMINGS) {
-    service_state.rx.timings[service_state.rx.timing_count++] =
-        pulse->duration_us;
+  int ret = -EINVAL;
+  active_set_t *set = active_enter();
+  if (set->dbs[r]) {
+    const irdb_entry_t *entry =
+        irdb_get_entry(set->dbs[r], id & BIT_MASK(IR_SERVICE_ID_SHIFT));
+    ret = entry ? 0 : -ENOENT;
+    if (entry) {
+      *entry_out = *entry;
+    }
   }
+  active_exit(set);
 
-  /* 重置超时 */
-  k_timer_start(&service_state.rx.timeout_timer, K_MSEC(150), K_NO_WAIT);
+  if (ret == -EINVAL) {
+    LOG_ERR("No database loaded");
+  }
+  return ret;
 }
 
-/* 服务初始化 */
-int ir_service_init(void) {
-  memset(&service_state, 0, sizeof(service_state));
+/* 按功能编号发送 */
+int ir_service_send_id(int id, uint32_t repeat) {
+  irdb_entry_t entry;
+  int ret = entry_of_id(id, &entry);
 
-  /* 初始化HAL */
-  int ret = ir_hal_init();
   if (ret < 0) {
-    LOG_ERR("HAL init failed: %d", ret);
     return ret;
   }
+  return ir_service_send_entry(&entry, repeat);
+}
 
-  /* 初始化接收定时器 */
-  k_timer_init(&service_state.rx.timeout_timer, rx_timeout_handler, NULL);
+/* 发送已编码时序 - 支持重复码的协议只发一次完整帧，之后发送重复码。
+ * params->gap为帧周期，各帧按帧起点的绝对时刻排定，由内核定时器唤醒 */
+static int send_timings(const ir_timing_t *timings, uint32_t timing_count,
+                        const ir_timing_t *repeat_timings,
+                        uint32_t repeat_count,
+                        const irdb_protocol_params_t *params,
+                        uint32_t repeat, ir_trace_record_t *trace) {
+  const ir_timing_t *frame = timings;
+  uint32_t frame_count = timing_count;
+  int64_t frame_start = k_uptime_ticks();
 
-  LOG_INF("IR Service initialized");
+  ir_trace_mark(trace, IR_TRACE_TX_START);
+  for (uint32_t r = 0; r < repeat; r++) {
+    int ret = ir_hal_tx_frame(frame, frame_count, params->frequency,
+                              params->duty_cycle);
+    if (ret < 0) {
+      LOG_ERR("TX frame failed: %d", ret);
+      ir_trace_commit(trace);
+      return ret;
+    }
+
+    if (r < repeat - 1 && params->gap > 0) {
+      frame_start += k_us_to_ticks_ceil64(params->gap);
+      k_sleep(K_TIMEOUT_ABS_TICKS(frame_start));
+    }
+
+    if (repeat_count > 0) {
+      frame = repeat_timings;
+      frame_count = repeat_count;
+    }
+  }
+
+  ir_trace_mark(trace, IR_TRACE_TX_END);
+  ir_trace_commit(trace);
   return 0;
 }
 
-/* 加载遥控器数据库 */
-int ir_service_load_remote(const ir_service_config_t *config) {
-  if (!config) {
-    return -EINVAL;
+/* 缓存关闭时即时编码发送 */
+static int send_entry_uncached(const irdb_entry_t *entry,
+                               const irdb_protocol_params_t *params,
+                               uint32_t repeat, ir_trace_record_t *trace) {
+  ir_timing_t timings[MAX_RAW_TIMINGS];
+  uint32_t timing_count;
+
+  int ret = encode_entry(entry, params, timings, &timing_count,
+                         MAX_RAW_TIMINGS);
+  if (ret < 0) {
+    LOG_ERR("Encoding failed: %d", ret);
+    return ret;
   }
 
-  /* 释放旧数据库 */
-  if (service_state.db_loaded) {
-    irdb_free_database(&service_state.current_db);
-    service_state.db_loaded = false;
+  ir_timing_t repeat_timings[IR_TX_REPEAT_MAX_TIMINGS];
+  uint32_t repeat_count = 0;
+  if (repeat > 1) {
+    irdb_encode_repeat(entry, repeat_timings, &repeat_count,
+                       IR_TX_REPEAT_MAX_TIMINGS);
   }
+  ir_trace_mark(trace, IR_TRACE_TX_ENCODE);
 
-  int ret = -EINVAL;
-  char path[128];
+  ret = send_timings(timings, timing_count, repeat_timings, repeat_count,
+                     params, repeat, trace);
+  if (ret == 0) {
+    ir_event_code(IR_EVENT_TX_SENT, entry, repeat);
+  }
+  return ret;
+}
 
-  switch (config->load_method) {
-  case IRDB_LOAD_FILESYSTEM:
-    irdb_build_path(path, sizeof(path), config->manufacturer,
-                    config->device_type, config->device, config->subdevice);
-    ret = irdb_load_from_file(&service_state.current_db, path);
-    break;
+/* 发送IRDB条目 */
+int ir_service_send_entry(const irdb_entry_t *entry, uint32_t repeat) {
+  if (!entry) {
+    return -EINVAL;
+  }
 
-  case IRDB_LOAD_HTTP:
-    ret = irdb_load_from_http(&service_state.current_db, config->manufacturer,
-                              config->device_type, config->device,
-                              config->subdevice);
-    break;
+  ir_trace_record_t trace;
+  send_trace_begin(&trace, IR_HAL_TX_CH_DEFAULT);
+  return send_entry(entry, repeat, &trace);
+}
 
-  default:
-    LOG_ERR("Unsupported load method");
+static int send_entry(const irdb_entry_t *entry, uint32_t repeat,
+                      ir_trace_record_t *trace) {
+  trace->protocol = entry->protocol;
+
+  /* 获取协议参数 */
+  const irdb_protocol_params_t *params =
+      irdb_get_protocol_params(entry->protocol);
+  if (!params) {
+    LOG_ERR("Unknown protocol: %u", entry->protocol);
     return -ENOTSUP;
   }
+  repeat = irdb_send_frames(params, repeat);
 
-  if (ret == 0) {
-    strncpy(service_state.current_db.manufacturer, config->manufacturer,
-            sizeof(service_state.current_db.manufacturer) - 1);
-    strncpy(service_state.current_db.device_type, config->device_type,
-            sizeof(service_state.current_db.device_type) - 1);
+  ir_usage_note_send(entry);
 
-    service_state.db_loaded = true;
-    LOG_INF("Loaded remote: %s %s (%u,%u) - %u functions", config->manufacturer,
-            config->device_type, config->device, config->subdevice,
-            service_state.current_db.entry_count);
+  /* 优先使用发送缓存中的预编码时序 */
+  const ir_tx_blob_t *blob = ir_tx_cache_get(entry);
+  if (!blob) {
+    return send_entry_uncached(entry, params, repeat, trace);
   }
+  ir_trace_mark(trace, IR_TRACE_TX_ENCODE);
 
-  return ret;
+  int ret = send_timings(blob->timings, blob->timing_count,
+                         blob->repeat_timings, blob->repeat_timing_count,
+                         params, repeat, trace);
+  ir_tx_cache_put(blob);
+  if (ret < 0) {
+    return ret;
+  }
+
+  ir_event_code(IR_EVENT_TX_SENT, entry, repeat);
+  return 0;
 }
 
-/* 从嵌入式CSV加载 */
-int ir_service_load_embedded_csv(const char *csv_data, const char *manufacturer,
-                                 const char *device_type) {
-  if (!csv_data) {
+/* 发送Pronto学习码 - 周期数直接交给HAL生成序列，不经微秒换算
+ * 第一次发送单次序列(为空时用重复序列)，之后发送重复序列 */
+int ir_service_send_pronto(const char *pronto, uint32_t repeat) {
+  if (!pronto) {
     return -EINVAL;
   }
 
-  /* 释放旧数据库 */
-  if (service_state.db_loaded) {
-    irdb_free_database(&service_state.current_db);
-    service_state.db_loaded = false;
+  uint16_t periods[MAX_RAW_TIMINGS];
+  irdb_pronto_info_t info;
+  int ret = irdb_pronto_parse(pronto, strlen(pronto), periods,
+                              MAX_RAW_TIMINGS, &info);
+  if (ret < 0) {
+    LOG_ERR("Invalid Pronto code: %d", ret);
+    return ret;
   }
 
-  int ret = irdb_load_embedded(&service_state.current_db, csv_data);
-
-  if (ret == 0) {
-    if (manufacturer) {
-      strncpy(service_state.current_db.manufacturer, manufacturer,
-              sizeof(service_state.current_db.manufacturer) - 1);
-    }
-    if (device_type) {
-      strncpy(service_state.current_db.device_type, device_type,
-              sizeof(service_state.current_db.device_type) - 1);
+  const uint16_t *repeat_periods = periods + info.once_length;
+  for (uint32_t r = 0; r < repeat; r++) {
+    bool once = info.once_length > 0 && (r == 0 || info.repeat_length == 0);
+    ret = ir_hal_tx_periods(once ? periods : repeat_periods,
+                            once ? info.once_length : info.repeat_length,
+                            info.carrier_freq, 0);
+    if (ret < 0) {
+      LOG_ERR("TX frame failed: %d", ret);
+      return ret;
     }
-
-    service_state.db_loaded = true;
-    LOG_INF("Loaded embedded database: %u functions",
-            service_state.current_db.entry_count);
   }
 
-  return ret;
+  ir_event_emit(IR_EVENT_TX_PRONTO, repeat, info.carrier_freq, 0);
+  return 0;
 }
 
-/* 发送命令 */
-int ir_service_send_command(const char *function_name, uint32_t repeat) {
+static int send_entry_async(const irdb_entry_t *entry, uint32_t repeat,
+                            uint8_t channels, uint64_t start_at_us,
+                            ir_tx_done_callback_t callback, void *user_data,
+                            ir_trace_record_t *trace);
+
+/* 异步发送命令 */
+int ir_service_send_async(const char *function_name, uint32_t repeat,
+                          ir_tx_done_callback_t callback, void *user_data) {
+  return ir_service_send_async_on(function_name, repeat, IR_HAL_TX_CH_DEFAULT,
+                                  callback, user_data);
+}
+
+/* 按通道异步发送命令 */
+int ir_service_send_async_on(const char *function_name, uint32_t repeat,
+                             uint8_t channels, ir_tx_done_callback_t callback,
+                             void *user_data) {
   if (!function_name) {
     return -EINVAL;
   }
 
-  if (!service_state.db_loaded) {
-    LOG_ERR("No database loaded");
+  ir_trace_record_t trace;
+  send_trace_begin(&trace, channels);
+
+  irdb_entry_t entry;
+  int ret = find_function(function_name, &entry);
+  if (ret < 0) {
+    return ret;
+  }
+  ir_trace_mark(&trace, IR_TRACE_TX_LOOKUP);
+
+  return send_entry_async(&entry, repeat, channels, 0, callback,
+                          user_data, &trace);
+}
+
+/* 队列帧释放时归还缓存引用 */
+static void release_blob(void *ctx) { ir_tx_cache_put(ctx); }
+
+/* 异步发送IRDB条目 */
+int ir_service_send_entry_async(const irdb_entry_t *entry, uint32_t repeat,
+                                ir_tx_done_callback_t callback,
+                                void *user_data) {
+  return ir_service_send_entry_async_on(entry, repeat, IR_HAL_TX_CH_DEFAULT,
+                                        callback, user_data);
+}
+
+/* 按通道异步发送IRDB条目 */
+int ir_service_send_entry_async_on(const irdb_entry_t *entry, uint32_t repeat,
+                                   uint8_t channels,
+                                   ir_tx_done_callback_t callback,
+                                   void *user_data) {
+  ir_trace_record_t trace;
+
+  send_trace_begin(&trace, channels);
+  return send_entry_async(entry, repeat, channels, 0, callback,
+                          user_data, &trace);
+}
+
+/* 定时异步发送 */
+int ir_service_send_at(const char *function_name, uint32_t repeat,
+                       uint8_t channels, uint64_t start_at_us,
+                       ir_tx_done_callback_t callback, void *user_data) {
+  irdb_entry_t entry;
+
+  if (!function_name || start_at_us == 0) {
     return -EINVAL;
   }
+  int ret = find_function(function_name, &entry);
+  if (ret < 0) {
+    return ret;
+  }
+  return ir_service_send_entry_at(&entry, repeat, channels, start_at_us,
+                                  callback, user_data);
+}
 
-  /* 查找功能 */
-  const irdb_entry_t *entry =
-      irdb_find_function(&service_state.current_db, function_name);
-  if (!entry) {
-    LOG_ERR("Function not found: %s", function_name);
-    return -ENOENT;
+int ir_service_send_entry_at(const irdb_entry_t *entry, uint32_t repeat,
+                             uint8_t channels, uint64_t start_at_us,
+                             ir_tx_done_callback_t callback,
+                             void *user_data) {
+  ir_trace_record_t trace;
+
+  if (start_at_us == 0) {
+    return -EINVAL;
+  }
+  send_trace_begin(&trace, channels);
+  return send_entry_async(entry, repeat, channels, start_at_us, callback,
+                          user_data, &trace);
+}
+
+/* 按功能编号异步发送 */
+int ir_service_send_id_async_on(int id, uint32_t repeat, uint8_t channels,
+                                ir_tx_done_callback_t callback,
+                                void *user_data) {
+  ir_trace_record_t trace;
+  irdb_entry_t entry;
+
+  send_trace_begin(&trace, channels);
+  int ret = entry_of_id(id, &entry);
+  if (ret < 0) {
+    return ret;
   }
+  ir_trace_mark(&trace, IR_TRACE_TX_LOOKUP);
 
-  return ir_service_send_entry(entry, repeat);
+  return send_entry_async(&entry, repeat, channels, 0, callback,
+                          user_data, &trace);
 }
 
-/* 发送IRDB条目 */
-int ir_service_send_entry(const irdb_entry_t *entry, uint32_t repeat) {
-  if (!entry) {
+/* 原始时序异步发送 - 不经编码，直接拷贝进队列帧 */
+int ir_service_send_raw_async_on(const ir_timing_t *timings, uint32_t count,
+                                 uint32_t carrier_freq, uint32_t gap_us,
+                                 uint32_t repeat, uint8_t channels,
+                                 ir_tx_done_callback_t callback,
+                                 void *user_data) {
+  if (!timings || count == 0 || count > IR_TX_FRAME_MAX_TIMINGS ||
+      repeat == 0 || channels == 0 || (channels & ~IR_HAL_TX_CH_ALL)) {
+    return -EINVAL;
+  }
+
+  ir_trace_record_t trace;
+  send_trace_begin(&trace, channels);
+
+  ir_tx_frame_t *frame = ir_tx_frame_alloc();
+  if (!frame) {
+    return -ENOBUFS;
+  }
+
+  memcpy(frame->timings, timings, count * sizeof(ir_timing_t));
+  frame->timing_count = count;
+  frame->carrier_freq = carrier_freq > 0 ? carrier_freq : IR_CARRIER_FREQ;
+  frame->channels = channels;
+  frame->gap_us = gap_us;
+  frame->repeat = repeat;
+  frame->callback = callback;
+  frame->user_data = user_data;
+
+  ir_trace_mark(&trace, IR_TRACE_TX_ENCODE);
+  frame->trace = trace;
+
+  return ir_tx_queue_submit(frame);
+}
+
+/* 编码到队列帧并入队，时延记录随帧交给TX线程 */
+static int send_entry_async(const irdb_entry_t *entry, uint32_t repeat,
+                            uint8_t channels, uint64_t start_at_us,
+                            ir_tx_done_callback_t callback, void *user_data,
+                            ir_trace_record_t *trace) {
+  if (!entry || repeat == 0 || channels == 0 ||
+      (channels & ~IR_HAL_TX_CH_ALL)) {
     return -EINVAL;
   }
 
-  /* 获取协议参数 */
   const irdb_protocol_params_t *params =
       irdb_get_protocol_params(entry->protocol);
   if (!params) {
     LOG_ERR("Unknown protocol: %u", entry->protocol);
     return -ENOTSUP;
   }
+  repeat = irdb_send_frames(params, repeat);
 
-  /* 编码为原始时序 */
-  uint32_t timings[MAX_RAW_TIMINGS];
-  uint32_t timing_count;
+  ir_tx_frame_t *frame = ir_tx_frame_alloc();
+  if (!frame) {
+    return -ENOBUFS;
+  }
 
-  int ret = irdb_encode_to_raw(entry, timings, &timing_count, MAX_RAW_TIMINGS);
-  if (ret < 0) {
-    LOG_ERR("Encoding failed: %d", ret);
-    return ret;
+  ir_usage_note_send(entry);
+  const ir_tx_blob_t *blob = ir_tx_cache_get(entry);
+  if (blob) {
+    /* 缓存命中: 只移交时序指针，发送完成后释放引用 */
+    frame->ext_timings = blob->timings;
+    frame->timing_count = blob->timing_count;
+    frame->release = release_blob;
+    frame->release_ctx = (void *)blob;
+    frame->repeat_timing_count = blob->repeat_timing_count;
+    memcpy(frame->repeat_timings, blob->repeat_timings,
+           sizeof(frame->repeat_timings));
+  } else {
+    /* 直接编码到队列帧中，避免额外拷贝 */
+    int ret = encode_entry(entry, params, frame->timings,
+                           &frame->timing_count, IR_TX_FRAME_MAX_TIMINGS);
+    if (ret < 0) {
+      LOG_ERR("Encoding failed: %d", ret);
+      ir_tx_frame_free(frame);
+      return ret;
+    }
+
+    /* 单次发送也带上重复码: 随后提交的相同命令并入本帧时发送重复码 */
+    irdb_encode_repeat(entry, frame->repeat_timings,
+                       &frame->repeat_timing_count, IR_TX_REPEAT_MAX_TIMINGS);
   }
 
-  LOG_DBG("Sending: %s (P:%u D:%u.%u F:%u) %u timings", entry->function_name,
-          entry->protocol, entry->device, entry->subdevice, entry->function,
-          timing_count);
+  frame->carrier_freq = params->frequency;
+  frame->duty_cycle = params->duty_cycle;
+  frame->channels = channels;
+  frame->gap_us = params->gap;
+  frame->period = true;
+  frame->repeat = repeat;
+  frame->target = IR_TX_TARGET(entry->protocol, entry->device);
+  frame->start_at_us = start_at_us;
+  if (start_at_us > 0) {
+    frame->priority = IR_TX_PRIO_BULK; // 等待开始时刻时不挡住交互命令
+  }
+  frame->callback = callback;
+  frame->user_data = user_data;
 
-  /* 启动发送 */
-  ret = ir_hal_tx_start(params->frequency);
-  if (ret < 0) {
-    return ret;
+  trace->protocol = entry->protocol;
+  ir_trace_mark(trace, IR_TRACE_TX_ENCODE);
+  frame->trace = *trace;
+
+  return ir_tx_queue_submit(frame);
+}
+
+/* 启动接收 - 调用者持有db_mutex */
+static int receive_start(uint8_t channels, ir_service_rx_callback_t callback,
+                         void *user_data) {
+  /* 没有数据库时解码所有已注册协议，含init之后注册的自定义协议 */
+  if (!remotes_loaded()) {
+    remotes_publish();
   }
 
-  /* 发送重复次数 */
-  for (uint32_t r = 0; r < repeat; r++) {
-    /* 发送所有时序 */
-    for (uint32_t i = 0; i < timing_count; i++) {
-      bool is_mark = (i % 2 == 0); // 偶数索引为mark
-      ir_hal_tx_pulse(timings[i], is_mark);
-    }
+  for (size_t i = 0; i < IR_HAL_RX_CHANNELS; i++) {
+    rx_channel_ctx_t *rx = &service_state.rx.ch[i];
 
-    /* 重复间隔 */
-    if (r < repeat - 1 && params->gap > 0) {
-      k_usleep(params->gap);
+    if (!(channels & BIT(i))) {
+      continue;
     }
+
+    rx->active = false;
+    rx->callback = callback;
+    rx->user_data = user_data;
+    rx->timing_count = 0;
+    rx->frames_dropped = 0;
+    rx->last_valid = false;
+    rx_streams_init(rx);
+    rx->active = true;
   }
 
-  /* 停止发送 */
-  ir_hal_tx_stop();
+  uint8_t wanted = service_state.rx.channels | channels;
+  int ret = service_state.rx.channels
+                ? ir_hal_rx_set_channels(service_state.rx.subscriber, wanted)
+                : ir_hal_rx_subscribe(wanted, hal_rx_callback, NULL);
+  if (ret < 0) {
+    LOG_ERR("Failed to start receive: %d", ret);
+    for (size_t i = 0; i < IR_HAL_RX_CHANNELS; i++) {
+      if ((channels & ~service_state.rx.channels) & BIT(i)) {
+        service_state.rx.ch[i].active = false;
+      }
+    }
+    return ret;
+  }
+  if (!service_state.rx.channels) {
+    service_state.rx.subscriber = ret;
+  }
+  service_state.rx.channels = wanted;
 
-  LOG_INF("Sent: %s (%u repeats)", entry->function_name, repeat);
+  LOG_INF("Started receiving (channels 0x%x)", channels);
   return 0;
 }
 
+/* 按通道启动接收 */
+int ir_service_start_receive_on(uint8_t channels,
+                                ir_service_rx_callback_t callback,
+                                void *user_data) {
+  if (channels == 0 || (channels & ~IR_HAL_RX_CH_ALL)) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&db_mutex, K_FOREVER);
+  int ret = receive_start(channels, callback, user_data);
+  k_mutex_unlock(&db_mutex);
+  return ret;
+}
+
 /* 启动接收 */
 int ir_service_start_receive(ir_service_rx_callback_t callback,
                              void *user_data) {
-  if (!callback) {
+  return ir_service_start_receive_on(IR_HAL_RX_CH_ALL, callback, user_data);
+}
+
+/* 设置未解码帧回调 */
+void ir_service_set_raw_callback(ir_service_raw_callback_t callback,
+                                 void *user_data) {
+  service_state.rx.raw_user_data = user_data;
+  service_state.rx.raw_callback = callback;
+}
+
+/* 设置码值回调 - 嗅探期间解码索引扩展到所有已注册协议 */
+void ir_service_set_code_callback(ir_service_code_callback_t callback,
+                                  void *user_data) {
+  k_mutex_lock(&db_mutex, K_FOREVER);
+  service_state.rx.code_user_data = user_data;
+  service_state.rx.code_callback = callback;
+  remotes_publish();
+  k_mutex_unlock(&db_mutex);
+}
+
+/* 设置按键事件回调 - 与码值回调一样，设置期间解码所有已注册协议 */
+void ir_service_set_key_callback(ir_service_key_callback_t callback,
+                                 void *user_data) {
+  k_mutex_lock(&db_mutex, K_FOREVER);
+  service_state.rx.key_user_data = user_data;
+  service_state.rx.key_callback = callback;
+  remotes_publish();
+  k_mutex_unlock(&db_mutex);
+}
+
+/* 活动集版本 */
+uint32_t ir_service_generation(void) {
+  return atomic_get(&service_state.generation);
+}
+
+/* 接收统计 */
+int ir_service_rx_press(ir_service_press_t *press) {
+  if (!press || k_current_get() != k_work_queue_thread_get(&decode_work_q)) {
     return -EINVAL;
   }
+  *press = service_state.rx.press;
+  return 0;
+}
 
-  if (!service_state.db_loaded) {
-    LOG_ERR("No database loaded");
-    return -EINVAL;
+void ir_service_get_rx_stats(ir_service_rx_stats_t *stats) {
+  if (!stats) {
+    return;
+  }
+
+  for (size_t p = 0; p <= IRDB_PROTOCOL_MAX_ID; p++) {
+    stats->decoded[p] = atomic_get(&rx_stats.decoded[p]);
+    stats->unmatched[p] = atomic_get(&rx_stats.unmatched[p]);
   }
+  stats->repeats = atomic_get(&rx_stats.repeats);
+  stats->failed = atomic_get(&rx_stats.failed);
+  stats->dropped = atomic_get(&rx_stats.dropped);
+  stats->memo_hits = atomic_get(&rx_stats.memo_hits);
+  stats->overlapped = atomic_get(&rx_stats.overlapped);
+  stats->key_events = atomic_get(&rx_stats.key_events);
+  stats->coalesced = 0;
+  for (size_t i = 0; i < IR_HAL_RX_CHANNELS; i++) {
+    stats->coalesced += service_state.rx.ch[i].keys.coalesced;
+  }
+}
 
-  service_state.rx.callback = callback;
-  service_state.rx.user_data = user_data;
-  service_state.rx.timing_count = 0;
-  service_state.rx.active = true;
+/* 按通道停止接收 */
+int ir_service_stop_receive_on(uint8_t channels) {
+  k_mutex_lock(&db_mutex, K_FOREVER);
+  for (size_t i = 0; i < IR_HAL_RX_CHANNELS; i++) {
+    rx_channel_ctx_t *rx = &service_state.rx.ch[i];
 
-  int ret = ir_hal_rx_start(hal_rx_callback, NULL);
-  if (ret < 0) {
-    LOG_ERR("Failed to start receive: %d", ret);
-    return ret;
+    if (channels & BIT(i)) {
+      rx->active = false;
+    }
+  }
+
+  uint8_t remaining = service_state.rx.channels & ~channels;
+  if (service_state.rx.channels && !remaining) {
+    ir_hal_rx_unsubscribe(service_state.rx.subscriber);
+  } else if (remaining != service_state.rx.channels) {
+    ir_hal_rx_set_channels(service_state.rx.subscriber, remaining);
   }
+  service_state.rx.channels = remaining;
+  k_mutex_unlock(&db_mutex);
 
-  LOG_INF("Started receiving");
+  LOG_INF("Stopped receiving (channels 0x%x)", channels);
   return 0;
 }
 
 /* 停止接收 */
 int ir_service_stop_receive(void) {
-  service_state.rx.active = false;
-  k_timer_stop(&service_state.rx.timeout_timer);
-  ir_hal_rx_stop();
+  return ir_service_stop_receive_on(IR_HAL_RX_CH_ALL);
+}
 
-  LOG_INF("Stopped receiving");
-  return 0;
+/* 列表输出 - snprintf截断时offset停在缓冲末尾，不越界 */
+typedef struct {
+  char *buf;
+  size_t size;
+  size_t offset;
+} list_out_t;
+
+static int list_append(list_out_t *out, const char *fmt, ...) {
+  va_list args;
+
+  if (out->offset + 1 >= out->size) {
+    return -ENOSPC;
+  }
+
+  va_start(args, fmt);
+  int n = vsnprintf(out->buf + out->offset, out->size - out->offset, fmt, args);
+  va_end(args);
+
+  if (n < 0) {
+    return n;
+  }
+  out->offset = MIN(out->offset + n, out->size - 1);
+  return out->offset + 1 >= out->size ? -ENOSPC : 0;
 }
 
-/* 列出所有功能 */
+static int list_function(const irdb_database_t *db, uint32_t index,
+                         const irdb_entry_t *entry, void *user_data) {
+  return list_append(user_data, "  %-20s P:%u D:%u.%u F:%u\n",
+                     irdb_entry_name(db, entry), entry->protocol,
+                     entry->device, entry->subdevice, entry->function);
+}
+
+/* 列出所有功能 - 当前选中的遥控器，放不下时截断 */
 int ir_service_list_functions(char *buf, size_t buf_size) {
   if (!buf || buf_size == 0) {
     return -EINVAL;
   }
 
-  if (!service_state.db_loaded) {
+  list_out_t out = {.buf = buf, .size = buf_size};
+  active_set_t *set = active_enter();
+  const irdb_database_t *db = set->dbs[set->selected];
+  if (!db) {
+    active_exit(set);
     return -EINVAL;
   }
 
-  size_t offset = 0;
-  const irdb_database_t *db = &service_state.current_db;
+  buf[0] = '\0';
+  list_append(&out, "Remote: %s %s\n", db->manufacturer, db->device_type);
+  list_append(&out, "Functions (%u):\n", db->entry_count);
+  irdb_for_each_entry(db, 0, list_function, &out);
+
+  active_exit(set);
+  return 0;
+}
+
+void ir_service_func_iter_init(ir_service_func_iter_t *it, uint32_t start) {
+  it->index = start;
+  it->count = 0;
+  it->db = NULL;
+}
+
+/* 游标取条目 - 每次只在拷贝期间进入活动集，读侧仍很快结束 */
+int ir_service_func_iter_next(ir_service_func_iter_t *it, irdb_entry_t *entry,
+                              char *name, size_t size) {
+  if (!it || !entry) {
+    return -EINVAL;
+  }
+
+  int ret = 0;
+  active_set_t *set = active_enter();
+  const irdb_database_t *db = set->dbs[set->selected];
+
+  if (!db) {
+    ret = -EINVAL;
+  } else if (it->db && it->db != db) {
+    ret = -ESTALE;
+  } else if (it->index >= db->entry_count) {
+    it->db = db;
+    it->count = db->entry_count;
+    ret = -ENOENT;
+  } else {
+    *entry = db->entries[it->index];
+    if (name && size > 0) {
+      strncpy(name, irdb_entry_name(db, entry), size - 1);
+      name[size - 1] = '\0';
+    }
+    it->db = db;
+    it->count = db->entry_count;
+    it->index++;
+  }
+
+  active_exit(set);
+  return ret;
+}
+
+/* 按前缀查找 - 每个遥控器一个游标，每次取名称最小的队首 */
+int ir_service_search_functions(const char *prefix, uint32_t skip,
+                                ir_service_match_t *out, size_t max) {
+  if (!prefix || (!out && max > 0)) {
+    return -EINVAL;
+  }
+
+  irdb_prefix_iter_t its[IR_SERVICE_MAX_REMOTES];
+  int heads[IR_SERVICE_MAX_REMOTES];
+  size_t n = 0;
+  active_set_t *set = active_enter();
+
+  for (size_t r = 0; r < ARRAY_SIZE(set->dbs); r++) {
+    irdb_prefix_iter_init(&its[r], set->dbs[r], prefix);
+    heads[r] = irdb_prefix_iter_next(&its[r]);
+  }
 
-  offset += snprintf(buf + offset, buf_size - offset, "Remote: %s %s\n",
-                     db->manufacturer, db->device_type);
+  while (n < max) {
+    const char *best_name = NULL;
+    int best = -1;
+
+    for (size_t r = 0; r < ARRAY_SIZE(set->dbs); r++) {
+      if (heads[r] < 0) {
+        continue;
+      }
+      const char *name =
+          irdb_entry_name(set->dbs[r], &set->dbs[r]->entries[heads[r]]);
+      if (best < 0 || strcasecmp(name, best_name) < 0) {
+        best = r;
+        best_name = name;
+      }
+    }
+    if (best < 0) {
+      break;
+    }
+
+    if (skip > 0) {
+      skip--;
+    } else {
+      ir_service_match_t *m = &out[n++];
+
+      strncpy(m->remote, set->ids[best], sizeof(m->remote) - 1);
+      m->remote[sizeof(m->remote) - 1] = '\0';
+      strncpy(m->name, best_name, sizeof(m->name) - 1);
+      m->name[sizeof(m->name) - 1] = '\0';
+      m->id = heads[best];
+    }
+    heads[best] = irdb_prefix_iter_next(&its[best]);
+  }
 
-  offset += snprintf(buf + offset, buf_size - offset, "Functions (%u):\n",
-                     db->entry_count);
+  active_exit(set);
+  return n;
+}
 
-  for (uint32_t i = 0; i < db->entry_count && offset < buf_size; i++) {
-    offset +=
-        snprintf(buf + offset, buf_size - offset, "  %-20s P:%u D:%u.%u F:%u\n",
-                 db->entries[i].function_name, db->entries[i].protocol,
-                 db->entries[i].device, db->entries[i].subdevice,
-                 db->entries[i].function);
+/* 列出活动集 */
+int ir_service_list_remotes(char *buf, size_t buf_size) {
+  if (!buf || buf_size == 0) {
+    return -EINVAL;
   }
 
+  size_t offset = 0;
+  buf[0] = '\0';
+  active_set_t *set = active_enter();
+  for (size_t r = 0; r < ARRAY_SIZE(set->dbs); r++) {
+    const irdb_database_t *db = set->dbs[r];
+
+    if (!db || offset >= buf_size) {
+      continue;
+    }
+    offset += snprintf(buf + offset, buf_size - offset,
+                       "%c %-15s %s %s (%u functions)\n",
+                       r == set->selected ? '*' : ' ',
+                       set->ids[r][0] ? set->ids[r] : "-", db->manufacturer,
+                       db->device_type, db->entry_count);
+  }
+  active_exit(set);
   return 0;
 }
 
-/* 获取数据库 */
+/* 获取条目的功能名称 */
+const char *ir_service_entry_name(const irdb_entry_t *entry) {
+  active_set_t *set = active_enter();
+  const char *name = irdb_entry_name(set->dbs[set_of_entry(set, entry)],
+                                     entry);
+  active_exit(set);
+  return name;
+}
+
+/* 获取条目所属遥控器的编号 - 槽位编号在遥控器移出前不变 */
+const char *ir_service_entry_remote(const irdb_entry_t *entry) {
+  active_set_t *set = active_enter();
+  size_t r = set_of_entry(set, entry);
+  active_exit(set);
+  return service_state.remotes[r].id;
+}
+
+/* 获取数据库 - 当前选中的遥控器 */
 const irdb_database_t *ir_service_get_database(void) {
-  return service_state.db_loaded ? &service_state.current_db : NULL;
-}
\ No newline at end of file
+  active_set_t *set = active_enter();
+  const irdb_database_t *db = set->dbs[set->selected];
+  active_exit(set);
+  return db;
+}
+
+/* 按编号获取活动集中的数据库 */
+const irdb_database_t *ir_service_get_remote(const char *remote_id) {
+  const irdb_database_t *db = NULL;
+
+  if (remote_id) {
+    active_set_t *set = active_enter();
+    int r = set_find(set, remote_id, strlen(remote_id));
+    db = r >= 0 ? set->dbs[r] : NULL;
+    active_exit(set);
+  }
+  return db;
+}
@@ -0,0 +1,1010 @@
+/**
+ * @file ir_signal_lib.c
+ * @brief 学习信号库实现
+ *
+ * LittleFS后端文件布局: 文件魔数 + 记录*N，
+ * 记录 = lib_record_t + 名称(不含'\0') + 正文。正文长度为0的记录表示删除，同名的后一条记录覆盖前一条。写入时整条记录先在
+ * 一块时序缓冲中组装，提交时填好长度一次追加再fs_sync，不再回到记录头
+ * 改写(LittleFS改写文件中间的数据要复制整块)。缓冲池空或记录放不下时
+ * 退回直接写文件: 记录头先以LIB_BODY_PENDING写入，正文写完后回填长度。
+ * 掉电只会在末尾留下未完成的记录，下次扫描时截掉。
+ *
+ * 记录头魔数为LIB_RECORD_MAGIC_LZ时正文是LZ流(ir_lz.h)，记录头中的
+ * 长度为压缩后的字节数，两种记录可以混在同一个文件中。
+ *
+ * NVS后端记录: 名称长度(1字节) + 名称 + 正文，ID为名称哈希起的
+ * IR_SIGNAL_NVS_PROBE个连续ID中的一个，查找时比对记录中的名称。
+ */
+
+#include "ir_signal_lib.h"
+#include "ir_fs.h"
+#include "ir_lz.h"
+#include "ir_mem.h"
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#ifdef CONFIG_FILE_SYSTEM
+#include <zephyr/fs/fs.h>
+#endif
+
+#ifdef CONFIG_IR_LEARNING_STORAGE_NVS
+#include <zephyr/drivers/flash.h>
+#include <zephyr/fs/nvs.h>
+#include <zephyr/storage/flash_map.h>
+#endif
+
+LOG_MODULE_REGISTER(ir_signal_lib, LOG_LEVEL_INF);
+
+/* 压缩正文的流状态 - 同一时刻只有一个读或写，编解码器共用 */
+struct ir_signal_lz {
+  union {
+    ir_lz_encoder_t enc;
+    ir_lz_decoder_t dec;
+  };
+  uint8_t in[32]; // 读入的压缩字节
+  uint8_t in_pos;
+  uint8_t in_len;
+  uint32_t start; // 正文在文件中的起点
+  uint32_t size;  // 正文压缩后的字节数
+  uint32_t left;  // 尚未读入的压缩字节
+};
+
+#ifdef CONFIG_FILE_SYSTEM
+/* 按块读入压缩正文，直接解压到调用者的缓冲 */
+static ssize_t lz_stream_read(ir_signal_stream_t *st, uint8_t *data,
+                              size_t len) {
+  struct ir_signal_lz *z = st->lz;
+  size_t done = 0;
+
+  while (done < len) {
+    if (z->in_pos == z->in_len) {
+      if (z->left == 0) {
+        break;
+      }
+      ssize_t n = fs_read(st->file, z->in, MIN(sizeof(z->in), z->left));
+      if (n <= 0) {
+        return n < 0 ? n : -EIO;
+      }
+      z->left -= n;
+      z->in_pos = 0;
+      z->in_len = n;
+    }
+
+    size_t used;
+    done += ir_lz_decode(&z->dec, z->in + z->in_pos, z->in_len - z->in_pos,
+                         &used, data + done, len - done);
+    z->in_pos += used;
+  }
+
+  st->pos += done;
+  return done;
+}
+#endif
+
+ssize_t ir_signal_stream_read(ir_signal_stream_t *st, void *data, size_t len) {
+#ifdef CONFIG_FILE_SYSTEM
+  if (st->lz) {
+    return lz_stream_read(st, data, len);
+  }
+  if (st->file) {
+    ssize_t n = fs_read(st->file, data, len);
+    st->pos += n > 0 ? n : 0;
+    return n;
+  }
+#endif
+
+  size_t n = MIN(len, st->size - st->pos);
+  memcpy(data, st->buf + st->pos, n);
+  st->pos += n;
+  return n;
+}
+
+ssize_t ir_signal_stream_write(ir_signal_stream_t *st, const void *data,
+                               size_t len) {
+#ifdef CONFIG_FILE_SYSTEM
+  if (st->lz) {
+    int ret = ir_lz_encode(&st->lz->enc, data, len);
+    if (ret < 0) {
+      return ret;
+    }
+    st->pos += len;
+    return len;
+  }
+  if (st->sink) {
+    int ret = st->sink(NULL, data, len);
+    if (ret < 0) {
+      return ret;
+    }
+    st->pos += len;
+    return len;
+  }
+  if (st->file) {
+    ssize_t n = fs_write(st->file, data, len);
+    st->pos += n > 0 ? n : 0;
+    return n;
+  }
+#endif
+
+  if (len > st->size - st->pos) {
+    return -ENOSPC;
+  }
+  memcpy(st->buf + st->pos, data, len);
+  st->pos += len;
+  return len;
+}
+
+int ir_signal_stream_rewind(ir_signal_stream_t *st) {
+#ifdef CONFIG_FILE_SYSTEM
+  if (st->lz) {
+    /* 压缩正文从头重新解压 */
+    int ret = fs_seek(st->file, st->lz->start, FS_SEEK_SET);
+    if (ret < 0) {
+      return ret;
+    }
+    ir_lz_decoder_init(&st->lz->dec);
+    st->lz->in_pos = st->lz->in_len = 0;
+    st->lz->left = st->lz->size;
+  } else if (st->file) {
+    int ret = fs_seek(st->file, -(off_t)st->pos, FS_SEEK_CUR);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+#endif
+
+  st->pos = 0;
+  return 0;
+}
+
+/* FNV-1a */
+static uint32_t lib_hash(const char *name, size_t len) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h = (h ^ (uint8_t)name[i]) * 16777619u;
+  }
+  return h;
+}
+
+static K_MUTEX_DEFINE(lib_mutex);
+
+#if defined(CONFIG_IR_LEARNING_STORAGE_LFS)
+
+#define LIB_FILE_MAGIC 0x4C535249 // "IRSL"
+#define LIB_RECORD_MAGIC 0xA7
+#define LIB_RECORD_MAGIC_LZ 0xA8 // 正文为LZ流
+#define LIB_BODY_PENDING 0xFFFF // 正文尚未提交
+#define LIB_TMP_PATH "/lfs/ir_learned.tmp"
+#define LIB_SLOTS (2 * IR_SIGNAL_LIB_MAX) // 索引槽数，负载不超过1/2
+#define LIB_COMPACT_MIN 4096 // 废弃字节达到此值且超过有效字节时整理
+#define LIB_STAGE_BYTES (IR_TIMING_BUF_TIMINGS * sizeof(ir_timing_t))
+
+/* 记录头 */
+typedef struct {
+  uint8_t magic;     // LIB_RECORD_MAGIC
+  uint8_t name_len;  // 名称长度
+  uint16_t body_len; // 正文长度，0为删除记录
+} lib_record_t;
+
+/* 内存索引条目 - 名称留在文件中，哈希相同时再读出比对 */
+typedef struct {
+  uint32_t hash;
+  uint32_t offset; // 记录在文件中的起点
+  uint16_t body_len;
+  uint8_t name_len;
+  bool lz;
+} lib_entry_t;
+
+static struct {
+  struct fs_file_t file;
+  ir_signal_stream_t stream; // 指向file，读写正文
+  struct ir_signal_lz lz;    // 压缩正文的编解码状态
+  bool open;
+  lib_entry_t entries[IR_SIGNAL_LIB_MAX];
+  uint16_t slots[LIB_SLOTS]; // 条目下标+1，0为空
+  uint16_t count;
+  uint32_t end;  // 文件长度
+  uint32_t dead; // 作废记录占用的字节
+
+  /* 进行中的写入 - stage非NULL时记录在其中组装 */
+  uint8_t *stage;
+  size_t stage_len;
+  uint32_t pending_offset;
+  uint32_t pending_hash;
+  uint8_t pending_name_len;
+  char pending_name[IR_SIGNAL_LIB_NAME_MAX];
+} lib;
+
+static uint32_t record_size(uint8_t name_len, uint16_t body_len) {
+  return sizeof(lib_record_t) + name_len + body_len;
+}
+
+static int read_at(uint32_t offset, void *buf, size_t len) {
+  int ret = fs_seek(&lib.file, offset, FS_SEEK_SET);
+  if (ret < 0) {
+    return ret;
+  }
+  ssize_t n = fs_read(&lib.file, buf, len);
+  return n == (ssize_t)len ? 0 : (n < 0 ? n : -EIO);
+}
+
+static int write_at(uint32_t offset, const void *buf, size_t len) {
+  int ret = fs_seek(&lib.file, offset, FS_SEEK_SET);
+  if (ret < 0) {
+    return ret;
+  }
+  ssize_t n = fs_write(&lib.file, buf, len);
+  return n == (ssize_t)len ? 0 : (n < 0 ? n : -ENOSPC);
+}
+
+/* 写入进行中的记录 - 先进暂存缓冲，放不下时把已暂存的部分写入文件，
+ * 此后直接写文件。签名同ir_lz_sink_t，也作为压缩正文的输出 */
+static int lib_put(void *ctx, const void *data, size_t len) {
+  if (lib.stage && lib.stage_len + len <= LIB_STAGE_BYTES) {
+    memcpy(lib.stage + lib.stage_len, data, len);
+    lib.stage_len += len;
+    return 0;
+  }
+
+  if (lib.stage) {
+    int ret = write_at(lib.pending_offset, lib.stage, lib.stage_len);
+    ir_timing_buf_free((ir_timing_t *)lib.stage);
+    lib.stage = NULL;
+    if (ret < 0) {
+      return ret;
+    }
+  }
+
+  ssize_t n = fs_write(&lib.file, data, len);
+  return n == (ssize_t)len ? 0 : (n < 0 ? n : -ENOSPC);
+}
+
+static bool entry_name_equal(const lib_entry_t *e, const char *name,
+                             size_t len) {
+  char buf[IR_SIGNAL_LIB_NAME_MAX];
+
+  return e->name_len == len &&
+         read_at(e->offset + sizeof(lib_record_t), buf, len) == 0 &&
+         memcmp(buf, name, len) == 0;
+}
+
+/* 按名称查找条目下标，未找到返回-1 */
+static int lib_find(const char *name, size_t len, uint32_t hash) {
+  for (uint32_t i = 0, slot = hash % LIB_SLOTS; i < LIB_SLOTS;
+       i++, slot = (slot + 1) % LIB_SLOTS) {
+    uint16_t idx = lib.slots[slot];
+    if (idx == 0) {
+      break;
+    }
+    const lib_entry_t *e = &lib.entries[idx - 1];
+    if (e->hash == hash && entry_name_equal(e, name, len)) {
+      return idx - 1;
+    }
+  }
+  return -1;
+}
+
+static void slot_insert(uint16_t idx) {
+  uint32_t slot = lib.entries[idx].hash % LIB_SLOTS;
+  while (lib.slots[slot] != 0) {
+    slot = (slot + 1) % LIB_SLOTS;
+  }
+  lib.slots[slot] = idx + 1;
+}
+
+/* 移除条目 - 末尾条目补位后重建槽 (删除远少于查找) */
+static void lib_remove(int idx) {
+  const lib_entry_t *e = &lib.entries[idx];
+
+  lib.dead += record_size(e->name_len, e->body_len);
+  lib.entries[idx] = lib.entries[--lib.count];
+
+  memset(lib.slots, 0, sizeof(lib.slots));
+  for (uint16_t i = 0; i < lib.count; i++) {
+    slot_insert(i);
+  }
+}
+
+/* 记录生效: 同名旧记录作废，删除记录本身也计为废弃字节 */
+static int lib_apply(const char *name, uint8_t name_len, uint32_t hash,
+                     uint32_t offset, uint16_t body_len, bool lz) {
+  int idx = lib_find(name, name_len, hash);
+  if (idx >= 0) {
+    lib_remove(idx);
+  }
+
+  if (body_len == 0) {
+    lib.dead += record_size(name_len, 0);
+    return 0;
+  }
+
+  if (lib.count == IR_SIGNAL_LIB_MAX) {
+    return -ENOSPC;
+  }
+
+  lib.entries[lib.count] = (lib_entry_t){
+      .hash = hash,
+      .offset = offset,
+      .body_len = body_len,
+      .name_len = name_len,
+      .lz = lz,
+  };
+  slot_insert(lib.count++);
+  return 0;
+}
+
+/* 扫描全部记录建立索引，遇到不完整或损坏的记录从该处截断 */
+static int lib_scan(uint32_t size) {
+  uint32_t offset = sizeof(uint32_t);
+
+  while (offset < size) {
+    lib_record_t rec;
+    char name[IR_SIGNAL_LIB_NAME_MAX];
+
+    int ret = read_at(offset, &rec, sizeof(rec));
+    bool valid = ret == 0 &&
+                 (rec.magic == LIB_RECORD_MAGIC ||
+                  rec.magic == LIB_RECORD_MAGIC_LZ) &&
+                 rec.name_len > 0 && rec.name_len < sizeof(name) &&
+                 rec.body_len != LIB_BODY_PENDING &&
+                 offset + record_size(rec.name_len, rec.body_len) <= size;
+    if (valid) {
+      valid = read_at(offset + sizeof(rec), name, rec.name_len) == 0;
+    }
+
+    if (!valid) {
+      LOG_WRN("Truncating signal library at %u/%u", offset, size);
+      ret = fs_truncate(&lib.file, offset);
+      size = offset;
+      if (ret < 0) {
+        return ret;
+      }
+      break;
+    }
+
+    ret = lib_apply(name, rec.name_len, lib_hash(name, rec.name_len), offset,
+                    rec.body_len, rec.magic == LIB_RECORD_MAGIC_LZ);
+    if (ret < 0) {
+      LOG_WRN("Signal library full, ignoring records from %u", offset);
+    }
+    offset += record_size(rec.name_len, rec.body_len);
+  }
+
+  lib.end = size;
+  return 0;
+}
+
+static int lib_open(void) {
+  uint32_t magic = LIB_FILE_MAGIC;
+  uint32_t stored = 0;
+
+  fs_file_t_init(&lib.file);
+  int ret = fs_open(&lib.file, IR_SIGNAL_LIB_PATH, FS_O_CREATE | FS_O_RDWR);
+  if (ret < 0) {
+    return ret;
+  }
+
+  ret = fs_seek(&lib.file, 0, FS_SEEK_END);
+  off_t size = ret == 0 ? fs_tell(&lib.file) : ret;
+  if (size < 0) {
+    fs_close(&lib.file);
+    return size;
+  }
+
+  if (size >= (off_t)sizeof(stored)) {
+    read_at(0, &stored, sizeof(stored));
+  }
+  if (stored != magic) {
+    if (size > 0) {
+      LOG_ERR("Signal library corrupt, recreating");
+      fs_truncate(&lib.file, 0);
+    }
+    ret = write_at(0, &magic, sizeof(magic));
+    if (ret == 0) {
+      ret = fs_sync(&lib.file);
+    }
+    size = sizeof(magic);
+  }
+
+  lib.count = 0;
+  lib.dead = 0;
+  memset(lib.slots, 0, sizeof(lib.slots));
+
+  if (ret == 0) {
+    ret = lib_scan(size);
+  }
+  if (ret < 0) {
+    fs_close(&lib.file);
+    return ret;
+  }
+
+  lib.open = true;
+  return 0;
+}
+
+/* 整理 - 有效记录按索引顺序复制到临时文件后替换原文件 */
+static void lib_compact(void) {
+  if (lib.dead < LIB_COMPACT_MIN || lib.dead < lib.end - lib.dead) {
+    return;
+  }
+
+  struct fs_file_t tmp;
+  uint32_t magic = LIB_FILE_MAGIC;
+  uint8_t chunk[64];
+  fs_file_t_init(&tmp);
+
+  int ret = fs_open(&tmp, LIB_TMP_PATH, FS_O_CREATE | FS_O_WRITE | FS_O_TRUNC);
+  if (ret < 0) {
+    LOG_WRN("Signal library compaction failed: %d", ret);
+    return;
+  }
+
+  ssize_t n = fs_write(&tmp, &magic, sizeof(magic));
+  ret = n == sizeof(magic) ? 0 : (n < 0 ? n : -ENOSPC);
+
+  for (uint16_t i = 0; ret == 0 && i < lib.count; i++) {
+    const lib_entry_t *e = &lib.entries[i];
+    uint32_t remaining = record_size(e->name_len, e->body_len);
+    uint32_t offset = e->offset;
+
+    while (ret == 0 && remaining > 0) {
+      size_t len = MIN(remaining, sizeof(chunk));
+      ret = read_at(offset, chunk, len);
+      if (ret == 0) {
+        n = fs_write(&tmp, chunk, len);
+        ret = n == (ssize_t)len ? 0 : (n < 0 ? n : -ENOSPC);
+      }
+      offset += len;
+      remaining -= len;
+    }
+  }
+  fs_close(&tmp);
+
+  if (ret < 0) {
+    LOG_WRN("Signal library compaction failed: %d", ret);
+    fs_unlink(LIB_TMP_PATH);
+    return;
+  }
+
+  /* 删除原文件后改名；中途掉电时lib_init从临时文件恢复 */
+  uint32_t before = lib.end;
+  fs_close(&lib.file);
+  lib.open = false;
+  fs_unlink(IR_SIGNAL_LIB_PATH);
+
+  ret = fs_rename(LIB_TMP_PATH, IR_SIGNAL_LIB_PATH);
+  if (ret == 0) {
+    ret = lib_open();
+  }
+  if (ret < 0) {
+    LOG_ERR("Failed to reopen signal library: %d", ret);
+    return;
+  }
+
+  LOG_INF("Signal library compacted: %u -> %u bytes", before, lib.end);
+}
+
+int ir_signal_lib_init(void) {
+  struct fs_dirent entry;
+  int ret = 0;
+
+  k_mutex_lock(&lib_mutex, K_FOREVER);
+
+  if (!lib.open) {
+    ret = ir_fs_mount();
+  }
+  if (!lib.open && ret == 0) {
+    /* 整理在删除原文件和改名之间掉电: 临时文件即完整的库 */
+    if (fs_stat(IR_SIGNAL_LIB_PATH, &entry) < 0 &&
+        fs_stat(LIB_TMP_PATH, &entry) == 0) {
+      LOG_WRN("Recovering signal library from %s", LIB_TMP_PATH);
+      fs_rename(LIB_TMP_PATH, IR_SIGNAL_LIB_PATH);
+    } else {
+      fs_unlink(LIB_TMP_PATH);
+    }
+
+    ret = lib_open();
+    if (ret < 0) {
+      LOG_ERR("Failed to open signal library: %d", ret);
+    } else {
+      LOG_INF("Signal library: %u signals, %u bytes (%u dead)", lib.count,
+              lib.end, lib.dead);
+      lib_compact();
+    }
+  }
+
+  k_mutex_unlock(&lib_mutex);
+  return ret;
+}
+
+int ir_signal_lib_read_begin(const char *name, ir_signal_stream_t **st) {
+  size_t len = name ? strlen(name) : 0;
+  if (len == 0 || len >= IR_SIGNAL_LIB_NAME_MAX || !st) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&lib_mutex, K_FOREVER);
+
+  int idx = lib.open ? lib_find(name, len, lib_hash(name, len)) : -1;
+  int ret = idx >= 0 ? 0 : (lib.open ? -ENOENT : -ENODEV);
+  const lib_entry_t *e = ret == 0 ? &lib.entries[idx] : NULL;
+  uint32_t body = e ? e->offset + sizeof(lib_record_t) + e->name_len : 0;
+  if (ret == 0) {
+    ret = fs_seek(&lib.file, body, FS_SEEK_SET);
+  }
+
+  if (ret < 0) {
+    k_mutex_unlock(&lib_mutex);
+    return ret;
+  }
+
+  lib.stream = (ir_signal_stream_t){.file = &lib.file};
+  if (e->lz) {
+    ir_lz_decoder_init(&lib.lz.dec);
+    lib.lz.in_pos = lib.lz.in_len = 0;
+    lib.lz.start = body;
+    lib.lz.size = lib.lz.left = e->body_len;
+    lib.stream.lz = &lib.lz;
+  }
+  *st = &lib.stream;
+  return 0;
+}
+
+void ir_signal_lib_read_end(void) {
+  k_mutex_unlock(&lib_mutex);
+}
+
+int ir_signal_lib_write_begin(const char *name, ir_signal_stream_t **st) {
+  size_t len = name ? strlen(name) : 0;
+  if (len == 0 || len >= IR_SIGNAL_LIB_NAME_MAX || !st) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&lib_mutex, K_FOREVER);
+
+  uint32_t hash = lib_hash(name, len);
+  int ret = 0;
+
+  if (!lib.open) {
+    ret = -ENODEV;
+  } else if (lib.count == IR_SIGNAL_LIB_MAX && lib_find(name, len, hash) < 0) {
+    ret = -ENOSPC;
+  }
+
+  bool lz = IS_ENABLED(CONFIG_IR_STORAGE_COMPRESS);
+
+  if (ret == 0) {
+    lib_record_t rec = {
+        .magic = lz ? LIB_RECORD_MAGIC_LZ : LIB_RECORD_MAGIC,
+        .name_len = len,
+        .body_len = LIB_BODY_PENDING,
+    };
+
+    /* 池空时不等待，直接写文件 */
+    lib.stage = (uint8_t *)ir_timing_buf_alloc();
+    lib.stage_len = 0;
+    lib.pending_offset = lib.end;
+
+    ret = fs_seek(&lib.file, lib.end, FS_SEEK_SET);
+    if (ret == 0) {
+      ret = lib_put(NULL, &rec, sizeof(rec));
+    }
+    if (ret == 0) {
+      ret = lib_put(NULL, name, len);
+    }
+    if (ret < 0) {
+      ir_timing_buf_free((ir_timing_t *)lib.stage);
+      lib.stage = NULL;
+      fs_truncate(&lib.file, lib.end);
+    }
+  }
+
+  if (ret < 0) {
+    k_mutex_unlock(&lib_mutex);
+    return ret;
+  }
+
+  lib.pending_hash = hash;
+  lib.pending_name_len = len;
+  memcpy(lib.pending_name, name, len);
+  lib.stream = (ir_signal_stream_t){.sink = lib_put};
+  if (lz) {
+    ir_lz_encoder_init(&lib.lz.enc, lib_put, NULL);
+    lib.stream.lz = &lib.lz;
+  }
+  *st = &lib.stream;
+  return 0;
+}
+
+int ir_signal_lib_write_end(bool commit) {
+  uint32_t body = lib.pending_offset + record_size(lib.pending_name_len, 0);
+  bool lz = lib.stream.lz != NULL;
+  int ret = 0;
+
+  /* 编码器中剩余的字节写出后正文才完整 */
+  if (commit && lz) {
+    ret = ir_lz_encode_finish(&lib.lz.enc);
+  }
+  off_t pos = lib.stage ? (off_t)(lib.pending_offset + lib.stage_len)
+                        : fs_tell(&lib.file);
+
+  if (!commit) {
+    ret = -ECANCELED;
+  } else if (ret == 0 && pos < 0) {
+    ret = pos;
+  } else if (ret == 0 && (pos <= body || pos - body >= LIB_BODY_PENDING)) {
+    ret = pos <= body ? -EINVAL : -E2BIG;
+  }
+
+  if (ret == 0) {
+    lib_record_t rec = {
+        .magic = lz ? LIB_RECORD_MAGIC_LZ : LIB_RECORD_MAGIC,
+        .name_len = lib.pending_name_len,
+        .body_len = pos - body,
+    };
+
+    /* 暂存的整条记录一次追加，否则回填已写入文件的记录头 */
+    if (lib.stage) {
+      memcpy(lib.stage, &rec, sizeof(rec));
+      ret = write_at(lib.pending_offset, lib.stage, lib.stage_len);
+    } else {
+      ret = write_at(lib.pending_offset, &rec, sizeof(rec));
+    }
+    if (ret == 0) {
+      ret = fs_sync(&lib.file);
+    }
+    if (ret == 0) {
+      lib.end = pos;
+      ret = lib_apply(lib.pending_name, lib.pending_name_len, lib.pending_hash,
+                      lib.pending_offset, rec.body_len, lz);
+    }
+  }
+
+  ir_timing_buf_free((ir_timing_t *)lib.stage);
+  lib.stage = NULL;
+
+  if (ret < 0) {
+    fs_truncate(&lib.file, lib.pending_offset);
+    lib.end = lib.pending_offset;
+  } else {
+    lib_compact();
+  }
+
+  k_mutex_unlock(&lib_mutex);
+  return ret == -ECANCELED ? 0 : ret;
+}
+
+int ir_signal_lib_delete(const char *name) {
+  size_t len = name ? strlen(name) : 0;
+  if (len == 0 || len >= IR_SIGNAL_LIB_NAME_MAX) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&lib_mutex, K_FOREVER);
+
+  uint32_t hash = lib_hash(name, len);
+  int idx = lib.open ? lib_find(name, len, hash) : -1;
+  int ret = idx >= 0 ? 0 : (lib.open ? -ENOENT : -ENODEV);
+
+  if (ret == 0) {
+    lib_record_t rec = {
+        .magic = LIB_RECORD_MAGIC,
+        .name_len = len,
+        .body_len = 0,
+    };
+    ret = write_at(lib.end, &rec, sizeof(rec));
+    if (ret == 0) {
+      ssize_t n = fs_write(&lib.file, name, len);
+      ret = n == (ssize_t)len ? 0 : (n < 0 ? n : -ENOSPC);
+    }
+    if (ret == 0) {
+      ret = fs_sync(&lib.file);
+    }
+
+    if (ret < 0) {
+      fs_truncate(&lib.file, lib.end);
+    } else {
+      lib_apply(name, len, hash, lib.end, 0, false);
+      lib.end += record_size(len, 0);
+      lib_compact();
+    }
+  }
+
+  k_mutex_unlock(&lib_mutex);
+  return ret;
+}
+
+uint16_t ir_signal_lib_count(void) {
+  return lib.count;
+}
+
+int ir_signal_lib_name(uint16_t index, char *name, size_t size) {
+  if (!name || size == 0) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&lib_mutex, K_FOREVER);
+
+  int ret = index < lib.count ? 0 : -ENOENT;
+  if (ret == 0) {
+    const lib_entry_t *e = &lib.entries[index];
+    size_t len = MIN(e->name_len, size - 1);
+    ret = read_at(e->offset + sizeof(lib_record_t), name, len);
+    name[ret == 0 ? len : 0] = '\0';
+  }
+
+  k_mutex_unlock(&lib_mutex);
+  return ret;
+}
+
+#elif defined(CONFIG_IR_LEARNING_STORAGE_NVS)
+#define NVS_ID_BASE 1 // 信号占用ID NVS_ID_BASE起的IR_SIGNAL_LIB_MAX个
+#define NVS_PROBE 8   // 名称哈希冲突时顺延的ID数
+#define NVS_PARTITION ir_nvs_partition
+
+static struct {
+  struct nvs_fs fs;
+  bool open;
+  uint32_t used[DIV_ROUND_UP(IR_SIGNAL_LIB_MAX, 32)]; // 已占用的槽
+  uint16_t count;
+  uint16_t pending_slot;
+  ir_signal_stream_t stream;
+  uint8_t record[IR_SIGNAL_NVS_RECORD_MAX];
+} nvs_lib;
+
+static bool slot_used(uint16_t slot) {
+  return nvs_lib.used[slot / 32] & BIT(slot % 32);
+}
+
+static void slot_mark(uint16_t slot, bool used) {
+  if (slot_used(slot) == used) {
+    return;
+  }
+  nvs_lib.used[slot / 32] ^= BIT(slot % 32);
+  nvs_lib.count += used ? 1 : -1;
+}
+
+/* 读记录头(名称长度 + 名称) */
+static int nvs_read_name(uint16_t slot, uint8_t *hdr, size_t size) {
+  ssize_t n = nvs_read(&nvs_lib.fs, NVS_ID_BASE + slot, hdr, size);
+  if (n < 0) {
+    return n;
+  }
+  return n >= 1 + hdr[0] && hdr[0] < IR_SIGNAL_LIB_NAME_MAX ? 0 : -EBADMSG;
+}
+
+/* 在名称哈希起的NVS_PROBE个槽中查找，free_slot返回第一个空槽(无则-1) */
+static int nvs_find(const char *name, size_t len, int *free_slot) {
+  uint32_t hash = lib_hash(name, len);
+  uint8_t hdr[1 + IR_SIGNAL_LIB_NAME_MAX];
+
+  if (free_slot) {
+    *free_slot = -1;
+  }
+
+  for (uint16_t i = 0; i < MIN(NVS_PROBE, IR_SIGNAL_LIB_MAX); i++) {
+    uint16_t slot = (hash + i) % IR_SIGNAL_LIB_MAX;
+
+    if (!slot_used(slot)) {
+      if (free_slot && *free_slot < 0) {
+        *free_slot = slot;
+      }
+      continue;
+    }
+    if (nvs_read_name(slot, hdr, sizeof(hdr)) == 0 && hdr[0] == len &&
+        memcmp(hdr + 1, name, len) == 0) {
+      return slot;
+    }
+  }
+  return -1;
+}
+
+int ir_signal_lib_init(void) {
+  struct flash_pages_info info;
+  int ret = 0;
+
+  k_mutex_lock(&lib_mutex, K_FOREVER);
+
+  if (!nvs_lib.open) {
+    nvs_lib.fs.flash_device = FIXED_PARTITION_DEVICE(NVS_PARTITION);
+    nvs_lib.fs.offset = FIXED_PARTITION_OFFSET(NVS_PARTITION);
+
+    if (!device_is_ready(nvs_lib.fs.flash_device)) {
+      ret = -ENODEV;
+    } else {
+      ret = flash_get_page_info_by_offs(nvs_lib.fs.flash_device,
+                                        nvs_lib.fs.offset, &info);
+    }
+    if (ret == 0) {
+      nvs_lib.fs.sector_size = info.size;
+      nvs_lib.fs.sector_count = FIXED_PARTITION_SIZE(NVS_PARTITION) / info.size;
+      ret = nvs_mount(&nvs_lib.fs);
+    }
+
+    if (ret < 0) {
+      LOG_ERR("Failed to mount NVS signal storage: %d", ret);
+    } else {
+      /* 记录哪些槽有数据，查找时跳过空槽 */
+      memset(nvs_lib.used, 0, sizeof(nvs_lib.used));
+      nvs_lib.count = 0;
+      for (uint16_t slot = 0; slot < IR_SIGNAL_LIB_MAX; slot++) {
+        uint8_t name_len;
+        if (nvs_read(&nvs_lib.fs, NVS_ID_BASE + slot, &name_len, 1) > 0) {
+          slot_mark(slot, true);
+        }
+      }
+      nvs_lib.open = true;
+      LOG_INF("NVS signal storage: %u signals, %u bytes free", nvs_lib.count,
+              (uint32_t)nvs_calc_free_space(&nvs_lib.fs));
+    }
+  }
+
+  k_mutex_unlock(&lib_mutex);
+  return ret;
+}
+
+int ir_signal_lib_read_begin(const char *name, ir_signal_stream_t **st) {
+  size_t len = name ? strlen(name) : 0;
+  if (len == 0 || len >= IR_SIGNAL_LIB_NAME_MAX || !st) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&lib_mutex, K_FOREVER);
+
+  int slot = nvs_lib.open ? nvs_find(name, len, NULL) : -1;
+  int ret = slot >= 0 ? 0 : (nvs_lib.open ? -ENOENT : -ENODEV);
+  ssize_t n = 0;
+
+  if (ret == 0) {
+    n = nvs_read(&nvs_lib.fs, NVS_ID_BASE + slot, nvs_lib.record,
+                 sizeof(nvs_lib.record));
+    ret = n < 0 ? n : (n > sizeof(nvs_lib.record) ? -E2BIG : 0);
+  }
+
+  if (ret < 0) {
+    k_mutex_unlock(&lib_mutex);
+    return ret;
+  }
+
+  nvs_lib.stream = (ir_signal_stream_t){
+      .buf = nvs_lib.record + 1 + len,
+      .size = n - 1 - len,
+  };
+  *st = &nvs_lib.stream;
+  return 0;
+}
+
+void ir_signal_lib_read_end(void) {
+  k_mutex_unlock(&lib_mutex);
+}
+
+int ir_signal_lib_write_begin(const char *name, ir_signal_stream_t **st) {
+  size_t len = name ? strlen(name) : 0;
+  if (len == 0 || len >= IR_SIGNAL_LIB_NAME_MAX || !st) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&lib_mutex, K_FOREVER);
+
+  int free_slot = -1;
+  int slot = nvs_lib.open ? nvs_find(name, len, &free_slot) : -1;
+  if (slot < 0) {
+    slot = free_slot;
+  }
+
+  if (!nvs_lib.open || slot < 0) {
+    k_mutex_unlock(&lib_mutex);
+    return nvs_lib.open ? -ENOSPC : -ENODEV;
+  }
+
+  /* 正文在RAM中组装，提交时一次写入 */
+  nvs_lib.pending_slot = slot;
+  nvs_lib.record[0] = len;
+  memcpy(nvs_lib.record + 1, name, len);
+  nvs_lib.stream = (ir_signal_stream_t){
+      .buf = nvs_lib.record + 1 + len,
+      .size = sizeof(nvs_lib.record) - 1 - len,
+  };
+  *st = &nvs_lib.stream;
+  return 0;
+}
+
+int ir_signal_lib_write_end(bool commit) {
+  int ret = 0;
+
+  if (commit) {
+    size_t len = 1 + nvs_lib.record[0] + nvs_lib.stream.pos;
+    ssize_t n = nvs_write(&nvs_lib.fs, NVS_ID_BASE + nvs_lib.pending_slot,
+                          nvs_lib.record, len);
+    ret = n < 0 ? n : 0;
+    if (ret == 0) {
+      slot_mark(nvs_lib.pending_slot, true);
+    }
+  }
+
+  k_mutex_unlock(&lib_mutex);
+  return ret;
+}
+
+int ir_signal_lib_delete(const char *name) {
+  size_t len = name ? strlen(name) : 0;
+  if (len == 0 || len >= IR_SIGNAL_LIB_NAME_MAX) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&lib_mutex, K_FOREVER);
+
+  int slot = nvs_lib.open ? nvs_find(name, len, NULL) : -1;
+  int ret = slot >= 0 ? 0 : (nvs_lib.open ? -ENOENT : -ENODEV);
+  if (ret == 0) {
+    ret = nvs_delete(&nvs_lib.fs, NVS_ID_BASE + slot);
+    if (ret == 0) {
+      slot_mark(slot, false);
+    }
+  }
+
+  k_mutex_unlock(&lib_mutex);
+  return ret;
+}
+
+uint16_t ir_signal_lib_count(void) {
+  return nvs_lib.count;
+}
+
+int ir_signal_lib_name(uint16_t index, char *name, size_t size) {
+  uint8_t hdr[1 + IR_SIGNAL_LIB_NAME_MAX];
+
+  if (!name || size == 0) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&lib_mutex, K_FOREVER);
+
+  int ret = -ENOENT;
+  for (uint16_t slot = 0; slot < IR_SIGNAL_LIB_MAX; slot++) {
+    if (!slot_used(slot) || index-- > 0) {
+      continue;
+    }
+    ret = nvs_read_name(slot, hdr, sizeof(hdr));
+    if (ret == 0) {
+      size_t len = MIN(hdr[0], size - 1);
+      memcpy(name, hdr + 1, len);
+      name[len] = '\0';
+    }
+    break;
+  }
+
+  k_mutex_unlock(&lib_mutex);
+  return ret;
+}
+#else
+int ir_signal_lib_init(void) {
+  return -ENOTSUP;
+}
+
+int ir_signal_lib_read_begin(const char *name, ir_signal_stream_t **st) {
+  return -ENOTSUP;
+}
+
+void ir_signal_lib_read_end(void) {}
+
+int ir_signal_lib_write_begin(const char *name, ir_signal_stream_t **st) {
+  return -ENOTSUP;
+}
+
+int ir_signal_lib_write_end(bool commit) {
+  return -ENOTSUP;
+}
+
+int ir_signal_lib_delete(const char *name) {
+  return -ENOTSUP;
+}
+
+uint16_t ir_signal_lib_count(void) {
+  return 0;
+}
+
+int ir_signal_lib_name(uint16_t index, char *name, size_t size) {
+  return -ENOTSUP;
+}
+#endif
@@ -0,0 +1,23 @@
+/**
+ * @file ir_stats.c
+ * @brief 运行计数汇总实现
+ */
+
+#include "ir_stats.h"
+#include <string.h>
+
+void ir_stats_get(ir_stats_t *stats) {
+  if (!stats) {
+    return;
+  }
+
+  memset(stats, 0, sizeof(*stats));
+  ir_hal_rx_get_stats(&stats->rx);
+  ir_service_get_rx_stats(&stats->decode);
+  irdb_cache_get_stats(&stats->irdb_cache);
+  stats->parsed_bytes = irdb_parser_bytes();
+  ir_hal_tx_get_power_stats(&stats->tx);
+  ir_tx_queue_get_stats(&stats->tx_queue);
+  ir_tx_cache_get_stats(&stats->tx_cache);
+  ir_learning_get_stats(&stats->learning);
+}
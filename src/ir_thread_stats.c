@@ -0,0 +1,120 @@
+/**
+ * @file ir_thread_stats.c
+ * @brief 线程栈高水位和CPU占用实现
+ */
+
+#include "ir_thread_stats.h"
+#include <string.h>
+#include <zephyr/kernel.h>
+
+/* 上次取样时各线程的累计执行周期，按线程地址对应 */
+typedef struct {
+  const struct k_thread *thread;
+  uint64_t cycles;
+} thread_sample_t;
+
+static K_MUTEX_DEFINE(thread_stats_mutex);
+
+static struct {
+  thread_sample_t samples[IR_THREAD_STATS_MAX];
+  size_t sample_count;
+  uint64_t all_cycles;
+} thread_stats;
+
+/* 一次取样的遍历上下文 */
+typedef struct {
+  ir_thread_stat_t *out;
+  size_t max;
+  size_t count;
+  thread_sample_t samples[IR_THREAD_STATS_MAX];
+  uint64_t all_cycles; // 启动以来
+  uint64_t all_delta;  // 自上次取样
+  uint64_t idle_delta;
+} collect_t;
+
+static uint16_t permille(uint64_t part, uint64_t whole) {
+  return whole > 0 ? (uint16_t)MIN(part * 1000 / whole, 1000) : 0;
+}
+
+static uint64_t last_cycles(const struct k_thread *thread) {
+  for (size_t i = 0; i < thread_stats.sample_count; i++) {
+    if (thread_stats.samples[i].thread == thread) {
+      return thread_stats.samples[i].cycles;
+    }
+  }
+  return 0; // 上次之后创建的线程
+}
+
+static void collect_thread(const struct k_thread *thread, void *user_data) {
+  collect_t *c = user_data;
+  k_tid_t tid = (k_tid_t)thread;
+  k_thread_runtime_stats_t rt;
+  size_t unused = 0;
+
+  if (c->count >= c->max) {
+    return;
+  }
+  if (k_thread_runtime_stats_get(tid, &rt) < 0) {
+    rt.execution_cycles = 0;
+  }
+
+  uint64_t delta = rt.execution_cycles - last_cycles(thread);
+  ir_thread_stat_t *s = &c->out[c->count];
+  const char *name = k_thread_name_get(tid);
+
+  strncpy(s->name, name ? name : "?", sizeof(s->name) - 1);
+  s->name[sizeof(s->name) - 1] = '\0';
+  s->priority = k_thread_priority_get(tid);
+  s->stack_size = thread->stack_info.size;
+  s->stack_used = k_thread_stack_space_get(thread, &unused) == 0
+                      ? s->stack_size - unused
+                      : 0;
+  s->cpu_permille = permille(delta, c->all_delta);
+  s->cpu_total_permille = permille(rt.execution_cycles, c->all_cycles);
+
+  if (s->priority == K_IDLE_PRIO) {
+    c->idle_delta += delta;
+  }
+  c->samples[c->count].thread = thread;
+  c->samples[c->count].cycles = rt.execution_cycles;
+  c->count++;
+}
+
+int ir_thread_stats_get(ir_thread_stat_t *out, size_t max,
+                        uint16_t *total_permille) {
+  static collect_t c; // 约0.4KB，不占调用者的栈
+  k_thread_runtime_stats_t all;
+
+  if (!out) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&thread_stats_mutex, K_FOREVER);
+
+  if (k_thread_runtime_stats_all_get(&all) < 0) {
+    k_mutex_unlock(&thread_stats_mutex);
+    return -ENOTSUP;
+  }
+
+  memset(&c, 0, sizeof(c));
+  c.out = out;
+  c.max = MIN(max, IR_THREAD_STATS_MAX);
+  c.all_cycles = all.execution_cycles;
+  c.all_delta = all.execution_cycles - thread_stats.all_cycles;
+
+  /* 不持锁遍历 - 扫描栈较慢，期间不关中断 */
+  k_thread_foreach_unlocked(collect_thread, &c);
+
+  memcpy(thread_stats.samples, c.samples, sizeof(c.samples));
+  thread_stats.sample_count = c.count;
+  thread_stats.all_cycles = all.execution_cycles;
+
+  if (total_permille) {
+    *total_permille = c.all_delta > c.idle_delta
+                          ? permille(c.all_delta - c.idle_delta, c.all_delta)
+                          : 0;
+  }
+
+  k_mutex_unlock(&thread_stats_mutex);
+  return c.count;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file ir_timesync.c
+ * @brief 同步时基实现 - 本机运行时间加偏移，秒脉冲对齐到整秒
+ */
+
+#include "ir_timesync.h"
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#if defined(CONFIG_IR_TIMESYNC_PPS) &&                                         \
+    DT_NODE_HAS_PROP(DT_PATH(zephyr_user), ir_pps_gpios)
+#define TIMESYNC_PPS 1
+#include <zephyr/drivers/gpio.h>
+#endif
+
+LOG_MODULE_REGISTER(ir_timesync, LOG_LEVEL_INF);
+
+static struct {
+  struct k_spinlock lock; // 秒脉冲中断与设置者之间
+  int64_t offset_us;      // 同步时间 - 本机运行时间
+  ir_timesync_stats_t stats;
+} sync_state;
+
+uint64_t ir_timesync_local_us(void) {
+  return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+uint64_t ir_timesync_now_us(void) {
+  k_spinlock_key_t key = k_spin_lock(&sync_state.lock);
+  int64_t offset = sync_state.offset_us;
+  k_spin_unlock(&sync_state.lock, key);
+
+  return ir_timesync_local_us() + offset;
+}
+
+void ir_timesync_set_at(uint64_t sync_us, uint64_t local_us) {
+  k_spinlock_key_t key = k_spin_lock(&sync_state.lock);
+  sync_state.offset_us = (int64_t)(sync_us - local_us);
+  sync_state.stats.synced = true;
+  sync_state.stats.sets++;
+  k_spin_unlock(&sync_state.lock, key);
+}
+
+void ir_timesync_set(uint64_t sync_us) {
+  ir_timesync_set_at(sync_us, ir_timesync_local_us());
+}
+
+uint64_t ir_timesync_to_local_us(uint64_t sync_us) {
+  k_spinlock_key_t key = k_spin_lock(&sync_state.lock);
+  int64_t local = (int64_t)sync_us - sync_state.offset_us;
+  k_spin_unlock(&sync_state.lock, key);
+
+  return local > 0 ? local : 0;
+}
+
+void ir_timesync_get_stats(ir_timesync_stats_t *stats) {
+  k_spinlock_key_t key = k_spin_lock(&sync_state.lock);
+  *stats = sync_state.stats;
+  k_spin_unlock(&sync_state.lock, key);
+}
+
+#ifdef TIMESYNC_PPS
+static const struct gpio_dt_spec pps_gpio =
+    GPIO_DT_SPEC_GET(DT_PATH(zephyr_user), ir_pps_gpios);
+static struct gpio_callback pps_cb;
+
+/* 秒脉冲上升沿 - 同步时间对齐到最近的整秒 */
+static void pps_handler(const struct device *dev, struct gpio_callback *cb,
+                        uint32_t pins) {
+  uint64_t local = ir_timesync_local_us();
+
+  k_spinlock_key_t key = k_spin_lock(&sync_state.lock);
+  uint64_t now = local + sync_state.offset_us;
+  uint64_t second = (now + IR_TIMESYNC_PPS_PERIOD_US / 2) /
+                    IR_TIMESYNC_PPS_PERIOD_US * IR_TIMESYNC_PPS_PERIOD_US;
+  int32_t step = (int32_t)(second - now);
+
+  sync_state.offset_us += step;
+  sync_state.stats.synced = true;
+  sync_state.stats.pulses++;
+  sync_state.stats.last_step_us = step;
+  if ((uint32_t)abs(step) > sync_state.stats.max_step_us) {
+    sync_state.stats.max_step_us = abs(step);
+  }
+  k_spin_unlock(&sync_state.lock, key);
+}
+
+int ir_timesync_init(void) {
+  if (!gpio_is_ready_dt(&pps_gpio)) {
+    LOG_ERR("PPS GPIO device not ready");
+    return -ENODEV;
+  }
+
+  int ret = gpio_pin_configure_dt(&pps_gpio, GPIO_INPUT);
+  if (ret == 0) {
+    gpio_init_callback(&pps_cb, pps_handler, BIT(pps_gpio.pin));
+    ret = gpio_add_callback_dt(&pps_gpio, &pps_cb);
+  }
+  if (ret == 0) {
+    ret = gpio_pin_interrupt_configure_dt(&pps_gpio, GPIO_INT_EDGE_TO_ACTIVE);
+  }
+  if (ret < 0) {
+    LOG_ERR("PPS input setup failed: %d", ret);
+    return ret;
+  }
+
+  LOG_INF("PPS timebase on pin %u", pps_gpio.pin);
+  return 0;
+}
+#else
+int ir_timesync_init(void) { return 0; }
+#endif
@@ -0,0 +1,151 @@
+/**
+ * @file ir_trace.c
+ * @brief 收发流水线时延跟踪实现
+ */
+
+#include "ir_trace.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+
+static const char *const stage_names[IR_TRACE_KINDS][IR_TRACE_STAGES] = {
+    [IR_TRACE_RX] = {"capture", "frame_end", "decode_start", "decode_end",
+                     "dispatch"},
+    [IR_TRACE_TX] = {"command", "lookup", "encode", "tx_start", "tx_end"},
+};
+
+/* 总时延的终点 - 接收到回调返回，发送到开始发射(命令到发光) */
+static const int total_stage[IR_TRACE_KINDS] = {
+    [IR_TRACE_RX] = IR_TRACE_RX_DISPATCH,
+    [IR_TRACE_TX] = IR_TRACE_TX_START,
+};
+
+/* 记录环和直方图 - 提交来自解码线程和TX线程 */
+static struct {
+  struct k_spinlock lock;
+  ir_trace_record_t ring[IR_TRACE_RECORDS];
+  uint32_t head; // 下一条写入位置
+  uint32_t count;
+  ir_trace_hist_t hist[IR_TRACE_KINDS][IR_TRACE_STAGES];
+} trace_state;
+
+uint64_t ir_trace_now_us(void) {
+  return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+void ir_trace_begin(ir_trace_record_t *rec, ir_trace_kind_t kind,
+                    uint8_t channel, uint16_t protocol, uint64_t t0_us) {
+  rec->t0_us = t0_us;
+  rec->kind = kind;
+  rec->channel = channel;
+  rec->protocol = protocol;
+  rec->at_us[0] = 0;
+  for (int s = 1; s < IR_TRACE_STAGES; s++) {
+    rec->at_us[s] = IR_TRACE_UNSET;
+  }
+}
+
+void ir_trace_mark(ir_trace_record_t *rec, int stage) {
+  if (rec->kind == IR_TRACE_NONE || stage <= 0 || stage >= IR_TRACE_STAGES) {
+    return;
+  }
+
+  uint64_t now = ir_trace_now_us();
+
+  /* 硬件时间戳可能晚于刚换算出的tick时刻不到一个tick */
+  rec->at_us[stage] = now > rec->t0_us ? (uint32_t)(now - rec->t0_us) : 0;
+}
+
+static uint32_t hist_bin(uint32_t us) {
+  if (us < BIT(IR_TRACE_HIST_MIN_SHIFT)) {
+    return 0;
+  }
+
+  uint32_t bin = 31 - __builtin_clz(us) - (IR_TRACE_HIST_MIN_SHIFT - 1);
+  return MIN(bin, IR_TRACE_HIST_BINS - 1);
+}
+
+static void hist_add(ir_trace_hist_t *hist, uint32_t us) {
+  hist->count++;
+  hist->sum_us += us;
+  hist->max_us = MAX(hist->max_us, us);
+  hist->bins[hist_bin(us)]++;
+}
+
+void ir_trace_commit(ir_trace_record_t *rec) {
+  if (rec->kind == IR_TRACE_NONE || rec->kind >= IR_TRACE_KINDS) {
+    return;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&trace_state.lock);
+  ir_trace_hist_t *hist = trace_state.hist[rec->kind];
+  uint32_t prev = 0;
+
+  for (int s = 1; s < IR_TRACE_STAGES; s++) {
+    uint32_t at = rec->at_us[s];
+
+    if (at == IR_TRACE_UNSET) {
+      continue;
+    }
+    /* 阶段在不同线程中标记，单调性按记录顺序兜底 */
+    hist_add(&hist[s], at > prev ? at - prev : 0);
+    prev = MAX(at, prev);
+  }
+  if (rec->at_us[total_stage[rec->kind]] != IR_TRACE_UNSET) {
+    hist_add(&hist[0], rec->at_us[total_stage[rec->kind]]);
+  }
+
+  trace_state.ring[trace_state.head] = *rec;
+  trace_state.head = (trace_state.head + 1) % IR_TRACE_RECORDS;
+  trace_state.count = MIN(trace_state.count + 1, IR_TRACE_RECORDS);
+  k_spin_unlock(&trace_state.lock, key);
+
+  rec->kind = IR_TRACE_NONE;
+}
+
+int ir_trace_get_hist(ir_trace_kind_t kind, int span, ir_trace_hist_t *hist) {
+  if (kind == IR_TRACE_NONE || kind >= IR_TRACE_KINDS || span < 0 ||
+      span >= IR_TRACE_STAGES || !hist) {
+    return -EINVAL;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&trace_state.lock);
+  *hist = trace_state.hist[kind][span];
+  k_spin_unlock(&trace_state.lock, key);
+  return 0;
+}
+
+size_t ir_trace_get_records(ir_trace_record_t *out, size_t max) {
+  size_t n = 0;
+
+  if (!out) {
+    return 0;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&trace_state.lock);
+  uint32_t idx = trace_state.head;
+
+  while (n < max && n < trace_state.count) {
+    idx = (idx + IR_TRACE_RECORDS - 1) % IR_TRACE_RECORDS;
+    out[n++] = trace_state.ring[idx];
+  }
+  k_spin_unlock(&trace_state.lock, key);
+  return n;
+}
+
+const char *ir_trace_stage_name(ir_trace_kind_t kind, int stage) {
+  if (kind == IR_TRACE_NONE || kind >= IR_TRACE_KINDS || stage < 0 ||
+      stage >= IR_TRACE_STAGES) {
+    return "?";
+  }
+  return stage_names[kind][stage];
+}
+
+void ir_trace_reset(void) {
+  k_spinlock_key_t key = k_spin_lock(&trace_state.lock);
+  memset(trace_state.ring, 0, sizeof(trace_state.ring));
+  memset(trace_state.hist, 0, sizeof(trace_state.hist));
+  trace_state.head = 0;
+  trace_state.count = 0;
+  k_spin_unlock(&trace_state.lock, key);
+}
@@ -0,0 +1,319 @@
+/**
+ * @file ir_tx_cache.c
+ * @brief IR发送缓存实现
+ */
+
+#include "ir_tx_cache.h"
+#include "ir_mem.h"
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(ir_tx_cache, LOG_LEVEL_INF);
+
+/* 缓存槽位 */
+typedef struct {
+  ir_tx_blob_t blob;
+  uint32_t last_use; // 最近使用时刻(LRU)
+  uint16_t refs;     // 引用数(发送中)
+  bool valid;        // 可被查找
+  bool stale;        // 已清空但仍被引用，释放引用时回收
+  bool pinned;       // 不参与LRU淘汰和清空
+} tx_cache_slot_t;
+
+static tx_cache_slot_t slots[IR_TX_CACHE_SLOTS];
+static ir_tx_cache_mode_t cache_mode = IR_TX_CACHE_LAZY;
+static ir_tx_cache_stats_t cache_stats;
+static irdb_entry_t pins[IR_TX_CACHE_PIN_MAX]; // 钉住的码值
+static size_t pin_count;
+K_MUTEX_DEFINE(tx_cache_mutex);
+
+/* 键比较 */
+static bool blob_matches(const ir_tx_blob_t *blob, const irdb_entry_t *entry) {
+  return blob->protocol == entry->protocol && blob->device == entry->device &&
+         blob->subdevice == entry->subdevice &&
+         blob->function == entry->function;
+}
+
+/* 回收槽位 (调用者持锁) */
+static void slot_release(tx_cache_slot_t *slot) {
+  if (slot->blob.timings) {
+    cache_stats.bytes -= slot->blob.timing_count * sizeof(ir_timing_t);
+    cache_stats.used--;
+    k_free(slot->blob.timings);
+  }
+  memset(slot, 0, sizeof(*slot));
+}
+
+/* 编码条目到槽位 (调用者持锁) */
+static int slot_fill(tx_cache_slot_t *slot, const irdb_entry_t *entry) {
+  const irdb_protocol_params_t *params =
+      irdb_get_protocol_params(entry->protocol);
+  if (!params || params->toggle_bit) {
+    return -ENOTSUP; // toggle位每次发送都变化，不能缓存
+  }
+
+  /* 先编码到临时缓冲区，再按实际长度保存 */
+  ir_timing_t *scratch = ir_timing_buf_alloc();
+  if (!scratch) {
+    return -ENOMEM;
+  }
+
+  uint32_t count;
+  int ret = irdb_encode_to_raw(entry, scratch, &count, IR_TX_FRAME_MAX_TIMINGS);
+  if (ret < 0) {
+    ir_timing_buf_free(scratch);
+    return ret;
+  }
+
+  ir_timing_t *timings = k_malloc(count * sizeof(ir_timing_t));
+  if (!timings) {
+    ir_timing_buf_free(scratch);
+    return -ENOMEM;
+  }
+  memcpy(timings, scratch, count * sizeof(ir_timing_t));
+  ir_timing_buf_free(scratch);
+
+  ir_tx_blob_t *blob = &slot->blob;
+  blob->protocol = entry->protocol;
+  blob->device = entry->device;
+  blob->subdevice = entry->subdevice;
+  blob->function = entry->function;
+  blob->carrier_freq = params->frequency;
+  blob->gap_us = params->gap;
+  blob->timings = timings;
+  blob->timing_count = count;
+  blob->repeat_timing_count = 0;
+  irdb_encode_repeat(entry, blob->repeat_timings, &blob->repeat_timing_count,
+                     IR_TX_REPEAT_MAX_TIMINGS);
+
+  slot->valid = true;
+  slot->stale = false;
+  slot->refs = 0;
+  slot->last_use = k_uptime_get_32();
+
+  cache_stats.used++;
+  cache_stats.bytes += count * sizeof(ir_timing_t);
+  return 0;
+}
+
+/* 选择空闲或最久未用且未被引用的槽位 (调用者持锁) */
+static tx_cache_slot_t *slot_victim(void) {
+  tx_cache_slot_t *victim = NULL;
+
+  for (int i = 0; i < IR_TX_CACHE_SLOTS; i++) {
+    tx_cache_slot_t *slot = &slots[i];
+
+    if (!slot->valid && !slot->stale) {
+      return slot;
+    }
+
+    if (slot->valid && slot->refs == 0 && !slot->pinned &&
+        (!victim || (int32_t)(slot->last_use - victim->last_use) < 0)) {
+      victim = slot;
+    }
+  }
+
+  if (victim) {
+    cache_stats.evictions++;
+    slot_release(victim);
+  }
+  return victim;
+}
+
+/* 清空槽位，all为假时保留钉住的 (调用者持锁) */
+static void slots_clear(bool all) {
+  for (int i = 0; i < IR_TX_CACHE_SLOTS; i++) {
+    if (slots[i].pinned && !all) {
+      continue;
+    }
+    if (slots[i].pinned) {
+      slots[i].pinned = false;
+      cache_stats.pinned--;
+    }
+    if (slots[i].refs > 0) {
+      slots[i].valid = false;
+      slots[i].stale = true;
+    } else if (slots[i].valid) {
+      slot_release(&slots[i]);
+    }
+  }
+}
+
+/* 查找或编码条目 (调用者持锁) */
+static tx_cache_slot_t *slot_lookup(const irdb_entry_t *entry) {
+  for (int i = 0; i < IR_TX_CACHE_SLOTS; i++) {
+    if (slots[i].valid && blob_matches(&slots[i].blob, entry)) {
+      return &slots[i];
+    }
+  }
+
+  tx_cache_slot_t *slot = slot_victim();
+  if (slot && slot_fill(slot, entry) < 0) {
+    return NULL;
+  }
+  return slot;
+}
+
+/* 按钉住集合编码并标记 (调用者持锁) */
+static size_t pins_fill(void) {
+  size_t pinned = 0;
+
+  if (cache_mode == IR_TX_CACHE_OFF) {
+    return 0;
+  }
+
+  for (size_t i = 0; i < pin_count; i++) {
+    tx_cache_slot_t *slot = slot_lookup(&pins[i]);
+
+    if (slot && !slot->pinned) {
+      slot->pinned = true;
+      cache_stats.pinned++;
+    }
+    pinned += slot != NULL;
+  }
+  return pinned;
+}
+
+/* 设置模式 */
+void ir_tx_cache_set_mode(ir_tx_cache_mode_t mode) {
+  k_mutex_lock(&tx_cache_mutex, K_FOREVER);
+  slots_clear(true);
+  cache_mode = mode;
+  pins_fill();
+  k_mutex_unlock(&tx_cache_mutex);
+}
+
+/* 获取模式 */
+ir_tx_cache_mode_t ir_tx_cache_get_mode(void) { return cache_mode; }
+
+/* 预编码 */
+int ir_tx_cache_precompile(const irdb_database_t *db) {
+  if (!db) {
+    return -EINVAL;
+  }
+
+  if (cache_mode != IR_TX_CACHE_PRECOMPILE) {
+    return 0;
+  }
+
+  k_mutex_lock(&tx_cache_mutex, K_FOREVER);
+
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < db->entry_count && count < IR_TX_CACHE_SLOTS;
+       i++) {
+    tx_cache_slot_t *slot = slot_victim();
+    if (!slot) {
+      break;
+    }
+    if (slot_fill(slot, &db->entries[i]) == 0) {
+      count++;
+    }
+  }
+
+  k_mutex_unlock(&tx_cache_mutex);
+
+  LOG_INF("Precompiled %u of %u entries", count, db->entry_count);
+  return 0;
+}
+
+/* 获取时序块 */
+const ir_tx_blob_t *ir_tx_cache_get(const irdb_entry_t *entry) {
+  if (!entry || cache_mode == IR_TX_CACHE_OFF) {
+    return NULL;
+  }
+
+  const irdb_protocol_params_t *params =
+      irdb_get_protocol_params(entry->protocol);
+  if (!params || params->toggle_bit) {
+    return NULL;
+  }
+
+  k_mutex_lock(&tx_cache_mutex, K_FOREVER);
+
+  tx_cache_slot_t *found = NULL;
+  for (int i = 0; i < IR_TX_CACHE_SLOTS; i++) {
+    if (slots[i].valid && blob_matches(&slots[i].blob, entry)) {
+      found = &slots[i];
+      break;
+    }
+  }
+
+  if (found) {
+    cache_stats.hits++;
+  } else {
+    cache_stats.misses++;
+    found = slot_victim();
+    if (found && slot_fill(found, entry) < 0) {
+      found = NULL;
+    }
+  }
+
+  if (found) {
+    found->refs++;
+    found->last_use = k_uptime_get_32();
+  }
+
+  k_mutex_unlock(&tx_cache_mutex);
+  return found ? &found->blob : NULL;
+}
+
+/* 钉住条目 */
+int ir_tx_cache_pin(const irdb_entry_t *entries, size_t count) {
+  if (!entries && count > 0) {
+    return -EINVAL;
+  }
+
+  k_mutex_lock(&tx_cache_mutex, K_FOREVER);
+
+  /* 取消之前的钉住，槽位留在缓存中按LRU淘汰 */
+  for (int i = 0; i < IR_TX_CACHE_SLOTS; i++) {
+    if (slots[i].pinned) {
+      slots[i].pinned = false;
+      cache_stats.pinned--;
+    }
+  }
+
+  pin_count = MIN(count, IR_TX_CACHE_PIN_MAX);
+  memcpy(pins, entries, pin_count * sizeof(pins[0]));
+  size_t pinned = pins_fill();
+
+  k_mutex_unlock(&tx_cache_mutex);
+  return pinned;
+}
+
+/* 释放引用 */
+void ir_tx_cache_put(const ir_tx_blob_t *blob) {
+  if (!blob) {
+    return;
+  }
+
+  tx_cache_slot_t *slot = CONTAINER_OF(blob, tx_cache_slot_t, blob);
+
+  k_mutex_lock(&tx_cache_mutex, K_FOREVER);
+  if (slot->refs > 0) {
+    slot->refs--;
+  }
+  if (slot->refs == 0 && slot->stale) {
+    slot_release(slot);
+  }
+  k_mutex_unlock(&tx_cache_mutex);
+}
+
+/* 清空缓存 */
+void ir_tx_cache_clear(void) {
+  k_mutex_lock(&tx_cache_mutex, K_FOREVER);
+  slots_clear(false);
+  k_mutex_unlock(&tx_cache_mutex);
+}
+
+/* 获取统计 */
+void ir_tx_cache_get_stats(ir_tx_cache_stats_t *stats) {
+  if (!stats) {
+    return;
+  }
+
+  k_mutex_lock(&tx_cache_mutex, K_FOREVER);
+  *stats = cache_stats;
+  k_mutex_unlock(&tx_cache_mutex);
+}
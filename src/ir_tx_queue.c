@@ -0,0 +1,1046 @@
+/**
+ * @file ir_tx_queue.c
+ * @brief IR异步发送队列实现
+ */
+
+#include "ir_tx_queue.h"
+#include "ir_event.h"
+#include "ir_hal.h"
+#include "ir_timesync.h"
+#include <string.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(ir_tx_queue, LOG_LEVEL_INF);
+
+#define TXQ_SLAB_FRAMES (IR_TX_QUEUE_DEPTH + IR_TX_INTERACTIVE_RESERVE)
+
+/* 每个优先级类别一个队列 */
+enum { TXQ_INTERACTIVE, TXQ_BULK, TXQ_COUNT };
+
+/* 帧池和队列 - 队列只传递帧指针，帧池多出的帧只给交互帧用 */
+K_MEM_SLAB_DEFINE_STATIC(tx_frame_slab, sizeof(ir_tx_frame_t),
+                         TXQ_SLAB_FRAMES, 4);
+K_MSGQ_DEFINE(tx_msgq, sizeof(ir_tx_frame_t *), TXQ_SLAB_FRAMES, 4);
+K_MSGQ_DEFINE(tx_bulk_msgq, sizeof(ir_tx_frame_t *), IR_TX_QUEUE_DEPTH, 4);
+
+/* 入队和取消时唤醒TX线程 - 空闲等待和批量任务的帧间等待共用 */
+K_SEM_DEFINE(tx_wake, 0, 1);
+
+K_THREAD_STACK_DEFINE(tx_thread_stack, IR_TX_THREAD_STACK_SIZE);
+
+static struct k_msgq *const tx_queues[TXQ_COUNT] = {&tx_msgq, &tx_bulk_msgq};
+
+/* 队列状态 */
+static struct {
+  struct k_thread thread;
+  struct k_spinlock lock;
+  ir_tx_queue_stats_t stats;
+  ir_tx_frame_t *held[TXQ_COUNT]; // 不能并入上一批的帧，下一批首先发送
+  ir_tx_frame_t *tail[TXQ_COUNT]; // 最后入队、尚未取出的帧，相同命令可并入
+  atomic_t cancel_gen;            // ir_tx_queue_cancel_bulk的调用次数
+  uint64_t next_start_us;         // 上一帧要求的下一帧最早开始时刻
+  uint32_t sense_idle_us;         // 载波侦听的静默窗口，0关闭
+  uint32_t sense_max_us;          // 载波侦听的最长推迟
+  uint32_t backoff_seed;          // 退避随机数状态
+  bool filling;                   // 正在发送填入间隔的帧，不再嵌套填充
+  bool started;
+} txq_state;
+
+static void run_batch(ir_tx_frame_t *const *batch, size_t n);
+static void send_batch(ir_tx_frame_t *const *batch, size_t n,
+                       uint32_t latency);
+
+/* 自某时刻起经过的微秒数 (32位周期计数回绕安全) */
+static uint32_t elapsed_us(uint32_t since_cycles) {
+  return k_cyc_to_us_floor32(k_cycle_get_32() - since_cycles);
+}
+
+/* 64位运行时间(us)，序列可持续数十秒，不用会回绕的周期计数 */
+static uint64_t uptime_us(void) { return ir_timesync_local_us(); }
+
+/* 绝对时刻的超时 - 内核定时器(RTC)按时刻唤醒，线程调度和此前的处理
+ * 时间不会累加到帧周期上 */
+static k_timeout_t until_timeout(uint64_t until_us) {
+  return K_TIMEOUT_ABS_TICKS(k_us_to_ticks_ceil64(until_us));
+}
+
+static void sleep_until(uint64_t until_us) {
+  if (uptime_us() < until_us) {
+    k_sleep(until_timeout(until_us));
+  }
+}
+
+/* 等待上一帧的帧间隔结束 */
+static void wait_frame_gap(void) {
+  sleep_until(txq_state.next_start_us);
+}
+
+/* 退避随机数 (xorshift32) - 以首次退避时的周期计数为种子，各发射器的
+ * 启动时刻不同，退避错开即可，不需要熵源 */
+static uint32_t backoff_random(void) {
+  uint32_t x = txq_state.backoff_seed;
+
+  if (x == 0) {
+    x = k_cycle_get_32() | 1;
+  }
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  txq_state.backoff_seed = x;
+  return x;
+}
+
+/* 载波侦听 - 接收头静默满窗口后再发送。每侦听到一次信号，等到窗口补满
+ * 后再随机退避(上限逐次加倍)，同时侦听的几个发射器不会一起开始; 总等待
+ * 达到上限仍有信号时照常发送 */
+static void carrier_sense(void) {
+  uint32_t idle_us = txq_state.sense_idle_us;
+  uint32_t max_us = txq_state.sense_max_us;
+
+  if (idle_us == 0) {
+    return;
+  }
+
+  uint32_t start = k_cycle_get_32();
+  uint32_t slot = IR_TX_SENSE_SLOT_US;
+  uint32_t backoffs = 0;
+  bool forced = false;
+
+  while (1) {
+    uint32_t idle = ir_hal_rx_idle_us();
+    if (idle >= idle_us) {
+      break;
+    }
+
+    uint32_t waited = elapsed_us(start);
+    if (waited >= max_us) {
+      forced = true;
+      break;
+    }
+
+    uint32_t wait = idle_us - idle + backoff_random() % slot;
+    k_usleep(MIN(wait, max_us - waited));
+    slot = MIN(slot * 2, IR_TX_SENSE_SLOT_MAX_US);
+    backoffs++;
+  }
+
+  if (backoffs == 0) {
+    return;
+  }
+
+  uint32_t waited = elapsed_us(start);
+  k_spinlock_key_t key = k_spin_lock(&txq_state.lock);
+  txq_state.stats.busy_deferred++;
+  txq_state.stats.busy_backoffs += backoffs;
+  if (forced) {
+    txq_state.stats.busy_forced++;
+  }
+  if (waited > txq_state.stats.busy_max_wait_us) {
+    txq_state.stats.busy_max_wait_us = waited;
+  }
+  k_spin_unlock(&txq_state.lock, key);
+}
+
+/* 记录下一帧(包括插入的交互帧)的最早开始时刻 */
+static void frame_due(uint64_t until_us) {
+  txq_state.next_start_us = until_us;
+}
+
+/* 记录一帧发完 - 下一帧在gap_us之后开始 */
+static void frame_ended(uint32_t gap_us) {
+  frame_due(uptime_us() + gap_us);
+}
+
+/* 一帧之后下一帧的开始时刻 - 帧周期从帧起点start_us算起，否则从现在
+ * (帧刚发完)算起 */
+static uint64_t frame_next(bool period, uint32_t gap_us, uint64_t start_us) {
+  return (period ? start_us : uptime_us()) + gap_us;
+}
+
+/* 释放帧及其外部时序 */
+static void frame_release(ir_tx_frame_t *frame) {
+  if (frame->release) {
+    frame->release(frame->release_ctx);
+  }
+  k_mem_slab_free(&tx_frame_slab, frame);
+}
+
+/* 时序总时长(us) */
+static uint32_t timings_duration_us(const ir_timing_t *timings,
+                                    uint32_t count) {
+  uint32_t total = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    total += ir_timing_us(timings[i]);
+  }
+  return total;
+}
+
+/* 第r次发送的时序 - 有重复码时首次之后发送重复码 */
+static ir_hal_tx_lane_t frame_lane(const ir_tx_frame_t *frame, uint32_t r) {
+  ir_hal_tx_lane_t lane = {
+      .channels = frame->channels,
+      .timings = frame->ext_timings ? frame->ext_timings : frame->timings,
+      .count = frame->timing_count,
+  };
+
+  if (r > 0 && frame->repeat_timing_count > 0) {
+    lane.timings = frame->repeat_timings;
+    lane.count = frame->repeat_timing_count;
+  }
+  return lane;
+}
+
+static bool queue_empty(int q) {
+  return !txq_state.held[q] && k_msgq_num_used_get(tx_queues[q]) == 0;
+}
+
+static bool queue_peek(int q, ir_tx_frame_t **frame) {
+  if (txq_state.held[q]) {
+    *frame = txq_state.held[q];
+    return true;
+  }
+  return k_msgq_peek(tx_queues[q], frame) == 0;
+}
+
+/* 取出的帧不再接受合并，其发送次数此后不变 */
+static bool queue_get(int q, ir_tx_frame_t **frame) {
+  if (txq_state.held[q]) {
+    *frame = txq_state.held[q];
+    txq_state.held[q] = NULL;
+    return true;
+  }
+  if (k_msgq_get(tx_queues[q], frame, K_NO_WAIT) != 0) {
+    return false;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&txq_state.lock);
+  if (txq_state.tail[q] == *frame) {
+    txq_state.tail[q] = NULL;
+  }
+  k_spin_unlock(&txq_state.lock, key);
+  return true;
+}
+
+/* 报告结果 - 并入的相同命令各得一次回调 */
+static void frame_done(const ir_tx_frame_t *frame, int result) {
+  if (!frame->callback) {
+    return;
+  }
+  for (uint32_t i = 0; i <= frame->coalesced; i++) {
+    frame->callback(result, frame->user_data);
+  }
+}
+
+/* 入队后调用了ir_tx_queue_cancel_bulk */
+static bool frame_cancelled(const ir_tx_frame_t *frame) {
+  return frame->priority == IR_TX_PRIO_BULK &&
+         frame->cancel_gen != (uint32_t)atomic_get(&txq_state.cancel_gen);
+}
+
+/* 不发送已取消的帧 - 序列交给send_sequence报告取消 */
+static bool frame_discard(ir_tx_frame_t *frame) {
+  if (frame->sequence) {
+    atomic_set_bit(&frame->sequence->busy, 1);
+    return false;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&txq_state.lock);
+  txq_state.stats.cancelled++;
+  k_spin_unlock(&txq_state.lock, key);
+
+  frame_done(frame, -ECANCELED);
+  frame_release(frame);
+  return true;
+}
+
+/* 可与批内的帧同时发送: 通道不重叠，载波、占空比和定时开始时刻相同，
+ * 序列独占发射 */
+static bool frame_joins_batch(const ir_tx_frame_t *frame,
+                              const ir_tx_frame_t *first, uint8_t channels) {
+  return !frame->sequence && !first->sequence &&
+         frame->start_at_us == first->start_at_us &&
+         (frame->channels & channels) == 0 &&
+         frame->carrier_freq == first->carrier_freq &&
+         frame->duty_cycle == first->duty_cycle;
+}
+
+/* 从队列q取出一批 - 已排队的、发往其他通道的帧并入同一批，多个发射管
+ * 同时发送。队列为空(或只有已取消的帧)时返回0 */
+static size_t queue_batch(int q, ir_tx_frame_t **batch) {
+  ir_tx_frame_t *next;
+  uint8_t channels = 0;
+  size_t n = 0;
+
+  while (n < IR_HAL_TX_CHANNELS && queue_get(q, &next)) {
+    if (frame_cancelled(next) && frame_discard(next)) {
+      continue;
+    }
+    if (n > 0 && !frame_joins_batch(next, batch[0], channels)) {
+      txq_state.held[q] = next;
+      break;
+    }
+    channels |= next->channels;
+    batch[n++] = next;
+  }
+  return n;
+}
+
+/* 目标已知且不是间隔所属的任何设备 - 所属设备未知时不填充 */
+static bool target_free(uint32_t target, const uint32_t *busy, size_t n) {
+  if (target == 0) {
+    return false;
+  }
+  for (size_t i = 0; i < n; i++) {
+    if (busy[i] == 0 || busy[i] == target) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* 时长duration_us的发送连同前后保护间隔能在until_us之前结束 */
+static bool gap_fits(uint32_t duration_us, uint64_t until_us) {
+  return IR_TX_GAP_FILL_GUARD_US > 0 &&
+         uptime_us() + 2 * IR_TX_GAP_FILL_GUARD_US + duration_us <= until_us;
+}
+
+static void gap_filled(uint32_t n) {
+  k_spinlock_key_t key = k_spin_lock(&txq_state.lock);
+  txq_state.stats.gap_filled += n;
+  k_spin_unlock(&txq_state.lock, key);
+}
+
+/* 在busy设备的重复间隔(或序列的步间延时，n_busy为0)中发送其他设备的
+ * 排队单帧，until_us前结束。只取单帧，填入的发送不再嵌套等待。返回填入
+ * 的帧数 */
+static int gap_fill(const uint32_t *busy, size_t n_busy, uint64_t until_us) {
+  ir_tx_frame_t *frame;
+  int filled = 0;
+
+  if (txq_state.filling) {
+    return 0;
+  }
+  txq_state.filling = true;
+
+  for (int q = 0; q < TXQ_COUNT; q++) {
+    while (queue_peek(q, &frame) && !frame->sequence && frame->repeat == 1 &&
+           target_free(frame->target, busy, n_busy)) {
+      ir_hal_tx_lane_t lane = frame_lane(frame, 0);
+
+      if (!gap_fits(timings_duration_us(lane.timings, lane.count),
+                    until_us)) {
+        break;
+      }
+      queue_get(q, &frame);
+      if (frame_cancelled(frame) && frame_discard(frame)) {
+        continue;
+      }
+      if (frame->repeat != 1) {
+        txq_state.held[q] = frame; // 取出前并入了相同命令
+        break;
+      }
+
+      frame_ended(IR_TX_GAP_FILL_GUARD_US);
+      wait_frame_gap();
+      send_batch(&frame, 1, elapsed_us(frame->submit_cycles));
+      frame_release(frame);
+      frame_ended(IR_TX_GAP_FILL_GUARD_US);
+      filled++;
+    }
+  }
+
+  txq_state.filling = false;
+  if (filled > 0) {
+    gap_filled(filled);
+  }
+  return filled;
+}
+
+/* 在批量任务的帧边界发送已排队的全部交互帧 */
+static void txq_preempt(void) {
+  ir_tx_frame_t *batch[IR_HAL_TX_CHANNELS];
+  size_t n;
+
+  while ((n = queue_batch(TXQ_INTERACTIVE, batch)) > 0) {
+    run_batch(batch, n);
+
+    k_spinlock_key_t key = k_spin_lock(&txq_state.lock);
+    txq_state.stats.preempted++;
+    k_spin_unlock(&txq_state.lock, key);
+  }
+
+  /* 批量任务的下一帧同样要等交互帧的帧间隔 */
+  wait_frame_gap();
+}
+
+/* 批量任务等到until_us时刻 - 期间到达的交互帧先插入发送，放得下的
+ * 其他设备的排队帧填入空闲。被取消返回-ECANCELED，插入过帧返回1(之后
+ * 接着发的重复码要换回完整帧) */
+static int bulk_wait(uint32_t gen, const ir_tx_sequence_t *seq,
+                     const uint32_t *busy, size_t n_busy, uint64_t until_us) {
+  int ret = 0;
+
+  while (gen == (uint32_t)atomic_get(&txq_state.cancel_gen) &&
+         !(seq && atomic_test_bit(&seq->busy, 1))) {
+    if (!queue_empty(TXQ_INTERACTIVE)) {
+      txq_preempt();
+      ret = 1;
+      continue;
+    }
+    if (gap_fill(busy, n_busy, until_us) > 0) {
+      ret = 1;
+      continue;
+    }
+
+    uint64_t now = uptime_us();
+    if (now >= until_us) {
+      return ret;
+    }
+    k_sem_take(&tx_wake, until_timeout(until_us));
+  }
+  return -ECANCELED;
+}
+
+/* 发送一批帧 (含重复) - 各帧在自己的通道上同时发送，第r轮发送所有尚未
+ * 发完的帧，下一轮在各帧下一次开始时刻的最晚者开始: 帧周期从本轮起点
+ * 算起，其余从本轮发完算起。批量帧在轮间让交互帧插入 */
+static int transmit_batch(ir_tx_frame_t *const *batch, size_t n) {
+  ir_hal_tx_lane_t lanes[IR_HAL_TX_CHANNELS];
+  uint32_t busy[IR_HAL_TX_CHANNELS];
+  bool bulk = batch[0]->priority == IR_TX_PRIO_BULK;
+  uint32_t rounds = 0;
+  uint32_t first = 0; // 插入交互帧后从完整帧重新开始的轮次
+  uint64_t last_due = 0;
+  int ret = 0;
+
+  for (size_t f = 0; f < n; f++) {
+    rounds = MAX(rounds, batch[f]->repeat);
+    busy[f] = batch[f]->target;
+  }
+
+  for (uint32_t r = 0; r < rounds; r++) {
+    uint64_t start = uptime_us();
+    uint64_t until = 0;
+    size_t active = 0;
+
+    for (size_t f = 0; f < n; f++) {
+      if (r < batch[f]->repeat) {
+        lanes[active++] = frame_lane(batch[f], r - first);
+      }
+    }
+
+    ret = ir_hal_tx_lanes(lanes, active, batch[0]->carrier_freq,
+                          batch[0]->duty_cycle);
+    if (ret < 0) {
+      break;
+    }
+
+    for (size_t f = 0; f < n; f++) {
+      const ir_tx_frame_t *frame = batch[f];
+
+      if (r >= frame->repeat) {
+        continue;
+      }
+      uint64_t due = frame_next(frame->period, frame->gap_us, start);
+      last_due = MAX(last_due, due);
+      if (r < frame->repeat - 1 && frame->gap_us > 0) {
+        until = MAX(until, due);
+      }
+    }
+    if (r == rounds - 1) {
+      break;
+    }
+
+    if (bulk) {
+      frame_due(until);
+      int wait = bulk_wait(batch[0]->cancel_gen, NULL, busy, n, until);
+      if (wait < 0) {
+        ret = wait;
+        break;
+      }
+      if (wait > 0) {
+        first = r + 1;
+      }
+    } else if (until > 0) {
+      if (gap_fill(busy, n, until) > 0) {
+        first = r + 1;
+      }
+      sleep_until(until);
+    }
+  }
+
+  frame_due(MAX(last_due, txq_state.next_start_us));
+  return ret;
+}
+
+/* 第r次发送的时序 */
+static ir_hal_tx_lane_t step_lane(const ir_tx_step_t *step, uint32_t r) {
+  ir_hal_tx_lane_t lane = {
+      .channels = step->channels,
+      .timings = step->timings,
+      .count = step->timing_count,
+  };
+
+  if (r > 0 && step->repeat_timing_count > 0) {
+    lane.timings = step->repeat_timings;
+    lane.count = step->repeat_timing_count;
+  }
+  return lane;
+}
+
+/* 一步的发送时长 - 与transmit_step的间隔计算一致 */
+uint32_t ir_tx_step_duration_us(const ir_tx_step_t *step) {
+  uint32_t total = 0;
+
+  for (uint32_t r = 0; r < step->repeat; r++) {
+    ir_hal_tx_lane_t lane = step_lane(step, r);
+    uint32_t airtime = timings_duration_us(lane.timings, lane.count);
+
+    if (r == step->repeat - 1) {
+      total += airtime;
+    } else if (step->period) {
+      total += MAX(airtime, step->gap_us);
+    } else {
+      total += airtime + step->gap_us;
+    }
+  }
+  return total;
+}
+
+/* 发送序列的一步 (含重复)，重复间隔内可被取消和插入交互帧。next为可
+ * 提前的下一步(本步delay_us为0)，放得进重复间隔时在其中发送并置
+ * *next_sent */
+static int transmit_step(const ir_tx_frame_t *carrier,
+                         const ir_tx_step_t *step, const ir_tx_step_t *next,
+                         bool *next_sent) {
+  uint32_t first = 0;
+
+  for (uint32_t r = 0; r < step->repeat; r++) {
+    ir_hal_tx_lane_t lane = step_lane(step, r - first);
+    uint64_t frame_start = uptime_us();
+
+    int ret = ir_hal_tx_lanes(&lane, 1, step->carrier_freq, step->duty_cycle);
+    if (ret < 0) {
+      return ret;
+    }
+
+    /* 帧周期按帧起点的绝对时刻排定，最后一帧同样约束下一步 */
+    uint64_t until = frame_next(step->period, step->gap_us, frame_start);
+    frame_due(until);
+
+    if (r < step->repeat - 1 && step->gap_us > 0) {
+      if (next && !*next_sent && target_free(next->target, &step->target, 1) &&
+          gap_fits(ir_tx_step_duration_us(next), until)) {
+        frame_ended(IR_TX_GAP_FILL_GUARD_US);
+        wait_frame_gap();
+        ret = transmit_step(carrier, next, NULL, NULL);
+        if (ret < 0) {
+          return ret;
+        }
+        frame_ended(IR_TX_GAP_FILL_GUARD_US);
+        *next_sent = true;
+        first = r + 1;
+        gap_filled(1);
+      }
+
+      int wait = bulk_wait(carrier->cancel_gen, carrier->sequence,
+                           &step->target, 1, until);
+      if (wait < 0) {
+        return wait;
+      }
+      if (wait > 0) {
+        first = r + 1;
+      }
+    }
+  }
+  return 0;
+}
+
+/* 执行序列 - 每步在计划时刻开始: 前一步的计划开始 + 发送时长 + 延时。
+ * 插入的交互帧不推后计划，只体现为之后各步的迟到; 提前插入上一步重复
+ * 间隔的步不计发送时长，之后各步相应提前 */
+static void transmit_sequence(const ir_tx_frame_t *carrier,
+                              uint32_t latency) {
+  ir_tx_sequence_t *seq = carrier->sequence;
+  ir_tx_sequence_report_t *report = &seq->report;
+
+  memset(report, 0, sizeof(*report));
+  report->latency_us = latency;
+  for (uint32_t i = 0; i < seq->step_count; i++) {
+    report->planned_us += ir_tx_step_duration_us(&seq->steps[i]);
+    if (i < seq->step_count - 1) {
+      report->planned_us += seq->steps[i].delay_us;
+    }
+  }
+
+  uint64_t start = uptime_us();
+  uint64_t planned = start;
+
+  for (uint32_t i = 0; i < seq->step_count; i++) {
+    const ir_tx_step_t *step = &seq->steps[i];
+
+    if (bulk_wait(carrier->cancel_gen, seq, NULL, 0, planned) < 0) {
+      report->result = -ECANCELED;
+      break;
+    }
+
+    carrier_sense();
+
+    uint64_t now = uptime_us();
+    if (now > planned) {
+      report->max_late_us = MAX(report->max_late_us, (uint32_t)(now - planned));
+    }
+
+    const ir_tx_step_t *next = NULL;
+    bool next_sent = false;
+
+    if (i + 1 < seq->step_count && step->delay_us == 0) {
+      next = &seq->steps[i + 1];
+    }
+    report->result = transmit_step(carrier, step, next, &next_sent);
+    if (report->result < 0) {
+      break;
+    }
+    report->steps_sent++;
+    planned += ir_tx_step_duration_us(step) + step->delay_us;
+
+    if (next_sent) {
+      report->steps_sent++;
+      planned += next->delay_us;
+      i++;
+    }
+  }
+  report->elapsed_us = uptime_us() - start;
+}
+
+/* 发送序列并更新统计 */
+static void send_sequence(const ir_tx_frame_t *carrier, uint32_t latency) {
+  ir_tx_sequence_t *seq = carrier->sequence;
+
+  transmit_sequence(carrier, latency);
+
+  const ir_tx_sequence_report_t *report = &seq->report;
+  k_spinlock_key_t key = k_spin_lock(&txq_state.lock);
+  txq_state.stats.last_latency_us = latency;
+  if (latency > txq_state.stats.max_latency_us) {
+    txq_state.stats.max_latency_us = latency;
+  }
+  txq_state.stats.sent += report->steps_sent;
+  txq_state.stats.sequences++;
+  if (report->result == -ECANCELED) {
+    txq_state.stats.cancelled++;
+  } else if (report->result < 0) {
+    txq_state.stats.failed++;
+  }
+  k_spin_unlock(&txq_state.lock, key);
+
+  if (report->result < 0 && report->result != -ECANCELED) {
+    LOG_ERR("TX sequence failed at step %u: %d", report->steps_sent,
+            report->result);
+  }
+
+  /* 先清除busy，回调中可以再次提交同一序列 */
+  atomic_clear_bit(&seq->busy, 1);
+  atomic_clear_bit(&seq->busy, 0);
+  if (seq->callback) {
+    seq->callback(seq, seq->user_data);
+  }
+}
+
+/* 发送一批帧并更新统计 */
+static void send_batch(ir_tx_frame_t *const *batch, size_t n,
+                       uint32_t latency) {
+  for (size_t f = 0; f < n; f++) {
+    ir_trace_mark(&batch[f]->trace, IR_TRACE_TX_START);
+  }
+
+  int ret = transmit_batch(batch, n);
+
+  for (size_t f = 0; f < n; f++) {
+    ir_trace_mark(&batch[f]->trace, IR_TRACE_TX_END);
+    ir_trace_commit(&batch[f]->trace);
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&txq_state.lock);
+  txq_state.stats.last_latency_us = latency;
+  if (latency > txq_state.stats.max_latency_us) {
+    txq_state.stats.max_latency_us = latency;
+  }
+  if (ret == 0) {
+    txq_state.stats.sent += n;
+  } else if (ret == -ECANCELED) {
+    txq_state.stats.cancelled += n;
+  } else {
+    txq_state.stats.failed += n;
+  }
+  if (n > 1) {
+    txq_state.stats.parallel += n;
+  }
+  k_spin_unlock(&txq_state.lock, key);
+
+  if (ret < 0 && ret != -ECANCELED) {
+    LOG_ERR("TX frame failed: %d", ret);
+  }
+
+  for (size_t f = 0; f < n; f++) {
+    frame_done(batch[f], ret);
+  }
+}
+
+/* 定时帧等到开始时刻 - 批量帧期间让交互帧插入，放得下的其他排队单帧
+ * 填入; 睡到时刻前的最后一个节拍，余下的忙等。被取消返回-ECANCELED */
+static int timed_wait(ir_tx_frame_t *const *batch, size_t n) {
+  uint64_t at = ir_timesync_to_local_us(batch[0]->start_at_us);
+  uint64_t tick_us = k_ticks_to_us_floor64(k_us_to_ticks_floor64(at));
+  uint32_t busy[IR_HAL_TX_CHANNELS];
+
+  for (size_t f = 0; f < n; f++) {
+    busy[f] = batch[f]->target;
+  }
+
+  if (batch[0]->priority == IR_TX_PRIO_BULK) {
+    if (bulk_wait(batch[0]->cancel_gen, NULL, busy, n, tick_us) < 0) {
+      return -ECANCELED;
+    }
+  } else {
+    gap_fill(busy, n, tick_us);
+  }
+  sleep_until(tick_us);
+
+  uint64_t now = uptime_us();
+  uint32_t late = now > at ? now - at : 0;
+
+  if (now < at) {
+    k_busy_wait(at - now);
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&txq_state.lock);
+  txq_state.stats.timed++;
+  if (late > 0) {
+    txq_state.stats.timed_late++;
+    txq_state.stats.timed_max_late_us =
+        MAX(txq_state.stats.timed_max_late_us, late);
+  }
+  k_spin_unlock(&txq_state.lock, key);
+  return 0;
+}
+
+/* 定时帧未发送即取消 */
+static void timed_cancel(ir_tx_frame_t *const *batch, size_t n) {
+  k_spinlock_key_t key = k_spin_lock(&txq_state.lock);
+  txq_state.stats.cancelled += n;
+  k_spin_unlock(&txq_state.lock, key);
+
+  for (size_t f = 0; f < n; f++) {
+    frame_done(batch[f], -ECANCELED);
+  }
+}
+
+/* 发送一批并释放 */
+static void run_batch(ir_tx_frame_t *const *batch, size_t n) {
+  wait_frame_gap();
+
+  /* 序列在每步开始前侦听 */
+  if (batch[0]->sequence) {
+    send_sequence(batch[0], elapsed_us(batch[0]->submit_cycles));
+  } else if (batch[0]->start_at_us == 0) {
+    carrier_sense();
+    send_batch(batch, n, elapsed_us(batch[0]->submit_cycles));
+  } else if (timed_wait(batch, n) == 0) {
+    send_batch(batch, n, elapsed_us(batch[0]->submit_cycles));
+  } else {
+    timed_cancel(batch, n);
+  }
+
+  for (size_t f = 0; f < n; f++) {
+    frame_release(batch[f]);
+  }
+}
+
+/* TX线程 - 交互帧先于批量任务，各类别内按顺序发送 */
+static void tx_thread_entry(void *p1, void *p2, void *p3) {
+  ir_tx_frame_t *batch[IR_HAL_TX_CHANNELS];
+  bool powered = false;
+
+  while (1) {
+    int q = queue_empty(TXQ_INTERACTIVE) ? TXQ_BULK : TXQ_INTERACTIVE;
+
+    /* 首帧上电，队列排空后挂起，连续的帧之间保持HFXO运行 */
+    if (queue_empty(q)) {
+      if (powered) {
+        ir_hal_tx_power_put();
+        powered = false;
+      }
+      k_sem_take(&tx_wake, K_FOREVER);
+      continue;
+    }
+
+    size_t n = queue_batch(q, batch);
+    if (n == 0) {
+      continue;
+    }
+
+    if (!powered) {
+      ir_hal_tx_power_get();
+      powered = true;
+    }
+    run_batch(batch, n);
+  }
+}
+
+/* 初始化 */
+int ir_tx_queue_init(void) {
+  if (txq_state.started) {
+    return 0;
+  }
+
+  memset(&txq_state.stats, 0, sizeof(txq_state.stats));
+  txq_state.next_start_us = 0;
+  ir_timesync_init();
+  ir_tx_queue_set_sense(IR_TX_SENSE_IDLE_US, IR_TX_SENSE_MAX_MS);
+
+  k_thread_create(&txq_state.thread, tx_thread_stack,
+                  K_THREAD_STACK_SIZEOF(tx_thread_stack), tx_thread_entry,
+                  NULL, NULL, NULL, K_PRIO_PREEMPT(IR_TX_THREAD_PRIORITY), 0,
+                  K_NO_WAIT);
+  k_thread_name_set(&txq_state.thread, "ir_tx");
+
+  txq_state.started = true;
+  LOG_INF("TX queue initialized (depth %u)", IR_TX_QUEUE_DEPTH);
+  return 0;
+}
+
+/* 申请帧 */
+ir_tx_frame_t *ir_tx_frame_alloc(void) {
+  void *block;
+
+  if (k_mem_slab_alloc(&tx_frame_slab, &block, K_NO_WAIT) < 0) {
+    k_spinlock_key_t key = k_spin_lock(&txq_state.lock);
+    txq_state.stats.dropped++;
+    k_spin_unlock(&txq_state.lock, key);
+    return NULL;
+  }
+
+  ir_tx_frame_t *frame = block;
+  frame->callback = NULL;
+  frame->user_data = NULL;
+  frame->repeat = 1;
+  frame->priority = IR_TX_PRIO_AUTO;
+  frame->target = 0;
+  frame->start_at_us = 0;
+  frame->coalesced = 0;
+  frame->channels = IR_HAL_TX_CH_DEFAULT;
+  frame->duty_cycle = 0;
+  frame->gap_us = 0;
+  frame->period = false;
+  frame->timing_count = 0;
+  frame->repeat_timing_count = 0;
+  frame->ext_timings = NULL;
+  frame->release = NULL;
+  frame->release_ctx = NULL;
+  frame->sequence = NULL;
+  frame->trace.kind = IR_TRACE_NONE;
+  return frame;
+}
+
+/* 释放帧 */
+void ir_tx_frame_free(ir_tx_frame_t *frame) {
+  if (frame) {
+    frame_release(frame);
+  }
+}
+
+static uint32_t queue_depth(void) {
+  return k_msgq_num_used_get(&tx_msgq) + k_msgq_num_used_get(&tx_bulk_msgq);
+}
+
+static bool timings_equal(const ir_timing_t *a, const ir_timing_t *b,
+                          uint32_t count) {
+  return a == b || memcmp(a, b, count * sizeof(*a)) == 0;
+}
+
+/* frame与队尾帧tail是同一条命令，并入后发送次数不超过上限 */
+static bool frame_coalesces(const ir_tx_frame_t *frame,
+                            const ir_tx_frame_t *tail) {
+  if (frame->target == 0 || frame->target != tail->target ||
+      frame->sequence || tail->sequence || frame->start_at_us > 0 ||
+      tail->start_at_us > 0 || frame->priority != tail->priority ||
+      frame->cancel_gen != tail->cancel_gen ||
+      frame->channels != tail->channels ||
+      frame->carrier_freq != tail->carrier_freq ||
+      frame->duty_cycle != tail->duty_cycle ||
+      frame->gap_us != tail->gap_us || frame->period != tail->period ||
+      frame->callback != tail->callback ||
+      frame->user_data != tail->user_data ||
+      tail->repeat + frame->repeat > IR_TX_COALESCE_MAX) {
+    return false;
+  }
+
+  ir_hal_tx_lane_t a = frame_lane(frame, 0);
+  ir_hal_tx_lane_t b = frame_lane(tail, 0);
+
+  return a.count == b.count && timings_equal(a.timings, b.timings, a.count) &&
+         frame->repeat_timing_count == tail->repeat_timing_count &&
+         timings_equal(frame->repeat_timings, tail->repeat_timings,
+                       frame->repeat_timing_count);
+}
+
+/* 入队 - 失败时释放帧。与队尾的相同命令合并时只加发送次数并释放本帧;
+ * 入队与记下队尾在同一临界区内，并发的提交者不会合并到非相邻的帧 */
+static int queue_put(ir_tx_frame_t *frame) {
+  if (!txq_state.started) {
+    frame_release(frame);
+    return -EAGAIN;
+  }
+
+  frame->submit_cycles = k_cycle_get_32();
+  frame->cancel_gen = atomic_get(&txq_state.cancel_gen);
+
+  int q = frame->priority != IR_TX_PRIO_BULK ? TXQ_INTERACTIVE : TXQ_BULK;
+  ir_tx_frame_t *tail;
+  bool merged = false;
+  int ret = -ENOMSG;
+
+  k_spinlock_key_t key = k_spin_lock(&txq_state.lock);
+  tail = txq_state.tail[q];
+  if (tail && frame_coalesces(frame, tail)) {
+    tail->repeat += frame->repeat;
+    tail->coalesced++;
+    txq_state.stats.coalesced++;
+    merged = true;
+    ret = 0;
+  } else if (q == TXQ_INTERACTIVE ||
+             k_mem_slab_num_free_get(&tx_frame_slab) >=
+                 IR_TX_INTERACTIVE_RESERVE) {
+    /* 批量任务不占用留给交互帧的空闲帧 */
+    ret = k_msgq_put(tx_queues[q], &frame, K_NO_WAIT);
+    if (ret == 0) {
+      txq_state.tail[q] = frame;
+    }
+  }
+
+  if (ret < 0) {
+    txq_state.stats.dropped++;
+  } else {
+    uint32_t depth = queue_depth();
+    txq_state.stats.submitted++;
+    if (depth > txq_state.stats.max_depth) {
+      txq_state.stats.max_depth = depth;
+    }
+  }
+  k_spin_unlock(&txq_state.lock, key);
+
+  if (ret < 0) {
+    ir_event_emit(IR_EVENT_TX_DROPPED, frame->channels, queue_depth(), 0);
+    frame_release(frame);
+    return -ENOBUFS;
+  }
+  if (merged) {
+    frame_release(frame);
+    return 0;
+  }
+
+  k_sem_give(&tx_wake);
+  return 0;
+}
+
+/* 提交帧 */
+int ir_tx_queue_submit(ir_tx_frame_t *frame) {
+  if (!frame) {
+    return -EINVAL;
+  }
+
+  if (frame->timing_count == 0 || frame->repeat == 0 ||
+      frame->channels == 0 || (frame->channels & ~IR_HAL_TX_CH_ALL)) {
+    frame_release(frame);
+    return -EINVAL;
+  }
+
+  if (frame->priority == IR_TX_PRIO_AUTO) {
+    frame->priority = frame->repeat > IR_TX_BULK_REPEAT
+                          ? IR_TX_PRIO_BULK
+                          : IR_TX_PRIO_INTERACTIVE;
+  }
+  return queue_put(frame);
+}
+
+/* 提交序列 - 以一个载体帧入队 */
+int ir_tx_queue_submit_sequence(ir_tx_sequence_t *seq) {
+  if (!seq || !seq->steps || seq->step_count == 0) {
+    return -EINVAL;
+  }
+
+  for (uint32_t i = 0; i < seq->step_count; i++) {
+    const ir_tx_step_t *step = &seq->steps[i];
+
+    if (!step->timings || step->timing_count == 0 || step->repeat == 0 ||
+        step->channels == 0 || (step->channels & ~IR_HAL_TX_CH_ALL)) {
+      return -EINVAL;
+    }
+  }
+
+  if (atomic_test_and_set_bit(&seq->busy, 0)) {
+    return -EBUSY;
+  }
+  atomic_clear_bit(&seq->busy, 1);
+
+  ir_tx_frame_t *frame = ir_tx_frame_alloc();
+  if (!frame) {
+    atomic_clear_bit(&seq->busy, 0);
+    return -ENOBUFS;
+  }
+  frame->sequence = seq;
+  frame->priority = IR_TX_PRIO_BULK;
+
+  int ret = queue_put(frame);
+  if (ret < 0) {
+    atomic_clear_bit(&seq->busy, 0);
+  }
+  return ret;
+}
+
+/* 取消序列 */
+int ir_tx_sequence_cancel(ir_tx_sequence_t *seq) {
+  if (!seq) {
+    return -EINVAL;
+  }
+
+  if (!atomic_test_bit(&seq->busy, 0)) {
+    return -EALREADY;
+  }
+
+  atomic_set_bit(&seq->busy, 1);
+  k_sem_give(&tx_wake);
+  return 0;
+}
+
+/* 取消批量任务 - 入队时记下的取消次数与当前不同即视为已取消 */
+void ir_tx_queue_cancel_bulk(void) {
+  atomic_inc(&txq_state.cancel_gen);
+  k_sem_give(&tx_wake);
+}
+
+/* 载波侦听参数 - 下一批次起生效 */
+void ir_tx_queue_set_sense(uint32_t idle_us, uint32_t max_ms) {
+  txq_state.sense_idle_us = idle_us;
+  txq_state.sense_max_us = CLAMP(max_ms, 1, 60000) * USEC_PER_MSEC;
+}
+
+void ir_tx_queue_get_sense(uint32_t *idle_us, uint32_t *max_ms) {
+  *idle_us = txq_state.sense_idle_us;
+  *max_ms = txq_state.sense_max_us / USEC_PER_MSEC;
+}
+
+/* 获取统计 */
+void ir_tx_queue_get_stats(ir_tx_queue_stats_t *stats) {
+  if (!stats) {
+    return;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&txq_state.lock);
+  *stats = txq_state.stats;
+  k_spin_unlock(&txq_state.lock, key);
+
+  stats->depth = queue_depth();
+}
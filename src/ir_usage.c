@@ -0,0 +1,433 @@
+/**
+ * @file ir_usage.c
+ * @brief 使用统计实现 - space-saving计数表，定期保存到LittleFS
+ */
+
+#include "ir_usage.h"
+#include "ir_fs.h"
+#include "ir_io.h"
+#include "ir_tx_cache.h"
+#include "irdb_loader.h"
+#include <string.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(ir_usage, LOG_LEVEL_INF);
+
+#define USAGE_MAGIC 0x53555249 // "IRUS"
+#define USAGE_VERSION 1
+#define USAGE_DECAY_AT (1U << 16) // 最大计数超过时全部减半，旧习惯逐渐淡出
+
+#ifdef CONFIG_IR_USAGE_SAVE_INTERVAL
+#define USAGE_SAVE_INTERVAL_S CONFIG_IR_USAGE_SAVE_INTERVAL
+#else
+#define USAGE_SAVE_INTERVAL_S 600
+#endif
+
+/* 文件头，之后为functions个和remotes个记录(结构体原样) */
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint8_t functions;
+  uint8_t remotes;
+  uint16_t function_size; // sizeof(ir_usage_function_t)，结构变化时失效
+  uint16_t remote_size;   // sizeof(ir_usage_remote_t)
+} usage_file_t;
+
+static struct {
+  ir_usage_function_t functions[IR_USAGE_FUNCTIONS]; // count为0的为空
+  ir_usage_remote_t remotes[IR_USAGE_REMOTES];
+  bool dirty;
+} usage;
+static struct k_spinlock usage_lock;
+
+/* 保存和钉住在工作项与shell之间串行，快照避免持自旋锁写文件 */
+static K_MUTEX_DEFINE(usage_mutex);
+static ir_usage_function_t snap_functions[IR_USAGE_FUNCTIONS];
+static ir_usage_remote_t snap_remotes[IR_USAGE_REMOTES];
+static irdb_entry_t pinned[IR_USAGE_PIN];
+static size_t pinned_count;
+
+static void usage_save_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(usage_save_work, usage_save_handler);
+
+/* 定期保存和预载由I/O执行器执行，不占系统工作队列 */
+static ir_io_job_t usage_save_job;
+static struct {
+  ir_io_job_t job;
+  ir_service_config_t config;
+} usage_preload_jobs[IR_USAGE_PRELOAD];
+static atomic_t usage_preloaded;
+
+static bool code_equal(const irdb_entry_t *a, const irdb_entry_t *b) {
+  return a->protocol == b->protocol && a->device == b->device &&
+         a->subdevice == b->subdevice && a->function == b->function;
+}
+
+static bool config_equal(const ir_service_config_t *a,
+                         const ir_service_config_t *b) {
+  return a->load_method == b->load_method && a->device == b->device &&
+         a->subdevice == b->subdevice &&
+         strcmp(a->manufacturer, b->manufacturer) == 0 &&
+         strcmp(a->device_type, b->device_type) == 0;
+}
+
+void ir_usage_note_send(const irdb_entry_t *entry) {
+  irdb_entry_t code = {
+      .name = IRDB_NAME_NONE,
+      .protocol = entry->protocol,
+      .device = entry->device,
+      .subdevice = entry->subdevice,
+      .function = entry->function,
+  };
+
+  size_t min = 0;
+  size_t i;
+
+  /* space-saving: 命中加1，未命中时替换计数最小的一项 */
+  k_spinlock_key_t key = k_spin_lock(&usage_lock);
+  for (i = 0; i < ARRAY_SIZE(usage.functions); i++) {
+    const ir_usage_function_t *f = &usage.functions[i];
+
+    if (f->count > 0 && code_equal(&f->code, &code)) {
+      break;
+    }
+    if (f->count < usage.functions[min].count) {
+      min = i;
+    }
+  }
+  if (i == ARRAY_SIZE(usage.functions)) {
+    i = min;
+    usage.functions[i].code = code;
+  }
+  usage.functions[i].count++;
+  usage.dirty = true;
+  k_spin_unlock(&usage_lock, key);
+}
+
+void ir_usage_note_remote(const ir_service_config_t *config) {
+  size_t min = 0;
+  size_t i;
+
+  k_spinlock_key_t key = k_spin_lock(&usage_lock);
+  for (i = 0; i < ARRAY_SIZE(usage.remotes); i++) {
+    const ir_usage_remote_t *r = &usage.remotes[i];
+
+    if (r->count > 0 && config_equal(&r->config, config)) {
+      break;
+    }
+    if (r->count < usage.remotes[min].count) {
+      min = i;
+    }
+  }
+  if (i == ARRAY_SIZE(usage.remotes)) {
+    i = min;
+    usage.remotes[i].config = *config;
+  }
+  usage.remotes[i].count++;
+  usage.dirty = true;
+  k_spin_unlock(&usage_lock, key);
+}
+
+/* 计数减半 (调用者持锁) */
+static void usage_decay(void) {
+  uint32_t max = 0;
+
+  for (size_t i = 0; i < ARRAY_SIZE(usage.functions); i++) {
+    max = MAX(max, usage.functions[i].count);
+  }
+  if (max < USAGE_DECAY_AT) {
+    return;
+  }
+  for (size_t i = 0; i < ARRAY_SIZE(usage.functions); i++) {
+    usage.functions[i].count /= 2;
+  }
+  for (size_t i = 0; i < ARRAY_SIZE(usage.remotes); i++) {
+    usage.remotes[i].count /= 2;
+  }
+}
+
+/* 按计数降序插入，表很小。返回插入位置，排在前max项之外时返回max */
+static size_t top_slot(const uint32_t *counts, size_t n, size_t max,
+                       uint32_t count) {
+  size_t j = MIN(n, max);
+
+  while (j > 0 && counts[j - 1] < count) {
+    j--;
+  }
+  return j;
+}
+
+size_t ir_usage_top_functions(ir_usage_function_t *out, size_t max) {
+  uint32_t counts[IR_USAGE_FUNCTIONS];
+  size_t n = 0;
+
+  if (!out) {
+    return 0;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&usage_lock);
+  for (size_t i = 0; i < ARRAY_SIZE(usage.functions); i++) {
+    uint32_t count = usage.functions[i].count;
+    size_t j = top_slot(counts, n, max, count);
+
+    if (count == 0 || j >= max) {
+      continue;
+    }
+    n = MIN(n + 1, max);
+    memmove(&out[j + 1], &out[j], (n - 1 - j) * sizeof(out[0]));
+    memmove(&counts[j + 1], &counts[j], (n - 1 - j) * sizeof(counts[0]));
+    out[j] = usage.functions[i];
+    counts[j] = count;
+  }
+  k_spin_unlock(&usage_lock, key);
+  return n;
+}
+
+size_t ir_usage_top_remotes(ir_usage_remote_t *out, size_t max) {
+  uint32_t counts[IR_USAGE_REMOTES];
+  size_t n = 0;
+
+  if (!out) {
+    return 0;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&usage_lock);
+  for (size_t i = 0; i < ARRAY_SIZE(usage.remotes); i++) {
+    uint32_t count = usage.remotes[i].count;
+    size_t j = top_slot(counts, n, max, count);
+
+    if (count == 0 || j >= max) {
+      continue;
+    }
+    n = MIN(n + 1, max);
+    memmove(&out[j + 1], &out[j], (n - 1 - j) * sizeof(out[0]));
+    memmove(&counts[j + 1], &counts[j], (n - 1 - j) * sizeof(counts[0]));
+    out[j] = usage.remotes[i];
+    counts[j] = count;
+  }
+  k_spin_unlock(&usage_lock, key);
+  return n;
+}
+
+/* 钉住计数最高的功能，集合没变时不动发送缓存 (调用者持usage_mutex) */
+static void usage_pin(void) {
+  irdb_entry_t codes[IR_USAGE_PIN];
+  size_t n = ir_usage_top_functions(snap_functions, IR_USAGE_PIN);
+
+  for (size_t i = 0; i < n; i++) {
+    codes[i] = snap_functions[i].code;
+  }
+
+  bool same = n == pinned_count;
+  for (size_t i = 0; same && i < n; i++) {
+    bool found = false;
+    for (size_t j = 0; !found && j < pinned_count; j++) {
+      found = code_equal(&codes[i], &pinned[j]);
+    }
+    same = found;
+  }
+  if (same) {
+    return;
+  }
+
+  memcpy(pinned, codes, n * sizeof(codes[0]));
+  pinned_count = n;
+  int ret = ir_tx_cache_pin(codes, n);
+  LOG_INF("Pinned %d of %u hot functions", ret, n);
+}
+
+#ifdef CONFIG_FILE_SYSTEM
+static int usage_write(void) {
+  usage_file_t hdr = {
+      .magic = USAGE_MAGIC,
+      .version = USAGE_VERSION,
+      .functions = IR_USAGE_FUNCTIONS,
+      .remotes = IR_USAGE_REMOTES,
+      .function_size = sizeof(ir_usage_function_t),
+      .remote_size = sizeof(ir_usage_remote_t),
+  };
+  struct fs_file_t file;
+
+  k_spinlock_key_t key = k_spin_lock(&usage_lock);
+  usage_decay();
+  memcpy(snap_functions, usage.functions, sizeof(snap_functions));
+  memcpy(snap_remotes, usage.remotes, sizeof(snap_remotes));
+  usage.dirty = false;
+  k_spin_unlock(&usage_lock, key);
+
+  int ret = ir_fs_mount();
+  if (ret < 0) {
+    return ret;
+  }
+
+  fs_file_t_init(&file);
+  ret = fs_open(&file, IR_USAGE_PATH, FS_O_CREATE | FS_O_WRITE | FS_O_TRUNC);
+  if (ret < 0) {
+    LOG_ERR("Failed to create %s: %d", IR_USAGE_PATH, ret);
+    return ret;
+  }
+
+  ssize_t written = fs_write(&file, &hdr, sizeof(hdr));
+  if (written == sizeof(hdr)) {
+    written = fs_write(&file, snap_functions, sizeof(snap_functions));
+  }
+  if (written == sizeof(snap_functions)) {
+    written = fs_write(&file, snap_remotes, sizeof(snap_remotes));
+  }
+  fs_close(&file);
+  if (written != sizeof(snap_remotes)) {
+    LOG_ERR("Failed to write %s: %d", IR_USAGE_PATH, (int)written);
+    return written < 0 ? (int)written : -ENOSPC;
+  }
+  return 0;
+}
+
+static int usage_read(void) {
+  usage_file_t hdr;
+  struct fs_file_t file;
+
+  fs_file_t_init(&file);
+  if (ir_fs_mount() < 0 || fs_open(&file, IR_USAGE_PATH, FS_O_READ) < 0) {
+    return -ENOENT;
+  }
+
+  ssize_t len = fs_read(&file, &hdr, sizeof(hdr));
+  if (len != sizeof(hdr) || hdr.magic != USAGE_MAGIC ||
+      hdr.version != USAGE_VERSION ||
+      hdr.function_size != sizeof(ir_usage_function_t) ||
+      hdr.remote_size != sizeof(ir_usage_remote_t)) {
+    fs_close(&file);
+    LOG_WRN("Ignoring invalid %s", IR_USAGE_PATH);
+    return -EINVAL;
+  }
+
+  /* 表改小时只取前面能放下的槽位 */
+  size_t functions = MIN(hdr.functions, IR_USAGE_FUNCTIONS);
+  size_t remotes = MIN(hdr.remotes, IR_USAGE_REMOTES);
+
+  memset(snap_functions, 0, sizeof(snap_functions));
+  memset(snap_remotes, 0, sizeof(snap_remotes));
+  len = fs_read(&file, snap_functions, functions * hdr.function_size);
+  if (len == functions * hdr.function_size) {
+    fs_seek(&file, (hdr.functions - functions) * hdr.function_size,
+            FS_SEEK_CUR);
+    len = fs_read(&file, snap_remotes, remotes * hdr.remote_size);
+  }
+  fs_close(&file);
+  if (len < 0) {
+    return len;
+  }
+
+  k_spinlock_key_t key = k_spin_lock(&usage_lock);
+  memcpy(usage.functions, snap_functions, sizeof(usage.functions));
+  memcpy(usage.remotes, snap_remotes, sizeof(usage.remotes));
+  k_spin_unlock(&usage_lock, key);
+  return 0;
+}
+#else
+static int usage_write(void) { return -ENOTSUP; }
+
+static int usage_read(void) { return -ENOTSUP; }
+#endif
+
+int ir_usage_save(void) {
+  k_mutex_lock(&usage_mutex, K_FOREVER);
+  int ret = usage_write();
+  usage_pin();
+  k_mutex_unlock(&usage_mutex);
+  return ret;
+}
+
+static int usage_save_stage(ir_io_job_t *job) { return ir_usage_save(); }
+
+/* 定期保存 - 没有新计数时不写flash; 上一次还在排队时跳过 */
+static void usage_save_handler(struct k_work *work) {
+  k_spinlock_key_t key = k_spin_lock(&usage_lock);
+  bool dirty = usage.dirty;
+  k_spin_unlock(&usage_lock, key);
+
+  if (dirty) {
+    ir_io_submit(&usage_save_job);
+  }
+  k_work_schedule(&usage_save_work, K_SECONDS(USAGE_SAVE_INTERVAL_S));
+}
+
+int ir_usage_init(void) {
+  ir_io_init();
+  ir_io_job_init(&usage_save_job, usage_save_stage, NULL, NULL);
+
+  int ret = usage_read();
+
+  if (ret == 0) {
+    LOG_INF("Usage restored from %s", IR_USAGE_PATH);
+  }
+
+  k_mutex_lock(&usage_mutex, K_FOREVER);
+  usage_pin();
+  k_mutex_unlock(&usage_mutex);
+
+  k_work_schedule(&usage_save_work, K_SECONDS(USAGE_SAVE_INTERVAL_S));
+  return ret == -ENOENT ? 0 : ret;
+}
+
+/* 预载一个遥控器 - 可能经HTTP，不持usage_mutex，定期保存不被阻塞 */
+static int usage_preload_stage(ir_io_job_t *job) {
+  const ir_service_config_t *config = job->user_data;
+
+  return ir_service_prefetch_remote(config);
+}
+
+static void usage_preload_done(ir_io_job_t *job, int result) {
+  const ir_service_config_t *config = job->user_data;
+
+  if (result < 0) {
+    LOG_WRN("Preload %s %s (%u,%u) failed: %d", config->manufacturer,
+            config->device_type, config->device, config->subdevice, result);
+    return;
+  }
+  LOG_INF("Preloaded hot remote %d: %s %s (%u,%u)",
+          (int)atomic_inc(&usage_preloaded) + 1, config->manufacturer,
+          config->device_type, config->device, config->subdevice);
+}
+
+/* 每个遥控器一个独立作业(不成链)，一个失败不影响其余 */
+int ir_usage_preload(void) {
+  ir_usage_remote_t top[IR_USAGE_PRELOAD];
+  int queued = 0;
+
+  size_t n = ir_usage_top_remotes(top, ARRAY_SIZE(top));
+  for (size_t i = 0; i < n; i++) {
+    ir_io_job_t *job = &usage_preload_jobs[i].job;
+
+    if (ir_io_busy(job)) {
+      continue; // 上一次预载尚未完成
+    }
+    usage_preload_jobs[i].config = top[i].config;
+    ir_io_job_init(job, usage_preload_stage, usage_preload_done,
+                   &usage_preload_jobs[i].config);
+    if (ir_io_submit(job) == 0) {
+      queued++;
+    }
+  }
+
+  LOG_INF("Queued preload of %d of %u hot remotes", queued, n);
+  return queued;
+}
+
+void ir_usage_reset(void) {
+  k_spinlock_key_t key = k_spin_lock(&usage_lock);
+  memset(&usage, 0, sizeof(usage));
+  k_spin_unlock(&usage_lock, key);
+
+  k_mutex_lock(&usage_mutex, K_FOREVER);
+  pinned_count = 0;
+  ir_tx_cache_pin(NULL, 0);
+#ifdef CONFIG_FILE_SYSTEM
+  if (ir_fs_mount() == 0) {
+    fs_unlink(IR_USAGE_PATH);
+  }
+#endif
+  k_mutex_unlock(&usage_mutex);
+}
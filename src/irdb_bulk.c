@@ -0,0 +1,461 @@
+/**
+ * @file irdb_bulk.c
+ * @brief 批量加载实现 - I/O执行线程读块，调用者线程解析
+ */
+
+#include "irdb_bulk.h"
+#include "ir_fs.h"
+#include "ir_io.h"
+#include "ir_mem.h"
+#include "irdb_image.h"
+#include "irdb_store.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(irdb_bulk, LOG_LEVEL_INF);
+
+/* 数据块标志 */
+#define BULK_FIRST BIT(0)  // 文件的第一块 (打开失败时也置位)
+#define BULK_LAST BIT(1)   // 文件的最后一块
+#define BULK_IMAGE BIT(2)  // 镜像文件，已整体读入image
+#define BULK_CACHED BIT(3) // 已在RAM缓存中，未读
+#define BULK_END BIT(4)    // 全部文件已读完，空块
+
+/* 工作项 - 一次读取作业及其数据块 */
+typedef struct {
+  ir_io_job_t job;
+  irdb_database_t image;
+  int result; // 打开、读取或读镜像的错误
+  uint16_t file; // keys中的下标
+  uint16_t len;
+  uint8_t flags;
+  char buf[IRDB_BULK_CHUNK_SIZE];
+} bulk_item_t;
+
+static bulk_item_t bulk_items[IRDB_BULK_CHUNKS];
+
+/* 读完的工作项按读取顺序交给调用者 */
+K_MSGQ_DEFINE(bulk_filled, sizeof(bulk_item_t *), IRDB_BULK_CHUNKS, 4);
+
+static K_MUTEX_DEFINE(bulk_mutex);
+
+/* 读游标 - 只在I/O执行线程的读取阶段中存取 */
+static struct {
+  const irdb_cache_key_t *keys;
+  size_t count;
+  size_t next; // 正在读或下一个要打开的文件
+  struct fs_file_t file;
+  bool open;
+  uint32_t bytes;
+  uint64_t read_cycles;
+} bulk_reader;
+
+static irdb_cache_key_t bulk_key(const irdb_cache_key_t *keys, size_t i) {
+  irdb_cache_key_t key = keys[i];
+
+  key.source = IRDB_LOAD_FILESYSTEM;
+  return key;
+}
+
+/* 当前文件读完或出错 - 关闭并移到下一个 */
+static void bulk_reader_next(bulk_item_t *item) {
+  if (bulk_reader.open) {
+    fs_close(&bulk_reader.file);
+    bulk_reader.open = false;
+  }
+  item->flags |= BULK_LAST;
+  bulk_reader.next++;
+}
+
+/* 打开下一个文件 - RAM缓存已有的跳过 */
+static int bulk_reader_open(bulk_item_t *item) {
+  irdb_cache_key_t key = bulk_key(bulk_reader.keys, bulk_reader.next);
+  irdb_database_t *hit;
+  char path[128];
+  int ret;
+
+  if (irdb_cache_get(&key, &hit) == 0) {
+    irdb_cache_release(hit);
+    item->flags |= BULK_CACHED;
+    return -EALREADY;
+  }
+
+  irdb_build_path(path, sizeof(path), key.manufacturer, key.device_type,
+                  key.device, key.subdevice);
+  fs_file_t_init(&bulk_reader.file);
+  ret = ir_fs_mount();
+  if (ret == 0) {
+    ret = fs_open(&bulk_reader.file, path, FS_O_READ);
+  }
+  if (ret < 0) {
+    LOG_WRN("Failed to open %s: %d", path, ret);
+    return ret;
+  }
+
+  bulk_reader.open = true;
+  item->flags |= BULK_FIRST;
+  return 0;
+}
+
+/* 读取阶段 - 读出当前文件的下一块; 镜像文件在第一块识别后整体读入 */
+static int bulk_read_stage(ir_io_job_t *job) {
+  bulk_item_t *item = job->user_data;
+  uint32_t start = k_cycle_get_32();
+  ssize_t n;
+
+  item->file = bulk_reader.next;
+  item->flags = 0;
+  item->len = 0;
+  item->result = 0;
+
+  if (bulk_reader.next >= bulk_reader.count) {
+    item->flags = BULK_END;
+    return 0;
+  }
+
+  if (!bulk_reader.open) {
+    int ret = bulk_reader_open(item);
+
+    if (ret < 0) {
+      item->flags |= BULK_FIRST;
+      item->result = ret == -EALREADY ? 0 : ret;
+      bulk_reader_next(item);
+      goto out;
+    }
+  }
+
+  n = fs_read(&bulk_reader.file, item->buf, sizeof(item->buf));
+
+  uint32_t magic;
+  if ((item->flags & BULK_FIRST) && n >= (ssize_t)sizeof(magic)) {
+    memcpy(&magic, item->buf, sizeof(magic));
+    if ((magic == IRDB_IMAGE_MAGIC || magic == IRDB_IMAGE_LZ_MAGIC) &&
+        fs_seek(&bulk_reader.file, 0, FS_SEEK_SET) == 0) {
+      item->flags |= BULK_IMAGE;
+      item->result = irdb_image_read_file(&bulk_reader.file, &item->image);
+      n = fs_tell(&bulk_reader.file);
+      bulk_reader.bytes += MAX(n, 0);
+      bulk_reader_next(item);
+      goto out;
+    }
+  }
+
+  if (n < 0) {
+    item->result = n;
+    bulk_reader_next(item);
+    goto out;
+  }
+
+  item->len = n;
+  bulk_reader.bytes += n;
+  if ((size_t)n < sizeof(item->buf)) {
+    bulk_reader_next(item);
+  }
+
+out:
+  bulk_reader.read_cycles += k_cycle_get_32() - start;
+  return item->result;
+}
+
+/* 读取完成 - 作业已回到空闲，交给调用者后可以重新提交 */
+static void bulk_read_done(ir_io_job_t *job, int result) {
+  bulk_item_t *item = job->user_data;
+
+  ARG_UNUSED(result);
+  k_msgq_put(&bulk_filled, &item, K_NO_WAIT);
+}
+
+/* 调用者一侧 - 当前文件的解析状态 */
+typedef struct {
+  const irdb_cache_key_t *keys;
+  size_t count;
+  irdb_prefetch_cb_t cb;
+  void *user_data;
+  irdb_parser_t parser;
+  irdb_database_t db;
+  bool parsing; // 已收到当前文件的第一块，还没收到最后一块
+  irdb_bulk_stats_t stats;
+} bulk_ctx_t;
+
+static void bulk_report(bulk_ctx_t *c, size_t i, int result) {
+  if (c->cb) {
+    irdb_cache_key_t key = bulk_key(c->keys, i);
+
+    c->cb(i, c->count, &key, result, c->user_data);
+  }
+}
+
+/* 放入RAM缓存，放不下时丢弃 */
+static void bulk_store(bulk_ctx_t *c, size_t i, irdb_database_t *db) {
+  irdb_cache_key_t key = bulk_key(c->keys, i);
+  int ret;
+
+  strncpy(db->manufacturer, key.manufacturer, sizeof(db->manufacturer) - 1);
+  strncpy(db->device_type, key.device_type, sizeof(db->device_type) - 1);
+
+  ret = irdb_cache_put(&key, db, NULL);
+  if (ret < 0) {
+    irdb_free_database(db);
+    c->stats.uncached++;
+  } else {
+    c->stats.loaded++;
+  }
+  bulk_report(c, i, ret);
+}
+
+/* 倍增扩展留下的空余条目归还堆 */
+static void bulk_shrink(const irdb_parser_t *parser, irdb_database_t *db) {
+  if (db->entry_count == 0 || db->entry_count >= parser->capacity) {
+    return;
+  }
+
+  irdb_entry_t *entries =
+      irdb_heap_realloc(db->entries, db->entry_count * sizeof(irdb_entry_t));
+  if (entries) {
+    db->entries = entries;
+  }
+}
+
+static void bulk_consume(bulk_ctx_t *c, bulk_item_t *item) {
+  size_t i = item->file;
+  int ret;
+
+  if (item->flags & BULK_CACHED) {
+    c->stats.cached++;
+    bulk_report(c, i, 0);
+    return;
+  }
+
+  if (item->flags & BULK_IMAGE) {
+    if (item->result == 0) {
+      bulk_store(c, i, &item->image);
+    } else {
+      c->stats.failed++;
+      bulk_report(c, i, item->result);
+    }
+    return;
+  }
+
+  if (item->flags & BULK_FIRST) {
+    irdb_parser_init(&c->parser, &c->db, NULL);
+    c->parsing = true;
+  }
+  if (item->result < 0 && !c->parser.error) {
+    c->parser.error = item->result;
+  }
+  if (item->len > 0) {
+    irdb_parser_feed(&c->parser, item->buf, item->len);
+  }
+  if (!(item->flags & BULK_LAST)) {
+    return;
+  }
+
+  c->parsing = false;
+  ret = irdb_parser_finish(&c->parser);
+  if (ret < 0) {
+    c->stats.failed++;
+    bulk_report(c, i, ret);
+    return;
+  }
+  bulk_shrink(&c->parser, &c->db);
+  bulk_store(c, i, &c->db);
+}
+
+int irdb_bulk_load(const irdb_cache_key_t *keys, size_t count,
+                   irdb_prefetch_cb_t cb, void *user_data,
+                   irdb_bulk_stats_t *stats) {
+  static bulk_ctx_t c; // 含解析器的半行缓冲，不占调用者的栈
+  uint64_t wait_cycles = 0;
+  uint64_t parse_cycles = 0;
+  int64_t start = k_uptime_get();
+  size_t in_flight = 0;
+
+  if ((!keys && count > 0) || count > UINT16_MAX) {
+    return -EINVAL;
+  }
+  if (ir_io_in_executor()) {
+    return -EDEADLK;
+  }
+  ir_io_init();
+
+  k_mutex_lock(&bulk_mutex, K_FOREVER);
+
+  memset(&c, 0, sizeof(c));
+  c.keys = keys;
+  c.count = count;
+  c.cb = cb;
+  c.user_data = user_data;
+
+  memset(&bulk_reader, 0, sizeof(bulk_reader));
+  bulk_reader.keys = keys;
+  bulk_reader.count = count;
+  k_msgq_purge(&bulk_filled);
+
+  for (size_t i = 0; i < ARRAY_SIZE(bulk_items); i++) {
+    ir_io_job_init(&bulk_items[i].job, bulk_read_stage, bulk_read_done,
+                   &bulk_items[i]);
+    if (ir_io_submit(&bulk_items[i].job) == 0) {
+      in_flight++;
+    }
+  }
+
+  /* 每取回一块就解析并重新提交，读取端随即读下一块 */
+  while (in_flight > 0) {
+    bulk_item_t *item;
+    uint32_t t0 = k_cycle_get_32();
+
+    k_msgq_get(&bulk_filled, &item, K_FOREVER);
+    uint32_t t1 = k_cycle_get_32();
+    wait_cycles += t1 - t0;
+
+    if (item->flags & BULK_END) {
+      in_flight--;
+      continue;
+    }
+
+    bulk_consume(&c, item);
+    parse_cycles += k_cycle_get_32() - t1;
+
+    if (ir_io_submit(&item->job) < 0) {
+      in_flight--;
+    }
+  }
+
+  /* 重新提交失败时剩下的文件未读完，解析了一半的释放 */
+  if (bulk_reader.open) {
+    fs_close(&bulk_reader.file);
+  }
+  if (c.parsing) {
+    c.parser.error = -ECANCELED;
+    irdb_parser_finish(&c.parser);
+  }
+  for (size_t i = bulk_reader.next; i < count; i++) {
+    c.stats.failed++;
+    bulk_report(&c, i, -ECANCELED);
+  }
+
+  c.stats.bytes = bulk_reader.bytes;
+  c.stats.read_ms = k_cyc_to_ms_floor64(bulk_reader.read_cycles);
+  c.stats.parse_ms = k_cyc_to_ms_floor64(parse_cycles);
+  c.stats.wait_ms = k_cyc_to_ms_floor64(wait_cycles);
+  c.stats.total_ms = k_uptime_get() - start;
+
+  LOG_INF("Bulk load: %u loaded, %u cached, %u uncached, %u failed; "
+          "%u bytes in %u ms (read %u ms, parse %u ms)",
+          c.stats.loaded, c.stats.cached, c.stats.uncached, c.stats.failed,
+          c.stats.bytes, c.stats.total_ms, c.stats.read_ms,
+          c.stats.parse_ms);
+
+  if (stats) {
+    *stats = c.stats;
+  }
+  int failed = c.stats.failed;
+
+  k_mutex_unlock(&bulk_mutex);
+  return failed;
+}
+
+int irdb_bulk_parse_spec(char *spec, irdb_cache_key_t *key) {
+  unsigned int device, subdevice;
+  char *codes, *type;
+
+  if (!spec || !key) {
+    return -EINVAL;
+  }
+
+  codes = strrchr(spec, '/');
+  if (!codes || codes == spec) {
+    return -EINVAL;
+  }
+  *codes++ = '\0';
+  type = strrchr(spec, '/');
+  if (!type || type == spec || type[1] == '\0') {
+    return -EINVAL;
+  }
+  *type++ = '\0';
+
+  if (sscanf(codes, "%u,%u", &device, &subdevice) != 2 || device > 255 ||
+      subdevice > 255) {
+    return -EINVAL;
+  }
+
+  *key = (irdb_cache_key_t){
+      .manufacturer = spec,
+      .device_type = type,
+      .device = device,
+      .subdevice = subdevice,
+      .source = IRDB_LOAD_FILESYSTEM,
+  };
+  return 0;
+}
+
+int irdb_bulk_load_list(const char *path, irdb_prefetch_cb_t cb,
+                        void *user_data, irdb_bulk_stats_t *stats) {
+  static char list[IRDB_BULK_MAX_REMOTES * IRDB_BULK_LINE_MAX];
+  static irdb_cache_key_t keys[IRDB_BULK_MAX_REMOTES];
+  struct fs_file_t file;
+  size_t count = 0;
+  ssize_t len;
+  int ret;
+
+  if (!path) {
+    return -EINVAL;
+  }
+
+  /* 列表缓冲和键表在加载期间被引用，与加载同一把锁(可重入) */
+  k_mutex_lock(&bulk_mutex, K_FOREVER);
+
+  fs_file_t_init(&file);
+  ret = ir_fs_mount();
+  if (ret == 0) {
+    ret = fs_open(&file, path, FS_O_READ);
+  }
+  if (ret < 0) {
+    goto out;
+  }
+  len = fs_read(&file, list, sizeof(list) - 1);
+  fs_close(&file);
+  if (len < 0) {
+    ret = len;
+    goto out;
+  }
+  if (len == sizeof(list) - 1) {
+    ret = -EFBIG;
+    goto out;
+  }
+  list[len] = '\0';
+
+  for (char *line = list, *next; line; line = next) {
+    next = strchr(line, '\n');
+    if (next) {
+      *next++ = '\0';
+    }
+    line[strcspn(line, "\r")] = '\0';
+    if (line[0] == '\0' || line[0] == '#') {
+      continue;
+    }
+    if (count == ARRAY_SIZE(keys)) {
+      ret = -E2BIG;
+      goto out;
+    }
+    if (irdb_bulk_parse_spec(line, &keys[count]) < 0) {
+      LOG_WRN("Skipping bad line in %s: %s", path, line);
+      continue;
+    }
+    count++;
+  }
+
+  ret = irdb_bulk_load(keys, count, cb, user_data, stats);
+
+out:
+  k_mutex_unlock(&bulk_mutex);
+  return ret;
+}
+
+uint32_t irdb_bulk_rate(const irdb_bulk_stats_t *stats) {
+  return (uint64_t)stats->bytes * MSEC_PER_SEC / MAX(stats->total_ms, 1);
+}
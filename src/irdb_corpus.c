@@ -0,0 +1,292 @@
+/**
+ * @file irdb_corpus.c
+ * @brief IRDB镜像库实现 - 外部QSPI flash上的整库离线镜像
+ */
+
+#include "irdb_corpus.h"
+#include "ir_lz.h"
+#include "ir_mem.h"
+#include "irdb_image.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#ifdef CONFIG_IRDB_CORPUS
+#include <zephyr/storage/flash_map.h>
+#endif
+
+LOG_MODULE_REGISTER(irdb_corpus, LOG_LEVEL_INF);
+
+#ifdef CONFIG_IRDB_CORPUS_CACHE_LINES
+#define CORPUS_CACHE_LINES CONFIG_IRDB_CORPUS_CACHE_LINES
+#else
+#define CORPUS_CACHE_LINES 8
+#endif
+
+#define CORPUS_LINE_BYTES 64 // 每行4个索引槽
+#define CORPUS_LINE_SLOTS (CORPUS_LINE_BYTES / sizeof(irdb_corpus_slot_t))
+#define CORPUS_KEY_MAX 128   // 键字符串上限，超出视为损坏
+
+BUILD_ASSERT(sizeof(irdb_corpus_header_t) == 20, "corpus header layout");
+BUILD_ASSERT(sizeof(irdb_corpus_slot_t) == 16, "corpus slot layout");
+
+static uint32_t fnv1a(uint32_t h, const void *data, size_t len) {
+  const uint8_t *p = data;
+
+  while (len--) {
+    h ^= *p++;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+uint32_t irdb_corpus_key_hash(const char *manufacturer,
+                              const char *device_type, uint8_t device,
+                              uint8_t subdevice) {
+  uint8_t tail[2] = {device, subdevice};
+  uint32_t h = 2166136261u;
+
+  h = fnv1a(h, manufacturer, strlen(manufacturer) + 1);
+  h = fnv1a(h, device_type, strlen(device_type) + 1);
+  return fnv1a(h, tail, sizeof(tail));
+}
+
+#if defined(CONFIG_IRDB_CORPUS)
+#if !FIXED_PARTITION_EXISTS(irdb_corpus_partition)
+#error "CONFIG_IRDB_CORPUS needs an irdb_corpus_partition in the devicetree"
+#endif
+
+/* 索引行缓存 - 直接映射，行号取模；外部flash的每次读取都有命令和地址
+ * 开销，相邻的探查和重复查找同一遥控器都不再访问flash */
+typedef struct {
+  uint32_t line; // 行号+1，0为空
+  irdb_corpus_slot_t slots[CORPUS_LINE_SLOTS];
+} corpus_line_t;
+
+static K_MUTEX_DEFINE(corpus_mutex);
+
+static struct {
+  const struct flash_area *fa;
+  bool probed; // 已尝试打开(失败时不再重试)
+  irdb_corpus_header_t hdr;
+  corpus_line_t lines[CORPUS_CACHE_LINES];
+  ir_lz_decoder_t dec;
+  irdb_corpus_stats_t stats;
+} corpus;
+
+static int corpus_read(uint32_t offset, void *buf, size_t len) {
+  int ret = flash_area_read(corpus.fa, offset, buf, len);
+  if (ret == 0) {
+    corpus.stats.bytes_read += len;
+  }
+  return ret;
+}
+
+/* 解压的输入 - 记录中镜像的剩余部分 */
+typedef struct {
+  uint32_t offset;
+  uint32_t end;
+} corpus_source_t;
+
+static ssize_t corpus_source(void *ctx, void *buf, size_t len) {
+  corpus_source_t *src = ctx;
+  size_t n = MIN(len, src->end - src->offset);
+
+  int ret = n > 0 ? corpus_read(src->offset, buf, n) : 0;
+  if (ret < 0) {
+    return ret;
+  }
+  src->offset += n;
+  return n;
+}
+
+/* 首次加载时打开分区并校验文件头。调用者须持有corpus_mutex */
+static int corpus_open(void) {
+  if (corpus.probed) {
+    return corpus.fa ? 0 : -ENODEV;
+  }
+  corpus.probed = true;
+
+  const struct flash_area *fa;
+  int ret = flash_area_open(FIXED_PARTITION_ID(irdb_corpus_partition), &fa);
+  if (ret < 0) {
+    LOG_ERR("Failed to open corpus partition: %d", ret);
+    return -ENODEV;
+  }
+
+  irdb_corpus_header_t *hdr = &corpus.hdr;
+  ret = flash_area_read(fa, 0, hdr, sizeof(*hdr));
+  uint64_t index_end = sizeof(*hdr) +
+                       (uint64_t)hdr->index_size * sizeof(irdb_corpus_slot_t);
+  if (ret < 0 || hdr->magic != IRDB_CORPUS_MAGIC ||
+      hdr->version != IRDB_CORPUS_VERSION || hdr->index_size == 0 ||
+      (hdr->index_size & (hdr->index_size - 1)) != 0 ||
+      hdr->size > fa->fa_size || index_end > hdr->size) {
+    LOG_WRN("No valid IRDB corpus in %s", "irdb_corpus_partition");
+    flash_area_close(fa);
+    return -ENODEV;
+  }
+
+  corpus.fa = fa;
+  corpus.stats.remotes = hdr->remote_count;
+  corpus.stats.size = hdr->size;
+  LOG_INF("IRDB corpus: %u remotes, %u bytes, %u index slots",
+          hdr->remote_count, hdr->size, hdr->index_size);
+  return 0;
+}
+
+/* 读取索引槽，经行缓存。调用者须持有corpus_mutex */
+static int corpus_slot(uint32_t index, irdb_corpus_slot_t *slot) {
+  uint32_t line = index / CORPUS_LINE_SLOTS;
+  corpus_line_t *l = &corpus.lines[line % CORPUS_CACHE_LINES];
+
+  corpus.stats.probes++;
+  if (l->line == line + 1) {
+    corpus.stats.line_hits++;
+  } else {
+    /* 索引槽数不足一行时只读有效部分 */
+    uint32_t first = line * CORPUS_LINE_SLOTS;
+    uint32_t count = MIN(CORPUS_LINE_SLOTS, corpus.hdr.index_size - first);
+
+    l->line = 0;
+    int ret = corpus_read(sizeof(irdb_corpus_header_t) +
+                              first * sizeof(irdb_corpus_slot_t),
+                          l->slots, count * sizeof(irdb_corpus_slot_t));
+    if (ret < 0) {
+      return ret;
+    }
+    l->line = line + 1;
+  }
+
+  *slot = l->slots[index % CORPUS_LINE_SLOTS];
+  return 0;
+}
+
+/* 按键查找索引槽 */
+static int corpus_find(const char *manufacturer, const char *device_type,
+                       uint8_t device, uint8_t subdevice,
+                       irdb_corpus_slot_t *slot) {
+  uint32_t hash =
+      irdb_corpus_key_hash(manufacturer, device_type, device, subdevice);
+  uint32_t key_len = strlen(manufacturer) + strlen(device_type) + 2;
+  uint32_t mask = corpus.hdr.index_size - 1;
+
+  for (uint32_t i = 0; i <= mask; i++) {
+    int ret = corpus_slot((hash + i) & mask, slot);
+    if (ret < 0) {
+      return ret;
+    }
+    if (slot->size == 0) {
+      break;
+    }
+    /* 键字符串随记录一起读出后再比对 */
+    if (slot->hash == hash && slot->device == device &&
+        slot->subdevice == subdevice && slot->key_len == key_len) {
+      return 0;
+    }
+  }
+  return -ENOENT;
+}
+
+int irdb_corpus_load(const char *manufacturer, const char *device_type,
+                     uint8_t device, uint8_t subdevice, irdb_database_t *db) {
+  if (!manufacturer || !device_type || !db) {
+    return -EINVAL;
+  }
+
+  irdb_corpus_slot_t slot = {0};
+
+  k_mutex_lock(&corpus_mutex, K_FOREVER);
+
+  int ret = corpus_open();
+  if (ret == 0) {
+    ret = corpus_find(manufacturer, device_type, device, subdevice, &slot);
+  }
+
+  uint32_t image_offset = ROUND_UP(slot.key_len, 4);
+  if (ret == 0 &&
+      (slot.key_len > CORPUS_KEY_MAX || slot.offset % 4 != 0 ||
+       slot.size < image_offset + sizeof(irdb_image_lz_header_t) ||
+       (uint64_t)slot.offset + slot.size > corpus.hdr.size)) {
+    LOG_ERR("Corrupt corpus slot for %s/%s %u,%u", manufacturer, device_type,
+            device, subdevice);
+    ret = -EBADMSG;
+  }
+
+  /* 先读键和镜像开头，核对键后再读镜像 */
+  uint8_t head[CORPUS_KEY_MAX + sizeof(irdb_image_lz_header_t)] __aligned(4);
+  const irdb_image_lz_header_t *lz =
+      (const irdb_image_lz_header_t *)(head + image_offset);
+  if (ret == 0) {
+    ret = corpus_read(slot.offset, head, image_offset + sizeof(*lz));
+  }
+  if (ret == 0) {
+    size_t mfr_len = strlen(manufacturer) + 1;
+    if (memcmp(head, manufacturer, mfr_len) != 0 ||
+        strcmp((const char *)head + mfr_len, device_type) != 0) {
+      ret = -ENOENT; // 哈希相同的另一个遥控器
+    }
+  }
+
+  bool compressed = ret == 0 && lz->magic == IRDB_IMAGE_LZ_MAGIC;
+  uint32_t image_size = compressed ? lz->size : slot.size - image_offset;
+  if (ret == 0 && image_size < sizeof(irdb_image_header_t)) {
+    ret = -EBADMSG;
+  }
+
+  /* 压缩的镜像按块读出直接解压到数据库堆中的镜像缓冲，未压缩的一次
+   * 连续读入；镜像都在缓冲中原地打开 */
+  uint8_t *image = NULL;
+  if (ret == 0) {
+    image = irdb_heap_alloc(image_size);
+    ret = image ? 0 : -ENOMEM;
+  }
+  if (ret == 0 && compressed) {
+    corpus_source_t src = {
+        .offset = slot.offset + image_offset + sizeof(*lz),
+        .end = slot.offset + slot.size,
+    };
+    ir_lz_decoder_init(&corpus.dec);
+    ret = ir_lz_decode_all(&corpus.dec, corpus_source, &src, image,
+                           image_size);
+  } else if (ret == 0) {
+    ret = corpus_read(slot.offset + image_offset, image, image_size);
+  }
+
+  if (ret == 0) {
+    const irdb_image_header_t *hdr = (const irdb_image_header_t *)image;
+    if (!irdb_image_is_valid(hdr) || hdr->size != image_size) {
+      ret = -EBADMSG;
+    } else {
+      ret = irdb_image_open(db, hdr);
+    }
+  }
+
+  if (ret == 0) {
+    db->image_buf = image;
+    corpus.stats.loads++;
+  } else {
+    irdb_heap_free(image);
+  }
+
+  k_mutex_unlock(&corpus_mutex);
+  return ret;
+}
+
+void irdb_corpus_get_stats(irdb_corpus_stats_t *stats) {
+  k_mutex_lock(&corpus_mutex, K_FOREVER);
+  *stats = corpus.stats;
+  k_mutex_unlock(&corpus_mutex);
+}
+
+#else
+int irdb_corpus_load(const char *manufacturer, const char *device_type,
+                     uint8_t device, uint8_t subdevice, irdb_database_t *db) {
+  return -ENODEV;
+}
+
+void irdb_corpus_get_stats(irdb_corpus_stats_t *stats) {
+  memset(stats, 0, sizeof(*stats));
+}
+#endif /* CONFIG_IRDB_CORPUS */
@@ -0,0 +1,543 @@
+/**
+ * @file irdb_delta.c
+ * @brief IRDB增量更新实现
+ *
+ * 清单和增量文件都边收边处理: 清单记录直接与本地列表匹配，增量文件的
+ * 删除表收齐后先把保留的旧条目送入流式解析器，其余CSV照常解析。
+ */
+
+#include "irdb_delta.h"
+#include "ir_fs.h"
+#include "ir_mem.h"
+#include "irdb_flash_cache.h"
+#include "irdb_loader.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#ifdef CONFIG_IRDB_DELTA
+#include <zephyr/fs/fs.h>
+#endif
+
+LOG_MODULE_REGISTER(irdb_delta, LOG_LEVEL_INF);
+
+BUILD_ASSERT(sizeof(irdb_delta_manifest_t) == 16, "manifest header layout");
+BUILD_ASSERT(sizeof(irdb_delta_record_t) == 12, "manifest record layout");
+BUILD_ASSERT(sizeof(irdb_delta_header_t) == 20, "delta header layout");
+
+static uint32_t fnv1a(uint32_t h, const void *data, size_t len) {
+  const uint8_t *p = data;
+
+  while (len--) {
+    h ^= *p++;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+/* 条目哈希 - 码值按小端(目标平台字节序)参与 */
+static uint32_t entry_hash(const irdb_database_t *db, const irdb_entry_t *e) {
+  const char *name = db->names + e->name;
+  const uint16_t codes[] = {e->protocol, e->device, e->subdevice,
+                            e->function};
+  uint32_t h = fnv1a(2166136261u, name, strlen(name) + 1);
+
+  return fnv1a(h, codes, sizeof(codes));
+}
+
+/* 内容哈希 */
+uint32_t irdb_delta_content_hash(const irdb_database_t *db) {
+  uint32_t sum = 0;
+
+  for (uint32_t i = 0; i < db->entry_count; i++) {
+    sum += entry_hash(db, &db->entries[i]);
+  }
+  return sum;
+}
+
+#ifdef CONFIG_IRDB_DELTA
+
+#define DELTA_MAX_REMOTES CONFIG_IRDB_DELTA_MAX_REMOTES
+#define DELTA_MANIFEST_URL CONFIG_IRDB_DELTA_PATH "/manifest.bin"
+#define DELTA_VALIDATOR_PATH IRDB_FLASH_CACHE_DIR "/manifest.val"
+
+/* flash缓存中的一个遥控器 */
+typedef struct {
+  char key[IRDB_FLASH_CACHE_KEY_MAX]; // manufacturer和device_type，以'\0'分隔
+  uint8_t device;
+  uint8_t subdevice;
+  uint32_t hash;           // irdb_cache_key_hash
+  uint32_t version;        // 本地版本，0为未知
+  uint32_t target_version; // 清单中的版本，0为未列入清单
+  uint32_t target_hash;    // 清单中的内容哈希
+} delta_remote_t;
+
+typedef struct {
+  delta_remote_t *remotes;
+  uint16_t count;
+  uint16_t skipped; // 超出CONFIG_IRDB_DELTA_MAX_REMOTES的
+} delta_list_t;
+
+/* 清单流式解析 */
+typedef struct {
+  delta_list_t *list;
+  union {
+    irdb_delta_manifest_t hdr;
+    irdb_delta_record_t rec;
+    uint8_t raw[sizeof(irdb_delta_manifest_t)];
+  } buf;
+  size_t got;    // buf中已收到的字节
+  uint32_t left; // 未收到的记录数
+  bool have_header;
+  uint32_t bytes;
+} delta_manifest_t;
+
+/* 增量应用 */
+typedef struct {
+  irdb_parser_t parser;
+  const irdb_database_t *old;
+  const delta_remote_t *remote;
+  irdb_delta_header_t hdr;
+  uint32_t *removed; // 尚未匹配的删除项在前left个
+  size_t got;        // 文件头和删除表中已收到的字节
+  uint16_t left;
+  bool body; // 已进入CSV部分
+  uint32_t bytes;
+} delta_apply_t;
+
+static K_MUTEX_DEFINE(delta_mutex);
+
+static void delta_key(const delta_remote_t *r, irdb_cache_key_t *key) {
+  key->manufacturer = r->key;
+  key->device_type = r->key + strlen(r->key) + 1;
+  key->device = r->device;
+  key->subdevice = r->subdevice;
+  key->source = IRDB_LOAD_HTTP;
+}
+
+static int list_visit(const irdb_cache_key_t *key,
+                      const irdb_http_validator_t *validator,
+                      void *user_data) {
+  delta_list_t *list = user_data;
+  size_t mfr_len = strlen(key->manufacturer) + 1;
+  size_t type_len = strlen(key->device_type) + 1;
+
+  if (list->count == DELTA_MAX_REMOTES) {
+    list->skipped++;
+    return 0;
+  }
+
+  delta_remote_t *r = &list->remotes[list->count++];
+  memcpy(r->key, key->manufacturer, mfr_len);
+  memcpy(r->key + mfr_len, key->device_type, type_len);
+  r->device = key->device;
+  r->subdevice = key->subdevice;
+  r->hash = irdb_cache_key_hash(key);
+  r->version = validator->version;
+  return 0;
+}
+
+static void manifest_record(delta_list_t *list,
+                            const irdb_delta_record_t *rec) {
+  /* 本地遥控器不多，线性匹配；键哈希相同的都取这条记录 */
+  for (uint16_t i = 0; i < list->count; i++) {
+    delta_remote_t *r = &list->remotes[i];
+    if (r->hash == rec->key_hash) {
+      r->target_version = rec->version;
+      r->target_hash = rec->content_hash;
+    }
+  }
+}
+
+static int manifest_body(const uint8_t *data, size_t len, void *user_data) {
+  delta_manifest_t *m = user_data;
+
+  m->bytes += len;
+  while (len > 0 && (!m->have_header || m->left > 0)) {
+    size_t need = m->have_header ? sizeof(m->buf.rec) : sizeof(m->buf.hdr);
+    size_t n = MIN(len, need - m->got);
+
+    memcpy(m->buf.raw + m->got, data, n);
+    m->got += n;
+    data += n;
+    len -= n;
+    if (m->got < need) {
+      break;
+    }
+    m->got = 0;
+
+    if (m->have_header) {
+      manifest_record(m->list, &m->buf.rec);
+      m->left--;
+    } else if (m->buf.hdr.magic != IRDB_DELTA_MANIFEST_MAGIC ||
+               m->buf.hdr.format != IRDB_DELTA_FORMAT) {
+      LOG_ERR("Invalid delta manifest");
+      return -EINVAL;
+    } else {
+      m->have_header = true;
+      m->left = m->buf.hdr.count;
+    }
+  }
+  return 0;
+}
+
+/* 清单的校验信息存在flash缓存目录中，不计入缓存预算 */
+static void validator_load(irdb_http_validator_t *validator) {
+  struct fs_file_t file;
+  fs_file_t_init(&file);
+
+  if (fs_open(&file, DELTA_VALIDATOR_PATH, FS_O_READ) == 0) {
+    if (fs_read(&file, validator, sizeof(*validator)) != sizeof(*validator)) {
+      memset(validator, 0, sizeof(*validator));
+    }
+    fs_close(&file);
+  }
+}
+
+static void validator_save(const irdb_http_validator_t *validator) {
+  struct fs_file_t file;
+  fs_file_t_init(&file);
+
+  if (fs_open(&file, DELTA_VALIDATOR_PATH,
+              FS_O_CREATE | FS_O_WRITE | FS_O_TRUNC) == 0) {
+    fs_write(&file, validator, sizeof(*validator));
+    fs_close(&file);
+  }
+}
+
+/* 旧条目写成CSV行送入解析器，名称带引号并转义 */
+static int feed_entry(irdb_parser_t *parser, const irdb_database_t *db,
+                      const irdb_entry_t *e) {
+  char line[IRDB_PARSER_LINE_MAX];
+  size_t n = 0;
+
+  /* 名称中的引号加倍，转义后放不下一行时报错 */
+  line[n++] = '"';
+  for (const char *p = db->names + e->name; *p; p++) {
+    if (n + (*p == '"' ? 2 : 1) > sizeof(line)) {
+      return -E2BIG;
+    }
+    if (*p == '"') {
+      line[n++] = '"';
+    }
+    line[n++] = *p;
+  }
+
+  int len = snprintf(line + n, sizeof(line) - n, "\",%u,%u,%u,%u\n",
+                     e->protocol, e->device, e->subdevice, e->function);
+  if (len < 0 || (size_t)len >= sizeof(line) - n) {
+    return -E2BIG;
+  }
+  return irdb_parser_feed(parser, line, n + len);
+}
+
+/* 删除表收齐 - 保留的旧条目先进入新数据库 */
+static int delta_keep_old(delta_apply_t *d) {
+  const irdb_database_t *old = d->old;
+  int ret = irdb_parser_reserve(&d->parser, old->entry_count - d->left);
+
+  for (uint32_t i = 0; ret == 0 && i < old->entry_count; i++) {
+    uint32_t h = entry_hash(old, &old->entries[i]);
+    bool drop = false;
+
+    for (uint16_t j = 0; j < d->left; j++) {
+      if (d->removed[j] == h) {
+        d->removed[j] = d->removed[--d->left];
+        drop = true;
+        break;
+      }
+    }
+    if (!drop) {
+      ret = feed_entry(&d->parser, old, &old->entries[i]);
+    }
+  }
+
+  /* 要删除的条目不在旧数据库中，说明本地内容与版本不符 */
+  if (ret == 0 && d->left > 0) {
+    LOG_WRN("Delta removes %u entries not present locally", d->left);
+    ret = -EINVAL;
+  }
+  d->body = true;
+  return ret;
+}
+
+/* 文件头收齐 */
+static int delta_begin(delta_apply_t *d) {
+  const delta_remote_t *r = d->remote;
+
+  if (d->hdr.magic != IRDB_DELTA_MAGIC || d->hdr.from != r->version ||
+      d->hdr.to != r->target_version ||
+      d->hdr.content_hash != r->target_hash ||
+      d->hdr.removed_count > d->old->entry_count) {
+    LOG_WRN("Delta header does not match the manifest");
+    return -EINVAL;
+  }
+
+  d->left = d->hdr.removed_count;
+  if (d->left == 0) {
+    return delta_keep_old(d);
+  }
+
+  d->removed = irdb_heap_alloc(d->left * sizeof(uint32_t));
+  return d->removed ? 0 : -ENOMEM;
+}
+
+static int delta_body(const uint8_t *data, size_t len, void *user_data) {
+  delta_apply_t *d = user_data;
+
+  d->bytes += len;
+  while (len > 0 && !d->body) {
+    size_t n;
+    int ret = 0;
+
+    if (d->got < sizeof(d->hdr)) {
+      n = MIN(len, sizeof(d->hdr) - d->got);
+      memcpy((uint8_t *)&d->hdr + d->got, data, n);
+      d->got += n;
+      if (d->got == sizeof(d->hdr)) {
+        ret = delta_begin(d);
+      }
+    } else {
+      size_t total = sizeof(d->hdr) + d->hdr.removed_count * sizeof(uint32_t);
+      n = MIN(len, total - d->got);
+      memcpy((uint8_t *)d->removed + d->got - sizeof(d->hdr), data, n);
+      d->got += n;
+      if (d->got == total) {
+        ret = delta_keep_old(d);
+      }
+    }
+
+    if (ret < 0) {
+      return ret;
+    }
+    data += n;
+    len -= n;
+  }
+
+  return len > 0 ? irdb_parser_feed(&d->parser, (const char *)data, len) : 0;
+}
+
+/* 下载并应用增量，成功时db为新版本 */
+static int delta_patch(const delta_remote_t *r, const irdb_database_t *old,
+                       irdb_database_t *db, uint32_t *bytes) {
+  irdb_cache_key_t key;
+  char url[192];
+
+  delta_key(r, &key);
+  snprintf(url, sizeof(url), "%s/%s/%s/%u,%u.%u.delta", CONFIG_IRDB_DELTA_PATH,
+           key.manufacturer, key.device_type, key.device, key.subdevice,
+           r->version);
+
+  delta_apply_t *d = irdb_heap_calloc(1, sizeof(*d));
+  if (!d) {
+    return -ENOMEM;
+  }
+
+  irdb_parser_init(&d->parser, db, NULL);
+  d->old = old;
+  d->remote = r;
+
+  int ret = irdb_http_get(url, NULL, delta_body, d);
+  *bytes += d->bytes;
+  if (ret == 0 && !d->body) {
+    ret = -EIO; // 文件在删除表之前截断
+  }
+  if (ret < 0) {
+    d->parser.error = ret;
+  }
+
+  ret = irdb_parser_finish(&d->parser);
+  if (ret == 0 && irdb_delta_content_hash(db) != r->target_hash) {
+    LOG_WRN("Patched content hash mismatch");
+    irdb_free_database(db);
+    ret = -EBADMSG;
+  }
+
+  irdb_heap_free(d->removed);
+  irdb_heap_free(d);
+  return ret;
+}
+
+/* 更新一个过期的遥控器 */
+static int delta_update(const delta_remote_t *r, irdb_delta_stats_t *stats) {
+  irdb_cache_key_t key;
+  irdb_http_validator_t validator = {0};
+  irdb_database_t old = {0};
+  irdb_database_t db = {0};
+  irdb_database_t *hit;
+
+  delta_key(r, &key);
+  int ret = irdb_flash_cache_load(&key, &old, &validator);
+  if (ret < 0) {
+    return ret;
+  }
+
+  /* 首次同步: 内容与清单一致时只记下版本 */
+  if (r->version == 0 && irdb_delta_content_hash(&old) == r->target_hash) {
+    irdb_free_database(&old);
+    ret = irdb_flash_cache_set_version(&key, r->target_version);
+    if (ret == 0) {
+      stats->current++;
+    }
+    return ret;
+  }
+
+  ret = -ENOENT;
+  if (r->version != 0) {
+    ret = delta_patch(r, &old, &db, &stats->bytes);
+    if (ret < 0) {
+      LOG_INF("No usable delta for %s/%s %u,%u (%d), fetching in full",
+              key.manufacturer, key.device_type, key.device, key.subdevice,
+              ret);
+    }
+  }
+  irdb_free_database(&old);
+
+  /* 旧的校验信息对应旧内容，整表下载时换成新响应的 */
+  memset(validator.etag, 0, sizeof(validator.etag));
+  memset(validator.last_modified, 0, sizeof(validator.last_modified));
+
+  if (ret == 0) {
+    stats->patched++;
+  } else {
+    ret = irdb_load_from_http_cond(&db, key.manufacturer, key.device_type,
+                                   key.device, key.subdevice, &validator);
+    if (ret != 0) {
+      return ret < 0 ? ret : -EIO;
+    }
+    stats->full++;
+  }
+
+  /* 服务器上的CSV与清单不一致时不记版本，下次同步再比较 */
+  validator.version = irdb_delta_content_hash(&db) == r->target_hash
+                          ? r->target_version
+                          : 0;
+  if (validator.version == 0) {
+    LOG_WRN("%s/%s %u,%u does not match manifest version %u",
+            key.manufacturer, key.device_type, key.device, key.subdevice,
+            r->target_version);
+  }
+
+  ret = irdb_flash_cache_store(&key, &db, &validator);
+
+  /* 已在RAM缓存中的换成新数据库，旧的在最后一个引用释放时回收 */
+  if (irdb_cache_get(&key, &hit) == 0) {
+    irdb_cache_release(hit);
+    strncpy(db.manufacturer, key.manufacturer, sizeof(db.manufacturer) - 1);
+    strncpy(db.device_type, key.device_type, sizeof(db.device_type) - 1);
+    if (irdb_cache_put(&key, &db, NULL) < 0) {
+      LOG_WRN("RAM cache keeps the old %s/%s %u,%u", key.manufacturer,
+              key.device_type, key.device, key.subdevice);
+    }
+  }
+  irdb_free_database(&db);
+  return ret;
+}
+
+/* 同步flash缓存中的全部遥控器 */
+int irdb_delta_sync(irdb_delta_stats_t *stats) {
+  irdb_delta_stats_t local = {0};
+  delta_list_t list = {0};
+  irdb_http_validator_t validator = {0};
+  delta_manifest_t manifest = {.list = &list};
+  bool versioned = true;
+
+  if (sizeof(CONFIG_IRDB_DELTA_PATH) == 1) {
+    LOG_ERR("CONFIG_IRDB_DELTA_PATH not set");
+    return -ENOTSUP;
+  }
+
+  int ret = ir_fs_mount();
+  if (ret < 0) {
+    return ret;
+  }
+
+  list.remotes = irdb_heap_calloc(DELTA_MAX_REMOTES, sizeof(delta_remote_t));
+  if (!list.remotes) {
+    return -ENOMEM;
+  }
+
+  k_mutex_lock(&delta_mutex, K_FOREVER);
+
+  ret = irdb_flash_cache_foreach(list_visit, &list);
+  if (ret == -ENOENT) {
+    ret = 0; // 缓存目录尚未创建
+  }
+  if (ret < 0 || list.count == 0) {
+    goto out;
+  }
+  if (list.skipped > 0) {
+    LOG_WRN("Only the first %u of %u remotes are synced", list.count,
+            list.count + list.skipped);
+  }
+  local.checked = list.count;
+
+  /* 所有遥控器都有版本时清单可以条件请求，否则须拿到完整清单 */
+  for (uint16_t i = 0; i < list.count; i++) {
+    versioned = versioned && list.remotes[i].version != 0;
+  }
+  if (versioned) {
+    validator_load(&validator);
+  }
+
+  ret = irdb_http_get(DELTA_MANIFEST_URL, &validator, manifest_body,
+                      &manifest);
+  local.bytes += manifest.bytes;
+  if (ret == IRDB_HTTP_NOT_MODIFIED) {
+    local.current = list.count;
+    ret = 0;
+    goto out;
+  }
+  if (ret == 0 && (!manifest.have_header || manifest.left > 0)) {
+    ret = -EIO;
+  }
+  if (ret < 0) {
+    LOG_ERR("Delta manifest fetch failed: %d", ret);
+    goto out;
+  }
+
+  for (uint16_t i = 0; i < list.count; i++) {
+    const delta_remote_t *r = &list.remotes[i];
+
+    if (r->target_version == 0) {
+      continue; // 不在清单中
+    }
+    if (r->version == r->target_version) {
+      local.current++;
+      continue;
+    }
+
+    int err = delta_update(r, &local);
+    if (err < 0) {
+      local.failed++;
+      LOG_WRN("Delta sync of %s failed: %d", r->key, err);
+    }
+  }
+
+  /* 有失败的下次须拿到完整清单重试 */
+  if (local.failed == 0) {
+    validator_save(&validator);
+  }
+  ret = local.failed;
+
+out:
+  k_mutex_unlock(&delta_mutex);
+  irdb_heap_free(list.remotes);
+
+  LOG_INF("Delta sync: %u checked, %u current, %u patched, %u full, "
+          "%u failed, %u bytes",
+          local.checked, local.current, local.patched, local.full,
+          local.failed, local.bytes);
+  if (stats) {
+    *stats = local;
+  }
+  return ret;
+}
+
+#else
+int irdb_delta_sync(irdb_delta_stats_t *stats) {
+  return -ENOTSUP;
+}
+#endif
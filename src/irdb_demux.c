@@ -0,0 +1,203 @@
+/**
+ * @file irdb_demux.c
+ * @brief 帧分离实现 - 流式解码器池，外来脉冲并入space
+ */
+
+#include "irdb_demux.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/util.h>
+
+int irdb_demux_init(irdb_demux_t *dm, const uint16_t *protocols,
+                    size_t count) {
+  irdb_stream_decoder_t probe;
+
+  if (!dm || (!protocols && count > 0)) {
+    return -EINVAL;
+  }
+
+  memset(dm, 0, sizeof(*dm));
+  for (size_t i = 0; i < count && i < ARRAY_SIZE(dm->protocols); i++) {
+    if (irdb_stream_init(&probe, protocols[i]) == 0) {
+      dm->protocols[dm->protocol_count++] = protocols[i];
+    }
+  }
+  return dm->protocol_count;
+}
+
+void irdb_demux_reset(irdb_demux_t *dm) {
+  for (size_t i = 0; i < ARRAY_SIZE(dm->hyps); i++) {
+    dm->hyps[i].active = false;
+  }
+}
+
+/* 把一个时长交给假设 - 在副本上试，不匹配时假设不变 */
+static int hyp_try(irdb_demux_hyp_t *h, uint32_t duration_us, bool is_mark,
+                   irdb_entry_t *code) {
+  irdb_stream_decoder_t trial = h->dec;
+  int ret = irdb_stream_feed(&trial, duration_us, is_mark, code);
+
+  if (ret >= 0) {
+    h->dec = trial;
+  }
+  return ret;
+}
+
+/* 推进一个假设 - 返回1/IRDB_STREAM_REPEAT为解出，0继续，-ENOENT结束 */
+static int hyp_feed(irdb_demux_t *dm, irdb_demux_hyp_t *h,
+                    uint32_t duration_us, bool is_mark, irdb_entry_t *code) {
+  if (h->pending_us > 0) {
+    h->pending_us += duration_us;
+    if (is_mark) {
+      dm->stats.absorbed++;
+      return ++h->absorbed > IRDB_DEMUX_ABSORB ? -ENOENT : 0;
+    }
+
+    int ret = hyp_try(h, h->pending_us, false, code);
+    if (ret >= 0) {
+      h->pending_us = 0;
+      return ret;
+    }
+    return h->pending_us < h->limit_us ? 0 : -ENOENT;
+  }
+
+  int ret = hyp_try(h, duration_us, is_mark, code);
+  if (ret >= 0) {
+    return ret;
+  }
+
+  /* 帧中的space过短: 可能被另一帧的mark截断，开始并入 */
+  if (!is_mark && duration_us < h->limit_us &&
+      (h->dec.have_first || h->dec.bits > 0)) {
+    h->pending_us = duration_us;
+    h->absorbed = 0;
+    return 0;
+  }
+  return -ENOENT;
+}
+
+/* 空位，没有时取尚未过引导码的假设中最早的，都已在解码数据位时返回NULL */
+static irdb_demux_hyp_t *hyp_slot(irdb_demux_t *dm) {
+  irdb_demux_hyp_t *victim = NULL;
+
+  for (size_t i = 0; i < ARRAY_SIZE(dm->hyps); i++) {
+    irdb_demux_hyp_t *h = &dm->hyps[i];
+
+    if (!h->active) {
+      return h;
+    }
+    if (h->dec.bits == 0 && h->dec.state == IRDB_STREAM_HEADER &&
+        (!victim || (int32_t)(h->start - victim->start) < 0)) {
+      victim = h;
+    }
+  }
+  return victim;
+}
+
+/* 在本mark上为各协议开始新假设 */
+static void hyp_spawn(irdb_demux_t *dm, uint32_t duration_us) {
+  for (uint8_t p = 0; p < dm->protocol_count; p++) {
+    uint16_t protocol = dm->protocols[p];
+    const irdb_protocol_params_t *params = irdb_get_protocol_params(protocol);
+    irdb_demux_hyp_t fresh = {.start = dm->edge, .active = true};
+    irdb_entry_t code;
+
+    /* 无引导码的协议任何mark都可能是帧起点，同时只跟踪一个 */
+    if (params->header_mark == 0) {
+      bool live = false;
+
+      for (size_t i = 0; !live && i < ARRAY_SIZE(dm->hyps); i++) {
+        live = dm->hyps[i].active && dm->hyps[i].dec.protocol == protocol;
+      }
+      if (live) {
+        continue;
+      }
+    }
+
+    if (irdb_stream_init(&fresh.dec, protocol) < 0 ||
+        irdb_stream_feed(&fresh.dec, duration_us, true, &code) != 0 ||
+        (params->header_mark > 0 && !fresh.dec.have_first)) {
+      continue;
+    }
+
+    irdb_demux_hyp_t *slot = hyp_slot(dm);
+    if (!slot) {
+      dm->stats.full++;
+      continue;
+    }
+    fresh.limit_us = irdb_frame_end_gap(protocol);
+    *slot = fresh;
+  }
+}
+
+int irdb_demux_feed(irdb_demux_t *dm, uint32_t duration_us, bool is_mark,
+                    irdb_demux_result_t *out, size_t max) {
+  int n = 0;
+
+  if (!dm || !out) {
+    return -EINVAL;
+  }
+
+  dm->edge++;
+
+  /* 长静默 - 所有帧都已结束 */
+  if (!is_mark && duration_us >= IRDB_STREAM_IDLE_US) {
+    irdb_demux_reset(dm);
+    return 0;
+  }
+
+  for (size_t i = 0; i < ARRAY_SIZE(dm->hyps); i++) {
+    irdb_demux_hyp_t *h = &dm->hyps[i];
+    irdb_entry_t code;
+
+    if (!h->active) {
+      continue;
+    }
+
+    int ret = hyp_feed(dm, h, duration_us, is_mark, &code);
+    if (ret < 0) {
+      h->active = false;
+      continue;
+    }
+    if (ret != 1 && ret != IRDB_STREAM_REPEAT) {
+      continue;
+    }
+
+    h->active = false;
+    if ((size_t)n < max) {
+      out[n].code = code;
+      out[n].start = h->start;
+      out[n].repeat = ret == IRDB_STREAM_REPEAT;
+      n++;
+    }
+  }
+
+  /* 上一帧在本帧开始后才结束，或另有已过引导码的帧在进行，即为交叠 */
+  for (int r = 0; r < n; r++) {
+    bool overlapped = dm->stats.frames > 0 &&
+                      (int32_t)(dm->done_edge - out[r].start) > 0;
+
+    for (size_t j = 0; !overlapped && j < ARRAY_SIZE(dm->hyps); j++) {
+      const irdb_demux_hyp_t *o = &dm->hyps[j];
+
+      overlapped = o->active && o->start != out[r].start && o->dec.bits > 0;
+    }
+    out[r].overlapped = overlapped;
+  }
+
+  if (is_mark) {
+    hyp_spawn(dm, duration_us);
+  }
+  return n;
+}
+
+void irdb_demux_settle(irdb_demux_t *dm, const irdb_demux_result_t *result) {
+  for (size_t i = 0; i < ARRAY_SIZE(dm->hyps); i++) {
+    if (dm->hyps[i].start == result->start) {
+      dm->hyps[i].active = false;
+    }
+  }
+  dm->done_edge = dm->edge;
+  dm->stats.frames++;
+  dm->stats.overlapped += result->overlapped;
+}
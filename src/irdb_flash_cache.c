@@ -0,0 +1,475 @@
+/**
+ * @file irdb_flash_cache.c
+ * @brief IRDB flash缓存实现
+ *
+ * 文件布局: flash_cache_meta_t + 二进制镜像(irdb_image.h)
+ * 写入先落到临时文件再改名，掉电不会留下半个镜像。
+ */
+
+#include "irdb_flash_cache.h"
+#include "ir_fs.h"
+#include "irdb_image.h"
+#include "irdb_store.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#ifdef CONFIG_IRDB_FLASH_CACHE
+#include <zephyr/fs/fs.h>
+#endif
+
+LOG_MODULE_REGISTER(irdb_flash_cache, LOG_LEVEL_INF);
+
+#ifdef CONFIG_IRDB_FLASH_CACHE
+
+#define FLASH_CACHE_MAGIC 0x32465249 // "IRF2"，文件头带版本号
+#define FLASH_CACHE_PATH_MAX 48
+
+/* 文件头 */
+typedef struct {
+  uint32_t magic;     // FLASH_CACHE_MAGIC
+  uint32_t last_used; // 访问序号，按差值比较，LRU修剪用
+  uint8_t device;
+  uint8_t subdevice;
+  uint16_t reserved;
+  char key[IRDB_FLASH_CACHE_KEY_MAX]; // manufacturer和device_type，以'\0'分隔
+  irdb_http_validator_t validator;
+} flash_cache_meta_t;
+
+static uint32_t flash_seq;
+static bool flash_seq_valid;
+static K_MUTEX_DEFINE(flash_mutex);
+
+static void flash_cache_path(char *path, size_t size, uint32_t hash,
+                             const char *ext) {
+  snprintf(path, size, "%s/%08x.%s", IRDB_FLASH_CACHE_DIR, hash, ext);
+}
+
+/* 键写入文件头，过长返回-ENAMETOOLONG */
+static int meta_set_key(flash_cache_meta_t *meta, const irdb_cache_key_t *key) {
+  size_t mfr_len = strlen(key->manufacturer) + 1;
+  size_t type_len = strlen(key->device_type) + 1;
+
+  if (mfr_len + type_len > sizeof(meta->key)) {
+    return -ENAMETOOLONG;
+  }
+
+  memset(meta, 0, sizeof(*meta));
+  meta->magic = FLASH_CACHE_MAGIC;
+  meta->device = key->device;
+  meta->subdevice = key->subdevice;
+  memcpy(meta->key, key->manufacturer, mfr_len);
+  memcpy(meta->key + mfr_len, key->device_type, type_len);
+  return 0;
+}
+
+/* 哈希相同的不同遥控器共用文件名，须比对完整键 */
+static bool meta_key_equal(const flash_cache_meta_t *a,
+                           const flash_cache_meta_t *b) {
+  return a->magic == b->magic && a->device == b->device &&
+         a->subdevice == b->subdevice &&
+         memcmp(a->key, b->key, sizeof(a->key)) == 0;
+}
+
+static int read_exact(struct fs_file_t *file, void *buf, size_t len) {
+  ssize_t ret = fs_read(file, buf, len);
+  return ret == (ssize_t)len ? 0 : (ret < 0 ? ret : -EIO);
+}
+
+static int write_exact(struct fs_file_t *file, const void *buf, size_t len) {
+  ssize_t ret = fs_write(file, buf, len);
+  return ret == (ssize_t)len ? 0 : (ret < 0 ? ret : -ENOSPC);
+}
+
+/* 遍历缓存目录，cb返回非0时停止。调用者须持有flash_mutex */
+typedef int (*flash_cache_visit_t)(const char *path, size_t size,
+                                   const flash_cache_meta_t *meta,
+                                   void *user_data);
+
+static int flash_cache_foreach(flash_cache_visit_t cb, void *user_data) {
+  struct fs_dir_t dir;
+  struct fs_dirent entry;
+  fs_dir_t_init(&dir);
+
+  int ret = fs_opendir(&dir, IRDB_FLASH_CACHE_DIR);
+  if (ret < 0) {
+    return ret;
+  }
+
+  while (fs_readdir(&dir, &entry) == 0 && entry.name[0] != '\0') {
+    size_t len = strlen(entry.name);
+    char path[FLASH_CACHE_PATH_MAX];
+    flash_cache_meta_t meta = {0};
+    struct fs_file_t file;
+
+    if (entry.type != FS_DIR_ENTRY_FILE || len < 4 ||
+        strcmp(entry.name + len - 4, ".img") != 0) {
+      continue;
+    }
+
+    snprintf(path, sizeof(path), "%s/%s", IRDB_FLASH_CACHE_DIR, entry.name);
+    fs_file_t_init(&file);
+    if (fs_open(&file, path, FS_O_READ) == 0) {
+      read_exact(&file, &meta, sizeof(meta));
+      fs_close(&file);
+    }
+
+    ret = cb(path, entry.size, &meta, user_data);
+    if (ret != 0) {
+      break;
+    }
+  }
+
+  fs_closedir(&dir);
+  return ret < 0 ? ret : 0;
+}
+
+static int seq_visit(const char *path, size_t size,
+                     const flash_cache_meta_t *meta, void *user_data) {
+  /* 以距当前最远的序号为起点，保证新访问的序号差值最大 */
+  if (meta->magic == FLASH_CACHE_MAGIC &&
+      (int32_t)(meta->last_used - flash_seq) > 0) {
+    flash_seq = meta->last_used;
+  }
+  return 0;
+}
+
+/* 首次使用时从已有文件恢复访问序号。调用者须持有flash_mutex */
+static uint32_t flash_next_seq(void) {
+  if (!flash_seq_valid) {
+    flash_cache_foreach(seq_visit, NULL);
+    flash_seq_valid = true;
+  }
+  return ++flash_seq;
+}
+
+/* 读取缓存的数据库 */
+int irdb_flash_cache_load(const irdb_cache_key_t *key, irdb_database_t *db,
+                          irdb_http_validator_t *validator) {
+  if (!key || !key->manufacturer || !key->device_type || !db) {
+    return -EINVAL;
+  }
+
+  flash_cache_meta_t expect;
+  flash_cache_meta_t meta;
+  char path[FLASH_CACHE_PATH_MAX];
+  struct fs_file_t file;
+
+  int ret = meta_set_key(&expect, key);
+  if (ret < 0) {
+    return ret;
+  }
+
+  ret = ir_fs_mount();
+  if (ret < 0) {
+    return ret;
+  }
+
+  flash_cache_path(path, sizeof(path), irdb_cache_key_hash(key), "img");
+  fs_file_t_init(&file);
+
+  k_mutex_lock(&flash_mutex, K_FOREVER);
+
+  ret = fs_open(&file, path, FS_O_RDWR);
+  if (ret < 0) {
+    k_mutex_unlock(&flash_mutex);
+    return -ENOENT;
+  }
+
+  memset(db, 0, sizeof(*db));
+  ret = read_exact(&file, &meta, sizeof(meta));
+  if (ret == 0 && !meta_key_equal(&meta, &expect)) {
+    ret = -ENOENT;
+  }
+  if (ret == 0) {
+    ret = irdb_image_read_file(&file, db);
+    if (ret == -EINVAL) {
+      LOG_WRN("Corrupt flash cache file %s", path);
+    }
+  }
+
+  /* 更新访问序号 */
+  if (ret == 0) {
+    meta.last_used = flash_next_seq();
+    if (fs_seek(&file, offsetof(flash_cache_meta_t, last_used),
+                FS_SEEK_SET) == 0) {
+      write_exact(&file, &meta.last_used, sizeof(meta.last_used));
+    }
+  }
+
+  fs_close(&file);
+
+  /* 损坏或截断的文件直接删除，下次重新下载 */
+  if (ret == -EINVAL || ret == -EIO) {
+    fs_unlink(path);
+  }
+  k_mutex_unlock(&flash_mutex);
+
+  if (ret < 0) {
+    irdb_free_database(db);
+    return ret;
+  }
+
+  if (validator) {
+    *validator = meta.validator;
+  }
+
+  LOG_INF("Flash cache hit: %s/%s %u,%u (%u entries)", key->manufacturer,
+          key->device_type, key->device, key->subdevice, db->entry_count);
+  return 0;
+}
+
+/* LRU修剪 - 统计总大小并找出最久未用的文件 */
+typedef struct {
+  size_t total;
+  uint32_t oldest_age;
+  char oldest[FLASH_CACHE_PATH_MAX];
+} flash_prune_t;
+
+static int prune_visit(const char *path, size_t size,
+                       const flash_cache_meta_t *meta, void *user_data) {
+  flash_prune_t *prune = user_data;
+  /* 无法识别的文件视为最旧 */
+  uint32_t age = meta->magic == FLASH_CACHE_MAGIC
+                     ? flash_seq - meta->last_used
+                     : UINT32_MAX;
+
+  prune->total += size;
+  if (!prune->oldest[0] || age > prune->oldest_age) {
+    prune->oldest_age = age;
+    strncpy(prune->oldest, path, sizeof(prune->oldest) - 1);
+  }
+  return 0;
+}
+
+/* 调用者须持有flash_mutex */
+static void flash_cache_prune(size_t budget) {
+  for (;;) {
+    flash_prune_t prune = {0};
+
+    if (flash_cache_foreach(prune_visit, &prune) < 0 ||
+        prune.total <= budget || !prune.oldest[0]) {
+      return;
+    }
+
+    LOG_INF("Flash cache prune: %s", prune.oldest);
+    if (fs_unlink(prune.oldest) < 0) {
+      return;
+    }
+  }
+}
+
+/* 保存数据库 */
+int irdb_flash_cache_store(const irdb_cache_key_t *key,
+                           const irdb_database_t *db,
+                           const irdb_http_validator_t *validator) {
+  if (!key || !key->manufacturer || !key->device_type || !db) {
+    return -EINVAL;
+  }
+
+  flash_cache_meta_t meta;
+  irdb_image_header_t hdr;
+  char path[FLASH_CACHE_PATH_MAX];
+  char tmp_path[FLASH_CACHE_PATH_MAX];
+  struct fs_file_t file;
+
+  int ret = meta_set_key(&meta, key);
+  if (ret == 0) {
+    ret = irdb_image_header_init(&hdr, db);
+  }
+  if (ret == 0) {
+    ret = ir_fs_mount();
+  }
+  if (ret < 0) {
+    return ret;
+  }
+
+  if (sizeof(meta) + hdr.size > IRDB_FLASH_CACHE_BYTES) {
+    return -ENOMEM;
+  }
+
+  if (validator) {
+    meta.validator = *validator;
+  }
+
+  uint32_t hash = irdb_cache_key_hash(key);
+  flash_cache_path(path, sizeof(path), hash, "img");
+  flash_cache_path(tmp_path, sizeof(tmp_path), hash, "tmp");
+  fs_file_t_init(&file);
+
+  k_mutex_lock(&flash_mutex, K_FOREVER);
+
+  fs_mkdir(IRDB_FLASH_CACHE_DIR);
+  meta.last_used = flash_next_seq();
+
+  ret = fs_open(&file, tmp_path, FS_O_CREATE | FS_O_WRITE | FS_O_TRUNC);
+  if (ret < 0) {
+    k_mutex_unlock(&flash_mutex);
+    LOG_ERR("Failed to create %s: %d", tmp_path, ret);
+    return ret;
+  }
+
+  ret = write_exact(&file, &meta, sizeof(meta));
+  if (ret == 0) {
+    ret = irdb_image_write_file(&file, db);
+  }
+  fs_close(&file);
+
+  /* LittleFS的rename不覆盖已存在的目标 */
+  if (ret == 0) {
+    fs_unlink(path);
+    ret = fs_rename(tmp_path, path);
+  }
+  if (ret < 0) {
+    fs_unlink(tmp_path);
+    LOG_ERR("Failed to write flash cache %s: %d", path, ret);
+  } else {
+    flash_cache_prune(IRDB_FLASH_CACHE_BYTES);
+    LOG_INF("Flash cache stored: %s/%s %u,%u (%u bytes)", key->manufacturer,
+            key->device_type, key->device, key->subdevice,
+            (unsigned)(sizeof(meta) + hdr.size));
+  }
+
+  k_mutex_unlock(&flash_mutex);
+  return ret;
+}
+
+/* 只更新版本号 */
+int irdb_flash_cache_set_version(const irdb_cache_key_t *key,
+                                 uint32_t version) {
+  if (!key || !key->manufacturer || !key->device_type) {
+    return -EINVAL;
+  }
+
+  flash_cache_meta_t expect;
+  flash_cache_meta_t meta;
+  char path[FLASH_CACHE_PATH_MAX];
+  struct fs_file_t file;
+
+  int ret = meta_set_key(&expect, key);
+  if (ret == 0) {
+    ret = ir_fs_mount();
+  }
+  if (ret < 0) {
+    return ret;
+  }
+
+  flash_cache_path(path, sizeof(path), irdb_cache_key_hash(key), "img");
+  fs_file_t_init(&file);
+
+  k_mutex_lock(&flash_mutex, K_FOREVER);
+
+  if (fs_open(&file, path, FS_O_RDWR) < 0) {
+    k_mutex_unlock(&flash_mutex);
+    return -ENOENT;
+  }
+
+  ret = read_exact(&file, &meta, sizeof(meta));
+  if (ret == 0 && !meta_key_equal(&meta, &expect)) {
+    ret = -ENOENT;
+  }
+  if (ret == 0) {
+    ret = fs_seek(&file,
+                  offsetof(flash_cache_meta_t, validator) +
+                      offsetof(irdb_http_validator_t, version),
+                  FS_SEEK_SET);
+  }
+  if (ret == 0) {
+    ret = write_exact(&file, &version, sizeof(version));
+  }
+
+  fs_close(&file);
+  k_mutex_unlock(&flash_mutex);
+  return ret;
+}
+
+typedef struct {
+  irdb_flash_cache_cb_t cb;
+  void *user_data;
+} flash_list_t;
+
+static int list_visit(const char *path, size_t size,
+                      const flash_cache_meta_t *meta, void *user_data) {
+  flash_list_t *list = user_data;
+  size_t mfr_len = strnlen(meta->key, sizeof(meta->key));
+
+  /* 未识别或键不完整的文件跳过 */
+  if (meta->magic != FLASH_CACHE_MAGIC || mfr_len + 1 >= sizeof(meta->key) ||
+      strnlen(meta->key + mfr_len + 1, sizeof(meta->key) - mfr_len - 1) ==
+          sizeof(meta->key) - mfr_len - 1) {
+    return 0;
+  }
+
+  irdb_cache_key_t key = {
+      .manufacturer = meta->key,
+      .device_type = meta->key + mfr_len + 1,
+      .device = meta->device,
+      .subdevice = meta->subdevice,
+      .source = IRDB_LOAD_HTTP,
+  };
+  return list->cb(&key, &meta->validator, list->user_data);
+}
+
+/* 遍历缓存的遥控器 */
+int irdb_flash_cache_foreach(irdb_flash_cache_cb_t cb, void *user_data) {
+  flash_list_t list = {cb, user_data};
+
+  if (!cb) {
+    return -EINVAL;
+  }
+
+  int ret = ir_fs_mount();
+  if (ret < 0) {
+    return ret;
+  }
+
+  k_mutex_lock(&flash_mutex, K_FOREVER);
+  ret = flash_cache_foreach(list_visit, &list);
+  k_mutex_unlock(&flash_mutex);
+  return ret;
+}
+
+static int clear_visit(const char *path, size_t size,
+                       const flash_cache_meta_t *meta, void *user_data) {
+  fs_unlink(path);
+  return 0;
+}
+
+/* 删除全部缓存文件 */
+void irdb_flash_cache_clear(void) {
+  if (ir_fs_mount() < 0) {
+    return;
+  }
+
+  k_mutex_lock(&flash_mutex, K_FOREVER);
+  flash_cache_foreach(clear_visit, NULL);
+  k_mutex_unlock(&flash_mutex);
+  LOG_INF("Flash cache cleared");
+}
+
+#else
+int irdb_flash_cache_load(const irdb_cache_key_t *key, irdb_database_t *db,
+                          irdb_http_validator_t *validator) {
+  return -ENOTSUP;
+}
+
+int irdb_flash_cache_store(const irdb_cache_key_t *key,
+                           const irdb_database_t *db,
+                           const irdb_http_validator_t *validator) {
+  return -ENOTSUP;
+}
+
+int irdb_flash_cache_set_version(const irdb_cache_key_t *key,
+                                 uint32_t version) {
+  return -ENOTSUP;
+}
+
+int irdb_flash_cache_foreach(irdb_flash_cache_cb_t cb, void *user_data) {
+  return -ENOTSUP;
+}
+
+void irdb_flash_cache_clear(void) {}
+#endif
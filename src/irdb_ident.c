@@ -0,0 +1,137 @@
+/**
+ * @file irdb_ident.c
+ * @brief 遥控器识别索引查找
+ */
+
+#include "irdb_ident.h"
+#include <errno.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/toolchain.h>
+
+LOG_MODULE_REGISTER(irdb_ident, LOG_LEVEL_INF);
+
+/* 索引中的结构直接按C结构访问，须与scripts/irdb_ident.py一致 */
+BUILD_ASSERT(sizeof(irdb_ident_header_t) == 24, "ident header changed");
+BUILD_ASSERT(sizeof(irdb_ident_key_t) == 12, "ident key layout changed");
+BUILD_ASSERT(sizeof(irdb_ident_path_t) == 6, "ident path layout changed");
+
+/* 各段位置 */
+typedef struct {
+  const irdb_ident_key_t *keys;
+  const irdb_ident_path_t *paths;
+  const uint16_t *refs;
+  const char *strings;
+} ident_view_t;
+
+bool irdb_ident_is_valid(const void *index) {
+  const irdb_ident_header_t *hdr = index;
+
+  return hdr && hdr->magic == IRDB_IDENT_MAGIC &&
+         hdr->version == IRDB_IDENT_VERSION;
+}
+
+/* 校验长度并定位各段 */
+static int ident_view(const irdb_ident_header_t *hdr, ident_view_t *view) {
+  size_t keys_off = sizeof(*hdr);
+  size_t paths_off = keys_off + hdr->key_count * sizeof(irdb_ident_key_t);
+  size_t refs_off = paths_off + hdr->path_count * sizeof(irdb_ident_path_t);
+  size_t strings_off = refs_off + hdr->ref_count * sizeof(uint16_t);
+
+  const char *strings = (const char *)hdr + strings_off;
+
+  if (strings_off + hdr->strings_len > hdr->size ||
+      (hdr->strings_len == 0 && hdr->path_count > 0) ||
+      (hdr->strings_len > 0 && strings[hdr->strings_len - 1] != '\0')) {
+    LOG_ERR("Corrupt IRDB ident index");
+    return -EINVAL;
+  }
+
+  const uint8_t *base = (const uint8_t *)hdr;
+
+  view->keys = (const irdb_ident_key_t *)(base + keys_off);
+  view->paths = (const irdb_ident_path_t *)(base + paths_off);
+  view->refs = (const uint16_t *)(base + refs_off);
+  view->strings = strings;
+  return 0;
+}
+
+/* 键比较 - 与生成器的排序一致 */
+static int key_compare(const irdb_ident_key_t *key, const irdb_entry_t *code) {
+  if (key->protocol != code->protocol) {
+    return key->protocol < code->protocol ? -1 : 1;
+  }
+  if (key->device != code->device) {
+    return key->device < code->device ? -1 : 1;
+  }
+  if (key->subdevice != code->subdevice) {
+    return key->subdevice < code->subdevice ? -1 : 1;
+  }
+  return 0;
+}
+
+int irdb_identify(const void *index, const irdb_entry_t *code,
+                  irdb_ident_candidate_t *out, size_t max) {
+  if (!irdb_ident_is_valid(index) || !code || (max > 0 && !out)) {
+    return -EINVAL;
+  }
+
+  const irdb_ident_header_t *hdr = index;
+  ident_view_t view;
+
+  int ret = ident_view(hdr, &view);
+  if (ret < 0) {
+    return ret;
+  }
+
+  uint32_t lo = 0, hi = hdr->key_count;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    int cmp = key_compare(&view.keys[mid], code);
+
+    if (cmp == 0) {
+      lo = mid;
+      break;
+    }
+    if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo >= hdr->key_count || key_compare(&view.keys[lo], code) != 0) {
+    return 0;
+  }
+
+  const irdb_ident_key_t *key = &view.keys[lo];
+  if (key->first_ref + key->ref_count > hdr->ref_count) {
+    return -EINVAL;
+  }
+
+  for (size_t i = 0; i < key->ref_count && i < max; i++) {
+    uint16_t ref = view.refs[key->first_ref + i];
+    if (ref >= hdr->path_count) {
+      return -EINVAL;
+    }
+
+    const irdb_ident_path_t *path = &view.paths[ref];
+    if (path->manufacturer >= hdr->strings_len ||
+        path->device_type >= hdr->strings_len) {
+      return -EINVAL;
+    }
+
+    out[i].manufacturer = view.strings + path->manufacturer;
+    out[i].device_type = view.strings + path->device_type;
+    out[i].device = path->device;
+    out[i].subdevice = path->subdevice;
+  }
+  return key->ref_count;
+}
+
+#ifdef CONFIG_IRDB_IDENT_INDEX
+/* 由scripts/irdb_ident.py生成 */
+extern const uint8_t irdb_ident_index[];
+
+const void *irdb_ident_builtin(void) { return irdb_ident_index; }
+#else
+const void *irdb_ident_builtin(void) { return NULL; }
+#endif
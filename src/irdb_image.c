@@ -0,0 +1,135 @@
+/**
+ * @file irdb_image.c
+ * @brief IRDB二进制镜像加载
+ */
+
+#include "irdb_image.h"
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/toolchain.h>
+
+LOG_MODULE_REGISTER(irdb_image, LOG_LEVEL_INF);
+
+/* 镜像中的条目直接按irdb_entry_t访问 */
+BUILD_ASSERT(sizeof(irdb_entry_t) == 10, "irdb_entry_t layout changed");
+BUILD_ASSERT(sizeof(irdb_image_header_t) == 36, "image header layout changed");
+
+/* 判断是否为镜像 */
+bool irdb_image_is_valid(const void *data) {
+  const irdb_image_header_t *hdr = data;
+
+  return hdr && hdr->magic == IRDB_IMAGE_MAGIC &&
+         hdr->version == IRDB_IMAGE_VERSION;
+}
+
+/* 打开镜像 */
+int irdb_image_open(irdb_database_t *db, const void *data) {
+  if (!db || !data) {
+    return -EINVAL;
+  }
+
+  const irdb_image_header_t *hdr = data;
+
+  if (!irdb_image_is_valid(hdr)) {
+    LOG_ERR("Not an IRDB image");
+    return -EINVAL;
+  }
+
+  if (hdr->protocol_count > IRDB_MAX_DB_PROTOCOLS ||
+      (hdr->index_size & (hdr->index_size - 1)) != 0) {
+    LOG_ERR("Corrupt IRDB image header");
+    return -EINVAL;
+  }
+
+  size_t entries_off = sizeof(*hdr);
+  size_t slots_off = entries_off + hdr->entry_count * sizeof(irdb_entry_t);
+  size_t names_off = slots_off + 2 * hdr->index_size * sizeof(uint16_t);
+
+  if (names_off + hdr->names_len > hdr->size) {
+    LOG_ERR("Truncated IRDB image");
+    return -EINVAL;
+  }
+
+  const uint8_t *base = data;
+
+  memset(db, 0, sizeof(*db));
+  db->image = data;
+  db->entries = (irdb_entry_t *)(base + entries_off);
+  db->entry_count = hdr->entry_count;
+  db->names = (char *)(base + names_off);
+  db->names_len = hdr->names_len;
+
+  memcpy(db->protocols, hdr->protocols, sizeof(db->protocols));
+  db->protocol_count = hdr->protocol_count;
+
+  if (hdr->index_size > 0) {
+    db->hash_slots = (uint16_t *)(base + slots_off);
+    db->name_slots = db->hash_slots + hdr->index_size;
+    db->hash_mask = hdr->index_size - 1;
+  }
+
+  LOG_INF("Opened IRDB image: %u entries, %u bytes", db->entry_count,
+          hdr->size);
+  return 0;
+}
+
+/* 填写镜像头 */
+int irdb_image_header_init(irdb_image_header_t *hdr,
+                           const irdb_database_t *db) {
+  if (!hdr || !db) {
+    return -EINVAL;
+  }
+
+  uint32_t index_size = db->hash_slots ? db->hash_mask + 1 : 0;
+
+  if (db->entry_count >= UINT16_MAX || db->names_len > UINT16_MAX ||
+      index_size > UINT16_MAX) {
+    return -E2BIG;
+  }
+
+  memset(hdr, 0, sizeof(*hdr));
+  hdr->magic = IRDB_IMAGE_MAGIC;
+  hdr->version = IRDB_IMAGE_VERSION;
+  hdr->entry_count = db->entry_count;
+  hdr->names_len = db->names_len;
+  hdr->index_size = index_size;
+  hdr->protocol_count = db->protocol_count;
+  memcpy(hdr->protocols, db->protocols, sizeof(hdr->protocols));
+  hdr->size = sizeof(*hdr) + db->entry_count * sizeof(irdb_entry_t) +
+              2 * index_size * sizeof(uint16_t) + db->names_len;
+  return 0;
+}
+
+#ifdef CONFIG_IRDB_BUILTIN_REMOTES
+/* 由scripts/irdb_image.py --registry生成 */
+extern const irdb_builtin_remote_t irdb_builtin_remotes[];
+extern const size_t irdb_builtin_remote_count;
+
+/* 按序号获取内置遥控器 */
+const irdb_builtin_remote_t *irdb_builtin_get(size_t index) {
+  return index < irdb_builtin_remote_count ? &irdb_builtin_remotes[index]
+                                           : NULL;
+}
+#else
+const irdb_builtin_remote_t *irdb_builtin_get(size_t index) { return NULL; }
+#endif
+
+/* 查找内置遥控器 */
+const void *irdb_builtin_find(const char *manufacturer,
+                              const char *device_type, uint8_t device,
+                              uint8_t subdevice) {
+  if (!manufacturer || !device_type) {
+    return NULL;
+  }
+
+  const irdb_builtin_remote_t *remote;
+  for (size_t i = 0; (remote = irdb_builtin_get(i)) != NULL; i++) {
+    if (remote->device == device && remote->subdevice == subdevice &&
+        strcmp(remote->manufacturer, manufacturer) == 0 &&
+        strcmp(remote->device_type, device_type) == 0) {
+      return remote->image;
+    }
+  }
+
+  return NULL;
+}
@@ -0,0 +1,433 @@
+/**
+ * @file irdb_irp.c
+ * @brief IRP协议字节码解释器
+ *
+ * 编码按指令逐段输出时序，相邻同电平合并; 解码按同一程序逐沿比对，
+ * 位形态的4个窗口每帧算一次，字段位在紧凑循环中按窗口命中组合判定，
+ * 与irdb_protocol.c中手写协议的解码方式相同。
+ */
+
+#include "irdb_irp.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_REGISTER(irdb_irp, LOG_LEVEL_INF);
+
+/* 各指令的字节数(含操作码)，0为非法指令 */
+static const uint8_t op_sizes[] = {
+    [IRP_OP_END] = 1,   [IRP_OP_MARK] = 4,  [IRP_OP_SPACE] = 4,
+    [IRP_OP_EXTENT] = 4, [IRP_OP_FIELD] = 4, [IRP_OP_CONST] = 6,
+    [IRP_OP_REPEAT] = 1,
+};
+
+/* 变量位宽上限 (与irdb_entry_t的字段对应) */
+static const uint8_t var_limits[] = {
+    [IRP_VAR_D] = 16,
+    [IRP_VAR_S] = 16,
+    [IRP_VAR_F] = 16,
+    [IRP_VAR_T] = 1,
+};
+
+static inline uint32_t get24(const uint8_t *p) {
+  return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16;
+}
+
+static inline uint32_t get32(const uint8_t *p) {
+  return get24(p) | (uint32_t)p[3] << 24;
+}
+
+static inline uint32_t field_mask(uint8_t width) {
+  return width >= 32 ? UINT32_MAX : BIT(width) - 1;
+}
+
+/* 段在END、REPEAT或EXTENT处结束 */
+static inline bool section_end(const uint8_t *pc) {
+  return *pc == IRP_OP_END || *pc == IRP_OP_REPEAT || *pc == IRP_OP_EXTENT;
+}
+
+/* 首帧段或重复码段的第一条指令，没有重复码段返回NULL */
+static const uint8_t *section_of(const uint8_t *program, bool repeat) {
+  const uint8_t *pc = program + IRP_HEADER_SIZE;
+
+  if (!repeat) {
+    return pc;
+  }
+  if (!(program[0] & IRP_FLAG_REPEAT)) {
+    return NULL;
+  }
+  while (*pc != IRP_OP_REPEAT) {
+    pc += op_sizes[*pc];
+  }
+  return pc + 1;
+}
+
+/* 检查程序结构 */
+int irdb_irp_check(const uint8_t *program) {
+  if (!program) {
+    return -EINVAL;
+  }
+
+  bool repeat = false;
+  uint32_t pos = IRP_HEADER_SIZE;
+
+  while (pos < IRP_PROGRAM_MAX) {
+    const uint8_t *pc = program + pos;
+    uint8_t op = *pc;
+
+    if (op >= ARRAY_SIZE(op_sizes) || op_sizes[op] == 0) {
+      return -EINVAL;
+    }
+    if (op == IRP_OP_END) {
+      return repeat == !!(program[0] & IRP_FLAG_REPEAT) ? 0 : -EINVAL;
+    }
+    if (op == IRP_OP_REPEAT) {
+      if (repeat) {
+        return -EINVAL;
+      }
+      repeat = true;
+    } else if (op == IRP_OP_FIELD) {
+      uint8_t var = pc[1] & IRP_FIELD_VAR_MASK;
+      if (pc[2] == 0 || pc[2] + pc[3] > var_limits[var]) {
+        return -EINVAL;
+      }
+    } else if (op == IRP_OP_CONST && (pc[1] == 0 || pc[1] > 32)) {
+      return -EINVAL;
+    }
+    pos += op_sizes[op];
+  }
+  return -E2BIG;
+}
+
+/* 编码输出 - 时序从mark开始交替，同电平合并，帧前的space丢弃 */
+typedef struct {
+  ir_timing_t *out;
+  uint32_t idx;
+  uint32_t max;
+  uint32_t last_us; // 最后一个时序的微秒数(合并用)
+  int err;
+} irp_emitter_t;
+
+static void emit(irp_emitter_t *e, bool mark, uint32_t us) {
+  if (e->idx == 0 && !mark) {
+    return;
+  }
+
+  if (e->idx > 0 && ((e->idx & 1) == 1) == mark) {
+    e->last_us += us;
+    e->out[e->idx - 1] = ir_timing_pack(e->last_us);
+    return;
+  }
+
+  if (e->idx >= e->max) {
+    e->err = -ENOMEM;
+    return;
+  }
+  e->last_us = us;
+  e->out[e->idx++] = ir_timing_pack(us);
+}
+
+static void emit_bits(irp_emitter_t *e, const uint8_t *program,
+                      uint32_t value, uint8_t width) {
+  bool msb = program[0] & IRP_FLAG_MSB;
+
+  for (uint8_t i = 0; i < width; i++) {
+    uint32_t bit = (value >> (msb ? width - 1 - i : i)) & 1;
+    const uint8_t *sym = program + 1 + 6 * bit;
+
+    emit(e, true, get24(sym));
+    emit(e, false, get24(sym + 3));
+  }
+}
+
+/* 编码首帧或重复码段 */
+int irdb_irp_encode(const irdb_protocol_params_t *params,
+                    const irdb_entry_t *entry, uint8_t toggle, bool repeat,
+                    ir_timing_t *timings_out, uint32_t *length_out,
+                    uint32_t max_length) {
+  const uint8_t *program = params->program;
+
+  if (repeat && (program[0] & IRP_FLAG_REPEAT_DATA)) {
+    return -ENOTSUP;
+  }
+  const uint8_t *pc = section_of(program, repeat);
+  if (!pc) {
+    return -ENOTSUP;
+  }
+
+  const uint32_t vars[] = {
+      [IRP_VAR_D] = entry->device,
+      [IRP_VAR_S] = entry->subdevice,
+      [IRP_VAR_F] = entry->function,
+      [IRP_VAR_T] = toggle & 1,
+  };
+  irp_emitter_t e = {.out = timings_out, .max = max_length};
+
+  /* EXTENT补齐的space就是帧间隔，不输出 */
+  for (; !section_end(pc); pc += op_sizes[*pc]) {
+    switch (*pc) {
+    case IRP_OP_MARK:
+    case IRP_OP_SPACE:
+      emit(&e, *pc == IRP_OP_MARK, get24(pc + 1));
+      break;
+    case IRP_OP_FIELD: {
+      uint32_t value = vars[pc[1] & IRP_FIELD_VAR_MASK] >> pc[3];
+      if (pc[1] & IRP_FIELD_INVERT) {
+        value = ~value;
+      }
+      emit_bits(&e, program, value & field_mask(pc[2]), pc[2]);
+      break;
+    }
+    case IRP_OP_CONST:
+      emit_bits(&e, program, get32(pc + 2), pc[1]);
+      break;
+    }
+  }
+
+  if (e.err < 0) {
+    return e.err;
+  }
+
+  /* 帧尾的space并入帧间隔 */
+  if (e.idx > 0 && (e.idx & 1) == 0) {
+    e.idx--;
+  }
+  *length_out = e.idx;
+  return 0;
+}
+
+/* 时序窗口 - 同irdb_protocol.c，一次无符号比较判定 */
+typedef struct {
+  uint32_t lo;
+  uint32_t span;
+} irp_window_t;
+
+static irp_window_t window_for(uint32_t expected) {
+  uint32_t tolerance = expected * IRDB_TIMING_TOLERANCE / 100;
+
+  return (irp_window_t){.lo = expected - tolerance, .span = 2 * tolerance};
+}
+
+static inline bool in_window(irp_window_t win, uint32_t us) {
+  return us - win.lo <= win.span;
+}
+
+/* 两个位形态的命中组合 -> 位值: 都不中为-1，窗口重叠时取0 */
+static const int8_t symbol_bit[4] = {-1, 0, 1, 0};
+
+/* 解码状态 - 变量按位记录已解出的部分，重复出现时须一致 */
+typedef struct {
+  const uint8_t *program;
+  irp_window_t bits[4]; // 0的mark/space，1的mark/space
+  uint32_t vars[4];
+  uint32_t known[4];
+} irp_matcher_t;
+
+/* 解出width位，段末字段的最后一个space是帧间静默，不比对也不消耗 */
+static int match_bits(const irp_matcher_t *m, const ir_timing_t *timings,
+                      uint32_t length, uint32_t *idx, uint32_t *elapsed,
+                      uint8_t width, bool last, uint32_t *value_out) {
+  bool msb = m->program[0] & IRP_FLAG_MSB;
+  uint32_t value = 0;
+
+  for (uint8_t i = 0; i < width; i++) {
+    if (*idx >= length) {
+      return -ENOENT;
+    }
+
+    uint32_t mark = ir_timing_us(timings[*idx]);
+    bool tail = *idx + 1 >= length || (last && i == width - 1);
+    uint32_t space = tail ? 0 : ir_timing_us(timings[*idx + 1]);
+    bool zero = in_window(m->bits[0], mark) &&
+                (tail || in_window(m->bits[1], space));
+    bool one = in_window(m->bits[2], mark) &&
+               (tail || in_window(m->bits[3], space));
+    int bit = symbol_bit[zero | one << 1];
+
+    if (bit < 0) {
+      return -ENOENT;
+    }
+    value |= (uint32_t)bit << (msb ? width - 1 - i : i);
+    *elapsed += mark + space;
+    *idx += tail ? 1 : 2;
+  }
+
+  *value_out = value;
+  return 0;
+}
+
+/* 按一段指令匹配时序 - 段尾的space(或补齐)是帧间静默: 帧在此结束时
+ * 不需要它，后面还有时序(连着的下一帧)时它不能短于标称值，之后的忽略 */
+static int match_section(irp_matcher_t *m, const uint8_t *pc,
+                         const ir_timing_t *timings, uint32_t length) {
+  uint32_t idx = 0;
+  uint32_t elapsed = 0;
+  uint32_t gap_min = 0;
+
+  memset(m->vars, 0, sizeof(m->vars));
+  memset(m->known, 0, sizeof(m->known));
+
+  for (; !section_end(pc); pc += op_sizes[*pc]) {
+    bool last = section_end(pc + op_sizes[*pc]);
+    uint32_t value;
+    int ret;
+
+    switch (*pc) {
+    case IRP_OP_MARK:
+    case IRP_OP_SPACE: {
+      irp_window_t win = window_for(get24(pc + 1));
+      if (*pc == IRP_OP_SPACE && last) {
+        gap_min = win.lo;
+        break;
+      }
+      if (idx >= length || !in_window(win, ir_timing_us(timings[idx]))) {
+        return -ENOENT;
+      }
+      elapsed += ir_timing_us(timings[idx++]);
+      gap_min = 0;
+      break;
+    }
+    case IRP_OP_FIELD: {
+      ret = match_bits(m, timings, length, &idx, &elapsed, pc[2], last,
+                       &value);
+      if (ret < 0) {
+        return ret;
+      }
+
+      uint8_t var = pc[1] & IRP_FIELD_VAR_MASK;
+      uint32_t mask = field_mask(pc[2]) << pc[3];
+      if (pc[1] & IRP_FIELD_INVERT) {
+        value = ~value;
+      }
+      value = (value << pc[3]) & mask;
+      if ((m->known[var] & mask) && ((m->vars[var] ^ value) & mask)) {
+        return -ENOENT;
+      }
+      m->vars[var] |= value;
+      m->known[var] |= mask;
+      gap_min = MIN(m->bits[1].lo, m->bits[3].lo);
+      break;
+    }
+    case IRP_OP_CONST:
+      ret = match_bits(m, timings, length, &idx, &elapsed, pc[1], last,
+                       &value);
+      if (ret < 0 || value != get32(pc + 2)) {
+        return -ENOENT;
+      }
+      gap_min = MIN(m->bits[1].lo, m->bits[3].lo);
+      break;
+    }
+  }
+
+  if (*pc == IRP_OP_EXTENT) {
+    uint32_t extent = get24(pc + 1);
+    gap_min = extent > elapsed ? window_for(extent - elapsed).lo : 0;
+  }
+  if (idx < length && ir_timing_us(timings[idx]) < gap_min) {
+    return -ENOENT;
+  }
+  return 0;
+}
+
+static void matcher_init(irp_matcher_t *m, const uint8_t *program) {
+  m->program = program;
+  for (int i = 0; i < 4; i++) {
+    m->bits[i] = window_for(get24(program + 1 + 3 * i));
+  }
+}
+
+/* 解码一帧 */
+int irdb_irp_decode(const irdb_protocol_params_t *params,
+                    const ir_timing_t *timings, uint32_t length,
+                    irdb_entry_t *code_out, int *toggle_out) {
+  const uint8_t *program = params->program;
+  irp_matcher_t m;
+
+  matcher_init(&m, program);
+  int ret = match_section(&m, section_of(program, false), timings, length);
+  if (ret < 0 && (program[0] & IRP_FLAG_REPEAT_DATA)) {
+    /* 重复帧是不带引导码的完整数据 (JVC) */
+    ret = match_section(&m, section_of(program, true), timings, length);
+  }
+  if (ret < 0) {
+    return ret;
+  }
+
+  memset(code_out, 0, sizeof(*code_out));
+  code_out->name = IRDB_NAME_NONE;
+  code_out->protocol = params->protocol_id;
+  code_out->device = m.vars[IRP_VAR_D];
+  code_out->subdevice = m.vars[IRP_VAR_S];
+  code_out->function = m.vars[IRP_VAR_F];
+
+  if (toggle_out) {
+    *toggle_out = params->toggle_bit ? (int)m.vars[IRP_VAR_T]
+                                     : IRDB_TOGGLE_NONE;
+  }
+  return 0;
+}
+
+/* 是否为短重复码 */
+bool irdb_irp_is_repeat(const irdb_protocol_params_t *params,
+                        const ir_timing_t *timings, uint32_t length) {
+  const uint8_t *program = params->program;
+
+  if ((program[0] & IRP_FLAG_REPEAT_DATA) || length == 0) {
+    return false;
+  }
+  const uint8_t *pc = section_of(program, true);
+  if (!pc) {
+    return false;
+  }
+
+  irp_matcher_t m;
+  matcher_init(&m, program);
+  return match_section(&m, pc, timings, length) == 0;
+}
+
+/* 帧内最长的space */
+uint32_t irdb_irp_longest_space(const irdb_protocol_params_t *params) {
+  const uint8_t *program = params->program;
+  uint32_t longest = MAX(get24(program + 4), get24(program + 10));
+
+  for (const uint8_t *pc = program + IRP_HEADER_SIZE; *pc != IRP_OP_END;
+       pc += op_sizes[*pc]) {
+    const uint8_t *next = pc + op_sizes[*pc];
+
+    if (*pc == IRP_OP_SPACE && !section_end(next)) {
+      longest = MAX(longest, get24(pc + 1));
+    }
+  }
+  return longest;
+}
+
+#ifdef CONFIG_IRDB_IRP_PROTOCOLS
+/* 由scripts/irp_compile.py生成 */
+extern const irdb_protocol_params_t irdb_irp_protocols[];
+extern const size_t irdb_irp_protocol_count;
+
+/* 注册生成的协议 */
+int irdb_irp_register_builtin(void) {
+  int count = 0;
+
+  for (size_t i = 0; i < irdb_irp_protocol_count; i++) {
+    const irdb_protocol_params_t *params = &irdb_irp_protocols[i];
+
+    if (irdb_get_protocol_params(params->protocol_id) == params) {
+      continue;
+    }
+
+    int ret = irdb_register_protocol(params);
+    if (ret < 0) {
+      LOG_WRN("IRP protocol %s (%u) not registered: %d", params->name,
+              params->protocol_id, ret);
+      continue;
+    }
+    count++;
+  }
+  return count;
+}
+#else
+int irdb_irp_register_builtin(void) { return 0; }
+#endif
@@ -4,6 +4,11 @@
  */
 
 #include "irdb_loader.h"
+#include "ir_fs.h"
+#include "irdb_flash_cache.h"
+#include "irdb_image.h"
+#include "ir_mem.h"
+#include "irdb_store.h"
 #include <stdio.h>
 #include <string.h>
 #include <zephyr/kernel.h>
@@ -16,17 +21,32 @@
 #ifdef CONFIG_HTTP_CLIENT
 #include <zephyr/net/http/client.h>
 #include <zephyr/net/socket.h>
+#include <zephyr/net/tls_credentials.h>
 #endif
 
 LOG_MODULE_REGISTER(irdb_loader, LOG_LEVEL_INF);
 
-/* IRDB CDN基础URL */
-#define IRDB_CDN_BASE "https://cdn.jsdelivr.net/gh/probonopd/irdb@master/codes"
-
-/* 缓存数组 */
-static irdb_cache_entry_t cache[IRDB_CACHE_SIZE];
+/* 文件分块读取大小 */
+#define IRDB_LOAD_CHUNK_SIZE 256
+
+/* IRDB CDN */
+#define IRDB_CDN_HOST "cdn.jsdelivr.net"
+#define IRDB_CDN_PORT "443"
+#define IRDB_CDN_PATH "/gh/probonopd/irdb@master/codes"
+
+/* 缓存 - 节点按预算动态分配，按键哈希开放寻址(线性探测)索引。
+ * cache_lock保护索引、引用计数和统计，查找只在其中探测几个槽位；
+ * cache_mutex串行化添加和清空，释放内存在自旋锁外进行 */
+static irdb_cache_entry_t *cache_index[IRDB_CACHE_INDEX_SIZE];
+static uint32_t cache_count;
+static size_t cache_used;
+static uint32_t cache_clock; // 访问序号，每次命中或添加递增
+static irdb_cache_stats_t cache_stats; // 在cache_lock下更新
+static struct k_spinlock cache_lock;
 static K_MUTEX_DEFINE(cache_mutex);
 
+#define CACHE_INDEX_MASK (IRDB_CACHE_INDEX_SIZE - 1)
+
 /* 构建IRDB路径 */
 void irdb_build_path(char *path_out, size_t path_size, const char *manufacturer,
                      const char *device_type, uint8_t device,
@@ -36,12 +56,17 @@ void irdb_build_path(char *path_out, size_t path_size, const char *manufacturer,
 }
 
 /* 从嵌入式数据加载 */
-int irdb_load_embedded(irdb_database_t *db, const char *csv_data) {
-  if (!db || !csv_data) {
+int irdb_load_embedded(irdb_database_t *db, const void *data) {
+  if (!db || !data) {
     return -EINVAL;
   }
 
-  return irdb_parse_csv(csv_data, db);
+  /* 二进制镜像直接引用，CSV文本需解析 */
+  if (irdb_image_is_valid(data)) {
+    return irdb_image_open(db, data);
+  }
+
+  return irdb_parse_csv(data, db);
 }
 
 #ifdef CONFIG_FILE_SYSTEM
@@ -54,41 +79,67 @@ int irdb_load_from_file(irdb_database_t *db, const char *filepath) {
   struct fs_file_t file;
   fs_file_t_init(&file);
 
-  int ret = fs_open(&file, filepath, FS_O_READ);
+  int ret = ir_fs_mount();
+  if (ret == 0) {
+    ret = fs_open(&file, filepath, FS_O_READ);
+  }
   if (ret < 0) {
     LOG_ERR("Failed to open file %s: %d", filepath, ret);
     return ret;
   }
 
-  /* 获取文件大小 */
-  struct fs_dirent entry;
-  ret = fs_stat(filepath, &entry);
-  if (ret < 0) {
+  /* 已编译的镜像(irdb_store保存的.img，可能压缩)直接读入，不再解析 */
+  uint32_t magic = 0;
+  if (fs_read(&file, &magic, sizeof(magic)) == sizeof(magic) &&
+      (magic == IRDB_IMAGE_MAGIC || magic == IRDB_IMAGE_LZ_MAGIC) &&
+      fs_seek(&file, 0, FS_SEEK_SET) == 0) {
+    ret = irdb_image_read_file(&file, db);
     fs_close(&file);
+    if (ret == 0) {
+      LOG_INF("Loaded IRDB image: %s (%u entries)", filepath,
+              db->entry_count);
+    }
     return ret;
   }
+  fs_seek(&file, 0, FS_SEEK_SET);
+
+  /* 分块读取并流式解析，峰值内存与文件大小无关 */
+  irdb_parser_t parser;
+  char chunk[IRDB_LOAD_CHUNK_SIZE];
+  ssize_t bytes_read;
+  uint32_t lines = 1;
+
+  irdb_parser_init(&parser, db, NULL);
+
+  /* 第一遍统计行数，条目数组按实际大小一次分配 */
+  while ((bytes_read = fs_read(&file, chunk, sizeof(chunk))) > 0) {
+    for (ssize_t i = 0; i < bytes_read; i++) {
+      if (chunk[i] == '\n') {
+        lines++;
+      }
+    }
+  }
 
-  /* 分配缓冲区 */
-  char *buffer = k_malloc(entry.size + 1);
-  if (!buffer) {
-    fs_close(&file);
-    return -ENOMEM;
+  if (bytes_read == 0) {
+    bytes_read = fs_seek(&file, 0, FS_SEEK_SET);
+  }
+  if (bytes_read == 0) {
+    parser.error = irdb_parser_reserve(&parser, lines);
   }
 
-  /* 读取文件 */
-  ssize_t bytes_read = fs_read(&file, buffer, entry.size);
+  while (!parser.error && (bytes_read = fs_read(&file, chunk, sizeof(chunk))) > 0) {
+    ret = irdb_parser_feed(&parser, chunk, bytes_read);
+    if (ret < 0) {
+      break;
+    }
+  }
   fs_close(&file);
 
-  if (bytes_read < 0) {
-    k_free(buffer);
-    return bytes_read;
+  if (bytes_read < 0 && !parser.error) {
+    parser.error = bytes_read;
   }
 
-  buffer[bytes_read] = '\0';
-
-  /* 解析CSV */
-  ret = irdb_parse_csv(buffer, db);
-  k_free(buffer);
+  ret = irdb_parser_finish(&parser);
 
   if (ret == 0) {
     LOG_INF("Loaded IRDB from file: %s", filepath);
@@ -104,36 +155,258 @@ int irdb_load_from_file(irdb_database_t *db, const char *filepath) {
 #endif
 
 #ifdef CONFIG_HTTP_CLIENT
-/* HTTP响应缓冲区 */
-#define HTTP_RECV_BUF_SIZE 4096
-static char http_recv_buf[HTTP_RECV_BUF_SIZE];
-static size_t http_data_len;
+/* HTTP接收缓冲区 - 响应体分片直接送入流式解析器 */
+#ifdef CONFIG_IRDB_HTTP_RECV_BUF
+#define HTTP_RECV_BUF_SIZE CONFIG_IRDB_HTTP_RECV_BUF
+#else
+#define HTTP_RECV_BUF_SIZE 1024
+#endif
+static uint8_t http_recv_buf[HTTP_RECV_BUF_SIZE];
+
+/* 请求超时 */
+#define HTTP_TIMEOUT_MS 5000
+
+/* DNS结果缓存时长 */
+#define HTTP_DNS_CACHE_MS (10 * 60 * 1000)
+
+/* 空闲超过此时长的连接视为已被服务器关闭，不再复用 */
+#define HTTP_KEEPALIVE_MS 30000
+
+#ifdef CONFIG_IRDB_HTTP_SEC_TAG
+#define IRDB_HTTP_SEC_TAG CONFIG_IRDB_HTTP_SEC_TAG
+#else
+#define IRDB_HTTP_SEC_TAG 0x1D4B
+#endif
+
+/* CA证书(DER)由CMake从CONFIG_IRDB_HTTP_CA_CERT生成；未配置时须由应用
+ * 预先把证书注册到IRDB_HTTP_SEC_TAG */
+#ifdef IRDB_HTTP_HAVE_CA_CERT
+static const unsigned char http_ca_cert[] = {
+#include "irdb_ca_cert.inc"
+};
+#endif
+
+/* 持久连接 - 多次下载复用同一TLS会话，省去握手 */
+static struct {
+  struct sockaddr_in addr; // DNS缓存
+  uint32_t addr_time;
+  bool addr_valid;
+  bool tls_ready;
+  bool connected;
+  int sock;
+  uint32_t last_used;
+} http_conn;
+static K_MUTEX_DEFINE(http_mutex);
+
+/* HTTP下载上下文 */
+typedef struct {
+  irdb_http_body_cb_t body; // 200响应的响应体分片
+  void *user_data;
+  int body_error;                   // body回调返回的第一个错误
+  irdb_http_validator_t *validator; // 捕获响应中的校验头，可为NULL
+  char *header_value;               // 当前头部值写入位置，NULL表示忽略
+  size_t header_size;
+  char connection[8];               // Connection响应头
+  uint16_t status;
+} http_fetch_t;
+
+static http_fetch_t *http_fetch_of(struct http_parser *parser) {
+  struct http_request *req =
+      CONTAINER_OF(parser, struct http_request, internal.parser);
+  return req->internal.user_data;
+}
+
+/* 响应头字段名 - 只关心ETag和Last-Modified */
+static int http_header_field_cb(struct http_parser *parser, const char *at,
+                                size_t length) {
+  http_fetch_t *fetch = http_fetch_of(parser);
 
-/* HTTP响应回调 */
+  fetch->header_value = NULL;
+  if (length == 10 && strncasecmp(at, "Connection", 10) == 0) {
+    fetch->header_value = fetch->connection;
+    fetch->header_size = sizeof(fetch->connection);
+  }
+  if (!fetch->validator) {
+    return 0;
+  }
+
+  if (length == 4 && strncasecmp(at, "ETag", 4) == 0) {
+    fetch->header_value = fetch->validator->etag;
+    fetch->header_size = sizeof(fetch->validator->etag);
+  } else if (length == 13 && strncasecmp(at, "Last-Modified", 13) == 0) {
+    fetch->header_value = fetch->validator->last_modified;
+    fetch->header_size = sizeof(fetch->validator->last_modified);
+  }
+  return 0;
+}
+
+static int http_header_value_cb(struct http_parser *parser, const char *at,
+                                size_t length) {
+  http_fetch_t *fetch = http_fetch_of(parser);
+
+  if (fetch->header_value) {
+    length = MIN(length, fetch->header_size - 1);
+    memcpy(fetch->header_value, at, length);
+    fetch->header_value[length] = '\0';
+    fetch->header_value = NULL;
+  }
+  return 0;
+}
+
+static const struct http_parser_settings http_header_cbs = {
+    .on_header_field = http_header_field_cb,
+    .on_header_value = http_header_value_cb,
+};
+
+/* HTTP响应回调 - 只把200响应的响应体交给body回调 */
 static void http_response_cb(struct http_response *rsp,
                              enum http_final_call final_data, void *user_data) {
-  if (rsp->data_len > 0) {
-    size_t copy_len =
-        MIN(rsp->data_len, HTTP_RECV_BUF_SIZE - http_data_len - 1);
-    memcpy(http_recv_buf + http_data_len, rsp->recv_buf, copy_len);
-    http_data_len += copy_len;
+  http_fetch_t *fetch = user_data;
+
+  fetch->status = rsp->http_status_code;
+  if (fetch->status == 200 && rsp->body_frag_start && rsp->body_frag_len > 0 &&
+      fetch->body_error == 0) {
+    fetch->body_error = fetch->body(rsp->body_frag_start, rsp->body_frag_len,
+                                    fetch->user_data);
   }
 }
 
-/* 从HTTP加载 */
-int irdb_load_from_http(irdb_database_t *db, const char *manufacturer,
-                        const char *device_type, uint8_t device,
-                        uint8_t subdevice) {
-  if (!db || !manufacturer || !device_type) {
-    return -EINVAL;
+/* 解析CDN地址，结果缓存HTTP_DNS_CACHE_MS。调用者须持有http_mutex */
+static int http_resolve(void) {
+  uint32_t now = k_uptime_get_32();
+
+  if (http_conn.addr_valid && now - http_conn.addr_time < HTTP_DNS_CACHE_MS) {
+    return 0;
   }
 
-  /* 构建URL */
-  char url[256];
-  snprintf(url, sizeof(url), "%s/%s/%s/%u,%u.csv", IRDB_CDN_BASE, manufacturer,
-           device_type, device, subdevice);
+  struct addrinfo hints = {
+      .ai_family = AF_INET,
+      .ai_socktype = SOCK_STREAM,
+  };
+  struct addrinfo *res;
+
+  int ret = getaddrinfo(IRDB_CDN_HOST, IRDB_CDN_PORT, &hints, &res);
+  if (ret != 0) {
+    LOG_ERR("DNS lookup failed for %s: %d", IRDB_CDN_HOST, ret);
+    return -EHOSTUNREACH;
+  }
+
+  memcpy(&http_conn.addr, res->ai_addr,
+         MIN(res->ai_addrlen, sizeof(http_conn.addr)));
+  freeaddrinfo(res);
+
+  http_conn.addr_time = now;
+  http_conn.addr_valid = true;
+  return 0;
+}
+
+/* 调用者须持有http_mutex */
+static void http_disconnect(void) {
+  if (http_conn.connected) {
+    close(http_conn.sock);
+    http_conn.connected = false;
+  }
+}
+
+/* 建立或复用TLS连接，返回是否为复用连接。调用者须持有http_mutex */
+static int http_connect(bool *reused) {
+  uint32_t now = k_uptime_get_32();
+
+  *reused = false;
+  if (http_conn.connected) {
+    if (now - http_conn.last_used < HTTP_KEEPALIVE_MS) {
+      *reused = true;
+      return 0;
+    }
+    http_disconnect();
+  }
+
+#ifdef IRDB_HTTP_HAVE_CA_CERT
+  if (!http_conn.tls_ready) {
+    int err = tls_credential_add(IRDB_HTTP_SEC_TAG,
+                                 TLS_CREDENTIAL_CA_CERTIFICATE, http_ca_cert,
+                                 sizeof(http_ca_cert));
+    if (err < 0 && err != -EEXIST) {
+      LOG_ERR("Failed to register CA certificate: %d", err);
+      return err;
+    }
+    http_conn.tls_ready = true;
+  }
+#endif
+
+  int ret = http_resolve();
+  if (ret < 0) {
+    return ret;
+  }
+
+  int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TLS_1_2);
+  if (sock < 0) {
+    LOG_ERR("Failed to create socket");
+    return -errno;
+  }
 
-  LOG_INF("Fetching: %s", url);
+  const sec_tag_t sec_tags[] = {IRDB_HTTP_SEC_TAG};
+  int verify = TLS_PEER_VERIFY_REQUIRED;
+
+  if (setsockopt(sock, SOL_TLS, TLS_SEC_TAG_LIST, sec_tags,
+                 sizeof(sec_tags)) < 0 ||
+      setsockopt(sock, SOL_TLS, TLS_HOSTNAME, IRDB_CDN_HOST,
+                 sizeof(IRDB_CDN_HOST) - 1) < 0 ||
+      setsockopt(sock, SOL_TLS, TLS_PEER_VERIFY, &verify, sizeof(verify)) <
+          0) {
+    ret = -errno;
+    close(sock);
+    LOG_ERR("Failed to configure TLS: %d", ret);
+    return ret;
+  }
+
+  if (connect(sock, (struct sockaddr *)&http_conn.addr,
+              sizeof(http_conn.addr)) < 0) {
+    ret = -errno;
+    close(sock);
+    /* 地址可能已变更，下次重新解析 */
+    http_conn.addr_valid = false;
+    LOG_ERR("Connection to %s failed: %d", IRDB_CDN_HOST, ret);
+    return ret;
+  }
+
+  http_conn.sock = sock;
+  http_conn.connected = true;
+  return 0;
+}
+
+/* HTTP GET */
+int irdb_http_get(const char *url, irdb_http_validator_t *validator,
+                  irdb_http_body_cb_t body, void *user_data) {
+  if (!url || !body) {
+    return -EINVAL;
+  }
+
+  LOG_INF("Fetching: https://%s%s", IRDB_CDN_HOST, url);
+
+  /* 条件请求头 - 本地副本未过期时服务器只回304 */
+  char if_none_match[sizeof(validator->etag) + 20];
+  char if_modified_since[sizeof(validator->last_modified) + 24];
+  const char *cond_headers[3];
+  int header_count = 0;
+  irdb_http_validator_t sent = {0};
+
+  if (validator) {
+    sent = *validator;
+    if (sent.etag[0]) {
+      snprintf(if_none_match, sizeof(if_none_match), "If-None-Match: %s\r\n",
+               sent.etag);
+      cond_headers[header_count++] = if_none_match;
+    }
+    if (sent.last_modified[0]) {
+      snprintf(if_modified_since, sizeof(if_modified_since),
+               "If-Modified-Since: %s\r\n", sent.last_modified);
+      cond_headers[header_count++] = if_modified_since;
+    }
+    memset(validator->etag, 0, sizeof(validator->etag));
+    memset(validator->last_modified, 0, sizeof(validator->last_modified));
+  }
+  cond_headers[header_count] = NULL;
 
   /* 初始化HTTP请求 */
   struct http_request req;
@@ -141,49 +414,113 @@ int irdb_load_from_http(irdb_database_t *db, const char *manufacturer,
 
   req.method = HTTP_GET;
   req.url = url;
+  req.host = IRDB_CDN_HOST;
   req.protocol = "HTTP/1.1";
+  req.optional_headers = cond_headers;
+  req.http_cb = &http_header_cbs;
   req.response = http_response_cb;
   req.recv_buf = http_recv_buf;
   req.recv_buf_len = sizeof(http_recv_buf);
 
-  http_data_len = 0;
+  http_fetch_t fetch = {
+      .body = body,
+      .user_data = user_data,
+      .validator = validator,
+  };
 
-  /* 发送HTTP请求 */
-  int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-  if (sock < 0) {
-    LOG_ERR("Failed to create socket");
-    return -errno;
-  }
+  k_mutex_lock(&http_mutex, K_FOREVER);
 
-  /* 解析主机名和端口 */
-  struct sockaddr_in addr;
-  memset(&addr, 0, sizeof(addr));
-  addr.sin_family = AF_INET;
-  addr.sin_port = htons(443); // HTTPS
+  int ret;
+  bool reused;
+
+  /* 复用的连接可能已被服务器关闭，未收到响应时换新连接重试一次 */
+  for (int attempt = 0; attempt < 2; attempt++) {
+    ret = http_connect(&reused);
+    if (ret < 0) {
+      break;
+    }
 
-  /* 这里需要DNS解析，简化处理 */
-  /* 实际项目中需要使用getaddrinfo或DNS查询 */
+    ret = http_client_req(http_conn.sock, &req, HTTP_TIMEOUT_MS, &fetch);
+    if (ret >= 0 || fetch.status != 0 || !reused) {
+      break;
+    }
 
-  /* 连接服务器 */
-  int ret = connect(sock, (struct sockaddr *)&addr, sizeof(addr));
-  if (ret < 0) {
-    close(sock);
-    LOG_ERR("Connection failed");
-    return -errno;
+    LOG_DBG("Stale keep-alive connection, reconnecting");
+    http_disconnect();
+    if (validator) {
+      memset(validator->etag, 0, sizeof(validator->etag));
+      memset(validator->last_modified, 0, sizeof(validator->last_modified));
+    }
   }
 
-  /* 发送HTTP请求 */
-  ret = http_client_req(sock, &req, 5000, NULL);
-  close(sock);
+  if (ret < 0 || strncasecmp(fetch.connection, "close", 5) == 0) {
+    http_disconnect();
+  } else {
+    http_conn.last_used = k_uptime_get_32();
+  }
+
+  k_mutex_unlock(&http_mutex);
 
   if (ret < 0) {
     LOG_ERR("HTTP request failed: %d", ret);
     return ret;
   }
+  if (fetch.status == 304) {
+    /* 304可不带校验头，沿用请求时的值 */
+    if (validator && !validator->etag[0] && !validator->last_modified[0]) {
+      *validator = sent;
+    }
+    LOG_INF("Not modified: %s", url);
+    return IRDB_HTTP_NOT_MODIFIED;
+  }
+  if (fetch.status != 200) {
+    LOG_ERR("HTTP status %u: %s", fetch.status, url);
+    return fetch.status == 404 ? -ENOENT : -EIO;
+  }
+  return fetch.body_error;
+}
 
-  /* 解析响应 */
-  http_recv_buf[http_data_len] = '\0';
-  ret = irdb_parse_csv(http_recv_buf, db);
+/* 响应体分片直接送入流式解析器，内存与文件大小无关 */
+static int http_parser_body(const uint8_t *data, size_t len, void *user_data) {
+  return irdb_parser_feed(user_data, (const char *)data, len);
+}
+
+/* 从HTTP加载 */
+int irdb_load_from_http(irdb_database_t *db, const char *manufacturer,
+                        const char *device_type, uint8_t device,
+                        uint8_t subdevice) {
+  return irdb_load_from_http_cond(db, manufacturer, device_type, device,
+                                  subdevice, NULL);
+}
+
+/* 条件请求加载 */
+int irdb_load_from_http_cond(irdb_database_t *db, const char *manufacturer,
+                             const char *device_type, uint8_t device,
+                             uint8_t subdevice,
+                             irdb_http_validator_t *validator) {
+  if (!db || !manufacturer || !device_type) {
+    return -EINVAL;
+  }
+
+  /* 构建请求路径 */
+  char url[192];
+  snprintf(url, sizeof(url), "%s/%s/%s/%u,%u.csv", IRDB_CDN_PATH, manufacturer,
+           device_type, device, subdevice);
+
+  irdb_parser_t parser;
+  irdb_parser_init(&parser, db, NULL);
+
+  int ret = irdb_http_get(url, validator, http_parser_body, &parser);
+  if (ret == IRDB_HTTP_NOT_MODIFIED) {
+    irdb_free_database(db);
+    return ret;
+  }
+  if (ret < 0) {
+    parser.error = ret;
+  }
+
+  /* 完成解析 */
+  ret = irdb_parser_finish(&parser);
 
   if (ret == 0) {
     LOG_INF("Loaded IRDB from HTTP: %s", url);
@@ -192,105 +529,434 @@ int irdb_load_from_http(irdb_database_t *db, const char *manufacturer,
   return ret;
 }
 #else
+int irdb_http_get(const char *url, irdb_http_validator_t *validator,
+                  irdb_http_body_cb_t body, void *user_data) {
+  LOG_ERR("HTTP client support not enabled");
+  return -ENOTSUP;
+}
+
 int irdb_load_from_http(irdb_database_t *db, const char *manufacturer,
                         const char *device_type, uint8_t device,
                         uint8_t subdevice) {
   LOG_ERR("HTTP client support not enabled");
   return -ENOTSUP;
 }
+
+int irdb_load_from_http_cond(irdb_database_t *db, const char *manufacturer,
+                             const char *device_type, uint8_t device,
+                             uint8_t subdevice,
+                             irdb_http_validator_t *validator) {
+  LOG_ERR("HTTP client support not enabled");
+  return -ENOTSUP;
+}
 #endif
 
+/* 数据库占用的堆字节数 */
+static size_t database_bytes(const irdb_database_t *db) {
+  size_t bytes = db->entry_count * sizeof(irdb_entry_t) + db->names_len;
+
+  if (db->hash_slots) {
+    bytes += 2 * (db->hash_mask + 1) * sizeof(uint16_t);
+  }
+  return bytes;
+}
+
+/* FNV-1a，覆盖键的全部字段 */
+static uint32_t fnv1a(uint32_t h, const void *data, size_t len) {
+  const uint8_t *p = data;
+
+  while (len--) {
+    h ^= *p++;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+uint32_t irdb_cache_key_hash(const irdb_cache_key_t *key) {
+  uint8_t tail[3] = {key->device, key->subdevice, key->source};
+  uint32_t h = 2166136261u;
+
+  h = fnv1a(h, key->manufacturer, strlen(key->manufacturer) + 1);
+  h = fnv1a(h, key->device_type, strlen(key->device_type) + 1);
+  return fnv1a(h, tail, sizeof(tail));
+}
+
+static bool cache_key_equal(const irdb_cache_entry_t *entry, uint32_t hash,
+                            const irdb_cache_key_t *key) {
+  const char *device_type = entry->key + strlen(entry->key) + 1;
+
+  return entry->hash == hash && entry->device == key->device &&
+         entry->subdevice == key->subdevice && entry->source == key->source &&
+         strcmp(entry->key, key->manufacturer) == 0 &&
+         strcmp(device_type, key->device_type) == 0;
+}
+
+/* 查找键所在槽位，未找到返回-1。调用者须持有cache_lock */
+static int index_find(uint32_t hash, const irdb_cache_key_t *key) {
+  for (uint32_t i = hash & CACHE_INDEX_MASK; cache_index[i];
+       i = (i + 1) & CACHE_INDEX_MASK) {
+    if (cache_key_equal(cache_index[i], hash, key)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void index_insert(irdb_cache_entry_t *entry) {
+  uint32_t i = entry->hash & CACHE_INDEX_MASK;
+
+  while (cache_index[i]) {
+    i = (i + 1) & CACHE_INDEX_MASK;
+  }
+  cache_index[i] = entry;
+  cache_count++;
+}
+
+/* 删除槽位并回移后续探测链，无需墓碑。调用者须持有cache_lock */
+static void index_remove(uint32_t i) {
+  cache_index[i] = NULL;
+  cache_count--;
+
+  for (uint32_t j = (i + 1) & CACHE_INDEX_MASK; cache_index[j];
+       j = (j + 1) & CACHE_INDEX_MASK) {
+    uint32_t home = cache_index[j]->hash & CACHE_INDEX_MASK;
+
+    /* i位于home到j的探测路径上时可前移 */
+    if (((j - home) & CACHE_INDEX_MASK) >= ((j - i) & CACHE_INDEX_MASK)) {
+      cache_index[i] = cache_index[j];
+      cache_index[j] = NULL;
+      i = j;
+    }
+  }
+}
+
+/* 条目移出索引；无引用时挂到待释放链，否则待最后一次释放时回收。
+ * 调用者须持有cache_lock */
+static void cache_detach(uint32_t i, irdb_cache_entry_t **free_list) {
+  irdb_cache_entry_t *entry = cache_index[i];
+
+  index_remove(i);
+  entry->valid = false;
+  if (entry->refs == 0) {
+    cache_used -= entry->cost;
+    entry->next = *free_list;
+    *free_list = entry;
+  }
+}
+
+static void cache_free_list(irdb_cache_entry_t *entry) {
+  while (entry) {
+    irdb_cache_entry_t *next = entry->next;
+
+    irdb_free_database(&entry->database);
+    irdb_heap_free(entry);
+    entry = next;
+  }
+}
+
+/* 最久未用且未被引用的条目槽位，无可淘汰返回-1。调用者须持有cache_lock */
+static int cache_lru_victim(void) {
+  int victim = -1;
+  uint32_t oldest_age = 0;
+
+  for (int i = 0; i < IRDB_CACHE_INDEX_SIZE; i++) {
+    irdb_cache_entry_t *entry = cache_index[i];
+
+    if (!entry || entry->refs > 0) {
+      continue;
+    }
+
+    /* 差值比较，访问序号回绕后仍然正确 */
+    uint32_t age = cache_clock - entry->last_access;
+    if (victim < 0 || age > oldest_age) {
+      victim = i;
+      oldest_age = age;
+    }
+  }
+  return victim;
+}
+
 /* 缓存查找 */
-int irdb_cache_get(const char *path, irdb_database_t **db_out) {
-  if (!path || !db_out) {
+int irdb_cache_get(const irdb_cache_key_t *key, irdb_database_t **db_out) {
+  if (!key || !key->manufacturer || !key->device_type || !db_out) {
     return -EINVAL;
   }
 
-  k_mutex_lock(&cache_mutex, K_FOREVER);
+  uint32_t hash = irdb_cache_key_hash(key);
+  k_spinlock_key_t lock = k_spin_lock(&cache_lock);
 
-  for (int i = 0; i < IRDB_CACHE_SIZE; i++) {
-    if (cache[i].valid && strcmp(cache[i].path, path) == 0) {
-      cache[i].last_access = k_uptime_get_32();
-      *db_out = &cache[i].database;
-      k_mutex_unlock(&cache_mutex);
-      LOG_DBG("Cache hit: %s", path);
-      return 0;
-    }
+  int i = index_find(hash, key);
+  if (i >= 0) {
+    irdb_cache_entry_t *entry = cache_index[i];
+
+    entry->last_access = ++cache_clock;
+    entry->refs++;
+    *db_out = &entry->database;
+    cache_stats.hits++;
+  } else {
+    cache_stats.misses++;
   }
 
-  k_mutex_unlock(&cache_mutex);
-  return -ENOENT;
+  k_spin_unlock(&cache_lock, lock);
+
+  if (i < 0) {
+    return -ENOENT;
+  }
+
+  LOG_DBG("Cache hit: %s/%s %u,%u", key->manufacturer, key->device_type,
+          key->device, key->subdevice);
+  return 0;
 }
 
 /* 缓存添加 */
-int irdb_cache_put(const char *path, const irdb_database_t *db) {
-  if (!path || !db) {
+int irdb_cache_put(const irdb_cache_key_t *key, irdb_database_t *db,
+                   irdb_database_t **db_out) {
+  if (!key || !key->manufacturer || !key->device_type || !db) {
     return -EINVAL;
   }
 
+  size_t mfr_len = strlen(key->manufacturer) + 1;
+  size_t type_len = strlen(key->device_type) + 1;
+  size_t node_size = sizeof(irdb_cache_entry_t) + mfr_len + type_len;
+  size_t cost = node_size + database_bytes(db);
+
+  if (cost > IRDB_CACHE_BYTES) {
+    return -ENOMEM;
+  }
+
+  uint32_t hash = irdb_cache_key_hash(key);
+  irdb_cache_entry_t *free_list = NULL;
+  int ret = 0;
+
   k_mutex_lock(&cache_mutex, K_FOREVER);
+  k_spinlock_key_t lock = k_spin_lock(&cache_lock);
 
-  /* 查找空闲或最久未使用的条目 */
-  int target_idx = 0;
-  uint32_t oldest_time = UINT32_MAX;
+  /* 同键旧条目让位 */
+  int i = index_find(hash, key);
+  if (i >= 0) {
+    cache_detach(i, &free_list);
+  }
 
-  for (int i = 0; i < IRDB_CACHE_SIZE; i++) {
-    if (!cache[i].valid) {
-      target_idx = i;
+  /* 按LRU淘汰直到预算和索引容量足够，被引用的条目不可淘汰 */
+  while (cache_used + cost > IRDB_CACHE_BYTES ||
+         cache_count >= IRDB_CACHE_MAX_ENTRIES) {
+    i = cache_lru_victim();
+    if (i < 0) {
+      ret = -EBUSY;
       break;
     }
+    LOG_DBG("Cache evict: %s (%u bytes)", cache_index[i]->key,
+            (unsigned)cache_index[i]->cost);
+    cache_detach(i, &free_list);
+    cache_stats.evictions++;
+  }
 
-    if (cache[i].last_access < oldest_time) {
-      oldest_time = cache[i].last_access;
-      target_idx = i;
+  k_spin_unlock(&cache_lock, lock);
+  cache_free_list(free_list);
+
+  irdb_cache_entry_t *entry = NULL;
+  if (ret == 0) {
+    entry = irdb_heap_alloc(node_size);
+    if (!entry) {
+      ret = -ENOMEM;
     }
   }
 
-  /* 清理旧条目 */
-  if (cache[target_idx].valid) {
-    irdb_free_database(&cache[target_idx].database);
+  if (ret < 0) {
+    k_mutex_unlock(&cache_mutex);
+    return ret;
   }
 
-  /* 复制新数据 */
-  strncpy(cache[target_idx].path, path, sizeof(cache[target_idx].path) - 1);
+  /* 转移所有权 - 条目、字符串池和索引指针原样移交，无需拷贝和重建索引 */
+  memcpy(entry->key, key->manufacturer, mfr_len);
+  memcpy(entry->key + mfr_len, key->device_type, type_len);
+  entry->device = key->device;
+  entry->subdevice = key->subdevice;
+  entry->source = key->source;
+  entry->hash = hash;
+  entry->database = *db;
+  memset(db, 0, sizeof(*db));
+
+  entry->cost = cost;
+  entry->refs = db_out ? 1 : 0;
+  entry->valid = true;
+
+  lock = k_spin_lock(&cache_lock);
+  entry->last_access = ++cache_clock;
+  index_insert(entry);
+  cache_used += cost;
+  k_spin_unlock(&cache_lock, lock);
+
+  if (db_out) {
+    *db_out = &entry->database;
+  }
 
-  /* 深拷贝数据库 */
-  cache[target_idx].database.entry_count = db->entry_count;
-  cache[target_idx].database.entries =
-      k_malloc(db->entry_count * sizeof(irdb_entry_t));
+  k_mutex_unlock(&cache_mutex);
+  LOG_DBG("Cache stored: %s/%s %u,%u (%u bytes, %u/%u used)",
+          key->manufacturer, key->device_type, key->device, key->subdevice,
+          (unsigned)cost, (unsigned)cache_used, IRDB_CACHE_BYTES);
+  return 0;
+}
 
-  if (!cache[target_idx].database.entries) {
-    k_mutex_unlock(&cache_mutex);
-    return -ENOMEM;
+/* 释放引用 - 已被清空或淘汰的条目在最后一次释放时回收 */
+void irdb_cache_release(const irdb_database_t *db) {
+  if (!db) {
+    return;
   }
 
-  memcpy(cache[target_idx].database.entries, db->entries,
-         db->entry_count * sizeof(irdb_entry_t));
-
-  strncpy(cache[target_idx].database.manufacturer, db->manufacturer,
-          sizeof(cache[target_idx].database.manufacturer) - 1);
-  strncpy(cache[target_idx].database.device_type, db->device_type,
-          sizeof(cache[target_idx].database.device_type) - 1);
+  irdb_cache_entry_t *entry = CONTAINER_OF(db, irdb_cache_entry_t, database);
+  bool reclaim = false;
 
-  cache[target_idx].last_access = k_uptime_get_32();
-  cache[target_idx].valid = true;
+  k_spinlock_key_t lock = k_spin_lock(&cache_lock);
+  if (entry->refs > 0 && --entry->refs == 0 && !entry->valid) {
+    cache_used -= entry->cost;
+    reclaim = true;
+  }
+  k_spin_unlock(&cache_lock, lock);
 
-  k_mutex_unlock(&cache_mutex);
-  LOG_DBG("Cache stored: %s", path);
-  return 0;
+  if (reclaim) {
+    entry->next = NULL;
+    cache_free_list(entry);
+  }
 }
 
 /* 清空缓存 */
 void irdb_cache_clear(void) {
+  irdb_cache_entry_t *free_list = NULL;
+
   k_mutex_lock(&cache_mutex, K_FOREVER);
+  k_spinlock_key_t lock = k_spin_lock(&cache_lock);
 
-  for (int i = 0; i < IRDB_CACHE_SIZE; i++) {
-    if (cache[i].valid) {
-      irdb_free_database(&cache[i].database);
-      cache[i].valid = false;
+  for (int i = 0; i < IRDB_CACHE_INDEX_SIZE; i++) {
+    /* 回移可能把后续条目移入当前槽位 */
+    while (cache_index[i]) {
+      cache_detach(i, &free_list);
     }
   }
 
+  k_spin_unlock(&cache_lock, lock);
+  cache_free_list(free_list);
   k_mutex_unlock(&cache_mutex);
   LOG_INF("Cache cleared");
-}
\ No newline at end of file
+}
+
+/* 缓存占用字节数 */
+size_t irdb_cache_used(void) {
+  k_spinlock_key_t lock = k_spin_lock(&cache_lock);
+  size_t used = cache_used;
+  k_spin_unlock(&cache_lock, lock);
+  return used;
+}
+
+/* 缓存统计 */
+void irdb_cache_get_stats(irdb_cache_stats_t *stats) {
+  if (!stats) {
+    return;
+  }
+
+  k_spinlock_key_t lock = k_spin_lock(&cache_lock);
+  *stats = cache_stats;
+  k_spin_unlock(&cache_lock, lock);
+}
+
+/* HTTP遥控器两级加载 */
+int irdb_load_http_cached(const irdb_cache_key_t *key, irdb_database_t *db) {
+  if (!key || !key->manufacturer || !key->device_type || !db) {
+    return -EINVAL;
+  }
+
+  irdb_http_validator_t validator = {0};
+  irdb_database_t fetched = {0};
+  bool cached = irdb_flash_cache_load(key, db, &validator) == 0;
+  int ret = IRDB_LOADED_FROM_FLASH;
+
+  /* 带版本号的副本由增量更新(irdb_delta_sync)维护，不逐个校验 */
+  bool revalidate = IS_ENABLED(CONFIG_IRDB_FLASH_CACHE_REVALIDATE) &&
+                    !(IS_ENABLED(CONFIG_IRDB_DELTA) && validator.version != 0);
+
+  if (!cached || revalidate) {
+    ret = irdb_load_from_http_cond(&fetched, key->manufacturer,
+                                   key->device_type, key->device,
+                                   key->subdevice, &validator);
+    if (ret == 0) {
+      irdb_free_database(db);
+      *db = fetched;
+      validator.version = 0; // 整表下载的内容不对应清单中的版本
+      irdb_flash_cache_store(key, db, &validator);
+    } else if (cached) {
+      if (ret != IRDB_HTTP_NOT_MODIFIED) {
+        LOG_WRN("HTTP fetch failed (%d), using flash copy", ret);
+      }
+      ret = IRDB_LOADED_FROM_FLASH;
+    } else if (ret > 0) {
+      ret = -EIO;
+    }
+  }
+
+  if (ret >= 0) {
+    strncpy(db->manufacturer, key->manufacturer, sizeof(db->manufacturer) - 1);
+    strncpy(db->device_type, key->device_type, sizeof(db->device_type) - 1);
+  }
+  return ret;
+}
+
+/* 批量预取 */
+int irdb_prefetch(const irdb_cache_key_t *keys, size_t count,
+                  irdb_prefetch_cb_t cb, void *user_data,
+                  irdb_prefetch_stats_t *stats) {
+  irdb_prefetch_stats_t local = {0};
+  uint32_t start = k_uptime_get_32();
+
+  if (!keys && count > 0) {
+    return -EINVAL;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    irdb_cache_key_t key = keys[i];
+    irdb_database_t *hit;
+    uint32_t t0 = k_uptime_get_32();
+    int ret;
+
+    key.source = IRDB_LOAD_HTTP;
+
+    if (irdb_cache_get(&key, &hit) == 0) {
+      irdb_cache_release(hit);
+      local.cached++;
+      ret = 0;
+    } else {
+      irdb_database_t loaded = {0};
+
+      ret = irdb_load_http_cached(&key, &loaded);
+      if (ret >= 0) {
+        if (ret == 0) {
+          local.fetched++;
+        } else {
+          local.from_flash++;
+        }
+        /* RAM预算不足时只保留flash副本 */
+        if (irdb_cache_put(&key, &loaded, NULL) < 0) {
+          irdb_free_database(&loaded);
+        }
+      } else {
+        local.failed++;
+      }
+    }
+
+    uint32_t elapsed = k_uptime_get_32() - t0;
+    local.max_ms = MAX(local.max_ms, elapsed);
+
+    if (cb) {
+      cb(i, count, &key, ret, user_data);
+    }
+  }
+
+  local.total_ms = k_uptime_get_32() - start;
+  LOG_INF("Prefetch: %u fetched, %u flash, %u cached, %u failed in %u ms",
+          local.fetched, local.from_flash, local.cached, local.failed,
+          local.total_ms);
+
+  if (stats) {
+    *stats = local;
+  }
+  return local.failed;
+}
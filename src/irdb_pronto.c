@@ -0,0 +1,197 @@
+/**
+ * @file irdb_pronto.c
+ * @brief Pronto hex编解码
+ */
+
+#include "irdb_pronto.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <zephyr/sys/util.h>
+
+#define PRONTO_ENCODE_MAX 192           // 条目编码缓冲(时长个数)
+#define PRONTO_DEFAULT_LEAD_OUT_US 40000 // 协议无重复间隔时的lead-out
+
+/* 载波周期 <-> 微秒，周期 = freq_word * 0.241246us */
+static uint32_t pronto_periods_to_us(uint32_t periods, uint16_t freq_word) {
+  return (uint64_t)periods * freq_word * 241246 / 1000000;
+}
+
+static uint16_t pronto_us_to_periods(uint32_t us, uint16_t freq_word) {
+  uint64_t unit = (uint64_t)freq_word * 241246;
+  uint64_t periods = ((uint64_t)us * 1000000 + unit / 2) / unit;
+
+  return MAX(MIN(periods, 0xFFFF), 1);
+}
+
+int irdb_pronto_parse(const char *pronto, size_t len, uint16_t *periods_out,
+                      uint32_t max_length, irdb_pronto_info_t *info) {
+  if (!pronto || !periods_out || !info) {
+    return -EINVAL;
+  }
+
+  const char *p = pronto;
+  const char *end = pronto + len;
+  uint32_t words[4];
+  char *next;
+
+  for (size_t i = 0; i < ARRAY_SIZE(words); i++) {
+    words[i] = strtoul(p, &next, 16);
+    if (next == p || next > end) {
+      return -EINVAL;
+    }
+    p = next;
+  }
+
+  if (words[0] != 0) {
+    return -ENOTSUP; // 非学习码 (如RC5 5000、NEC 900A)
+  }
+
+  uint32_t length = (words[2] + words[3]) * 2;
+  if (words[1] == 0 || words[1] > 0xFFFF || length == 0) {
+    return -EINVAL;
+  }
+  if (length > max_length) {
+    return -E2BIG;
+  }
+
+  for (uint32_t i = 0; i < length; i++) {
+    uint32_t periods = strtoul(p, &next, 16);
+    if (next == p || next > end || periods > 0xFFFF) {
+      return -EINVAL;
+    }
+    periods_out[i] = periods;
+    p = next;
+  }
+
+  info->freq_word = words[1];
+  info->carrier_freq = IRDB_PRONTO_CLOCK_HZ / words[1];
+  info->once_length = words[2] * 2;
+  info->repeat_length = words[3] * 2;
+  return 0;
+}
+
+int irdb_pronto_to_raw(const char *pronto, size_t len,
+                       ir_timing_t *timings_out, uint32_t max_length,
+                       irdb_pronto_info_t *info) {
+  /* ir_timing_t与周期数同为16位，原地换算 */
+  int ret = irdb_pronto_parse(pronto, len, timings_out, max_length, info);
+  if (ret < 0) {
+    return ret;
+  }
+
+  uint32_t length = info->once_length + info->repeat_length;
+  for (uint32_t i = 0; i < length; i++) {
+    timings_out[i] = ir_timing_pack(
+        pronto_periods_to_us(timings_out[i], info->freq_word));
+  }
+  return 0;
+}
+
+/* 追加一个序列，lead-out补在末尾 */
+static int pronto_append(char *buf, size_t size, size_t *offset,
+                         const ir_timing_t *timings, uint32_t length,
+                         uint16_t freq_word, uint32_t lead_out_us) {
+  for (uint32_t i = 0; i < length; i++) {
+    uint32_t us = ir_timing_us(timings[i]);
+    if (i == length - 1 && (length % 2) == 0) {
+      us += lead_out_us;
+    }
+    *offset += snprintf(buf + *offset, size - MIN(*offset, size), " %04X",
+                        pronto_us_to_periods(us, freq_word));
+  }
+  if (length % 2) {
+    *offset += snprintf(buf + *offset, size - MIN(*offset, size), " %04X",
+                        pronto_us_to_periods(lead_out_us, freq_word));
+  }
+  return *offset < size ? 0 : -ENOMEM;
+}
+
+/* 生成学习码，两个序列各自的lead-out */
+static int pronto_format(const ir_timing_t *once, uint32_t once_length,
+                         uint32_t once_lead_out, const ir_timing_t *repeat,
+                         uint32_t repeat_length, uint32_t repeat_lead_out,
+                         uint32_t carrier_freq, char *buf, size_t size) {
+  if ((!once && once_length) || (!repeat && repeat_length) || !buf ||
+      size == 0 || carrier_freq == 0 || once_length + repeat_length == 0) {
+    return -EINVAL;
+  }
+
+  uint32_t freq_word =
+      (IRDB_PRONTO_CLOCK_HZ + carrier_freq / 2) / carrier_freq;
+  if (freq_word == 0 || freq_word > 0xFFFF) {
+    return -EINVAL;
+  }
+
+  size_t offset = snprintf(buf, size, "0000 %04X %04X %04X", freq_word,
+                           (once_length + 1) / 2, (repeat_length + 1) / 2);
+  if (offset >= size) {
+    return -ENOMEM;
+  }
+
+  int ret = pronto_append(buf, size, &offset, once, once_length, freq_word,
+                          once_lead_out);
+  if (ret == 0) {
+    ret = pronto_append(buf, size, &offset, repeat, repeat_length, freq_word,
+                        repeat_lead_out);
+  }
+  return ret < 0 ? ret : (int)offset;
+}
+
+int irdb_pronto_from_raw(const ir_timing_t *once, uint32_t once_length,
+                         const ir_timing_t *repeat, uint32_t repeat_length,
+                         uint32_t carrier_freq, uint32_t lead_out_us,
+                         char *buf, size_t size) {
+  return pronto_format(once, once_length, lead_out_us, repeat, repeat_length,
+                       lead_out_us, carrier_freq, buf, size);
+}
+
+/* 帧与帧起点对齐: lead-out = 帧周期 - 帧长。gap对所有协议都是帧周期，
+ * 无重复码、整帧循环的协议(RC5/Sony等)同样扣除帧长 */
+static uint32_t pronto_lead_out(const irdb_protocol_params_t *params,
+                                const ir_timing_t *timings, uint32_t length) {
+  uint32_t gap = params->gap;
+
+  for (uint32_t i = 0; i < length; i++) {
+    uint32_t us = ir_timing_us(timings[i]);
+    gap = gap > us ? gap - us : 0;
+  }
+  return gap > 0 ? gap : PRONTO_DEFAULT_LEAD_OUT_US;
+}
+
+int irdb_encode_pronto(const irdb_entry_t *entry, char *buf, size_t size) {
+  if (!entry || !buf) {
+    return -EINVAL;
+  }
+
+  const irdb_protocol_params_t *params =
+      irdb_get_protocol_params(entry->protocol);
+  if (!params) {
+    return -ENOTSUP;
+  }
+
+  ir_timing_t frame[PRONTO_ENCODE_MAX];
+  uint32_t frame_length;
+  int ret = irdb_encode_to_raw(entry, frame, &frame_length, ARRAY_SIZE(frame));
+  if (ret < 0) {
+    return ret;
+  }
+
+  uint32_t lead_out = pronto_lead_out(params, frame, frame_length);
+  if (params->repeat_space == 0) {
+    /* 无重复码: 按住时整帧循环 */
+    return pronto_format(NULL, 0, 0, frame, frame_length, lead_out,
+                         params->frequency, buf, size);
+  }
+
+  ir_timing_t repeat[3];
+  uint32_t repeat_length;
+  ret = irdb_encode_repeat(entry, repeat, &repeat_length, ARRAY_SIZE(repeat));
+  if (ret < 0) {
+    return ret;
+  }
+
+  return pronto_format(frame, frame_length, lead_out, repeat, repeat_length,
+                       pronto_lead_out(params, repeat, repeat_length),
+                       params->frequency, buf, size);
+}
@@ -4,19 +4,20 @@
  */
 
 #include "irdb_protocol.h"
+#include "irdb_irp.h"
+#include "ir_mem.h"
 #include <ctype.h>
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
 
 LOG_MODULE_REGISTER(irdb_protocol, LOG_LEVEL_INF);
 
-#define TOLERANCE_PERCENT 20
 // #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
 
-/* 字符串比较（不区分大小写）- 如果系统没有提供 */
-#ifndef CONFIG_POSIX_API
+/* 字符串比较（不区分大小写）- 如果系统没有提供 (主机libc自带) */
+#if !defined(CONFIG_POSIX_API) && !defined(CONFIG_NATIVE_LIBC)
 static int strcasecmp(const char *s1, const char *s2) {
   while (*s1 && *s2) {
     int c1 = tolower((unsigned char)*s1);
@@ -31,436 +32,2405 @@ static int strcasecmp(const char *s1, const char *s2) {
 }
 #endif
 
-/* 协议参数表 - 基于IrScrutinizer标准 */
-static const irdb_protocol_params_t protocol_params[] = {
-    {.protocol_id = IRDB_PROTOCOL_NEC1,
-     .name = "NEC1",
-     .frequency = 38000,
-     .duty_cycle = 33,
-     .header_mark = 9000,
-     .header_space = 4500,
-     .bit_mark = 560,
-     .bit_0_space = 560,
-     .bit_1_space = 1690,
-     .trailer_mark = 560,
-     .gap = 108000,
-     .device_bits = 8,
-     .subdevice_bits = 8,
-     .function_bits = 8,
-     .toggle_bit = false},
-    {.protocol_id = IRDB_PROTOCOL_NEC2,
-     .name = "NEC2",
-     .frequency = 38000,
-     .duty_cycle = 33,
-     .header_mark = 9000,
-     .header_space = 4500,
-     .bit_mark = 560,
-     .bit_0_space = 560,
-     .bit_1_space = 1690,
-     .trailer_mark = 560,
-     .gap = 108000,
-     .device_bits = 16,
-     .subdevice_bits = 0,
-     .function_bits = 8,
-     .toggle_bit = false},
-    {.protocol_id = IRDB_PROTOCOL_RC5,
-     .name = "RC5",
-     .frequency = 36000,
-     .duty_cycle = 25,
-     .header_mark = 0,
-     .header_space = 0,
-     .bit_mark = 889,
-     .bit_0_space = 889,
-     .bit_1_space = 889,
-     .trailer_mark = 0,
-     .gap = 113792,
-     .device_bits = 5,
-     .subdevice_bits = 0,
-     .function_bits = 6,
-     .toggle_bit = true},
-    {.protocol_id = IRDB_PROTOCOL_SONY12,
-     .name = "Sony12",
-     .frequency = 40000,
-     .duty_cycle = 33,
-     .header_mark = 2400,
-     .header_space = 600,
-     .bit_mark = 1200,
-     .bit_0_space = 600,
-     .bit_1_space = 600, // Sony使用脉冲宽度编码
-     .trailer_mark = 0,
-     .gap = 45000,
-     .device_bits = 5,
-     .subdevice_bits = 0,
-     .function_bits = 7,
-     .toggle_bit = false},
-    {.protocol_id = IRDB_PROTOCOL_SONY15,
-     .name = "Sony15",
-     .frequency = 40000,
-     .duty_cycle = 33,
-     .header_mark = 2400,
-     .header_space = 600,
-     .bit_mark = 1200,
-     .bit_0_space = 600,
-     .bit_1_space = 600,
-     .trailer_mark = 0,
-     .gap = 45000,
-     .device_bits = 8,
-     .subdevice_bits = 0,
-     .function_bits = 7,
-     .toggle_bit = false},
-    {.protocol_id = IRDB_PROTOCOL_SAMSUNG32,
-     .name = "Samsung32",
-     .frequency = 38000,
-     .duty_cycle = 33,
-     .header_mark = 4500,
-     .header_space = 4500,
-     .bit_mark = 560,
-     .bit_0_space = 560,
-     .bit_1_space = 1690,
-     .trailer_mark = 560,
-     .gap = 108000,
-     .device_bits = 8,
-     .subdevice_bits = 8,
-     .function_bits = 8,
-     .toggle_bit = false}};
+/* 协议参数 - 基于IrScrutinizer标准 */
+static const irdb_protocol_params_t params_NEC1 = {
+    .protocol_id = IRDB_PROTOCOL_NEC1,
+    .name = "NEC1",
+    .coding = IRDB_CODING_PULSE_DISTANCE,
+    .function_inverse = true,
+    .frequency = 38000,
+    .duty_cycle = 33,
+    .header_mark = 9000,
+    .header_space = 4500,
+    .bit_mark = 560,
+    .bit_0_space = 560,
+    .bit_1_space = 1690,
+    .trailer_mark = 560,
+    .gap = 108000,
+    .repeat_space = 2250,
+    .device_bits = 8,
+    .subdevice_bits = 8,
+    .function_bits = 8,
+    .toggle_bit = false,
+};
+
+static const irdb_protocol_params_t params_NEC2 = {
+    .protocol_id = IRDB_PROTOCOL_NEC2,
+    .name = "NEC2",
+    .coding = IRDB_CODING_PULSE_DISTANCE,
+    .frequency = 38000,
+    .duty_cycle = 33,
+    .header_mark = 9000,
+    .header_space = 4500,
+    .bit_mark = 560,
+    .bit_0_space = 560,
+    .bit_1_space = 1690,
+    .trailer_mark = 560,
+    .gap = 108000,
+    .repeat_space = 2250,
+    .device_bits = 16,
+    .subdevice_bits = 0,
+    .function_bits = 8,
+    .toggle_bit = false,
+};
+
+static const irdb_protocol_params_t params_RC5 = {
+    .protocol_id = IRDB_PROTOCOL_RC5,
+    .name = "RC5",
+    .coding = IRDB_CODING_BIPHASE,
+    .frequency = 36000,
+    .duty_cycle = 25,
+    .header_mark = 0,
+    .header_space = 0,
+    .bit_mark = 889,
+    .bit_0_space = 889,
+    .bit_1_space = 889,
+    .trailer_mark = 0,
+    .gap = 113792,
+    .device_bits = 5,
+    .subdevice_bits = 0,
+    .function_bits = 6,
+    .toggle_bit = true,
+};
+
+/* RC6模式0 - 时间单位T=444us，引导6T/2T，数据为D:8 F:8 */
+static const irdb_protocol_params_t params_RC6 = {
+    .protocol_id = IRDB_PROTOCOL_RC6,
+    .name = "RC6",
+    .coding = IRDB_CODING_RC6,
+    .frequency = 36000,
+    .duty_cycle = 33,
+    .header_mark = 2664,
+    .header_space = 888,
+    .bit_mark = 444,
+    .bit_0_space = 444,
+    .bit_1_space = 444,
+    .trailer_mark = 0,
+    .gap = 107000,
+    .device_bits = 8,
+    .subdevice_bits = 0,
+    .function_bits = 8,
+    .toggle_bit = true,
+};
+
+static const irdb_protocol_params_t params_SONY12 = {
+    .protocol_id = IRDB_PROTOCOL_SONY12,
+    .name = "Sony12",
+    .coding = IRDB_CODING_PULSE_WIDTH,
+    .frequency = 40000,
+    .duty_cycle = 33,
+    .header_mark = 2400,
+    .header_space = 600,
+    .bit_mark = 1200,
+    .bit_0_space = 600,
+    .bit_1_space = 600, // Sony使用脉冲宽度编码
+    .trailer_mark = 0,
+    .gap = 45000,
+    .device_bits = 5,
+    .subdevice_bits = 0,
+    .function_bits = 7,
+    .toggle_bit = false,
+    .min_frames = 3,
+};
+
+static const irdb_protocol_params_t params_SONY15 = {
+    .protocol_id = IRDB_PROTOCOL_SONY15,
+    .name = "Sony15",
+    .coding = IRDB_CODING_PULSE_WIDTH,
+    .frequency = 40000,
+    .duty_cycle = 33,
+    .header_mark = 2400,
+    .header_space = 600,
+    .bit_mark = 1200,
+    .bit_0_space = 600,
+    .bit_1_space = 600,
+    .trailer_mark = 0,
+    .gap = 45000,
+    .device_bits = 8,
+    .subdevice_bits = 0,
+    .function_bits = 7,
+    .toggle_bit = false,
+    .min_frames = 3,
+};
+
+static const irdb_protocol_params_t params_SONY20 = {
+    .protocol_id = IRDB_PROTOCOL_SONY20,
+    .name = "Sony20",
+    .coding = IRDB_CODING_PULSE_WIDTH,
+    .frequency = 40000,
+    .duty_cycle = 33,
+    .header_mark = 2400,
+    .header_space = 600,
+    .bit_mark = 1200,
+    .bit_0_space = 600,
+    .bit_1_space = 600,
+    .trailer_mark = 0,
+    .gap = 45000,
+    .device_bits = 5,
+    .subdevice_bits = 8,
+    .function_bits = 7,
+    .toggle_bit = false,
+    .min_frames = 3,
+};
+
+static const irdb_protocol_params_t params_SAMSUNG32 = {
+    .protocol_id = IRDB_PROTOCOL_SAMSUNG32,
+    .name = "Samsung32",
+    .coding = IRDB_CODING_PULSE_DISTANCE,
+    .frequency = 38000,
+    .duty_cycle = 33,
+    .header_mark = 4500,
+    .header_space = 4500,
+    .bit_mark = 560,
+    .bit_0_space = 560,
+    .bit_1_space = 1690,
+    .trailer_mark = 560,
+    .gap = 108000,
+    .device_bits = 8,
+    .subdevice_bits = 8,
+    .function_bits = 8,
+    .toggle_bit = false,
+};
+
+/* Samsung36 - D:8 S:8之后有同步脉冲，功能码12位(高4位为扩展码E)，附加8位反码 */
+static const irdb_protocol_params_t params_SAMSUNG36 = {
+    .protocol_id = IRDB_PROTOCOL_SAMSUNG36,
+    .name = "Samsung36",
+    .coding = IRDB_CODING_PULSE_DISTANCE,
+    .function_inverse = true,
+    .frequency = 38000,
+    .duty_cycle = 33,
+    .header_mark = 4500,
+    .header_space = 4500,
+    .bit_mark = 500,
+    .bit_0_space = 500,
+    .bit_1_space = 1500,
+    .trailer_mark = 500,
+    .gap = 108000,
+    .sync_space = 4500,
+    .sync_bit = 16,
+    .device_bits = 8,
+    .subdevice_bits = 8,
+    .function_bits = 12,
+    .toggle_bit = false,
+};
+
+/* 已实现的协议 - 新增协议只需定义params_<ID>并加入此列表 */
+#define PROTOCOL_LIST(X)                                                       \
+  X(NEC1)                                                                      \
+  X(NEC2)                                                                      \
+  X(RC5)                                                                       \
+  X(RC6)                                                                       \
+  X(SONY12)                                                                    \
+  X(SONY15)                                                                    \
+  X(SONY20)                                                                    \
+  X(SAMSUNG32)                                                                 \
+  X(SAMSUNG36)
+
+/* 按协议编号直接索引的参数表，空位可在运行时注册自定义协议 */
+#define PROTOCOL_PARAMS_REF(id) [IRDB_PROTOCOL_##id] = &params_##id,
+static const irdb_protocol_params_t *protocol_params[IRDB_PROTOCOL_MAX_ID + 1] =
+    {PROTOCOL_LIST(PROTOCOL_PARAMS_REF)};
+
+/* 各协议的时序窗口 - 按容差预先算好[lo, lo + span]，匹配只需一次无符号
+ * 比较(低于lo时差值回绕为大数)，解码热路径上没有乘除 */
+typedef struct {
+  uint32_t lo;
+  uint32_t span;
+} timing_window_t;
+
+enum {
+  WIN_HEADER_MARK,
+  WIN_HEADER_SPACE,
+  WIN_BIT_MARK, // 也是双相/RC6的1个半位
+  WIN_HALF_MARK, // 脉冲宽度编码的0 (bit_mark/2)
+  WIN_BIT_0,
+  WIN_BIT_1,
+  WIN_TRAILER,
+  WIN_REPEAT,
+  WIN_SYNC,
+  WIN_UNIT_2, // 2个半位
+  WIN_UNIT_3, // 3个半位 (RC6 toggle位与相邻半位合并)
+  WIN_HEADER_DRIFT, // 以下按容差加时钟偏差: 引导mark
+  WIN_LEAD_DRIFT,   // 引导mark + space
+  WIN_UNIT_DRIFT,   // 单个位单元 (bit_mark)
+  WIN_COUNT
+};
+
+/* 帧时间缩放 - Q12定点，标称/实测 */
+#define SCALE_SHIFT 12
+#define SCALE_ONE (1U << SCALE_SHIFT)
+#define SCALE_UNITS 8 // 无引导码时参与估计的首部时长数
+
+static inline uint32_t scaled_us(ir_timing_t t, uint32_t scale) {
+  return (ir_timing_us(t) * scale) >> SCALE_SHIFT;
+}
+
+static timing_window_t protocol_windows[IRDB_PROTOCOL_MAX_ID + 1][WIN_COUNT];
+static atomic_t windows_ready;
+
+/* 自适应窗口 - 每槽两份表轮换: 改写不在用的一份再发布指针，解码中的读者
+ * 始终看到完整的表 */
+static struct {
+  bool used;
+  uint8_t protocol;
+  uint8_t next; // 下次改写的表
+  timing_window_t win[2][WIN_COUNT];
+} adapt_slots[IRDB_ADAPT_PROTOCOLS];
+static atomic_ptr_t adapted_windows[IRDB_PROTOCOL_MAX_ID + 1];
+
+/* 自适应类别对应的窗口 */
+static const uint8_t adapt_class_win[IRDB_ADAPT_CLASSES] = {
+    [IRDB_ADAPT_HEADER_MARK] = WIN_HEADER_MARK,
+    [IRDB_ADAPT_HEADER_SPACE] = WIN_HEADER_SPACE,
+    [IRDB_ADAPT_BIT_MARK] = WIN_BIT_MARK,
+    [IRDB_ADAPT_BIT_0] = WIN_BIT_0,
+    [IRDB_ADAPT_BIT_1] = WIN_BIT_1,
+};
+
+/* 期望值为0的窗口只匹配0 */
+static timing_window_t window_pct(uint32_t expected, uint32_t percent) {
+  uint32_t tolerance = expected * percent / 100;
+
+  return (timing_window_t){.lo = expected - tolerance, .span = 2 * tolerance};
+}
+
+static timing_window_t window_for(uint32_t expected) {
+  return window_pct(expected, IRDB_TIMING_TOLERANCE);
+}
+
+static void windows_build(const irdb_protocol_params_t *params,
+                          timing_window_t *win) {
+  win[WIN_HEADER_MARK] = window_for(params->header_mark);
+  win[WIN_HEADER_SPACE] = window_for(params->header_space);
+  win[WIN_BIT_MARK] = window_for(params->bit_mark);
+  win[WIN_HALF_MARK] = window_for(params->bit_mark / 2);
+  win[WIN_BIT_0] = window_for(params->bit_0_space);
+  win[WIN_BIT_1] = window_for(params->bit_1_space);
+  win[WIN_TRAILER] = window_for(params->trailer_mark);
+  win[WIN_REPEAT] = window_for(params->repeat_space);
+  win[WIN_SYNC] = window_for(params->sync_space);
+  win[WIN_UNIT_2] = window_for(2 * params->bit_mark);
+  win[WIN_UNIT_3] = window_for(3 * params->bit_mark);
+
+  uint32_t drift = IRDB_TIMING_TOLERANCE + IRDB_CLOCK_DRIFT;
+  win[WIN_HEADER_DRIFT] = window_pct(params->header_mark, drift);
+  win[WIN_LEAD_DRIFT] =
+      window_pct(params->header_mark + params->header_space, drift);
+  win[WIN_UNIT_DRIFT] = window_pct(params->bit_mark, drift);
+}
+
+/* 协议的标称时序窗口 - 内置协议首次使用时统一计算(并发时各线程写入相同
+ * 的值，且都在读取前写完)，自定义协议在注册时计算 */
+static const timing_window_t *
+nominal_windows_of(const irdb_protocol_params_t *params) {
+  if (!atomic_get(&windows_ready)) {
+    for (size_t id = 0; id < ARRAY_SIZE(protocol_params); id++) {
+      if (protocol_params[id]) {
+        windows_build(protocol_params[id], protocol_windows[id]);
+      }
+    }
+    atomic_set(&windows_ready, 1);
+  }
+  return protocol_windows[params->protocol_id];
+}
+
+/* 解码用的时序窗口 - 有自适应窗口时用它 */
+static const timing_window_t *windows_of(const irdb_protocol_params_t *params) {
+  const timing_window_t *adapted =
+      atomic_ptr_get(&adapted_windows[params->protocol_id]);
+
+  return adapted ? adapted : nominal_windows_of(params);
+}
+
+static inline bool in_window(const timing_window_t *win, uint32_t us) {
+  return us - win->lo <= win->span;
+}
+
+/* 由引导码mark+space估计缩放 - 和不受接收头展宽mark、缩短space的影响 */
+static uint32_t lead_scale(const irdb_protocol_params_t *params,
+                           uint32_t lead_us) {
+  if (IRDB_CLOCK_DRIFT == 0 || lead_us == 0) {
+    return SCALE_ONE;
+  }
+  return ((params->header_mark + params->header_space) << SCALE_SHIFT) /
+         lead_us;
+}
+
+/* 估计整帧的时间缩放 - 有引导码按引导码; 否则取首部落在单个位单元附近
+ * (容差加时钟偏差)的时长的平均，mark和space都计入以抵消接收头偏差。
+ * 估计不出时不缩放 */
+static uint32_t frame_scale(const irdb_protocol_params_t *params,
+                            const timing_window_t *win,
+                            const ir_timing_t *timings, uint32_t length) {
+  uint32_t measured = 0;
+  uint32_t n = 0;
+
+  if (IRDB_CLOCK_DRIFT == 0) {
+    return SCALE_ONE;
+  }
+
+  if (params->header_mark > 0) {
+    if (length < 2) {
+      return SCALE_ONE;
+    }
+    measured = ir_timing_us(timings[0]) + ir_timing_us(timings[1]);
+    return in_window(&win[WIN_LEAD_DRIFT], measured)
+               ? lead_scale(params, measured)
+               : SCALE_ONE;
+  }
+
+  for (uint32_t i = 0; i < length && i < SCALE_UNITS; i++) {
+    uint32_t us = ir_timing_us(timings[i]);
+
+    if (in_window(&win[WIN_UNIT_DRIFT], us)) {
+      measured += us;
+      n++;
+    }
+  }
+  if (n == 0 || measured == 0) {
+    return SCALE_ONE;
+  }
+  return (params->bit_mark * n << SCALE_SHIFT) / measured;
+}
+
+/* 获取协议参数 */
+const irdb_protocol_params_t *
+irdb_get_protocol_params(irdb_protocol_id_t protocol) {
+  if ((uint32_t)protocol > IRDB_PROTOCOL_MAX_ID) {
+    return NULL;
+  }
+  return protocol_params[protocol];
+}
+
+/* 注册自定义协议 */
+int irdb_register_protocol(const irdb_protocol_params_t *params) {
+  if (!params || (uint32_t)params->protocol_id > IRDB_PROTOCOL_MAX_ID ||
+      params->coding > IRDB_CODING_IRP || params->function_bits == 0 ||
+      (params->coding == IRDB_CODING_IRP &&
+       irdb_irp_check(params->program) < 0) ||
+      params->device_bits + params->subdevice_bits + params->function_bits +
+              (params->function_inverse ? 8 : 0) >
+          64) {
+    return -EINVAL;
+  }
+
+  if (protocol_params[params->protocol_id]) {
+    return -EEXIST;
+  }
+
+  /* 先算好窗口再发布参数，解码线程看到参数时窗口已就绪 */
+  windows_build(params, protocol_windows[params->protocol_id]);
+  protocol_params[params->protocol_id] = params;
+  LOG_INF("Registered protocol %u (%s)", params->protocol_id,
+          params->name ? params->name : "?");
+  return 0;
+}
+
+/* 跳过行内空白 */
+static const char *skip_blank(const char *p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\t')) {
+    p++;
+  }
+  return p;
+}
+
+/* 解析功能名字段 - 支持双引号包围及""转义，p前进到字段之后 */
+static const char *parse_name_field(const char *p, const char *end,
+                                    char *name, size_t name_size) {
+  size_t n = 0;
+
+  p = skip_blank(p, end);
+
+  if (p < end && *p == '"') {
+    p++;
+    while (p < end) {
+      char c = *p++;
+      if (c == '"') {
+        if (p < end && *p == '"') {
+          p++; // 转义的引号
+        } else {
+          break;
+        }
+      }
+      if (n < name_size - 1) {
+        name[n++] = c;
+      }
+    }
+    p = skip_blank(p, end);
+  } else {
+    while (p < end && *p != ',') {
+      if (n < name_size - 1) {
+        name[n++] = *p;
+      }
+      p++;
+    }
+    while (n > 0 && (name[n - 1] == ' ' || name[n - 1] == '\t')) {
+      n--;
+    }
+  }
+
+  name[n] = '\0';
+  return p;
+}
+
+/* 解析无符号整数字段，失败返回NULL */
+static const char *parse_uint_field(const char *p, const char *end,
+                                    uint16_t *value) {
+  uint32_t v = 0;
+
+  p = skip_blank(p, end);
+  if (p >= end || *p < '0' || *p > '9') {
+    return NULL;
+  }
+
+  while (p < end && *p >= '0' && *p <= '9') {
+    v = v * 10 + (*p++ - '0');
+    if (v > UINT16_MAX) {
+      return NULL;
+    }
+  }
+
+  *value = v;
+  return skip_blank(p, end);
+}
+
+/* 解析一条记录 [p, end)，不含行结束符
+ * 格式: function_name, protocol, device, subdevice, function
+ * 示例: Power,1,7,7,12 或 "Vol, up",1,7,7,12 */
+static int parse_csv_record(const char *p, const char *end,
+                            irdb_entry_t *entry, char *name) {
+  uint16_t *fields[] = {&entry->protocol, &entry->device, &entry->subdevice,
+                        &entry->function};
+
+  memset(entry, 0, sizeof(*entry));
+
+  p = parse_name_field(p, end, name, IRDB_NAME_MAX);
+
+  for (size_t i = 0; i < ARRAY_SIZE(fields); i++) {
+    if (p >= end || *p != ',') {
+      return -EINVAL;
+    }
+    p = parse_uint_field(p + 1, end, fields[i]);
+    if (!p) {
+      return -EINVAL; // 包括表头行 (protocol列非数字)
+    }
+  }
+
+  /* 允许多余的列 */
+  return (p == end || *p == ',') ? 0 : -EINVAL;
+}
+
+/* 内存区对齐 (4字节) */
+static inline size_t arena_align(size_t offset) {
+  return (offset + 3) & ~(size_t)3;
+}
+
+/* 内存区分配，空间不足返回NULL */
+static void *arena_alloc(irdb_arena_t *arena, size_t size) {
+  size_t offset = arena_align(arena->used);
+
+  if (offset + size > arena->size) {
+    return NULL;
+  }
+
+  arena->used = offset + size;
+  return arena->base + offset;
+}
+
+/* 初始化内存区 */
+void irdb_arena_init(irdb_arena_t *arena, void *buf, size_t size) {
+  arena->base = buf;
+  arena->size = size;
+  arena->used = 0;
+}
+
+/* 预留条目容量 */
+int irdb_parser_reserve(irdb_parser_t *ctx, uint32_t count) {
+  irdb_database_t *db = ctx->db;
+
+  if (count <= ctx->capacity) {
+    return 0;
+  }
+
+  if (db->arena) {
+    /* 条目在arena顶部连续增长，名称池分配后不可再扩展 */
+    if (db->names) {
+      return -ENOMEM;
+    }
+    size_t need = (size_t)(count - ctx->capacity) * sizeof(irdb_entry_t);
+    if (db->arena->used + need > db->arena->size) {
+      return -ENOMEM;
+    }
+    db->arena->used += need;
+  } else {
+    irdb_entry_t *new_entries =
+        irdb_heap_realloc(db->entries, count * sizeof(irdb_entry_t));
+    if (!new_entries) {
+      return -ENOMEM;
+    }
+    db->entries = new_entries;
+  }
+
+  ctx->capacity = count;
+  return 0;
+}
+
+/* 追加一个空条目，按需扩展数组 */
+static irdb_entry_t *parser_slot(irdb_parser_t *ctx) {
+  irdb_database_t *db = ctx->db;
+
+  if (db->entry_count >= ctx->capacity) {
+    /* arena中逐条增长；堆上未预留时退回倍增 */
+    uint32_t capacity = db->arena          ? ctx->capacity + 1
+                        : ctx->capacity == 0 ? 16
+                                             : ctx->capacity * 2;
+    if (irdb_parser_reserve(ctx, capacity) < 0) {
+      return NULL;
+    }
+  }
+
+  return &db->entries[db->entry_count];
+}
+
+/* 功能名称存入字符串池，返回偏移或负错误码 */
+static int parser_intern(irdb_parser_t *ctx, const char *name) {
+  irdb_database_t *db = ctx->db;
+  size_t len = strlen(name) + 1;
+
+  if (db->names_len + len > IRDB_NAME_POOL_MAX) {
+    LOG_ERR("Name pool full");
+    return -ENOSPC;
+  }
+
+  if (db->names_len + len > ctx->names_cap) {
+    if (db->arena) {
+      /* 名称池在arena顶部连续增长，此后条目数组不可再扩展 */
+      if (!db->names) {
+        db->names = (char *)(db->arena->base + db->arena->used);
+      }
+      if (db->arena->used + len > db->arena->size) {
+        return -ENOMEM;
+      }
+      db->arena->used += len;
+      ctx->names_cap += len;
+    } else {
+      uint32_t cap = MAX(ctx->names_cap * 2, 256);
+      char *names = irdb_heap_realloc(db->names, MIN(cap, IRDB_NAME_POOL_MAX));
+      if (!names) {
+        return -ENOMEM;
+      }
+      db->names = names;
+      ctx->names_cap = MIN(cap, IRDB_NAME_POOL_MAX);
+    }
+  }
+
+  int offset = db->names_len;
+  memcpy(db->names + offset, name, len);
+  db->names_len += len;
+  return offset;
+}
+
+/* 处理一个完整行 [line, end) */
+static int parser_line(irdb_parser_t *ctx, const char *line,
+                       const char *end) {
+  ctx->lines++;
+
+  // 跳过空行和注释
+  line = skip_blank(line, end);
+  if (line == end || *line == '#') {
+    return 0;
+  }
+
+  irdb_entry_t *entry = parser_slot(ctx);
+  if (!entry) {
+    LOG_ERR("Memory allocation failed");
+    return -ENOMEM;
+  }
+
+  // 解析行 (表头和格式错误的行被跳过)
+  char name[IRDB_NAME_MAX];
+  if (parse_csv_record(line, end, entry, name) < 0) {
+    return 0;
+  }
+
+  int offset = parser_intern(ctx, name);
+  if (offset < 0) {
+    return offset;
+  }
+
+  entry->name = offset;
+  ctx->db->entry_count++;
+  return 0;
+}
+
+/* 初始化流式解析器 */
+int irdb_parser_init(irdb_parser_t *ctx, irdb_database_t *db,
+                     irdb_arena_t *arena) {
+  if (!ctx || !db) {
+    return -EINVAL;
+  }
+
+  memset(ctx, 0, sizeof(*ctx));
+  memset(db, 0, sizeof(irdb_database_t));
+  ctx->db = db;
+
+  if (arena) {
+    arena->used = arena_align(arena->used);
+    if (arena->used > arena->size) {
+      arena->used = arena->size;
+    }
+    db->arena = arena;
+    db->arena_mark = arena->used;
+    db->entries = (irdb_entry_t *)(arena->base + arena->used);
+  }
+  return 0;
+}
+
+/* 累计输入解析器的字节数 */
+static atomic_t parsed_bytes;
+
+/* 输入一块数据 - 完整行直接在块内解析，仅块尾的半行被暂存 */
+int irdb_parser_feed(irdb_parser_t *ctx, const char *chunk, size_t len) {
+  if (!ctx || !ctx->db || (!chunk && len > 0)) {
+    return -EINVAL;
+  }
+
+  if (ctx->error) {
+    return ctx->error;
+  }
+
+  atomic_add(&parsed_bytes, len);
+
+  const char *p = chunk;
+  const char *end = chunk + len;
+
+  // 跳过UTF-8 BOM (仅文件开头，可能跨块)
+  static const uint8_t bom[] = {0xEF, 0xBB, 0xBF};
+  while (ctx->bom_pos < sizeof(bom) && p < end) {
+    if ((uint8_t)*p != bom[ctx->bom_pos]) {
+      ctx->bom_pos = sizeof(bom);
+      break;
+    }
+    p++;
+    ctx->bom_pos++;
+  }
+
+  while (p < end) {
+    const char *line = p;
+
+    // 定位行尾 (兼容LF/CRLF/CR)
+    while (p < end && *p != '\n' && *p != '\r') {
+      p++;
+    }
+
+    if (p == end) {
+      // 半行: 暂存到下一块，超长行截断(解析时会被拒绝或截断名称)
+      size_t n = MIN((size_t)(end - line),
+                     sizeof(ctx->carry) - ctx->carry_len);
+      memcpy(ctx->carry + ctx->carry_len, line, n);
+      ctx->carry_len += n;
+      break;
+    }
+
+    int ret;
+    if (ctx->carry_len > 0) {
+      // 与上一块的半行拼接
+      size_t n = MIN((size_t)(p - line), sizeof(ctx->carry) - ctx->carry_len);
+      memcpy(ctx->carry + ctx->carry_len, line, n);
+      ret = parser_line(ctx, ctx->carry, ctx->carry + ctx->carry_len + n);
+      ctx->carry_len = 0;
+    } else {
+      ret = parser_line(ctx, line, p);
+    }
+
+    if (ret < 0) {
+      ctx->error = ret;
+      return ret;
+    }
+
+    // 跳过行结束符
+    while (p < end && (*p == '\n' || *p == '\r')) {
+      p++;
+    }
+  }
+
+  return 0;
+}
+
+uint32_t irdb_parser_bytes(void) {
+  return atomic_get(&parsed_bytes);
+}
+
+/* 结束解析 - 处理最后一个无换行的行并建索引 */
+int irdb_parser_finish(irdb_parser_t *ctx) {
+  if (!ctx || !ctx->db) {
+    return -EINVAL;
+  }
+
+  int ret = ctx->error;
+  if (ret == 0 && ctx->carry_len > 0) {
+    ret = parser_line(ctx, ctx->carry, ctx->carry + ctx->carry_len);
+    ctx->carry_len = 0;
+  }
+
+  if (ret < 0) {
+    irdb_free_database(ctx->db);
+    return ret;
+  }
+
+  LOG_INF("Parsed %u IRDB entries", ctx->db->entry_count);
+  return irdb_build_index(ctx->db);
+}
+
+/* 解析CSV数据 - 原地解析，不复制行 */
+int irdb_parse_csv(const char *csv_data, irdb_database_t *db) {
+  if (!csv_data || !db) {
+    return -EINVAL;
+  }
+
+  return irdb_parse_csv_into(NULL, csv_data, db);
+}
+
+/* 统计行数 (条目数上限) */
+static uint32_t count_lines(const char *p, size_t len) {
+  uint32_t lines = 1;
+
+  for (size_t i = 0; i < len; i++) {
+    if (p[i] == '\n') {
+      lines++;
+    }
+  }
+  return lines;
+}
+
+/* 解析CSV数据到内存区 */
+int irdb_parse_csv_into(irdb_arena_t *arena, const char *csv_data,
+                        irdb_database_t *db) {
+  if (!csv_data || !db) {
+    return -EINVAL;
+  }
+
+  size_t len = strlen(csv_data);
+  irdb_parser_t ctx;
+
+  irdb_parser_init(&ctx, db, arena);
+
+  /* 第一遍只统计行数，条目数组一次分配到位 */
+  int ret = irdb_parser_reserve(&ctx, count_lines(csv_data, len));
+  if (ret < 0) {
+    LOG_ERR("Memory allocation failed");
+    irdb_free_database(db);
+    return ret;
+  }
+
+  irdb_parser_feed(&ctx, csv_data, len);
+  return irdb_parser_finish(&ctx);
+}
+
+/* 释放数据库 */
+void irdb_free_database(irdb_database_t *db) {
+  if (!db) {
+    return;
+  }
+
+  /* 名称序总在堆中，与库的存放方式无关 */
+  irdb_heap_free(db->name_order);
+  db->name_order = NULL;
+
+  if (db->image) {
+    /* 只读镜像，读入堆中的才需归还 */
+    irdb_heap_free(db->image_buf);
+  } else if (db->arena) {
+    /* O(1): 整体回退内存区 */
+    db->arena->used = db->arena_mark;
+  } else if (db->entries || db->names) {
+    irdb_heap_free(db->entries);
+    irdb_heap_free(db->names);
+    irdb_heap_free(db->hash_slots);
+  } else {
+    return;
+  }
+
+  memset(db, 0, sizeof(irdb_database_t));
+}
+
+/* 码值哈希 */
+static uint32_t code_hash(uint16_t protocol, uint16_t device,
+                          uint16_t subdevice, uint16_t function) {
+  uint32_t h = ((uint32_t)protocol << 16 | device) * 0x9E3779B1u;
+  h ^= ((uint32_t)subdevice << 16 | function) * 0x85EBCA77u;
+  return h ^ (h >> 15);
+}
+
+/* 名称哈希 (FNV-1a，按小写折叠) */
+static uint32_t name_hash(const char *name) {
+  uint32_t h = 2166136261u;
+
+  while (*name) {
+    h ^= (uint8_t)tolower((unsigned char)*name++);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+/* 记录库中出现的协议 */
+static void collect_protocols(const irdb_database_t *db, uint16_t *protocols,
+                              uint8_t *count) {
+  *count = 0;
+
+  for (uint32_t i = 0; i < db->entry_count; i++) {
+    uint16_t protocol = db->entries[i].protocol;
+    uint8_t j;
+
+    for (j = 0; j < *count; j++) {
+      if (protocols[j] == protocol) {
+        break;
+      }
+    }
+
+    if (j == *count) {
+      if (*count >= IRDB_MAX_DB_PROTOCOLS) {
+        LOG_WRN("Too many protocols, %u not indexed", protocol);
+        continue;
+      }
+      protocols[(*count)++] = protocol;
+    }
+  }
+}
+
+/* 建立解码索引 */
+int irdb_build_index(irdb_database_t *db) {
+  if (!db) {
+    return -EINVAL;
+  }
+
+  if (db->image) {
+    return 0; // 镜像自带索引
+  }
+
+  if (!db->arena) {
+    irdb_heap_free(db->hash_slots);
+  }
+  db->hash_slots = NULL;
+  db->name_slots = NULL;
+  db->hash_mask = 0;
+
+  collect_protocols(db, db->protocols, &db->protocol_count);
+
+  if (db->entry_count == 0 || db->entry_count >= UINT16_MAX) {
+    return 0;
+  }
+
+  /* 负载因子不超过0.5 */
+  uint32_t size = 16;
+  while (size < db->entry_count * 2) {
+    size <<= 1;
+  }
+
+  /* 码值表和名称表共用一次分配: [0, size)码值，[size, 2*size)名称 */
+  if (db->arena) {
+    db->hash_slots = arena_alloc(db->arena, 2 * size * sizeof(uint16_t));
+    if (db->hash_slots) {
+      memset(db->hash_slots, 0, 2 * size * sizeof(uint16_t));
+    }
+  } else {
+    db->hash_slots = irdb_heap_calloc(2 * size, sizeof(uint16_t));
+  }
+  if (!db->hash_slots) {
+    LOG_WRN("No memory for hash index, using linear lookup");
+    return 0;
+  }
+  db->hash_mask = size - 1;
+  db->name_slots = db->hash_slots + size;
+
+  for (uint32_t i = 0; i < db->entry_count; i++) {
+    const irdb_entry_t *e = &db->entries[i];
+    uint32_t slot =
+        code_hash(e->protocol, e->device, e->subdevice, e->function) &
+        db->hash_mask;
+
+    while (db->hash_slots[slot] != 0) {
+      slot = (slot + 1) & db->hash_mask;
+    }
+    db->hash_slots[slot] = i + 1;
+
+    /* 同名条目按出现顺序排在探测链上，查找返回最先出现的 */
+    slot = name_hash(irdb_entry_name(db, e)) & db->hash_mask;
+    while (db->name_slots[slot] != 0) {
+      slot = (slot + 1) & db->hash_mask;
+    }
+    db->name_slots[slot] = i + 1;
+  }
+
+  return 0;
+}
+
+/* 按码值查找条目 - 重复码值返回最先出现的条目 */
+const irdb_entry_t *irdb_lookup_code(const irdb_database_t *db,
+                                     uint16_t protocol, uint16_t device,
+                                     uint16_t subdevice, uint16_t function) {
+  if (!db) {
+    return NULL;
+  }
+
+  if (!db->hash_slots) {
+    for (uint32_t i = 0; i < db->entry_count; i++) {
+      const irdb_entry_t *e = &db->entries[i];
+      if (e->protocol == protocol && e->device == device &&
+          e->subdevice == subdevice && e->function == function) {
+        return e;
+      }
+    }
+    return NULL;
+  }
+
+  uint32_t slot =
+      code_hash(protocol, device, subdevice, function) & db->hash_mask;
+
+  while (db->hash_slots[slot] != 0) {
+    const irdb_entry_t *e = &db->entries[db->hash_slots[slot] - 1];
+    if (e->protocol == protocol && e->device == device &&
+        e->subdevice == subdevice && e->function == function) {
+      return e;
+    }
+    slot = (slot + 1) & db->hash_mask;
+  }
+
+  return NULL;
+}
+
+/* 获取功能名称 */
+const char *irdb_entry_name(const irdb_database_t *db,
+                            const irdb_entry_t *entry) {
+  if (!db || !entry || !db->names || entry->name >= db->names_len) {
+    return "";
+  }
+
+  return db->names + entry->name;
+}
+
+/* 遍历条目 */
+int irdb_for_each_entry(const irdb_database_t *db, uint32_t start,
+                        irdb_entry_cb_t cb, void *user_data) {
+  if (!db || !cb) {
+    return -EINVAL;
+  }
+
+  for (uint32_t i = start; i < db->entry_count; i++) {
+    int ret = cb(db, i, &db->entries[i], user_data);
+    if (ret != 0) {
+      return ret;
+    }
+  }
+  return 0;
+}
+
+/* 遍历同名条目 - 同名条目按出现顺序排在同一条探测链上 */
+int irdb_for_each_named(const irdb_database_t *db, const char *function_name,
+                        irdb_entry_cb_t cb, void *user_data) {
+  if (!db || !function_name || !cb) {
+    return -EINVAL;
+  }
+
+  if (!db->name_slots) {
+    for (uint32_t i = 0; i < db->entry_count; i++) {
+      const irdb_entry_t *e = &db->entries[i];
+      if (strcasecmp(irdb_entry_name(db, e), function_name) == 0) {
+        int ret = cb(db, i, e, user_data);
+        if (ret != 0) {
+          return ret;
+        }
+      }
+    }
+    return 0;
+  }
+
+  uint32_t slot = name_hash(function_name) & db->hash_mask;
+
+  while (db->name_slots[slot] != 0) {
+    uint32_t id = db->name_slots[slot] - 1;
+    const irdb_entry_t *e = &db->entries[id];
+    if (strcasecmp(irdb_entry_name(db, e), function_name) == 0) {
+      int ret = cb(db, id, e, user_data);
+      if (ret != 0) {
+        return ret;
+      }
+    }
+    slot = (slot + 1) & db->hash_mask;
+  }
+  return 0;
+}
+
+/* 查找功能编号 */
+int irdb_find_function_id(const irdb_database_t *db,
+                          const char *function_name) {
+  if (!db || !function_name) {
+    return -EINVAL;
+  }
+
+  if (!db->name_slots) {
+    for (uint32_t i = 0; i < db->entry_count; i++) {
+      if (strcasecmp(irdb_entry_name(db, &db->entries[i]), function_name) ==
+          0) {
+        return i;
+      }
+    }
+    return -ENOENT;
+  }
+
+  uint32_t slot = name_hash(function_name) & db->hash_mask;
+
+  while (db->name_slots[slot] != 0) {
+    uint32_t id = db->name_slots[slot] - 1;
+    if (strcasecmp(irdb_entry_name(db, &db->entries[id]), function_name) ==
+        0) {
+      return id;
+    }
+    slot = (slot + 1) & db->hash_mask;
+  }
+
+  return -ENOENT;
+}
+
+/* 名称序比较 - 不区分大小写，同名按下标，排序结果唯一 */
+static int name_order_cmp(const irdb_database_t *db, uint16_t a, uint16_t b) {
+  int c = strcasecmp(irdb_entry_name(db, &db->entries[a]),
+                     irdb_entry_name(db, &db->entries[b]));
+  return c != 0 ? c : (int)a - (int)b;
+}
+
+static void name_order_sift(const irdb_database_t *db, uint16_t *order,
+                            uint32_t root, uint32_t count) {
+  for (;;) {
+    uint32_t child = 2 * root + 1;
+
+    if (child >= count) {
+      return;
+    }
+    if (child + 1 < count &&
+        name_order_cmp(db, order[child], order[child + 1]) < 0) {
+      child++;
+    }
+    if (name_order_cmp(db, order[root], order[child]) >= 0) {
+      return;
+    }
+
+    uint16_t tmp = order[root];
+    order[root] = order[child];
+    order[child] = tmp;
+    root = child;
+  }
+}
+
+/* 建立名称序 - 堆排序: 不递归、不占额外内存，qsort的比较函数拿不到db */
+int irdb_build_name_order(irdb_database_t *db) {
+  if (!db) {
+    return -EINVAL;
+  }
+  if (db->name_order || db->entry_count == 0) {
+    return 0;
+  }
+  if (db->entry_count >= UINT16_MAX) {
+    return -E2BIG;
+  }
+
+  uint32_t count = db->entry_count;
+  uint16_t *order = irdb_heap_alloc(count * sizeof(uint16_t));
+  if (!order) {
+    LOG_WRN("No memory for name order, using linear prefix search");
+    return -ENOMEM;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    order[i] = i;
+  }
+  for (uint32_t i = count / 2; i-- > 0;) {
+    name_order_sift(db, order, i, count);
+  }
+  for (uint32_t end = count - 1; end > 0; end--) {
+    uint16_t tmp = order[0];
+    order[0] = order[end];
+    order[end] = tmp;
+    name_order_sift(db, order, 0, end);
+  }
+
+  db->name_order = order;
+  return 0;
+}
+
+/* 名称前len个字符与前缀比较 (不区分大小写)，名称较短时以结束符参与比较 */
+static int prefix_cmp(const char *name, const char *prefix, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    int c1 = tolower((unsigned char)name[i]);
+    int c2 = tolower((unsigned char)prefix[i]);
+    if (c1 != c2 || c1 == 0) {
+      return c1 - c2;
+    }
+  }
+  return 0;
+}
+
+void irdb_prefix_iter_init(irdb_prefix_iter_t *it, const irdb_database_t *db,
+                           const char *prefix) {
+  it->db = db;
+  it->prefix = prefix ? prefix : "";
+  it->prefix_len = strlen(it->prefix);
+  it->pos = 0;
+  it->last = -1;
+
+  if (!db || !db->name_order) {
+    return;
+  }
+
+  /* 名称序按前prefix_len个字符截断后仍有序，二分找第一个不小于前缀的 */
+  uint32_t lo = 0;
+  uint32_t hi = db->entry_count;
+
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    const char *name =
+        irdb_entry_name(db, &db->entries[db->name_order[mid]]);
+
+    if (prefix_cmp(name, it->prefix, it->prefix_len) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  it->pos = lo;
+}
+
+/* 前缀查找取下一个 - 名称序中同名相邻且下标小的在前，跳过与上一个同名
+ * 的即可; 逐条扫描时只给出名称查找会返回的那一个 */
+int irdb_prefix_iter_next(irdb_prefix_iter_t *it) {
+  const irdb_database_t *db = it->db;
+
+  if (!db) {
+    return -ENOENT;
+  }
+
+  while (it->pos < db->entry_count) {
+    uint32_t id = db->name_order ? db->name_order[it->pos] : it->pos;
+    const char *name = irdb_entry_name(db, &db->entries[id]);
+
+    it->pos++;
+    if (prefix_cmp(name, it->prefix, it->prefix_len) != 0) {
+      if (db->name_order) {
+        it->pos = db->entry_count; // 有序，之后都不匹配
+        break;
+      }
+      continue;
+    }
+
+    if (db->name_order
+            ? it->last >= 0 &&
+                  strcasecmp(name, irdb_entry_name(
+                                       db, &db->entries[it->last])) == 0
+            : irdb_find_function_id(db, name) != (int)id) {
+      continue;
+    }
+
+    it->last = id;
+    return id;
+  }
+
+  return -ENOENT;
+}
+
+/* 按前缀查找 */
+int irdb_search_prefix(const irdb_database_t *db, const char *prefix,
+                       uint32_t skip, uint32_t max, irdb_entry_cb_t cb,
+                       void *user_data) {
+  if (!db || !cb) {
+    return -EINVAL;
+  }
+
+  irdb_prefix_iter_t it;
+  int delivered = 0;
+  int id;
+
+  irdb_prefix_iter_init(&it, db, prefix);
+  while ((max == 0 || (uint32_t)delivered < max) &&
+         (id = irdb_prefix_iter_next(&it)) >= 0) {
+    if (skip > 0) {
+      skip--;
+      continue;
+    }
+    delivered++;
+    if (cb(db, id, &db->entries[id], user_data) != 0) {
+      break;
+    }
+  }
+
+  return delivered;
+}
+
+/* 按编号获取条目 */
+const irdb_entry_t *irdb_get_entry(const irdb_database_t *db, int id) {
+  if (!db || id < 0 || (uint32_t)id >= db->entry_count) {
+    return NULL;
+  }
+
+  return &db->entries[id];
+}
+
+/* 查找功能 */
+const irdb_entry_t *irdb_find_function(const irdb_database_t *db,
+                                       const char *function_name) {
+  return irdb_get_entry(db, irdb_find_function_id(db, function_name));
+}
+
+/* 码字总位数 */
+static inline uint32_t code_total_bits(const irdb_protocol_params_t *params) {
+  uint32_t total_bits =
+      params->device_bits + params->subdevice_bits + params->function_bits;
+
+  if (params->function_inverse) {
+    total_bits += 8; // 功能码反码
+  }
+  return total_bits;
+}
+
+/* 组装完整码字: 设备码 | 子设备码 | 功能码 [| 功能码反码] */
+static inline uint64_t code_assemble(const irdb_protocol_params_t *params,
+                                     const irdb_entry_t *entry) {
+  uint64_t code = entry->device & ((1 << params->device_bits) - 1);
+
+  if (params->subdevice_bits > 0) {
+    code = (code << params->subdevice_bits) |
+           (entry->subdevice & ((1 << params->subdevice_bits) - 1));
+  }
+
+  code = (code << params->function_bits) |
+         (entry->function & ((1 << params->function_bits) - 1));
+
+  if (params->function_inverse) {
+    code = (code << 8) | ((~entry->function) & 0xFF);
+  }
+  return code;
+}
+
+/* 追加电平持续时间，与前一段同电平时合并 (曼彻斯特编码相邻半位) */
+static int emit_level(ir_timing_t *timings_out, uint32_t *idx,
+                      uint32_t max_length, uint32_t *last_us, bool mark,
+                      uint32_t us) {
+  bool last_mark = (*idx & 1) == 1; // 已写入奇数段时最后一段是mark
+
+  if (*idx > 0 && last_mark == mark) {
+    *last_us += us;
+    timings_out[*idx - 1] = ir_timing_pack(*last_us);
+    return 0;
+  }
+
+  if (*idx == 0 && !mark) {
+    return 0; // 帧首的space并入帧间静默
+  }
+
+  if (*idx + 1 > max_length) {
+    return -ENOMEM;
+  }
+  *last_us = us;
+  timings_out[(*idx)++] = ir_timing_pack(us);
+  return 0;
+}
+
+#define RC6_LEAD_BITS 0x8 // 起始位1 + 模式0 (000)
+#define RC6_HALF_BITS 44  // 起始4位 + toggle(2位宽) + 16数据位，以半位计
+
+/* RC6模式0编码: 引导 + 起始位1 + 模式000 + 双宽toggle + D:8 F:8
+ * 位值1为mark-space，0为space-mark */
+static int encode_rc6(const irdb_protocol_params_t *params,
+                      const irdb_entry_t *entry, uint8_t toggle,
+                      ir_timing_t *timings_out, uint32_t *length_out,
+                      uint32_t max_length) {
+  const uint32_t t = params->bit_mark;
+  uint32_t code = ((entry->device & 0xFF) << 8) | (entry->function & 0xFF);
+  uint32_t idx = 0;
+  uint32_t last_us = 0;
+  int ret = 0;
+
+  ret |= emit_level(timings_out, &idx, max_length, &last_us, true,
+                    params->header_mark);
+  ret |= emit_level(timings_out, &idx, max_length, &last_us, false,
+                    params->header_space);
+
+  /* 起始位1和模式位000 */
+  for (int i = 3; i >= 0; i--) {
+    bool bit = (RC6_LEAD_BITS >> i) & 1;
+    ret |= emit_level(timings_out, &idx, max_length, &last_us, bit, t);
+    ret |= emit_level(timings_out, &idx, max_length, &last_us, !bit, t);
+  }
+
+  /* toggle位为双倍宽度 */
+  ret |= emit_level(timings_out, &idx, max_length, &last_us, toggle, 2 * t);
+  ret |= emit_level(timings_out, &idx, max_length, &last_us, !toggle, 2 * t);
+
+  for (int i = code_total_bits(params) - 1; i >= 0; i--) {
+    bool bit = (code >> i) & 1;
+    ret |= emit_level(timings_out, &idx, max_length, &last_us, bit, t);
+    ret |= emit_level(timings_out, &idx, max_length, &last_us, !bit, t);
+  }
+
+  if (ret < 0) {
+    return -ENOMEM;
+  }
+
+  /* 帧尾的space并入帧间隔 */
+  if ((idx & 1) == 0) {
+    idx--;
+  }
+
+  *length_out = idx;
+  return 0;
+}
+
+#define RC5_START_BITS 0x3 // S1 S2，均为1 (RC5X的扩展功能位不使用)
+#define BIPHASE_MAX_BITS 32 // 双相帧位数上限(含起始位和toggle位)
+
+/* 曼彻斯特编码: 1为space-mark，0为mark-space，相邻同电平的半位合并。
+ * 有toggle位的按RC5布局在码字前加起始位S1 S2和toggle位T; 首位1的前半
+ * 个space并入帧间静默 */
+static int encode_biphase(const irdb_protocol_params_t *params,
+                          const irdb_entry_t *entry, uint8_t toggle,
+                          ir_timing_t *timings_out, uint32_t *length_out,
+                          uint32_t max_length) {
+  const uint32_t t = params->bit_mark;
+  uint32_t total_bits = code_total_bits(params);
+  uint64_t code = code_assemble(params, entry);
+  uint32_t idx = 0;
+  uint32_t last_us = 0;
+  int ret = 0;
+
+  if (params->toggle_bit) {
+    code |= (uint64_t)((RC5_START_BITS << 1) | (toggle & 1)) << total_bits;
+    total_bits += 3;
+  }
+
+  for (int i = total_bits - 1; i >= 0; i--) {
+    bool bit = (code >> i) & 1;
+    ret |= emit_level(timings_out, &idx, max_length, &last_us, !bit, t);
+    ret |= emit_level(timings_out, &idx, max_length, &last_us, bit, t);
+  }
+
+  if (ret < 0) {
+    return -ENOMEM;
+  }
+
+  /* 帧尾的space并入帧间隔 */
+  if ((idx & 1) == 0) {
+    idx--;
+  }
+
+  *length_out = idx;
+  return 0;
+}
+
+/* 编码一帧 - 各协议的编码函数以常量params内联展开，时序和分支在编译期确定 */
+static inline __attribute__((always_inline)) int
+encode_frame(const irdb_protocol_params_t *params, const irdb_entry_t *entry,
+             uint8_t toggle, ir_timing_t *timings_out, uint32_t *length_out,
+             uint32_t max_length) {
+  if (params->coding == IRDB_CODING_IRP) {
+    return irdb_irp_encode(params, entry, toggle, false, timings_out,
+                           length_out, max_length);
+  }
+  if (params->coding == IRDB_CODING_RC6) {
+    return encode_rc6(params, entry, toggle, timings_out, length_out,
+                      max_length);
+  }
+  if (params->coding == IRDB_CODING_BIPHASE) {
+    return encode_biphase(params, entry, toggle, timings_out, length_out,
+                          max_length);
+  }
+
+  uint32_t idx = 0;
+
+  // 引导码
+  if (params->header_mark > 0) {
+    if (idx + 2 > max_length)
+      return -ENOMEM;
+    timings_out[idx++] = ir_timing_pack(params->header_mark);
+    timings_out[idx++] = ir_timing_pack(params->header_space);
+  }
+
+  uint64_t code = code_assemble(params, entry);
+  const uint32_t total_bits = code_total_bits(params);
+
+  if (idx + 2 * total_bits + (params->sync_space > 0 ? 2 : 0) > max_length)
+    return -ENOMEM;
+
+  const ir_timing_t mark = ir_timing_pack(params->bit_mark);
+  const ir_timing_t short_mark = ir_timing_pack(params->bit_mark / 2);
+  const ir_timing_t space_0 = ir_timing_pack(params->bit_0_space);
+  const ir_timing_t space_1 = ir_timing_pack(params->bit_1_space);
+
+  // 编码数据位
+  for (int i = total_bits - 1; i >= 0; i--) {
+    bool bit = (code >> i) & 1;
+
+    // 帧中同步脉冲
+    if (params->sync_space > 0 && total_bits - 1 - i == params->sync_bit) {
+      timings_out[idx++] = mark;
+      timings_out[idx++] = ir_timing_pack(params->sync_space);
+    }
+
+    switch (params->coding) {
+    case IRDB_CODING_PULSE_WIDTH:
+      timings_out[idx++] = bit ? mark : short_mark;
+      timings_out[idx++] = space_0;
+      break;
+    default:
+      timings_out[idx++] = mark;
+      timings_out[idx++] = bit ? space_1 : space_0;
+      break;
+    }
+  }
+
+  // 结束标记
+  if (params->trailer_mark > 0) {
+    if (idx + 1 > max_length)
+      return -ENOMEM;
+    timings_out[idx++] = ir_timing_pack(params->trailer_mark);
+  }
+
+  *length_out = idx;
+  return 0;
+}
+
+/* 各协议专用编码函数 */
+typedef int (*protocol_encoder_t)(const irdb_entry_t *entry, uint8_t toggle,
+                                  ir_timing_t *timings_out,
+                                  uint32_t *length_out, uint32_t max_length);
+
+#define PROTOCOL_ENCODER_DEFINE(id)                                            \
+  static int encode_##id(const irdb_entry_t *entry, uint8_t toggle,           \
+                         ir_timing_t *timings_out, uint32_t *length_out,      \
+                         uint32_t max_length) {                                \
+    return encode_frame(&params_##id, entry, toggle, timings_out, length_out, \
+                        max_length);                                           \
+  }
+PROTOCOL_LIST(PROTOCOL_ENCODER_DEFINE)
+
+/* 通用编码 (参数在运行时确定) */
+static __attribute__((noinline)) int
+encode_generic(const irdb_protocol_params_t *params, const irdb_entry_t *entry,
+               uint8_t toggle, ir_timing_t *timings_out, uint32_t *length_out,
+               uint32_t max_length) {
+  return encode_frame(params, entry, toggle, timings_out, length_out,
+                      max_length);
+}
+
+/* 按协议编号直接索引的编码函数表 */
+#define PROTOCOL_ENCODER_REF(id) [IRDB_PROTOCOL_##id] = encode_##id,
+static const protocol_encoder_t protocol_encoders[] = {
+    PROTOCOL_LIST(PROTOCOL_ENCODER_REF)};
+
+/* 编码为原始时序 - toggle位按协议逐次翻转 */
+int irdb_encode_to_raw(const irdb_entry_t *entry, ir_timing_t *timings_out,
+                       uint32_t *length_out, uint32_t max_length) {
+  static uint32_t toggles; // 按协议编号的位图
+
+  if (!entry || entry->protocol > IRDB_PROTOCOL_MAX_ID) {
+    return -EINVAL;
+  }
+
+  toggles ^= BIT(entry->protocol);
+  return irdb_encode_with_toggle(entry, (toggles >> entry->protocol) & 1,
+                                 timings_out, length_out, max_length);
+}
+
+/* 按给定toggle位编码 */
+int irdb_encode_with_toggle(const irdb_entry_t *entry, uint8_t toggle,
+                            ir_timing_t *timings_out, uint32_t *length_out,
+                            uint32_t max_length) {
+  if (!entry || !timings_out || !length_out) {
+    return -EINVAL;
+  }
+
+  if (entry->protocol < ARRAY_SIZE(protocol_encoders) &&
+      protocol_encoders[entry->protocol]) {
+    return protocol_encoders[entry->protocol](entry, toggle, timings_out,
+                                              length_out, max_length);
+  }
+
+  /* 运行时注册的协议走通用编码 */
+  const irdb_protocol_params_t *params =
+      irdb_get_protocol_params(entry->protocol);
+  if (!params) {
+    LOG_ERR("Unknown protocol: %u", entry->protocol);
+    return -ENOTSUP;
+  }
+
+  return encode_generic(params, entry, toggle, timings_out, length_out,
+                        max_length);
+}
+
+/* 按给定参数编码 */
+int irdb_encode_params(const irdb_protocol_params_t *params,
+                       const irdb_entry_t *entry, uint8_t toggle,
+                       ir_timing_t *timings_out, uint32_t *length_out,
+                       uint32_t max_length) {
+  if (!params || !entry || !timings_out || !length_out) {
+    return -EINVAL;
+  }
+  return encode_generic(params, entry, toggle, timings_out, length_out,
+                        max_length);
+}
+
+/* 编码重复码 */
+int irdb_encode_repeat(const irdb_entry_t *entry, ir_timing_t *timings_out,
+                       uint32_t *length_out, uint32_t max_length) {
+  if (!entry || !timings_out || !length_out) {
+    return -EINVAL;
+  }
+
+  const irdb_protocol_params_t *params =
+      irdb_get_protocol_params(entry->protocol);
+  if (params && params->coding == IRDB_CODING_IRP) {
+    return irdb_irp_encode(params, entry, 0, true, timings_out, length_out,
+                           max_length);
+  }
+  if (!params || params->repeat_space == 0) {
+    return -ENOTSUP;
+  }
+
+  if (max_length < 3) {
+    return -ENOMEM;
+  }
+
+  timings_out[0] = ir_timing_pack(params->header_mark);
+  timings_out[1] = ir_timing_pack(params->repeat_space);
+  timings_out[2] = ir_timing_pack(params->trailer_mark);
+  *length_out = 3;
+  return 0;
+}
+
+/* 帧结束的静默门限 */
+uint32_t irdb_frame_end_gap(uint16_t protocol) {
+  const irdb_protocol_params_t *params = irdb_get_protocol_params(protocol);
+  if (!params) {
+    return 0;
+  }
 
-/* 获取协议参数 */
-const irdb_protocol_params_t *
-irdb_get_protocol_params(irdb_protocol_id_t protocol) {
-  for (size_t i = 0; i < ARRAY_SIZE(protocol_params); i++) {
-    if (protocol_params[i].protocol_id == protocol) {
-      return &protocol_params[i];
-    }
+  uint32_t longest = MAX(MAX(params->header_space, params->sync_space),
+                         MAX(params->bit_0_space, params->bit_1_space));
+  longest = MAX(longest, params->repeat_space);
+  if (params->coding == IRDB_CODING_IRP) {
+    longest = MAX(longest, irdb_irp_longest_space(params));
   }
-  return NULL;
+  return MAX(2 * longest, params->gap / 10);
 }
 
-/* 解析CSV行 */
-static int parse_csv_line(const char *line, irdb_entry_t *entry) {
-  // 格式: function_name, protocol, device, subdevice, function
-  // 示例: Power,1,7,7,12
+/* 时序质量 - 落在协议某个时序窗口内的时长按到窗口中心的偏差计分，取最近
+ * 的窗口，正中为100、容差边缘为0。不在任何窗口内的(帧间隔)不计入 */
+int irdb_timing_quality(uint16_t protocol, const ir_timing_t *timings,
+                        uint32_t length) {
+  const irdb_protocol_params_t *params = irdb_get_protocol_params(protocol);
+  if (!params || !timings || params->coding == IRDB_CODING_IRP) {
+    return -ENOTSUP;
+  }
+
+  const timing_window_t *win = windows_of(params);
+  uint32_t sum = 0;
+  uint32_t counted = 0;
 
-  char func_name[32];
-  int protocol, device, subdevice, function;
+  for (uint32_t i = 0; i < length; i++) {
+    uint32_t us = ir_timing_us(timings[i]);
+    uint32_t best = UINT32_MAX;
 
-  // 查找第一个逗号之前的内容作为功能名
-  const char *comma = strchr(line, ',');
-  if (!comma) {
-    return -EINVAL;
+    for (int w = 0; w < WIN_HEADER_DRIFT; w++) {
+      uint32_t half = win[w].span / 2;
+      uint32_t center = win[w].lo + half;
+
+      if (half == 0 || !in_window(&win[w], us)) {
+        continue;
+      }
+      best = MIN(best, (us > center ? us - center : center - us) * 100 / half);
+    }
+    if (best != UINT32_MAX) {
+      sum += 100 - MIN(best, 100);
+      counted++;
+    }
   }
+  return counted ? (int)(sum / counted) : -ENODATA;
+}
 
-  size_t name_len = comma - line;
-  if (name_len >= sizeof(func_name)) {
-    name_len = sizeof(func_name) - 1;
+/* 时长分布 - 按标称窗口归类，统计的是遥控器的实际时序而不是当前窗口 */
+int irdb_timing_profile(uint16_t protocol, const ir_timing_t *timings,
+                        uint32_t length, irdb_timing_profile_t *out) {
+  const irdb_protocol_params_t *params = irdb_get_protocol_params(protocol);
+  if (!params || !timings || !out || params->coding == IRDB_CODING_IRP) {
+    return -ENOTSUP;
   }
 
-  strncpy(func_name, line, name_len);
-  func_name[name_len] = '\0';
+  const timing_window_t *win = nominal_windows_of(params);
+  bool biphase = params->coding == IRDB_CODING_RC6 ||
+                 params->coding == IRDB_CODING_BIPHASE;
+  uint32_t scale = frame_scale(params, win, timings, length);
+  uint32_t counted = 0;
+
+  memset(out, 0, sizeof(*out));
+  out->scale = MIN(scale, UINT16_MAX);
+
+  for (uint32_t i = 0; i < length; i++) {
+    uint32_t us = scaled_us(timings[i], scale);
+    bool mark = (i & 1) == 0;
+    int best = -1;
+    uint32_t best_dist = UINT32_MAX;
+
+    for (int c = 0; c < IRDB_ADAPT_CLASSES; c++) {
+      const timing_window_t *w = &win[adapt_class_win[c]];
+      bool mark_class =
+          c == IRDB_ADAPT_HEADER_MARK || c == IRDB_ADAPT_BIT_MARK;
+      uint32_t center = w->lo + w->span / 2;
+
+      /* 双相编码的半位mark和space同长 */
+      if ((mark_class != mark && !(biphase && c == IRDB_ADAPT_BIT_MARK)) ||
+          w->span == 0 || !in_window(w, us)) {
+        continue;
+      }
+      uint32_t dist = us > center ? us - center : center - us;
+      if (dist < best_dist) {
+        best_dist = dist;
+        best = c;
+      }
+    }
+    if (best < 0) {
+      continue;
+    }
+
+    uint16_t v = MIN(us, UINT16_MAX);
+    if (out->hi_us[best] == 0) {
+      out->lo_us[best] = v;
+      out->hi_us[best] = v;
+    } else {
+      out->lo_us[best] = MIN(out->lo_us[best], v);
+      out->hi_us[best] = MAX(out->hi_us[best], v);
+    }
+    counted++;
+  }
+  return counted ? 0 : -ENODATA;
+}
 
-  // 解析数字部分
-  if (sscanf(comma + 1, "%d,%d,%d,%d", &protocol, &device, &subdevice,
-             &function) != 4) {
+/* 替换时序窗口 */
+int irdb_adapt_windows(uint16_t protocol, const irdb_window_t *windows) {
+  const irdb_protocol_params_t *params = irdb_get_protocol_params(protocol);
+  if (!params) {
     return -EINVAL;
   }
+  if (params->coding == IRDB_CODING_IRP) {
+    return -ENOTSUP;
+  }
+
+  int slot = -1;
+  for (int i = 0; i < ARRAY_SIZE(adapt_slots); i++) {
+    if (adapt_slots[i].used && adapt_slots[i].protocol == protocol) {
+      slot = i;
+      break;
+    }
+    if (!adapt_slots[i].used && slot < 0) {
+      slot = i;
+    }
+  }
+
+  if (!windows) {
+    atomic_ptr_set(&adapted_windows[protocol], NULL);
+    if (slot >= 0 && adapt_slots[slot].used &&
+        adapt_slots[slot].protocol == protocol) {
+      adapt_slots[slot].used = false;
+    }
+    return 0;
+  }
+  if (slot < 0) {
+    return -ENOMEM;
+  }
+
+  /* 读者最多还持有上次发布的一份(槽刚被别的协议释放时也是)，改写另一份 */
+  const timing_window_t *nominal = nominal_windows_of(params);
+  timing_window_t *win = adapt_slots[slot].win[adapt_slots[slot].next];
+  uint32_t limit = IRDB_TIMING_TOLERANCE + IRDB_CLOCK_DRIFT;
+
+  memcpy(win, nominal, sizeof(adapt_slots[slot].win[0]));
+  for (int c = 0; c < IRDB_ADAPT_CLASSES; c++) {
+    const timing_window_t *n = &nominal[adapt_class_win[c]];
+    uint32_t expected = n->lo + n->span / 2;
 
-  // 填充条目
-  strncpy(entry->function_name, func_name, sizeof(entry->function_name) - 1);
-  entry->protocol = protocol;
-  entry->device = device;
-  entry->subdevice = subdevice;
-  entry->function = function;
+    if (windows[c].hi_us == 0 || expected == 0) {
+      continue;
+    }
+
+    timing_window_t bound = window_pct(expected, limit);
+    uint32_t lo = MAX(windows[c].lo_us, bound.lo);
+    uint32_t hi = MIN(windows[c].hi_us, bound.lo + bound.span);
+
+    if (lo < hi) {
+      win[adapt_class_win[c]] = (timing_window_t){.lo = lo, .span = hi - lo};
+    }
+  }
 
+  adapt_slots[slot].used = true;
+  adapt_slots[slot].protocol = protocol;
+  adapt_slots[slot].next ^= 1;
+  atomic_ptr_set(&adapted_windows[protocol], win);
   return 0;
 }
 
-/* 解析CSV数据 */
-int irdb_parse_csv(const char *csv_data, irdb_database_t *db) {
-  if (!csv_data || !db) {
-    return -EINVAL;
+/* 判断是否为重复码 */
+bool irdb_is_repeat_frame(uint16_t protocol, const ir_timing_t *timings,
+                          uint32_t length) {
+  const irdb_protocol_params_t *params = irdb_get_protocol_params(protocol);
+
+  if (params && params->coding == IRDB_CODING_IRP && timings) {
+    return irdb_irp_is_repeat(params, timings, length);
+  }
+  if (!params || params->repeat_space == 0 || !timings || length < 3) {
+    return false;
   }
 
-  memset(db, 0, sizeof(irdb_database_t));
+  const timing_window_t *win = windows_of(params);
+  return in_window(&win[WIN_HEADER_MARK], ir_timing_us(timings[0])) &&
+         in_window(&win[WIN_REPEAT], ir_timing_us(timings[1])) &&
+         in_window(&win[WIN_TRAILER], ir_timing_us(timings[2]));
+}
 
-  const char *p = csv_data;
-  uint32_t capacity = 0;
+/* 两个窗口的命中组合 -> 位值: 都不中为-1，窗口重叠时取0 */
+static const int8_t symbol_bit[4] = {-1, 0, 1, 0};
 
-  // 跳过可能的BOM和空行
-  while (*p && (*p == '\n' || *p == '\r' || *p == ' ')) {
-    p++;
+/* 脉冲宽度位判定 - 返回位值，不匹配返回-1 */
+static int width_bit(const timing_window_t *win, uint32_t mark) {
+  return symbol_bit[in_window(&win[WIN_HALF_MARK], mark) |
+                    in_window(&win[WIN_BIT_MARK], mark) << 1];
+}
+
+/* 成对时序位判定 - mark查一次、space按0/1窗口分类一次，不匹配返回-1 */
+static int pair_bit(const timing_window_t *win, uint32_t first,
+                    uint32_t second) {
+  if (!in_window(&win[WIN_BIT_MARK], first)) {
+    return -1;
   }
+  return symbol_bit[in_window(&win[WIN_BIT_0], second) |
+                    in_window(&win[WIN_BIT_1], second) << 1];
+}
 
-  while (*p) {
-    char line[256];
-    size_t len = 0;
+/* 从码字提取字段 */
+static void code_extract(uint16_t protocol,
+                         const irdb_protocol_params_t *params,
+                         uint64_t decoded, irdb_entry_t *code_out) {
+  memset(code_out, 0, sizeof(*code_out));
+  code_out->name = IRDB_NAME_NONE;
+  code_out->protocol = protocol;
 
-    // 读取一行
-    while (*p && *p != '\n' && *p != '\r' && len < sizeof(line) - 1) {
-      line[len++] = *p++;
-    }
-    line[len] = '\0';
+  if (params->function_inverse) {
+    decoded >>= 8; // 跳过末尾的功能码反码
+  }
 
-    // 跳过行结束符
-    while (*p && (*p == '\n' || *p == '\r')) {
-      p++;
+  code_out->function = decoded & ((1 << params->function_bits) - 1);
+  decoded >>= params->function_bits;
+
+  if (params->subdevice_bits > 0) {
+    code_out->subdevice = decoded & ((1 << params->subdevice_bits) - 1);
+    decoded >>= params->subdevice_bits;
+  }
+
+  code_out->device = decoded & ((1 << params->device_bits) - 1);
+}
+
+/* 1~3个半位窗口的命中组合 -> 半位数，重叠时取较短的 */
+static const uint8_t symbol_units[8] = {0, 1, 2, 1, 3, 1, 2, 1};
+
+/* 时序从idx起展开为半位电平序列(mark为1)，每段最长max_units个半位，
+ * 遇到帧间静默停止; 展开满count个半位返回0，否则-ENOENT */
+static int half_bits_expand(const timing_window_t *win, uint32_t max_units,
+                            const ir_timing_t *timings, uint32_t idx,
+                            uint32_t length, uint32_t scale, uint8_t *half,
+                            uint32_t n, uint32_t count) {
+  for (; idx < length && n < count; idx++) {
+    uint32_t us = scaled_us(timings[idx], scale);
+    uint32_t units = symbol_units[in_window(&win[WIN_BIT_MARK], us) |
+                                  in_window(&win[WIN_UNIT_2], us) << 1 |
+                                  in_window(&win[WIN_UNIT_3], us) << 2];
+    bool mark = (idx & 1) == 0;
+
+    if (units < 1 || units > max_units) {
+      if (!mark) {
+        break; // 帧间静默
+      }
+      return -ENOENT;
     }
 
-    // 跳过空行和注释
-    if (len == 0 || line[0] == '#') {
-      continue;
+    while (units-- > 0 && n < count) {
+      half[n++] = mark;
     }
+  }
 
-    // 扩展数组
-    if (db->entry_count >= capacity) {
-      capacity = capacity == 0 ? 16 : capacity * 2;
-      irdb_entry_t *new_entries =
-          realloc(db->entries, capacity * sizeof(irdb_entry_t));
-      if (!new_entries) {
-        LOG_ERR("Memory allocation failed");
-        irdb_free_database(db);
-        return -ENOMEM;
-      }
-      db->entries = new_entries;
+  /* 末位以mark结束时最后半位的space并入静默 */
+  if (n == count - 1 && half[n - 1]) {
+    half[n++] = 0;
+  }
+  return n == count ? 0 : -ENOENT;
+}
+
+/* 双相(RC5)解码 - 帧首半位的space并入静默，1为space-mark，0为mark-space */
+static int decode_biphase(const irdb_protocol_params_t *params,
+                          const ir_timing_t *timings, uint32_t length,
+                          uint32_t scale, irdb_entry_t *code_out,
+                          int *toggle_out) {
+  uint32_t data_bits = code_total_bits(params);
+  uint32_t bits = data_bits + (params->toggle_bit ? 3 : 0);
+  uint8_t half[2 * BIPHASE_MAX_BITS];
+
+  if (bits > BIPHASE_MAX_BITS) {
+    return -ENOTSUP;
+  }
+
+  half[0] = 0;
+  if (half_bits_expand(windows_of(params), 2, timings, 0, length, scale, half,
+                       1, 2 * bits) < 0) {
+    return -ENOENT;
+  }
+
+  uint64_t decoded = 0;
+  for (uint32_t i = 0; i < 2 * bits; i += 2) {
+    if (half[i] == half[i + 1]) {
+      return -ENOENT;
     }
+    decoded = (decoded << 1) | half[i + 1];
+  }
 
-    // 解析行
-    if (parse_csv_line(line, &db->entries[db->entry_count]) == 0) {
-      db->entry_count++;
+  if (params->toggle_bit) {
+    if ((decoded >> (data_bits + 1)) != RC5_START_BITS) {
+      return -ENOENT;
     }
+    *toggle_out = (decoded >> data_bits) & 1;
   }
 
-  LOG_INF("Parsed %u IRDB entries", db->entry_count);
+  code_extract(params->protocol_id, params, decoded, code_out);
   return 0;
 }
 
-/* 释放数据库 */
-void irdb_free_database(irdb_database_t *db) {
-  if (db && db->entries) {
-    free(db->entries);
-    memset(db, 0, sizeof(irdb_database_t));
+/* RC6模式0解码 - 时序展开为半位电平序列后按位配对 */
+static int decode_rc6(const irdb_protocol_params_t *params,
+                      const ir_timing_t *timings, uint32_t length,
+                      uint32_t scale, irdb_entry_t *code_out,
+                      int *toggle_out) {
+  const timing_window_t *win = windows_of(params);
+  uint8_t half[RC6_HALF_BITS];
+
+  if (!in_window(&win[WIN_HEADER_MARK], scaled_us(timings[0], scale)) ||
+      !in_window(&win[WIN_HEADER_SPACE], scaled_us(timings[1], scale))) {
+    return -ENOENT;
   }
-}
 
-/* 查找功能 */
-const irdb_entry_t *irdb_find_function(const irdb_database_t *db,
-                                       const char *function_name) {
-  if (!db || !function_name) {
-    return NULL;
+  if (half_bits_expand(win, 3, timings, 2, length, scale, half, 0,
+                       RC6_HALF_BITS) < 0) {
+    return -ENOENT;
   }
 
-  for (uint32_t i = 0; i < db->entry_count; i++) {
-    if (strcasecmp(db->entries[i].function_name, function_name) == 0) {
-      return &db->entries[i];
+  /* 起始位和模式位 */
+  for (int i = 0; i < 4; i++) {
+    bool bit = (RC6_LEAD_BITS >> (3 - i)) & 1;
+    if (half[2 * i] != bit || half[2 * i + 1] == bit) {
+      return -ENOENT;
     }
   }
 
-  return NULL;
+  /* toggle位: 1为mark 2T + space 2T，0相反；解码时两者都接受 */
+  if (half[8] != half[9] || half[10] != half[11] || half[8] == half[10]) {
+    return -ENOENT;
+  }
+
+  uint64_t decoded = 0;
+  for (int i = 12; i < RC6_HALF_BITS; i += 2) {
+    if (half[i] == half[i + 1]) {
+      return -ENOENT;
+    }
+    decoded = (decoded << 1) | half[i];
+  }
+
+  *toggle_out = half[8];
+  code_extract(IRDB_PROTOCOL_RC6, params, decoded, code_out);
+  return 0;
 }
 
-/* 编码为原始时序 */
-int irdb_encode_to_raw(const irdb_entry_t *entry, uint32_t *timings_out,
-                       uint32_t *length_out, uint32_t max_length) {
-  if (!entry || !timings_out || !length_out) {
+/* 按指定协议解码原始时序 */
+int irdb_decode_protocol(uint16_t protocol, const ir_timing_t *timings,
+                         uint32_t length, irdb_entry_t *code_out) {
+  return irdb_decode_with_toggle(protocol, timings, length, code_out, NULL);
+}
+
+/* 按指定协议解码，另输出toggle位 */
+int irdb_decode_with_toggle(uint16_t protocol, const ir_timing_t *timings,
+                            uint32_t length, irdb_entry_t *code_out,
+                            int *toggle_out) {
+  int toggle = IRDB_TOGGLE_NONE;
+  int ret;
+
+  if (!timings || length < 4 || !code_out) {
     return -EINVAL;
   }
 
-  const irdb_protocol_params_t *params =
-      irdb_get_protocol_params(entry->protocol);
+  const irdb_protocol_params_t *params = irdb_get_protocol_params(protocol);
   if (!params) {
-    LOG_ERR("Unknown protocol: %u", entry->protocol);
     return -ENOTSUP;
   }
 
-  uint32_t idx = 0;
-
-  // 引导码
-  if (params->header_mark > 0) {
-    if (idx + 2 > max_length)
-      return -ENOMEM;
-    timings_out[idx++] = params->header_mark;
-    timings_out[idx++] = params->header_space;
+  if (params->coding == IRDB_CODING_IRP) {
+    return irdb_irp_decode(params, timings, length, code_out, toggle_out);
   }
 
-  // 组装完整码字
-  uint64_t code = 0;
-  uint32_t total_bits = 0;
-
-  // 添加设备码
-  if (params->device_bits > 0) {
-    code = (code << params->device_bits) |
-           (entry->device & ((1 << params->device_bits) - 1));
-    total_bits += params->device_bits;
+  /* 时钟偏差的遥控器整帧按同一比例偏移，先归一化再按标称窗口判定 */
+  const timing_window_t *win = windows_of(params);
+  uint32_t scale = frame_scale(params, win, timings, length);
+
+  if (params->coding == IRDB_CODING_RC6 ||
+      params->coding == IRDB_CODING_BIPHASE) {
+    ret = params->coding == IRDB_CODING_RC6
+              ? decode_rc6(params, timings, length, scale, code_out, &toggle)
+              : decode_biphase(params, timings, length, scale, code_out,
+                               &toggle);
+    if (ret == 0 && toggle_out) {
+      *toggle_out = toggle;
+    }
+    return ret;
   }
 
-  // 添加子设备码
-  if (params->subdevice_bits > 0) {
-    code = (code << params->subdevice_bits) |
-           (entry->subdevice & ((1 << params->subdevice_bits) - 1));
-    total_bits += params->subdevice_bits;
+  if (toggle_out) {
+    *toggle_out = IRDB_TOGGLE_NONE;
   }
 
-  // 添加功能码
-  code = (code << params->function_bits) |
-         (entry->function & ((1 << params->function_bits) - 1));
-  total_bits += params->function_bits;
+  uint32_t idx = 0;
 
-  // 对于NEC1，添加功能码的反码
-  if (entry->protocol == IRDB_PROTOCOL_NEC1) {
-    code = (code << 8) | ((~entry->function) & 0xFF);
-    total_bits += 8;
+  // 检查引导码
+  if (params->header_mark > 0) {
+    if (idx + 2 > length)
+      return -ENOENT;
+
+    if (!in_window(&win[WIN_HEADER_MARK], scaled_us(timings[idx], scale)) ||
+        !in_window(&win[WIN_HEADER_SPACE],
+                   scaled_us(timings[idx + 1], scale))) {
+      return -ENOENT;
+    }
+    idx += 2;
   }
 
-  // 编码数据位
-  for (int i = total_bits - 1; i >= 0; i--) {
-    if (idx + 2 > max_length)
-      return -ENOMEM;
+  // 解码数据位
+  uint64_t decoded = 0;
+  uint32_t bits_decoded = 0;
+  uint32_t total_bits = code_total_bits(params);
 
-    bool bit = (code >> i) & 1;
+  while (idx < length && bits_decoded < total_bits) {
+    int bit;
 
-    // RC5使用曼彻斯特编码
-    if (entry->protocol == IRDB_PROTOCOL_RC5) {
-      if (bit) {
-        timings_out[idx++] = params->bit_0_space; // space then mark
-        timings_out[idx++] = params->bit_mark;
-      } else {
-        timings_out[idx++] = params->bit_mark; // mark then space
-        timings_out[idx++] = params->bit_0_space;
+    // 帧中同步脉冲
+    if (params->sync_space > 0 && bits_decoded == params->sync_bit) {
+      if (idx + 1 >= length ||
+          !in_window(&win[WIN_BIT_MARK], scaled_us(timings[idx], scale)) ||
+          !in_window(&win[WIN_SYNC], scaled_us(timings[idx + 1], scale))) {
+        break;
+      }
+      idx += 2;
+      if (idx >= length) {
+        break;
       }
     }
-    // Sony使用脉冲位置调制
-    else if (entry->protocol >= IRDB_PROTOCOL_SONY12 &&
-             entry->protocol <= IRDB_PROTOCOL_SONY20) {
-      timings_out[idx++] = bit ? params->bit_mark : params->bit_mark / 2;
-      timings_out[idx++] = params->bit_0_space;
+
+    if (params->coding == IRDB_CODING_PULSE_WIDTH) {
+      // 末位之后的space会并入帧间静默，只看mark
+      bit = width_bit(win, scaled_us(timings[idx], scale));
+    } else if (idx + 1 < length) {
+      bit = pair_bit(win, scaled_us(timings[idx], scale),
+                     scaled_us(timings[idx + 1], scale));
+    } else {
+      break;
     }
-    // 标准脉冲距离编码
-    else {
-      timings_out[idx++] = params->bit_mark;
-      timings_out[idx++] = bit ? params->bit_1_space : params->bit_0_space;
+
+    if (bit < 0) {
+      break;
     }
+
+    decoded = (decoded << 1) | (uint64_t)bit;
+    bits_decoded++;
+    idx += 2;
   }
 
-  // 结束标记
-  if (params->trailer_mark > 0) {
-    if (idx + 1 > max_length)
-      return -ENOMEM;
-    timings_out[idx++] = params->trailer_mark;
+  if (bits_decoded != total_bits) {
+    return -ENOENT;
   }
 
-  *length_out = idx;
+  code_extract(protocol, params, decoded, code_out);
   return 0;
 }
 
-/* 时序匹配（带容差） */
-static bool timing_match(uint32_t measured, uint32_t expected) {
-  if (expected == 0)
-    return measured == 0;
+/* 流式解码器初始化 */
+int irdb_stream_init(irdb_stream_decoder_t *dec, uint16_t protocol) {
+  if (!dec) {
+    return -EINVAL;
+  }
+
+  /* RC5/RC6的半位合并无法逐对判定，IRP协议的帧结构由字节码决定，
+   * 都由整帧解码处理 */
+  const irdb_protocol_params_t *params = irdb_get_protocol_params(protocol);
+  if (!params || params->coding == IRDB_CODING_RC6 ||
+      params->coding == IRDB_CODING_BIPHASE ||
+      params->coding == IRDB_CODING_IRP) {
+    return -ENOTSUP;
+  }
+
+  memset(dec, 0, sizeof(*dec));
+  dec->params = params;
+  dec->protocol = protocol;
+  dec->total_bits = code_total_bits(params);
+  irdb_stream_reset(dec);
+  return 0;
+}
 
-  uint32_t tolerance = expected * TOLERANCE_PERCENT / 100;
-  return (measured >= expected - tolerance) &&
-         (measured <= expected + tolerance);
+/* 流式解码器复位 - 回到等待帧起点 */
+void irdb_stream_reset(irdb_stream_decoder_t *dec) {
+  dec->state = dec->params->header_mark > 0 ? IRDB_STREAM_HEADER
+                                            : IRDB_STREAM_DATA;
+  dec->have_first = false;
+  dec->repeat = false;
+  dec->synced = false;
+  dec->scale = SCALE_ONE;
+  dec->bits = 0;
+  dec->code = 0;
 }
 
-/* 解码原始时序 */
-int irdb_decode_from_raw(const irdb_database_t *db, const uint32_t *timings,
-                         uint32_t length, irdb_entry_t *entry_out) {
-  if (!db || !timings || length < 4 || !entry_out) {
-    return -EINVAL;
+/* 帧起点处理 - 仅mark可以开始一帧 */
+static int stream_start(irdb_stream_decoder_t *dec, uint32_t duration_us,
+                        bool is_mark) {
+  irdb_stream_reset(dec);
+
+  if (!is_mark) {
+    return -ENOENT;
   }
 
-  // 尝试所有数据库条目的协议
-  for (uint32_t i = 0; i < db->entry_count; i++) {
-    const irdb_entry_t *entry = &db->entries[i];
-    const irdb_protocol_params_t *params =
-        irdb_get_protocol_params(entry->protocol);
+  /* 引导mark按容差加时钟偏差放宽，收到space后再按缩放后的值判定 */
+  if (dec->state == IRDB_STREAM_HEADER &&
+      !in_window(&windows_of(dec->params)[WIN_HEADER_DRIFT], duration_us)) {
+    return -ENOENT;
+  }
 
-    if (!params)
-      continue;
+  dec->first = duration_us;
+  dec->have_first = true;
+  return 0;
+}
 
-    uint32_t idx = 0;
+/* 记录一位，收满后进入结束标记或完成 */
+static int stream_push_bit(irdb_stream_decoder_t *dec, int bit,
+                           irdb_entry_t *code_out) {
+  dec->code = (dec->code << 1) | (uint64_t)bit;
+  dec->bits++;
 
-    // 检查引导码
-    if (params->header_mark > 0) {
-      if (idx + 2 > length)
-        continue;
+  if (dec->bits < dec->total_bits) {
+    return 0;
+  }
 
-      if (!timing_match(timings[idx], params->header_mark) ||
-          !timing_match(timings[idx + 1], params->header_space)) {
-        continue;
-      }
-      idx += 2;
-    }
+  if (dec->params->trailer_mark > 0) {
+    dec->state = IRDB_STREAM_TRAILER;
+    return 0;
+  }
 
-    // 解码数据位
-    uint64_t decoded = 0;
-    uint32_t bits_decoded = 0;
-    uint32_t total_bits =
-        params->device_bits + params->subdevice_bits + params->function_bits;
+  code_extract(dec->protocol, dec->params, dec->code, code_out);
+  irdb_stream_reset(dec);
+  return 1;
+}
 
-    if (entry->protocol == IRDB_PROTOCOL_NEC1) {
-      total_bits += 8; // 功能码反码
-    }
+/* 输入一个脉冲 */
+int irdb_stream_feed(irdb_stream_decoder_t *dec, uint32_t duration_us,
+                     bool is_mark, irdb_entry_t *code_out) {
+  if (!dec || !dec->params || !code_out) {
+    return -EINVAL;
+  }
 
-    while (idx + 1 < length && bits_decoded < total_bits) {
-      bool bit_value;
+  const irdb_protocol_params_t *params = dec->params;
+  const timing_window_t *win = windows_of(params);
+  uint32_t raw_us = duration_us; // 重新开始一帧时不带本帧的缩放
 
-      if (entry->protocol == IRDB_PROTOCOL_RC5) {
-        // 曼彻斯特解码
-        if (timing_match(timings[idx], params->bit_mark) &&
-            timing_match(timings[idx + 1], params->bit_0_space)) {
-          bit_value = false;
-        } else if (timing_match(timings[idx], params->bit_0_space) &&
-                   timing_match(timings[idx + 1], params->bit_mark)) {
-          bit_value = true;
-        } else {
-          break;
+  /* 长静默即帧边界 */
+  if (!is_mark && duration_us >= IRDB_STREAM_IDLE_US) {
+    bool mid_frame = dec->have_first || dec->bits > 0 ||
+                     dec->state == IRDB_STREAM_TRAILER;
+    irdb_stream_reset(dec);
+    return mid_frame ? -ENOENT : 0;
+  }
+
+  if (dec->state != IRDB_STREAM_HEADER) {
+    duration_us = (duration_us * dec->scale) >> SCALE_SHIFT;
+  }
+
+  switch (dec->state) {
+  case IRDB_STREAM_HEADER:
+    if (!dec->have_first) {
+      return stream_start(dec, duration_us, is_mark);
+    }
+    if (!is_mark && params->repeat_space > 0 &&
+        in_window(&win[WIN_REPEAT], duration_us)) {
+      /* 重复码: 引导标记 + 短间隔 + 结束标记 */
+      dec->have_first = false;
+      dec->repeat = true;
+      dec->state = IRDB_STREAM_TRAILER;
+      return 0;
+    }
+    if (!is_mark && in_window(&win[WIN_LEAD_DRIFT], dec->first + duration_us)) {
+      uint32_t scale = lead_scale(params, dec->first + duration_us);
+
+      if (in_window(&win[WIN_HEADER_MARK],
+                    (dec->first * scale) >> SCALE_SHIFT) &&
+          in_window(&win[WIN_HEADER_SPACE],
+                    (duration_us * scale) >> SCALE_SHIFT)) {
+        dec->scale = scale;
+        dec->have_first = false;
+        dec->state = IRDB_STREAM_DATA;
+        return 0;
+      }
+    }
+    /* 头部不符，当前脉冲可能是下一帧的起点 */
+    stream_start(dec, duration_us, is_mark);
+    return -ENOENT;
+
+  case IRDB_STREAM_DATA:
+    if (!dec->have_first) {
+      if (dec->bits == 0 && params->header_mark == 0) {
+        if (stream_start(dec, raw_us, is_mark) < 0) {
+          return 0;
         }
       } else {
-        // 脉冲距离解码
-        if (!timing_match(timings[idx], params->bit_mark)) {
-          break;
-        }
+        dec->first = duration_us;
+        dec->have_first = true;
+      }
 
-        if (timing_match(timings[idx + 1], params->bit_0_space)) {
-          bit_value = false;
-        } else if (timing_match(timings[idx + 1], params->bit_1_space)) {
-          bit_value = true;
-        } else {
-          break;
+      /* 脉冲宽度编码: mark即定位值，have_first表示等待位间space */
+      if (dec->params->coding == IRDB_CODING_PULSE_WIDTH) {
+        int bit = width_bit(win, duration_us);
+        if (bit < 0) {
+          stream_start(dec, raw_us, is_mark);
+          return -ENOENT;
         }
+        return stream_push_bit(dec, bit, code_out);
       }
+      return 0;
+    }
 
-      decoded = (decoded << 1) | (bit_value ? 1 : 0);
-      bits_decoded++;
-      idx += 2;
+    dec->have_first = false;
+
+    /* 脉冲宽度编码的位间space只做校验 */
+    if (dec->params->coding == IRDB_CODING_PULSE_WIDTH) {
+      if (!in_window(&win[WIN_BIT_0], duration_us)) {
+        stream_start(dec, raw_us, is_mark);
+        return -ENOENT;
+      }
+      return 0;
     }
 
-    if (bits_decoded != total_bits) {
-      continue;
+    /* 帧中同步脉冲 */
+    if (params->sync_space > 0 && dec->bits == params->sync_bit &&
+        !dec->synced) {
+      if (!in_window(&win[WIN_BIT_MARK], dec->first) ||
+          !in_window(&win[WIN_SYNC], duration_us)) {
+        stream_start(dec, raw_us, is_mark);
+        return -ENOENT;
+      }
+      dec->synced = true;
+      return 0;
+    }
+
+    int bit = pair_bit(win, dec->first, duration_us);
+    if (bit < 0) {
+      stream_start(dec, raw_us, is_mark);
+      return -ENOENT;
+    }
+    return stream_push_bit(dec, bit, code_out);
+
+  case IRDB_STREAM_TRAILER:
+    if (!is_mark || !in_window(&win[WIN_TRAILER], duration_us)) {
+      stream_start(dec, raw_us, is_mark);
+      return -ENOENT;
+    }
+    if (dec->repeat) {
+      memset(code_out, 0, sizeof(*code_out));
+      code_out->protocol = dec->protocol;
+      irdb_stream_reset(dec);
+      return IRDB_STREAM_REPEAT;
     }
+    code_extract(dec->protocol, params, dec->code, code_out);
+    irdb_stream_reset(dec);
+    return 1;
+
+  default:
+    irdb_stream_reset(dec);
+    return -ENOENT;
+  }
+}
+
+/* 不依赖数据库的解码 - 取时序误差最小的协议 */
+int irdb_decode_any(const ir_timing_t *timings, uint32_t length,
+                    irdb_entry_t *code_out) {
+  if (!timings || length < 4 || !code_out) {
+    return -EINVAL;
+  }
+
+  irdb_candidate_t best;
+
+  if (irdb_decode_ranked(NULL, 0, timings, length, &best, 1) < 0) {
+    return -ENOENT;
+  }
+  *code_out = best.entry;
+  return 0;
+}
+
+/* 候选误差的参照帧长度上限 (解码线程栈上) - 内置协议不到100个时长 */
+#define SCORE_MAX_TIMINGS 128
+
+/* 候选的时序误差 - 按码值重新编码，与本帧(按解码时的缩放归一化)逐个
+ * 比较。偶数长度时末尾为space，并入帧间静默，两边都不计 */
+static int candidate_score(irdb_candidate_t *cand, const ir_timing_t *timings,
+                           uint32_t length) {
+  const irdb_protocol_params_t *params =
+      irdb_get_protocol_params(cand->entry.protocol);
+  ir_timing_t ref[SCORE_MAX_TIMINGS];
+  uint32_t ref_length;
+  uint32_t scale = SCALE_ONE;
+
+  int ret = irdb_encode_with_toggle(&cand->entry, cand->toggle == 1, ref,
+                                    &ref_length, ARRAY_SIZE(ref));
+  if (ret < 0) {
+    return ret;
+  }
+  if (params->coding != IRDB_CODING_IRP) {
+    scale = frame_scale(params, nominal_windows_of(params), timings, length);
+  }
+
+  ref_length -= ref_length % 2 == 0;
+  length -= length % 2 == 0;
+
+  uint32_t n = MIN(length, ref_length);
+  uint32_t total = MAX(length, ref_length);
+  uint32_t error = (total - n) * 100;
+
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t us = scaled_us(timings[i], scale);
+    uint32_t expected = ir_timing_us(ref[i]);
+    uint32_t diff = us > expected ? us - expected : expected - us;
+
+    error += expected ? MIN(diff * 100 / expected, 100) : 100;
+  }
+
+  cand->error = error;
+  cand->confidence = total ? 100 - MIN(error / total, 100) : 0;
+  return 0;
+}
+
+/* 按误差插入有序表，误差相同时库中条目在前，其次保持协议顺序。
+ * 返回新的项数 */
+static size_t candidate_insert(irdb_candidate_t *out, size_t n, size_t max,
+                               const irdb_candidate_t *cand) {
+  size_t j = n;
+
+  while (j > 0 && (out[j - 1].error > cand->error ||
+                   (out[j - 1].error == cand->error && cand->in_db &&
+                    !out[j - 1].in_db))) {
+    j--;
+  }
+  if (j >= max) {
+    return n;
+  }
+  n = MIN(n + 1, max);
+  memmove(&out[j + 1], &out[j], (n - 1 - j) * sizeof(out[0]));
+  out[j] = *cand;
+  return n;
+}
+
+int irdb_decode_ranked(const uint16_t *protocols, size_t protocol_count,
+                       const ir_timing_t *timings, uint32_t length,
+                       irdb_candidate_t *out, size_t max) {
+  size_t n = 0;
+
+  if (!timings || length < 4 || !out || max == 0) {
+    return -EINVAL;
+  }
+  if (!protocols) {
+    protocol_count = IRDB_PROTOCOL_MAX_ID + 1;
+  }
 
-    // 提取字段
-    uint16_t function = decoded & ((1 << params->function_bits) - 1);
-    decoded >>= params->function_bits;
+  for (size_t i = 0; i < protocol_count; i++) {
+    uint16_t protocol = protocols ? protocols[i] : i;
+    irdb_candidate_t cand = {.in_db = false};
+    int toggle;
 
-    if (entry->protocol == IRDB_PROTOCOL_NEC1) {
-      decoded >>= 8; // 跳过反码
+    if (!irdb_get_protocol_params(protocol) ||
+        irdb_decode_with_toggle(protocol, timings, length, &cand.entry,
+                                &toggle) < 0) {
+      continue;
+    }
+    cand.toggle = toggle;
+    if (candidate_score(&cand, timings, length) == 0) {
+      n = candidate_insert(out, n, max, &cand);
     }
+  }
+  return n > 0 ? (int)n : -ENOENT;
+}
+
+int irdb_decode_candidates(const irdb_database_t *db,
+                           const ir_timing_t *timings, uint32_t length,
+                           irdb_candidate_t *out, size_t max) {
+  irdb_candidate_t ranked[IRDB_MAX_CANDIDATES];
+
+  if (!db || !timings || length < 4 || !out || max == 0) {
+    return -EINVAL;
+  }
 
-    uint16_t subdevice = 0;
-    if (params->subdevice_bits > 0) {
-      subdevice = decoded & ((1 << params->subdevice_bits) - 1);
-      decoded >>= params->subdevice_bits;
+  uint16_t local_protocols[IRDB_MAX_DB_PROTOCOLS];
+  const uint16_t *protocols = db->protocols;
+  uint8_t protocol_count = db->protocol_count;
+
+  /* 未建索引的数据库 (如缓存副本) 临时统计协议 */
+  if (protocol_count == 0 && db->entry_count > 0) {
+    collect_protocols(db, local_protocols, &protocol_count);
+    protocols = local_protocols;
+  }
+  if (protocol_count == 0) {
+    return -ENOENT;
+  }
+
+  int found = irdb_decode_ranked(protocols, protocol_count, timings, length,
+                                 ranked, ARRAY_SIZE(ranked));
+  if (found < 0) {
+    return found;
+  }
+
+  /* 查表后重新排序，误差相同的库中条目提前 */
+  size_t n = 0;
+  for (int i = 0; i < found; i++) {
+    const irdb_entry_t *code = &ranked[i].entry;
+    const irdb_entry_t *entry = irdb_lookup_code(
+        db, code->protocol, code->device, code->subdevice, code->function);
+
+    if (entry) {
+      ranked[i].entry = *entry;
+      ranked[i].in_db = true;
     }
+    n = candidate_insert(out, n, max, &ranked[i]);
+  }
+  return n;
+}
+
+/* 解码原始时序 - 取误差最小的库中条目 */
+int irdb_decode_from_raw(const irdb_database_t *db, const ir_timing_t *timings,
+                         uint32_t length, irdb_entry_t *entry_out) {
+  irdb_candidate_t cand[IRDB_MAX_CANDIDATES];
 
-    uint16_t device = decoded & ((1 << params->device_bits) - 1);
+  if (!db || !timings || length < 4 || !entry_out) {
+    return -EINVAL;
+  }
 
-    // 匹配数据库条目
-    if (device == entry->device && subdevice == entry->subdevice &&
-        function == entry->function) {
-      memcpy(entry_out, entry, sizeof(irdb_entry_t));
+  int n = irdb_decode_candidates(db, timings, length, cand, ARRAY_SIZE(cand));
+  for (int i = 0; i < n; i++) {
+    if (cand[i].in_db) {
+      *entry_out = cand[i].entry;
       return 0;
     }
   }
-
   return -ENOENT;
-}
\ No newline at end of file
+}
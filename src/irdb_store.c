@@ -0,0 +1,432 @@
+/**
+ * @file irdb_store.c
+ * @brief 数据库存储 - 上传会话、镜像文件读写和按名称存取
+ */
+
+#include "irdb_store.h"
+#include "ir_fs.h"
+#include "ir_lz.h"
+#include "irdb_image.h"
+#include "ir_mem.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#ifdef CONFIG_FILE_SYSTEM
+#include <zephyr/fs/fs.h>
+#endif
+
+LOG_MODULE_REGISTER(irdb_store, LOG_LEVEL_INF);
+
+#define STORE_PATH_MAX (sizeof(IRDB_STORE_DIR) + IRDB_STORE_NAME_MAX + 4)
+
+int irdb_upload_begin(irdb_upload_t *up) {
+  if (!up) {
+    return -EINVAL;
+  }
+
+  irdb_upload_abort(up);
+  int ret = irdb_parser_init(&up->parser, &up->db, NULL);
+  if (ret < 0) {
+    return ret;
+  }
+
+  up->bytes = 0;
+  up->entries = 0;
+  up->elapsed_ms = 0;
+  up->start_ms = k_uptime_get();
+  up->active = true;
+  return 0;
+}
+
+int irdb_upload_feed(irdb_upload_t *up, const void *chunk, size_t len) {
+  if (!up || !up->active) {
+    return -EINVAL;
+  }
+
+  up->bytes += len;
+  int ret = irdb_parser_feed(&up->parser, chunk, len);
+  if (ret < 0) {
+    irdb_upload_abort(up);
+  }
+  return ret;
+}
+
+int irdb_upload_end(irdb_upload_t *up) {
+  if (!up || !up->active) {
+    return -EINVAL;
+  }
+
+  /* 失败时解析器已释放db */
+  up->active = false;
+  int ret = irdb_parser_finish(&up->parser);
+  up->entries = ret == 0 ? up->db.entry_count : 0;
+  up->elapsed_ms = k_uptime_get() - up->start_ms;
+  return ret;
+}
+
+int irdb_upload_save(irdb_upload_t *up, const char *name) {
+  int ret = irdb_upload_end(up);
+  if (ret < 0) {
+    return ret;
+  }
+
+  ret = irdb_store_save(name, &up->db);
+  irdb_free_database(&up->db);
+  up->elapsed_ms = k_uptime_get() - up->start_ms;
+  return ret;
+}
+
+void irdb_upload_abort(irdb_upload_t *up) {
+  if (up && up->active) {
+    irdb_free_database(&up->db);
+    up->active = false;
+  }
+}
+
+uint32_t irdb_upload_rate(const irdb_upload_t *up) {
+  return (uint64_t)up->bytes * MSEC_PER_SEC / MAX(up->elapsed_ms, 1);
+}
+
+#ifdef CONFIG_FILE_SYSTEM
+static int read_exact(struct fs_file_t *file, void *buf, size_t len) {
+  ssize_t ret = fs_read(file, buf, len);
+  return ret == (ssize_t)len ? 0 : (ret < 0 ? ret : -EIO);
+}
+
+static int write_exact(struct fs_file_t *file, const void *buf, size_t len) {
+  ssize_t ret = fs_write(file, buf, len);
+  return ret == (ssize_t)len ? 0 : (ret < 0 ? ret : -ENOSPC);
+}
+
+static int lz_file_sink(void *ctx, const void *data, size_t len) {
+  return write_exact(ctx, data, len);
+}
+
+static ssize_t lz_file_source(void *ctx, void *buf, size_t len) {
+  return fs_read(ctx, buf, len);
+}
+
+/* 镜像各段依次写出，压缩时经编码器 */
+static int image_put(struct fs_file_t *file, ir_lz_encoder_t *enc,
+                     const void *data, size_t len) {
+  return enc ? ir_lz_encode(enc, data, len) : write_exact(file, data, len);
+}
+
+int irdb_image_write_file(struct fs_file_t *file, const irdb_database_t *db) {
+  irdb_image_header_t hdr;
+  ir_lz_encoder_t *enc = NULL;
+
+  int ret = irdb_image_header_init(&hdr, db);
+
+#ifdef CONFIG_IR_STORAGE_COMPRESS
+  /* 编码器分配不到时写成未压缩镜像，读取时两者都接受 */
+  enc = ret == 0 ? irdb_heap_alloc(sizeof(*enc)) : NULL;
+  if (enc) {
+    irdb_image_lz_header_t lz = {
+        .magic = IRDB_IMAGE_LZ_MAGIC,
+        .size = hdr.size,
+    };
+    ir_lz_encoder_init(enc, lz_file_sink, file);
+    ret = write_exact(file, &lz, sizeof(lz));
+  }
+#endif
+
+  if (ret == 0) {
+    ret = image_put(file, enc, &hdr, sizeof(hdr));
+  }
+  if (ret == 0) {
+    ret = image_put(file, enc, db->entries,
+                    db->entry_count * sizeof(irdb_entry_t));
+  }
+  if (ret == 0 && hdr.index_size) {
+    ret = image_put(file, enc, db->hash_slots,
+                    2 * hdr.index_size * sizeof(uint16_t));
+  }
+  if (ret == 0) {
+    ret = image_put(file, enc, db->names, db->names_len);
+  }
+  if (ret == 0 && enc) {
+    ret = ir_lz_encode_finish(enc);
+  }
+
+  irdb_heap_free(enc);
+  return ret;
+}
+
+/* 压缩镜像 - 文件按块读入直接解压到镜像缓冲，在其中原地打开 */
+static int image_read_lz(struct fs_file_t *file, irdb_database_t *db) {
+  uint32_t size = 0;
+  uint8_t *image = NULL;
+  ir_lz_decoder_t *dec = NULL;
+
+  int ret = read_exact(file, &size, sizeof(size));
+  if (ret == 0 && size < sizeof(irdb_image_header_t)) {
+    ret = -EINVAL;
+  }
+  if (ret == 0) {
+    image = irdb_heap_alloc(size);
+    dec = irdb_heap_alloc(sizeof(*dec));
+    ret = image && dec ? 0 : -ENOMEM;
+  }
+  if (ret == 0) {
+    ir_lz_decoder_init(dec);
+    ret = ir_lz_decode_all(dec, lz_file_source, file, image, size);
+  }
+  irdb_heap_free(dec);
+
+  if (ret == 0 && ((const irdb_image_header_t *)image)->size != size) {
+    ret = -EINVAL;
+  }
+  if (ret == 0) {
+    ret = irdb_image_open(db, image);
+  }
+  if (ret < 0) {
+    irdb_heap_free(image);
+    memset(db, 0, sizeof(*db));
+    return ret;
+  }
+
+  db->image_buf = image;
+  return 0;
+}
+
+/* 读出镜像头，压缩镜像只解压开头 */
+static int image_read_header(struct fs_file_t *file,
+                             irdb_image_header_t *hdr) {
+  uint32_t size;
+
+  int ret = read_exact(file, &hdr->magic, sizeof(hdr->magic));
+  if (ret < 0 || hdr->magic != IRDB_IMAGE_LZ_MAGIC) {
+    return ret < 0 ? ret
+                   : read_exact(file, &hdr->version,
+                                sizeof(*hdr) - sizeof(hdr->magic));
+  }
+
+  ir_lz_decoder_t *dec = irdb_heap_alloc(sizeof(*dec));
+  ret = dec ? read_exact(file, &size, sizeof(size)) : -ENOMEM;
+  if (ret == 0) {
+    ir_lz_decoder_init(dec);
+    ret = ir_lz_decode_all(dec, lz_file_source, file, hdr, sizeof(*hdr));
+  }
+  irdb_heap_free(dec);
+  return ret;
+}
+
+int irdb_image_read_file(struct fs_file_t *file, irdb_database_t *db) {
+  irdb_image_header_t hdr = {0};
+
+  memset(db, 0, sizeof(*db));
+  int ret = read_exact(file, &hdr.magic, sizeof(hdr.magic));
+  if (ret == 0 && hdr.magic == IRDB_IMAGE_LZ_MAGIC) {
+    return image_read_lz(file, db);
+  }
+  if (ret == 0) {
+    ret = read_exact(file, &hdr.version, sizeof(hdr) - sizeof(hdr.magic));
+  }
+
+  uint32_t entries_size = hdr.entry_count * sizeof(irdb_entry_t);
+  uint32_t slots_size = 2 * hdr.index_size * sizeof(uint16_t);
+
+  if (ret == 0 &&
+      (!irdb_image_is_valid(&hdr) ||
+       hdr.protocol_count > IRDB_MAX_DB_PROTOCOLS ||
+       (hdr.index_size & (hdr.index_size - 1)) != 0 ||
+       hdr.size != sizeof(hdr) + entries_size + slots_size + hdr.names_len)) {
+    ret = -EINVAL;
+  }
+
+  if (ret == 0) {
+    db->entries = irdb_heap_alloc(MAX(entries_size, 1));
+    db->names = irdb_heap_alloc(MAX(hdr.names_len, 1));
+    db->hash_slots = hdr.index_size ? irdb_heap_alloc(slots_size) : NULL;
+    if (!db->entries || !db->names || (hdr.index_size && !db->hash_slots)) {
+      ret = -ENOMEM;
+    }
+  }
+  if (ret == 0) {
+    ret = read_exact(file, db->entries, entries_size);
+  }
+  if (ret == 0 && hdr.index_size) {
+    ret = read_exact(file, db->hash_slots, slots_size);
+  }
+  if (ret == 0) {
+    ret = read_exact(file, db->names, hdr.names_len);
+  }
+  if (ret < 0) {
+    irdb_free_database(db);
+    return ret;
+  }
+
+  db->entry_count = hdr.entry_count;
+  db->names_len = hdr.names_len;
+  memcpy(db->protocols, hdr.protocols, sizeof(db->protocols));
+  db->protocol_count = hdr.protocol_count;
+  if (hdr.index_size) {
+    db->name_slots = db->hash_slots + hdr.index_size;
+    db->hash_mask = hdr.index_size - 1;
+  }
+  return 0;
+}
+
+/* 名称只允许作文件名的字符，不能带目录 */
+static int store_path(char *path, size_t size, const char *name,
+                      const char *ext) {
+  size_t len = name ? strlen(name) : 0;
+
+  if (len == 0 || len >= IRDB_STORE_NAME_MAX || strchr(name, '/') ||
+      name[0] == '.') {
+    return -EINVAL;
+  }
+  snprintf(path, size, "%s/%s.%s", IRDB_STORE_DIR, name, ext);
+  return 0;
+}
+
+int irdb_store_save(const char *name, const irdb_database_t *db) {
+  char path[STORE_PATH_MAX];
+  char tmp_path[STORE_PATH_MAX];
+  struct fs_file_t file;
+
+  if (!db) {
+    return -EINVAL;
+  }
+  int ret = store_path(path, sizeof(path), name, "img");
+  if (ret < 0) {
+    return ret;
+  }
+  store_path(tmp_path, sizeof(tmp_path), name, "tmp");
+
+  ret = ir_fs_mount();
+  if (ret < 0) {
+    return ret;
+  }
+
+  fs_mkdir(IRDB_STORE_DIR);
+  fs_file_t_init(&file);
+  ret = fs_open(&file, tmp_path, FS_O_CREATE | FS_O_WRITE | FS_O_TRUNC);
+  if (ret < 0) {
+    LOG_ERR("Failed to create %s: %d", tmp_path, ret);
+    return ret;
+  }
+
+  ret = irdb_image_write_file(&file, db);
+  fs_close(&file);
+
+  /* LittleFS的rename不覆盖已存在的目标 */
+  if (ret == 0) {
+    fs_unlink(path);
+    ret = fs_rename(tmp_path, path);
+  }
+  if (ret < 0) {
+    fs_unlink(tmp_path);
+    LOG_ERR("Failed to write %s: %d", path, ret);
+    return ret;
+  }
+
+  LOG_INF("Stored %s (%u entries)", path, db->entry_count);
+  return 0;
+}
+
+int irdb_store_load(const char *name, irdb_database_t *db) {
+  char path[STORE_PATH_MAX];
+  struct fs_file_t file;
+
+  int ret = store_path(path, sizeof(path), name, "img");
+  if (ret < 0 || !db) {
+    return -EINVAL;
+  }
+
+  fs_file_t_init(&file);
+  if (ir_fs_mount() < 0 || fs_open(&file, path, FS_O_READ) < 0) {
+    return -ENOENT;
+  }
+
+  ret = irdb_image_read_file(&file, db);
+  fs_close(&file);
+  if (ret < 0) {
+    LOG_ERR("Failed to read %s: %d", path, ret);
+  }
+  return ret;
+}
+
+int irdb_store_delete(const char *name) {
+  char path[STORE_PATH_MAX];
+
+  int ret = store_path(path, sizeof(path), name, "img");
+  if (ret == 0) {
+    ret = ir_fs_mount();
+  }
+  if (ret < 0) {
+    return ret;
+  }
+  return fs_unlink(path);
+}
+
+int irdb_store_list(char *buf, size_t buf_size) {
+  struct fs_dir_t dir;
+  struct fs_dirent entry;
+  size_t used = 0;
+  int count = 0;
+
+  if (!buf || buf_size == 0) {
+    return -EINVAL;
+  }
+  buf[0] = '\0';
+
+  int ret = ir_fs_mount();
+  if (ret < 0) {
+    return ret;
+  }
+
+  fs_dir_t_init(&dir);
+  if (fs_opendir(&dir, IRDB_STORE_DIR) < 0) {
+    return 0;
+  }
+
+  while (fs_readdir(&dir, &entry) == 0 && entry.name[0] != '\0') {
+    char *ext = strrchr(entry.name, '.');
+    char path[STORE_PATH_MAX + 8];
+    irdb_image_header_t hdr = {0};
+    struct fs_file_t file;
+
+    if (entry.type != FS_DIR_ENTRY_FILE || !ext || strcmp(ext, ".img") != 0) {
+      continue;
+    }
+
+    snprintf(path, sizeof(path), "%s/%s", IRDB_STORE_DIR, entry.name);
+    fs_file_t_init(&file);
+    if (fs_open(&file, path, FS_O_READ) == 0) {
+      image_read_header(&file, &hdr);
+      fs_close(&file);
+    }
+
+    *ext = '\0';
+    int n = snprintf(buf + used, buf_size - used, "%s %u %u\n", entry.name,
+                     irdb_image_is_valid(&hdr) ? hdr.entry_count : 0,
+                     (unsigned)entry.size);
+    if (n < 0 || (size_t)n >= buf_size - used) {
+      break;
+    }
+    used += n;
+    count++;
+  }
+
+  fs_closedir(&dir);
+  return count;
+}
+#else
+int irdb_store_save(const char *name, const irdb_database_t *db) {
+  return -ENOTSUP;
+}
+
+int irdb_store_load(const char *name, irdb_database_t *db) {
+  return -ENOTSUP;
+}
+
+int irdb_store_delete(const char *name) { return -ENOTSUP; }
+
+int irdb_store_list(char *buf, size_t buf_size) { return -ENOTSUP; }
+#endif
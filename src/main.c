@@ -3,8 +3,37 @@
  * @brief IR遥控应用 - 使用IRDB数据库 + 自学习功能
  */
 
+#include "ir_adapt.h"
+#include "ir_app.h"
+#include "ir_bench.h"
+#include "ir_calib.h"
+#include "ir_capture.h"
+#include "ir_event.h"
 #include "ir_learning.h"
+#include "ir_ac.h"
+#include "ir_action.h"
+#include "ir_ble.h"
+#include "ir_coap.h"
+#include "ir_link.h"
+#include "ir_loopback.h"
+#include "ir_macro.h"
+#include "ir_mem.h"
+#include "ir_prof.h"
 #include "ir_service.h"
+#include "ir_io.h"
+#include "ir_stats.h"
+#include "ir_thread_stats.h"
+#include "irdb_corpus.h"
+#include "irdb_delta.h"
+#include "irdb_ident.h"
+#include "irdb_image.h"
+#include "irdb_store.h"
+#include "ir_trace.h"
+#include "ir_tx_cache.h"
+#include "ir_usage.h"
+#include "irdb_bulk.h"
+#include "ir_dlink.h"
+#include <stdio.h>
 #include <stdlib.h> // 添加：atoi
 #include <string.h> // 添加：strcmp, strcpy
 #include <zephyr/kernel.h>
@@ -15,31 +44,15 @@ LOG_MODULE_REGISTER(ir_app, LOG_LEVEL_INF);
 
 /* Zephyr已经定义了ARRAY_SIZE，不需要重复定义 */
 
-/* 嵌入式IRDB数据 - Samsung TV (7,7) */
-static const char samsung_tv_7_7[] = "Power,1,7,7,2\n"
-                                     "Source,1,7,7,1\n"
-                                     "Menu,1,7,7,26\n"
-                                     "Up,1,7,7,96\n"
-                                     "Down,1,7,7,97\n"
-                                     "Left,1,7,7,101\n"
-                                     "Right,1,7,7,98\n"
-                                     "Enter,1,7,7,104\n"
-                                     "Back,1,7,7,88\n"
-                                     "Vol+,1,7,7,7\n"
-                                     "Vol-,1,7,7,11\n"
-                                     "Mute,1,7,7,15\n"
-                                     "Ch+,1,7,7,18\n"
-                                     "Ch-,1,7,7,16\n"
-                                     "1,1,7,7,4\n"
-                                     "2,1,7,7,5\n"
-                                     "3,1,7,7,6\n"
-                                     "4,1,7,7,8\n"
-                                     "5,1,7,7,9\n"
-                                     "6,1,7,7,10\n"
-                                     "7,1,7,7,12\n"
-                                     "8,1,7,7,13\n"
-                                     "9,1,7,7,14\n"
-                                     "0,1,7,7,17\n";
+/* 内置IRDB数据 - Samsung TV (7,7)
+ * 二进制镜像，构建时由configs/irdb_samples/Samsung_TV_7_7.csv生成 */
+static const ir_service_config_t samsung_tv_7_7 = {
+    .load_method = IRDB_LOAD_EMBEDDED,
+    .manufacturer = "Samsung",
+    .device_type = "TV",
+    .device = 7,
+    .subdevice = 7,
+};
 
 /* Sony TV IRDB数据 */
 static const char sony_tv[] = "Power,15,1,0,21\n"
@@ -62,20 +75,42 @@ static const char sony_tv[] = "Power,15,1,0,21\n"
 
 /* 接收回调 */
 static void rx_callback(const irdb_entry_t *entry, void *user_data) {
-  LOG_INF("Received: %s", entry->function_name);
+  const char *name = ir_service_entry_name(entry);
+  ir_service_press_t press = {.new_press = true, .id = -ENOENT};
+
+  ir_service_rx_press(&press);
+  LOG_INF("Received: %s (remote '%s')%s", name, ir_service_entry_remote(entry),
+          press.new_press ? "" : " held");
   LOG_INF("  Protocol: %u, Device: %u.%u, Function: %u", entry->protocol,
           entry->device, entry->subdevice, entry->function);
 
-  /* 根据接收到的命令执行操作 */
-  if (strcmp(entry->function_name, "Power") == 0) {
-    LOG_INF(">> Power button action");
-  } else if (strcmp(entry->function_name, "Vol+") == 0) {
-    LOG_INF(">> Volume up action");
-  } else if (strcmp(entry->function_name, "Vol-") == 0) {
-    LOG_INF(">> Volume down action");
-  }
+  /* 按功能编号查动作表执行操作 */
+  ir_action_dispatch(&press);
+}
+
+static void app_power_action(const ir_action_binding_t *binding,
+                             const ir_service_press_t *press) {
+  LOG_INF(">> Power button action");
 }
 
+static void app_volume_action(const ir_action_binding_t *binding,
+                              const ir_service_press_t *press) {
+  LOG_INF(">> Volume %s action", (const char *)binding->user_data);
+}
+
+/* 动作绑定 - 电源键长按不重复触发，音量键长按连续调节 */
+static const ir_action_binding_t app_actions[] = {
+    {.function = "Power", .kind = IR_ACTION_HANDLER,
+     .handler = app_power_action},
+    {.function = "Vol+", .kind = IR_ACTION_HANDLER,
+     .handler = app_volume_action, .user_data = "up",
+     .flags = IR_ACTION_REPEAT},
+    {.function = "Vol-", .kind = IR_ACTION_HANDLER,
+     .handler = app_volume_action, .user_data = "down",
+     .flags = IR_ACTION_REPEAT},
+};
+
+#ifndef CONFIG_IR_APP_PRODUCTION
 /* 发送测试 */
 static void test_send(void) {
   LOG_INF("=== Send Test ===");
@@ -94,6 +129,26 @@ static void test_send(void) {
   }
 }
 
+/* 打印当前遥控器的功能 - 逐条输出，不需要整表缓冲 */
+static void log_functions(void) {
+  const irdb_database_t *db = ir_service_get_database();
+  ir_service_func_iter_t it;
+  irdb_entry_t e;
+  char name[IRDB_NAME_MAX];
+
+  if (!db) {
+    return;
+  }
+
+  LOG_INF("Remote: %s %s (%u functions)", db->manufacturer, db->device_type,
+          db->entry_count);
+  ir_service_func_iter_init(&it, 0);
+  while (ir_service_func_iter_next(&it, &e, name, sizeof(name)) == 0) {
+    LOG_INF("  %-20s P:%u D:%u.%u F:%u", name, e.protocol, e.device,
+            e.subdevice, e.function);
+  }
+}
+
 /* 接收测试 */
 static void test_receive(uint32_t duration_sec) {
   LOG_INF("=== Receive Test ===");
@@ -110,6 +165,168 @@ static void test_receive(uint32_t duration_sec) {
   ir_service_stop_receive();
   LOG_INF("Receive test completed");
 }
+#else
+/* 加载一个配置项 - "<编号>=<厂商>,<类型>,<设备>,<子设备>"为内置遥控器，
+ * 单独的"<编号>"为ir store保存的同名镜像 */
+static int app_load_remote(char *item) {
+  char *manufacturer = strchr(item, '=');
+
+  if (!manufacturer) {
+    irdb_database_t db;
+    int ret = irdb_store_load(item, &db);
+    if (ret == 0) {
+      ret = ir_service_add_database(item, &db);
+      if (ret < 0) {
+        irdb_free_database(&db);
+      }
+    }
+    return ret;
+  }
+
+  char *type = strchr(manufacturer + 1, ',');
+  char *device = type ? strchr(type + 1, ',') : NULL;
+  char *subdevice = device ? strchr(device + 1, ',') : NULL;
+  if (!subdevice) {
+    return -EINVAL;
+  }
+  *manufacturer++ = '\0';
+  *type++ = '\0';
+  *device++ = '\0';
+  *subdevice++ = '\0';
+
+  ir_service_config_t config = {
+      .load_method = IRDB_LOAD_EMBEDDED,
+      .device = strtoul(device, NULL, 0),
+      .subdevice = strtoul(subdevice, NULL, 0),
+  };
+  strncpy(config.manufacturer, manufacturer, sizeof(config.manufacturer) - 1);
+  strncpy(config.device_type, type, sizeof(config.device_type) - 1);
+  return ir_service_add_remote(item, &config);
+}
+
+/* 加载CONFIG_IR_APP_REMOTES (空格分隔)，返回成功加载的个数 -
+ * 个别失败不影响其余的 */
+static int app_load_remotes(void) {
+  char list[] = CONFIG_IR_APP_REMOTES;
+  char *item = list;
+  int loaded = 0;
+
+  while (item) {
+    char *next = strchr(item, ' ');
+    if (next) {
+      *next++ = '\0';
+    }
+    if (*item) {
+      int ret = app_load_remote(item);
+      if (ret < 0) {
+        LOG_ERR("Failed to load remote '%s': %d", item, ret);
+      } else {
+        loaded++;
+      }
+    }
+    item = next;
+  }
+  return loaded;
+}
+
+void ir_app_rx_resume(void) {
+  int ret = ir_service_start_receive(rx_callback, NULL);
+  if (ret < 0) {
+    LOG_ERR("Failed to resume receive: %d", ret);
+  }
+}
+
+/* 产品模式启动 - 接收常开，解码和按键处理都在解码工作队列中完成 */
+static int app_start(void) {
+  int loaded = app_load_remotes();
+  if (loaded == 0) {
+    LOG_WRN("No remote loaded, receiving codes only");
+  }
+
+  char list_buf[256];
+  ir_service_list_remotes(list_buf, sizeof(list_buf));
+  LOG_INF("Remotes:\n%s", list_buf);
+  ir_action_compile(app_actions, ARRAY_SIZE(app_actions));
+
+  int ret = ir_service_start_receive(rx_callback, NULL);
+  if (ret < 0) {
+    LOG_ERR("Failed to start receive: %d", ret);
+    return ret;
+  }
+
+  LOG_INF("Ready: %d remote(s), receiver armed", loaded);
+  return 0;
+}
+#endif /* CONFIG_IR_APP_PRODUCTION */
+
+/* 启动剖析 - 每个阶段的耗时和结束时刻(自内核启动起)，main之前的
+ * 驱动和SYS_INIT初始化计入第一个阶段的结束时刻 */
+static int64_t boot_prev;
+
+static void boot_stage(const char *stage) {
+  int64_t now = k_uptime_ticks();
+
+  LOG_INF("Boot: %-10s %6u us, at %u us", stage,
+          k_ticks_to_us_floor32(now - boot_prev), k_ticks_to_us_floor32(now));
+  boot_prev = now;
+}
+
+/* 不影响收发就绪的初始化 - 就绪之后再做。存储(信号库、数据库存储、
+ * flash缓存)都在首次存取时才挂载和扫描，这里不涉及 */
+static void boot_deferred(void) {
+  __maybe_unused int ret;
+
+  /* 接收头补偿 - 没有校准过时按原始时长 */
+  ir_calib_load();
+  boot_stage("calib");
+
+#ifdef CONFIG_IR_ADAPT
+  /* 学到的遥控器时序 - 之前按标称窗口解码 */
+  ret = ir_adapt_init();
+  if (ret < 0) {
+    LOG_WRN("Timing statistics restore failed: %d", ret);
+  }
+  boot_stage("adapt");
+#endif
+
+#ifdef CONFIG_IR_BLE
+  /* BLE外设 (红外服务/命令链路BLE后端共用) - 失败时shell仍可用 */
+  ret = ir_ble_init();
+  if (ret < 0) {
+    LOG_ERR("BLE init failed: %d", ret);
+  }
+  boot_stage("ble");
+#endif
+
+#ifdef CONFIG_IR_LINK
+  /* 集线器命令链路 - 失败时shell仍可用 */
+  ret = ir_link_init();
+  if (ret < 0) {
+    LOG_ERR("Command link init failed: %d", ret);
+  }
+  boot_stage("link");
+#endif
+
+#ifdef CONFIG_IR_COAP
+  /* CoAP端点 - 网络接口稍后才连上也可先绑定 */
+  ret = ir_coap_init();
+  if (ret < 0) {
+    LOG_ERR("CoAP init failed: %d", ret);
+  }
+  boot_stage("coap");
+#endif
+
+#ifdef CONFIG_IR_USAGE
+  /* 上次运行的使用统计 - 钉住常用功能，预载常用遥控器，放在最后不推迟
+   * 其他传输就绪 */
+  ret = ir_usage_init();
+  if (ret < 0) {
+    LOG_WRN("Usage restore failed: %d", ret);
+  }
+  ir_usage_preload();
+  boot_stage("usage");
+#endif
+}
 
 /* 主函数 */
 int main(void) {
@@ -118,6 +335,7 @@ int main(void) {
   LOG_INF("  + Self-Learning Feature");
   LOG_INF("  nRF52840 + Zephyr RTOS");
   LOG_INF("========================================");
+  boot_stage("kernel");
 
   /* 初始化服务 */
   int ret = ir_service_init();
@@ -125,6 +343,7 @@ int main(void) {
     LOG_ERR("Service init failed: %d", ret);
     return ret;
   }
+  boot_stage("service");
 
   /* 初始化学习模块 */
   ret = ir_learning_init();
@@ -132,19 +351,33 @@ int main(void) {
     LOG_ERR("Learning init failed: %d", ret);
     return ret;
   }
+  boot_stage("learning");
 
-  /* 方式1: 从嵌入式数据加载 */
+#ifdef CONFIG_IR_APP_PRODUCTION
+  /* 产品模式: 接收就绪后再初始化传输，之后主线程退出，由接收回调和
+   * 各传输的线程驱动 */
+  ret = app_start();
+  boot_stage("ready");
+  boot_deferred();
+  return ret;
+#else
+  /* 方式1: 从嵌入式数据加载 - 没有链接内置遥控器
+   * (CONFIG_IRDB_BUILTIN_REMOTES=n)时不致命，之后用shell加载 */
   LOG_INF("Loading Samsung TV database (embedded)...");
-  ret = ir_service_load_embedded_csv(samsung_tv_7_7, "Samsung", "TV");
-  if (ret < 0) {
+  ret = ir_service_load_remote(&samsung_tv_7_7);
+  if (ret < 0 && IS_ENABLED(CONFIG_IRDB_BUILTIN_REMOTES)) {
     LOG_ERR("Failed to load database: %d", ret);
     return ret;
   }
+  if (ret < 0) {
+    LOG_WRN("No built-in remotes linked (%d), load one with 'ir load'", ret);
+  }
+  ir_action_compile(app_actions, ARRAY_SIZE(app_actions));
+  boot_stage("ready");
+  boot_deferred();
 
   /* 显示数据库信息 */
-  char list_buf[1024];
-  ir_service_list_functions(list_buf, sizeof(list_buf));
-  LOG_INF("\n%s", list_buf);
+  log_functions();
 
   k_sleep(K_SECONDS(2));
 
@@ -166,12 +399,12 @@ int main(void) {
 #if 0
         LOG_INF("Switching to Sony TV database...");
         ir_service_load_embedded_csv(sony_tv, "Sony", "TV");
-        ir_service_list_functions(list_buf, sizeof(list_buf));
-        LOG_INF("\n%s", list_buf);
+        log_functions();
 #endif
   }
 
   return 0;
+#endif /* CONFIG_IR_APP_PRODUCTION */
 }
 
 /* Shell命令接口 */
@@ -181,14 +414,25 @@ int main(void) {
 
 /* 加载数据库命令 */
 static int cmd_load(const struct shell *shell, size_t argc, char **argv) {
-  if (argc < 2) {
+  if (argc != 2 && argc != 5) {
     shell_error(shell, "Usage: ir load <samsung|sony>");
+    shell_error(shell, "       ir load <manufacturer> <type> <dev> <subdev>");
     return -EINVAL;
   }
 
   int ret;
-  if (strcmp(argv[1], "samsung") == 0) {
-    ret = ir_service_load_embedded_csv(samsung_tv_7_7, "Samsung", "TV");
+  if (argc == 5) {
+    /* 内置遥控器 (ir remotes列出) */
+    ir_service_config_t config = {
+        .load_method = IRDB_LOAD_EMBEDDED,
+        .device = atoi(argv[3]),
+        .subdevice = atoi(argv[4]),
+    };
+    strncpy(config.manufacturer, argv[1], sizeof(config.manufacturer) - 1);
+    strncpy(config.device_type, argv[2], sizeof(config.device_type) - 1);
+    ret = ir_service_load_remote(&config);
+  } else if (strcmp(argv[1], "samsung") == 0) {
+    ret = ir_service_load_remote(&samsung_tv_7_7);
   } else if (strcmp(argv[1], "sony") == 0) {
     ret = ir_service_load_embedded_csv(sony_tv, "Sony", "TV");
   } else {
@@ -205,109 +449,1731 @@ static int cmd_load(const struct shell *shell, size_t argc, char **argv) {
   return ret;
 }
 
-/* 发送命令 */
+/* 活动集 - 多个遥控器同时加载，"编号:功能"寻址 */
+static int cmd_remote(const struct shell *shell, size_t argc, char **argv) {
+  int ret;
+
+  if (argc < 2) {
+    char buf[256];
+
+    ir_service_list_remotes(buf, sizeof(buf));
+    shell_print(shell, "Active remotes (max %u):\n%s", IR_SERVICE_MAX_REMOTES,
+                buf);
+    return 0;
+  }
+
+  if (strcmp(argv[1], "add") == 0 && argc == 4 &&
+      strcmp(argv[3], "sony") == 0) {
+    ret = ir_service_add_embedded(argv[2], sony_tv, "Sony", "TV");
+  } else if (strcmp(argv[1], "add") == 0 && argc == 7) {
+    ir_service_config_t config = {
+        .load_method = IRDB_LOAD_EMBEDDED,
+        .device = atoi(argv[5]),
+        .subdevice = atoi(argv[6]),
+    };
+    strncpy(config.manufacturer, argv[3], sizeof(config.manufacturer) - 1);
+    strncpy(config.device_type, argv[4], sizeof(config.device_type) - 1);
+    ret = ir_service_add_remote(argv[2], &config);
+  } else if (strcmp(argv[1], "rm") == 0 && argc == 3) {
+    ret = ir_service_remove_remote(argv[2]);
+  } else if (strcmp(argv[1], "use") == 0 && argc == 3) {
+    ret = ir_service_select_remote(argv[2]);
+  } else {
+    shell_error(shell, "Usage: ir remote [add <id> <sony|mfr type dev sub>]");
+    shell_error(shell, "       ir remote <rm|use> <id>");
+    return -EINVAL;
+  }
+
+  if (ret < 0) {
+    shell_error(shell, "Failed: %d", ret);
+  }
+  return ret;
+}
+
+/* 列出内置遥控器 */
+static int cmd_remotes(const struct shell *shell, size_t argc, char **argv) {
+  const irdb_builtin_remote_t *remote;
+  size_t i;
+
+  for (i = 0; (remote = irdb_builtin_get(i)) != NULL; i++) {
+    const irdb_image_header_t *hdr = remote->image;
+    shell_print(shell, "  %s %s %u %u (%u functions)", remote->manufacturer,
+                remote->device_type, remote->device, remote->subdevice,
+                hdr->entry_count);
+  }
+  shell_print(shell, "%u builtin remotes", (unsigned)i);
+  return 0;
+}
+
+/* CSV解析吞吐量 - 反复解析嵌入式数据库直到累计2000行 */
+static int cmd_csvbench(const struct shell *shell, size_t argc, char **argv) {
+  uint32_t target_lines = argc > 1 ? atoi(argv[1]) : 2000;
+  uint32_t lines = 0, bytes = 0, cycles = 0;
+
+  while (lines < target_lines) {
+    irdb_database_t db;
+    uint32_t start = k_cycle_get_32();
+    int ret = irdb_parse_csv(sony_tv, &db);
+    cycles += k_cycle_get_32() - start;
+
+    if (ret < 0) {
+      shell_error(shell, "Parse failed: %d", ret);
+      return ret;
+    }
+    lines += db.entry_count;
+    bytes += sizeof(sony_tv) - 1;
+    irdb_free_database(&db);
+  }
+
+  uint32_t us = k_cyc_to_us_floor32(cycles);
+  shell_print(shell, "Parsed %u lines (%u bytes) in %u us", lines, bytes, us);
+  if (us > 0) {
+    shell_print(shell, "Throughput: %u bytes/ms",
+                (uint32_t)((uint64_t)bytes * 1000 / us));
+  }
+  return 0;
+}
+
+/* 异步发送完成回调 */
+static void send_done_callback(int result, void *user_data) {
+  if (result < 0) {
+    LOG_ERR("Send failed: %d", result);
+  } else {
+    LOG_INF("Send completed");
+  }
+}
+
+/* 发送命令 - 入队后立即返回 */
 static int cmd_send(const struct shell *shell, size_t argc, char **argv) {
   if (argc < 2) {
-    shell_error(shell, "Usage: ir send <function> [repeat]");
+    shell_error(shell, "Usage: ir send <function> [repeat] [channel_mask]");
     return -EINVAL;
   }
 
   const char *function = argv[1];
   uint32_t repeat = argc > 2 ? atoi(argv[2]) : 1;
+  uint8_t channels =
+      argc > 3 ? strtoul(argv[3], NULL, 0) : IR_HAL_TX_CH_DEFAULT;
 
-  shell_print(shell, "Sending: %s (x%u)", function, repeat);
+  shell_print(shell, "Sending: %s (x%u, channels 0x%x)", function, repeat,
+              channels);
 
-  int ret = ir_service_send_command(function, repeat);
+  int ret = ir_service_send_async_on(function, repeat, channels,
+                                     send_done_callback, NULL);
   if (ret < 0) {
     shell_error(shell, "Send failed: %d", ret);
     return ret;
   }
 
-  shell_print(shell, "Sent successfully");
+  shell_print(shell, "Queued successfully");
   return 0;
 }
 
-/* 接收命令 */
-static int cmd_receive(const struct shell *shell, size_t argc, char **argv) {
-  uint32_t duration = argc > 1 ? atoi(argv[1]) : 10;
+/* 宏 - 参数为若干步 [@]名称[,次数[,延时ms]]，@前缀为学习信号，功能名可带
+ * "编号:"前缀 (CSV中的名称不含逗号) */
+static ir_macro_t shell_macro;
 
-  shell_print(shell, "Receiving for %u seconds...", duration);
+static void macro_done_callback(const ir_tx_sequence_t *seq,
+                                void *user_data) {
+  const ir_tx_sequence_report_t *report = &seq->report;
 
-  int ret = ir_service_start_receive(rx_callback, NULL);
+  LOG_INF("Macro done: %d, %u/%u steps, %u/%u ms, late max %u us",
+          report->result, report->steps_sent, seq->step_count,
+          report->elapsed_us / 1000, report->planned_us / 1000,
+          report->max_late_us);
+}
+
+static int cmd_macro(const struct shell *shell, size_t argc, char **argv) {
+  if (argc < 2) {
+    shell_error(shell,
+                "Usage: ir macro <[@]name[,repeat[,delay_ms]]>... | cancel");
+    return -EINVAL;
+  }
+
+  if (strcmp(argv[1], "cancel") == 0) {
+    return ir_macro_cancel(&shell_macro);
+  }
+
+  ir_macro_step_t steps[IR_MACRO_MAX_STEPS];
+  size_t count = MIN(argc - 1, ARRAY_SIZE(steps));
+
+  /* 就地切分参数，名称只在编译期间使用 */
+  for (size_t i = 0; i < count; i++) {
+    char *arg = argv[i + 1];
+    char *field = strchr(arg, ',');
+
+    steps[i] = (ir_macro_step_t){.source = IR_MACRO_FUNCTION, .repeat = 1};
+    if (arg[0] == '@') {
+      steps[i].source = IR_MACRO_SIGNAL;
+      arg++;
+    }
+    steps[i].name = arg;
+    if (field) {
+      *field = '\0';
+      steps[i].repeat = strtoul(field + 1, &field, 0);
+      if (*field == ',') {
+        steps[i].delay_ms = strtoul(field + 1, NULL, 0);
+      }
+    }
+  }
+
+  int ret = ir_macro_free(&shell_macro);
+  if (ret == 0) {
+    ret = ir_macro_compile(&shell_macro, steps, count);
+  }
+  if (ret == 0) {
+    ret = ir_macro_run(&shell_macro, macro_done_callback, NULL);
+  }
   if (ret < 0) {
-    shell_error(shell, "Failed to start: %d", ret);
+    shell_error(shell, "Macro failed: %d", ret);
     return ret;
   }
 
-  k_sleep(K_SECONDS(duration));
-  ir_service_stop_receive();
+  shell_print(shell, "Macro queued: %u steps, %u ms planned", count,
+              ir_macro_duration_us(&shell_macro) / 1000);
+  return 0;
+}
 
-  shell_print(shell, "Receive completed");
+static int cmd_actions(const struct shell *shell, size_t argc, char **argv) {
+  ir_action_stats_t stats;
+
+  ir_action_get_stats(&stats);
+  shell_print(shell,
+              "Actions: %u/%u bound to %u entries, table %u bytes, "
+              "generation %u",
+              stats.compiled, stats.bindings, stats.entries, stats.table_bytes,
+              stats.generation);
+  shell_print(shell, "Compiles: %u, dispatched: %u, unbound: %u",
+              stats.compiles, stats.dispatched, stats.unbound);
   return 0;
 }
 
-/* 列出功能 */
-static int cmd_list(const struct shell *shell, size_t argc, char **argv) {
-  char buf[1024];
+/* 空调 - 保存一份状态，参数逐项修改后整帧发出 */
+static const char *const ac_mode_names[IR_AC_MODE_COUNT] = {
+    "auto", "cool", "dry", "fan", "heat"};
+static const char *const ac_fan_names[IR_AC_FAN_COUNT] = {"autofan", "low",
+                                                          "mid", "high"};
+static ir_ac_state_t shell_ac;
+static bool shell_ac_ready;
+
+static int ac_lookup(const char *const *names, size_t count,
+                     const char *arg) {
+  for (size_t i = 0; i < count; i++) {
+    if (strcmp(names[i], arg) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void ac_print(const struct shell *shell) {
+  shell_print(shell, "State: %s %s %uC fan %s%s",
+              shell_ac.power ? "on" : "off", ac_mode_names[shell_ac.mode],
+              shell_ac.temp_c, ac_fan_names[shell_ac.fan],
+              shell_ac.swing ? " swing" : "");
+}
+
+static int cmd_ac(const struct shell *shell, size_t argc, char **argv) {
+  if (!shell_ac_ready) {
+    ir_ac_state_default(&shell_ac);
+    shell_ac_ready = true;
+  }
+
+  if (argc < 2) {
+    const ir_ac_protocol_t *proto;
+
+    shell_print(shell, "Usage: ir ac <protocol> [on|off] [mode] [temp] "
+                       "[fan] [swing|noswing]");
+    for (size_t i = 0; (proto = ir_ac_get(i)) != NULL; i++) {
+      shell_print(shell, "  %s (%u-%uC)", proto->name, proto->temp_min,
+                  proto->temp_max);
+    }
+    ac_print(shell);
+    return 0;
+  }
+
+  const ir_ac_protocol_t *proto = ir_ac_find(argv[1]);
+  if (!proto) {
+    shell_error(shell, "Unknown AC protocol: %s", argv[1]);
+    return -ENOENT;
+  }
+
+  ir_ac_state_t state = shell_ac;
+  for (size_t i = 2; i < argc; i++) {
+    const char *arg = argv[i];
+    int value;
 
-  int ret = ir_service_list_functions(buf, sizeof(buf));
+    if (strcmp(arg, "on") == 0 || strcmp(arg, "off") == 0) {
+      state.power = arg[1] == 'n';
+    } else if (strcmp(arg, "swing") == 0 || strcmp(arg, "noswing") == 0) {
+      state.swing = arg[0] == 's';
+    } else if ((value = ac_lookup(ac_mode_names, IR_AC_MODE_COUNT, arg)) >=
+               0) {
+      state.mode = value;
+    } else if ((value = ac_lookup(ac_fan_names, IR_AC_FAN_COUNT, arg)) >= 0) {
+      state.fan = value;
+    } else if (arg[0] >= '0' && arg[0] <= '9') {
+      state.temp_c = atoi(arg);
+    } else {
+      shell_error(shell, "Unknown AC setting: %s", arg);
+      return -EINVAL;
+    }
+  }
+
+  int ret = ir_ac_send(proto, &state, IR_HAL_TX_CH_DEFAULT,
+                       send_done_callback, NULL);
   if (ret < 0) {
-    shell_error(shell, "No database loaded");
+    shell_error(shell, "AC send failed: %d", ret);
     return ret;
   }
 
-  shell_print(shell, "%s", buf);
+  shell_ac = state;
+  ac_print(shell);
   return 0;
 }
 
-/* 从文件加载（需要文件系统支持） */
-#ifdef CONFIG_FILE_SYSTEM
-static int cmd_load_file(const struct shell *shell, size_t argc, char **argv) {
-  if (argc < 4) {
-    shell_error(
-        shell,
-        "Usage: ir loadfile <manufacturer> <device_type> <device,subdevice>");
-    shell_error(shell, "Example: ir loadfile Samsung TV 7,7");
-    return -EINVAL;
+/* 发送队列统计 */
+static int cmd_txq(const struct shell *shell, size_t argc, char **argv) {
+  ir_tx_queue_stats_t stats;
+
+  if (argc > 1 && strcmp(argv[1], "cancel") == 0) {
+    ir_tx_queue_cancel_bulk();
+    shell_print(shell, "Bulk TX cancelled");
+    return 0;
   }
 
-  const char *manufacturer = argv[1];
-  const char *device_type = argv[2];
+  uint32_t idle_us, max_ms;
+  ir_tx_queue_get_sense(&idle_us, &max_ms);
 
-  uint8_t device, subdevice;
-  if (sscanf(argv[3], "%hhu,%hhu", &device, &subdevice) != 2) {
-    shell_error(shell, "Invalid device,subdevice format");
-    return -EINVAL;
+  if (argc > 1 && strcmp(argv[1], "sense") == 0) {
+    if (argc > 2) {
+      idle_us = strtoul(argv[2], NULL, 0);
+    }
+    if (argc > 3) {
+      max_ms = strtoul(argv[3], NULL, 0);
+    }
+    ir_tx_queue_set_sense(idle_us, max_ms);
+    ir_tx_queue_get_sense(&idle_us, &max_ms);
+    shell_print(shell, "Carrier sense: %s (idle %u us, max %u ms)",
+                idle_us ? "on" : "off", idle_us, max_ms);
+    return 0;
   }
 
-  ir_service_config_t config = {.load_method = IRDB_LOAD_FILESYSTEM,
-                                .device = device,
-                                .subdevice = subdevice};
+  ir_tx_queue_get_stats(&stats);
 
-  strncpy(config.manufacturer, manufacturer, sizeof(config.manufacturer) - 1);
-  strncpy(config.device_type, device_type, sizeof(config.device_type) - 1);
+  shell_print(shell, "TX queue:");
+  shell_print(shell, "  Depth: %u (max %u / %u)", stats.depth, stats.max_depth,
+              IR_TX_QUEUE_DEPTH);
+  shell_print(shell, "  Submitted: %u, Sent: %u", stats.submitted, stats.sent);
+  shell_print(shell, "  Dropped: %u, Failed: %u", stats.dropped, stats.failed);
+  shell_print(shell, "  Parallel: %u (%u channels)", stats.parallel,
+              IR_HAL_TX_CHANNELS);
+  shell_print(shell, "  Latency: last %u us, max %u us", stats.last_latency_us,
+              stats.max_latency_us);
+  shell_print(shell, "  Sequences: %u, Cancelled: %u, Preempted: %u",
+              stats.sequences, stats.cancelled, stats.preempted);
+  shell_print(shell, "  Gap filled: %u, Coalesced: %u", stats.gap_filled,
+              stats.coalesced);
+  if (stats.timed) {
+    shell_print(shell, "  Timed: %u, late %u, max late %u us", stats.timed,
+                stats.timed_late, stats.timed_max_late_us);
+  }
+  if (idle_us) {
+    shell_print(shell,
+                "  Carrier sense: idle %u us, deferred %u, backoffs %u, "
+                "forced %u, max wait %u us",
+                idle_us, stats.busy_deferred, stats.busy_backoffs,
+                stats.busy_forced, stats.busy_max_wait_us);
+  }
 
-  shell_print(shell, "Loading: %s/%s/%u,%u.csv", manufacturer, device_type,
-              device, subdevice);
+  ir_hal_tx_power_stats_t power;
+  ir_hal_tx_get_power_stats(&power);
 
-  int ret = ir_service_load_remote(&config);
-  if (ret < 0) {
-    shell_error(shell, "Load failed: %d", ret);
-    return ret;
+  shell_print(shell, "TX power:");
+  shell_print(shell, "  Resumes: %u, Powered: %u ms, LED on: %u ms",
+              power.resumes, (uint32_t)(power.powered_us / 1000),
+              (uint32_t)(power.carrier_us / 1000));
+  shell_print(shell, "  Energy: %u uJ (%u uJ/frame, estimated)",
+              power.energy_uj,
+              power.frames ? power.energy_uj / power.frames : 0);
+  return 0;
+}
+
+/* 发送缓存模式与统计 */
+static int cmd_txcache(const struct shell *shell, size_t argc, char **argv) {
+  static const char *const mode_names[] = {"off", "lazy", "precompile"};
+
+  if (argc > 1) {
+    ir_tx_cache_mode_t mode;
+
+    if (strcmp(argv[1], "off") == 0) {
+      mode = IR_TX_CACHE_OFF;
+    } else if (strcmp(argv[1], "lazy") == 0) {
+      mode = IR_TX_CACHE_LAZY;
+    } else if (strcmp(argv[1], "precompile") == 0) {
+      mode = IR_TX_CACHE_PRECOMPILE;
+    } else {
+      shell_error(shell, "Usage: ir txcache [off|lazy|precompile]");
+      return -EINVAL;
+    }
+
+    ir_tx_cache_set_mode(mode);
+    const irdb_database_t *db = ir_service_get_database();
+    if (db) {
+      ir_tx_cache_precompile(db);
+    }
   }
 
-  shell_print(shell, "Loaded successfully");
+  ir_tx_cache_stats_t stats;
+  ir_tx_cache_get_stats(&stats);
+
+  shell_print(shell, "TX cache (%s):", mode_names[ir_tx_cache_get_mode()]);
+  shell_print(shell, "  Slots: %u / %u (%u pinned), %u bytes", stats.used,
+              IR_TX_CACHE_SLOTS, stats.pinned, stats.bytes);
+  shell_print(shell, "  Hits: %u, Misses: %u, Evictions: %u", stats.hits,
+              stats.misses, stats.evictions);
+  return 0;
+}
+
+/* 全局占空比覆盖 - 省电时把所有发送压到同一占空比 */
+static int cmd_duty(const struct shell *shell, size_t argc, char **argv) {
+  if (argc > 1) {
+    uint32_t duty =
+        strcmp(argv[1], "off") == 0 ? 0 : strtoul(argv[1], NULL, 10);
+
+    if (duty != 0 && (duty < IR_PWM_DUTY_MIN || duty > IR_PWM_DUTY_MAX)) {
+      shell_error(shell, "Usage: ir duty [off|%u..%u]", IR_PWM_DUTY_MIN,
+                  IR_PWM_DUTY_MAX);
+      return -EINVAL;
+    }
+    ir_hal_tx_set_duty_override(duty);
+  }
+
+  uint8_t duty = ir_hal_tx_get_duty_override();
+  if (duty > 0) {
+    shell_print(shell, "TX duty: %u%% (override)", duty);
+  } else {
+    shell_print(shell, "TX duty: per protocol/signal (default %u%%)",
+                IR_PWM_DUTY);
+  }
+  return 0;
+}
+
+#ifdef CONFIG_IR_BLE
+/* BLE连接状态与连接参数模式 */
+static int cmd_ble(const struct shell *shell, size_t argc, char **argv) {
+  static const char *const modes[IR_BLE_MODE_COUNT] = {
+      [IR_BLE_MODE_LOW_LATENCY] = "latency",
+      [IR_BLE_MODE_LOW_POWER] = "power",
+  };
+
+  if (argc > 1) {
+    ir_ble_mode_t mode = IR_BLE_MODE_COUNT;
+
+    for (int i = 0; i < IR_BLE_MODE_COUNT; i++) {
+      if (strcmp(argv[1], modes[i]) == 0) {
+        mode = i;
+      }
+    }
+    if (mode == IR_BLE_MODE_COUNT) {
+      shell_error(shell, "Usage: ir ble [latency|power]");
+      return -EINVAL;
+    }
+
+    int ret = ir_ble_set_mode(mode);
+    if (ret < 0) {
+      shell_error(shell, "Parameter update failed: %d", ret);
+      return ret;
+    }
+  }
+
+  ir_ble_status_t status;
+  ir_ble_get_status(&status);
+
+  shell_print(shell, "BLE mode: %s", modes[status.mode]);
+  if (!status.connected) {
+    shell_print(shell, "  Not connected (advertising)");
+  } else {
+    shell_print(shell, "  Interval: %u.%02u ms, latency %u, timeout %u ms",
+                status.interval * 125 / 100, status.interval * 125 % 100,
+                status.latency, status.timeout * 10);
+  }
   return 0;
 }
 #endif
 
-SHELL_STATIC_SUBCMD_SET_CREATE(
-    ir_cmds, SHELL_CMD(load, NULL, "Load embedded database", cmd_load),
-    SHELL_CMD(send, NULL, "Send IR command", cmd_send),
-    SHELL_CMD(receive, NULL, "Receive IR signals", cmd_receive),
-    SHELL_CMD(list, NULL, "List functions", cmd_list),
-#ifdef CONFIG_FILE_SYSTEM
-    SHELL_CMD(loadfile, NULL, "Load from file", cmd_load_file),
+/* 接收缓冲统计 */
+static int cmd_rxq(const struct shell *shell, size_t argc, char **argv) {
+  ir_hal_rx_stats_t stats;
+
+  ir_hal_rx_get_stats(&stats);
+
+  shell_print(shell, "RX ring (%u channel(s)):", IR_HAL_RX_CHANNELS);
+  shell_print(shell, "  Edges: %u, Frames: %u, Wakeups: %u", stats.edges,
+              stats.frames, stats.wakeups);
+  shell_print(shell, "  Max fill: %u / %u", stats.max_fill,
+              IR_HAL_RX_RING_SIZE);
+  shell_print(shell, "  Overflows: %u, Glitches: %u", stats.overflows,
+              stats.glitches);
+  shell_print(shell, "  Echo: %u edges dropped, %u pulses tagged",
+              stats.echo_dropped, stats.echo_tagged);
+  shell_print(shell, "  Frame gap: %u us", ir_hal_rx_get_frame_gap());
+#ifdef IR_HAL_RX_LOWPOWER
+  shell_print(shell, "  Sense wakeups: %u", stats.sense_wakeups);
+#endif
+#ifdef IR_HAL_RX_WAKE_OFF
+  shell_print(shell, "  Wake frames: %u", stats.wake_frames);
+#endif
+#ifdef IR_HAL_RX_ADC
+  ir_hal_rx_adc_stats_t adc;
+
+  ir_hal_rx_adc_get_stats(&adc);
+  shell_print(shell, "  ADC: %u Hz, %u buffers, %u overruns, %u marks",
+              adc.sample_rate, adc.buffers, adc.overruns, adc.marks);
+  shell_print(shell, "  Baseline %u, noise %u, threshold %u",
+              adc.baseline, adc.noise, adc.threshold);
+  shell_print(shell, "  Frame peak: last %u, min %u, max %u", adc.last_peak,
+              adc.min_peak, adc.max_peak);
+#endif
+  return 0;
+}
+
+#ifdef IR_HAL_RX_WAKE_OFF
+/* 进入System OFF - 红外帧唤醒，唤醒帧在启动时捕获 */
+static int cmd_off(const struct shell *shell, size_t argc, char **argv) {
+  shell_print(shell, "Entering System OFF, press a remote key to wake");
+  k_msleep(50); // 让shell输出发完
+  return ir_hal_rx_poweroff();
+}
+#endif
+
+/* 一类记录的时延直方图 - 第0行为总时延，其后逐阶段 */
+static void stats_print_kind(const struct shell *shell, ir_trace_kind_t kind) {
+  int total_stage = kind == IR_TRACE_RX ? IR_TRACE_RX_DISPATCH
+                                        : IR_TRACE_TX_START;
+
+  shell_print(shell, "%s latency (us):", kind == IR_TRACE_RX ? "RX" : "TX");
+  shell_print(shell, "  %-24s %6s %7s %7s  histogram", "span", "n", "avg",
+              "max");
+
+  for (int span = 0; span < IR_TRACE_STAGES; span++) {
+    ir_trace_hist_t h;
+    char label[32];
+    char bins[96];
+    size_t len = 0;
+
+    if (ir_trace_get_hist(kind, span, &h) < 0 || h.count == 0) {
+      continue;
+    }
+
+    snprintf(label, sizeof(label), "%s%s",
+             span == 0 ? "total to " : "",
+             ir_trace_stage_name(kind, span == 0 ? total_stage : span));
+    bins[0] = '\0';
+    for (int b = 0; b < IR_TRACE_HIST_BINS && len < sizeof(bins); b++) {
+      if (h.bins[b] > 0) {
+        len += snprintf(bins + len, sizeof(bins) - len, " <%u:%u",
+                        1U << (b + IR_TRACE_HIST_MIN_SHIFT), h.bins[b]);
+      }
+    }
+    shell_print(shell, "  %-24s %6u %7u %7u %s", label, h.count,
+                (uint32_t)(h.sum_us / h.count), h.max_us, bins);
+  }
+}
+
+/* 最近的记录 - 各阶段为相对第0阶段的偏移 */
+static void stats_print_last(const struct shell *shell, size_t max) {
+  ir_trace_record_t recs[8];
+  size_t n = ir_trace_get_records(recs, MIN(max, ARRAY_SIZE(recs)));
+
+  for (size_t i = 0; i < n; i++) {
+    const ir_trace_record_t *rec = &recs[i];
+    char line[128];
+    size_t len = snprintf(line, sizeof(line), "%s%u P:%-3u",
+                          rec->kind == IR_TRACE_RX ? "RX" : "TX",
+                          rec->channel, rec->protocol);
+
+    for (int s = 1; s < IR_TRACE_STAGES && len < sizeof(line); s++) {
+      if (rec->at_us[s] != IR_TRACE_UNSET) {
+        len += snprintf(line + len, sizeof(line) - len, " %s=+%u",
+                        ir_trace_stage_name(rec->kind, s), rec->at_us[s]);
+      }
+    }
+    shell_print(shell, "  %s", line);
+  }
+  if (n == 0) {
+    shell_print(shell, "  no records");
+  }
+}
+
+/* 流水线时延 - ir stats [rx|tx|last [n]|reset] */
+#ifdef CONFIG_IR_THREAD_STATS
+/* 各线程的栈高水位和CPU占用 - 用量超过栈的90%时标出 */
+static void stats_print_threads(const struct shell *shell) {
+  static ir_thread_stat_t threads[IR_THREAD_STATS_MAX]; // 不占shell栈
+  uint16_t load = 0;
+  int n = ir_thread_stats_get(threads, ARRAY_SIZE(threads), &load);
+
+  if (n < 0) {
+    shell_error(shell, "Thread stats unavailable: %d", n);
+    return;
+  }
+
+  shell_print(shell, "CPU load since last: %u.%u%%", load / 10, load % 10);
+  shell_print(shell, "  %-16s %4s %11s %7s %7s", "thread", "prio",
+              "stack used", "cpu", "boot");
+  for (int i = 0; i < n; i++) {
+    const ir_thread_stat_t *t = &threads[i];
+
+    shell_print(shell, "%c %-16s %4d %5u/%-5u %3u.%u%% %3u.%u%%",
+                t->stack_used * 10 > t->stack_size * 9 ? '!' : ' ', t->name,
+                t->priority, t->stack_used, t->stack_size,
+                t->cpu_permille / 10, t->cpu_permille % 10,
+                t->cpu_total_permille / 10, t->cpu_total_permille % 10);
+  }
+}
+#endif
+
+static int cmd_stats(const struct shell *shell, size_t argc, char **argv) {
+  const char *what = argc > 1 ? argv[1] : "";
+
+  if (strcmp(what, "reset") == 0) {
+    ir_trace_reset();
+    return 0;
+  }
+  if (strcmp(what, "last") == 0) {
+    stats_print_last(shell, argc > 2 ? atoi(argv[2]) : 8);
+    return 0;
+  }
+#ifdef CONFIG_IR_THREAD_STATS
+  if (strcmp(what, "threads") == 0) {
+    stats_print_threads(shell);
+    return 0;
+  }
+#endif
+  if (strcmp(what, "tx") != 0) {
+    stats_print_kind(shell, IR_TRACE_RX);
+  }
+  if (strcmp(what, "rx") != 0) {
+    stats_print_kind(shell, IR_TRACE_TX);
+  }
+  return 0;
+}
+
+/* 热路径事件 - ir events [n] | raw [n] | clear，raw按十六进制输出原始
+ * 记录(时间戳 编号 a b c)供主机解析 */
+static int cmd_events(const struct shell *shell, size_t argc, char **argv) {
+  static ir_event_t events[IR_EVENT_RECORDS]; // 不占shell栈
+  const char *what = argc > 1 ? argv[1] : "";
+  bool raw = strcmp(what, "raw") == 0;
+
+  if (strcmp(what, "clear") == 0) {
+    ir_event_clear();
+    return 0;
+  }
+
+  size_t arg = raw ? 2 : 1;
+  size_t max = argc > arg ? strtoul(argv[arg], NULL, 10) : 16;
+  size_t n = ir_event_get(events, MIN(max, ARRAY_SIZE(events)));
+  uint32_t total = ir_event_total();
+
+  shell_print(shell, "Events: %zu shown, %u recorded, %u overwritten", n,
+              total, total > IR_EVENT_RECORDS ? total - IR_EVENT_RECORDS : 0);
+
+  for (size_t i = 0; i < n; i++) {
+    const ir_event_t *ev = &events[i];
+    char line[80];
+
+    if (raw) {
+      shell_print(shell, "%08x %04x %04x %08x %08x", ev->cycles, ev->id,
+                  ev->a, ev->b, ev->c);
+      continue;
+    }
+    ir_event_format(ev, line, sizeof(line));
+    shell_print(shell, "  %10u us  %s",
+                (uint32_t)k_cyc_to_us_floor64(ev->cycles), line);
+  }
+  return 0;
+}
+
+/* 运行计数 - 各层累计值，解码结果按协议分列(只列非零的协议) */
+static int cmd_counters(const struct shell *shell, size_t argc, char **argv) {
+  static ir_stats_t stats; // 约0.5KB，不占shell栈
+
+  ir_stats_get(&stats);
+
+  shell_print(shell, "RX: edges %u, filtered %u, overflows %u, frames %u",
+              stats.rx.edges, stats.rx.glitches, stats.rx.overflows,
+              stats.rx.frames);
+  shell_print(shell,
+              "Decode: repeats %u, failed %u, dropped %u, memo %u, "
+              "overlap %u",
+              stats.decode.repeats, stats.decode.failed,
+              stats.decode.dropped, stats.decode.memo_hits,
+              stats.decode.overlapped);
+  shell_print(shell, "Keys: events %u, coalesced frames %u",
+              stats.decode.key_events, stats.decode.coalesced);
+  for (uint16_t p = 0; p <= IRDB_PROTOCOL_MAX_ID; p++) {
+    const irdb_protocol_params_t *params;
+
+    if (stats.decode.decoded[p] == 0 && stats.decode.unmatched[p] == 0) {
+      continue;
+    }
+    params = irdb_get_protocol_params(p);
+    shell_print(shell, "  %-3u %-10s decoded %u, not in db %u", p,
+                params && params->name ? params->name : "?",
+                stats.decode.decoded[p], stats.decode.unmatched[p]);
+  }
+  shell_print(shell, "IRDB: cache hits %u, misses %u, evictions %u, "
+              "parsed %u bytes",
+              stats.irdb_cache.hits, stats.irdb_cache.misses,
+              stats.irdb_cache.evictions, stats.parsed_bytes);
+  shell_print(shell, "TX: frames %u, airtime %u ms, failed %u, dropped %u",
+              stats.tx.frames, (uint32_t)(stats.tx.airtime_us / 1000),
+              stats.tx_queue.failed, stats.tx_queue.dropped);
+  shell_print(shell, "TX cache: hits %u, misses %u, evictions %u",
+              stats.tx_cache.hits, stats.tx_cache.misses,
+              stats.tx_cache.evictions);
+  shell_print(shell, "Learn: completed %u (recognized %u), timeouts %u, "
+              "errors %u",
+              stats.learning.completed, stats.learning.recognized,
+              stats.learning.timeouts, stats.learning.errors);
+#ifdef CONFIG_IR_LINK
+  ir_link_stats_t link;
+
+  ir_link_get_stats(&link);
+  shell_print(shell, "Link: commands %u, errors %u, bad frames %u, "
+              "overruns %u, tx errors %u",
+              link.commands, link.errors, link.crc_errors, link.overruns,
+              link.tx_errors);
+#endif
+#ifdef CONFIG_IR_COAP
+  ir_coap_stats_t coap;
+
+  ir_coap_get_stats(&coap);
+  shell_print(shell, "CoAP: requests %u, commands %u, rejected %u, "
+              "errors %u, invalid %u",
+              coap.requests, coap.commands, coap.rejected, coap.errors,
+              coap.invalid);
+#endif
+  return 0;
+}
+
+/* 内存命令 - 数据库堆和时序缓冲池的占用与高水位 */
+static int cmd_mem(const struct shell *shell, size_t argc, char **argv) {
+  ir_mem_stats_t stats;
+
+  ir_mem_get_stats(&stats);
+  shell_print(shell, "DB heap: %u/%u bytes, peak %u, failures %u",
+              stats.heap_used, stats.heap_size, stats.heap_max_used,
+              stats.heap_failures);
+  shell_print(shell, "Timing buffers: %u/%u x %u bytes, peak %u, "
+              "failures %u",
+              stats.bufs_used, stats.bufs_total,
+              (uint32_t)(IR_TIMING_BUF_TIMINGS * sizeof(ir_timing_t)),
+              stats.bufs_max_used, stats.bufs_failures);
+  return 0;
+}
+
+#ifdef CONFIG_IR_USAGE
+/* 使用统计命令 - 常用功能和遥控器，save立即保存并刷新钉住，reset清空 */
+static int cmd_usage(const struct shell *shell, size_t argc, char **argv) {
+  ir_usage_function_t functions[IR_USAGE_PIN];
+  ir_usage_remote_t remote;
+
+  if (argc > 1 && strcmp(argv[1], "save") == 0) {
+    int ret = ir_usage_save();
+    if (ret < 0) {
+      shell_error(shell, "Save failed: %d", ret);
+      return ret;
+    }
+  } else if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+    ir_usage_reset();
+    shell_print(shell, "Usage cleared");
+    return 0;
+  } else if (argc > 1) {
+    shell_error(shell, "Usage: ir usage [save|reset]");
+    return -EINVAL;
+  }
+
+  size_t n = ir_usage_top_functions(functions, ARRAY_SIZE(functions));
+  shell_print(shell, "Hot functions:");
+  for (size_t i = 0; i < n; i++) {
+    const irdb_entry_t *c = &functions[i].code;
+    shell_print(shell, "  %8u  P:%u D:%u.%u F:%u", functions[i].count,
+                c->protocol, c->device, c->subdevice, c->function);
+  }
+
+  n = ir_usage_top_remotes(&remote, 1);
+  if (n > 0) {
+    shell_print(shell, "Top remote: %s %s (%u,%u), %u loads",
+                remote.config.manufacturer, remote.config.device_type,
+                remote.config.device, remote.config.subdevice, remote.count);
+  }
+  return 0;
+}
+#endif
+
+#ifdef CONFIG_IR_ADAPT
+/* 时序自适应命令 - 各(协议, 设备)学到的时序，save立即保存，reset恢复
+ * 标称窗口重新学习 */
+static int cmd_adapt(const struct shell *shell, size_t argc, char **argv) {
+  static const char *const classes[IRDB_ADAPT_CLASSES] = {
+      "hdr mark", "hdr space", "bit mark", "0 space", "1 space"};
+  ir_adapt_pair_t pairs[IR_ADAPT_PAIRS];
+
+  if (argc > 1 && strcmp(argv[1], "save") == 0) {
+    int ret = ir_adapt_save();
+    if (ret < 0) {
+      shell_error(shell, "Save failed: %d", ret);
+      return ret;
+    }
+  } else if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+    ir_adapt_reset();
+    shell_print(shell, "Timing statistics cleared, nominal windows");
+    return 0;
+  } else if (argc > 1) {
+    shell_error(shell, "Usage: ir adapt [save|reset]");
+    return -EINVAL;
+  }
+
+  size_t n = ir_adapt_get_pairs(pairs, ARRAY_SIZE(pairs));
+  shell_print(shell, "%u pair(s)%s", n,
+              ir_adapt_relaxed() ? ", nominal windows (recent misses)" : "");
+  for (size_t i = 0; i < n; i++) {
+    const ir_adapt_pair_t *p = &pairs[i];
+
+    shell_print(shell, "  P:%u D:%u  %u frames%s, clock %u.%03u", p->protocol,
+                p->device, p->frames,
+                p->frames >= IR_ADAPT_MIN_FRAMES ? "" : " (learning)",
+                p->scale >> 12, ((p->scale & 0xFFF) * 1000) >> 12);
+    for (int c = 0; c < IRDB_ADAPT_CLASSES; c++) {
+      if (p->hi_us[c] > 0) {
+        shell_print(shell, "    %-9s %5u-%u us", classes[c], p->lo_us[c],
+                    p->hi_us[c]);
+      }
+    }
+  }
+  return 0;
+}
+#endif
+
+#ifdef CONFIG_IR_IO
+/* I/O执行器统计 - 批次大小、排队等待和阶段执行时间 */
+static int cmd_io(const struct shell *shell, size_t argc, char **argv) {
+  ir_io_stats_t stats;
+
+  ir_io_get_stats(&stats);
+  shell_print(shell, "Jobs: %u submitted, %u completed, %u pending",
+              stats.submitted, stats.completed, stats.pending);
+  shell_print(shell, "  failed %u, canceled %u", stats.failed,
+              stats.canceled);
+  shell_print(shell, "Batches: %u, max %u/%u stages", stats.batches,
+              stats.max_batch, IR_IO_BATCH);
+  shell_print(shell, "Max wait %u us, max run %u us", stats.max_wait_us,
+              stats.max_run_us);
+  return 0;
+}
+#endif
+
+#ifdef CONFIG_IRDB_CORPUS
+/* 镜像库命令 - 外部flash上的离线IRDB，"ir load <mfr> <type> <dev> <sub>"
+ * 对内置镜像中没有的遥控器自动到这里查找 */
+static int cmd_corpus(const struct shell *shell, size_t argc, char **argv) {
+  irdb_corpus_stats_t stats;
+
+  irdb_corpus_get_stats(&stats);
+  if (stats.remotes == 0) {
+    shell_print(shell, "No corpus loaded yet (opened on first lookup)");
+  } else {
+    shell_print(shell, "Corpus: %u remotes, %u bytes", stats.remotes,
+                stats.size);
+  }
+  shell_print(shell, "Loads %u, index probes %u (%u line hits), %u bytes read",
+              stats.loads, stats.probes, stats.line_hits, stats.bytes_read);
+  return 0;
+}
+#endif
+
+#ifdef CONFIG_IRDB_DELTA
+/* 增量更新命令 - 按版本清单更新flash缓存中的遥控器 */
+static int cmd_delta(const struct shell *shell, size_t argc, char **argv) {
+  irdb_delta_stats_t stats;
+
+  int ret = irdb_delta_sync(&stats);
+  if (ret < 0) {
+    shell_error(shell, "Delta sync failed: %d", ret);
+    return ret;
+  }
+
+  shell_print(shell,
+              "%u remotes: %u current, %u patched, %u full, %u failed "
+              "(%u bytes of manifest/delta)",
+              stats.checked, stats.current, stats.patched, stats.full,
+              stats.failed, stats.bytes);
+  return 0;
+}
+#endif
+
+/* 后台接收 - ir receive start之后命令立即返回，收到的按键打印到发起
+ * 命令的shell，其间可照常发送、查看统计。解码工作队列只把按键放进消息
+ * 队列，由系统工作队列打印: shell执行其他命令时输出要等它结束，不能让
+ * 解码等shell */
+typedef struct {
+  char name[IRDB_NAME_MAX];
+  char remote[IR_SERVICE_REMOTE_ID_MAX];
+  irdb_entry_t entry;
+  bool held;
+} rx_shell_event_t;
+
+K_MSGQ_DEFINE(rx_shell_events, sizeof(rx_shell_event_t), 8, 4);
+
+static struct {
+  const struct shell *shell; // 非NULL时后台接收进行中
+  uint32_t dropped;          // 消息队列满丢弃的按键
+} rx_session;
+
+static void rx_shell_work_handler(struct k_work *work);
+static K_WORK_DEFINE(rx_shell_work, rx_shell_work_handler);
+
+static void rx_shell_work_handler(struct k_work *work) {
+  const struct shell *shell = rx_session.shell;
+  rx_shell_event_t ev;
+
+  while (k_msgq_get(&rx_shell_events, &ev, K_NO_WAIT) == 0) {
+    if (!shell) {
+      continue; // 已停止，丢弃剩余的
+    }
+    shell_fprintf(shell, SHELL_NORMAL,
+                  "Received: %s (remote '%s')%s P:%u D:%u.%u F:%u\n",
+                  ev.name, ev.remote, ev.held ? " held" : "",
+                  ev.entry.protocol, ev.entry.device, ev.entry.subdevice,
+                  ev.entry.function);
+  }
+}
+
+/* 解码工作队列中调用 - 名称此时取出，打印时数据库可能已换 */
+static void rx_shell_callback(const irdb_entry_t *entry, void *user_data) {
+  ir_service_press_t press = {.new_press = true};
+  rx_shell_event_t ev = {.entry = *entry};
+
+  ir_service_rx_press(&press);
+  ev.held = !press.new_press;
+  strncpy(ev.name, ir_service_entry_name(entry), sizeof(ev.name) - 1);
+  strncpy(ev.remote, ir_service_entry_remote(entry), sizeof(ev.remote) - 1);
+
+  if (k_msgq_put(&rx_shell_events, &ev, K_NO_WAIT) < 0) {
+    rx_session.dropped++;
+    return;
+  }
+  k_work_submit(&rx_shell_work);
+}
+
+/* 停止后台接收，接收交还应用 */
+static void rx_session_stop(void) {
+  if (!rx_session.shell) {
+    return;
+  }
+  ir_service_stop_receive();
+  rx_session.shell = NULL;
+  ir_app_rx_resume();
+}
+
+/* 接收命令 - ir receive [seconds] 阻塞接收; start|stop 后台接收 */
+static int cmd_receive(const struct shell *shell, size_t argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "start") == 0) {
+    rx_session_stop();
+    rx_session.dropped = 0;
+    rx_session.shell = shell;
+
+    int ret = ir_service_start_receive(rx_shell_callback, NULL);
+    if (ret < 0) {
+      rx_session.shell = NULL;
+      ir_app_rx_resume();
+      shell_error(shell, "Failed to start: %d", ret);
+      return ret;
+    }
+    shell_print(shell, "Receiving in background, 'ir receive stop' to end");
+    return 0;
+  }
+
+  if (argc > 1 && strcmp(argv[1], "stop") == 0) {
+    if (!rx_session.shell) {
+      shell_error(shell, "No background receive running");
+      return -EALREADY;
+    }
+    rx_session_stop();
+    shell_print(shell, "Background receive stopped (%u dropped)",
+                rx_session.dropped);
+    return 0;
+  }
+
+  uint32_t duration = argc > 1 ? atoi(argv[1]) : 10;
+
+  rx_session.shell = NULL; // 阻塞接收接管，后台会话结束
+
+  shell_print(shell, "Receiving for %u seconds...", duration);
+
+  int ret = ir_service_start_receive(rx_callback, NULL);
+  if (ret < 0) {
+    shell_error(shell, "Failed to start: %d", ret);
+    return ret;
+  }
+
+  k_sleep(K_SECONDS(duration));
+  ir_service_stop_receive();
+  ir_app_rx_resume();
+
+  shell_print(shell, "Receive completed");
+  return 0;
+}
+
+/* 嗅探码值 - 不需要数据库，库中没有的按键也打印，便于确定该取IRDB的
+ * 哪个<设备>,<子设备>.csv */
+static void sniff_callback(const irdb_entry_t *code, void *user_data) {
+  const irdb_protocol_params_t *params =
+      irdb_get_protocol_params(code->protocol);
+
+  LOG_INF("Code: %s P:%u D:%u.%u F:%u%s",
+          params && params->name ? params->name : "?", code->protocol,
+          code->device, code->subdevice, code->function,
+          code->name == IRDB_NAME_NONE ? " (not in db)" : "");
+}
+
+static int cmd_sniff(const struct shell *shell, size_t argc, char **argv) {
+  uint32_t duration = argc > 1 ? atoi(argv[1]) : 10;
+
+  shell_print(shell, "Sniffing all protocols for %u seconds...", duration);
+
+  ir_service_set_code_callback(sniff_callback, NULL);
+  int ret = ir_service_start_receive(NULL, NULL);
+  if (ret < 0) {
+    ir_service_set_code_callback(NULL, NULL);
+    shell_error(shell, "Failed to start: %d", ret);
+    return ret;
+  }
+
+  k_sleep(K_SECONDS(duration));
+  ir_service_stop_receive();
+  ir_service_set_code_callback(NULL, NULL);
+  ir_app_rx_resume();
+
+  shell_print(shell, "Sniff completed");
+  return 0;
+}
+
+/* 以十六进制行输出录制字节，scripts/ir_capture.py据此从日志还原文件 */
+static void capture_flush(const struct shell *shell) {
+  uint8_t chunk[32];
+  size_t n;
+
+  while ((n = ir_capture_drain(chunk, sizeof(chunk))) > 0) {
+    char hex[2 * sizeof(chunk) + 1];
+
+    for (size_t i = 0; i < n; i++) {
+      snprintf(hex + 2 * i, 3, "%02x", chunk[i]);
+    }
+    shell_print(shell, "#IRCAP:%s", hex);
+  }
+}
+
+/* 录制边沿流 - ir capture [seconds] [protocol device subdevice function]，
+ * 给出码值时作为标注写入头部(录制期间只按这一个键)。录制中每100ms导出
+ * 一次，串口跟不上时缓冲满的记录整条丢弃 */
+static int cmd_capture(const struct shell *shell, size_t argc, char **argv) {
+  uint32_t duration = argc > 1 ? atoi(argv[1]) : 10;
+  irdb_entry_t label = {.name = IRDB_NAME_NONE};
+  ir_capture_stats_t stats;
+
+  if (argc > 2 && argc != 6) {
+    shell_error(shell, "Usage: ir capture [seconds] [P D S F]");
+    return -EINVAL;
+  }
+  if (argc == 6) {
+    label.protocol = strtoul(argv[2], NULL, 0);
+    label.device = strtoul(argv[3], NULL, 0);
+    label.subdevice = strtoul(argv[4], NULL, 0);
+    label.function = strtoul(argv[5], NULL, 0);
+  }
+
+  int ret = ir_capture_start(IR_HAL_RX_CH_ALL, argc == 6 ? &label : NULL);
+  if (ret < 0) {
+    shell_error(shell, "Capture failed: %d", ret);
+    return ret;
+  }
+
+  shell_print(shell, "#IRCAP:BEGIN %u s", duration);
+  int64_t end = k_uptime_get() + (int64_t)duration * MSEC_PER_SEC;
+
+  while (k_uptime_get() < end) {
+    k_msleep(100);
+    capture_flush(shell);
+  }
+  ir_capture_stop(&stats);
+  capture_flush(shell);
+
+  shell_print(shell, "#IRCAP:END %u bytes, %u records, %u dropped",
+              stats.bytes, stats.records, stats.dropped);
+  return 0;
+}
+
+/* 识别遥控器 - 等一帧解码结果，查识别索引给出候选IRDB文件 */
+static K_SEM_DEFINE(identify_sem, 0, 1);
+static irdb_entry_t identify_code;
+
+static void identify_callback(const irdb_entry_t *code, void *user_data) {
+  if (k_sem_count_get(&identify_sem) == 0) {
+    identify_code = *code;
+    k_sem_give(&identify_sem);
+  }
+}
+
+static int cmd_identify(const struct shell *shell, size_t argc,
+                        char **argv) {
+  uint32_t duration = argc > 1 ? atoi(argv[1]) : 10;
+  const void *index = irdb_ident_builtin();
+
+  if (!index) {
+    shell_error(shell, "No ident index (CONFIG_IRDB_IDENT_INDEX)");
+    return -ENOTSUP;
+  }
+
+  shell_print(shell, "Press any key on the remote (%u s)...", duration);
+
+  k_sem_reset(&identify_sem);
+  ir_service_set_code_callback(identify_callback, NULL);
+  int ret = ir_service_start_receive(NULL, NULL);
+  if (ret == 0) {
+    ret = k_sem_take(&identify_sem, K_SECONDS(duration));
+    ir_service_stop_receive();
+  }
+  ir_service_set_code_callback(NULL, NULL);
+  ir_app_rx_resume();
+  if (ret == -EAGAIN) {
+    shell_error(shell, "No frame decoded");
+    return ret;
+  }
+  if (ret < 0) {
+    shell_error(shell, "Failed to start: %d", ret);
+    return ret;
+  }
+
+  irdb_ident_candidate_t candidates[8];
+  int count = irdb_identify(index, &identify_code, candidates,
+                            ARRAY_SIZE(candidates));
+
+  shell_print(shell, "P:%u D:%u.%u F:%u -> %d candidates",
+              identify_code.protocol, identify_code.device,
+              identify_code.subdevice, identify_code.function, count);
+  for (int i = 0; i < MIN(count, (int)ARRAY_SIZE(candidates)); i++) {
+    char path[64];
+
+    irdb_build_path(path, sizeof(path), candidates[i].manufacturer,
+                    candidates[i].device_type, candidates[i].device,
+                    candidates[i].subdevice);
+    shell_print(shell, "  %s", path);
+  }
+  return count < 0 ? count : 0;
+}
+
+/* TX时序环回 - 跳线TX引脚到一路RX，逐协议测量误差、抖动和吞吐 */
+static int cmd_loopback(const struct shell *shell, size_t argc,
+                        char **argv) {
+  if (argc > 1 && strcmp(argv[1], "stress") == 0) {
+    return cmd_loopback_stress(
+        shell, argc > 2 ? atoi(argv[2]) : IR_HAL_RX_CHANNELS - 1,
+        argc > 3 ? atoi(argv[3]) : 10);
+  }
+
+  uint32_t frames = argc > 1 ? atoi(argv[1]) : 20;
+  uint8_t channel = argc > 2 ? atoi(argv[2]) : IR_HAL_RX_CHANNELS - 1;
+  uint32_t hist[IR_LOOPBACK_HIST_BINS] = {0};
+  int failed = 0;
+
+  shell_print(shell, "Loopback on RX%u, %u frames per protocol", channel,
+              frames);
+  shell_print(shell, "  P   ok/sent  bias(m/s)  jitter  max  lat/max   fps");
+
+  for (uint16_t p = 0; p <= IRDB_PROTOCOL_MAX_ID; p++) {
+    const irdb_protocol_params_t *params = irdb_get_protocol_params(p);
+    ir_loopback_result_t r;
+
+    if (!params) {
+      continue;
+    }
+
+    int ret = ir_loopback_run(p, channel, frames, &r);
+    if (ret < 0) {
+      shell_error(shell, "  %-3u %s: %d", p, params->name ? params->name : "?",
+                  ret);
+      failed++;
+      continue;
+    }
+
+    shell_print(shell, "  %-3u %3u/%-4u %4d/%-4d %5u  %4u  %u/%u  %u", p,
+                r.frames - r.lost, r.frames, r.mark_bias_us, r.space_bias_us,
+                r.jitter_us, r.max_jitter_us, r.latency_us, r.max_latency_us,
+                r.frames_per_sec);
+    for (size_t i = 0; i < IR_LOOPBACK_HIST_BINS; i++) {
+      hist[i] += r.hist[i];
+    }
+  }
+
+  shell_print(shell, "Edge error histogram (us):");
+  for (size_t i = 0; i < IR_LOOPBACK_HIST_BINS; i++) {
+    int lo = ((int)i - IR_LOOPBACK_HIST_BINS / 2) * IR_LOOPBACK_HIST_STEP_US;
+
+    shell_print(shell, "  %4d..%-4d %u", lo, lo + IR_LOOPBACK_HIST_STEP_US,
+                hist[i]);
+  }
+  return failed ? -EIO : 0;
+}
+
+/* 接收压力测试 - 时长逐级减半直到连续两级过半的串丢沿，给出不丢沿的
+ * 最高沿速率 */
+static int cmd_loopback_stress(const struct shell *shell, uint8_t channel,
+                               uint32_t bursts) {
+  static const uint16_t steps_us[] = {800, 400, 200, 100, 60, 40, 30, 20, 10};
+  uint32_t ceiling = 0;
+  int bad = 0;
+
+  shell_print(shell, "RX stress on RX%u, %u bursts of %u pulses per step",
+              channel, bursts, IR_LOOPBACK_MAX_EDGES - 1);
+  shell_print(shell, "  width(us)  edges/s  pulses rx/tx   lost  err avg/max"
+                     "  ovf  glitch");
+
+  for (size_t i = 0; i < ARRAY_SIZE(steps_us) && bad < 2; i++) {
+    ir_loopback_stress_t r;
+    int ret = ir_loopback_stress(channel, steps_us[i], 2 * steps_us[i],
+                                 bursts, &r);
+    if (ret < 0) {
+      shell_error(shell, "  %u us: %d", steps_us[i], ret);
+      return ret;
+    }
+
+    shell_print(shell, "  %4u-%-4u %8u %7u/%-7u %3u  %5u/%-5u %4u %6u",
+                r.min_us, r.max_us, r.edge_rate, r.captured, r.sent,
+                r.lost_bursts, r.mean_error_us, r.max_error_us, r.overflows,
+                r.glitches);
+    if (r.lost_bursts == 0) {
+      ceiling = MAX(ceiling, r.edge_rate);
+    }
+    bad = r.lost_bursts * 2 > r.bursts ? bad + 1 : 0;
+  }
+
+  shell_print(shell, "No loss up to %u edges/s", ceiling);
+  return 0;
+}
+
+/* 接收头校准 - 按已知遥控器的键(或self: 本机LED对着接收头发送) */
+static int cmd_calib(const struct shell *shell, size_t argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "show") == 0) {
+    for (uint8_t i = 0; i < IR_HAL_RX_CHANNELS; i++) {
+      int16_t mark, space;
+
+      ir_hal_rx_get_bias(i, &mark, &space);
+      shell_print(shell, "RX%u bias mark %d us, space %d us", i, mark, space);
+    }
+    return 0;
+  }
+
+  if (argc > 1 && strcmp(argv[1], "clear") == 0) {
+    int ret = ir_calib_clear(argc > 2 ? atoi(argv[2]) : 0);
+    if (ret < 0) {
+      shell_error(shell, "Clear failed: %d", ret);
+    }
+    return ret;
+  }
+
+  uint32_t frames = argc > 1 ? atoi(argv[1]) : 20;
+  uint8_t channel = argc > 2 ? atoi(argv[2]) : 0;
+  bool self = argc > 3 && strcmp(argv[3], "self") == 0;
+  ir_calib_result_t r = {0};
+
+  if (!self) {
+    shell_print(shell, "Press keys on a known remote at RX%u (30 s)...",
+                channel);
+  }
+
+  int ret = ir_calib_run(channel, frames, self ? frames * 400 : 30000, self,
+                         &r);
+  if (r.frames == 0) {
+    shell_error(shell, "Calibration failed: %d", ret);
+    return ret;
+  }
+
+  shell_print(shell, "RX%u: %u frames (%u rejected, last P:%u), %u edges",
+              channel, r.frames, r.rejected, r.protocol, r.edges);
+  shell_print(shell, "  bias mark %d us, space %d us; jitter %u us (max %u)",
+              r.mark_bias_us, r.space_bias_us, r.jitter_us, r.max_jitter_us);
+  if (ret < 0) {
+    shell_error(shell, "Not applied/saved: %d", ret);
+  }
+  return ret;
+}
+
+/* 板上基准 - DWT周期计数逐次计时，输出min/median/p99 */
+static int cmd_bench(const struct shell *shell, size_t argc, char **argv) {
+  uint32_t ops = argc > 1 ? atoi(argv[1]) : 200;
+  const char *only = argc > 2 ? argv[2] : NULL;
+  uint32_t mhz = ir_bench_cycles_per_sec() / 1000000;
+  int failed = 0;
+
+  shell_print(shell, "Cycles per op at %u Hz (p99 includes interrupts)",
+              ir_bench_cycles_per_sec());
+  shell_print(shell, "  %-10s %5s %9s %9s %9s %9s %8s", "op", "n", "min",
+              "median", "p99", "max", "med(us)");
+
+  for (int op = 0; op < IR_BENCH_COUNT; op++) {
+    const char *name = ir_bench_name(op);
+    ir_bench_result_t r;
+
+    if (only && strcmp(only, name) != 0) {
+      continue;
+    }
+
+    int ret = ir_bench_run(op, ops, &r);
+    if (ret == -ENOTSUP) {
+      shell_print(shell, "  %-10s not available", name);
+      continue;
+    }
+    if (ret < 0) {
+      shell_error(shell, "  %-10s failed: %d", name, ret);
+      failed++;
+      continue;
+    }
+
+    shell_print(shell, "  %-10s %5u %9u %9u %9u %9u %8u", name, r.ops, r.min,
+                r.median, r.p99, r.max, mhz ? r.median / mhz : 0);
+  }
+  return failed ? -EIO : 0;
+}
+
+#ifdef CONFIG_IR_PROF
+/* 采样剖析 - ir prof start [hz] | stop | dump，不带参数时列出最热的PC。
+ * 用法: ir prof start; ir bench 1000; ir prof stop; ir prof dump */
+static int cmd_prof(const struct shell *shell, size_t argc, char **argv) {
+  const char *what = argc > 1 ? argv[1] : "";
+  ir_prof_stats_t st;
+
+  if (strcmp(what, "start") == 0) {
+    int ret = ir_prof_start(argc > 2 ? strtoul(argv[2], NULL, 10) : 0);
+    if (ret < 0) {
+      shell_error(shell, "Start failed: %d", ret);
+    }
+    return ret;
+  }
+  if (strcmp(what, "stop") == 0) {
+    ir_prof_stop();
+    what = "";
+  }
+
+  ir_prof_get_stats(&st);
+
+  if (strcmp(what, "dump") == 0) {
+    ir_prof_slot_t slot;
+    uint32_t pos = 0;
+
+    shell_print(shell, IR_PROF_PREFIX "BEGIN %u %u %u", st.hz, st.samples,
+                st.dropped);
+    while (ir_prof_next(&pos, &slot) == 0) {
+      shell_print(shell, IR_PROF_PREFIX "%08x %u", slot.pc, slot.count);
+    }
+    shell_print(shell, IR_PROF_PREFIX "END");
+    return 0;
+  }
+
+  ir_prof_slot_t top[10];
+  size_t n = ir_prof_top(top, ARRAY_SIZE(top));
+
+  shell_print(shell, "%s at %u Hz: %u samples, %u PCs, %u dropped",
+              st.running ? "Running" : "Stopped", st.hz, st.samples,
+              st.distinct, st.dropped);
+  for (size_t i = 0; i < n; i++) {
+    uint32_t pm = st.samples ? top[i].count * 1000ULL / st.samples : 0;
+    shell_print(shell, "  0x%08x %6u %3u.%u%%", top[i].pc, top[i].count,
+                pm / 10, pm % 10);
+  }
+  return 0;
+}
+#endif
+
+/* 列出功能 */
+static int cmd_list(const struct shell *shell, size_t argc, char **argv) {
+  const irdb_database_t *db = ir_service_get_database();
+  ir_service_func_iter_t it;
+  irdb_entry_t e;
+  char name[IRDB_NAME_MAX];
+  int ret;
+
+  if (!db) {
+    shell_error(shell, "No database loaded");
+    return -EINVAL;
+  }
+
+  shell_print(shell, "Remote: %s %s", db->manufacturer, db->device_type);
+  ir_service_func_iter_init(&it, 0);
+  while ((ret = ir_service_func_iter_next(&it, &e, name, sizeof(name))) == 0) {
+    shell_print(shell, "  %-20s P:%u D:%u.%u F:%u", name, e.protocol,
+                e.device, e.subdevice, e.function);
+  }
+  if (ret == -ESTALE) {
+    shell_error(shell, "Remote changed while listing");
+    return ret;
+  }
+
+  shell_print(shell, "Functions (%u)", it.count);
+  return ret == -ENOENT ? 0 : ret;
+}
+
+/* 按前缀查找功能名 - 活动集所有遥控器，按名称排序，分批取出打印 */
+#define FIND_BATCH 8
+
+static int cmd_find(const struct shell *shell, size_t argc, char **argv) {
+  ir_service_match_t m[FIND_BATCH];
+  uint32_t found = 0;
+  uint32_t cycles = 0;
+
+  if (argc < 2) {
+    shell_error(shell, "Usage: ir find <prefix> [max] [skip]");
+    return -EINVAL;
+  }
+
+  uint32_t max = argc > 2 ? strtoul(argv[2], NULL, 0) : 20;
+  uint32_t skip = argc > 3 ? strtoul(argv[3], NULL, 0) : 0;
+
+  while (found < max) {
+    size_t batch = MIN(max - found, FIND_BATCH);
+    uint32_t start = k_cycle_get_32();
+    int n = ir_service_search_functions(argv[1], skip + found, m, batch);
+    cycles += k_cycle_get_32() - start;
+
+    if (n < 0) {
+      shell_error(shell, "Search failed: %d", n);
+      return n;
+    }
+    for (int i = 0; i < n; i++) {
+      shell_print(shell, "  %s%s%-20s #%d", m[i].remote,
+                  m[i].remote[0] ? ":" : "", m[i].name, m[i].id);
+    }
+    found += n;
+    if ((size_t)n < batch) {
+      break;
+    }
+  }
+
+  shell_print(shell, "%u matches in %u us", found,
+              k_cyc_to_us_floor32(cycles));
+  return 0;
+}
+
+/* 从文件加载（需要文件系统支持） */
+#ifdef CONFIG_FILE_SYSTEM
+static int cmd_load_file(const struct shell *shell, size_t argc, char **argv) {
+  if (argc < 4) {
+    shell_error(
+        shell,
+        "Usage: ir loadfile <manufacturer> <device_type> <device,subdevice>");
+    shell_error(shell, "Example: ir loadfile Samsung TV 7,7");
+    return -EINVAL;
+  }
+
+  const char *manufacturer = argv[1];
+  const char *device_type = argv[2];
+
+  uint8_t device, subdevice;
+  if (sscanf(argv[3], "%hhu,%hhu", &device, &subdevice) != 2) {
+    shell_error(shell, "Invalid device,subdevice format");
+    return -EINVAL;
+  }
+
+  ir_service_config_t config = {.load_method = IRDB_LOAD_FILESYSTEM,
+                                .device = device,
+                                .subdevice = subdevice};
+
+  strncpy(config.manufacturer, manufacturer, sizeof(config.manufacturer) - 1);
+  strncpy(config.device_type, device_type, sizeof(config.device_type) - 1);
+
+  shell_print(shell, "Loading: %s/%s/%u,%u.csv", manufacturer, device_type,
+              device, subdevice);
+
+  int ret = ir_service_load_remote(&config);
+  if (ret < 0) {
+    shell_error(shell, "Load failed: %d", ret);
+    return ret;
+  }
+
+  shell_print(shell, "Loaded successfully");
+  return 0;
+}
+#endif
+
+#ifdef CONFIG_IRDB_BULK_LOAD
+/* 批量加载的逐个结果 - 只列出没有进入缓存的 */
+static void bulk_progress(size_t index, size_t count,
+                          const irdb_cache_key_t *key, int result,
+                          void *user_data) {
+  const struct shell *shell = user_data;
+
+  if (result < 0) {
+    shell_warn(shell, "  [%u/%u] %s/%s/%u,%u: %d", index + 1, count,
+               key->manufacturer, key->device_type, key->device,
+               key->subdevice, result);
+  }
+}
+
+/* 批量加载到RAM缓存 - 参数为列表文件，或若干"厂商/类型/设备码,子设备码" */
+static int cmd_bulk(const struct shell *shell, size_t argc, char **argv) {
+  static irdb_cache_key_t keys[CONFIG_SHELL_ARGC_MAX];
+  irdb_bulk_stats_t stats;
+  int ret;
+
+  if (argc < 2) {
+    shell_error(shell, "Usage: ir bulk <list-file> | "
+                       "<manufacturer/type/device,subdevice>...");
+    return -EINVAL;
+  }
+
+  if (argc == 2 && !strchr(argv[1], ',')) {
+    ret = irdb_bulk_load_list(argv[1], bulk_progress, (void *)shell, &stats);
+  } else {
+    for (size_t i = 1; i < argc; i++) {
+      if (irdb_bulk_parse_spec(argv[i], &keys[i - 1]) < 0) {
+        shell_error(shell, "Bad remote: %s", argv[i]);
+        return -EINVAL;
+      }
+    }
+    ret = irdb_bulk_load(keys, argc - 1, bulk_progress, (void *)shell,
+                         &stats);
+  }
+  if (ret < 0) {
+    shell_error(shell, "Bulk load failed: %d", ret);
+    return ret;
+  }
+
+  uint32_t rate = irdb_bulk_rate(&stats);
+
+  shell_print(shell, "%u loaded, %u already cached, %u over cache budget, "
+                     "%u failed",
+              stats.loaded, stats.cached, stats.uncached, stats.failed);
+  shell_print(shell,
+              "%u bytes in %u ms (%u.%u KB/s): read %u ms, parse %u ms, "
+              "waited %u ms",
+              stats.bytes, stats.total_ms, rate / 1024,
+              rate % 1024 * 10 / 1024, stats.read_ms, stats.parse_ms,
+              stats.wait_ms);
+  return 0;
+}
+#endif
+
+#ifdef CONFIG_IR_DLINK
+/* 数据链路的逐个文件结果 */
+static void dlink_progress(const char *path, uint32_t size, int result,
+                           void *user_data) {
+  const struct shell *shell = user_data;
+
+  if (result < 0) {
+    shell_warn(shell, "  %s: %d", path, result);
+  } else {
+    shell_print(shell, "  %s (%u bytes)", path, size);
+  }
+}
+
+/* 红外数据链路 - send <路径>...(目录发送其中全部文件) | recv [静默秒数]
+ * [rx通道]; 两台设备的TX/RX相对，先在接收端执行recv */
+static int cmd_dlink(const struct shell *shell, size_t argc, char **argv) {
+  ir_dlink_stats_t stats;
+  int ret;
+
+  if (argc > 2 && strcmp(argv[1], "send") == 0) {
+    shell_print(shell, "Sending over IR (tick %u us)...", IR_DLINK_TICK_US);
+    ret = ir_dlink_send((const char *const *)&argv[2], argc - 2, 0,
+                        dlink_progress, (void *)shell, &stats);
+  } else if (argc > 1 && strcmp(argv[1], "recv") == 0) {
+    uint32_t idle = argc > 2 ? atoi(argv[2]) : 60;
+    uint8_t channel = argc > 3 ? atoi(argv[3]) : 0;
+
+    shell_print(shell, "Receiving on RX%u (stops after %u s idle)...",
+                channel, idle);
+    ret = ir_dlink_receive(channel, idle * MSEC_PER_SEC, dlink_progress,
+                           (void *)shell, &stats);
+  } else {
+    shell_error(shell, "Usage: ir dlink send <path>... | "
+                       "recv [idle_s] [rx_channel]");
+    return -EINVAL;
+  }
+  if (ret < 0) {
+    shell_error(shell, "Data link failed: %d", ret);
+    return ret;
+  }
+
+  shell_print(shell, "%u files ok, %u failed; %u bytes in %u ms (%u bit/s)",
+              stats.files, stats.failed, stats.bytes, stats.elapsed_ms,
+              ir_dlink_rate(&stats));
+  shell_print(shell, "%u frames, %u resent, %u bad", stats.frames,
+              stats.retries, stats.errors);
+  return 0;
+}
+#endif
+
+#ifdef CONFIG_FILE_SYSTEM
+/* 已编译数据库的上传与存取 - CSV按块经"hex"输入，CSV不在RAM中整体缓存 */
+static irdb_upload_t shell_upload;
+static char shell_upload_name[IRDB_STORE_NAME_MAX];
+
+static int cmd_store(const struct shell *shell, size_t argc, char **argv) {
+  const char *sub = argc > 1 ? argv[1] : "list";
+  int ret;
+
+  if (strcmp(sub, "begin") == 0 && argc == 3) {
+    if (strlen(argv[2]) >= sizeof(shell_upload_name)) {
+      return -EINVAL;
+    }
+    ret = irdb_upload_begin(&shell_upload);
+    if (ret == 0) {
+      strcpy(shell_upload_name, argv[2]);
+    }
+  } else if (strcmp(sub, "hex") == 0 && argc == 3) {
+    uint8_t chunk[IRDB_STORE_HEX_CHUNK];
+    size_t len = hex2bin(argv[2], strlen(argv[2]), chunk, sizeof(chunk));
+
+    ret = len ? irdb_upload_feed(&shell_upload, chunk, len) : -EINVAL;
+  } else if (strcmp(sub, "end") == 0) {
+    ret = irdb_upload_save(&shell_upload, shell_upload_name);
+    if (ret == 0) {
+      uint32_t rate = irdb_upload_rate(&shell_upload);
+
+      shell_print(shell, "%s: %u entries, %u bytes in %u ms (%u.%u KB/s)",
+                  shell_upload_name, shell_upload.entries, shell_upload.bytes,
+                  shell_upload.elapsed_ms, rate / 1024,
+                  rate % 1024 * 10 / 1024);
+    }
+  } else if (strcmp(sub, "abort") == 0) {
+    irdb_upload_abort(&shell_upload);
+    ret = 0;
+  } else if (strcmp(sub, "list") == 0) {
+    char buf[512];
+
+    ret = irdb_store_list(buf, sizeof(buf));
+    if (ret >= 0) {
+      shell_print(shell, "%d stored (name entries bytes):\n%s", ret, buf);
+      ret = 0;
+    }
+  } else if (strcmp(sub, "rm") == 0 && argc == 3) {
+    ret = irdb_store_delete(argv[2]);
+  } else if (strcmp(sub, "load") == 0 && (argc == 3 || argc == 4)) {
+    irdb_database_t db;
+
+    /* 镜像直接读入，无需解析和建索引 */
+    ret = irdb_store_load(argv[2], &db);
+    if (ret == 0) {
+      ret = ir_service_add_database(argc == 4 ? argv[3] : argv[2], &db);
+      if (ret < 0) {
+        irdb_free_database(&db);
+      } else {
+        shell_print(shell, "Loaded %s: %u entries", argv[2], db.entry_count);
+      }
+    }
+  } else {
+    shell_error(shell, "Usage: ir store begin <name> | hex <csv-hex> | end"
+                       " | abort");
+    shell_error(shell, "       ir store list | rm <name>"
+                       " | load <name> [remote_id]");
+    return -EINVAL;
+  }
+
+  if (ret < 0) {
+    shell_error(shell, "store %s failed: %d", sub, ret);
+  }
+  return ret;
+}
+#endif
+
+SHELL_STATIC_SUBCMD_SET_CREATE(
+    ir_cmds, SHELL_CMD(load, NULL, "Load embedded database", cmd_load),
+    SHELL_CMD(remotes, NULL, "List builtin remotes", cmd_remotes),
+    SHELL_CMD(remote, NULL, "Active set [add|rm|use] (send <id>:<function>)",
+              cmd_remote),
+    SHELL_CMD(send, NULL, "Send IR command", cmd_send),
+    SHELL_CMD(macro, NULL, "Run a scene [@]name[,repeat[,delay_ms]]...",
+              cmd_macro),
+    SHELL_CMD(actions, NULL, "Show receive action table", cmd_actions),
+    SHELL_CMD(ac, NULL,
+              "AC state frame <protocol> [on|off] [mode] [temp] [fan]...",
+              cmd_ac),
+    SHELL_CMD(txq, NULL,
+              "Show TX queue stats [cancel | sense [idle_us [max_ms]]]",
+              cmd_txq),
+    SHELL_CMD(txcache, NULL, "TX cache mode/stats [off|lazy|precompile]",
+              cmd_txcache),
+    SHELL_CMD(duty, NULL, "TX duty cycle override [off|percent]", cmd_duty),
+    SHELL_CMD(rxq, NULL, "Show RX ring stats", cmd_rxq),
+#ifdef IR_HAL_RX_WAKE_OFF
+    SHELL_CMD(off, NULL, "System OFF until the next IR frame", cmd_off),
+#endif
+    SHELL_CMD(stats, NULL, "Pipeline latency [rx|tx|last [n]|threads|reset]",
+              cmd_stats),
+    SHELL_CMD(events, NULL, "Hot-path event trace [n|raw [n]|clear]",
+              cmd_events),
+    SHELL_CMD(counters, NULL, "Runtime counters (HAL/service/IRDB/learn)",
+              cmd_counters),
+    SHELL_CMD(mem, NULL, "DB heap and timing buffer usage", cmd_mem),
+#ifdef CONFIG_IR_USAGE
+    SHELL_CMD(usage, NULL, "Hot functions and remotes [save|reset]",
+              cmd_usage),
+#endif
+#ifdef CONFIG_IR_ADAPT
+    SHELL_CMD(adapt, NULL, "Learned remote timing [save|reset]", cmd_adapt),
+#endif
+#ifdef CONFIG_IR_IO
+    SHELL_CMD(io, NULL, "Async I/O executor stats", cmd_io),
+#endif
+#ifdef CONFIG_IRDB_CORPUS
+    SHELL_CMD(corpus, NULL, "External flash IRDB corpus stats", cmd_corpus),
+#endif
+#ifdef CONFIG_IRDB_DELTA
+    SHELL_CMD(delta, NULL, "Update flash-cached remotes from the delta manifest",
+              cmd_delta),
+#endif
+    SHELL_CMD(loopback, NULL,
+              "TX timing loopback [frames] [rx_channel] | stress "
+              "[rx_channel] [bursts]",
+              cmd_loopback),
+    SHELL_CMD(calib, NULL,
+              "RX bias calibration [frames [rx_channel [self]]|show|clear]",
+              cmd_calib),
+    SHELL_CMD(receive, NULL, "Receive IR signals [seconds|start|stop]",
+              cmd_receive),
+    SHELL_CMD(sniff, NULL, "Print decoded codes, no db needed [seconds]",
+              cmd_sniff),
+    SHELL_CMD(capture, NULL, "Record raw edges as hex [seconds] [P D S F]",
+              cmd_capture),
+    SHELL_CMD(identify, NULL, "Identify a remote from one key [seconds]",
+              cmd_identify),
+    SHELL_CMD(list, NULL, "List functions", cmd_list),
+    SHELL_CMD(find, NULL, "Find functions by name prefix <prefix> [max] [skip]",
+              cmd_find),
+    SHELL_CMD(csvbench, NULL, "CSV parser throughput [lines]", cmd_csvbench),
+    SHELL_CMD(bench, NULL, "Cycle-count benchmark [ops] [op]", cmd_bench),
+#ifdef CONFIG_IR_PROF
+    SHELL_CMD(prof, NULL, "Sampling profiler [start [hz]|stop|dump]",
+              cmd_prof),
+#endif
+#ifdef CONFIG_FILE_SYSTEM
+    SHELL_CMD(loadfile, NULL, "Load from file", cmd_load_file),
+    SHELL_CMD(store, NULL, "Stored databases [begin|hex|end|list|rm|load]",
+              cmd_store),
+#endif
+#ifdef CONFIG_IRDB_BULK_LOAD
+    SHELL_CMD(bulk, NULL, "Load remotes into the RAM cache <list|m/t/d,s...>",
+              cmd_bulk),
+#endif
+#ifdef CONFIG_IR_DLINK
+    SHELL_CMD(dlink, NULL, "IR file transfer <send path...|recv [idle_s]>",
+              cmd_dlink),
+#endif
+#ifdef CONFIG_IR_BLE
+    SHELL_CMD(ble, NULL, "BLE connection and mode [latency|power]", cmd_ble),
 #endif
     SHELL_SUBCMD_SET_END);
 
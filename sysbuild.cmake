@@ -0,0 +1,11 @@
+# sysbuild.cmake - nRF5340双核: 应用核镜像之外加上网络核接收引擎
+
+if(SB_CONFIG_IR_NETCORE)
+    ExternalZephyrProject_Add(
+        APPLICATION ir_netcore
+        SOURCE_DIR ${APP_DIR}/netcore
+        BOARD ${SB_CONFIG_IR_NETCORE_BOARD}
+    )
+    set_config_bool(${DEFAULT_IMAGE} CONFIG_IR_HAL_IPC y)
+    sysbuild_add_dependencies(FLASH ${DEFAULT_IMAGE} ir_netcore)
+endif()